@@ -51,6 +51,7 @@
 #include "adb_auth.h"
 #include "adb_io.h"
 #include "adb_listeners.h"
+#include "adb_trace_ring.h"
 #include "adb_unique_fd.h"
 #include "adb_utils.h"
 #include "adb_wifi.h"
@@ -89,11 +90,39 @@ uint32_t calculate_apacket_checksum(const apacket* p) {
     return sum;
 }
 
+// apacket objects are recycled through a per-thread freelist so that steady-state
+// packet dispatch doesn't hit the heap; their payload Blocks are returned to the
+// thread-local block pool (see types.cpp) when the packet is put back.
+static constexpr size_t kMaxFreeApackets = 64;
+
+namespace {
+
+struct ApacketPool {
+    std::vector<apacket*> free_packets;
+
+    ~ApacketPool() {
+        for (apacket* p : free_packets) {
+            delete p;
+        }
+    }
+};
+
+}  // namespace
+
+static thread_local ApacketPool g_apacket_pool;
+
 apacket* get_apacket(void)
 {
-    apacket* p = new apacket();
-    if (p == nullptr) {
-        LOG(FATAL) << "failed to allocate an apacket";
+    apacket* p;
+    auto& pool = g_apacket_pool.free_packets;
+    if (!pool.empty()) {
+        p = pool.back();
+        pool.pop_back();
+    } else {
+        p = new apacket();
+        if (p == nullptr) {
+            LOG(FATAL) << "failed to allocate an apacket";
+        }
     }
 
     memset(&p->msg, 0, sizeof(p->msg));
@@ -102,7 +131,16 @@ apacket* get_apacket(void)
 
 void put_apacket(apacket *p)
 {
-    delete p;
+    // Clearing the payload here (instead of at reuse) returns its buffer to the
+    // block pool of the thread that's done with it.
+    p->payload.clear();
+
+    auto& pool = g_apacket_pool.free_packets;
+    if (pool.size() < kMaxFreeApackets) {
+        pool.push_back(p);
+    } else {
+        delete p;
+    }
 }
 
 void handle_online(atransport *t)
@@ -1226,6 +1264,12 @@ HostRequestResult handle_host_request(std::string_view service, TransportType ty
         return HostRequestResult::Handled;
     }
 
+    // Dump the binary trace ring (see adb_trace_ring.h for the record format).
+    if (service == "trace-ring") {
+        SendOkay(reply_fd, adb_trace_ring_dump());
+        return HostRequestResult::Handled;
+    }
+
     // remove TCP transport
     if (service.starts_with("disconnect:")) {
         std::string address(service.substr(11));
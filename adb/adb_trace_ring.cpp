@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "adb_trace_ring.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+#include <android-base/threads.h>
+
+// 64Ki records * 24 bytes = 1.5MiB. Must be a power of two so the slot index is a
+// single mask instead of a division.
+static constexpr uint64_t kTraceRingSize = 1 << 16;
+static AdbTraceRecord g_trace_ring[kTraceRingSize];
+static std::atomic<uint64_t> g_trace_ring_head{0};
+
+void adb_trace_ring_record(AdbTraceEvent event, uint64_t arg) {
+    // GetThreadId is a syscall on some platforms; do it once per thread.
+    static thread_local uint32_t tid = static_cast<uint32_t>(android::base::GetThreadId());
+
+    uint64_t index = g_trace_ring_head.fetch_add(1, std::memory_order_relaxed);
+    AdbTraceRecord& record = g_trace_ring[index & (kTraceRingSize - 1)];
+    record.timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                  std::chrono::steady_clock::now().time_since_epoch())
+                                  .count();
+    record.event = static_cast<uint32_t>(event);
+    record.tid = tid;
+    record.arg = arg;
+}
+
+std::string adb_trace_ring_dump() {
+    uint64_t head = g_trace_ring_head.load(std::memory_order_relaxed);
+    uint64_t count = std::min(head, kTraceRingSize);
+    uint64_t first = head - count;
+
+    std::string out;
+    out.reserve(sizeof(count) + count * sizeof(AdbTraceRecord));
+    out.append(reinterpret_cast<const char*>(&count), sizeof(count));
+    for (uint64_t i = first; i != head; ++i) {
+        const AdbTraceRecord& record = g_trace_ring[i & (kTraceRingSize - 1)];
+        out.append(reinterpret_cast<const char*>(&record), sizeof(record));
+    }
+    return out;
+}
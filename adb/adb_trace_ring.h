@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+
+// Low-overhead binary tracer for the transport hot paths.
+//
+// ADB_TRACE logging formats strings and writes them out inline on the thread being
+// traced, which perturbs exactly the throughput problems it is used to debug. This
+// tracer instead appends fixed-size records to a process-wide lock-free ring:
+// recording is one relaxed atomic increment, a monotonic clock read and four stores,
+// with no allocation, formatting, locking, or I/O, so it is always on.
+//
+// The ring keeps the most recent 64Ki records. Writers never synchronize with
+// readers, so a dump taken while the process is busy may contain a few torn records
+// at the overwrite frontier; tooling should treat records with implausible
+// timestamps as garbage. That trade keeps the record path wait-free.
+
+enum class AdbTraceEvent : uint32_t {
+    PacketEnqueue = 1,    // arg = payload length
+    PacketDequeue = 2,    // arg = payload length
+    FdeventWakeup = 3,    // arg = number of fdevents dispatched
+    SyncRequestBegin = 4, // arg = sync request id
+    SyncRequestEnd = 5,   // arg = sync request id
+};
+
+struct AdbTraceRecord {
+    uint64_t timestamp_ns;  // steady clock
+    uint32_t event;         // AdbTraceEvent
+    uint32_t tid;
+    uint64_t arg;
+};
+
+// Appends one record to the ring. Wait-free, safe from any thread.
+void adb_trace_ring_record(AdbTraceEvent event, uint64_t arg);
+
+// Serializes the valid portion of the ring, oldest record first: a little-endian
+// uint64_t record count followed by that many raw AdbTraceRecords in host byte
+// order. Served by the "host:trace-ring" service.
+std::string adb_trace_ring_dump();
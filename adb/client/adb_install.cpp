@@ -22,12 +22,15 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <algorithm>
+#include <atomic>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <vector>
 
 #include <android-base/file.h>
 #include <android-base/parsebool.h>
+#include <android-base/parseint.h>
 #include <android-base/stringprintf.h>
 #include <android-base/strings.h>
 
@@ -535,6 +538,106 @@ int install_app(int argc, const char** argv) {
     return res;
 }
 
+// One pending `pm install-write` for a split that still has to be streamed to the device.
+struct InstallWriteItem {
+    std::string local_path;
+    std::string remote_name;
+    std::string session_id;
+    uint64_t size;
+};
+
+// Number of concurrent install-write streams used for multi-split sessions. Each split
+// gets its own abb/exec stream, so the USB transfer of one split overlaps with the
+// device-side write and verification of the others. Override with $ADB_INSTALL_STREAMS;
+// 1 restores the old sequential behavior.
+static size_t parallel_install_streams() {
+    size_t streams = 4;
+    if (const char* env = getenv("ADB_INSTALL_STREAMS")) {
+        size_t env_streams;
+        if (android::base::ParseUint(env, &env_streams) && env_streams >= 1 &&
+            env_streams <= 16) {
+            streams = env_streams;
+        }
+    }
+    return streams;
+}
+
+static bool stream_install_write(const std::string& install_cmd, const InstallWriteItem& item) {
+    std::vector<std::string> cmd_args = {
+            install_cmd,
+            "install-write",
+            "-S",
+            std::to_string(item.size),
+            item.session_id,
+            item.remote_name,
+            "-",
+    };
+
+    unique_fd local_fd(adb_open(item.local_path.c_str(), O_RDONLY | O_CLOEXEC));
+    if (local_fd < 0) {
+        fprintf(stderr, "adb: failed to open %s: %s\n", item.local_path.c_str(), strerror(errno));
+        return false;
+    }
+
+    std::string error;
+    unique_fd remote_fd = send_command(cmd_args, &error);
+    if (remote_fd < 0) {
+        fprintf(stderr, "adb: connect error for write: %s\n", error.c_str());
+        return false;
+    }
+
+    if (!copy_to_file(local_fd.get(), remote_fd.get())) {
+        fprintf(stderr, "adb: failed to write %s: %s\n", item.local_path.c_str(), strerror(errno));
+        return false;
+    }
+
+    char buf[BUFSIZ];
+    read_status_line(remote_fd.get(), buf, sizeof(buf));
+    if (strncmp("Success", buf, 7)) {
+        fprintf(stderr, "adb: failed to write %s\n", item.local_path.c_str());
+        fputs(buf, stderr);
+        return false;
+    }
+    return true;
+}
+
+// Streams all pending install-writes, concurrently when there's more than one split and
+// more than one stream configured. Each worker opens independent device connections, so
+// no state is shared beyond the work list itself.
+static bool stream_install_writes(const std::string& install_cmd,
+                                  const std::vector<InstallWriteItem>& items) {
+    const size_t streams = std::min(parallel_install_streams(), items.size());
+    if (streams <= 1) {
+        for (const auto& item : items) {
+            if (!stream_install_write(install_cmd, item)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::atomic<size_t> next_item(0);
+    std::atomic<bool> success(true);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < streams; ++i) {
+        threads.emplace_back([&]() {
+            while (success.load()) {
+                size_t index = next_item.fetch_add(1);
+                if (index >= items.size()) {
+                    break;
+                }
+                if (!stream_install_write(install_cmd, items[index])) {
+                    success = false;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    return success;
+}
+
 static int install_multiple_app_streamed(int argc, const char** argv) {
     // Find all APK arguments starting at end.
     // All other arguments passed through verbatim.
@@ -606,57 +709,24 @@ static int install_multiple_app_streamed(int argc, const char** argv) {
 
     // Valid session, now stream the APKs
     bool success = true;
-    for (int i = first_apk; i < argc; i++) {
-        const char* file = argv[i];
-        struct stat sb;
-        if (stat(file, &sb) == -1) {
-            fprintf(stderr, "adb: failed to stat \"%s\": %s\n", file, strerror(errno));
-            success = false;
-            goto finalize_session;
-        }
-
-        std::vector<std::string> cmd_args = {
-                install_cmd,
-                "install-write",
-                "-S",
-                std::to_string(sb.st_size),
-                session_id_str,
-                android::base::Basename(file),
-                "-",
-        };
-
-        unique_fd local_fd(adb_open(file, O_RDONLY | O_CLOEXEC));
-        if (local_fd < 0) {
-            fprintf(stderr, "adb: failed to open \"%s\": %s\n", file, strerror(errno));
-            success = false;
-            goto finalize_session;
-        }
-
-        std::string error;
-        unique_fd remote_fd = send_command(cmd_args, &error);
-        if (remote_fd < 0) {
-            fprintf(stderr, "adb: connect error for write: %s\n", error.c_str());
-            success = false;
-            goto finalize_session;
+    {
+        std::vector<InstallWriteItem> write_items;
+        for (int i = first_apk; i < argc; i++) {
+            const char* file = argv[i];
+            struct stat sb;
+            if (stat(file, &sb) == -1) {
+                fprintf(stderr, "adb: failed to stat \"%s\": %s\n", file, strerror(errno));
+                success = false;
+                break;
+            }
+            write_items.push_back({file, android::base::Basename(file), session_id_str,
+                                   static_cast<uint64_t>(sb.st_size)});
         }
-
-        if (!copy_to_file(local_fd.get(), remote_fd.get())) {
-            fprintf(stderr, "adb: failed to write \"%s\": %s\n", file, strerror(errno));
-            success = false;
-            goto finalize_session;
-        }
-
-        read_status_line(remote_fd.get(), buf, sizeof(buf));
-
-        if (strncmp("Success", buf, 7)) {
-            fprintf(stderr, "adb: failed to write \"%s\"\n", file);
-            fputs(buf, stderr);
-            success = false;
-            goto finalize_session;
+        if (success) {
+            success = stream_install_writes(install_cmd, write_items);
         }
     }
 
-finalize_session:
     // Commit session if we streamed everything okay; otherwise abandon.
     std::vector<std::string> service_args = {
             install_cmd,
@@ -796,8 +866,9 @@ int install_multi_package(int argc, const char** argv) {
     fprintf(stdout, "Created parent session ID %d.\n", parent_session_id);
 
     std::vector<int> session_ids;
+    std::vector<InstallWriteItem> write_items;
 
-    // Valid session, now create the individual sessions and stream the APKs
+    // Valid session, now create the individual sessions and queue up the APK writes
     int success = EXIT_FAILURE;
     std::vector<std::string> individual_cmd_args = {install_cmd, "install-create"};
     for (int i = 1; i < first_package; i++) {
@@ -870,45 +941,20 @@ int install_multi_package(int argc, const char** argv) {
                 goto finalize_multi_package_session;
             }
 
-            std::vector<std::string> cmd_args = {
-                    install_cmd,
-                    "install-write",
-                    "-S",
-                    std::to_string(sb.st_size),
-                    session_id_str,
-                    android::base::StringPrintf("%d_%s", i, android::base::Basename(split).c_str()),
-                    "-",
-            };
-
-            unique_fd local_fd(adb_open(split.c_str(), O_RDONLY | O_CLOEXEC));
-            if (local_fd < 0) {
-                fprintf(stderr, "adb: failed to open %s: %s\n", split.c_str(), strerror(errno));
-                goto finalize_multi_package_session;
-            }
-
-            std::string error;
-            unique_fd remote_fd = send_command(cmd_args, &error);
-            if (remote_fd < 0) {
-                fprintf(stderr, "adb: connect error for write: %s\n", error.c_str());
-                goto finalize_multi_package_session;
-            }
-
-            if (!copy_to_file(local_fd.get(), remote_fd.get())) {
-                fprintf(stderr, "adb: failed to write %s: %s\n", split.c_str(), strerror(errno));
-                goto finalize_multi_package_session;
-            }
-
-            read_status_line(remote_fd.get(), buf, sizeof(buf));
-
-            if (strncmp("Success", buf, 7)) {
-                fprintf(stderr, "adb: failed to write %s\n", split.c_str());
-                fputs(buf, stderr);
-                goto finalize_multi_package_session;
-            }
+            write_items.push_back(
+                    {split,
+                     android::base::StringPrintf("%d_%s", i,
+                                                 android::base::Basename(split).c_str()),
+                     session_id_str, static_cast<uint64_t>(sb.st_size)});
         }
         add_session_cmd_args.push_back(std::to_string(session_id));
     }
 
+    // All sessions are created; stream the splits, independent ones concurrently.
+    if (!stream_install_writes(install_cmd, write_items)) {
+        goto finalize_multi_package_session;
+    }
+
     {
         unique_fd fd = send_command(add_session_cmd_args, &error);
         if (fd < 0) {
@@ -494,6 +494,9 @@ void adb_auth_tls_handshake(atransport* t) {
         }
 
         LOG(INFO) << "Attempting to TLS handshake";
+        // Key the session cache by the transport serial (the device address), so
+        // reconnecting to a known device can resume its previous TLS session.
+        t->connection()->SetTlsSessionKey(t->serial);
         bool success = t->connection()->DoTlsHandshake(key.get());
         if (success) {
             LOG(INFO) << "Handshake succeeded. Waiting for CNXN packet...";
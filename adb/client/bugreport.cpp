@@ -26,6 +26,8 @@
 #include <android-base/file.h>
 #include <android-base/strings.h>
 
+#include "adb_io.h"
+#include "adb_unique_fd.h"
 #include "adb_utils.h"
 #include "client/file_sync_client.h"
 
@@ -198,6 +200,53 @@ class BugreportStandardStreamsCallback : public StandardStreamsCallbackInterface
     DISALLOW_COPY_AND_ASSIGN(BugreportStandardStreamsCallback);
 };
 
+// Writes the streamed zipped bugreport straight to the destination file as the device
+// produces it.
+class BugreportStreamedCallback : public StandardStreamsCallbackInterface {
+  public:
+    BugreportStreamedCallback(Bugreport* br, const std::string& dest_file,
+                              const std::string& line_message)
+        : br_(br), dest_file_(dest_file), line_message_(line_message) {
+        fd_.reset(adb_open_mode(dest_file_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                                0644));
+        if (fd_ < 0) {
+            fprintf(stderr, "adb: cannot create '%s': %s\n", dest_file_.c_str(), strerror(errno));
+        }
+    }
+
+    bool opened() const { return fd_ >= 0; }
+
+    void OnStdout(const char* buffer, int length) {
+        if (failed_) return;
+        if (!WriteFdExactly(fd_, buffer, length)) {
+            fprintf(stderr, "adb: cannot write '%s': %s\n", dest_file_.c_str(), strerror(errno));
+            failed_ = true;
+            return;
+        }
+        bytes_written_ += length;
+        br_->UpdateStreamedBytes(line_message_, bytes_written_);
+    }
+
+    void OnStderr(const char* buffer, int length) {
+        OnStream(nullptr, stderr, buffer, length);
+    }
+
+    int Done(int status) {
+        fd_.reset();
+        return failed_ ? -1 : status;
+    }
+
+  private:
+    Bugreport* br_;
+    std::string dest_file_;
+    std::string line_message_;
+    unique_fd fd_;
+    uint64_t bytes_written_ = 0;
+    bool failed_ = false;
+
+    DISALLOW_COPY_AND_ASSIGN(BugreportStreamedCallback);
+};
+
 int Bugreport::DoIt(int argc, const char** argv) {
     if (argc > 2) error_exit("usage: adb bugreport [PATH]");
 
@@ -256,6 +305,29 @@ int Bugreport::DoIt(int argc, const char** argv) {
         }
     }
 
+    // bugreportz 1.2 and later can stream the zipped bugreport to stdout while dumpstate
+    // is still producing it, so the transfer overlaps generation instead of waiting for
+    // the whole file to land on /data and pulling it afterwards.
+    int bugz_major = 0, bugz_minor = 0;
+    sscanf(bugz_version.c_str(), "%d.%d", &bugz_major, &bugz_minor);
+    if (bugz_major > 1 || (bugz_major == 1 && bugz_minor >= 2)) {
+        std::string destination;
+        if (dest_dir.empty()) {
+            destination = dest_file;
+        } else {
+            destination = android::base::StringPrintf("%s%c%s", dest_dir.c_str(),
+                                                      OS_PATH_SEPARATOR, dest_file.c_str());
+        }
+        BugreportStreamedCallback stream_callback(
+                this, destination, "streaming " + android::base::Basename(dest_file));
+        if (!stream_callback.opened()) return 1;
+        int status = SendShellCommand("bugreportz -s", false, &stream_callback);
+        if (status == 0) {
+            printf("Bug report copied to %s\n", destination.c_str());
+        }
+        return status;
+    }
+
     bool show_progress = true;
     std::string bugz_command = "bugreportz -p";
     if (bugz_version == "1.0") {
@@ -278,6 +350,13 @@ void Bugreport::UpdateProgress(const std::string& message, int progress_percenta
         LinePrinter::INFO);
 }
 
+void Bugreport::UpdateStreamedBytes(const std::string& message, uint64_t bytes) {
+    // Stream mode has no total to report a percentage against.
+    line_printer_.Print(android::base::StringPrintf("[%7.2fMB] %s", bytes / 1048576.0,
+                                                    message.c_str()),
+                        LinePrinter::INFO);
+}
+
 int Bugreport::SendShellCommand(const std::string& command, bool disable_shell_protocol,
                                 StandardStreamsCallbackInterface* callback) {
     return send_shell_command(command, disable_shell_protocol, callback);
@@ -285,5 +364,8 @@ int Bugreport::SendShellCommand(const std::string& command, bool disable_shell_p
 
 bool Bugreport::DoSyncPull(const std::vector<const char*>& srcs, const char* dst, bool copy_attrs,
                            const char* name) {
-    return do_sync_pull(srcs, dst, copy_attrs, CompressionType::None, name);
+    // Let the sync layer negotiate the best codec the device offers: even though the
+    // zip's payload is already deflated, zstd stores incompressible blocks nearly for
+    // free, and the text sections that didn't make it into the zip still shrink.
+    return do_sync_pull(srcs, dst, copy_attrs, CompressionType::Any, name);
 }
@@ -25,6 +25,7 @@
 
 class Bugreport {
     friend class BugreportStandardStreamsCallback;
+    friend class BugreportStreamedCallback;
 
   public:
     Bugreport() : line_printer_() {
@@ -43,6 +44,7 @@ class Bugreport {
 
   private:
     virtual void UpdateProgress(const std::string& file_name, int progress_percentage);
+    void UpdateStreamedBytes(const std::string& message, uint64_t bytes);
     LinePrinter line_printer_;
     DISALLOW_COPY_AND_ASSIGN(Bugreport);
 };
@@ -21,6 +21,7 @@
 #include <assert.h>
 #include <ctype.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <inttypes.h>
 #include <limits.h>
 #include <stdarg.h>
@@ -242,6 +243,10 @@ static void help() {
         " $ANDROID_LOG_TAGS        tags to be used by logcat (see logcat --help)\n"
         " $ADB_LOCAL_TRANSPORT_MAX_PORT max emulator scan port (default 5585, 16 emus)\n"
         " $ADB_MDNS_AUTO_CONNECT   comma-separated list of mdns services to allow auto-connect (default adb-tls-connect)\n"
+        " $ADB_SYNC_STREAMS        number of parallel connections for push/pull of directories (default 1, max 16)\n"
+        " $ADB_ADAPTIVE_COMPRESSION pick the push compression codec per file from link speed and payload compressibility\n"
+        " $ADB_DELTA_SYNC         push only the changed blocks of files that already exist on the device\n"
+        " $ADB_INSTALL_STREAMS     number of parallel install-write streams for multi-split installs (default 4, max 16)\n"
     );
     // clang-format on
 }
@@ -371,9 +376,86 @@ static void stdinout_raw_epilogue(int inFd, int outFd, int old_stdin_mode, int o
 #endif
 }
 
+#if defined(__linux__)
+// Returns true if the fd can sit on the non-pipe side of a splice(2) call.
+// Terminals and other character devices can't, and finding that out mid-stream
+// (after data has been pulled into the intermediate pipe) would lose data.
+static bool fd_is_spliceable(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        return false;
+    }
+    return S_ISREG(st.st_mode) || S_ISFIFO(st.st_mode) || S_ISSOCK(st.st_mode);
+}
+
+// Bulk raw-mode fast path: move data between the stdio fd and the server
+// socket with splice(2) instead of bouncing every chunk through a userspace
+// buffer. Each splice call needs a pipe on one side, so when the stdio end is
+// already a pipe (`adb exec-out ... | gzip`) data moves directly, and
+// otherwise the copy runs through an intermediate pipe like the sync service's
+// zero-copy paths. Returns false without consuming anything if the fds can't
+// be spliced, in which case the caller falls back to the read/write loop.
+static bool copy_to_file_spliced(int inFd, int outFd, bool* result, long* total) {
+    static constexpr size_t kSpliceSize = 1024 * 1024;
+
+    if (!fd_is_spliceable(inFd) || !fd_is_spliceable(outFd)) {
+        return false;
+    }
+
+    struct stat st;
+    bool direct = (fstat(inFd, &st) == 0 && S_ISFIFO(st.st_mode)) ||
+                  (fstat(outFd, &st) == 0 && S_ISFIFO(st.st_mode));
+
+    unique_fd pipe_read, pipe_write;
+    if (!direct) {
+        int pipefd[2];
+        if (pipe2(pipefd, O_CLOEXEC) != 0) {
+            return false;
+        }
+        pipe_read.reset(pipefd[0]);
+        pipe_write.reset(pipefd[1]);
+    }
+
+    while (true) {
+        int out_fd = direct ? outFd : pipe_write.get();
+        ssize_t len = splice(inFd, nullptr, out_fd, nullptr, kSpliceSize, SPLICE_F_MOVE);
+        if (len == 0) {
+            break;
+        }
+        if (len < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EINVAL && *total == 0) {
+                // Not spliceable after all (e.g. a socketpair emulation);
+                // nothing was consumed, so the buffered loop can take over.
+                return false;
+            }
+            D("copy_to_file(): splice failed: %s", strerror(errno));
+            *result = false;
+            break;
+        }
+
+        if (!direct) {
+            ssize_t spliced = len;
+            while (spliced > 0) {
+                ssize_t out = splice(pipe_read.get(), nullptr, outFd, nullptr, spliced,
+                                     SPLICE_F_MOVE);
+                if (out <= 0) {
+                    if (out < 0 && errno == EINTR) continue;
+                    D("copy_to_file(): splice to output failed: %s", strerror(errno));
+                    *result = false;
+                    return true;
+                }
+                spliced -= out;
+            }
+        }
+        *total += len;
+    }
+    return true;
+}
+#endif
+
 bool copy_to_file(int inFd, int outFd) {
     bool result = true;
-    std::vector<char> buf(64 * 1024);
     int len;
     long total = 0;
     int old_stdin_mode = -1;
@@ -383,6 +465,16 @@ bool copy_to_file(int inFd, int outFd) {
 
     stdinout_raw_prologue(inFd, outFd, old_stdin_mode, old_stdout_mode);
 
+#if defined(__linux__)
+    if (copy_to_file_spliced(inFd, outFd, &result, &total)) {
+        stdinout_raw_epilogue(inFd, outFd, old_stdin_mode, old_stdout_mode);
+        D("copy_to_file() finished with %s after %lu bytes", result ? "success" : "failure",
+          total);
+        return result;
+    }
+#endif
+
+    std::vector<char> buf(1024 * 1024);
     while (true) {
         if (inFd == STDIN_FILENO) {
             len = unix_read(inFd, buf.data(), buf.size());
@@ -2089,10 +2181,15 @@ int adb_commandline(int argc, const char** argv) {
         TrackAppStreamsCallback callback;
         return adb_connect_command("track-app", nullptr, &callback);
     } else if (!strcmp(argv[0], "track-devices")) {
-        if (argc > 2 || (argc == 2 && strcmp(argv[1], "-l"))) {
-            error_exit("usage: adb track-devices [-l]");
-        }
-        return adb_connect_command(argc == 2 ? "host:track-devices-l" : "host:track-devices");
+        const char* service = "host:track-devices";
+        if (argc == 2 && !strcmp(argv[1], "-l")) {
+            service = "host:track-devices-l";
+        } else if (argc == 2 && !strcmp(argv[1], "--delta")) {
+            service = "host:track-devices-delta";
+        } else if (argc != 1) {
+            error_exit("usage: adb track-devices [-l | --delta]");
+        }
+        return adb_connect_command(service);
     } else if (!strcmp(argv[0], "raw")) {
         if (argc != 2) {
             error_exit("usage: adb raw SERVICE");
@@ -28,12 +28,17 @@
 #include <unistd.h>
 #include <utime.h>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <deque>
 #include <functional>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <variant>
 #include <vector>
 
@@ -42,6 +47,7 @@
 #include "adb.h"
 #include "adb_client.h"
 #include "adb_io.h"
+#include "adb_trace_ring.h"
 #include "adb_utils.h"
 #include "compression_utils.h"
 #include "file_sync_protocol.h"
@@ -52,7 +58,10 @@
 #include "client/commandline.h"
 
 #include <android-base/file.h>
+#include <android-base/parseint.h>
 #include <android-base/strings.h>
+
+#include <openssl/sha.h>
 #include <android-base/stringprintf.h>
 
 using namespace std::literals;
@@ -242,6 +251,15 @@ class SyncConnection {
             have_sendrecv_v2_lz4_ = CanUseFeature(*features, kFeatureSendRecv2LZ4);
             have_sendrecv_v2_zstd_ = CanUseFeature(*features, kFeatureSendRecv2Zstd);
             have_sendrecv_v2_dry_run_send_ = CanUseFeature(*features, kFeatureSendRecv2DryRunSend);
+            have_delta_sync_ = CanUseFeature(*features, kFeatureDeltaSync);
+            have_sparse_sync_ = CanUseFeature(*features, kFeatureSparseSync);
+            have_sync_snapshot_ = CanUseFeature(*features, kFeatureSyncSnapshot);
+            if (const char* adaptive = getenv("ADB_ADAPTIVE_COMPRESSION")) {
+                adaptive_compression_ = strcmp(adaptive, "0") != 0;
+            }
+            if (const char* delta = getenv("ADB_DELTA_SYNC")) {
+                delta_sync_ = strcmp(delta, "0") != 0;
+            }
             std::string error;
             fd.reset(adb_connect("sync:", &error));
             if (fd < 0) {
@@ -271,6 +289,9 @@ class SyncConnection {
     bool HaveSendRecv2LZ4() const { return have_sendrecv_v2_lz4_; }
     bool HaveSendRecv2Zstd() const { return have_sendrecv_v2_zstd_; }
     bool HaveSendRecv2DryRunSend() const { return have_sendrecv_v2_dry_run_send_; }
+    bool UseDeltaSync() const { return delta_sync_ && have_delta_sync_; }
+    bool HaveSparseSync() const { return have_sparse_sync_; }
+    bool HaveSyncSnapshot() const { return have_sync_snapshot_; }
 
     // Resolve a compression type which might be CompressionType::Any to a specific compression
     // algorithm.
@@ -288,6 +309,67 @@ class SyncConnection {
         return compression;
     }
 
+    // Picks a codec for a single file in adaptive mode: skip compression entirely for
+    // payloads that don't compress, and otherwise spend more CPU per byte the slower
+    // the link is. `sample` is the file's first block.
+    CompressionType ChooseAdaptiveCompression(const Block& sample) {
+        if (!sample.empty() && HaveSendRecv2LZ4()) {
+            LZ4Encoder probe(SYNC_DATA_MAX);
+            Block input(sample.size());
+            memcpy(input.data(), sample.data(), sample.size());
+            probe.Append(std::move(input));
+            probe.Finish();
+
+            size_t encoded_size = 0;
+            bool done = false;
+            while (!done) {
+                Block output;
+                switch (probe.Encode(&output)) {
+                    case EncodeResult::MoreOutput:
+                        encoded_size += output.size();
+                        break;
+                    case EncodeResult::Done:
+                        encoded_size += output.size();
+                        done = true;
+                        break;
+                    case EncodeResult::NeedInput:
+                    case EncodeResult::Error:
+                        // Can't happen after Finish, but don't loop forever if it does.
+                        done = true;
+                        break;
+                }
+            }
+
+            // Already-compressed payloads (APKs, media) don't shrink even under LZ4;
+            // if the probe didn't shave off at least ~5%, a codec is pure CPU waste.
+            if (done && encoded_size + sample.size() / 20 >= sample.size()) {
+                return CompressionType::None;
+            }
+        }
+
+        double rate = TransferRateMBps();
+        if (rate >= 100.0) {
+            // USB3-class link: only LZ4 keeps up without pegging a core.
+            if (HaveSendRecv2LZ4()) return CompressionType::LZ4;
+        } else if (rate > 0.0 && rate < 10.0) {
+            // Slow Wi-Fi link: ratio dominates, so pay for Brotli.
+            if (HaveSendRecv2Brotli()) return CompressionType::Brotli;
+        }
+        return ResolveCompressionType(CompressionType::Any);
+    }
+
+    // Observed throughput of this session so far, or a negative value if we haven't
+    // transferred enough yet for the measurement to mean anything.
+    double TransferRateMBps() const {
+        static constexpr uint64_t kMinSampleBytes = 4 * 1024 * 1024;
+        if (global_ledger_.bytes_transferred < kMinSampleBytes) return -1.0;
+
+        std::chrono::duration<double> s =
+                std::chrono::steady_clock::now() - global_ledger_.start_time;
+        if (s.count() <= 0) return -1.0;
+        return static_cast<double>(global_ledger_.bytes_transferred) / s.count() / (1024 * 1024);
+    }
+
     const FeatureSet& Features() const { return *features_; }
 
     bool IsValid() { return fd >= 0; }
@@ -346,10 +428,12 @@ class SyncConnection {
         req->path_length = path.length();
         char* data = reinterpret_cast<char*>(req + 1);
         memcpy(data, path.data(), path.length());
+        adb_trace_ring_record(AdbTraceEvent::SyncRequestBegin, id);
         return WriteFdExactly(fd, buf.data(), buf.size());
     }
 
-    bool SendSend2(std::string_view path, mode_t mode, CompressionType compression, bool dry_run) {
+    bool SendSend2(std::string_view path, mode_t mode, CompressionType compression, bool dry_run,
+                   bool delta, bool sparse) {
         if (path.length() > 1024) {
             Error("SendRequest failed: path too long: %zu", path.length());
             errno = ENAMETOOLONG;
@@ -390,6 +474,14 @@ class SyncConnection {
             msg.send_v2_setup.flags |= kSyncFlagDryRun;
         }
 
+        if (delta) {
+            msg.send_v2_setup.flags |= kSyncFlagDelta;
+        }
+
+        if (sparse) {
+            msg.send_v2_setup.flags |= kSyncFlagSparse;
+        }
+
         buf.resize(sizeof(SyncRequest) + path.length() + sizeof(msg.send_v2_setup));
 
         void* p = buf.data();
@@ -401,7 +493,7 @@ class SyncConnection {
         return WriteFdExactly(fd, buf.data(), buf.size());
     }
 
-    bool SendRecv2(const std::string& path, CompressionType compression) {
+    bool SendRecv2(const std::string& path, CompressionType compression, bool allow_sparse) {
         if (path.length() > 1024) {
             Error("SendRequest failed: path too long: %zu", path.length());
             errno = ENAMETOOLONG;
@@ -437,6 +529,10 @@ class SyncConnection {
                 LOG(FATAL) << "unexpected CompressionType::Any";
         }
 
+        if (allow_sparse) {
+            msg.recv_v2_setup.flags |= kSyncFlagSparse;
+        }
+
         buf.resize(sizeof(SyncRequest) + path.length() + sizeof(msg.recv_v2_setup));
 
         void* p = buf.data();
@@ -448,6 +544,53 @@ class SyncConnection {
         return WriteFdExactly(fd, buf.data(), buf.size());
     }
 
+    bool SendSnapshot(const std::string& path, CompressionType compression) {
+        if (path.length() > 1024) {
+            Error("SendSnapshot failed: path too long: %zu", path.length());
+            errno = ENAMETOOLONG;
+            return false;
+        }
+
+        Block buf;
+
+        SyncRequest req;
+        req.id = ID_SNAP;
+        req.path_length = path.length();
+
+        syncmsg msg;
+        msg.snap_setup.id = ID_SNAP;
+        msg.snap_setup.flags = 0;
+        switch (compression) {
+            case CompressionType::None:
+                break;
+
+            case CompressionType::Brotli:
+                msg.snap_setup.flags |= kSyncFlagBrotli;
+                break;
+
+            case CompressionType::LZ4:
+                msg.snap_setup.flags |= kSyncFlagLZ4;
+                break;
+
+            case CompressionType::Zstd:
+                msg.snap_setup.flags |= kSyncFlagZstd;
+                break;
+
+            case CompressionType::Any:
+                LOG(FATAL) << "unexpected CompressionType::Any";
+        }
+
+        buf.resize(sizeof(SyncRequest) + path.length() + sizeof(msg.snap_setup));
+
+        void* p = buf.data();
+
+        p = mempcpy(p, &req, sizeof(SyncRequest));
+        p = mempcpy(p, path.data(), path.length());
+        p = mempcpy(p, &msg.snap_setup, sizeof(msg.snap_setup));
+
+        return WriteFdExactly(fd, buf.data(), buf.size());
+    }
+
     bool SendStat(const std::string& path) {
         if (!have_stat_v2_) {
             errno = ENOTSUP;
@@ -523,6 +666,132 @@ class SyncConnection {
         return SendRequest(have_ls_v2_ ? ID_LIST_V2 : ID_LIST_V1, path);
     }
 
+    struct SnapshotEntry {
+        uint32_t mode;
+        uint64_t size;
+        int64_t mtime;
+    };
+
+    // Fetches stat data for an entire remote subtree in one ID_SNAP request; the result maps
+    // each entry's path relative to `path` (no leading slash) to its stat data.  A nonexistent
+    // remote path yields an empty snapshot.  Returns false on protocol failure, after which
+    // the connection must not be reused.
+    bool GetDirectorySnapshot(const std::string& path, CompressionType compression,
+                              std::unordered_map<std::string, SnapshotEntry>* entries) {
+        compression = ResolveCompressionType(compression);
+        if (!SendSnapshot(path, compression)) return false;
+
+        Block buffer(SYNC_DATA_MAX);
+        std::variant<std::monostate, NullDecoder, BrotliDecoder, LZ4Decoder, ZstdDecoder>
+                decoder_storage;
+        Decoder* decoder = nullptr;
+
+        std::span buffer_span(buffer.data(), buffer.size());
+        switch (compression) {
+            case CompressionType::None:
+                decoder = &decoder_storage.emplace<NullDecoder>(buffer_span);
+                break;
+
+            case CompressionType::Brotli:
+                decoder = &decoder_storage.emplace<BrotliDecoder>(buffer_span);
+                break;
+
+            case CompressionType::LZ4:
+                decoder = &decoder_storage.emplace<LZ4Decoder>(buffer_span);
+                break;
+
+            case CompressionType::Zstd:
+                decoder = &decoder_storage.emplace<ZstdDecoder>(buffer_span);
+                break;
+
+            case CompressionType::Any:
+                LOG(FATAL) << "unexpected CompressionType::Any";
+        }
+
+        // Records can straddle ID_DATA packet and decoder output boundaries, so decompressed
+        // bytes accumulate here until a full record is available.
+        std::vector<char> pending;
+        while (true) {
+            syncmsg msg;
+            if (!ReadFdExactly(fd.get(), &msg.data, sizeof(msg.data))) {
+                Error("failed to read snapshot response");
+                return false;
+            }
+
+            if (msg.data.id == ID_DONE) {
+                if (!decoder->Finish()) {
+                    Error("unexpected ID_DONE in snapshot response");
+                    return false;
+                }
+            } else if (msg.data.id != ID_DATA) {
+                Error("unexpected message id in snapshot response: %08x", msg.data.id);
+                return false;
+            } else {
+                if (msg.data.size > max) {
+                    Error("snapshot msg.data.size too large: %u (max %zu)", msg.data.size, max);
+                    return false;
+                }
+                Block block(msg.data.size);
+                if (!ReadFdExactly(fd.get(), block.data(), msg.data.size)) {
+                    Error("failed to read snapshot data");
+                    return false;
+                }
+                decoder->Append(std::move(block));
+            }
+
+            while (true) {
+                std::span<char> output;
+                DecodeResult result = decoder->Decode(&output);
+                if (result == DecodeResult::Error) {
+                    Error("snapshot decompress failed");
+                    return false;
+                }
+
+                pending.insert(pending.end(), output.begin(), output.end());
+
+                size_t offset = 0;
+                while (pending.size() - offset >= sizeof(sync_dent_v2)) {
+                    sync_dent_v2 dent;
+                    memcpy(&dent, pending.data() + offset, sizeof(dent));
+                    if (dent.id != ID_DENT_V2) {
+                        Error("unexpected record id in snapshot response: %08x", dent.id);
+                        return false;
+                    }
+                    if (dent.namelen > 4096) {
+                        Error("snapshot record name too long: %u", dent.namelen);
+                        return false;
+                    }
+                    if (pending.size() - offset < sizeof(dent) + dent.namelen) break;
+
+                    if (dent.error == 0) {
+                        std::string name(pending.data() + offset + sizeof(dent), dent.namelen);
+                        (*entries)[std::move(name)] = SnapshotEntry{
+                                .mode = dent.mode,
+                                .size = dent.size,
+                                .mtime = dent.mtime,
+                        };
+                    }
+                    offset += sizeof(dent) + dent.namelen;
+                }
+                pending.erase(pending.begin(), pending.begin() + offset);
+
+                if (result == DecodeResult::NeedInput) {
+                    break;
+                } else if (result == DecodeResult::MoreOutput) {
+                    continue;
+                } else if (result == DecodeResult::Done) {
+                    if (!pending.empty()) {
+                        Error("truncated record in snapshot response");
+                        return false;
+                    }
+                    return true;
+                } else {
+                    LOG(FATAL) << "invalid DecodeResult: " << static_cast<int>(result);
+                }
+            }
+        }
+    }
+
   private:
     template <bool v2>
     static bool FinishLsImpl(borrowed_fd fd, const std::function<sync_ls_cb>& callback) {
@@ -606,6 +875,88 @@ class SyncConnection {
         return true;
     }
 
+#if defined(SEEK_HOLE)
+    // Pushes a sparse file as data regions and ID_HOLE gaps, walking the allocation map
+    // with SEEK_DATA/SEEK_HOLE so it transfers in proportion to its allocated size.
+    bool SendSparseFile(const std::string& path, mode_t mode, const std::string& lpath,
+                        const std::string& rpath, unsigned mtime, borrowed_fd lfd,
+                        uint64_t total_size, bool dry_run) {
+        if (!SendSend2(path, mode, CompressionType::None, dry_run, false, true)) {
+            Error("failed to send ID_SEND_V2 message '%s': %s", path.c_str(), strerror(errno));
+            return false;
+        }
+
+        syncmsg msg;
+        uint64_t bytes_copied = 0;
+
+        auto send_hole = [&](uint64_t len) -> bool {
+            while (len > 0) {
+                uint32_t chunk = std::min<uint64_t>(len, UINT32_MAX);
+                msg.data.id = ID_HOLE;
+                msg.data.size = chunk;
+                if (!WriteOrDie(lpath, rpath, &msg.data, sizeof(msg.data))) return false;
+                bytes_copied += chunk;
+                RecordBytesTransferred(chunk);
+                ReportProgress(rpath, bytes_copied, total_size);
+                len -= chunk;
+            }
+            return true;
+        };
+
+        syncsendbuf sbuf;
+        sbuf.id = ID_DATA;
+
+        uint64_t offset = 0;
+        while (offset < total_size) {
+            int64_t data = adb_lseek(lfd, offset, SEEK_DATA);
+            if (data == -1) {
+                if (errno == ENXIO) break;  // Nothing but hole until EOF.
+                Error("seeking '%s' locally failed: %s", lpath.c_str(), strerror(errno));
+                return false;
+            }
+            int64_t hole = adb_lseek(lfd, data, SEEK_HOLE);
+            if (hole == -1) {
+                Error("seeking '%s' locally failed: %s", lpath.c_str(), strerror(errno));
+                return false;
+            }
+
+            if (static_cast<uint64_t>(data) > offset) {
+                if (!send_hole(data - offset)) return false;
+            }
+
+            if (adb_lseek(lfd, data, SEEK_SET) == -1) {
+                Error("seeking '%s' locally failed: %s", lpath.c_str(), strerror(errno));
+                return false;
+            }
+            uint64_t remaining = hole - data;
+            while (remaining > 0) {
+                int r = adb_read(lfd, sbuf.data, std::min<uint64_t>(remaining, SYNC_DATA_MAX));
+                if (r <= 0) {
+                    Error("reading '%s' locally failed: %s", lpath.c_str(),
+                          r == 0 ? "file truncated during transfer" : strerror(errno));
+                    return false;
+                }
+                sbuf.size = r;
+                WriteOrDie(lpath, rpath, &sbuf, sizeof(SyncRequest) + r);
+                bytes_copied += r;
+                RecordBytesTransferred(r);
+                ReportProgress(rpath, bytes_copied, total_size);
+                remaining -= r;
+            }
+            offset = hole;
+        }
+
+        // A trailing hole still has to be accounted for so the device truncates to
+        // full length.
+        if (offset < total_size && !send_hole(total_size - offset)) return false;
+
+        msg.data.id = ID_DONE;
+        msg.data.size = mtime;
+        RecordFileSent(lpath, rpath);
+        return WriteOrDie(lpath, rpath, &msg.data, sizeof(msg.data));
+    }
+#endif
+
     bool SendLargeFile(const std::string& path, mode_t mode, const std::string& lpath,
                        const std::string& rpath, unsigned mtime, CompressionType compression,
                        bool dry_run) {
@@ -618,13 +969,6 @@ class SyncConnection {
             return SendLargeFileLegacy(path, mode, lpath, rpath, mtime);
         }
 
-        compression = ResolveCompressionType(compression);
-
-        if (!SendSend2(path, mode, compression, dry_run)) {
-            Error("failed to send ID_SEND_V2 message '%s': %s", path.c_str(), strerror(errno));
-            return false;
-        }
-
         struct stat st;
         if (stat(lpath.c_str(), &st) == -1) {
             Error("cannot stat '%s': %s", lpath.c_str(), strerror(errno));
@@ -640,6 +984,36 @@ class SyncConnection {
             return false;
         }
 
+#if defined(SEEK_HOLE)
+        // A file whose allocated blocks don't cover its length is sparse. Skipping the
+        // holes beats compressing their zeroes, so sparse mode wins over compression.
+        if (HaveSparseSync() && S_ISREG(st.st_mode) &&
+            static_cast<uint64_t>(st.st_blocks) * 512 < total_size) {
+            return SendSparseFile(path, mode, lpath, rpath, mtime, lfd, total_size, dry_run);
+        }
+#endif
+
+        // Read the first block up front: adaptive mode uses it to judge whether the
+        // file compresses at all before a codec is committed on the wire.
+        Block first_block(SYNC_DATA_MAX);
+        int first_read = adb_read(lfd.get(), first_block.data(), first_block.size());
+        if (first_read < 0) {
+            Error("reading '%s' locally failed: %s", lpath.c_str(), strerror(errno));
+            return false;
+        }
+        first_block.resize(first_read);
+
+        if (adaptive_compression_) {
+            compression = ChooseAdaptiveCompression(first_block);
+        } else {
+            compression = ResolveCompressionType(compression);
+        }
+
+        if (!SendSend2(path, mode, compression, dry_run, false, false)) {
+            Error("failed to send ID_SEND_V2 message '%s': %s", path.c_str(), strerror(errno));
+            return false;
+        }
+
         syncsendbuf sbuf;
         sbuf.id = ID_DATA;
 
@@ -667,46 +1041,178 @@ class SyncConnection {
                 LOG(FATAL) << "unexpected CompressionType::Any";
         }
 
-        bool sending = true;
-        while (sending) {
-            Block input(SYNC_DATA_MAX);
-            int r = adb_read(lfd.get(), input.data(), input.size());
-            if (r < 0) {
-                Error("reading '%s' locally failed: %s", lpath.c_str(), strerror(errno));
-                return false;
-            }
+        if (compression != CompressionType::None) {
+            // Compressed sends are pipelined: a worker thread reads the file and runs the
+            // encoder, staying a bounded number of packets ahead of this thread, which
+            // drains completed packets to the socket in order. Encoder stalls and socket
+            // stalls overlap instead of serializing, which keeps a fast link saturated
+            // even when the codec is the bottleneck.
+            struct Pipeline {
+                std::mutex mutex;
+                std::condition_variable cv;
+                // Framed ID_DATA packets, paired with the number of raw input bytes
+                // consumed to produce each one (for progress accounting).
+                std::deque<std::pair<Block, uint64_t>> queue;
+                bool done = false;
+                bool error = false;
+            } pipeline;
+            static constexpr size_t kMaxQueuedPackets = 8;
+
+            auto emit = [&](Block packet, uint64_t raw_bytes) {
+                std::unique_lock<std::mutex> lock(pipeline.mutex);
+                pipeline.cv.wait(lock,
+                                 [&]() { return pipeline.queue.size() < kMaxQueuedPackets; });
+                pipeline.queue.emplace_back(std::move(packet), raw_bytes);
+                pipeline.cv.notify_all();
+            };
+
+            std::thread encoder_thread([&]() {
+                bool sending = true;
+                bool have_first_block = true;
+                uint64_t raw_bytes_pending = 0;
+                while (sending) {
+                    Block input;
+                    int r;
+                    if (have_first_block) {
+                        have_first_block = false;
+                        r = first_block.size();
+                        input = std::move(first_block);
+                    } else {
+                        input = Block(SYNC_DATA_MAX);
+                        r = adb_read(lfd.get(), input.data(), input.size());
+                        if (r < 0) {
+                            std::lock_guard<std::mutex> lock(pipeline.mutex);
+                            pipeline.error = true;
+                            break;
+                        }
+                        input.resize(r);
+                    }
 
-            if (r == 0) {
-                encoder->Finish();
-            } else {
-                input.resize(r);
-                encoder->Append(std::move(input));
-                RecordBytesTransferred(r);
-                bytes_copied += r;
-                ReportProgress(rpath, bytes_copied, total_size);
-            }
+                    if (r == 0) {
+                        encoder->Finish();
+                    } else {
+                        encoder->Append(std::move(input));
+                        raw_bytes_pending += r;
+                    }
+
+                    while (true) {
+                        Block output;
+                        EncodeResult result = encoder->Encode(&output);
+                        if (result == EncodeResult::Error) {
+                            std::lock_guard<std::mutex> lock(pipeline.mutex);
+                            pipeline.error = true;
+                            sending = false;
+                            break;
+                        }
+
+                        if (!output.empty()) {
+                            Block packet(sizeof(SyncRequest) + output.size());
+                            SyncRequest* req = reinterpret_cast<SyncRequest*>(packet.data());
+                            req->id = ID_DATA;
+                            req->path_length = output.size();
+                            memcpy(packet.data() + sizeof(SyncRequest), output.data(),
+                                   output.size());
+                            emit(std::move(packet), std::exchange(raw_bytes_pending, 0));
+                        }
+
+                        if (result == EncodeResult::Done) {
+                            sending = false;
+                            break;
+                        } else if (result == EncodeResult::NeedInput) {
+                            break;
+                        } else if (result == EncodeResult::MoreOutput) {
+                            continue;
+                        }
+                    }
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(pipeline.mutex);
+                    pipeline.done = true;
+                }
+                pipeline.cv.notify_all();
+            });
 
             while (true) {
-                Block output;
-                EncodeResult result = encoder->Encode(&output);
-                if (result == EncodeResult::Error) {
-                    Error("compressing '%s' locally failed", lpath.c_str());
-                    return false;
+                Block packet;
+                uint64_t raw_bytes;
+                {
+                    std::unique_lock<std::mutex> lock(pipeline.mutex);
+                    pipeline.cv.wait(lock,
+                                     [&]() { return !pipeline.queue.empty() || pipeline.done; });
+                    if (pipeline.queue.empty()) {
+                        break;
+                    }
+                    packet = std::move(pipeline.queue.front().first);
+                    raw_bytes = pipeline.queue.front().second;
+                    pipeline.queue.pop_front();
                 }
+                pipeline.cv.notify_all();
 
-                if (!output.empty()) {
-                    sbuf.size = output.size();
-                    memcpy(sbuf.data, output.data(), output.size());
-                    WriteOrDie(lpath, rpath, &sbuf, sizeof(SyncRequest) + output.size());
+                WriteOrDie(lpath, rpath, packet.data(), packet.size());
+                if (raw_bytes != 0) {
+                    RecordBytesTransferred(raw_bytes);
+                    bytes_copied += raw_bytes;
+                    ReportProgress(rpath, bytes_copied, total_size);
                 }
+            }
 
-                if (result == EncodeResult::Done) {
-                    sending = false;
-                    break;
-                } else if (result == EncodeResult::NeedInput) {
-                    break;
-                } else if (result == EncodeResult::MoreOutput) {
-                    continue;
+            encoder_thread.join();
+            if (pipeline.error) {
+                Error("compressing '%s' locally failed: %s", lpath.c_str(), strerror(errno));
+                return false;
+            }
+        } else {
+            bool sending = true;
+            bool have_first_block = true;
+            while (sending) {
+                Block input;
+                int r;
+                if (have_first_block) {
+                    have_first_block = false;
+                    r = first_block.size();
+                    input = std::move(first_block);
+                } else {
+                    input = Block(SYNC_DATA_MAX);
+                    r = adb_read(lfd.get(), input.data(), input.size());
+                    if (r < 0) {
+                        Error("reading '%s' locally failed: %s", lpath.c_str(), strerror(errno));
+                        return false;
+                    }
+                    input.resize(r);
+                }
+
+                if (r == 0) {
+                    encoder->Finish();
+                } else {
+                    encoder->Append(std::move(input));
+                    RecordBytesTransferred(r);
+                    bytes_copied += r;
+                    ReportProgress(rpath, bytes_copied, total_size);
+                }
+
+                while (true) {
+                    Block output;
+                    EncodeResult result = encoder->Encode(&output);
+                    if (result == EncodeResult::Error) {
+                        Error("compressing '%s' locally failed", lpath.c_str());
+                        return false;
+                    }
+
+                    if (!output.empty()) {
+                        sbuf.size = output.size();
+                        memcpy(sbuf.data, output.data(), output.size());
+                        WriteOrDie(lpath, rpath, &sbuf, sizeof(SyncRequest) + output.size());
+                    }
+
+                    if (result == EncodeResult::Done) {
+                        sending = false;
+                        break;
+                    } else if (result == EncodeResult::NeedInput) {
+                        break;
+                    } else if (result == EncodeResult::MoreOutput) {
+                        continue;
+                    }
                 }
             }
         }
@@ -769,6 +1275,191 @@ class SyncConnection {
         return WriteOrDie(lpath, rpath, &msg.data, sizeof(msg.data));
     }
 
+    // Fetches the per-block digests of lpath from the server's cross-invocation cache
+    // (host:sync-cache).  Re-pushing an unchanged tree to several devices then hashes
+    // each file once in the server rather than once per device per run.  Any failure
+    // (old server, unreadable file, racing modification) is just a miss.
+    bool GetCachedLocalDigests(const std::string& lpath, const struct stat& st,
+                               std::string* digests) {
+        std::string service = android::base::StringPrintf(
+                "host:sync-cache:%" PRIu64 ",%" PRIu64 ",%s", static_cast<uint64_t>(st.st_size),
+                static_cast<uint64_t>(st.st_mtime), lpath.c_str());
+        std::string error;
+        unique_fd cache_fd(adb_connect(service, &error));
+        if (cache_fd < 0) {
+            return false;
+        }
+        digests->clear();
+        if (!android::base::ReadFdToString(cache_fd, digests)) {
+            return false;
+        }
+        uint64_t blocks =
+                (static_cast<uint64_t>(st.st_size) + SYNC_DATA_MAX - 1) / SYNC_DATA_MAX;
+        return digests->size() == blocks * SYNC_DELTA_DIGEST_SIZE;
+    }
+
+    // Delta push: ask the daemon for per-block digests of the existing remote file and
+    // resend only the blocks that changed. Only worthwhile for in-place edits of large
+    // files; an insertion or deletion shifts every subsequent block and degenerates to a
+    // full send, which the caller performs when this returns false with *fell_back set.
+    bool SendFileDelta(const std::string& path, mode_t mode, const std::string& lpath,
+                       const std::string& rpath, unsigned mtime, bool* fell_back) {
+        *fell_back = true;
+
+        // The checksum exchange is a synchronous request/response on the sync socket, so
+        // acknowledgements for any earlier sends have to be drained first.
+        if (!ReadAcknowledgements(true)) {
+            *fell_back = false;
+            return false;
+        }
+
+        struct stat st;
+        if (stat(lpath.c_str(), &st) == -1) {
+            Error("cannot stat '%s': %s", lpath.c_str(), strerror(errno));
+            *fell_back = false;
+            return false;
+        }
+
+        unique_fd lfd(adb_open(lpath.c_str(), O_RDONLY | O_CLOEXEC));
+        if (lfd < 0) {
+            Error("opening '%s' locally failed: %s", lpath.c_str(), strerror(errno));
+            *fell_back = false;
+            return false;
+        }
+
+        if (!SendRequest(ID_CKSM, path)) {
+            *fell_back = false;
+            return false;
+        }
+
+        std::string remote_digests;
+        syncmsg msg;
+        while (true) {
+            if (!ReadFdExactly(fd, &msg.data, sizeof(msg.data))) {
+                Error("failed to read checksum response");
+                *fell_back = false;
+                return false;
+            }
+            if (msg.data.id == ID_DONE) {
+                break;
+            } else if (msg.data.id == ID_FAIL) {
+                *fell_back = false;
+                return ReportCopyFailure(lpath, rpath, msg);
+            } else if (msg.data.id != ID_CKSM ||
+                       msg.data.size % SYNC_DELTA_DIGEST_SIZE != 0 ||
+                       msg.data.size > SYNC_DATA_MAX) {
+                Error("unexpected checksum response: id = %#" PRIx32, msg.data.id);
+                *fell_back = false;
+                return false;
+            }
+            size_t offset = remote_digests.size();
+            remote_digests.resize(offset + msg.data.size);
+            if (!ReadFdExactly(fd, remote_digests.data() + offset, msg.data.size)) {
+                Error("failed to read checksum response");
+                *fell_back = false;
+                return false;
+            }
+        }
+
+        size_t remote_blocks = remote_digests.size() / SYNC_DELTA_DIGEST_SIZE;
+        if (remote_blocks == 0) {
+            // No remote file to delta against.
+            return false;
+        }
+
+        // The server caches local digests across invocations (and so across devices);
+        // with a hit, unchanged blocks are skipped without ever reading them here, and
+        // only the changed blocks of the file are read and sent.
+        std::string local_digests;
+        bool have_local_digests = GetCachedLocalDigests(lpath, st, &local_digests);
+
+        *fell_back = false;
+
+        if (!SendSend2(path, mode, CompressionType::None, false, true, false)) {
+            return false;
+        }
+
+        uint64_t total_size = st.st_size;
+        uint64_t bytes_copied = 0;
+        uint64_t read_offset = 0;
+        Block block(SYNC_DATA_MAX);
+        for (uint64_t index = 0;; ++index) {
+            const uint64_t block_offset = index * static_cast<uint64_t>(SYNC_DATA_MAX);
+            bool matches = false;
+            size_t len = 0;
+
+            if (have_local_digests) {
+                if (block_offset >= total_size) {
+                    break;
+                }
+                matches = index < remote_blocks &&
+                          memcmp(local_digests.data() + index * SYNC_DELTA_DIGEST_SIZE,
+                                 remote_digests.data() + index * SYNC_DELTA_DIGEST_SIZE,
+                                 SYNC_DELTA_DIGEST_SIZE) == 0;
+                if (matches) {
+                    len = std::min<uint64_t>(SYNC_DATA_MAX, total_size - block_offset);
+                }
+            }
+
+            if (!matches) {
+                // Skipped blocks leave the fd behind; catch it up before reading.
+                if (read_offset != block_offset) {
+                    if (adb_lseek(lfd, block_offset, SEEK_SET) != static_cast<int64_t>(block_offset)) {
+                        Error("seeking '%s' locally failed: %s", lpath.c_str(), strerror(errno));
+                        return false;
+                    }
+                    read_offset = block_offset;
+                }
+                while (len < block.size()) {
+                    int rc = adb_read(lfd, block.data() + len, block.size() - len);
+                    if (rc < 0) {
+                        Error("reading '%s' locally failed: %s", lpath.c_str(), strerror(errno));
+                        return false;
+                    } else if (rc == 0) {
+                        break;
+                    }
+                    len += rc;
+                }
+                read_offset += len;
+                if (len == 0) {
+                    break;
+                }
+
+                if (!have_local_digests) {
+                    uint8_t digest[SHA256_DIGEST_LENGTH];
+                    SHA256(reinterpret_cast<const uint8_t*>(block.data()), len, digest);
+                    matches = index < remote_blocks &&
+                              memcmp(digest, remote_digests.data() + index * SYNC_DELTA_DIGEST_SIZE,
+                                     SYNC_DELTA_DIGEST_SIZE) == 0;
+                }
+            }
+
+            if (matches) {
+                msg.copy.id = ID_COPY;
+                msg.copy.block = index;
+                WriteOrDie(lpath, rpath, &msg.copy, sizeof(msg.copy));
+            } else {
+                msg.data.id = ID_DATA;
+                msg.data.size = len;
+                WriteOrDie(lpath, rpath, &msg.data, sizeof(msg.data));
+                WriteOrDie(lpath, rpath, block.data(), len);
+                RecordBytesTransferred(len);
+            }
+
+            bytes_copied += len;
+            ReportProgress(rpath, bytes_copied, total_size);
+
+            if (len < block.size()) {
+                break;
+            }
+        }
+
+        msg.data.id = ID_DONE;
+        msg.data.size = mtime;
+        RecordFileSent(lpath, rpath);
+        return WriteOrDie(lpath, rpath, &msg.data, sizeof(msg.data));
+    }
+
     bool ReportCopyFailure(const std::string& from, const std::string& to, const syncmsg& msg) {
         std::vector<char> buf(msg.status.msglen + 1);
         if (!ReadFdExactly(fd, &buf[0], msg.status.msglen)) {
@@ -942,11 +1633,16 @@ class SyncConnection {
     const FeatureSet* features_ = nullptr;
     bool have_stat_v2_;
     bool have_ls_v2_;
+    bool have_sync_snapshot_;
     bool have_sendrecv_v2_;
     bool have_sendrecv_v2_brotli_;
     bool have_sendrecv_v2_lz4_;
     bool have_sendrecv_v2_zstd_;
     bool have_sendrecv_v2_dry_run_send_;
+    bool have_delta_sync_;
+    bool have_sparse_sync_;
+    bool adaptive_compression_ = false;
+    bool delta_sync_ = false;
 
     TransferLedger global_ledger_;
     TransferLedger current_ledger_;
@@ -1073,7 +1769,19 @@ static bool sync_send(SyncConnection& sc, const std::string& lpath, const std::s
             return false;
         }
     } else {
-        if (!sc.SendLargeFile(rpath, mode, lpath, rpath, mtime, compression, dry_run)) {
+        // Delta transfers cost an extra round trip for the checksum exchange, so only
+        // try them on files large enough for resent blocks to matter.
+        constexpr uint64_t kDeltaSyncMinFileSize = 256 * 1024;
+        bool sent = false;
+        if (sc.UseDeltaSync() && !dry_run &&
+            static_cast<uint64_t>(st.st_size) >= kDeltaSyncMinFileSize) {
+            bool fell_back = false;
+            sent = sc.SendFileDelta(rpath, mode, lpath, rpath, mtime, &fell_back);
+            if (!sent && !fell_back) {
+                return false;
+            }
+        }
+        if (!sent && !sc.SendLargeFile(rpath, mode, lpath, rpath, mtime, compression, dry_run)) {
             return false;
         }
     }
@@ -1139,7 +1847,7 @@ static bool sync_recv_v2(SyncConnection& sc, const char* rpath, const char* lpat
                          uint64_t expected_size, CompressionType compression) {
     compression = sc.ResolveCompressionType(compression);
 
-    if (!sc.SendRecv2(rpath, compression)) return false;
+    if (!sc.SendRecv2(rpath, compression, sc.HaveSparseSync())) return false;
 
     adb_unlink(lpath);
     unique_fd lfd(adb_creat(lpath, 0644));
@@ -1149,6 +1857,7 @@ static bool sync_recv_v2(SyncConnection& sc, const char* rpath, const char* lpat
     }
 
     uint64_t bytes_copied = 0;
+    bool sparse = false;
 
     Block buffer(SYNC_DATA_MAX);
     std::variant<std::monostate, NullDecoder, BrotliDecoder, LZ4Decoder, ZstdDecoder>
@@ -1189,6 +1898,22 @@ static bool sync_recv_v2(SyncConnection& sc, const char* rpath, const char* lpat
                 sc.Error("unexpected ID_DONE");
                 return false;
             }
+        } else if (msg.data.id == ID_SPRS && !sparse && bytes_copied == 0) {
+            // The device elected a sparse transfer: the rest of the stream is raw
+            // data and holes, regardless of the compression we asked for.
+            sparse = true;
+            decoder = &decoder_storage.emplace<NullDecoder>(buffer_span);
+            continue;
+        } else if (msg.data.id == ID_HOLE && sparse) {
+            if (adb_lseek(lfd, msg.data.size, SEEK_CUR) == -1) {
+                sc.Error("cannot seek '%s': %s", lpath, strerror(errno));
+                adb_unlink(lpath);
+                return false;
+            }
+            bytes_copied += msg.data.size;
+            sc.RecordBytesTransferred(msg.data.size);
+            sc.ReportProgress(name != nullptr ? name : rpath, bytes_copied, expected_size);
+            continue;
         } else if (msg.data.id != ID_DATA) {
             adb_unlink(lpath);
             sc.ReportCopyFailure(rpath, lpath, msg);
@@ -1235,6 +1960,13 @@ static bool sync_recv_v2(SyncConnection& sc, const char* rpath, const char* lpat
             } else if (result == DecodeResult::MoreOutput) {
                 continue;
             } else if (result == DecodeResult::Done) {
+                // A trailing hole leaves lfd seeked past EOF with nothing written;
+                // ftruncate materializes it.
+                if (sparse && adb_ftruncate(lfd, bytes_copied) == -1) {
+                    sc.Error("cannot truncate '%s': %s", lpath, strerror(errno));
+                    adb_unlink(lpath);
+                    return false;
+                }
                 sc.RecordFilesTransferred(1);
                 return true;
             } else {
@@ -1253,6 +1985,83 @@ static bool sync_recv(SyncConnection& sc, const char* rpath, const char* lpath,
     }
 }
 
+// Number of parallel sync streams to use for directory transfers, from $ADB_SYNC_STREAMS.
+// A single USB3 or Wi-Fi 6 link comfortably outruns one round-trip-bound sync channel, so
+// letting the user shard a large tree across several connections can be a multi-x win.
+static uint32_t sync_stream_count() {
+    const char* env = getenv("ADB_SYNC_STREAMS");
+    if (!env) return 1;
+
+    uint32_t streams;
+    if (!android::base::ParseUint(env, &streams) || streams == 0) {
+        fprintf(stderr, "adb: ignoring invalid $ADB_SYNC_STREAMS: '%s'\n", env);
+        return 1;
+    }
+    // More streams than this just burns file descriptors and device threads for no gain.
+    return std::min(streams, 16u);
+}
+
+// Partitions the non-skipped entries of `file_list` into `shards` lists, assigning each
+// file to the currently least-loaded shard (by byte count) so a handful of large files
+// can't serialize the whole transfer behind a single stream.
+static std::vector<std::vector<copyinfo>> shard_file_list(std::vector<copyinfo> file_list,
+                                                          size_t shards) {
+    std::vector<std::vector<copyinfo>> result(shards);
+    std::vector<uint64_t> shard_bytes(shards, 0);
+
+    // Largest files first, so they get spread across shards before the small-file filler.
+    std::stable_sort(file_list.begin(), file_list.end(),
+                     [](const copyinfo& a, const copyinfo& b) { return a.size > b.size; });
+
+    for (copyinfo& ci : file_list) {
+        size_t target = std::min_element(shard_bytes.begin(), shard_bytes.end()) -
+                        shard_bytes.begin();
+        shard_bytes[target] += ci.size;
+        result[target].push_back(std::move(ci));
+    }
+    return result;
+}
+
+// Pushes `file_list` across `streams` sync connections. Shard 0 reuses `sc` on the calling
+// thread; each remaining shard gets its own SyncConnection (and therefore its own sync
+// service session on the device) on a worker thread.
+static bool push_files_parallel(SyncConnection& sc, std::vector<copyinfo> file_list,
+                                uint32_t streams, CompressionType compression, bool dry_run) {
+    std::vector<std::vector<copyinfo>> shards = shard_file_list(std::move(file_list), streams);
+
+    std::atomic<bool> success = true;
+    auto push_shard = [&](SyncConnection& conn, const std::vector<copyinfo>& shard) {
+        for (const copyinfo& ci : shard) {
+            if (!sync_send(conn, ci.lpath, ci.rpath, ci.time, ci.mode, false, compression,
+                           dry_run)) {
+                success = false;
+                return;
+            }
+        }
+        if (!conn.ReadAcknowledgements(true)) success = false;
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < shards.size(); ++i) {
+        if (shards[i].empty()) continue;
+        workers.emplace_back([&, i]() {
+            SyncConnection worker_sc;
+            if (!worker_sc.IsValid()) {
+                success = false;
+                return;
+            }
+            push_shard(worker_sc, shards[i]);
+        });
+    }
+
+    push_shard(sc, shards[0]);
+
+    for (std::thread& t : workers) {
+        t.join();
+    }
+    return success;
+}
+
 bool do_sync_ls(const char* path) {
     SyncConnection sc;
     if (!sc.IsValid()) return false;
@@ -1389,33 +2198,49 @@ static bool copy_local_dir_remote(SyncConnection& sc, std::string lpath, std::st
     }
 
     if (check_timestamps) {
-        for (const copyinfo& ci : file_list) {
-            if (!sc.SendLstat(ci.rpath)) {
-                sc.Error("failed to send lstat");
+        if (sc.HaveSyncSnapshot()) {
+            // One snapshot request returns stat data for the whole destination subtree,
+            // replacing a stat round trip (pipelined or not) per file.
+            std::unordered_map<std::string, SyncConnection::SnapshotEntry> snapshot;
+            if (!sc.GetDirectorySnapshot(rpath, compression, &snapshot)) {
                 return false;
             }
-        }
-        for (copyinfo& ci : file_list) {
-            struct stat st;
-            if (sc.FinishStat(&st)) {
-                if (st.st_size == static_cast<off_t>(ci.size) && st.st_mtime == ci.time) {
+            for (copyinfo& ci : file_list) {
+                // Both paths have trailing separators, so the key is the remainder of
+                // ci.rpath, which the snapshot reports relative to rpath.
+                auto it = snapshot.find(ci.rpath.substr(rpath.size()));
+                if (it != snapshot.end() && it->second.size == ci.size &&
+                    it->second.mtime == ci.time) {
                     ci.skip = true;
                 }
             }
+        } else {
+            for (const copyinfo& ci : file_list) {
+                if (!sc.SendLstat(ci.rpath)) {
+                    sc.Error("failed to send lstat");
+                    return false;
+                }
+            }
+            for (copyinfo& ci : file_list) {
+                struct stat st;
+                if (sc.FinishStat(&st)) {
+                    if (st.st_size == static_cast<off_t>(ci.size) && st.st_mtime == ci.time) {
+                        ci.skip = true;
+                    }
+                }
+            }
         }
     }
 
     sc.ComputeExpectedTotalBytes(file_list);
 
+    std::vector<copyinfo> to_send;
     for (const copyinfo& ci : file_list) {
         if (!ci.skip) {
             if (list_only) {
                 sc.Println("would push: %s -> %s", ci.lpath.c_str(), ci.rpath.c_str());
             } else {
-                if (!sync_send(sc, ci.lpath, ci.rpath, ci.time, ci.mode, false, compression,
-                               dry_run)) {
-                    return false;
-                }
+                to_send.push_back(ci);
             }
         } else {
             skipped++;
@@ -1423,7 +2248,20 @@ static bool copy_local_dir_remote(SyncConnection& sc, std::string lpath, std::st
     }
 
     sc.RecordFilesSkipped(skipped);
-    bool success = sc.ReadAcknowledgements(true);
+
+    bool success;
+    uint32_t streams = sync_stream_count();
+    if (streams > 1 && to_send.size() > 1) {
+        success = push_files_parallel(sc, std::move(to_send), streams, compression, dry_run);
+    } else {
+        for (const copyinfo& ci : to_send) {
+            if (!sync_send(sc, ci.lpath, ci.rpath, ci.time, ci.mode, false, compression,
+                           dry_run)) {
+                return false;
+            }
+        }
+        success = sc.ReadAcknowledgements(true);
+    }
     sc.ReportTransferRate(lpath, TransferDirection::push);
     return success;
 }
@@ -1602,6 +2440,48 @@ static int set_time_and_mode(const std::string& lpath, time_t time,
     return r1 ? r1 : r2;
 }
 
+// Pull counterpart of push_files_parallel. Directory entries must already have been
+// created by the caller; only regular files may appear in `file_list`.
+static bool pull_files_parallel(SyncConnection& sc, std::vector<copyinfo> file_list,
+                                uint32_t streams, bool copy_attrs, CompressionType compression) {
+    std::vector<std::vector<copyinfo>> shards = shard_file_list(std::move(file_list), streams);
+
+    std::atomic<bool> success = true;
+    auto pull_shard = [&](SyncConnection& conn, const std::vector<copyinfo>& shard) {
+        for (const copyinfo& ci : shard) {
+            if (!sync_recv(conn, ci.rpath.c_str(), ci.lpath.c_str(), nullptr, ci.size,
+                           compression)) {
+                success = false;
+                return;
+            }
+            if (copy_attrs && set_time_and_mode(ci.lpath, ci.time, ci.mode)) {
+                success = false;
+                return;
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < shards.size(); ++i) {
+        if (shards[i].empty()) continue;
+        workers.emplace_back([&, i]() {
+            SyncConnection worker_sc;
+            if (!worker_sc.IsValid()) {
+                success = false;
+                return;
+            }
+            pull_shard(worker_sc, shards[i]);
+        });
+    }
+
+    pull_shard(sc, shards[0]);
+
+    for (std::thread& t : workers) {
+        t.join();
+    }
+    return success;
+}
+
 static bool copy_remote_dir_local(SyncConnection& sc, std::string rpath, std::string lpath,
                                   bool copy_attrs, CompressionType compression) {
     sc.NewTransfer();
@@ -1620,6 +2500,7 @@ static bool copy_remote_dir_local(SyncConnection& sc, std::string rpath, std::st
     sc.ComputeExpectedTotalBytes(file_list);
 
     int skipped = 0;
+    std::vector<copyinfo> to_recv;
     for (const copyinfo &ci : file_list) {
         if (!ci.skip) {
             if (S_ISDIR(ci.mode)) {
@@ -1633,6 +2514,18 @@ static bool copy_remote_dir_local(SyncConnection& sc, std::string rpath, std::st
                 continue;
             }
 
+            to_recv.push_back(ci);
+        } else {
+            skipped++;
+        }
+    }
+
+    bool success = true;
+    uint32_t streams = sync_stream_count();
+    if (streams > 1 && to_recv.size() > 1) {
+        success = pull_files_parallel(sc, std::move(to_recv), streams, copy_attrs, compression);
+    } else {
+        for (const copyinfo& ci : to_recv) {
             if (!sync_recv(sc, ci.rpath.c_str(), ci.lpath.c_str(), nullptr, ci.size, compression)) {
                 return false;
             }
@@ -1640,14 +2533,12 @@ static bool copy_remote_dir_local(SyncConnection& sc, std::string rpath, std::st
             if (copy_attrs && set_time_and_mode(ci.lpath, ci.time, ci.mode)) {
                 return false;
             }
-        } else {
-            skipped++;
         }
     }
 
     sc.RecordFilesSkipped(skipped);
     sc.ReportTransferRate(rpath, TransferDirection::pull);
-    return true;
+    return success;
 }
 
 bool do_sync_pull(const std::vector<const char*>& srcs, const char* dst, bool copy_attrs,
@@ -54,6 +54,13 @@ static constexpr int kCompressBound = std::max(kBlockSize, LZ4_COMPRESSBOUND(kBl
 static constexpr auto kReadBufferSize = 128 * 1024;
 static constexpr int kPollTimeoutMillis = 300000;  // 5 minutes
 
+// Miss-driven readahead, patterned after the kernel's: every page miss schedules the
+// blocks right after it, a miss that lands inside the previous readahead window doubles
+// the window (the device is reading sequentially and we're not keeping up), and a miss
+// somewhere else resets it. The cap keeps one greedy file from monopolizing the link.
+static constexpr int kReadaheadBlocksMin = 8;
+static constexpr int kReadaheadBlocksMax = 256;
+
 using BlockSize = int16_t;
 using FileId = int16_t;
 using BlockIdx = int32_t;
@@ -178,6 +185,10 @@ class File {
 
     std::vector<bool> sentTreeBlocks;
 
+    // Sequential-run tracking for miss-driven readahead.
+    BlockIdx lastMissBlock = -1;
+    int readaheadBlocks = kReadaheadBlocksMin;
+
     const char* const filepath;
     const FileId id;
     const int64_t size;
@@ -213,10 +224,13 @@ class IncrementalServer {
         BlockIdx overallEnd = 0;
         BlockIdx priorityIndex = 0;
 
-        explicit PrefetchState(const File& f, BlockIdx start, int count)
+        bool fromMiss = false;
+
+        explicit PrefetchState(const File& f, BlockIdx start, int count, bool fromMiss = false)
             : file(&f),
               overallIndex(start),
-              overallEnd(std::min<BlockIdx>(start + count, f.sentBlocks.size())) {}
+              overallEnd(std::min<BlockIdx>(start + count, f.sentBlocks.size())),
+              fromMiss(fromMiss) {}
 
         explicit PrefetchState(const File& f)
             : PrefetchState(f, 0, (BlockIdx)f.sentBlocks.size()) {}
@@ -258,6 +272,7 @@ class IncrementalServer {
 
     std::deque<PrefetchState> prefetches_;
     int compressed_ = 0, uncompressed_ = 0;
+    int readaheadSent_ = 0;
     long long sentSize_ = 0;
 
     static constexpr auto kChunkFlushSize = 31 * kBlockSize;
@@ -495,6 +510,9 @@ void IncrementalServer::RunPrefetching() {
         for (auto& i = prefetch.overallIndex; blocksToSend > 0 && i < prefetch.overallEnd; ++i) {
             if (auto res = SendDataBlock(file.id, i); res == SendResult::Sent) {
                 --blocksToSend;
+                if (prefetch.fromMiss) {
+                    ++readaheadSent_;
+                }
             } else if (res == SendResult::Error) {
                 fprintf(stderr, "Failed to send block %" PRId32 "\n", i);
             }
@@ -533,10 +551,11 @@ bool IncrementalServer::ServingComplete(std::optional<TimePoint> startTime, int
     using namespace std::chrono;
     auto endTime = high_resolution_clock::now();
     D("Streaming completed.\n"
-      "Misses: %d, of those unique: %d; sent compressed: %d, uncompressed: "
-      "%d, mb: %.3f\n"
+      "Misses: %d, of those unique: %d; readahead blocks sent: %d; sent compressed: %d, "
+      "uncompressed: %d, mb: %.3f\n"
       "Total time taken: %.3fms",
-      missesCount, missesSent, compressed_, uncompressed_, sentSize_ / 1024.0 / 1024.0,
+      missesCount, missesSent, readaheadSent_, compressed_, uncompressed_,
+      sentSize_ / 1024.0 / 1024.0,
       duration_cast<microseconds>(endTime - (startTime ? *startTime : endTime)).count() / 1000.0);
     return true;
 }
@@ -615,14 +634,25 @@ bool IncrementalServer::Serve() {
                           int(file.PriorityBlocks().size()));
                     }
 
+                    auto& file = files_[fileId];
+                    if (blockIdx >= file.lastMissBlock &&
+                        blockIdx <= file.lastMissBlock + file.readaheadBlocks) {
+                        file.readaheadBlocks =
+                                std::min(file.readaheadBlocks * 2, kReadaheadBlocksMax);
+                    } else {
+                        file.readaheadBlocks = kReadaheadBlocksMin;
+                    }
+                    file.lastMissBlock = blockIdx;
+
                     if (auto res = SendDataBlock(fileId, blockIdx, true);
                         res == SendResult::Error) {
                         fprintf(stderr, "Failed to send block %" PRId32 ".\n", blockIdx);
                     } else if (res == SendResult::Sent) {
                         ++missesSent;
-                        // Make sure we send more pages from this place onward, in case if the OS is
-                        // reading a bigger block.
-                        prefetches_.emplace_front(files_[fileId], blockIdx + 1, 7);
+                        // Push the likely-next blocks ahead of the device asking for them, so a
+                        // sequential reader pays the link round trip once instead of per page.
+                        prefetches_.emplace_front(files_[fileId], blockIdx + 1,
+                                                  file.readaheadBlocks - 1, /*fromMiss=*/true);
                     }
                     break;
                 }
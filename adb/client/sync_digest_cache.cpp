@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "client/sync_digest_cache.h"
+
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <android-base/logging.h>
+#include <android-base/thread_annotations.h>
+#include <openssl/sha.h>
+
+#include "adb_io.h"
+#include "file_sync_protocol.h"
+#include "sysdeps.h"
+
+static_assert(SYNC_DELTA_DIGEST_SIZE == SHA256_DIGEST_LENGTH,
+              "delta digests are truncated SHA-256");
+
+namespace {
+
+struct CacheEntry {
+    uint64_t size;
+    uint64_t mtime;
+    std::string digests;
+    std::list<std::string>::iterator lru_it;
+};
+
+// Bounds the total digest bytes kept, not the entry count: digests cost
+// size / 2048 bytes, so 64MiB of cache covers roughly 128GiB of pushed
+// content.  Least recently used entries are evicted first.
+constexpr size_t kMaxCacheBytes = 64 * 1024 * 1024;
+
+std::mutex cache_mutex;
+std::unordered_map<std::string, CacheEntry> cache GUARDED_BY(cache_mutex);
+std::list<std::string> cache_lru GUARDED_BY(cache_mutex);  // front = most recent
+size_t cache_bytes GUARDED_BY(cache_mutex) = 0;
+
+bool compute_digests(const std::string& path, uint64_t size, std::string* digests) {
+    unique_fd fd(adb_open(path.c_str(), O_RDONLY | O_CLOEXEC));
+    if (fd < 0) {
+        return false;
+    }
+
+    uint64_t blocks = (size + SYNC_DATA_MAX - 1) / SYNC_DATA_MAX;
+    digests->clear();
+    digests->reserve(blocks * SYNC_DELTA_DIGEST_SIZE);
+
+    std::string block(SYNC_DATA_MAX, '\0');
+    for (uint64_t index = 0; index < blocks; ++index) {
+        size_t len = 0;
+        while (len < block.size()) {
+            int rc = adb_read(fd, block.data() + len, block.size() - len);
+            if (rc < 0) {
+                return false;
+            } else if (rc == 0) {
+                break;
+            }
+            len += rc;
+        }
+
+        uint8_t digest[SHA256_DIGEST_LENGTH];
+        SHA256(reinterpret_cast<const uint8_t*>(block.data()), len, digest);
+        digests->append(reinterpret_cast<const char*>(digest), SYNC_DELTA_DIGEST_SIZE);
+
+        if (len < block.size()) {
+            break;
+        }
+    }
+
+    // The file changed while it was being hashed; the caller's (size, mtime)
+    // key no longer describes it.
+    return digests->size() == blocks * SYNC_DELTA_DIGEST_SIZE;
+}
+
+}  // namespace
+
+bool sync_digest_cache_get(const std::string& path, uint64_t size, uint64_t mtime,
+                           std::string* digests) {
+    struct stat st;
+    if (stat(path.c_str(), &st) == -1 || static_cast<uint64_t>(st.st_size) != size ||
+        static_cast<uint64_t>(st.st_mtime) != mtime) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        auto it = cache.find(path);
+        if (it != cache.end() && it->second.size == size && it->second.mtime == mtime) {
+            cache_lru.splice(cache_lru.begin(), cache_lru, it->second.lru_it);
+            *digests = it->second.digests;
+            return true;
+        }
+    }
+
+    // Hash outside the lock; concurrent misses for the same file waste a read
+    // but never block each other or the rest of the cache.
+    if (!compute_digests(path, size, digests)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    auto it = cache.find(path);
+    if (it != cache.end()) {
+        cache_bytes -= it->second.digests.size();
+        cache_lru.erase(it->second.lru_it);
+        cache.erase(it);
+    }
+
+    while (cache_bytes + digests->size() > kMaxCacheBytes && !cache_lru.empty()) {
+        auto lru = cache.find(cache_lru.back());
+        cache_bytes -= lru->second.digests.size();
+        cache.erase(lru);
+        cache_lru.pop_back();
+    }
+
+    cache_lru.push_front(path);
+    cache.emplace(path, CacheEntry{size, mtime, *digests, cache_lru.begin()});
+    cache_bytes += digests->size();
+    return true;
+}
+
+void sync_digest_cache_service(unique_fd fd, std::string spec) {
+    // spec is "<size>,<mtime>,<path>"; the path may itself contain commas.
+    char* end = nullptr;
+    uint64_t size = strtoull(spec.c_str(), &end, 10);
+    if (end == nullptr || *end != ',') {
+        return;
+    }
+    uint64_t mtime = strtoull(end + 1, &end, 10);
+    if (end == nullptr || *end != ',') {
+        return;
+    }
+    std::string path(end + 1);
+
+    std::string digests;
+    if (!sync_digest_cache_get(path, size, mtime, &digests)) {
+        return;
+    }
+
+    if (!WriteFdExactly(fd, digests.data(), digests.size())) {
+        D("sync-cache: failed to write digests for %s", path.c_str());
+    }
+}
@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+
+#include "adb_unique_fd.h"
+
+// Returns the concatenated per-block SHA-256 digests of the host file at path
+// (SYNC_DATA_MAX-sized blocks, SYNC_DELTA_DIGEST_SIZE bytes each), computing
+// and caching them in the server process on a miss.  The cache is keyed by
+// (path, size, mtime), so repeated pushes of an unchanged tree to any number
+// of devices hash each file once per server lifetime instead of once per
+// invocation.  Returns false if the file can't be read or no longer matches
+// the given size and mtime.
+bool sync_digest_cache_get(const std::string& path, uint64_t size, uint64_t mtime,
+                           std::string* digests);
+
+// Service function for `host:sync-cache:<size>,<mtime>,<path>`: writes the
+// digests of the given file to fd and closes it.  A client that reads fewer
+// bytes than it expects treats the lookup as a miss and hashes locally.
+void sync_digest_cache_service(unique_fd fd, std::string spec);
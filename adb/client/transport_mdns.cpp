@@ -24,11 +24,17 @@
 #include <arpa/inet.h>
 #endif
 
+#include <inttypes.h>
+
+#include <chrono>
 #include <memory>
+#include <mutex>
 #include <thread>
 #include <unordered_set>
 #include <vector>
 
+#include <android-base/file.h>
+#include <android-base/parseint.h>
 #include <android-base/stringprintf.h>
 #include <android-base/strings.h>
 #include <dns_sd.h>
@@ -115,6 +121,133 @@ static bool adb_DNSServiceShouldAutoConnect(const char* regType, const char* ser
     return true;
 }
 
+// Persistent discovery cache.
+//
+// The continuous browse below keeps the in-memory service registries warm for as long
+// as the server runs, but a freshly started server has resolved nothing yet, so the
+// first connect-by-name waits out a full mDNS resolve. Every successfully resolved
+// service is therefore also persisted ($HOME/.android/mdns_cache, one tab-separated
+// entry per line with an expiry derived from the record's TTL). A registry miss is
+// answered from the cache immediately while the live browse refreshes it in the
+// background; stale entries age out with their TTL or get replaced on re-resolve.
+
+struct MdnsCacheEntry {
+    int64_t expiry;  // seconds since the epoch
+    std::string service_name;
+    std::string reg_type;
+    std::string ip_addr;
+    uint16_t port;
+};
+
+// RFC 6762 suggests 120s for records containing a host name; cap whatever the
+// responder advertises so a bogus TTL can't pin a dead address for days.
+static constexpr int64_t kMdnsCacheDefaultTtlSecs = 120;
+static constexpr int64_t kMdnsCacheMaxTtlSecs = 24 * 60 * 60;
+
+static auto& g_mdns_cache_mutex = *new std::mutex();
+
+static std::string mdns_cache_path() {
+    return adb_get_android_dir_path() + OS_PATH_SEPARATOR + "mdns_cache";
+}
+
+static int64_t mdns_cache_now() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+            .count();
+}
+
+// Loads the still-valid cache entries. Caller must hold g_mdns_cache_mutex.
+static std::vector<MdnsCacheEntry> mdns_cache_load_locked() {
+    std::vector<MdnsCacheEntry> entries;
+    std::string contents;
+    if (!android::base::ReadFileToString(mdns_cache_path(), &contents)) {
+        return entries;
+    }
+
+    const int64_t now = mdns_cache_now();
+    for (const auto& line : android::base::Split(contents, "\n")) {
+        auto fields = android::base::Split(line, "\t");
+        if (fields.size() != 5) {
+            continue;
+        }
+        MdnsCacheEntry entry;
+        unsigned int port;
+        if (!android::base::ParseInt(fields[0], &entry.expiry) ||
+            !android::base::ParseUint(fields[4], &port) || port > UINT16_MAX) {
+            continue;
+        }
+        if (entry.expiry <= now) {
+            continue;
+        }
+        entry.service_name = fields[1];
+        entry.reg_type = fields[2];
+        entry.ip_addr = fields[3];
+        entry.port = static_cast<uint16_t>(port);
+        entries.push_back(std::move(entry));
+    }
+    return entries;
+}
+
+static void mdns_cache_store(const std::string& service_name, const std::string& reg_type,
+                             const std::string& ip_addr, uint16_t port, uint32_t ttl) {
+    // Pairing ports are single-use; a cached hit would only be misleading.
+    if (adb_DNSServiceIndexByName(reg_type) == kADBSecurePairingServiceRefIndex) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(g_mdns_cache_mutex);
+    auto entries = mdns_cache_load_locked();
+    entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                 [&](const MdnsCacheEntry& entry) {
+                                     return entry.service_name == service_name &&
+                                            entry.reg_type == reg_type;
+                                 }),
+                  entries.end());
+
+    MdnsCacheEntry entry;
+    int64_t ttl_secs = ttl != 0 ? std::min<int64_t>(ttl, kMdnsCacheMaxTtlSecs)
+                                : kMdnsCacheDefaultTtlSecs;
+    entry.expiry = mdns_cache_now() + ttl_secs;
+    entry.service_name = service_name;
+    entry.reg_type = reg_type;
+    entry.ip_addr = ip_addr;
+    entry.port = port;
+    entries.push_back(std::move(entry));
+
+    std::string contents;
+    for (const auto& e : entries) {
+        contents += android::base::StringPrintf("%" PRId64 "\t%s\t%s\t%s\t%u\n", e.expiry,
+                                                e.service_name.c_str(), e.reg_type.c_str(),
+                                                e.ip_addr.c_str(), e.port);
+    }
+    if (!android::base::WriteStringToFile(contents, mdns_cache_path())) {
+        D("Failed to write mdns cache to [%s]", mdns_cache_path().c_str());
+    }
+}
+
+// Returns a cached resolution for |instance_name|, restricted to |service_index| if it
+// is a valid service index, otherwise to any connect-capable service type.
+static std::optional<MdnsInfo> mdns_cache_lookup(std::string_view instance_name,
+                                                 int service_index) {
+    std::lock_guard<std::mutex> lock(g_mdns_cache_mutex);
+    for (const auto& entry : mdns_cache_load_locked()) {
+        if (entry.service_name != instance_name) {
+            continue;
+        }
+        int index = adb_DNSServiceIndexByName(entry.reg_type);
+        if (service_index >= 0 ? index != service_index
+                               : index != kADBTransportServiceRefIndex &&
+                                         index != kADBSecureConnectServiceRefIndex) {
+            continue;
+        }
+        D("mdns cache hit for [%s]: %s:%u", entry.service_name.c_str(), entry.ip_addr.c_str(),
+          entry.port);
+        return std::make_optional<MdnsInfo>(entry.service_name, entry.reg_type, entry.ip_addr,
+                                            entry.port);
+    }
+    return std::nullopt;
+}
+
 // Use adb_DNSServiceRefSockFD() instead of calling DNSServiceRefSockFD()
 // directly so that the socket is put through the appropriate compatibility
 // layers to work with the rest of ADB's internal APIs.
@@ -229,7 +362,7 @@ class ResolvedService : public AsyncServiceRef {
         return true;
     }
 
-    bool AddToServiceRegistry(const sockaddr* address) {
+    bool AddToServiceRegistry(const sockaddr* address, uint32_t ttl) {
         sa_family_ = address->sa_family;
 
         if (sa_family_ == AF_INET) {
@@ -273,6 +406,10 @@ class ResolvedService : public AsyncServiceRef {
 
         services->push_back(std::unique_ptr<ResolvedService>(this));
 
+        // Persist the resolution so the next server instance can answer
+        // connect-by-name before its own browse warms up.
+        mdns_cache_store(serviceName_, regType_, ip_addr_, port_, ttl);
+
         if (adb_DNSServiceShouldAutoConnect(regType_.c_str(), serviceName_.c_str())) {
             std::string response;
             D("Attempting to connect serviceName=[%s], regtype=[%s] ipaddr=(%s:%hu)",
@@ -459,7 +596,7 @@ static void DNSSD_API register_service_ip(DNSServiceRef sdRef, DNSServiceFlags f
     if (flags & kDNSServiceFlagsAdd) {
         D("Resolved IP address for [%s]. Adding to service registry.", hostname);
         auto* ptr = data.release();
-        if (!ptr->AddToServiceRegistry(address)) {
+        if (!ptr->AddToServiceRegistry(address, ttl)) {
             data.reset(ptr);
         }
     }
@@ -715,6 +852,10 @@ std::optional<MdnsInfo> mdns_get_connect_service_info(std::string_view name) {
                 D("Unknown reg_type [%s]", reg_type.data());
                 return std::nullopt;
         }
+        if (!info.has_value()) {
+            // Not resolved yet; see if a previous server run left a still-valid entry.
+            info = mdns_cache_lookup(mdns_instance->instance_name, index);
+        }
         return info;
     }
 
@@ -726,7 +867,7 @@ std::optional<MdnsInfo> mdns_get_connect_service_info(std::string_view name) {
         }
     }
 
-    return std::nullopt;
+    return mdns_cache_lookup(name, -1);
 }
 
 std::optional<MdnsInfo> mdns_get_pairing_service_info(std::string_view name) {
@@ -29,6 +29,7 @@
 #include <string>
 #include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include <libusb/libusb.h>
 
@@ -87,6 +88,26 @@ struct transfer_info {
 };
 
 namespace libusb {
+
+struct usb_handle;
+
+// An owned asynchronous OUT transfer. usb_write copies the caller's data into |buffer|,
+// submits, and returns without waiting for completion; the callback returns the transfer
+// to the free pool. Keeping several of these in flight keeps the bus busy instead of
+// idling between the header, payload and zero-length URBs of successive packets.
+struct write_transfer {
+    write_transfer() : transfer(libusb_alloc_transfer(0)) {}
+
+    ~write_transfer() {
+        libusb_free_transfer(transfer);
+    }
+
+    libusb_transfer* transfer;
+    std::vector<unsigned char> buffer;
+    bool zlp_pending = false;
+    usb_handle* handle = nullptr;
+};
+
 struct usb_handle : public ::usb_handle {
     usb_handle(const std::string& device_address, const std::string& serial,
                unique_device_handle&& device_handle, uint8_t interface, uint8_t bulk_in,
@@ -96,11 +117,16 @@ struct usb_handle : public ::usb_handle {
           closing(false),
           device_handle(device_handle.release()),
           read("read", zero_mask, false),
-          write("write", zero_mask, true),
+          zero_mask(zero_mask),
           interface(interface),
           bulk_in(bulk_in),
           bulk_out(bulk_out),
-          max_packet_size(max_packet_size) {}
+          max_packet_size(max_packet_size) {
+        for (size_t i = 0; i < kWriteQueueDepth; ++i) {
+            write_pool.emplace_back(new write_transfer());
+            write_free.push_back(write_pool.back().get());
+        }
+    }
 
     ~usb_handle() {
         Close();
@@ -124,7 +150,17 @@ struct usb_handle : public ::usb_handle {
 
         // Cancel already dispatched transfers.
         libusb_cancel_transfer(read.transfer);
-        libusb_cancel_transfer(write.transfer);
+        for (auto& xfer : write_pool) {
+            libusb_cancel_transfer(xfer->transfer);
+        }
+
+        // Wait for the canceled writes to drain: their callbacks run on the libusb event
+        // thread and must not race the handle teardown below.
+        {
+            std::unique_lock<std::mutex> write_lock(write_mutex);
+            write_cv.notify_all();
+            write_cv.wait(write_lock, [this]() { return writes_in_flight == 0; });
+        }
 
         libusb_release_interface(handle, interface);
         libusb_close(handle);
@@ -138,8 +174,18 @@ struct usb_handle : public ::usb_handle {
     libusb_device_handle* device_handle;
 
     transfer_info read;
-    transfer_info write;
 
+    // Asynchronous write pipeline. write_mutex guards the pool, the in-flight count and
+    // the error flag; when both locks are needed, device_handle_mutex is taken first.
+    static constexpr size_t kWriteQueueDepth = 4;
+    std::mutex write_mutex;
+    std::condition_variable write_cv;
+    std::vector<std::unique_ptr<write_transfer>> write_pool;
+    std::vector<write_transfer*> write_free;
+    size_t writes_in_flight = 0;
+    bool write_error = false;
+
+    uint16_t zero_mask;
     uint8_t interface;
     uint8_t bulk_in;
     uint8_t bulk_out;
@@ -561,27 +607,93 @@ static int perform_usb_transfer(usb_handle* h, transfer_info* info,
     return 0;
 }
 
+static LIBUSB_CALL void write_transfer_callback(libusb_transfer* transfer) {
+    write_transfer* xfer = static_cast<write_transfer*>(transfer->user_data);
+    usb_handle* h = xfer->handle;
+
+    if (transfer->status == LIBUSB_TRANSFER_COMPLETED) {
+        if (transfer->actual_length != transfer->length) {
+            LOG(DEBUG) << "write transfer incomplete, resubmitting";
+            transfer->length -= transfer->actual_length;
+            transfer->buffer += transfer->actual_length;
+            if (libusb_submit_transfer(transfer) == 0) {
+                return;
+            }
+            transfer->status = LIBUSB_TRANSFER_ERROR;
+        } else if (xfer->zlp_pending) {
+            LOG(DEBUG) << "submitting zero-length write";
+            xfer->zlp_pending = false;
+            transfer->length = 0;
+            if (libusb_submit_transfer(transfer) == 0) {
+                return;
+            }
+            transfer->status = LIBUSB_TRANSFER_ERROR;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(h->write_mutex);
+    if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
+        if (transfer->status != LIBUSB_TRANSFER_CANCELLED) {
+            LOG(WARNING) << "write transfer failed: " << libusb_error_name(transfer->status);
+        }
+        h->write_error = true;
+    }
+    h->write_free.push_back(xfer);
+    --h->writes_in_flight;
+    h->write_cv.notify_all();
+}
+
 int usb_write(usb_handle* h, const void* d, int len) {
     LOG(DEBUG) << "usb_write of length " << len;
 
-    std::unique_lock<std::mutex> lock(h->device_handle_mutex);
+    // Writes are pipelined: the data is copied into an owned transfer and submitted
+    // without waiting for completion, so successive packets (and the header/payload
+    // halves of a single one) keep multiple URBs queued on the endpoint. Bulk
+    // transfers on one endpoint go out in submission order, so ordering is preserved.
+    // A completion error is latched and reported on the next write.
+    write_transfer* xfer;
+    {
+        std::unique_lock<std::mutex> lock(h->write_mutex);
+        h->write_cv.wait(lock, [h]() {
+            return !h->write_free.empty() || h->write_error || h->closing;
+        });
+        if (h->write_error || h->closing) {
+            errno = EIO;
+            return -1;
+        }
+        xfer = h->write_free.back();
+        h->write_free.pop_back();
+    }
+
+    std::unique_lock<std::mutex> device_lock(h->device_handle_mutex);
     if (!h->device_handle) {
+        std::lock_guard<std::mutex> lock(h->write_mutex);
+        h->write_free.push_back(xfer);
         errno = EIO;
         return -1;
     }
 
-    transfer_info* info = &h->write;
-    info->transfer->dev_handle = h->device_handle;
-    info->transfer->flags = 0;
-    info->transfer->endpoint = h->bulk_out;
-    info->transfer->type = LIBUSB_TRANSFER_TYPE_BULK;
-    info->transfer->length = len;
-    info->transfer->buffer = reinterpret_cast<unsigned char*>(const_cast<void*>(d));
-    info->transfer->num_iso_packets = 0;
+    const unsigned char* data = static_cast<const unsigned char*>(d);
+    xfer->buffer.assign(data, data + len);
+    xfer->zlp_pending = should_perform_zero_transfer(h->bulk_out, len, h->zero_mask);
+    xfer->handle = h;
+    libusb_fill_bulk_transfer(xfer->transfer, h->device_handle, h->bulk_out, xfer->buffer.data(),
+                              len, write_transfer_callback, xfer, 0);
 
-    int rc = perform_usb_transfer(h, info, std::move(lock));
-    LOG(DEBUG) << "usb_write(" << len << ") = " << rc;
-    return info->transfer->actual_length;
+    {
+        std::lock_guard<std::mutex> lock(h->write_mutex);
+        int rc = libusb_submit_transfer(xfer->transfer);
+        if (rc != 0) {
+            LOG(WARNING) << "failed to submit write transfer: " << libusb_error_name(rc);
+            h->write_free.push_back(xfer);
+            errno = EIO;
+            return -1;
+        }
+        ++h->writes_in_flight;
+    }
+
+    LOG(DEBUG) << "usb_write(" << len << ") submitted";
+    return len;
 }
 
 int usb_read(usb_handle* h, void* d, int len) {
@@ -14,9 +14,13 @@
  * limitations under the License.
  */
 
+#include <fcntl.h>
+#include <linux/memfd.h>
+#include <sys/syscall.h>
 #include <sys/wait.h>
 
 #include <android-base/cmsg.h>
+#include <android-base/parseint.h>
 #include <android-base/strings.h>
 #include <cmd.h>
 
@@ -67,6 +71,68 @@ std::vector<std::string_view> parseCmdArgs(std::string_view args) {
     return argv;
 }
 
+// Only stage payloads big enough for the copy to pay off, and cap the staging
+// size: memfd pages are reclaimable but still count against memory pressure,
+// so very large streams keep reading straight from the socket.
+static constexpr uint64_t kMinStagedPayload = 1 * 1024 * 1024;
+static constexpr uint64_t kMaxStagedPayload = 256 * 1024 * 1024;
+
+// Commands that stream a payload over stdin declare its exact length up front
+// (`cmd package install[-write] -S <size> ...`). When we see such a
+// declaration, drain the payload from the command socket into a memfd and hand
+// the memfd to the command instead. This decouples the transport from the
+// command's consumption rate: adbd can push the whole stream at socket speed
+// while the package manager forwards it over binder at its own pace, instead
+// of backpressuring each apacket through the bridge.
+//
+// Returns an invalid fd if the command doesn't declare a payload or staging
+// doesn't apply; the caller falls back to passing the socket through.
+static unique_fd stageStdinPayload(const std::vector<std::string_view>& argv, borrowed_fd in) {
+    uint64_t size = 0;
+    bool found = false;
+    for (size_t i = 0; i + 1 < argv.size(); ++i) {
+        if (argv[i] == "-S" && android::base::ParseUint(std::string(argv[i + 1]), &size)) {
+            found = true;
+            break;
+        }
+    }
+    if (!found || size < kMinStagedPayload || size > kMaxStagedPayload) {
+        return unique_fd{};
+    }
+
+    unique_fd memfd(syscall(__NR_memfd_create, "abb_payload", MFD_CLOEXEC));
+    if (memfd == -1) {
+        PLOG(WARNING) << "memfd_create failed, reading payload from socket instead";
+        return unique_fd{};
+    }
+    if (fallocate(memfd.get(), 0, 0, size) == -1) {
+        PLOG(WARNING) << "fallocate(" << size << ") failed, reading payload from socket instead";
+        return unique_fd{};
+    }
+
+    std::vector<char> buffer(1024 * 1024);
+    uint64_t left = size;
+    while (left > 0) {
+        size_t chunk = std::min<uint64_t>(left, buffer.size());
+        if (!ReadFdExactly(in, buffer.data(), chunk) ||
+            !WriteFdExactly(memfd, buffer.data(), chunk)) {
+            // The stream died. Trim the preallocation so the command sees EOF
+            // where the payload stopped rather than zero fill.
+            int64_t written = adb_lseek(memfd, 0, SEEK_CUR);
+            if (written == -1 || adb_ftruncate(memfd, written) == -1) {
+                return unique_fd{};
+            }
+            break;
+        }
+        left -= chunk;
+    }
+    if (adb_lseek(memfd, 0, SEEK_SET) == -1) {
+        PLOG(WARNING) << "failed to rewind staged payload";
+        return unique_fd{};
+    }
+    return memfd;
+}
+
 }  // namespace
 
 static int execCmd(std::string_view args, borrowed_fd in, borrowed_fd out, borrowed_fd err) {
@@ -75,10 +141,13 @@ static int execCmd(std::string_view args, borrowed_fd in, borrowed_fd out, borro
     adb_setsockopt(out, SOL_SOCKET, SO_SNDBUF, &max_buf, sizeof(max_buf));
     adb_setsockopt(err, SOL_SOCKET, SO_SNDBUF, &max_buf, sizeof(max_buf));
 
+    std::vector<std::string_view> argv = parseCmdArgs(args);
+    unique_fd staged_in = stageStdinPayload(argv, in);
+    borrowed_fd cmd_in = staged_in != -1 ? staged_in : in;
+
     AdbFdTextOutput oin(out);
     AdbFdTextOutput oerr(err);
-    return cmdMain(parseCmdArgs(args), oin, oerr, in.get(), out.get(), err.get(),
-                   RunMode::kLibrary);
+    return cmdMain(argv, oin, oerr, cmd_in.get(), out.get(), err.get(), RunMode::kLibrary);
 }
 
 int main(int argc, char* const argv[]) {
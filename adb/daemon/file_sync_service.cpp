@@ -31,6 +31,12 @@
 #include <unistd.h>
 #include <utime.h>
 
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#endif
+
+#include <algorithm>
 #include <memory>
 #include <optional>
 #include <span>
@@ -43,6 +49,8 @@
 #include <android-base/stringprintf.h>
 #include <android-base/strings.h>
 
+#include <openssl/sha.h>
+
 #include <adbd_fs.h>
 
 // Needed for __android_log_security_bswrite.
@@ -57,6 +65,7 @@
 #include "adb.h"
 #include "adb_io.h"
 #include "adb_trace.h"
+#include "adb_trace_ring.h"
 #include "adb_utils.h"
 #include "compression_utils.h"
 #include "file_sync_protocol.h"
@@ -267,8 +276,203 @@ static bool SendSyncFailErrno(borrowed_fd fd, const std::string& reason) {
     return SendSyncFail(fd, StringPrintf("%s: %s", reason.c_str(), strerror(errno)));
 }
 
+#if defined(__linux__)
+// Result of an attempted zero-copy transfer. kUnsupported means nothing was consumed and
+// the caller should fall back to the buffered path.
+enum class ZeroCopyResult {
+    kDone,
+    kFailed,
+    kUnsupported,
+};
+
+// Drains uncompressed ID_DATA packets from the socket straight into `fd` with
+// splice(2) via a pipe, so the payload never crosses into userspace. The caller
+// has already verified that no decoder is needed.
+static ZeroCopyResult handle_send_file_data_spliced(borrowed_fd s, borrowed_fd fd,
+                                                    uint32_t* timestamp) {
+    int pipefd[2];
+    if (pipe2(pipefd, O_CLOEXEC) != 0) {
+        return ZeroCopyResult::kUnsupported;
+    }
+    unique_fd pipe_read(pipefd[0]);
+    unique_fd pipe_write(pipefd[1]);
+
+    syncmsg msg;
+    while (true) {
+        if (!ReadFdExactly(s, &msg.data, sizeof(msg.data))) return ZeroCopyResult::kFailed;
+
+        if (msg.data.id == ID_DONE) {
+            *timestamp = msg.data.size;
+            return ZeroCopyResult::kDone;
+        } else if (msg.data.id != ID_DATA) {
+            SendSyncFail(s, "invalid data message");
+            return ZeroCopyResult::kFailed;
+        }
+
+        size_t remaining = msg.data.size;
+        while (remaining > 0) {
+            ssize_t in = splice(s.get(), nullptr, pipe_write.get(), nullptr, remaining,
+                                SPLICE_F_MOVE);
+            if (in <= 0) {
+                if (in < 0 && errno == EINTR) continue;
+                SendSyncFailErrno(s, "splice from socket failed");
+                return ZeroCopyResult::kFailed;
+            }
+
+            ssize_t spliced = in;
+            while (spliced > 0) {
+                ssize_t out = splice(pipe_read.get(), nullptr, fd.get(), nullptr, spliced,
+                                     SPLICE_F_MOVE);
+                if (out <= 0) {
+                    if (out < 0 && errno == EINTR) continue;
+                    SendSyncFailErrno(s, "write failed");
+                    return ZeroCopyResult::kFailed;
+                }
+                spliced -= out;
+            }
+            remaining -= in;
+        }
+    }
+}
+
+// Streams `size` bytes of `fd` to the socket as uncompressed ID_DATA packets using
+// sendfile(2), avoiding the read/memcpy/write round trip through userspace.
+static ZeroCopyResult recv_file_data_sendfile(borrowed_fd s, borrowed_fd fd, uint64_t size) {
+    syncmsg msg;
+    msg.data.id = ID_DATA;
+
+    uint64_t remaining = size;
+    bool use_sendfile = true;
+    while (remaining > 0) {
+        size_t chunk = std::min<uint64_t>(remaining, SYNC_DATA_MAX);
+        msg.data.size = chunk;
+        if (!WriteFdExactly(s, &msg.data, sizeof(msg.data))) return ZeroCopyResult::kFailed;
+
+        size_t sent = 0;
+        while (sent < chunk) {
+            if (use_sendfile) {
+                ssize_t rc = sendfile(s.get(), fd.get(), nullptr, chunk - sent);
+                if (rc < 0) {
+                    if (errno == EINTR) continue;
+                    if (sent == 0 && (errno == EINVAL || errno == ENOSYS)) {
+                        // The socket or filesystem doesn't do sendfile, but the data
+                        // header for this chunk is already on the wire: fill the chunk
+                        // by hand instead.
+                        use_sendfile = false;
+                        continue;
+                    }
+                    SendSyncFailErrno(s, "sendfile failed");
+                    return ZeroCopyResult::kFailed;
+                }
+                if (rc == 0) {
+                    // The file shrank while we were sending it; the stream is now short
+                    // and unrecoverable.
+                    SendSyncFail(s, "file truncated during transfer");
+                    return ZeroCopyResult::kFailed;
+                }
+                sent += rc;
+            } else {
+                char buf[SYNC_DATA_MAX];
+                int rc = adb_read(fd.get(), buf, chunk - sent);
+                if (rc <= 0) {
+                    SendSyncFail(s, rc == 0 ? "file truncated during transfer" : "read failed");
+                    return ZeroCopyResult::kFailed;
+                }
+                if (!WriteFdExactly(s, buf, rc)) return ZeroCopyResult::kFailed;
+                sent += rc;
+            }
+        }
+        remaining -= chunk;
+    }
+
+    msg.data.id = ID_DONE;
+    msg.data.size = 0;
+    if (!WriteFdExactly(s, &msg.data, sizeof(msg.data))) return ZeroCopyResult::kFailed;
+    return ZeroCopyResult::kDone;
+}
+
+// Sends a sparse file as data regions and ID_HOLE gaps, walking the allocation map with
+// SEEK_DATA/SEEK_HOLE so a mostly-empty image transfers in proportion to its allocated
+// size. The stream opens with ID_SPRS so the client knows to expect raw data and holes.
+static bool recv_file_data_sparse(borrowed_fd s, borrowed_fd fd, uint64_t size) {
+    syncmsg msg;
+    msg.data.id = ID_SPRS;
+    msg.data.size = 0;
+    if (!WriteFdExactly(s, &msg.data, sizeof(msg.data))) return false;
+
+    auto send_hole = [&](uint64_t len) -> bool {
+        while (len > 0) {
+            uint32_t chunk = std::min<uint64_t>(len, UINT32_MAX);
+            msg.data.id = ID_HOLE;
+            msg.data.size = chunk;
+            if (!WriteFdExactly(s, &msg.data, sizeof(msg.data))) return false;
+            len -= chunk;
+        }
+        return true;
+    };
+
+    uint64_t offset = 0;
+    while (offset < size) {
+        off64_t data = lseek64(fd.get(), offset, SEEK_DATA);
+        if (data == -1) {
+            if (errno == ENXIO) break;  // Nothing but hole until EOF.
+            SendSyncFailErrno(s, "seek failed");
+            return false;
+        }
+        off64_t hole = lseek64(fd.get(), data, SEEK_HOLE);
+        if (hole == -1) {
+            SendSyncFailErrno(s, "seek failed");
+            return false;
+        }
+
+        if (static_cast<uint64_t>(data) > offset) {
+            if (!send_hole(data - offset)) return false;
+        }
+
+        if (lseek64(fd.get(), data, SEEK_SET) == -1) {
+            SendSyncFailErrno(s, "seek failed");
+            return false;
+        }
+        uint64_t remaining = hole - data;
+        while (remaining > 0) {
+            char buf[SYNC_DATA_MAX];
+            int rc = adb_read(fd.get(), buf, std::min<uint64_t>(remaining, sizeof(buf)));
+            if (rc <= 0) {
+                SendSyncFail(s, rc == 0 ? "file truncated during transfer" : "read failed");
+                return false;
+            }
+            msg.data.id = ID_DATA;
+            msg.data.size = rc;
+            if (!WriteFdExactly(s, &msg.data, sizeof(msg.data)) || !WriteFdExactly(s, buf, rc)) {
+                return false;
+            }
+            remaining -= rc;
+        }
+        offset = hole;
+    }
+
+    // A trailing hole still has to be accounted for so the client truncates to full length.
+    if (offset < size && !send_hole(size - offset)) return false;
+
+    msg.data.id = ID_DONE;
+    msg.data.size = 0;
+    return WriteFdExactly(s, &msg.data, sizeof(msg.data));
+}
+#endif
+
 static bool handle_send_file_data(borrowed_fd s, unique_fd fd, uint32_t* timestamp,
-                                  CompressionType compression) {
+                                  CompressionType compression, bool sparse) {
+#if defined(__linux__)
+    // fd is -1 if the client is pushing with --dry-run. The spliced path doesn't
+    // understand hole packets, so sparse streams take the ordinary loop below.
+    if (compression == CompressionType::None && !sparse && fd != -1) {
+        ZeroCopyResult result = handle_send_file_data_spliced(s, fd, timestamp);
+        if (result != ZeroCopyResult::kUnsupported) {
+            return result == ZeroCopyResult::kDone;
+        }
+    }
+#endif
+
     syncmsg msg;
     Block buffer(SYNC_DATA_MAX);
     std::span<char> buffer_span(buffer.data(), buffer.size());
@@ -307,6 +511,14 @@ static bool handle_send_file_data(borrowed_fd s, unique_fd fd, uint32_t* timesta
             Block block(msg.data.size);
             if (!ReadFdExactly(s, block.data(), msg.data.size)) return false;
             decoder->Append(std::move(block));
+        } else if (msg.data.id == ID_HOLE && sparse) {
+            // Sparse streams are never compressed, so the decoder is a passthrough
+            // and it's safe to seek around it.
+            if (fd != -1 && adb_lseek(fd, msg.data.size, SEEK_CUR) == -1) {
+                SendSyncFailErrno(s, "seek failed");
+                return false;
+            }
+            continue;
         } else {
             SendSyncFail(s, "invalid data message");
             return false;
@@ -333,6 +545,15 @@ static bool handle_send_file_data(borrowed_fd s, unique_fd fd, uint32_t* timesta
             } else if (result == DecodeResult::MoreOutput) {
                 continue;
             } else if (result == DecodeResult::Done) {
+                if (sparse && fd != -1) {
+                    // A trailing hole leaves the fd seeked past EOF with nothing
+                    // written; ftruncate materializes it.
+                    int64_t size = adb_lseek(fd, 0, SEEK_CUR);
+                    if (size == -1 || adb_ftruncate(fd, size) == -1) {
+                        SendSyncFailErrno(s, "truncate failed");
+                        return false;
+                    }
+                }
                 return true;
             } else {
                 LOG(FATAL) << "invalid DecodeResult: " << static_cast<int>(result);
@@ -343,10 +564,208 @@ static bool handle_send_file_data(borrowed_fd s, unique_fd fd, uint32_t* timesta
     __builtin_unreachable();
 }
 
+// Read as much of a full block as the file has left, coping with short reads.
+static int read_block(borrowed_fd fd, char* data, size_t block_size) {
+    size_t len = 0;
+    while (len < block_size) {
+        int rc = adb_read(fd, data + len, block_size - len);
+        if (rc < 0) {
+            return -1;
+        } else if (rc == 0) {
+            break;
+        }
+        len += rc;
+    }
+    return len;
+}
+
+static bool do_cksm(borrowed_fd s, const char* path, std::vector<char>& buffer) {
+    syncmsg msg;
+    std::string digests;
+
+    // A file that's missing or unreadable isn't an error: report no blocks and let the
+    // client fall back to a full transfer.
+    unique_fd fd(adb_open(path, O_RDONLY | O_CLOEXEC));
+    if (fd >= 0) {
+        int rc = posix_fadvise(fd.get(), 0, 0, POSIX_FADV_SEQUENTIAL | POSIX_FADV_NOREUSE);
+        if (rc != 0) {
+            D("[ Failed to fadvise: %s ]", strerror(rc));
+        }
+
+        while (true) {
+            int len = read_block(fd, &buffer[0], SYNC_DATA_MAX);
+            if (len < 0) {
+                SendSyncFailErrno(s, "read failed");
+                return false;
+            } else if (len == 0) {
+                break;
+            }
+
+            uint8_t digest[SHA256_DIGEST_LENGTH];
+            static_assert(SHA256_DIGEST_LENGTH == SYNC_DELTA_DIGEST_SIZE);
+            SHA256(reinterpret_cast<const uint8_t*>(&buffer[0]), len, digest);
+            digests.append(reinterpret_cast<const char*>(digest), sizeof(digest));
+
+            if (digests.size() + SYNC_DELTA_DIGEST_SIZE > SYNC_DATA_MAX) {
+                msg.data.id = ID_CKSM;
+                msg.data.size = digests.size();
+                if (!WriteFdExactly(s, &msg.data, sizeof(msg.data)) ||
+                    !WriteFdExactly(s, digests.data(), digests.size())) {
+                    return false;
+                }
+                digests.clear();
+            }
+
+            if (static_cast<size_t>(len) < SYNC_DATA_MAX) {
+                break;
+            }
+        }
+    }
+
+    if (!digests.empty()) {
+        msg.data.id = ID_CKSM;
+        msg.data.size = digests.size();
+        if (!WriteFdExactly(s, &msg.data, sizeof(msg.data)) ||
+            !WriteFdExactly(s, digests.data(), digests.size())) {
+            return false;
+        }
+    }
+
+    msg.data.id = ID_DONE;
+    msg.data.size = 0;
+    return WriteFdExactly(s, &msg.data, sizeof(msg.data));
+}
+
+// Receive a delta send: the stream contains ID_COPY references to unchanged blocks of
+// the old file interleaved with ID_DATA packets for the blocks that changed. The new
+// contents are assembled in a temporary file and renamed over the original, so a
+// transfer that dies partway doesn't destroy the only copy of the blocks it was
+// copying from.
+static bool handle_send_file_delta(borrowed_fd s, const char* path, uint32_t* timestamp,
+                                   uid_t uid, gid_t gid, uint64_t capabilities, mode_t mode,
+                                   std::vector<char>& buffer) {
+    syncmsg msg;
+    __android_log_security_bswrite(SEC_TAG_ADB_SEND_FILE, path);
+
+    std::string tmp_path = std::string(path) + ".adb-delta";
+    unique_fd old_fd(adb_open(path, O_RDONLY | O_CLOEXEC));
+    unique_fd fd;
+
+    if (old_fd < 0) {
+        SendSyncFailErrno(s, "couldn't open file for delta transfer");
+        goto fail;
+    }
+
+    fd.reset(adb_open_mode(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, mode));
+    if (fd < 0) {
+        SendSyncFailErrno(s, "couldn't create file");
+        goto fail;
+    }
+
+    if (fchown(fd.get(), uid, gid) == -1) {
+        SendSyncFailErrno(s, "fchown failed");
+        goto fail;
+    }
+
+#if defined(__ANDROID__)
+    // Not all filesystems support setting SELinux labels. http://b/23530370.
+    selinux_android_restorecon(tmp_path.c_str(), 0);
+#endif
+
+    // fchown clears the setuid bit - restore it if present.
+    // Ignore the result of calling fchmod. It's not supported
+    // by all filesystems, so we don't check for success. b/12441485
+    fchmod(fd.get(), mode);
+
+    while (true) {
+        if (!ReadFdExactly(s, &msg.data, sizeof(msg.data))) {
+            adb_unlink(tmp_path.c_str());
+            return false;
+        }
+
+        if (msg.data.id == ID_DONE) {
+            *timestamp = msg.data.size;
+            break;
+        } else if (msg.data.id == ID_DATA) {
+            if (msg.data.size > buffer.size()) {
+                SendSyncFail(s, "oversize data message");
+                goto fail;
+            }
+            if (!ReadFdExactly(s, &buffer[0], msg.data.size)) {
+                adb_unlink(tmp_path.c_str());
+                return false;
+            }
+            if (!WriteFdExactly(fd, &buffer[0], msg.data.size)) {
+                SendSyncFailErrno(s, "write failed");
+                goto fail;
+            }
+        } else if (msg.data.id == ID_COPY) {
+            uint64_t offset = static_cast<uint64_t>(msg.copy.block) * SYNC_DATA_MAX;
+            int len = TEMP_FAILURE_RETRY(
+                    pread64(old_fd.get(), &buffer[0], SYNC_DATA_MAX, offset));
+            if (len < 0) {
+                SendSyncFailErrno(s, "read of old block failed");
+                goto fail;
+            }
+            if (!WriteFdExactly(fd, &buffer[0], len)) {
+                SendSyncFailErrno(s, "write failed");
+                goto fail;
+            }
+        } else {
+            SendSyncFail(s, "invalid data message");
+            goto fail;
+        }
+    }
+
+    if (!update_capabilities(tmp_path.c_str(), capabilities)) {
+        SendSyncFailErrno(s, "update_capabilities failed");
+        goto fail;
+    }
+
+    if (rename(tmp_path.c_str(), path) != 0) {
+        SendSyncFailErrno(s, "rename failed");
+        goto fail;
+    }
+
+    msg.status.id = ID_OKAY;
+    msg.status.msglen = 0;
+    return WriteFdExactly(s, &msg.status, sizeof(msg.status));
+
+fail:
+    // Keep draining the stream until the client notices the failure, like
+    // handle_send_file does. ID_COPY records carry no payload.
+    while (true) {
+        if (!ReadFdExactly(s, &msg.data, sizeof(msg.data))) break;
+
+        if (msg.data.id == ID_DONE) {
+            break;
+        } else if (msg.data.id == ID_COPY) {
+            continue;
+        } else if (msg.data.id != ID_DATA) {
+            char id[5];
+            memcpy(id, &msg.data.id, sizeof(msg.data.id));
+            id[4] = '\0';
+            D("handle_send_file_delta received unexpected id '%s' during failure", id);
+            break;
+        }
+
+        if (msg.data.size > buffer.size()) {
+            D("handle_send_file_delta received oversized packet of length '%u' during failure",
+              msg.data.size);
+            break;
+        }
+
+        if (!ReadFdExactly(s, &buffer[0], msg.data.size)) break;
+    }
+
+    adb_unlink(tmp_path.c_str());
+    return false;
+}
+
 static bool handle_send_file(borrowed_fd s, const char* path, uint32_t* timestamp, uid_t uid,
                              gid_t gid, uint64_t capabilities, mode_t mode,
-                             CompressionType compression, bool dry_run, std::vector<char>& buffer,
-                             bool do_unlink) {
+                             CompressionType compression, bool sparse, bool dry_run,
+                             std::vector<char>& buffer, bool do_unlink) {
     syncmsg msg;
     unique_fd fd;
 
@@ -391,7 +810,7 @@ static bool handle_send_file(borrowed_fd s, const char* path, uint32_t* timestam
         }
     }
 
-    if (!handle_send_file_data(s, std::move(fd), timestamp, compression)) {
+    if (!handle_send_file_data(s, std::move(fd), timestamp, compression, sparse)) {
         goto fail;
     }
 
@@ -496,11 +915,18 @@ static bool handle_send_link(int s, const std::string& path, uint32_t* timestamp
 #endif
 
 static bool send_impl(int s, const std::string& path, mode_t mode, CompressionType compression,
-                      bool dry_run, std::vector<char>& buffer) {
+                      bool sparse, bool dry_run, bool delta, std::vector<char>& buffer) {
+    if (delta && S_ISLNK(mode)) {
+        SendSyncFail(s, "delta transfer of a symlink");
+        return false;
+    }
+
     // Don't delete files before copying if they are not "regular" or symlinks.
+    // A delta transfer reads the old file while writing the new one, so it must not
+    // unlink either.
     struct stat st;
     bool do_unlink = false;
-    if (!dry_run) {
+    if (!dry_run && !delta) {
         do_unlink = (lstat(path.c_str(), &st) == -1) || S_ISREG(st.st_mode) ||
                     (S_ISLNK(st.st_mode) && !S_ISLNK(mode));
     }
@@ -525,8 +951,13 @@ static bool send_impl(int s, const std::string& path, mode_t mode, CompressionTy
             adbd_fs_config(path.c_str(), 0, nullptr, &uid, &gid, &mode, &capabilities);
         }
 
-        result = handle_send_file(s, path.c_str(), &timestamp, uid, gid, capabilities, mode,
-                                  compression, dry_run, buffer, do_unlink);
+        if (delta) {
+            result = handle_send_file_delta(s, path.c_str(), &timestamp, uid, gid, capabilities,
+                                            mode, buffer);
+        } else {
+            result = handle_send_file(s, path.c_str(), &timestamp, uid, gid, capabilities, mode,
+                                      compression, sparse, dry_run, buffer, do_unlink);
+        }
     }
 
     if (!result) {
@@ -559,7 +990,7 @@ static bool do_send_v1(int s, const std::string& spec, std::vector<char>& buffer
         return false;
     }
 
-    return send_impl(s, path, mode, CompressionType::None, false, buffer);
+    return send_impl(s, path, mode, CompressionType::None, false, false, false, buffer);
 }
 
 static bool do_send_v2(int s, const std::string& path, std::vector<char>& buffer) {
@@ -608,6 +1039,24 @@ static bool do_send_v2(int s, const std::string& path, std::vector<char>& buffer
         msg.send_v2_setup.flags &= ~kSyncFlagDryRun;
         dry_run = true;
     }
+    bool delta = false;
+    if (msg.send_v2_setup.flags & kSyncFlagDelta) {
+        msg.send_v2_setup.flags &= ~kSyncFlagDelta;
+        delta = true;
+    }
+    if (delta && (compression || dry_run)) {
+        SendSyncFail(s, "delta transfers are incompatible with compression and dry-run");
+        return false;
+    }
+    bool sparse = false;
+    if (msg.send_v2_setup.flags & kSyncFlagSparse) {
+        msg.send_v2_setup.flags &= ~kSyncFlagSparse;
+        sparse = true;
+    }
+    if (sparse && (compression || delta)) {
+        SendSyncFail(s, "sparse transfers are incompatible with compression and delta");
+        return false;
+    }
 
     if (msg.send_v2_setup.flags) {
         SendSyncFail(s, android::base::StringPrintf("unknown flags: %d", msg.send_v2_setup.flags));
@@ -616,11 +1065,11 @@ static bool do_send_v2(int s, const std::string& path, std::vector<char>& buffer
 
     errno = 0;
     return send_impl(s, path, msg.send_v2_setup.mode, compression.value_or(CompressionType::None),
-                     dry_run, buffer);
+                     sparse, dry_run, delta, buffer);
 }
 
 static bool recv_impl(borrowed_fd s, const char* path, CompressionType compression,
-                      std::vector<char>& buffer) {
+                      bool allow_sparse, std::vector<char>& buffer) {
     __android_log_security_bswrite(SEC_TAG_ADB_RECV_FILE, path);
 
     unique_fd fd(adb_open(path, O_RDONLY | O_CLOEXEC));
@@ -634,6 +1083,26 @@ static bool recv_impl(borrowed_fd s, const char* path, CompressionType compressi
         D("[ Failed to fadvise: %s ]", strerror(rc));
     }
 
+#if defined(__linux__)
+    {
+        struct stat st;
+        if (fstat(fd.get(), &st) == 0 && S_ISREG(st.st_mode)) {
+            if (allow_sparse &&
+                static_cast<uint64_t>(st.st_blocks) * 512 < static_cast<uint64_t>(st.st_size)) {
+                // Only engage if the filesystem actually supports SEEK_DATA; probing
+                // first means ID_SPRS never goes on the wire and then fails over.
+                if (lseek64(fd.get(), 0, SEEK_DATA) != -1 || errno == ENXIO) {
+                    return recv_file_data_sparse(s, fd, st.st_size);
+                }
+                lseek64(fd.get(), 0, SEEK_SET);
+            }
+            if (compression == CompressionType::None) {
+                return recv_file_data_sendfile(s, fd, st.st_size) == ZeroCopyResult::kDone;
+            }
+        }
+    }
+#endif
+
     syncmsg msg;
     msg.data.id = ID_DATA;
 
@@ -711,7 +1180,7 @@ static bool recv_impl(borrowed_fd s, const char* path, CompressionType compressi
 }
 
 static bool do_recv_v1(borrowed_fd s, const char* path, std::vector<char>& buffer) {
-    return recv_impl(s, path, CompressionType::None, buffer);
+    return recv_impl(s, path, CompressionType::None, false, buffer);
 }
 
 static bool do_recv_v2(borrowed_fd s, const char* path, std::vector<char>& buffer) {
@@ -754,13 +1223,186 @@ static bool do_recv_v2(borrowed_fd s, const char* path, std::vector<char>& buffe
         }
         compression = CompressionType::Zstd;
     }
+    // kSyncFlagSparse only advertises that the client understands hole packets; whether
+    // to actually use them is decided here, once we've seen the file.
+    bool allow_sparse = false;
+    if (msg.recv_v2_setup.flags & kSyncFlagSparse) {
+        msg.recv_v2_setup.flags &= ~kSyncFlagSparse;
+        allow_sparse = true;
+    }
 
     if (msg.recv_v2_setup.flags) {
         SendSyncFail(s, android::base::StringPrintf("unknown flags: %d", msg.recv_v2_setup.flags));
         return false;
     }
 
-    return recv_impl(s, path, compression.value_or(CompressionType::None), buffer);
+    return recv_impl(s, path, compression.value_or(CompressionType::None), allow_sparse, buffer);
+}
+
+// Flushes the buffered snapshot records through the encoder and writes whatever it
+// produces as ID_DATA packets.
+static bool snapshot_write_records(borrowed_fd s, Encoder* encoder, std::vector<char>* pending,
+                                   bool finish) {
+    if (!pending->empty()) {
+        Block block(pending->size());
+        memcpy(block.data(), pending->data(), pending->size());
+        encoder->Append(std::move(block));
+        pending->clear();
+    }
+    if (finish) {
+        encoder->Finish();
+    }
+
+    while (true) {
+        Block output;
+        EncodeResult result = encoder->Encode(&output);
+        if (result == EncodeResult::Error) {
+            return false;
+        }
+
+        if (!output.empty()) {
+            syncmsg msg;
+            msg.data.id = ID_DATA;
+            msg.data.size = output.size();
+            if (!WriteFdExactly(s, &msg.data, sizeof(msg.data)) ||
+                !WriteFdExactly(s, output.data(), output.size())) {
+                return false;
+            }
+        }
+
+        if (result == EncodeResult::MoreOutput) {
+            continue;
+        }
+        return true;
+    }
+}
+
+static bool snapshot_walk(borrowed_fd s, const std::string& root, const std::string& rel,
+                          Encoder* encoder, std::vector<char>* pending) {
+    std::string dir_path = rel.empty() ? root : root + "/" + rel;
+    std::unique_ptr<DIR, int (*)(DIR*)> d(opendir(dir_path.c_str()), closedir);
+    if (!d) {
+        // Unreadable (or nonexistent) directories are skipped, matching do_list.
+        return true;
+    }
+
+    dirent* de;
+    while ((de = readdir(d.get()))) {
+        if (!strcmp(de->d_name, ".") || !strcmp(de->d_name, "..")) continue;
+
+        std::string name = rel.empty() ? de->d_name : rel + "/" + de->d_name;
+        std::string path = root + "/" + name;
+
+        sync_dent_v2 dent = {};
+        dent.id = ID_DENT_V2;
+
+        struct stat st;
+        bool stat_ok = lstat(path.c_str(), &st) == 0;
+        if (stat_ok) {
+            dent.dev = st.st_dev;
+            dent.ino = st.st_ino;
+            dent.mode = st.st_mode;
+            dent.nlink = st.st_nlink;
+            dent.uid = st.st_uid;
+            dent.gid = st.st_gid;
+            dent.size = st.st_size;
+            dent.atime = st.st_atime;
+            dent.mtime = st.st_mtime;
+            dent.ctime = st.st_ctime;
+        } else {
+            dent.error = errno_to_wire(errno);
+        }
+        dent.namelen = name.size();
+
+        const char* dent_bytes = reinterpret_cast<const char*>(&dent);
+        pending->insert(pending->end(), dent_bytes, dent_bytes + sizeof(dent));
+        pending->insert(pending->end(), name.begin(), name.end());
+        if (pending->size() >= SYNC_DATA_MAX) {
+            if (!snapshot_write_records(s, encoder, pending, false)) return false;
+        }
+
+        if (stat_ok && S_ISDIR(st.st_mode)) {
+            if (!snapshot_walk(s, root, name, encoder, pending)) return false;
+        }
+    }
+    return true;
+}
+
+// One ID_SNAP request walks an entire subtree and streams every entry's stat data back as
+// sync_dent_v2 records inside compressed ID_DATA packets; see file_sync_protocol.h.  This
+// collapses the per-path stat round trips of a large push into a single request.
+static bool do_snapshot(borrowed_fd s, const char* path) {
+    syncmsg msg;
+    if (!ReadFdExactly(s, &msg.snap_setup, sizeof(msg.snap_setup))) {
+        LOG(ERROR) << "failed to read snapshot setup packet";
+        return false;
+    }
+
+    std::optional<CompressionType> compression;
+    uint32_t orig_flags = msg.snap_setup.flags;
+    if (msg.snap_setup.flags & kSyncFlagBrotli) {
+        msg.snap_setup.flags &= ~kSyncFlagBrotli;
+        compression = CompressionType::Brotli;
+    }
+    if (msg.snap_setup.flags & kSyncFlagLZ4) {
+        msg.snap_setup.flags &= ~kSyncFlagLZ4;
+        if (compression) {
+            SendSyncFail(s, StringPrintf("multiple compression flags received: %d", orig_flags));
+            return false;
+        }
+        compression = CompressionType::LZ4;
+    }
+    if (msg.snap_setup.flags & kSyncFlagZstd) {
+        msg.snap_setup.flags &= ~kSyncFlagZstd;
+        if (compression) {
+            SendSyncFail(s, StringPrintf("multiple compression flags received: %d", orig_flags));
+            return false;
+        }
+        compression = CompressionType::Zstd;
+    }
+    if (msg.snap_setup.flags) {
+        SendSyncFail(s, StringPrintf("unknown flags: %d", msg.snap_setup.flags));
+        return false;
+    }
+
+    std::variant<std::monostate, NullEncoder, BrotliEncoder, LZ4Encoder, ZstdEncoder>
+            encoder_storage;
+    Encoder* encoder = nullptr;
+    switch (compression.value_or(CompressionType::None)) {
+        case CompressionType::None:
+            encoder = &encoder_storage.emplace<NullEncoder>(SYNC_DATA_MAX);
+            break;
+
+        case CompressionType::Brotli:
+            encoder = &encoder_storage.emplace<BrotliEncoder>(SYNC_DATA_MAX);
+            break;
+
+        case CompressionType::LZ4:
+            encoder = &encoder_storage.emplace<LZ4Encoder>(SYNC_DATA_MAX);
+            break;
+
+        case CompressionType::Zstd:
+            encoder = &encoder_storage.emplace<ZstdEncoder>(SYNC_DATA_MAX);
+            break;
+
+        case CompressionType::Any:
+            LOG(FATAL) << "unexpected CompressionType::Any";
+    }
+
+    // The request path keeps its trailing separator on pushes; strip it so the walk
+    // doesn't build double-slashed paths.
+    std::string root = path;
+    while (root.size() > 1 && root.back() == '/') {
+        root.pop_back();
+    }
+
+    std::vector<char> pending;
+    if (!snapshot_walk(s, root, "", encoder, &pending)) return false;
+    if (!snapshot_write_records(s, encoder, &pending, true)) return false;
+
+    msg.data.id = ID_DONE;
+    msg.data.size = 0;
+    return WriteFdExactly(s, &msg.data, sizeof(msg.data));
 }
 
 static const char* sync_id_to_name(uint32_t id) {
@@ -775,6 +1417,8 @@ static const char* sync_id_to_name(uint32_t id) {
       return "list_v1";
     case ID_LIST_V2:
       return "list_v2";
+    case ID_SNAP:
+      return "snapshot";
     case ID_SEND_V1:
         return "send_v1";
     case ID_SEND_V2:
@@ -783,6 +1427,8 @@ static const char* sync_id_to_name(uint32_t id) {
         return "recv_v1";
     case ID_RECV_V2:
         return "recv_v2";
+    case ID_CKSM:
+        return "cksm";
     case ID_QUIT:
         return "quit";
     default:
@@ -813,6 +1459,7 @@ static bool handle_sync_command(int fd, std::vector<char>& buffer) {
     std::string id_name = sync_id_to_name(request.id);
 
     D("sync: %s('%s')", id_name.c_str(), name);
+    adb_trace_ring_record(AdbTraceEvent::SyncRequestBegin, request.id);
     switch (request.id) {
         case ID_LSTAT_V1:
             if (!do_lstat_v1(fd, name)) return false;
@@ -827,6 +1474,9 @@ static bool handle_sync_command(int fd, std::vector<char>& buffer) {
         case ID_LIST_V2:
             if (!do_list_v2(fd, name)) return false;
             break;
+        case ID_SNAP:
+            if (!do_snapshot(fd, name)) return false;
+            break;
         case ID_SEND_V1:
             if (!do_send_v1(fd, name, buffer)) return false;
             break;
@@ -839,12 +1489,16 @@ static bool handle_sync_command(int fd, std::vector<char>& buffer) {
         case ID_RECV_V2:
             if (!do_recv_v2(fd, name, buffer)) return false;
             break;
+        case ID_CKSM:
+            if (!do_cksm(fd, name, buffer)) return false;
+            break;
         case ID_QUIT:
             return false;
         default:
             SendSyncFail(fd, StringPrintf("unknown command %08x", request.id));
             return false;
     }
+    adb_trace_ring_record(AdbTraceEvent::SyncRequestEnd, request.id);
 
     return true;
 }
@@ -401,12 +401,30 @@ struct JdwpTracker : public asocket {
 
 static auto& _jdwp_trackers = *new std::vector<std::unique_ptr<JdwpTracker>>();
 
-static void process_list_updated(TrackerKind kind) {
+// Attach/detach events arrive in bursts during process churn, and rebuilding
+// and re-sending the full list to every tracker for each event floods the
+// transport. Updates are coalesced instead: the first event of a burst posts
+// one flush behind whatever events are already queued on the main thread, and
+// the flush skips the broadcast entirely if the serialized list is unchanged
+// (e.g. a process that attached and died within the same burst).
+static bool _jdwp_list_dirty = false;
+static bool _app_list_dirty = false;
+static bool _process_list_update_scheduled = false;
+static auto& _last_jdwp_list_msg = *new std::string();
+static auto& _last_app_list_msg = *new std::string();
+
+static void broadcast_process_list(TrackerKind kind) {
     std::string data;
     const int kMaxLength = kind == TrackerKind::kJdwp ? 1024 : 2048;
     data.resize(kMaxLength);
     data.resize(process_list_msg(kind, &data[0], data.size()));
 
+    std::string& last = kind == TrackerKind::kJdwp ? _last_jdwp_list_msg : _last_app_list_msg;
+    if (data == last) {
+        return;
+    }
+    last = data;
+
     for (auto& t : _jdwp_trackers) {
         if (t->kind == kind && t->peer) {
             // The tracker might not have been connected yet.
@@ -416,6 +434,27 @@ static void process_list_updated(TrackerKind kind) {
     }
 }
 
+static void flush_process_list_updates() {
+    _process_list_update_scheduled = false;
+    if (_jdwp_list_dirty) {
+        _jdwp_list_dirty = false;
+        broadcast_process_list(TrackerKind::kJdwp);
+    }
+    if (_app_list_dirty) {
+        _app_list_dirty = false;
+        broadcast_process_list(TrackerKind::kApp);
+    }
+}
+
+static void process_list_updated(TrackerKind kind) {
+    (kind == TrackerKind::kJdwp ? _jdwp_list_dirty : _app_list_dirty) = true;
+    if (_process_list_update_scheduled) {
+        return;
+    }
+    _process_list_update_scheduled = true;
+    fdevent_run_on_main_thread(flush_process_list_updates);
+}
+
 static void jdwp_process_list_updated(void) {
     process_list_updated(TrackerKind::kJdwp);
 }
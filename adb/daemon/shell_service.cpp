@@ -141,6 +141,12 @@ bool CreateSocketpair(unique_fd* fd1, unique_fd* fd2) {
     return true;
 }
 
+// How many framed output bytes to accumulate before flushing to the protocol FD.
+// High-volume commands (logcat, tar to stdout) produce a flood of small pipe reads;
+// framing them into one buffer and writing it out in a single call avoids paying a
+// context switch and a protocol write per chunk.
+constexpr size_t kOutputBatchTarget = 256 * 1024;
+
 struct SubprocessPollfds {
     adb_pollfd pfds[3];
 
@@ -210,6 +216,9 @@ class Subprocess {
     std::unique_ptr<ShellProtocol> input_, output_;
     size_t input_bytes_left_ = 0;
 
+    // Reusable staging buffer for batched, pre-framed output packets.
+    std::vector<char> output_batch_;
+
     DISALLOW_COPY_AND_ASSIGN(Subprocess);
 };
 
@@ -737,24 +746,57 @@ unique_fd* Subprocess::PassInput() {
 }
 
 unique_fd* Subprocess::PassOutput(unique_fd* sfd, ShellProtocol::Id id) {
-    int bytes = adb_read(*sfd, output_->data(), output_->data_capacity());
-    if (bytes == 0 || (bytes < 0 && errno != EAGAIN)) {
-        // read() returns EIO if a PTY closes; don't report this as an error,
-        // it just means the subprocess completed.
-        if (bytes < 0 && !(type_ == SubprocessType::kPty && errno == EIO)) {
-            PLOG(ERROR) << "error reading output FD " << sfd->get();
+    // Drain the pipe instead of doing one packet-sized read per poll() wakeup.
+    // Each chunk is framed into |output_batch_| the same way ShellProtocol::Write
+    // frames it (1-byte id, 4-byte length), and the whole batch is flushed to the
+    // protocol FD with a single write.
+    constexpr size_t kHeaderSize = 1 + sizeof(uint32_t);
+    output_batch_.clear();
+
+    unique_fd* dead_sfd = nullptr;
+    while (true) {
+        int bytes = adb_read(*sfd, output_->data(), output_->data_capacity());
+        if (bytes == 0 || (bytes < 0 && errno != EAGAIN)) {
+            // read() returns EIO if a PTY closes; don't report this as an error,
+            // it just means the subprocess completed.
+            if (bytes < 0 && !(type_ == SubprocessType::kPty && errno == EIO)) {
+                PLOG(ERROR) << "error reading output FD " << sfd->get();
+            }
+            // Flush whatever was already drained before reporting the dead FD.
+            dead_sfd = sfd;
+            break;
+        } else if (bytes < 0) {
+            break;
+        }
+
+        char header[kHeaderSize];
+        header[0] = id;
+        uint32_t length = bytes;
+        memcpy(&header[1], &length, sizeof(length));
+        output_batch_.insert(output_batch_.end(), header, header + sizeof(header));
+        output_batch_.insert(output_batch_.end(), output_->data(), output_->data() + bytes);
+
+        if (output_batch_.size() >= kOutputBatchTarget) {
+            break;
+        }
+
+        // Only keep reading while there's more data immediately available; the
+        // pipe endpoints aren't necessarily non-blocking.
+        adb_pollfd pfd = {.fd = sfd->get(), .events = POLLIN, .revents = 0};
+        if (adb_poll(&pfd, 1, 0) != 1 || !(pfd.revents & POLLIN)) {
+            break;
         }
-        return sfd;
     }
 
-    if (bytes > 0 && !output_->Write(id, bytes)) {
+    if (!output_batch_.empty() &&
+        !WriteFdExactly(protocol_sfd_, output_batch_.data(), output_batch_.size())) {
         if (errno != 0) {
             PLOG(ERROR) << "error reading protocol FD " << protocol_sfd_.get();
         }
         return &protocol_sfd_;
     }
 
-    return nullptr;
+    return dead_sfd;
 }
 
 void Subprocess::WaitForExit() {
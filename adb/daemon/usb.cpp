@@ -54,14 +54,53 @@
 
 using android::base::StringPrintf;
 
-// Not all USB controllers support operations larger than 16k, so don't go above that.
-// Also, each submitted operation does an allocation in the kernel of that size, so we want to
-// minimize our queue depth while still maintaining a deep enough queue to keep the USB stack fed.
-static constexpr size_t kUsbReadQueueDepth = 8;
-static constexpr size_t kUsbReadSize = 4 * PAGE_SIZE;
+// Not all USB controllers support operations larger than 16k, so don't go above that by
+// default. Also, each submitted operation does an allocation in the kernel of that size, so we
+// want to minimize our queue depth while still maintaining a deep enough queue to keep the USB
+// stack fed.
+//
+// The defaults can be overridden per device (e.g. from init.rc for a controller that's known to
+// want a deeper queue or bigger operations), and the write queue depth additionally auto-tunes
+// at runtime from measured completion latency, between kUsbQueueDepthMin and
+// kUsbQueueDepthMax.
+static constexpr size_t kUsbDefaultQueueDepth = 8;
+static constexpr size_t kUsbDefaultIoSize = 4 * PAGE_SIZE;
+
+static constexpr size_t kUsbQueueDepthMin = 2;
+static constexpr size_t kUsbQueueDepthMax = 32;
+static constexpr size_t kUsbIoSizeMax = 256 * 1024;
+
+// Auto-tuning policy for the write queue: every kUsbTuneIntervalOps completed writes, grow the
+// queue if it saturated while completions stayed fast, shrink it if the controller is stalling.
+static constexpr size_t kUsbTuneIntervalOps = 256;
+static constexpr std::chrono::microseconds kUsbFastCompletionThreshold(2000);
+static constexpr std::chrono::microseconds kUsbSlowCompletionThreshold(20000);
+
+static size_t clamped_property(const char* prop, size_t def, size_t min, size_t max) {
+    size_t value = android::base::GetUintProperty<size_t>(prop, def);
+    return std::min(std::max(value, min), max);
+}
+
+static size_t usb_read_queue_depth() {
+    static size_t depth = clamped_property("persist.adb.usb_read_queue_depth",
+                                           kUsbDefaultQueueDepth, kUsbQueueDepthMin,
+                                           kUsbQueueDepthMax);
+    return depth;
+}
 
-static constexpr size_t kUsbWriteQueueDepth = 8;
-static constexpr size_t kUsbWriteSize = 4 * PAGE_SIZE;
+static size_t usb_write_queue_depth() {
+    static size_t depth = clamped_property("persist.adb.usb_write_queue_depth",
+                                           kUsbDefaultQueueDepth, kUsbQueueDepthMin,
+                                           kUsbQueueDepthMax);
+    return depth;
+}
+
+static size_t usb_io_size() {
+    static size_t size = clamped_property("persist.adb.usb_io_size", kUsbDefaultIoSize, PAGE_SIZE,
+                                          kUsbIoSizeMax) &
+                         ~(PAGE_SIZE - 1);
+    return size;
+}
 
 static const char* to_string(enum usb_functionfs_event_type type) {
     switch (type) {
@@ -120,6 +159,9 @@ struct IoBlock {
     struct iocb control = {};
     Payload payload;
 
+    // When the operation was handed to io_submit; used to measure completion latency.
+    std::chrono::steady_clock::time_point submit_time;
+
     TransferId id() const { return TransferId::from_value(control.aio_data); }
 };
 
@@ -177,8 +219,12 @@ struct UsbFfsConnection : public Connection {
           destruction_notifier_(std::move(destruction_notifier)),
           control_fd_(std::move(control)),
           read_fd_(std::move(read)),
-          write_fd_(std::move(write)) {
-        LOG(INFO) << "UsbFfsConnection constructed";
+          write_fd_(std::move(write)),
+          io_size_(usb_io_size()),
+          read_requests_(usb_read_queue_depth()),
+          write_queue_depth_(usb_write_queue_depth()) {
+        LOG(INFO) << "UsbFfsConnection constructed: read queue depth = " << read_requests_.size()
+                  << ", write queue depth = " << write_queue_depth_ << ", io size = " << io_size_;
         worker_event_fd_.reset(eventfd(0, EFD_CLOEXEC));
         if (worker_event_fd_ == -1) {
             PLOG(FATAL) << "failed to create eventfd";
@@ -189,11 +235,14 @@ struct UsbFfsConnection : public Connection {
             PLOG(FATAL) << "failed to create eventfd";
         }
 
-        aio_context_ = ScopedAioContext::Create(kUsbReadQueueDepth + kUsbWriteQueueDepth);
+        // The write queue can grow up to kUsbQueueDepthMax while auto-tuning, so size the
+        // context for the worst case up front.
+        aio_context_ = ScopedAioContext::Create(read_requests_.size() + kUsbQueueDepthMax);
     }
 
     ~UsbFfsConnection() {
         LOG(INFO) << "UsbFfsConnection being destroyed";
+        ReportStats();
         Stop();
         monitor_thread_.join();
 
@@ -224,7 +273,7 @@ struct UsbFfsConnection : public Connection {
             size_t len = payload->size();
 
             while (len > 0) {
-                size_t write_size = std::min(kUsbWriteSize, len);
+                size_t write_size = std::min(io_size_, len);
                 write_requests_.push_back(
                         CreateWriteBlock(payload, offset, write_size, next_write_id_++));
                 len -= write_size;
@@ -433,7 +482,7 @@ struct UsbFfsConnection : public Connection {
             adb_thread_setname("UsbFfs-worker");
             LOG(INFO) << "UsbFfs-worker thread spawned";
 
-            for (size_t i = 0; i < kUsbReadQueueDepth; ++i) {
+            for (size_t i = 0; i < read_requests_.size(); ++i) {
                 read_requests_[i] = CreateReadBlock(next_read_id_++);
                 if (!SubmitRead(&read_requests_[i])) {
                     return;
@@ -487,10 +536,10 @@ struct UsbFfsConnection : public Connection {
 
     void PrepareReadBlock(IoReadBlock* block, uint64_t id) {
         block->pending = false;
-        if (block->payload.capacity() >= kUsbReadSize) {
-            block->payload.resize(kUsbReadSize);
+        if (block->payload.capacity() >= io_size_) {
+            block->payload.resize(io_size_);
         } else {
-            block->payload = Block(kUsbReadSize);
+            block->payload = Block(io_size_);
         }
         block->control.aio_data = static_cast<uint64_t>(TransferId::read(id));
         block->control.aio_buf = reinterpret_cast<uintptr_t>(block->payload.data());
@@ -511,7 +560,7 @@ struct UsbFfsConnection : public Connection {
     }
 
     void ReadEvents() {
-        static constexpr size_t kMaxEvents = kUsbReadQueueDepth + kUsbWriteQueueDepth;
+        static constexpr size_t kMaxEvents = kUsbQueueDepthMax + kUsbQueueDepthMax;
         struct io_event events[kMaxEvents];
         struct timespec timeout = {.tv_sec = 0, .tv_nsec = 0};
         int rc = io_getevents(aio_context_.get(), 0, kMaxEvents, events, &timeout);
@@ -544,10 +593,12 @@ struct UsbFfsConnection : public Connection {
     }
 
     bool HandleRead(TransferId id, int64_t size) {
-        uint64_t read_idx = id.id % kUsbReadQueueDepth;
+        uint64_t read_idx = id.id % read_requests_.size();
         IoReadBlock* block = &read_requests_[read_idx];
         block->pending = false;
         block->payload.resize(size);
+        ++reads_completed_;
+        bytes_read_ += size;
 
         // Notification for completed reads can be received out of order.
         if (block->id().id != needed_read_id_) {
@@ -557,7 +608,7 @@ struct UsbFfsConnection : public Connection {
         }
 
         for (uint64_t id = needed_read_id_;; ++id) {
-            size_t read_idx = id % kUsbReadQueueDepth;
+            size_t read_idx = id % read_requests_.size();
             IoReadBlock* current_block = &read_requests_[read_idx];
             if (current_block->pending) {
                 break;
@@ -608,7 +659,7 @@ struct UsbFfsConnection : public Connection {
             }
         }
 
-        PrepareReadBlock(block, block->id().id + kUsbReadQueueDepth);
+        PrepareReadBlock(block, block->id().id + read_requests_.size());
         SubmitRead(block);
         return true;
     }
@@ -632,9 +683,42 @@ struct UsbFfsConnection : public Connection {
                 });
         CHECK(it != write_requests_.end());
 
+        auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - it->submit_time);
+        write_latency_ewma_us_ = write_latency_ewma_us_ == 0
+                                         ? latency.count()
+                                         : (7 * write_latency_ewma_us_ + latency.count()) / 8;
+        ++writes_completed_;
+        bytes_written_ += it->control.aio_nbytes;
+
         write_requests_.erase(it);
         size_t outstanding_writes = --writes_submitted_;
         LOG(DEBUG) << "USB write: reaped, down to " << outstanding_writes;
+
+        if (writes_completed_ % kUsbTuneIntervalOps == 0) {
+            TuneWriteQueueDepth();
+        }
+    }
+
+    // Scale the write queue depth from observed behavior: if the queue saturated over the last
+    // tuning interval while completions stayed fast, the controller can absorb more concurrent
+    // operations; if completions are slow, the controller is stalling and a shallower queue
+    // avoids piling work onto it.
+    void TuneWriteQueueDepth() REQUIRES(write_mutex_) {
+        size_t old_depth = write_queue_depth_;
+        if (write_latency_ewma_us_ >= kUsbSlowCompletionThreshold.count()) {
+            write_queue_depth_ = std::max(write_queue_depth_ / 2, kUsbQueueDepthMin);
+        } else if (write_queue_saturated_ &&
+                   write_latency_ewma_us_ <= kUsbFastCompletionThreshold.count()) {
+            write_queue_depth_ = std::min(write_queue_depth_ * 2, kUsbQueueDepthMax);
+        }
+        write_queue_saturated_ = false;
+
+        if (write_queue_depth_ != old_depth) {
+            ++depth_changes_;
+            LOG(INFO) << "USB write queue depth " << old_depth << " -> " << write_queue_depth_
+                      << " (completion latency ewma = " << write_latency_ewma_us_ << "us)";
+        }
     }
 
     IoWriteBlock CreateWriteBlock(std::shared_ptr<Block> payload, size_t offset, size_t len,
@@ -660,21 +744,28 @@ struct UsbFfsConnection : public Connection {
     }
 
     void SubmitWrites() REQUIRES(write_mutex_) {
-        if (writes_submitted_ == kUsbWriteQueueDepth) {
+        if (writes_submitted_ >= write_queue_depth_) {
+            write_queue_saturated_ = true;
             return;
         }
 
-        ssize_t writes_to_submit = std::min(kUsbWriteQueueDepth - writes_submitted_,
+        ssize_t writes_to_submit = std::min(write_queue_depth_ - writes_submitted_,
                                             write_requests_.size() - writes_submitted_);
         CHECK_GE(writes_to_submit, 0);
         if (writes_to_submit == 0) {
             return;
         }
 
-        struct iocb* iocbs[kUsbWriteQueueDepth];
+        if (write_requests_.size() - writes_submitted_ > static_cast<size_t>(writes_to_submit)) {
+            write_queue_saturated_ = true;
+        }
+
+        struct iocb* iocbs[kUsbQueueDepthMax];
+        auto now = std::chrono::steady_clock::now();
         for (int i = 0; i < writes_to_submit; ++i) {
             CHECK(!write_requests_[writes_submitted_ + i].pending);
             write_requests_[writes_submitted_ + i].pending = true;
+            write_requests_[writes_submitted_ + i].submit_time = now;
             iocbs[i] = &write_requests_[writes_submitted_ + i].control;
             LOG(VERBOSE) << "submitting write_request " << static_cast<void*>(iocbs[i]);
         }
@@ -691,6 +782,19 @@ struct UsbFfsConnection : public Connection {
         }
     }
 
+    // Publish I/O statistics so they can be inspected on device (`getprop service.adb.usb.stats`)
+    // without digging through logs.
+    void ReportStats() {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        std::string stats = StringPrintf(
+                "reads=%" PRIu64 " read_bytes=%" PRIu64 " writes=%" PRIu64 " write_bytes=%" PRIu64
+                " write_depth=%zu write_latency_us=%" PRIu64 " depth_changes=%" PRIu64,
+                reads_completed_, bytes_read_, writes_completed_, bytes_written_,
+                write_queue_depth_, write_latency_ewma_us_, depth_changes_);
+        LOG(INFO) << "UsbFfs stats: " << stats;
+        android::base::SetProperty("service.adb.usb.stats", stats);
+    }
+
     void HandleError(const std::string& error) {
         std::call_once(error_flag_, [&]() {
             error_callback_(this, error);
@@ -720,7 +824,9 @@ struct UsbFfsConnection : public Connection {
     std::optional<amessage> incoming_header_;
     IOVector incoming_payload_;
 
-    std::array<IoReadBlock, kUsbReadQueueDepth> read_requests_;
+    const size_t io_size_;
+
+    std::vector<IoReadBlock> read_requests_;
     IOVector read_data_;
 
     // ID of the next request that we're going to send out.
@@ -729,11 +835,23 @@ struct UsbFfsConnection : public Connection {
     // ID of the next packet we're waiting for.
     size_t needed_read_id_ = 0;
 
+    // Only touched on the worker thread.
+    uint64_t reads_completed_ = 0;
+    uint64_t bytes_read_ = 0;
+
     std::mutex write_mutex_;
     std::deque<IoWriteBlock> write_requests_ GUARDED_BY(write_mutex_);
     size_t next_write_id_ GUARDED_BY(write_mutex_) = 0;
     size_t writes_submitted_ GUARDED_BY(write_mutex_) = 0;
 
+    // Auto-tuning state for the write queue.
+    size_t write_queue_depth_ GUARDED_BY(write_mutex_);
+    bool write_queue_saturated_ GUARDED_BY(write_mutex_) = false;
+    uint64_t write_latency_ewma_us_ GUARDED_BY(write_mutex_) = 0;
+    uint64_t writes_completed_ GUARDED_BY(write_mutex_) = 0;
+    uint64_t bytes_written_ GUARDED_BY(write_mutex_) = 0;
+    uint64_t depth_changes_ GUARDED_BY(write_mutex_) = 0;
+
     static constexpr int kInterruptionSignal = SIGUSR1;
 };
 
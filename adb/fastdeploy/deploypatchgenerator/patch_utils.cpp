@@ -18,6 +18,11 @@
 
 #include <stdio.h>
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
 #include "adb_io.h"
 #include "adb_utils.h"
 #include "android-base/endian.h"
@@ -65,14 +70,46 @@ APKMetaData PatchUtils::GetHostAPKMetaData(const char* apkPath) {
 
     auto apkMetaData = GetDeviceAPKMetaData(dump);
 
-    // Now let's set data sizes.
-    for (auto& apkEntry : *apkMetaData.mutable_entries()) {
-        auto dataSize =
-                archive.CalculateLocalFileEntrySize(apkEntry.dataoffset(), apkEntry.datasize());
-        if (dataSize == 0) {
-            error_exit("Aborting");
+    // Now let's set data sizes. Each entry probes its local file header independently,
+    // and on large APKs those thousands of probes dominate patch setup while the device
+    // sits idle, so fan the fixup out across threads.
+    auto* entries = apkMetaData.mutable_entries();
+    const int entryCount = entries->size();
+    size_t threadCount = std::thread::hardware_concurrency();
+    if (threadCount == 0) {
+        threadCount = 4;
+    }
+    threadCount = std::min<size_t>({threadCount, 8, static_cast<size_t>(entryCount)});
+
+    std::atomic<int> nextEntry(0);
+    std::atomic<bool> failed(false);
+    auto worker = [&]() {
+        for (int i = nextEntry.fetch_add(1); i < entryCount && !failed;
+             i = nextEntry.fetch_add(1)) {
+            auto& apkEntry = *entries->Mutable(i);
+            auto dataSize =
+                    archive.CalculateLocalFileEntrySize(apkEntry.dataoffset(), apkEntry.datasize());
+            if (dataSize == 0) {
+                failed = true;
+                return;
+            }
+            apkEntry.set_datasize(dataSize);
+        }
+    };
+
+    if (threadCount <= 1) {
+        worker();
+    } else {
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < threadCount; ++i) {
+            threads.emplace_back(worker);
         }
-        apkEntry.set_datasize(dataSize);
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+    if (failed) {
+        error_exit("Aborting");
     }
 
     return apkMetaData;
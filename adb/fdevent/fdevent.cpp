@@ -19,14 +19,18 @@
 #include "sysdeps.h"
 
 #include <inttypes.h>
+#include <string.h>
 
 #include <android-base/logging.h>
 #include <android-base/stringprintf.h>
 #include <android-base/threads.h>
 
+#include "adb_trace_ring.h"
 #include "adb_utils.h"
 #include "fdevent.h"
 #include "fdevent_epoll.h"
+#include "fdevent_uring.h"
+#include "fdevent_win32.h"
 
 #if !defined(__linux__)
 #include "fdevent_poll.h"
@@ -60,6 +64,22 @@ std::string dump_fde(const fdevent* fde) {
                                        state.c_str());
 }
 
+fdevent_context::fdevent_context() {
+    auto* stub = new RunQueueNode(nullptr);
+    run_queue_head_.store(stub, std::memory_order_relaxed);
+    run_queue_tail_ = stub;
+}
+
+fdevent_context::~fdevent_context() {
+    // Nothing can be posting anymore; reclaim the stub and any unrun functions.
+    RunQueueNode* node = run_queue_tail_;
+    while (node) {
+        RunQueueNode* next = node->next.load(std::memory_order_relaxed);
+        delete node;
+        node = next;
+    }
+}
+
 fdevent* fdevent_context::Create(unique_fd fd, std::variant<fd_func, fd_func2> func, void* arg) {
     CheckMainThread();
     CHECK_GE(fd.get(), 0);
@@ -145,6 +165,7 @@ std::optional<std::chrono::milliseconds> fdevent_context::CalculatePollDuration(
 }
 
 void fdevent_context::HandleEvents(const std::vector<fdevent_event>& events) {
+    adb_trace_ring_record(AdbTraceEvent::FdeventWakeup, events.size());
     for (const auto& event : events) {
         invoke_fde(event.fde, event.events);
     }
@@ -152,18 +173,23 @@ void fdevent_context::HandleEvents(const std::vector<fdevent_event>& events) {
 }
 
 void fdevent_context::FlushRunQueue() {
+    // Clear the wakeup flag before draining. The exchange synchronizes with the
+    // producer that set it, and anything posted after the clear either gets
+    // picked up by the loop below or re-interrupts the poll.
+    run_queue_notified_.exchange(false, std::memory_order_acq_rel);
+
     // We need to be careful around reentrancy here, since a function we call can queue up another
-    // function.
+    // function. Functions posted from the main thread itself are fully linked by the time they're
+    // pushed, so the loop picks them up in the same flush.
     while (true) {
-        std::function<void()> fn;
-        {
-            std::lock_guard<std::mutex> lock(this->run_queue_mutex_);
-            if (this->run_queue_.empty()) {
-                break;
-            }
-            fn = std::move(this->run_queue_.front());
-            this->run_queue_.pop_front();
+        RunQueueNode* next = run_queue_tail_->next.load(std::memory_order_acquire);
+        if (!next) {
+            // Either the queue is drained, or a producer has swung run_queue_head_ but not yet
+            // linked its node; it will interrupt the loop once it has, and we'll get it then.
+            break;
         }
+        delete std::exchange(run_queue_tail_, next);
+        std::function<void()> fn = std::move(next->fn);
         fn();
     }
 }
@@ -175,12 +201,15 @@ void fdevent_context::CheckMainThread() {
 }
 
 void fdevent_context::Run(std::function<void()> fn) {
-    {
-        std::lock_guard<std::mutex> lock(run_queue_mutex_);
-        run_queue_.push_back(std::move(fn));
+    auto* node = new RunQueueNode(std::move(fn));
+    RunQueueNode* prev = run_queue_head_.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+
+    // Batch wakeups: only the post that finds the flag clear pays for the
+    // interrupt fd write, the rest of a burst piggybacks on it.
+    if (!run_queue_notified_.exchange(true, std::memory_order_acq_rel)) {
+        Interrupt();
     }
-
-    Interrupt();
 }
 
 void fdevent_context::TerminateLoop() {
@@ -190,8 +219,24 @@ void fdevent_context::TerminateLoop() {
 
 static std::unique_ptr<fdevent_context> fdevent_create_context() {
 #if defined(__linux__)
+#if defined(ADB_FDEVENT_URING)
+    if (const char* backend = getenv("ADB_FDEVENT_BACKEND"); backend && !strcmp(backend, "uring")) {
+        if (auto context = fdevent_context_uring::TryCreate()) {
+            return context;
+        }
+        LOG(WARNING) << "kernel doesn't support io_uring, falling back to epoll";
+    }
+#endif
     return std::make_unique<fdevent_context_epoll>();
 #else
+#if defined(ADB_FDEVENT_WIN32)
+    if (const char* backend = getenv("ADB_FDEVENT_BACKEND"); backend && !strcmp(backend, "iocp")) {
+        if (auto context = fdevent_context_win32::TryCreate()) {
+            return context;
+        }
+        LOG(WARNING) << "AFD poll unavailable, falling back to WSAPoll";
+    }
+#endif
     return std::make_unique<fdevent_context_poll>();
 #endif
 }
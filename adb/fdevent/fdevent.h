@@ -22,15 +22,11 @@
 
 #include <atomic>
 #include <chrono>
-#include <deque>
 #include <functional>
-#include <mutex>
 #include <optional>
 #include <unordered_map>
 #include <variant>
 
-#include <android-base/thread_annotations.h>
-
 #include "adb_unique_fd.h"
 
 // Events that may be observed
@@ -68,7 +64,8 @@ struct fdevent final {
 
 struct fdevent_context {
   public:
-    virtual ~fdevent_context() = default;
+    fdevent_context();
+    virtual ~fdevent_context();
 
     // Allocate and initialize a new fdevent object.
     fdevent* Create(unique_fd fd, std::variant<fd_func, fd_func2> func, void* arg);
@@ -99,8 +96,9 @@ struct fdevent_context {
     void HandleEvents(const std::vector<fdevent_event>& events);
 
   private:
-    // Run all pending functions enqueued via Run().
-    void FlushRunQueue() EXCLUDES(run_queue_mutex_);
+    // Run all pending functions enqueued via Run(). Must only be called from
+    // the main thread; it is the queue's single consumer.
+    void FlushRunQueue();
 
   public:
     // Loop until TerminateLoop is called, handling events.
@@ -131,8 +129,23 @@ struct fdevent_context {
 
   private:
     uint64_t fdevent_id_ = 0;
-    std::mutex run_queue_mutex_;
-    std::deque<std::function<void()>> run_queue_ GUARDED_BY(run_queue_mutex_);
+
+    // Lock-free MPSC run queue (a Vyukov-style intrusive list): producers push
+    // with two wait-free atomic operations, and only the main thread consumes.
+    // run_queue_tail_ points at the last consumed node (initially a stub), so
+    // the list is never empty and pushes never race with node reclamation.
+    struct RunQueueNode {
+        explicit RunQueueNode(std::function<void()> fn) : fn(std::move(fn)) {}
+        std::function<void()> fn;
+        std::atomic<RunQueueNode*> next = nullptr;
+    };
+
+    std::atomic<RunQueueNode*> run_queue_head_;
+    RunQueueNode* run_queue_tail_;
+
+    // Set by the first producer after an idle period, cleared by the consumer
+    // before draining, so a burst of posts triggers a single Interrupt().
+    std::atomic<bool> run_queue_notified_ = false;
 };
 
 // Backwards compatibility shims that forward to the global fdevent_context.
@@ -0,0 +1,350 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fdevent_uring.h"
+
+#if defined(ADB_FDEVENT_URING)
+
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <android-base/logging.h>
+#include <android-base/threads.h>
+
+#include "adb_unique_fd.h"
+#include "fdevent.h"
+
+// user_data values that don't correspond to an armed poll.
+static constexpr uint64_t kUserDataTimeout = UINT64_MAX;
+static constexpr uint64_t kUserDataPollRemove = UINT64_MAX - 1;
+
+static constexpr unsigned kRingEntries = 256;
+
+static int sys_io_uring_setup(unsigned entries, io_uring_params* p) {
+    return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+}
+
+static void fdevent_interrupt(int fd, unsigned, void*) {
+    uint64_t buf;
+    ssize_t rc = TEMP_FAILURE_RETRY(adb_read(fd, &buf, sizeof(buf)));
+    if (rc == -1) {
+        PLOG(FATAL) << "failed to read from fdevent interrupt fd";
+    }
+}
+
+std::unique_ptr<fdevent_context_uring> fdevent_context_uring::TryCreate() {
+    io_uring_params params = {};
+    unique_fd ring_fd(sys_io_uring_setup(kRingEntries, &params));
+    if (ring_fd == -1) {
+        return nullptr;
+    }
+    return std::unique_ptr<fdevent_context_uring>(
+            new fdevent_context_uring(std::move(ring_fd), params));
+}
+
+fdevent_context_uring::fdevent_context_uring(unique_fd ring_fd, const io_uring_params& params)
+    : ring_fd_(std::move(ring_fd)) {
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    single_mmap_ = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap_) {
+        sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    ring_fd_.get(), IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+        PLOG(FATAL) << "failed to mmap io_uring sq ring";
+    }
+
+    if (single_mmap_) {
+        cq_ring_ = sq_ring_;
+    } else {
+        cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring_fd_.get(), IORING_OFF_CQ_RING);
+        if (cq_ring_ == MAP_FAILED) {
+            PLOG(FATAL) << "failed to mmap io_uring cq ring";
+        }
+    }
+
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe*>(mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                                            MAP_SHARED | MAP_POPULATE, ring_fd_.get(),
+                                            IORING_OFF_SQES));
+    if (sqes_ == MAP_FAILED) {
+        PLOG(FATAL) << "failed to mmap io_uring sqes";
+    }
+
+    char* sq = static_cast<char*>(sq_ring_);
+    sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_entries_ = params.sq_entries;
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+    char* cq = static_cast<char*>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    unique_fd interrupt_fd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK));
+    if (interrupt_fd == -1) {
+        PLOG(FATAL) << "failed to create fdevent interrupt eventfd";
+    }
+
+    unique_fd interrupt_fd_dup(fcntl(interrupt_fd.get(), F_DUPFD_CLOEXEC, 3));
+    if (interrupt_fd_dup == -1) {
+        PLOG(FATAL) << "failed to dup fdevent interrupt eventfd";
+    }
+
+    this->interrupt_fd_ = std::move(interrupt_fd_dup);
+    fdevent* fde = this->Create(std::move(interrupt_fd), fdevent_interrupt, nullptr);
+    CHECK(fde != nullptr);
+    this->Add(fde, FDE_READ);
+}
+
+fdevent_context_uring::~fdevent_context_uring() {
+    // Destroy calls virtual methods, but this class is final, so that's okay.
+    this->Destroy(this->interrupt_fde_);
+
+    munmap(sqes_, sqes_size_);
+    munmap(sq_ring_, sq_ring_size_);
+    if (!single_mmap_) {
+        munmap(cq_ring_, cq_ring_size_);
+    }
+}
+
+io_uring_sqe* fdevent_context_uring::GetSqe() {
+    unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    unsigned tail = *sq_tail_;
+    if (tail - head >= sq_entries_) {
+        // The submission ring is full: flush what we have to make room.
+        Enter(0);
+        head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        tail = *sq_tail_;
+        CHECK_LT(tail - head, sq_entries_);
+    }
+
+    unsigned index = tail & sq_mask_;
+    io_uring_sqe* sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    ++to_submit_;
+    return sqe;
+}
+
+void fdevent_context_uring::Enter(unsigned min_complete) {
+    unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+    int rc = TEMP_FAILURE_RETRY(
+            sys_io_uring_enter(ring_fd_.get(), to_submit_, min_complete, flags));
+    if (rc < 0) {
+        PLOG(FATAL) << "io_uring_enter failed";
+    }
+    to_submit_ -= rc;
+}
+
+static unsigned short calculate_poll_events(fdevent* fde) {
+    unsigned short poll_events = 0;
+    if (fde->state & FDE_READ) {
+        poll_events |= POLLIN;
+    }
+    if (fde->state & FDE_WRITE) {
+        poll_events |= POLLOUT;
+    }
+    if (fde->state & FDE_ERROR) {
+        poll_events |= POLLERR;
+    }
+    poll_events |= POLLRDHUP;
+    return poll_events;
+}
+
+void fdevent_context_uring::ArmPoll(fdevent* fde) {
+    io_uring_sqe* sqe = GetSqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fde->fd.get();
+    sqe->poll_events = calculate_poll_events(fde);
+    sqe->user_data = fde->id;
+    armed_[fde->id] = fde;
+}
+
+void fdevent_context_uring::SubmitPollRemove(uint64_t id) {
+    io_uring_sqe* sqe = GetSqe();
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = id;
+    sqe->user_data = kUserDataPollRemove;
+}
+
+void fdevent_context_uring::Register(fdevent*) {
+    // Polls are armed lazily by Loop.
+}
+
+void fdevent_context_uring::Unregister(fdevent* fde) {
+    if (auto it = armed_.find(fde->id); it != armed_.end()) {
+        SubmitPollRemove(fde->id);
+        armed_.erase(it);
+    }
+}
+
+void fdevent_context_uring::Set(fdevent* fde, unsigned events) {
+    unsigned previous_state = fde->state;
+    fde->state = events;
+
+    // If the state is the same, or only differed by FDE_TIMEOUT, the armed poll is still valid.
+    if ((previous_state & ~FDE_TIMEOUT) == (events & ~FDE_TIMEOUT)) {
+        return;
+    }
+
+    // Cancel any outstanding poll; Loop will re-arm with the new mask.
+    if (auto it = armed_.find(fde->id); it != armed_.end()) {
+        SubmitPollRemove(fde->id);
+        armed_.erase(it);
+    }
+}
+
+void fdevent_context_uring::Loop() {
+    main_thread_id_ = android::base::GetThreadId();
+
+    std::vector<fdevent_event> fde_events;
+
+    while (true) {
+        if (terminate_loop_) {
+            break;
+        }
+
+        // Arm a one-shot poll for every fdevent that wants events and doesn't
+        // have one in flight. All of the arms are submitted in a single
+        // io_uring_enter below.
+        for (auto& [fd, fde] : installed_fdevents_) {
+            if ((fde.state & (FDE_READ | FDE_WRITE | FDE_ERROR)) != 0 &&
+                armed_.find(fde.id) == armed_.end()) {
+                ArmPoll(&fde);
+            }
+        }
+
+        __kernel_timespec ts;
+        if (std::optional<std::chrono::milliseconds> timeout = CalculatePollDuration(); timeout) {
+            ts.tv_sec = timeout->count() / 1000;
+            ts.tv_nsec = (timeout->count() % 1000) * 1000000;
+            io_uring_sqe* sqe = GetSqe();
+            sqe->opcode = IORING_OP_TIMEOUT;
+            sqe->fd = -1;
+            sqe->addr = reinterpret_cast<uint64_t>(&ts);
+            sqe->len = 1;
+            sqe->user_data = kUserDataTimeout;
+        }
+
+        Enter(1);
+
+        auto post_poll = std::chrono::steady_clock::now();
+        std::unordered_map<fdevent*, unsigned> event_map;
+
+        unsigned head = *cq_head_;
+        unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head) {
+            io_uring_cqe* cqe = &cqes_[head & cq_mask_];
+            if (cqe->user_data == kUserDataTimeout || cqe->user_data == kUserDataPollRemove) {
+                continue;
+            }
+
+            auto it = armed_.find(cqe->user_data);
+            if (it == armed_.end()) {
+                // The fdevent was destroyed or re-armed while this poll was in flight.
+                continue;
+            }
+            fdevent* fde = it->second;
+            armed_.erase(it);
+
+            if (cqe->res < 0) {
+                // ECANCELED from a poll remove that raced with readiness; drop it, the
+                // next iteration re-arms.
+                continue;
+            }
+
+            unsigned events = 0;
+            if ((cqe->res & POLLIN) && (fde->state & FDE_READ)) {
+                events |= FDE_READ;
+            }
+            if ((cqe->res & POLLOUT) && (fde->state & FDE_WRITE)) {
+                events |= FDE_WRITE;
+            }
+            if (cqe->res & (POLLERR | POLLHUP | POLLRDHUP | POLLNVAL)) {
+                // We fake a read, as the rest of the code assumes that errors will
+                // be detected at that point.
+                events |= FDE_READ | FDE_ERROR;
+            }
+
+            if (events != 0) {
+                event_map[fde] = events;
+            }
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+
+        for (auto& [fd, fde] : installed_fdevents_) {
+            unsigned events = 0;
+            if (auto it = event_map.find(&fde); it != event_map.end()) {
+                events = it->second;
+            }
+
+            if (events == 0) {
+                if (fde.timeout) {
+                    auto deadline = fde.last_active + *fde.timeout;
+                    if (deadline < post_poll) {
+                        events |= FDE_TIMEOUT;
+                    }
+                }
+            }
+
+            if (events != 0) {
+                LOG(DEBUG) << dump_fde(&fde) << " got events " << std::hex << std::showbase
+                           << events;
+                fde_events.push_back({&fde, events});
+                fde.last_active = post_poll;
+            }
+        }
+        this->HandleEvents(fde_events);
+        fde_events.clear();
+    }
+
+    main_thread_id_.reset();
+}
+
+size_t fdevent_context_uring::InstalledCount() {
+    // We always have an installed fde for interrupt.
+    return this->installed_fdevents_.size() - 1;
+}
+
+void fdevent_context_uring::Interrupt() {
+    uint64_t i = 1;
+    ssize_t rc = TEMP_FAILURE_RETRY(adb_write(this->interrupt_fd_, &i, sizeof(i)));
+    if (rc != sizeof(i)) {
+        PLOG(FATAL) << "failed to write to fdevent interrupt eventfd";
+    }
+}
+
+#endif  // defined(ADB_FDEVENT_URING)
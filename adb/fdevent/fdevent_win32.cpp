@@ -0,0 +1,382 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fdevent_win32.h"
+
+#if defined(ADB_FDEVENT_WIN32)
+
+#include <winternl.h>
+
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+
+#include <android-base/logging.h>
+#include <android-base/threads.h>
+
+#include "adb_unique_fd.h"
+#include "fdevent.h"
+
+// The AFD poll interface is not in the SDK headers, but it is stable ABI: it
+// is what select/WSAPoll are built on, and wepoll/libuv ship against it.
+#define IOCTL_AFD_POLL 0x00012024
+
+#define AFD_POLL_RECEIVE 0x0001
+#define AFD_POLL_RECEIVE_EXPEDITED 0x0002
+#define AFD_POLL_SEND 0x0004
+#define AFD_POLL_DISCONNECT 0x0008
+#define AFD_POLL_ABORT 0x0010
+#define AFD_POLL_LOCAL_CLOSE 0x0020
+#define AFD_POLL_ACCEPT 0x0080
+#define AFD_POLL_CONNECT_FAIL 0x0100
+
+struct AFD_POLL_HANDLE_INFO {
+    HANDLE Handle;
+    ULONG Events;
+    NTSTATUS Status;
+};
+
+struct AFD_POLL_INFO {
+    LARGE_INTEGER Timeout;
+    ULONG NumberOfHandles;
+    ULONG Exclusive;
+    AFD_POLL_HANDLE_INFO Handles[1];
+};
+
+#ifndef FILE_OPEN
+#define FILE_OPEN 0x00000001UL
+#endif
+
+#ifndef STATUS_SUCCESS
+#define STATUS_SUCCESS ((NTSTATUS)0x00000000L)
+#endif
+
+#ifndef STATUS_PENDING
+#define STATUS_PENDING ((NTSTATUS)0x00000103L)
+#endif
+
+#ifndef SIO_BASE_HANDLE
+#define SIO_BASE_HANDLE _WSAIOR(IOC_WS2, 34)
+#endif
+
+// Resolved from ntdll at runtime so we don't need to link against it.
+typedef NTSTATUS(NTAPI* NtCreateFile_t)(PHANDLE, ACCESS_MASK, POBJECT_ATTRIBUTES, PIO_STATUS_BLOCK,
+                                        PLARGE_INTEGER, ULONG, ULONG, ULONG, ULONG, PVOID, ULONG);
+typedef NTSTATUS(NTAPI* NtDeviceIoControlFile_t)(HANDLE, HANDLE, PIO_APC_ROUTINE, PVOID,
+                                                 PIO_STATUS_BLOCK, ULONG, PVOID, ULONG, PVOID,
+                                                 ULONG);
+typedef NTSTATUS(NTAPI* NtCancelIoFileEx_t)(HANDLE, PIO_STATUS_BLOCK, PIO_STATUS_BLOCK);
+
+static NtCreateFile_t Nt_CreateFile;
+static NtDeviceIoControlFile_t Nt_DeviceIoControlFile;
+static NtCancelIoFileEx_t Nt_CancelIoFileEx;
+
+static bool ResolveNtFunctions() {
+    HMODULE ntdll = GetModuleHandleW(L"ntdll.dll");
+    if (!ntdll) {
+        return false;
+    }
+    Nt_CreateFile = reinterpret_cast<NtCreateFile_t>(GetProcAddress(ntdll, "NtCreateFile"));
+    Nt_DeviceIoControlFile = reinterpret_cast<NtDeviceIoControlFile_t>(
+            GetProcAddress(ntdll, "NtDeviceIoControlFile"));
+    Nt_CancelIoFileEx =
+            reinterpret_cast<NtCancelIoFileEx_t>(GetProcAddress(ntdll, "NtCancelIoFileEx"));
+    return Nt_CreateFile && Nt_DeviceIoControlFile && Nt_CancelIoFileEx;
+}
+
+// AFD polls the base provider socket, not whatever an LSP may have layered on
+// top of the handle we got from the FH table.
+static HANDLE GetBaseSocketHandle(borrowed_fd fd) {
+    SOCKET s = static_cast<SOCKET>(adb_get_os_handle(fd));
+    SOCKET base = INVALID_SOCKET;
+    DWORD bytes = 0;
+    if (WSAIoctl(s, SIO_BASE_HANDLE, nullptr, 0, &base, sizeof(base), &bytes, nullptr, nullptr) !=
+        0) {
+        base = s;
+    }
+    return reinterpret_cast<HANDLE>(base);
+}
+
+struct fdevent_context_win32::PollRequest {
+    IO_STATUS_BLOCK iosb;
+    AFD_POLL_INFO info;
+    fdevent* fde;
+    uint64_t fde_id;
+};
+
+std::unique_ptr<fdevent_context_win32> fdevent_context_win32::TryCreate() {
+    if (!ResolveNtFunctions()) {
+        return nullptr;
+    }
+
+    HANDLE iocp = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+    if (!iocp) {
+        return nullptr;
+    }
+
+    // Open our own handle to the AFD driver to issue poll ioctls against; the
+    // path suffix after \Device\Afd\ is arbitrary and only shows up in tools.
+    static wchar_t device_path[] = L"\\Device\\Afd\\Adb";
+    UNICODE_STRING name;
+    name.Buffer = device_path;
+    name.Length = sizeof(device_path) - sizeof(wchar_t);
+    name.MaximumLength = sizeof(device_path);
+    OBJECT_ATTRIBUTES attributes = {sizeof(OBJECT_ATTRIBUTES), nullptr, &name, 0, nullptr, nullptr};
+    IO_STATUS_BLOCK iosb = {};
+    HANDLE afd_device = nullptr;
+    NTSTATUS status = Nt_CreateFile(&afd_device, SYNCHRONIZE, &attributes, &iosb, nullptr, 0,
+                                    FILE_SHARE_READ | FILE_SHARE_WRITE, FILE_OPEN, 0, nullptr, 0);
+    if (status != STATUS_SUCCESS) {
+        CloseHandle(iocp);
+        return nullptr;
+    }
+
+    if (CreateIoCompletionPort(afd_device, iocp, 0, 0) == nullptr) {
+        CloseHandle(afd_device);
+        CloseHandle(iocp);
+        return nullptr;
+    }
+    SetFileCompletionNotificationModes(afd_device, FILE_SKIP_SET_EVENT_ON_HANDLE);
+
+    return std::unique_ptr<fdevent_context_win32>(new fdevent_context_win32(iocp, afd_device));
+}
+
+fdevent_context_win32::fdevent_context_win32(HANDLE iocp, HANDLE afd_device)
+    : iocp_(iocp), afd_device_(afd_device) {}
+
+fdevent_context_win32::~fdevent_context_win32() {
+    // Closing the device handle cancels the in-flight polls; drain their
+    // completions so the kernel is done writing into the requests before the
+    // pending_ map frees them.
+    CloseHandle(afd_device_);
+    std::vector<OVERLAPPED_ENTRY> entries(64);
+    while (!pending_.empty()) {
+        ULONG num_entries = 0;
+        if (!GetQueuedCompletionStatusEx(iocp_, entries.data(), entries.size(), &num_entries, 100,
+                                         FALSE)) {
+            break;
+        }
+        for (ULONG i = 0; i < num_entries; ++i) {
+            if (entries[i].lpOverlapped) {
+                pending_.erase(reinterpret_cast<PollRequest*>(entries[i].lpOverlapped));
+            }
+        }
+    }
+    CloseHandle(iocp_);
+}
+
+static ULONG calculate_afd_events(unsigned state) {
+    ULONG events = 0;
+    if (state & FDE_READ) {
+        events |= AFD_POLL_RECEIVE | AFD_POLL_ACCEPT | AFD_POLL_DISCONNECT;
+    }
+    if (state & FDE_WRITE) {
+        events |= AFD_POLL_SEND;
+    }
+    // Always watch for errors; like the other backends, they're surfaced as reads.
+    events |= AFD_POLL_ABORT | AFD_POLL_CONNECT_FAIL | AFD_POLL_LOCAL_CLOSE;
+    return events;
+}
+
+void fdevent_context_win32::ArmPoll(fdevent* fde) {
+    auto req = std::make_unique<PollRequest>();
+    memset(&req->iosb, 0, sizeof(req->iosb));
+    req->fde = fde;
+    req->fde_id = fde->id;
+    req->info.Timeout.QuadPart = INT64_MAX;
+    req->info.NumberOfHandles = 1;
+    req->info.Exclusive = FALSE;
+    req->info.Handles[0].Handle = GetBaseSocketHandle(fde->fd);
+    req->info.Handles[0].Events = calculate_afd_events(fde->state);
+    req->info.Handles[0].Status = 0;
+
+    // The request pointer doubles as the completion key: the ApcContext comes
+    // back as the lpOverlapped of the completion packet.
+    NTSTATUS status =
+            Nt_DeviceIoControlFile(afd_device_, nullptr, nullptr, req.get(), &req->iosb,
+                                   IOCTL_AFD_POLL, &req->info, sizeof(req->info), &req->info,
+                                   sizeof(req->info));
+    if (status != STATUS_SUCCESS && status != STATUS_PENDING) {
+        LOG(FATAL) << "IOCTL_AFD_POLL failed for " << dump_fde(fde) << ": " << std::hex << status;
+    }
+
+    armed_[fde->id] = req.get();
+    pending_[req.get()] = std::move(req);
+}
+
+void fdevent_context_win32::CancelPoll(fdevent* fde) {
+    auto it = armed_.find(fde->id);
+    if (it == armed_.end()) {
+        return;
+    }
+    PollRequest* req = it->second;
+    armed_.erase(it);
+
+    // The request stays in pending_ until its (cancelled) completion arrives.
+    IO_STATUS_BLOCK cancel_iosb;
+    Nt_CancelIoFileEx(afd_device_, &req->iosb, &cancel_iosb);
+}
+
+void fdevent_context_win32::Register(fdevent*) {
+    // Polls are armed lazily by Loop.
+}
+
+void fdevent_context_win32::Unregister(fdevent* fde) {
+    CancelPoll(fde);
+}
+
+void fdevent_context_win32::Set(fdevent* fde, unsigned events) {
+    unsigned previous_state = fde->state;
+    fde->state = events;
+
+    // If the state is the same, or only differed by FDE_TIMEOUT, the armed poll is still valid.
+    if ((previous_state & ~FDE_TIMEOUT) == (events & ~FDE_TIMEOUT)) {
+        return;
+    }
+
+    // Cancel any outstanding poll; Loop will re-arm with the new mask.
+    CancelPoll(fde);
+}
+
+void fdevent_context_win32::Loop() {
+    main_thread_id_ = android::base::GetThreadId();
+
+    std::vector<fdevent_event> fde_events;
+    std::vector<OVERLAPPED_ENTRY> entries(64);
+
+    while (true) {
+        if (terminate_loop_) {
+            break;
+        }
+
+        // Arm a one-shot poll for every fdevent that wants events and doesn't
+        // have one in flight.
+        for (auto& [fd, fde] : installed_fdevents_) {
+            if ((fde.state & (FDE_READ | FDE_WRITE | FDE_ERROR)) != 0 &&
+                armed_.find(fde.id) == armed_.end()) {
+                ArmPoll(&fde);
+            }
+        }
+
+        DWORD timeout_ms = INFINITE;
+        if (std::optional<std::chrono::milliseconds> timeout = CalculatePollDuration(); timeout) {
+            timeout_ms = timeout->count();
+        }
+
+        ULONG num_entries = 0;
+        if (!GetQueuedCompletionStatusEx(iocp_, entries.data(), entries.size(), &num_entries,
+                                         timeout_ms, FALSE)) {
+            if (GetLastError() != WAIT_TIMEOUT) {
+                LOG(FATAL) << "GetQueuedCompletionStatusEx failed: " << GetLastError();
+            }
+            num_entries = 0;
+        }
+
+        auto post_poll = std::chrono::steady_clock::now();
+        std::unordered_map<fdevent*, unsigned> event_map;
+
+        for (ULONG i = 0; i < num_entries; ++i) {
+            if (entries[i].lpOverlapped == nullptr) {
+                // Wakeup posted by Interrupt().
+                continue;
+            }
+
+            PollRequest* req = reinterpret_cast<PollRequest*>(entries[i].lpOverlapped);
+            auto pending_it = pending_.find(req);
+            CHECK(pending_it != pending_.end());
+            std::unique_ptr<PollRequest> owned = std::move(pending_it->second);
+            pending_.erase(pending_it);
+
+            // Drop completions for requests that are no longer the active poll
+            // for their fdevent (cancelled, or the fdevent was destroyed).
+            auto armed_it = armed_.find(req->fde_id);
+            if (armed_it == armed_.end() || armed_it->second != req) {
+                continue;
+            }
+            armed_.erase(armed_it);
+
+            if (req->iosb.Status != STATUS_SUCCESS || req->info.NumberOfHandles < 1) {
+                continue;
+            }
+
+            ULONG afd_events = req->info.Handles[0].Events;
+            if (afd_events & AFD_POLL_LOCAL_CLOSE) {
+                // The socket was closed out from under us; nothing to report.
+                continue;
+            }
+
+            fdevent* fde = req->fde;
+            unsigned events = 0;
+            if ((afd_events & (AFD_POLL_RECEIVE | AFD_POLL_ACCEPT | AFD_POLL_DISCONNECT)) &&
+                (fde->state & FDE_READ)) {
+                events |= FDE_READ;
+            }
+            if ((afd_events & AFD_POLL_SEND) && (fde->state & FDE_WRITE)) {
+                events |= FDE_WRITE;
+            }
+            if (afd_events & (AFD_POLL_ABORT | AFD_POLL_CONNECT_FAIL)) {
+                // We fake a read, as the rest of the code assumes that errors will
+                // be detected at that point.
+                events |= FDE_READ | FDE_ERROR;
+            }
+
+            if (events != 0) {
+                event_map[fde] |= events;
+            }
+        }
+
+        for (auto& [fd, fde] : installed_fdevents_) {
+            unsigned events = 0;
+            if (auto it = event_map.find(&fde); it != event_map.end()) {
+                events = it->second;
+            }
+
+            if (events == 0) {
+                if (fde.timeout) {
+                    auto deadline = fde.last_active + *fde.timeout;
+                    if (deadline < post_poll) {
+                        events |= FDE_TIMEOUT;
+                    }
+                }
+            }
+
+            if (events != 0) {
+                LOG(DEBUG) << dump_fde(&fde) << " got events " << std::hex << std::showbase
+                           << events;
+                fde_events.push_back({&fde, events});
+                fde.last_active = post_poll;
+            }
+        }
+        this->HandleEvents(fde_events);
+        fde_events.clear();
+    }
+
+    main_thread_id_.reset();
+}
+
+size_t fdevent_context_win32::InstalledCount() {
+    // Unlike the other backends, interrupts post straight to the completion
+    // port, so there's no hidden interrupt fdevent to subtract.
+    return this->installed_fdevents_.size();
+}
+
+void fdevent_context_win32::Interrupt() {
+    if (!PostQueuedCompletionStatus(iocp_, 0, 0, nullptr)) {
+        LOG(FATAL) << "failed to post interrupt to completion port: " << GetLastError();
+    }
+}
+
+#endif  // defined(ADB_FDEVENT_WIN32)
@@ -0,0 +1,80 @@
+#pragma once
+
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if defined(_WIN32)
+
+#define ADB_FDEVENT_WIN32 1
+
+#include "sysdeps.h"
+
+#include <memory>
+#include <unordered_map>
+
+#include "adb_unique_fd.h"
+#include "fdevent.h"
+
+// An fdevent_context implemented on an I/O completion port.
+//
+// Readiness is tracked with one-shot AFD poll ioctls issued overlapped against
+// the \Device\Afd driver (the mechanism underneath select/WSAPoll, used the
+// same way by libuv's wepoll): every loop iteration arms polls for all
+// fdevents that want events and aren't already armed, then reaps every ready
+// socket with a single GetQueuedCompletionStatusEx call instead of one WSAPoll
+// scan over the whole fd set. Only readiness crosses the port - reads and
+// writes still go through the regular non-blocking sysdeps paths, so no data
+// is staged in backend-owned buffers. Interrupts are posted straight to the
+// port, which also saves the self-pipe socketpair the poll backend needs.
+struct fdevent_context_win32 final : public fdevent_context {
+    // Returns nullptr if the AFD device or ntdll's Nt* entry points are unavailable.
+    static std::unique_ptr<fdevent_context_win32> TryCreate();
+
+    virtual ~fdevent_context_win32();
+
+    virtual void Register(fdevent* fde) final;
+    virtual void Unregister(fdevent* fde) final;
+
+    virtual void Set(fdevent* fde, unsigned events) final;
+
+    virtual void Loop() final;
+    size_t InstalledCount() final;
+
+  protected:
+    virtual void Interrupt() final;
+
+  private:
+    struct PollRequest;
+
+    fdevent_context_win32(HANDLE iocp, HANDLE afd_device);
+
+    void ArmPoll(fdevent* fde);
+    void CancelPoll(fdevent* fde);
+
+    HANDLE iocp_ = INVALID_HANDLE_VALUE;
+    HANDLE afd_device_ = INVALID_HANDLE_VALUE;
+
+    // All in-flight poll requests. A request's memory must stay alive until
+    // its completion is reaped, even after cancellation.
+    std::unordered_map<PollRequest*, std::unique_ptr<PollRequest>> pending_;
+
+    // The active request per fdevent id. Completions for requests that are no
+    // longer active (cancelled, re-armed with a different mask, or belonging
+    // to a destroyed fdevent) are dropped.
+    std::unordered_map<uint64_t, PollRequest*> armed_;
+};
+
+#endif  // defined(_WIN32)
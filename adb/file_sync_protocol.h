@@ -26,6 +26,7 @@
 #define ID_LIST_V2 MKID('L', 'I', 'S', '2')
 #define ID_DENT_V1 MKID('D', 'E', 'N', 'T')
 #define ID_DENT_V2 MKID('D', 'N', 'T', '2')
+#define ID_SNAP MKID('S', 'N', 'A', 'P')
 
 #define ID_SEND_V1 MKID('S', 'E', 'N', 'D')
 #define ID_SEND_V2 MKID('S', 'N', 'D', '2')
@@ -33,6 +34,10 @@
 #define ID_RECV_V2 MKID('R', 'C', 'V', '2')
 #define ID_DONE MKID('D', 'O', 'N', 'E')
 #define ID_DATA MKID('D', 'A', 'T', 'A')
+#define ID_CKSM MKID('C', 'K', 'S', 'M')
+#define ID_COPY MKID('C', 'O', 'P', 'Y')
+#define ID_SPRS MKID('S', 'P', 'R', 'S')
+#define ID_HOLE MKID('H', 'O', 'L', 'E')
 #define ID_OKAY MKID('O', 'K', 'A', 'Y')
 #define ID_FAIL MKID('F', 'A', 'I', 'L')
 #define ID_QUIT MKID('Q', 'U', 'I', 'T')
@@ -94,6 +99,8 @@ enum SyncFlag : uint32_t {
     kSyncFlagBrotli = 1,
     kSyncFlagLZ4 = 2,
     kSyncFlagZstd = 4,
+    kSyncFlagSparse = 0x2000'0000U,
+    kSyncFlagDelta = 0x4000'0000U,
     kSyncFlagDryRun = 0x8000'0000U,
 };
 
@@ -125,6 +132,34 @@ struct __attribute__((packed)) sync_data {
     uint32_t size;
 };  // followed by `size` bytes of data.
 
+// A directory snapshot returns stat data for an entire subtree in one request.  Like the
+// send_v2/recv_v2 setups, a second syncmsg with the same ID follows the path and carries a
+// compression flag.  The response is a stream of ID_DATA packets whose decompressed payload is
+// a sequence of sync_dent_v2 records (id ID_DENT_V2) whose name is the entry's path relative
+// to the requested root, ended by an uncompressed ID_DONE.  Unreadable directories are
+// silently skipped, and a nonexistent root yields an empty snapshot rather than a failure.
+struct __attribute__((packed)) sync_snap {
+    uint32_t id;
+    uint32_t flags;
+};
+
+// Delta transfers operate on fixed SYNC_DATA_MAX-sized blocks. ID_CKSM requests the
+// SHA-256 digest of every block of an existing remote file; the response is a sequence
+// of sync_data packets (id ID_CKSM) carrying concatenated digests, ended by ID_DONE.
+// A send with kSyncFlagDelta then replaces the blocks that didn't change with ID_COPY
+// references into the old file instead of resending their contents.
+struct __attribute__((packed)) sync_copy {
+    uint32_t id;
+    uint32_t block;  // index of a SYNC_DATA_MAX-sized block in the old file
+};
+
+// Sparse transfers skip file holes instead of moving their zeroes. kSyncFlagSparse in a
+// send_v2/recv_v2 setup declares that the receiver understands ID_HOLE packets, which use
+// sync_data framing with no payload: `size` counts unwritten bytes the receiver seeks over
+// and materializes with a final ftruncate (holes of 4GiB or more are split across packets).
+// A sparse stream is never compressed; the holes are the win. On a pull the device decides:
+// if it elects sparse mode it sends an ID_SPRS packet (size 0) before any data, and the rest
+// of the stream is raw data and holes regardless of the compression the client asked for.
 struct __attribute__((packed)) sync_status {
     uint32_t id;
     uint32_t msglen;
@@ -136,9 +171,12 @@ union syncmsg {
     sync_dent_v1 dent_v1;
     sync_dent_v2 dent_v2;
     sync_data data;
+    sync_copy copy;
     sync_status status;
     sync_send_v2 send_v2_setup;
     sync_recv_v2 recv_v2_setup;
+    sync_snap snap_setup;
 };
 
 #define SYNC_DATA_MAX (64 * 1024)
+#define SYNC_DELTA_DIGEST_SIZE 32
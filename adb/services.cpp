@@ -41,6 +41,10 @@
 #include "sysdeps.h"
 #include "transport.h"
 
+#if ADB_HOST
+#include "client/sync_digest_cache.h"
+#endif
+
 namespace {
 
 void service_bootstrap_func(std::string service_name, std::function<void(unique_fd)> func,
@@ -242,9 +246,11 @@ static void wait_service(unique_fd fd, std::string serial, TransportId transport
 asocket* host_service_to_socket(std::string_view name, std::string_view serial,
                                 TransportId transport_id) {
     if (name == "track-devices") {
-        return create_device_tracker(false);
+        return create_device_tracker(TrackerOutputType::kShortText);
     } else if (name == "track-devices-l") {
-        return create_device_tracker(true);
+        return create_device_tracker(TrackerOutputType::kLongText);
+    } else if (name == "track-devices-delta") {
+        return create_device_tracker(TrackerOutputType::kDeltaText);
     } else if (android::base::ConsumePrefix(&name, "wait-for-")) {
         std::string spec(name);
         unique_fd fd =
@@ -256,6 +262,13 @@ asocket* host_service_to_socket(std::string_view name, std::string_view serial,
         unique_fd fd = create_service_thread(
                 "connect", std::bind(connect_service, std::placeholders::_1, host));
         return create_local_socket(std::move(fd));
+    } else if (android::base::ConsumePrefix(&name, "sync-cache:")) {
+        // "<size>,<mtime>,<path>": per-block digests of a host file, cached in the
+        // server across sync invocations; see client/sync_digest_cache.cpp.
+        std::string spec(name);
+        unique_fd fd = create_service_thread(
+                "sync-cache", std::bind(sync_digest_cache_service, std::placeholders::_1, spec));
+        return create_local_socket(std::move(fd));
     } else if (android::base::ConsumePrefix(&name, "pair:")) {
         const char* divider = strchr(name.data(), ':');
         if (!divider) {
@@ -47,6 +47,15 @@ struct asocket {
     // write packets and close directly.
     bool has_write_error = 0;
 
+    // flag: set while the socket is parked in the per-loop transmit batcher,
+    // which defers the writev of freshly enqueued data to one flush pass at
+    // the end of the current fdevent iteration
+    bool in_transmit_batch = false;
+
+    // flag: set when enqueue() reported backpressure, so the peer's ready()
+    // notification is owed once the deferred flush drains the queue
+    bool transmit_batch_notify_ready = false;
+
     /* flag: quit adbd when both ends close the
      * local service socket
      */
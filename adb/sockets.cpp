@@ -26,9 +26,11 @@
 #include <unistd.h>
 
 #include <algorithm>
+#include <array>
 #include <chrono>
 #include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <android-base/strings.h>
@@ -46,35 +48,55 @@
 
 using namespace std::chrono_literals;
 
+// The local socket registry is sharded by id: packet routing calls
+// find_local_socket() for every A_WRTE/A_OKAY/A_CLSE, and with hundreds of
+// forwarded sockets a single registry lock (and the linear scan it guarded)
+// shows up in profiles. A lookup hashes its id to one shard and touches only
+// that shard's lock.
+//
+// Lock order: local_socket_list_lock is always taken before any shard lock.
+// The locks are recursive because s->close() re-enters the registry while the
+// caller still holds them.
+static constexpr unsigned kLocalSocketShardCount = 16;
+
+struct LocalSocketShard {
+    std::recursive_mutex lock;
+    std::unordered_map<unsigned, asocket*> sockets;
+};
+
+static auto& local_socket_shards = *new std::array<LocalSocketShard, kLocalSocketShardCount>();
+
+static LocalSocketShard& local_socket_shard(unsigned id) {
+    static_assert((kLocalSocketShardCount & (kLocalSocketShardCount - 1)) == 0);
+    return local_socket_shards[id & (kLocalSocketShardCount - 1)];
+}
+
 static std::recursive_mutex& local_socket_list_lock = *new std::recursive_mutex();
 static unsigned local_socket_next_id = 1;
 
-static auto& local_socket_list = *new std::vector<asocket*>();
-
 /* the the list of currently closing local sockets.
 ** these have no peer anymore, but still packets to
 ** write to their fd.
 */
 static auto& local_socket_closing_list = *new std::vector<asocket*>();
 
-// Parse the global list of sockets to find one with id |local_id|.
+// Look up the socket with id |local_id| in its registry shard.
 // If |peer_id| is not 0, also check that it is connected to a peer
 // with id |peer_id|. Returns an asocket handle on success, NULL on failure.
 asocket* find_local_socket(unsigned local_id, unsigned peer_id) {
-    asocket* result = nullptr;
+    LocalSocketShard& shard = local_socket_shard(local_id);
+    std::lock_guard<std::recursive_mutex> lock(shard.lock);
 
-    std::lock_guard<std::recursive_mutex> lock(local_socket_list_lock);
-    for (asocket* s : local_socket_list) {
-        if (s->id != local_id) {
-            continue;
-        }
-        if (peer_id == 0 || (s->peer && s->peer->id == peer_id)) {
-            result = s;
-        }
-        break;
+    auto it = shard.sockets.find(local_id);
+    if (it == shard.sockets.end()) {
+        return nullptr;
     }
 
-    return result;
+    asocket* s = it->second;
+    if (peer_id == 0 || (s->peer && s->peer->id == peer_id)) {
+        return s;
+    }
+    return nullptr;
 }
 
 void install_local_socket(asocket* s) {
@@ -87,27 +109,42 @@ void install_local_socket(asocket* s) {
         LOG(FATAL) << "local socket id overflow";
     }
 
-    local_socket_list.push_back(s);
+    LocalSocketShard& shard = local_socket_shard(s->id);
+    std::lock_guard<std::recursive_mutex> shard_lock(shard.lock);
+    shard.sockets[s->id] = s;
 }
 
 void remove_socket(asocket* s) {
     std::lock_guard<std::recursive_mutex> lock(local_socket_list_lock);
-    for (auto list : { &local_socket_list, &local_socket_closing_list }) {
-        list->erase(std::remove_if(list->begin(), list->end(), [s](asocket* x) { return x == s; }),
-                    list->end());
+
+    LocalSocketShard& shard = local_socket_shard(s->id);
+    {
+        std::lock_guard<std::recursive_mutex> shard_lock(shard.lock);
+        auto it = shard.sockets.find(s->id);
+        if (it != shard.sockets.end() && it->second == s) {
+            shard.sockets.erase(it);
+        }
     }
+
+    local_socket_closing_list.erase(
+            std::remove_if(local_socket_closing_list.begin(), local_socket_closing_list.end(),
+                           [s](asocket* x) { return x == s; }),
+            local_socket_closing_list.end());
 }
 
 void close_all_sockets(atransport* t) {
-    /* this is a little gross, but since s->close() *will* modify
-    ** the list out from under you, your options are limited.
-    */
     std::lock_guard<std::recursive_mutex> lock(local_socket_list_lock);
-restart:
-    for (asocket* s : local_socket_list) {
-        if (s->transport == t || (s->peer && s->peer->transport == t)) {
-            s->close(s);
-            goto restart;
+    for (LocalSocketShard& shard : local_socket_shards) {
+        /* this is a little gross, but since s->close() *will* modify
+        ** the shard out from under you, your options are limited.
+        */
+        std::lock_guard<std::recursive_mutex> shard_lock(shard.lock);
+    restart:
+        for (const auto& [id, s] : shard.sockets) {
+            if (s->transport == t || (s->peer && s->peer->transport == t)) {
+                s->close(s);
+                goto restart;
+            }
         }
     }
 }
@@ -218,22 +255,65 @@ static bool local_socket_flush_outgoing(asocket* s) {
     return true;
 }
 
+// Per-loop transmit batcher.  Freshly enqueued data is not written out immediately; the socket
+// is parked here instead, and every parked socket is flushed in one pass of writevs at the end
+// of the current fdevent iteration (via the run queue).  A socket that receives several
+// payloads in one iteration is written once instead of once per payload, and the flushes of
+// many forwarded sockets run back to back instead of interleaving with their reads.
+static std::vector<asocket*> transmit_batch;
+static bool transmit_batch_scheduled = false;
+
+static void local_socket_flush_transmit_batch() {
+    transmit_batch_scheduled = false;
+    // Pop each socket before flushing it: a flush can destroy sockets, which scrubs them from
+    // the batch, and the popped socket itself must not be revisited if that happens.
+    while (!transmit_batch.empty()) {
+        asocket* s = transmit_batch.front();
+        transmit_batch.erase(transmit_batch.begin());
+        s->in_transmit_batch = false;
+        bool notify_ready = s->transmit_batch_notify_ready;
+        s->transmit_batch_notify_ready = false;
+        switch (local_socket_flush_incoming(s)) {
+            case SocketFlushResult::Destroyed:
+                break;
+
+            case SocketFlushResult::TryAgain:
+                // FDE_WRITE stays armed; the event path notifies the peer once the queue
+                // drains.
+                break;
+
+            case SocketFlushResult::Completed:
+                if (notify_ready && s->peer) {
+                    s->peer->ready(s->peer);
+                }
+                break;
+        }
+    }
+}
+
 static int local_socket_enqueue(asocket* s, apacket::payload_type data) {
     D("LS(%d): enqueue %zu", s->id, data.size());
 
     s->packet_queue.append(std::move(data));
-    switch (local_socket_flush_incoming(s)) {
-        case SocketFlushResult::Destroyed:
-            return -1;
-
-        case SocketFlushResult::TryAgain:
-            return 1;
-
-        case SocketFlushResult::Completed:
-            return 0;
+    if (!s->in_transmit_batch) {
+        s->in_transmit_batch = true;
+        transmit_batch.push_back(s);
+        // Keep the closing-path invariant that buffered data implies FDE_WRITE; the flush
+        // removes the event again once the queue drains.
+        fdevent_add(s->fde, FDE_WRITE);
+        if (!transmit_batch_scheduled) {
+            transmit_batch_scheduled = true;
+            fdevent_run_on_main_thread(local_socket_flush_transmit_batch);
+        }
     }
 
-    return !s->packet_queue.empty();
+    // Apply backpressure once a full payload is buffered.  The deferred flush (or, if it
+    // can't drain the queue, the FDE_WRITE path) calls the peer's ready() afterwards.
+    if (s->packet_queue.size() >= s->get_max_payload()) {
+        s->transmit_batch_notify_ready = true;
+        return 1;
+    }
+    return 0;
 }
 
 static void local_socket_ready(asocket* s) {
@@ -299,6 +379,11 @@ static void local_socket_destroy(asocket* s) {
 
     D("LS(%d): destroying fde.fd=%d", s->id, s->fd);
 
+    if (s->in_transmit_batch) {
+        transmit_batch.erase(std::remove(transmit_batch.begin(), transmit_batch.end(), s),
+                             transmit_batch.end());
+    }
+
     deferred_close(fdevent_release(s->fde));
 
     remove_socket(s);
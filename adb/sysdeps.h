@@ -104,6 +104,7 @@ extern int adb_pread(borrowed_fd fd, void* buf, int len, off64_t offset);
 extern int adb_write(borrowed_fd fd, const void* buf, int len);
 extern int adb_pwrite(borrowed_fd fd, const void* buf, int len, off64_t offset);
 extern int64_t adb_lseek(borrowed_fd fd, int64_t pos, int where);
+extern int adb_ftruncate(borrowed_fd fd, int64_t length);
 extern int adb_shutdown(borrowed_fd fd, int direction = SHUT_RDWR);
 extern int adb_close(int fd);
 extern int adb_register_socket(SOCKET s);
@@ -532,6 +533,16 @@ static inline int64_t adb_lseek(borrowed_fd fd, int64_t pos, int where) {
 #undef lseek
 #define lseek ___xxx_lseek
 
+static inline int adb_ftruncate(borrowed_fd fd, int64_t length) {
+#if defined(__APPLE__)
+    return ftruncate(fd.get(), length);
+#else
+    return ftruncate64(fd.get(), length);
+#endif
+}
+#undef ftruncate
+#define ftruncate ___xxx_ftruncate
+
 static inline int adb_unlink(const char* path) {
     return unlink(path);
 }
@@ -17,11 +17,19 @@
 #include "sysdeps/network.h"
 
 #include <errno.h>
+#include <fcntl.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <poll.h>
 #include <sys/socket.h>
 
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <android-base/logging.h>
 #include <android-base/stringprintf.h>
@@ -133,20 +141,160 @@ int network_loopback_server(int port, int type, std::string* error, bool prefer_
     return rc;
 }
 
+// Interval between starting successive connection attempts. A broken path on the
+// preferred address costs one stagger interval instead of a full TCP timeout.
+static constexpr int kConnectStaggerMs = 250;
+
+// Address family that most recently won the connect race for a host, so later
+// connects in the same server run lead with the family that actually works.
+static auto& g_winning_family_mutex = *new std::mutex();
+static auto& g_winning_family = *new std::unordered_map<std::string, int>();
+
 int network_connect(const std::string& host, int port, int type, int timeout, std::string* error) {
-    int getaddrinfo_error = 0;
-    int fd = socket_network_client_timeout(host.c_str(), port, type, timeout, &getaddrinfo_error);
-    if (fd != -1) {
-        return fd;
+    if (type != SOCK_STREAM) {
+        int getaddrinfo_error = 0;
+        int fd = socket_network_client_timeout(host.c_str(), port, type, timeout,
+                                               &getaddrinfo_error);
+        if (fd != -1) {
+            return fd;
+        }
+        if (getaddrinfo_error != 0) {
+            *error = android::base::StringPrintf("failed to resolve host: '%s': %s", host.c_str(),
+                                                 gai_strerror(getaddrinfo_error));
+            LOG(WARNING) << *error;
+        } else {
+            *error = android::base::StringPrintf("failed to connect to '%s:%d': %s", host.c_str(),
+                                                 port, strerror(errno));
+            LOG(WARNING) << *error;
+        }
+        return -1;
     }
+
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = type;
+    addrinfo* addrs = nullptr;
+    std::string port_str = std::to_string(port);
+    int getaddrinfo_error = getaddrinfo(host.c_str(), port_str.c_str(), &hints, &addrs);
     if (getaddrinfo_error != 0) {
         *error = android::base::StringPrintf("failed to resolve host: '%s': %s", host.c_str(),
                                              gai_strerror(getaddrinfo_error));
         LOG(WARNING) << *error;
-    } else {
-        *error = android::base::StringPrintf("failed to connect to '%s:%d': %s", host.c_str(), port,
-                                             strerror(errno));
-        LOG(WARNING) << *error;
+        return -1;
     }
+    std::unique_ptr<addrinfo, decltype(&freeaddrinfo)> addrs_guard(addrs, freeaddrinfo);
+
+    std::vector<const addrinfo*> order;
+    for (const addrinfo* ai = addrs; ai != nullptr; ai = ai->ai_next) {
+        order.push_back(ai);
+    }
+
+    // Lead with the family that won last time, if we have seen this host before.
+    {
+        std::lock_guard<std::mutex> lock(g_winning_family_mutex);
+        auto it = g_winning_family.find(host);
+        if (it != g_winning_family.end()) {
+            int family = it->second;
+            std::stable_partition(order.begin(), order.end(),
+                                  [family](const addrinfo* ai) { return ai->ai_family == family; });
+        }
+    }
+
+    // Happy-eyeballs style connect: launch non-blocking attempts a stagger interval
+    // apart and take the first one to complete, closing the losers.
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(timeout);
+    const bool have_deadline = timeout > 0;
+
+    auto take_winner = [&host](unique_fd s, int family) {
+        int flags = fcntl(s.get(), F_GETFL);
+        if (flags != -1) {
+            fcntl(s.get(), F_SETFL, flags & ~O_NONBLOCK);
+        }
+        std::lock_guard<std::mutex> lock(g_winning_family_mutex);
+        g_winning_family[host] = family;
+        return s.release();
+    };
+
+    std::vector<unique_fd> pending;
+    std::vector<int> pending_family;
+    size_t next_attempt = 0;
+    int last_error = ETIMEDOUT;
+
+    while (true) {
+        // Launch the next attempt if there is one.
+        if (next_attempt < order.size()) {
+            const addrinfo* ai = order[next_attempt++];
+            unique_fd s(socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol));
+            if (s != -1) {
+                int flags = fcntl(s.get(), F_GETFL);
+                if (flags != -1) {
+                    fcntl(s.get(), F_SETFL, flags | O_NONBLOCK);
+                }
+                int rc = connect(s.get(), ai->ai_addr, ai->ai_addrlen);
+                if (rc == 0) {
+                    return take_winner(std::move(s), ai->ai_family);
+                } else if (errno == EINPROGRESS) {
+                    pending_family.push_back(ai->ai_family);
+                    pending.push_back(std::move(s));
+                } else {
+                    last_error = errno;
+                }
+            } else {
+                last_error = errno;
+            }
+            // An attempt that failed outright shouldn't consume a stagger interval.
+            if (pending.empty() && next_attempt < order.size()) {
+                continue;
+            }
+        }
+        if (pending.empty()) {
+            break;
+        }
+
+        // Wait for an in-flight attempt to finish, but only up to the stagger
+        // interval while there are more addresses to try.
+        int poll_timeout = next_attempt < order.size() ? kConnectStaggerMs : -1;
+        if (have_deadline) {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                     deadline - std::chrono::steady_clock::now())
+                                     .count();
+            if (remaining <= 0) {
+                last_error = ETIMEDOUT;
+                break;
+            }
+            poll_timeout = poll_timeout < 0 ? static_cast<int>(remaining)
+                                            : std::min(poll_timeout, static_cast<int>(remaining));
+        }
+
+        std::vector<pollfd> pfds;
+        for (const auto& s : pending) {
+            pfds.push_back({.fd = s.get(), .events = POLLOUT, .revents = 0});
+        }
+        int rc = TEMP_FAILURE_RETRY(poll(pfds.data(), pfds.size(), poll_timeout));
+        if (rc < 0) {
+            last_error = errno;
+            break;
+        }
+
+        for (size_t i = pfds.size(); i-- > 0;) {
+            if (!(pfds[i].revents & (POLLOUT | POLLERR | POLLHUP))) {
+                continue;
+            }
+            int so_error = 0;
+            socklen_t len = sizeof(so_error);
+            getsockopt(pending[i].get(), SOL_SOCKET, SO_ERROR, &so_error, &len);
+            if (so_error == 0) {
+                return take_winner(std::move(pending[i]), pending_family[i]);
+            }
+            last_error = so_error;
+            pending.erase(pending.begin() + i);
+            pending_family.erase(pending_family.begin() + i);
+        }
+    }
+
+    errno = last_error;
+    *error = android::base::StringPrintf("failed to connect to '%s:%d': %s", host.c_str(), port,
+                                         strerror(errno));
+    LOG(WARNING) << *error;
     return -1;
 }
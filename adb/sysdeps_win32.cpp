@@ -526,6 +526,22 @@ int64_t adb_lseek(borrowed_fd fd, int64_t pos, int where) {
     return f->clazz->_fh_lseek(f, pos, where);
 }
 
+int adb_ftruncate(borrowed_fd fd, int64_t length) {
+    HANDLE h = adb_get_os_handle(fd);
+    if (h == nullptr || h == INVALID_HANDLE_VALUE) {
+        errno = EBADF;
+        return -1;
+    }
+    // FileEndOfFileInfo sets the size without disturbing the file pointer.
+    FILE_END_OF_FILE_INFO info;
+    info.EndOfFile.QuadPart = length;
+    if (!SetFileInformationByHandle(h, FileEndOfFileInfo, &info, sizeof(info))) {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
 int adb_close(int fd) {
     FH f = _fh_from_int(fd, __func__);
 
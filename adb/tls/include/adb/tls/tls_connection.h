@@ -81,6 +81,16 @@ class TlsConnection {
     // keying material. This is only valid after |DoHandshake| succeeds.
     virtual std::vector<uint8_t> ExportKeyingMaterial(size_t length) = 0;
 
+    // Enables TLS session resumption for this connection. |session_key| names
+    // the peer (e.g. the device address); a client offers the session ticket it
+    // cached under that key on a previous connection and caches any new ticket
+    // the peer issues, while a server encrypts tickets with a process-lifetime
+    // key instead of the default per-connection one so its tickets stay
+    // redeemable across connections. A resumed handshake completes in a single
+    // round trip and skips certificate re-verification. Must be called before
+    // |DoHandshake|.
+    virtual void EnableSessionResumption(std::string_view session_key) = 0;
+
     // Enable client-side check on whether server accepted the handshake. In TLS
     // 1.3, client will not know the server rejected the handshake until after
     // performing a read operation. Basically, this will perform an
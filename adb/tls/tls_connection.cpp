@@ -17,11 +17,15 @@
 #include "adb/tls/tls_connection.h"
 
 #include <algorithm>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <android-base/logging.h>
 #include <android-base/strings.h>
 #include <openssl/err.h>
+#include <openssl/rand.h>
 #include <openssl/ssl.h>
 
 using android::base::borrowed_fd;
@@ -33,6 +37,48 @@ namespace {
 
 static constexpr char kExportedKeyLabel[] = "adb-label";
 
+// Process-wide cache of established sessions, keyed by the caller-supplied peer name.
+// TLS 1.3 tickets arrive after the handshake, so entries are inserted from the
+// new-session callback once the peer actually issues one.
+static constexpr size_t kMaxCachedSessions = 64;
+static auto& session_cache_mutex = *new std::mutex();
+static auto& session_cache = *new std::unordered_map<std::string, bssl::UniquePtr<SSL_SESSION>>();
+
+static bssl::UniquePtr<SSL_SESSION> GetCachedSession(const std::string& session_key) {
+    std::lock_guard<std::mutex> lock(session_cache_mutex);
+    auto it = session_cache.find(session_key);
+    if (it == session_cache.end()) {
+        return nullptr;
+    }
+    if (!SSL_SESSION_is_resumable(it->second.get())) {
+        session_cache.erase(it);
+        return nullptr;
+    }
+    return bssl::UpRef(it->second);
+}
+
+static void CacheSession(const std::string& session_key, bssl::UniquePtr<SSL_SESSION> session) {
+    std::lock_guard<std::mutex> lock(session_cache_mutex);
+    if (session_cache.size() >= kMaxCachedSessions &&
+        session_cache.find(session_key) == session_cache.end()) {
+        session_cache.erase(session_cache.begin());
+    }
+    session_cache[session_key] = std::move(session);
+}
+
+// Servers create a fresh SSL_CTX per connection, and the default random per-context
+// ticket key would make every issued ticket unredeemable. Encrypt tickets with one
+// random key for the life of the process instead; restarting still invalidates
+// outstanding tickets, which only costs the peer a full handshake.
+static const uint8_t* SessionTicketKey() {
+    static const uint8_t* key = [] {
+        static uint8_t buf[48];
+        CHECK_EQ(RAND_bytes(buf, sizeof(buf)), 1);
+        return buf;
+    }();
+    return key;
+}
+
 class TlsConnectionImpl : public TlsConnection {
   public:
     explicit TlsConnectionImpl(Role role, std::string_view cert, std::string_view priv_key,
@@ -44,6 +90,7 @@ class TlsConnectionImpl : public TlsConnection {
     void SetCertificateCallback(SetCertCb cb) override;
     void SetClientCAList(STACK_OF(X509_NAME) * ca_list) override;
     std::vector<uint8_t> ExportKeyingMaterial(size_t length) override;
+    void EnableSessionResumption(std::string_view session_key) override;
     void EnableClientPostHandshakeCheck(bool enable) override;
     TlsError DoHandshake() override;
     std::vector<uint8_t> ReadFully(size_t size) override;
@@ -56,6 +103,7 @@ class TlsConnectionImpl : public TlsConnection {
   private:
     static int SSLSetCertVerifyCb(X509_STORE_CTX* ctx, void* opaque);
     static int SSLSetCertCb(SSL* ssl, void* opaque);
+    static int SSLNewSessionCb(SSL* ssl, SSL_SESSION* session);
 
     static bssl::UniquePtr<X509> X509FromBuffer(bssl::UniquePtr<CRYPTO_BUFFER> buffer);
     static const char* SSLErrorString();
@@ -71,6 +119,7 @@ class TlsConnectionImpl : public TlsConnection {
     bssl::UniquePtr<SSL_CTX> ssl_ctx_;
     bssl::UniquePtr<SSL> ssl_;
     std::vector<bssl::UniquePtr<X509>> known_certificates_;
+    std::string session_key_;
     bool client_verify_post_handshake_ = false;
 
     CertVerifyCb cert_verify_cb_;
@@ -150,6 +199,18 @@ int TlsConnectionImpl::SSLSetCertCb(SSL* ssl, void* opaque) {
     return p->set_cert_cb_(ssl);
 }
 
+// static
+int TlsConnectionImpl::SSLNewSessionCb(SSL* ssl, SSL_SESSION* session) {
+    auto* p = reinterpret_cast<TlsConnectionImpl*>(SSL_get_app_data(ssl));
+    if (p == nullptr || p->session_key_.empty()) {
+        return 0;
+    }
+    LOG(INFO) << p->RoleToString() << "Caching TLS session for [" << p->session_key_ << "]";
+    CacheSession(p->session_key_, bssl::UniquePtr<SSL_SESSION>(session));
+    // We took ownership of |session|.
+    return 1;
+}
+
 bool TlsConnectionImpl::AddTrustedCertificate(std::string_view cert) {
     // Create X509 buffer from the certificate string
     auto buf = X509FromBuffer(BufferFromPEM(cert));
@@ -187,6 +248,11 @@ std::vector<uint8_t> TlsConnectionImpl::ExportKeyingMaterial(size_t length) {
     return out;
 }
 
+void TlsConnectionImpl::EnableSessionResumption(std::string_view session_key) {
+    CHECK(!session_key.empty());
+    session_key_ = session_key;
+}
+
 void TlsConnectionImpl::EnableClientPostHandshakeCheck(bool enable) {
     client_verify_post_handshake_ = enable;
 }
@@ -261,6 +327,20 @@ TlsConnection::TlsError TlsConnectionImpl::DoHandshake() {
 
     SSL_CTX_set_verify(ssl_ctx_.get(), SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT, nullptr);
 
+    // Session resumption, so reconnects to a known peer complete in one round trip.
+    if (!session_key_.empty()) {
+        switch (role_) {
+            case Role::Server:
+                SSL_CTX_set_session_cache_mode(ssl_ctx_.get(), SSL_SESS_CACHE_SERVER);
+                SSL_CTX_set_tlsext_ticket_keys(ssl_ctx_.get(), SessionTicketKey(), 48);
+                break;
+            case Role::Client:
+                SSL_CTX_set_session_cache_mode(ssl_ctx_.get(), SSL_SESS_CACHE_CLIENT);
+                SSL_CTX_sess_set_new_cb(ssl_ctx_.get(), SSLNewSessionCb);
+                break;
+        }
+    }
+
     // Okay! Let's try to do the handshake!
     ssl_.reset(SSL_new(ssl_ctx_.get()));
     if (!SSL_set_fd(ssl_.get(), fd_.get())) {
@@ -268,6 +348,17 @@ TlsConnection::TlsError TlsConnectionImpl::DoHandshake() {
         return TlsError::UnknownFailure;
     }
 
+    if (!session_key_.empty()) {
+        SSL_set_app_data(ssl_.get(), this);
+        if (role_ == Role::Client) {
+            if (auto session = GetCachedSession(session_key_)) {
+                LOG(INFO) << RoleToString() << "Offering cached TLS session for [" << session_key_
+                          << "]";
+                SSL_set_session(ssl_.get(), session.get());
+            }
+        }
+    }
+
     switch (role_) {
         case Role::Server:
             SSL_set_accept_state(ssl_.get());
@@ -297,7 +388,8 @@ TlsConnection::TlsError TlsConnectionImpl::DoHandshake() {
         }
     }
 
-    LOG(INFO) << RoleToString() << "Handshake succeeded.";
+    LOG(INFO) << RoleToString() << "Handshake succeeded"
+              << (SSL_session_reused(ssl_.get()) ? " (session resumed)." : ".");
     return TlsError::Success;
 }
 
@@ -30,6 +30,7 @@
 
 #include <algorithm>
 #include <list>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <set>
@@ -51,6 +52,7 @@
 #include "adb_auth.h"
 #include "adb_io.h"
 #include "adb_trace.h"
+#include "adb_trace_ring.h"
 #include "adb_utils.h"
 #include "fdevent/fdevent.h"
 #include "sysdeps/chrono.h"
@@ -87,6 +89,9 @@ const char* const kFeatureSendRecv2Brotli = "sendrecv_v2_brotli";
 const char* const kFeatureSendRecv2LZ4 = "sendrecv_v2_lz4";
 const char* const kFeatureSendRecv2Zstd = "sendrecv_v2_zstd";
 const char* const kFeatureSendRecv2DryRunSend = "sendrecv_v2_dry_run_send";
+const char* const kFeatureDeltaSync = "delta_sync";
+const char* const kFeatureSparseSync = "sparse_sync";
+const char* const kFeatureSyncSnapshot = "sync_snapshot";
 
 namespace {
 
@@ -295,24 +300,35 @@ void BlockingConnectionAdapter::Start() {
 
     write_thread_ = std::thread([this]() {
         LOG(INFO) << this->transport_name_ << ": write thread spawning";
-        while (true) {
-            std::unique_lock<std::mutex> lock(mutex_);
-            ScopedLockAssertion assume_locked(mutex_);
-            cv_.wait(lock, [this]() REQUIRES(mutex_) {
-                return this->stopped_ || !this->write_queue_.empty();
-            });
+        std::deque<std::unique_ptr<apacket>> batch;
+        bool write_failed = false;
+        while (!write_failed) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                ScopedLockAssertion assume_locked(mutex_);
+                cv_.wait(lock, [this]() REQUIRES(mutex_) {
+                    return this->stopped_ || !this->write_queue_.empty();
+                });
+
+                if (this->stopped_) {
+                    return;
+                }
 
-            if (this->stopped_) {
-                return;
+                // Drain the whole queue in one lock acquisition.  Packets queued while the
+                // batch is written out are picked up on the next pass, so a burst of writers
+                // costs one wakeup and one lock round trip instead of one of each per packet.
+                batch.swap(this->write_queue_);
             }
 
-            std::unique_ptr<apacket> packet = std::move(this->write_queue_.front());
-            this->write_queue_.pop_front();
-            lock.unlock();
+            for (auto& packet : batch) {
+                adb_trace_ring_record(AdbTraceEvent::PacketDequeue, packet->msg.data_length);
 
-            if (!this->underlying_->Write(packet.get())) {
-                break;
+                if (!this->underlying_->Write(packet.get())) {
+                    write_failed = true;
+                    break;
+                }
             }
+            batch.clear();
         }
         std::call_once(this->error_flag_, [this]() { this->error_callback_(this, "write failed"); });
     });
@@ -350,6 +366,10 @@ void BlockingConnectionAdapter::StartReadThread() {
     });
 }
 
+void BlockingConnectionAdapter::SetTlsSessionKey(const std::string& session_key) {
+    this->underlying_->SetTlsSessionKey(session_key);
+}
+
 bool BlockingConnectionAdapter::DoTlsHandshake(RSA* key, std::string* auth_key) {
     std::lock_guard<std::mutex> lock(mutex_);
     if (read_thread_.joinable()) {
@@ -420,12 +440,19 @@ void BlockingConnectionAdapter::Stop() {
 }
 
 bool BlockingConnectionAdapter::Write(std::unique_ptr<apacket> packet) {
+    adb_trace_ring_record(AdbTraceEvent::PacketEnqueue, packet->msg.data_length);
+    bool wake;
     {
         std::lock_guard<std::mutex> lock(this->mutex_);
+        wake = write_queue_.empty();
         write_queue_.emplace_back(std::move(packet));
     }
 
-    cv_.notify_one();
+    // The write thread only sleeps on an empty queue, so only the packet that makes it
+    // non-empty needs to notify; later writers just append while the batch drains.
+    if (wake) {
+        cv_.notify_one();
+    }
     return true;
 }
 
@@ -479,6 +506,19 @@ bool FdConnection::Read(apacket* packet) {
 }
 
 bool FdConnection::Write(apacket* packet) {
+    if (packet->msg.data_length != 0 && packet->msg.data_length <= Block::kInlineCapacity) {
+        // Small payloads (mostly control packets) go out in the same write as the header,
+        // halving the syscall (or TLS record) count for the dominant packet size.
+        char buf[sizeof(packet->msg) + Block::kInlineCapacity];
+        memcpy(buf, &packet->msg, sizeof(packet->msg));
+        memcpy(buf + sizeof(packet->msg), &packet->payload[0], packet->msg.data_length);
+        if (!DispatchWrite(buf, sizeof(packet->msg) + packet->msg.data_length)) {
+            D("remote local: write terminated");
+            return false;
+        }
+        return true;
+    }
+
     if (!DispatchWrite(&packet->msg, sizeof(packet->msg))) {
         D("remote local: write terminated");
         return false;
@@ -531,6 +571,18 @@ bool FdConnection::DoTlsHandshake(RSA* key, std::string* auth_key) {
     tls_->SetClientCAList(ca_list.get());
 #endif
 
+#if ADB_HOST
+    // Offer/cache session tickets so reconnecting to a known device is a
+    // single-round-trip handshake. The key is the transport serial (address).
+    if (!tls_session_key_.empty()) {
+        tls_->EnableSessionResumption(tls_session_key_);
+    }
+#else
+    // The server side only needs the stable ticket encryption key; the peer
+    // identity is carried by the ticket itself.
+    tls_->EnableSessionResumption("adbd");
+#endif
+
     auto err = tls_->DoHandshake();
     if (err == TlsError::Success) {
         return true;
@@ -599,7 +651,9 @@ static fdevent* transport_registration_fde;
 struct device_tracker {
     asocket socket;
     bool update_needed = false;
-    bool long_output = false;
+    TrackerOutputType output_type = TrackerOutputType::kShortText;
+    // What a delta tracker was last told, by transport id: (serial, state).
+    std::map<TransportId, std::pair<std::string, std::string>> delta_snapshot;
     device_tracker* next = nullptr;
 };
 
@@ -652,6 +706,46 @@ static int device_tracker_send(device_tracker* tracker, const std::string& strin
     return peer->enqueue(peer, std::move(data));
 }
 
+// Returns the records for everything that changed since the tracker's last
+// update and advances its snapshot.  One record per line:
+//   add\t<transport_id>\t<serial>\t<state>
+//   state\t<transport_id>\t<serial>\t<state>
+//   remove\t<transport_id>\t<serial>
+// A tracker that just connected gets every device as an add record.
+static std::string device_tracker_delta(device_tracker* tracker) {
+    std::lock_guard<std::recursive_mutex> lock(transport_lock);
+
+    std::map<TransportId, std::pair<std::string, std::string>> current;
+    for (const auto& t : transport_list) {
+        std::string serial = t->serial;
+        if (serial.empty()) {
+            serial = "(no serial number)";
+        }
+        current[t->id] = std::make_pair(std::move(serial), t->connection_state_name());
+    }
+
+    std::string result;
+    for (const auto& [id, device] : current) {
+        auto it = tracker->delta_snapshot.find(id);
+        if (it == tracker->delta_snapshot.end()) {
+            android::base::StringAppendF(&result, "add\t%" PRIu64 "\t%s\t%s\n", id,
+                                         device.first.c_str(), device.second.c_str());
+        } else if (it->second.second != device.second) {
+            android::base::StringAppendF(&result, "state\t%" PRIu64 "\t%s\t%s\n", id,
+                                         device.first.c_str(), device.second.c_str());
+        }
+    }
+    for (const auto& [id, device] : tracker->delta_snapshot) {
+        if (current.find(id) == current.end()) {
+            android::base::StringAppendF(&result, "remove\t%" PRIu64 "\t%s\n", id,
+                                         device.first.c_str());
+        }
+    }
+
+    tracker->delta_snapshot = std::move(current);
+    return result;
+}
+
 static void device_tracker_ready(asocket* socket) {
     device_tracker* tracker = reinterpret_cast<device_tracker*>(socket);
 
@@ -659,11 +753,16 @@ static void device_tracker_ready(asocket* socket) {
     // for the first time, even if no update occurred.
     if (tracker->update_needed) {
         tracker->update_needed = false;
-        device_tracker_send(tracker, list_transports(tracker->long_output));
+        if (tracker->output_type == TrackerOutputType::kDeltaText) {
+            device_tracker_send(tracker, device_tracker_delta(tracker));
+        } else {
+            device_tracker_send(tracker,
+                                list_transports(tracker->output_type == TrackerOutputType::kLongText));
+        }
     }
 }
 
-asocket* create_device_tracker(bool long_output) {
+asocket* create_device_tracker(TrackerOutputType output_type) {
     device_tracker* tracker = new device_tracker();
     if (tracker == nullptr) LOG(FATAL) << "cannot allocate device tracker";
 
@@ -673,7 +772,7 @@ asocket* create_device_tracker(bool long_output) {
     tracker->socket.ready = device_tracker_ready;
     tracker->socket.close = device_tracker_close;
     tracker->update_needed = true;
-    tracker->long_output = long_output;
+    tracker->output_type = output_type;
 
     tracker->next = device_tracker_list;
     device_tracker_list = tracker;
@@ -706,7 +805,19 @@ void update_transports() {
     while (tracker != nullptr) {
         device_tracker* next = tracker->next;
         // This may destroy the tracker if the connection is closed.
-        device_tracker_send(tracker, list_transports(tracker->long_output));
+        if (tracker->output_type == TrackerOutputType::kDeltaText) {
+            // Every change since the last notification coalesces into one message, so a
+            // USB enumeration storm costs a delta tracker a few records per message
+            // rather than the full list each time; no message at all if nothing the
+            // tracker can see has changed.
+            std::string delta = device_tracker_delta(tracker);
+            if (!delta.empty()) {
+                device_tracker_send(tracker, delta);
+            }
+        } else {
+            device_tracker_send(tracker,
+                                list_transports(tracker->output_type == TrackerOutputType::kLongText));
+        }
         tracker = next;
     }
 }
@@ -1192,6 +1303,9 @@ const FeatureSet& supported_features() {
                 kFeatureSendRecv2LZ4,
                 kFeatureSendRecv2Zstd,
                 kFeatureSendRecv2DryRunSend,
+                kFeatureDeltaSync,
+                kFeatureSparseSync,
+                kFeatureSyncSnapshot,
                 // Increment ADB_SERVER_VERSION when adding a feature that adbd needs
                 // to know about. Otherwise, the client can be stuck running an old
                 // version of the server even after upgrading their copy of adb.
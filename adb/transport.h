@@ -98,6 +98,12 @@ extern const char* const kFeatureSendRecv2LZ4;
 extern const char* const kFeatureSendRecv2Zstd;
 // adbd supports dry-run send for send/recv v2.
 extern const char* const kFeatureSendRecv2DryRunSend;
+// adbd supports delta (block-checksum based) file transfers.
+extern const char* const kFeatureDeltaSync;
+// adbd supports hole-aware (ID_HOLE/ID_SPRS) sparse file transfers.
+extern const char* const kFeatureSparseSync;
+// adbd supports directory snapshot (ID_SNAP) sync requests.
+extern const char* const kFeatureSyncSnapshot;
 
 TransportId NextTransportId();
 
@@ -130,6 +136,11 @@ struct Connection {
 
     virtual bool DoTlsHandshake(RSA* key, std::string* auth_key = nullptr) = 0;
 
+    // Names the peer for TLS session resumption, so a reconnect to the same
+    // device can offer a cached session ticket. A no-op for connection types
+    // that don't support TLS.
+    virtual void SetTlsSessionKey(const std::string& session_key) {}
+
     // Stop, and reset the device if it's a USB connection.
     virtual void Reset();
 
@@ -156,6 +167,9 @@ struct BlockingConnection {
 
     virtual bool DoTlsHandshake(RSA* key, std::string* auth_key = nullptr) = 0;
 
+    // See Connection::SetTlsSessionKey.
+    virtual void SetTlsSessionKey(const std::string& session_key) {}
+
     // Terminate a connection.
     // This method must be thread-safe, and must cause concurrent Reads/Writes to terminate.
     // Formerly known as 'Kick' in atransport.
@@ -176,6 +190,8 @@ struct BlockingConnectionAdapter : public Connection {
     virtual void Stop() override final;
     virtual bool DoTlsHandshake(RSA* key, std::string* auth_key) override final;
 
+    virtual void SetTlsSessionKey(const std::string& session_key) override final;
+
     virtual void Reset() override final;
 
   private:
@@ -202,6 +218,10 @@ struct FdConnection : public BlockingConnection {
     bool Write(apacket* packet) override final;
     bool DoTlsHandshake(RSA* key, std::string* auth_key) override final;
 
+    void SetTlsSessionKey(const std::string& session_key) override final {
+        tls_session_key_ = session_key;
+    }
+
     void Close() override;
     virtual void Reset() override final { Close(); }
 
@@ -210,6 +230,7 @@ struct FdConnection : public BlockingConnection {
     bool DispatchWrite(void* buf, size_t len);
 
     unique_fd fd_;
+    std::string tls_session_key_;
     std::unique_ptr<adb::tls::TlsConnection> tls_;
 };
 
@@ -485,7 +506,16 @@ void close_usb_devices(std::function<bool(const atransport*)> predicate, bool re
 
 void send_packet(apacket* p, atransport* t);
 
-asocket* create_device_tracker(bool long_output);
+// Output styles for the `track-devices` service; see create_device_tracker().
+enum class TrackerOutputType {
+    kShortText,
+    kLongText,
+    // Sends per-transport add/state/remove records instead of re-sending the
+    // full device list on every transport state change.
+    kDeltaText,
+};
+
+asocket* create_device_tracker(TrackerOutputType output_type);
 
 #if !ADB_HOST
 unique_fd adb_listen(std::string_view addr, std::string* error);
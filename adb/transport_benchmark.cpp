@@ -14,13 +14,24 @@
  * limitations under the License.
  */
 
+// Performance benchmarks for the pieces of adb that sit on the data path: the
+// transport connection types, the sync-protocol compression codecs, and fdevent
+// dispatch. To catch regressions, record a baseline from a known-good build with
+//   adb_benchmark --benchmark_format=json --benchmark_out=baseline.json
+// and compare a candidate build against it with the benchmark library's
+// tools/compare.py.
+
 #include <malloc.h>
 #include <stdio.h>
 
+#include <random>
+
 #include <android-base/logging.h>
 #include <benchmark/benchmark.h>
 
 #include "adb_trace.h"
+#include "compression_utils.h"
+#include "file_sync_protocol.h"
 #include "sysdeps.h"
 #include "transport.h"
 
@@ -182,6 +193,207 @@ void BM_Connection_Echo(benchmark::State& state) {
 ADB_CONNECTION_BENCHMARK(BM_Connection_Echo, ThreadPolicy::SameThread);
 ADB_CONNECTION_BENCHMARK(BM_Connection_Echo, ThreadPolicy::MainThread);
 
+// Simulates the small-file storms that adb sync produces when pushing a directory
+// of tiny files: many sub-MTU packets in flight at once, instead of one packet per
+// round trip like BM_Connection_Unidirectional.
+template <typename ConnectionType>
+void BM_Connection_SmallPacketStorm(benchmark::State& state) {
+    int fds[2];
+    if (adb_socketpair(fds) != 0) {
+        LOG(FATAL) << "failed to create socketpair";
+    }
+
+    auto client = MakeConnection<ConnectionType>(unique_fd(fds[0]));
+    auto server = MakeConnection<ConnectionType>(unique_fd(fds[1]));
+
+    std::atomic<size_t> received_bytes;
+
+    client->SetReadCallback([](Connection*, std::unique_ptr<apacket>) -> bool { return true; });
+    server->SetReadCallback(
+            [&received_bytes](Connection*, std::unique_ptr<apacket> packet) -> bool {
+                received_bytes += packet->payload.size();
+                return true;
+            });
+
+    client->SetErrorCallback(
+            [](Connection*, const std::string& error) { LOG(INFO) << "client closed: " << error; });
+    server->SetErrorCallback(
+            [](Connection*, const std::string& error) { LOG(INFO) << "server closed: " << error; });
+
+    client->Start();
+    server->Start();
+
+    constexpr size_t kPacketsPerBatch = 256;
+    for (auto _ : state) {
+        size_t data_size = state.range(0);
+        received_bytes = 0;
+        for (size_t i = 0; i < kPacketsPerBatch; ++i) {
+            std::unique_ptr<apacket> packet = std::make_unique<apacket>();
+            memset(&packet->msg, 0, sizeof(packet->msg));
+            packet->msg.command = A_WRTE;
+            packet->msg.data_length = data_size;
+            packet->payload.resize(data_size);
+            memset(&packet->payload[0], 0xff, data_size);
+            client->Write(std::move(packet));
+        }
+        while (received_bytes < kPacketsPerBatch * data_size) {
+            continue;
+        }
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * kPacketsPerBatch *
+                            state.range(0));
+
+    client->Stop();
+    server->Stop();
+}
+
+BENCHMARK_TEMPLATE(BM_Connection_SmallPacketStorm, FdConnection)
+        ->Arg(64)
+        ->Arg(512)
+        ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_Connection_SmallPacketStorm, NonblockingFdConnection)
+        ->Arg(64)
+        ->Arg(512)
+        ->UseRealTime();
+
+enum class PayloadFlavor {
+    Compressible,
+    Random,
+};
+
+static Block MakePayload(size_t size, PayloadFlavor flavor) {
+    Block result(size);
+    if (flavor == PayloadFlavor::Random) {
+        std::minstd_rand rng(42);
+        for (size_t i = 0; i < size; ++i) {
+            result[i] = static_cast<char>(rng());
+        }
+    } else {
+        // Repetitive ASCII, roughly what pushing source trees or logs looks like.
+        static constexpr char kText[] =
+                "error: this function declaration is not a prototype [-Werror,-Wstrict-prototypes]\n";
+        for (size_t i = 0; i < size; ++i) {
+            result[i] = kText[i % (sizeof(kText) - 1)];
+        }
+    }
+    return result;
+}
+
+template <typename EncoderType>
+static std::vector<Block> EncodePayload(const Block& payload) {
+    std::vector<Block> result;
+    EncoderType encoder(SYNC_DATA_MAX);
+    size_t offset = 0;
+    while (offset < payload.size()) {
+        size_t chunk = std::min<size_t>(SYNC_DATA_MAX, payload.size() - offset);
+        encoder.Append(Block(payload.begin() + offset, payload.begin() + offset + chunk));
+        offset += chunk;
+
+        while (true) {
+            Block output;
+            EncodeResult rc = encoder.Encode(&output);
+            CHECK(rc != EncodeResult::Error);
+            if (!output.empty()) {
+                result.push_back(std::move(output));
+            }
+            if (rc != EncodeResult::MoreOutput) {
+                break;
+            }
+        }
+    }
+
+    encoder.Finish();
+    while (true) {
+        Block output;
+        EncodeResult rc = encoder.Encode(&output);
+        CHECK(rc != EncodeResult::Error);
+        if (!output.empty()) {
+            result.push_back(std::move(output));
+        }
+        if (rc == EncodeResult::Done) {
+            break;
+        }
+    }
+    return result;
+}
+
+// Measures the streaming encoders from compression_utils.h the way the sync
+// protocol drives them: SYNC_DATA_MAX input blocks, SYNC_DATA_MAX output blocks.
+template <typename EncoderType, PayloadFlavor flavor>
+void BM_Codec_Encode(benchmark::State& state) {
+    Block payload = MakePayload(state.range(0), flavor);
+    for (auto _ : state) {
+        std::vector<Block> encoded = EncodePayload<EncoderType>(payload);
+        benchmark::DoNotOptimize(encoded);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+
+template <typename EncoderType, typename DecoderType, PayloadFlavor flavor>
+void BM_Codec_Decode(benchmark::State& state) {
+    Block payload = MakePayload(state.range(0), flavor);
+    std::vector<Block> encoded = EncodePayload<EncoderType>(payload);
+
+    for (auto _ : state) {
+        Block buffer(SYNC_DATA_MAX);
+        DecoderType decoder(std::span(buffer.data(), buffer.size()));
+        size_t decoded_bytes = 0;
+        for (size_t i = 0; i < encoded.size(); ++i) {
+            decoder.Append(Block(encoded[i].begin(), encoded[i].end()));
+            if (i == encoded.size() - 1) {
+                decoder.Finish();
+            }
+
+            while (true) {
+                std::span<char> output;
+                DecodeResult rc = decoder.Decode(&output);
+                CHECK(rc != DecodeResult::Error);
+                decoded_bytes += output.size();
+                if (rc != DecodeResult::MoreOutput) {
+                    break;
+                }
+            }
+        }
+        CHECK_EQ(decoded_bytes, payload.size());
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * state.range(0));
+}
+
+#define ADB_CODEC_BENCHMARK(encoder, decoder)                                           \
+    BENCHMARK_TEMPLATE(BM_Codec_Encode, encoder, PayloadFlavor::Compressible)           \
+            ->Arg(1 << 20);                                                             \
+    BENCHMARK_TEMPLATE(BM_Codec_Encode, encoder, PayloadFlavor::Random)->Arg(1 << 20);  \
+    BENCHMARK_TEMPLATE(BM_Codec_Decode, encoder, decoder, PayloadFlavor::Compressible)  \
+            ->Arg(1 << 20);                                                             \
+    BENCHMARK_TEMPLATE(BM_Codec_Decode, encoder, decoder, PayloadFlavor::Random)        \
+            ->Arg(1 << 20)
+
+ADB_CODEC_BENCHMARK(NullEncoder, NullDecoder);
+ADB_CODEC_BENCHMARK(BrotliEncoder, BrotliDecoder);
+ADB_CODEC_BENCHMARK(LZ4Encoder, LZ4Decoder);
+ADB_CODEC_BENCHMARK(ZstdEncoder, ZstdDecoder);
+
+// Round-trip latency of handing work to the fdevent loop, which bounds how
+// quickly anything scheduled with fdevent_run_on_main_thread gets serviced.
+static void BM_Fdevent_DispatchLatency(benchmark::State& state) {
+    fdevent_reset();
+    std::thread fdevent_thread([]() { fdevent_loop(); });
+
+    for (auto _ : state) {
+        std::atomic<bool> done = false;
+        fdevent_run_on_main_thread([&done]() { done = true; });
+        while (!done) {
+            continue;
+        }
+    }
+
+    fdevent_terminate_loop();
+    fdevent_run_on_main_thread([]() {});
+    fdevent_thread.join();
+}
+
+BENCHMARK(BM_Fdevent_DispatchLatency)->UseRealTime();
+
 int main(int argc, char** argv) {
     // Set M_DECAY_TIME so that our allocations aren't immediately purged on free.
     mallopt(M_DECAY_TIME, 1);
@@ -16,6 +16,92 @@
 
 #include "types.h"
 
+#include <optional>
+
+namespace internal {
+
+// Buffers with capacities in [kMinPooledAllocation, kMaxPooledAllocation] are rounded up
+// to a power-of-two size class and recycled through a per-thread freelist. Smaller and
+// larger (or oddly-sized) buffers aren't worth pooling and go straight to the heap.
+static constexpr size_t kMinPooledAllocation = 4096;
+static constexpr size_t kMaxPooledAllocation = 1024 * 1024;
+
+// Per-thread cap on cached memory per size class.
+static constexpr size_t kMaxFreeBytesPerClass = 4 * 1024 * 1024;
+
+static constexpr size_t log2_floor(size_t n) {
+    return 63 - __builtin_clzll(n);
+}
+
+static constexpr size_t kClassCount =
+        log2_floor(kMaxPooledAllocation) - log2_floor(kMinPooledAllocation) + 1;
+
+namespace {
+
+struct BlockPool {
+    std::vector<char*> free_lists[kClassCount];
+
+    ~BlockPool() {
+        for (auto& free_list : free_lists) {
+            for (char* p : free_list) {
+                delete[] p;
+            }
+        }
+    }
+};
+
+}  // namespace
+
+static thread_local BlockPool g_block_pool;
+
+// Returns the size class index for a pooled capacity, or nullopt if unpooled.
+static std::optional<size_t> size_class(size_t capacity) {
+    if (capacity < kMinPooledAllocation || capacity > kMaxPooledAllocation) {
+        return std::nullopt;
+    }
+    if ((capacity & (capacity - 1)) != 0) {
+        return std::nullopt;
+    }
+    return log2_floor(capacity) - log2_floor(kMinPooledAllocation);
+}
+
+char* block_allocate(size_t* capacity) {
+    size_t size = *capacity;
+    if (size >= kMinPooledAllocation && size <= kMaxPooledAllocation) {
+        // Round up to the size class.
+        size_t rounded = kMinPooledAllocation;
+        while (rounded < size) {
+            rounded <<= 1;
+        }
+        *capacity = rounded;
+
+        auto& free_list = g_block_pool.free_lists[*size_class(rounded)];
+        if (!free_list.empty()) {
+            char* result = free_list.back();
+            free_list.pop_back();
+            return result;
+        }
+    }
+
+    // This isn't std::make_unique because that's equivalent to `new char[size]()`, which
+    // value-initializes the array instead of leaving it uninitialized. As an optimization,
+    // call new without parentheses to avoid this costly initialization.
+    return new char[*capacity];
+}
+
+void block_free(char* data, size_t capacity) {
+    if (std::optional<size_t> index = size_class(capacity); index) {
+        auto& free_list = g_block_pool.free_lists[*index];
+        if ((free_list.size() + 1) * capacity <= kMaxFreeBytesPerClass) {
+            free_list.push_back(data);
+            return;
+        }
+    }
+    delete[] data;
+}
+
+}  // namespace internal
+
 IOVector& IOVector::operator=(IOVector&& move) noexcept {
     chain_ = std::move(move.chain_);
     chain_length_ = move.chain_length_;
@@ -26,6 +112,37 @@ IOVector& IOVector::operator=(IOVector&& move) noexcept {
     return *this;
 }
 
+void IOVector::append(block_type&& block) {
+    if (block.size() == 0) {
+        return;
+    }
+
+    if (block.size() <= kCoalesceThreshold && !chain_.empty()) {
+        // Small fragment: copy it into the tail block's spare capacity rather than
+        // growing the chain, so a flood of tiny writes doesn't turn into an equally
+        // fragmented writev.
+        block_type& tail = chain_.back();
+        if (tail.capacity() - tail.size() >= block.size()) {
+            size_t offset = tail.size();
+            tail.resize(offset + block.size());
+            memcpy(tail.data() + offset, block.data(), block.size());
+            chain_length_ += block.size();
+            return;
+        }
+
+        // No room in the tail: start a staging block with space for more fragments.
+        block_type staging(kStagingBlockSize);
+        staging.resize(block.size());
+        memcpy(staging.data(), block.data(), block.size());
+        chain_length_ += staging.size();
+        chain_.emplace_back(std::move(staging));
+        return;
+    }
+
+    chain_length_ += block.size();
+    chain_.emplace_back(std::move(block));
+}
+
 IOVector::block_type IOVector::clear() {
     chain_length_ = 0;
     begin_offset_ = 0;
@@ -28,41 +28,69 @@
 #include "fdevent/fdevent.h"
 #include "sysdeps/uio.h"
 
+namespace internal {
+
+// Thread-local, size-classed pool of Block payload buffers.
+//
+// Packet payloads on the transport hot path are allocated and freed at a rate where
+// malloc/free shows up prominently in profiles. Buffers of common sizes are recycled
+// through per-thread freelists instead; since the freelists are thread-local, no
+// locking is needed, and a buffer freed on a different thread than it was allocated
+// on simply migrates to that thread's pool.
+//
+// Returns a buffer of at least *capacity bytes, updating *capacity to the actual
+// (size-class-rounded) capacity.
+char* block_allocate(size_t* capacity);
+
+// Returns a buffer previously obtained from block_allocate. `capacity` must be the
+// value block_allocate reported for it.
+void block_free(char* data, size_t capacity);
+
+}  // namespace internal
+
 // Essentially std::vector<char>, except without zero initialization or reallocation.
 struct Block {
     using iterator = char*;
 
+    // Blocks this small are stored inline instead of allocating: most of the packets on
+    // the wire are control traffic (A_OKAY, A_CLSE, shell window updates) whose payloads
+    // fit, and the allocator round trip costs more than copying the bytes on a move.
+    static constexpr size_t kInlineCapacity = 64;
+
     Block() = default;
 
     explicit Block(size_t size) { allocate(size); }
 
     template <typename Iterator>
     Block(Iterator begin, Iterator end) : Block(end - begin) {
-        std::copy(begin, end, data_.get());
+        std::copy(begin, end, data());
     }
 
     Block(const Block& copy) = delete;
-    Block(Block&& move) noexcept
-        : data_(std::exchange(move.data_, nullptr)),
-          capacity_(std::exchange(move.capacity_, 0)),
-          size_(std::exchange(move.size_, 0)) {}
+    Block(Block&& move) noexcept { take(move); }
 
     Block& operator=(const Block& copy) = delete;
     Block& operator=(Block&& move) noexcept {
         clear();
-        data_ = std::exchange(move.data_, nullptr);
-        capacity_ = std::exchange(move.capacity_, 0);
-        size_ = std::exchange(move.size_, 0);
+        take(move);
         return *this;
     }
 
-    ~Block() = default;
+    ~Block() { clear(); }
 
     void resize(size_t new_size) {
-        if (!data_) {
+        if (!data_ && capacity_ == 0) {
             allocate(new_size);
+        } else if (new_size <= capacity_) {
+            size_ = new_size;
         } else {
-            CHECK_GE(capacity_, new_size);
+            // Only inline blocks can grow: spill to an allocation, keeping the contents.
+            CHECK(is_inline());
+            size_t capacity = new_size;
+            std::unique_ptr<char[]> data(internal::block_allocate(&capacity));
+            memcpy(data.get(), inline_data_, size_);
+            data_ = std::move(data);
+            capacity_ = capacity;
             size_ = new_size;
         }
     }
@@ -71,11 +99,13 @@ struct Block {
     void assign(InputIt begin, InputIt end) {
         clear();
         allocate(end - begin);
-        std::copy(begin, end, data_.get());
+        std::copy(begin, end, data());
     }
 
     void clear() {
-        data_.reset();
+        if (data_) {
+            internal::block_free(data_.release(), capacity_);
+        }
         capacity_ = 0;
         size_ = 0;
     }
@@ -84,11 +114,13 @@ struct Block {
     size_t size() const { return size_; }
     bool empty() const { return size() == 0; }
 
-    char* data() { return data_.get(); }
-    const char* data() const { return data_.get(); }
+    char* data() { return data_ ? data_.get() : (capacity_ != 0 ? inline_data_ : nullptr); }
+    const char* data() const {
+        return data_ ? data_.get() : (capacity_ != 0 ? inline_data_ : nullptr);
+    }
 
-    char* begin() { return data_.get(); }
-    const char* begin() const { return data_.get(); }
+    char* begin() { return data(); }
+    const char* begin() const { return data(); }
 
     char* end() { return data() + size_; }
     const char* end() const { return data() + size_; }
@@ -101,23 +133,41 @@ struct Block {
     }
 
   private:
+    bool is_inline() const { return data_ == nullptr && capacity_ != 0; }
+
     void allocate(size_t size) {
         CHECK(data_ == nullptr);
         CHECK_EQ(0ULL, capacity_);
         CHECK_EQ(0ULL, size_);
-        if (size != 0) {
-            // This isn't std::make_unique because that's equivalent to `new char[size]()`, which
-            // value-initializes the array instead of leaving it uninitialized. As an optimization,
-            // call new without parentheses to avoid this costly initialization.
-            data_.reset(new char[size]);
-            capacity_ = size;
+        if (size == 0) {
+            return;
+        }
+        if (size <= kInlineCapacity) {
+            capacity_ = kInlineCapacity;
             size_ = size;
+            return;
+        }
+        size_t capacity = size;
+        data_.reset(internal::block_allocate(&capacity));
+        capacity_ = capacity;
+        size_ = size;
+    }
+
+    // Move the contents out of `move`, leaving it empty. An allocation changes hands;
+    // inline bytes are copied.
+    void take(Block& move) {
+        data_ = std::exchange(move.data_, nullptr);
+        capacity_ = std::exchange(move.capacity_, 0);
+        size_ = std::exchange(move.size_, 0);
+        if (is_inline()) {
+            memcpy(inline_data_, move.inline_data_, size_);
         }
     }
 
     std::unique_ptr<char[]> data_;
     size_t capacity_ = 0;
     size_t size_ = 0;
+    char inline_data_[kInlineCapacity];
 };
 
 struct amessage {
@@ -178,15 +228,17 @@ struct IOVector {
     // Split the first |len| bytes out of this chain into its own.
     IOVector take_front(size_type len);
 
-    // Add a nonempty block to the chain.
-    void append(block_type&& block) {
-        if (block.size() == 0) {
-            return;
-        }
-        CHECK_NE(0ULL, block.size());
-        chain_length_ += block.size();
-        chain_.emplace_back(std::move(block));
-    }
+    // Blocks smaller than this are copied into the tail of the chain (or into a
+    // fresh staging block) instead of being appended as fragments of their own.
+    // Interactive shell and logcat traffic produces floods of 16-64 byte chunks;
+    // without coalescing, every one of them becomes a separate iovec entry.
+    static constexpr size_type kCoalesceThreshold = 512;
+
+    // Capacity of the staging blocks that small fragments are coalesced into.
+    static constexpr size_type kStagingBlockSize = 4096;
+
+    // Add a nonempty block to the chain, coalescing small blocks into the tail.
+    void append(block_type&& block);
 
     void trim_front();
 
@@ -134,3 +134,80 @@ TEST(IOVector, drop_front) {
     ASSERT_EQ(1000U, vec.front_size());
     ASSERT_EQ(1000U, vec.size());
 }
+
+TEST(Block, pool_capacity_rounding) {
+    // Pooled allocations round their capacity up to the size class; tiny and huge
+    // allocations keep their exact capacity.
+    Block tiny(100);
+    ASSERT_EQ(100ULL, tiny.capacity());
+
+    Block pooled(5000);
+    ASSERT_EQ(5000ULL, pooled.size());
+    ASSERT_EQ(8192ULL, pooled.capacity());
+
+    Block huge(4 * 1024 * 1024 + 1);
+    ASSERT_EQ(4 * 1024 * 1024 + 1ULL, huge.capacity());
+}
+
+TEST(Block, pool_reuse) {
+    // A freed pooled buffer should be handed back out for a same-class allocation.
+    char* data;
+    {
+        Block block(65536);
+        data = block.data();
+    }
+    Block reused(65536);
+    ASSERT_EQ(data, reused.data());
+}
+
+TEST(Block, inline_storage) {
+    // Small blocks are stored inside the Block object itself, with no allocation.
+    Block small(16);
+    ASSERT_EQ(16ULL, small.size());
+    ASSERT_EQ(Block::kInlineCapacity, small.capacity());
+    ASSERT_GE(small.data(), reinterpret_cast<char*>(&small));
+    ASSERT_LT(small.data(), reinterpret_cast<char*>(&small + 1));
+
+    Block large(Block::kInlineCapacity + 1);
+    ASSERT_FALSE(large.data() >= reinterpret_cast<char*>(&large) &&
+                 large.data() < reinterpret_cast<char*>(&large + 1));
+}
+
+TEST(Block, inline_storage_move) {
+    // Moving an inline block copies its contents; the source is left empty.
+    auto block = create_block("foobar");
+    Block moved(std::move(block));
+    ASSERT_EQ(create_block("foobar"), moved);
+    ASSERT_TRUE(block.empty());
+
+    block = std::move(moved);
+    ASSERT_EQ(create_block("foobar"), block);
+}
+
+TEST(Block, inline_storage_spill) {
+    // Growing past the inline capacity spills to an allocation, keeping the contents.
+    auto block = create_block("foobar");
+    block.resize(Block::kInlineCapacity + 100);
+    ASSERT_EQ(Block::kInlineCapacity + 100ULL, block.size());
+    ASSERT_EQ(0, memcmp(block.data(), "foobar", strlen("foobar")));
+}
+
+TEST(IOVector, coalesce_small_fragments) {
+    // Small appended blocks should be merged instead of growing the iovec chain.
+    IOVector vec;
+    for (int i = 0; i < 64; ++i) {
+        vec.append(create_block('x', 64));
+    }
+    ASSERT_EQ(64ULL * 64, vec.size());
+    ASSERT_LE(vec.iovecs().size(), 2ULL);
+    ASSERT_EQ(create_block('x', 64 * 64), vec.coalesce());
+}
+
+TEST(IOVector, coalesce_large_blocks_zero_copy) {
+    // Blocks above the coalescing threshold must keep their identity (no copy).
+    IOVector vec;
+    auto block = create_block('y', 4096);
+    const char* data = block.data();
+    vec.append(std::move(block));
+    ASSERT_EQ(data, vec.front_data());
+}
@@ -19,10 +19,11 @@
 #include <dirent.h>
 #include <fcntl.h>
 #include <sys/stat.h>
-#include <utime.h>
+#include <unistd.h>
 
 #include <chrono>
 #include <cstdlib>
+#include <memory>
 #include <string>
 #include <utility>
 
@@ -35,14 +36,29 @@ namespace {
 
 const char BOOTSTAT_DATA_DIR[] = "/data/misc/bootstat/";
 
-// Given a boot even record file at |path|, extracts the event's relative time
-// from the record into |uptime|.
+// All records live in this single file under the store directory, one
+// "<event> <value>" line per record; later lines supersede earlier ones, so
+// logging an event is a single appending write instead of the
+// creat/stat/utime/close sequence the legacy one-file-per-event format needed.
+const char RECORD_LOG_NAME[] = "boot_event_log";
+
+// Appends are buffered in memory and written out once this many bytes
+// accumulate (or when the store is destroyed), batching the ~50 events of a
+// boot into a couple of write syscalls.
+const size_t kPendingFlushSize = 4096;
+
+// Once the record log grows beyond this many bytes of mostly-superseded
+// lines, it is rewritten with one line per live event at load time.
+const size_t kCompactionSize = 64 * 1024;
+
+// Given a legacy boot event record file at |path|, extracts the event's
+// relative time from the record into |uptime|. The legacy format stored the
+// value in the file's mtime.
 bool ParseRecordEventTime(const std::string& path, int32_t* uptime) {
   DCHECK_NE(static_cast<int32_t*>(nullptr), uptime);
 
   struct stat file_stat;
   if (stat(path.c_str(), &file_stat) == -1) {
-    PLOG(ERROR) << "Failed to read " << path;
     return false;
   }
 
@@ -57,94 +73,144 @@ BootEventRecordStore::BootEventRecordStore() {
   SetStorePath(BOOTSTAT_DATA_DIR);
 }
 
+BootEventRecordStore::~BootEventRecordStore() {
+  Flush();
+}
+
 void BootEventRecordStore::AddBootEvent(const std::string& event) {
   auto uptime = std::chrono::duration_cast<std::chrono::seconds>(
       android::base::boot_clock::now().time_since_epoch());
   AddBootEventWithValue(event, uptime.count());
 }
 
-// The implementation of AddBootEventValue makes use of the mtime file
-// attribute to store the value associated with a boot event in order to
-// optimize on-disk size requirements and small-file thrashing.
 void BootEventRecordStore::AddBootEventWithValue(const std::string& event, int32_t value) {
-  std::string record_path = GetBootEventPath(event);
-  int record_fd = creat(record_path.c_str(), S_IRUSR | S_IWUSR);
-  if (record_fd == -1) {
-    PLOG(ERROR) << "Failed to create " << record_path;
-    return;
-  }
-
-  // Fill out the stat structure for |record_path| in order to get the atime to
-  // set in the utime() call.
-  struct stat file_stat;
-  if (stat(record_path.c_str(), &file_stat) == -1) {
-    PLOG(ERROR) << "Failed to read " << record_path;
-    close(record_fd);
-    return;
-  }
-
-  // Set the |modtime| of the file to store the value of the boot event while
-  // preserving the |actime| (as read by stat).
-  struct utimbuf times = {/* actime */ file_stat.st_atime, /* modtime */ value};
-  if (utime(record_path.c_str(), &times) == -1) {
-    PLOG(ERROR) << "Failed to set mtime for " << record_path;
-    close(record_fd);
-    return;
+  index_[event] = value;
+  pending_ += event + ' ' + std::to_string(value) + '\n';
+  if (pending_.size() >= kPendingFlushSize) {
+    Flush();
   }
-
-  close(record_fd);
 }
 
 bool BootEventRecordStore::GetBootEvent(const std::string& event, BootEventRecord* record) const {
   CHECK_NE(static_cast<BootEventRecord*>(nullptr), record);
   CHECK(!event.empty());
 
-  const std::string record_path = GetBootEventPath(event);
+  auto it = index_.find(event);
+  if (it != index_.end()) {
+    *record = std::make_pair(it->first, it->second);
+    return true;
+  }
+
+  // A legacy record file may have appeared after the store was loaded.
   int32_t uptime;
-  if (!ParseRecordEventTime(record_path, &uptime)) {
-    LOG(ERROR) << "Failed to parse boot time record: " << record_path;
-    return false;
+  if (ParseRecordEventTime(GetBootEventPath(event), &uptime)) {
+    *record = std::make_pair(event, uptime);
+    return true;
   }
 
-  *record = std::make_pair(event, uptime);
-  return true;
+  return false;
 }
 
 std::vector<BootEventRecordStore::BootEventRecord> BootEventRecordStore::GetAllBootEvents() const {
   std::vector<BootEventRecord> events;
-
-  std::unique_ptr<DIR, decltype(&closedir)> dir(opendir(store_path_.c_str()), closedir);
-
-  // This case could happen due to external manipulation of the filesystem,
-  // so crash out if the record store doesn't exist.
-  CHECK_NE(static_cast<DIR*>(nullptr), dir.get());
-
-  struct dirent* entry;
-  while ((entry = readdir(dir.get())) != NULL) {
-    // Only parse regular files.
-    if (entry->d_type != DT_REG) {
-      continue;
-    }
-
-    const std::string event = entry->d_name;
-    BootEventRecord record;
-    if (!GetBootEvent(event, &record)) {
-      LOG(ERROR) << "Failed to parse boot time event: " << event;
-      continue;
-    }
-
-    events.push_back(record);
+  events.reserve(index_.size());
+  for (const auto& entry : index_) {
+    events.push_back(entry);
   }
-
   return events;
 }
 
 void BootEventRecordStore::SetStorePath(const std::string& path) {
   DCHECK_EQ('/', path.back());
   store_path_ = path;
+  LoadRecords();
 }
 
 std::string BootEventRecordStore::GetBootEventPath(const std::string& event) const {
   DCHECK_EQ('/', store_path_.back());
   return store_path_ + event;
 }
+
+void BootEventRecordStore::LoadRecords() {
+  index_.clear();
+  pending_.clear();
+
+  const std::string log_path = GetBootEventPath(RECORD_LOG_NAME);
+  record_fd_.reset(
+      open(log_path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR));
+  if (record_fd_ == -1) {
+    PLOG(ERROR) << "Failed to open " << log_path;
+  }
+
+  std::string contents;
+  if (android::base::ReadFileToString(log_path, &contents)) {
+    size_t pos = 0;
+    while (pos < contents.size()) {
+      size_t eol = contents.find('\n', pos);
+      if (eol == std::string::npos) break;
+      const std::string line = contents.substr(pos, eol - pos);
+      pos = eol + 1;
+
+      // The value follows the last space, so event names containing spaces
+      // round-trip correctly.
+      size_t split = line.rfind(' ');
+      int32_t value;
+      if (split == std::string::npos || split == 0 ||
+          !android::base::ParseInt(line.substr(split + 1), &value)) {
+        LOG(ERROR) << "Malformed boot event record: " << line;
+        continue;
+      }
+      index_[line.substr(0, split)] = value;
+    }
+  }
+
+  // Absorb records in the legacy one-file-per-event format, then remove them
+  // so the migration cost is only paid once.
+  std::unique_ptr<DIR, decltype(&closedir)> dir(opendir(store_path_.c_str()), closedir);
+  if (dir.get() != nullptr) {
+    struct dirent* entry;
+    while ((entry = readdir(dir.get())) != NULL) {
+      if (entry->d_type != DT_REG || RECORD_LOG_NAME == std::string(entry->d_name)) {
+        continue;
+      }
+
+      const std::string event = entry->d_name;
+      int32_t uptime;
+      if (!ParseRecordEventTime(GetBootEventPath(event), &uptime)) {
+        LOG(ERROR) << "Failed to parse legacy boot time event: " << event;
+        continue;
+      }
+
+      AddBootEventWithValue(event, uptime);
+      unlink(GetBootEventPath(event).c_str());
+    }
+  }
+
+  // Rewrite the log when it is dominated by superseded lines.
+  if (contents.size() >= kCompactionSize) {
+    std::string compacted;
+    for (const auto& entry : index_) {
+      compacted += entry.first + ' ' + std::to_string(entry.second) + '\n';
+    }
+    if (android::base::WriteStringToFile(compacted, log_path, S_IRUSR | S_IWUSR, getuid(),
+                                         getgid())) {
+      record_fd_.reset(
+          open(log_path.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC, S_IRUSR | S_IWUSR));
+      pending_.clear();
+    } else {
+      PLOG(ERROR) << "Failed to compact " << log_path;
+    }
+  }
+}
+
+void BootEventRecordStore::Flush() {
+  if (pending_.empty() || record_fd_ == -1) {
+    return;
+  }
+
+  if (!android::base::WriteStringToFd(pending_, record_fd_)) {
+    PLOG(ERROR) << "Failed to append boot event records";
+    return;
+  }
+  pending_.clear();
+}
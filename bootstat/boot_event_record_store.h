@@ -18,14 +18,18 @@
 #define BOOT_EVENT_RECORD_STORE_H_
 
 #include <android-base/macros.h>
+#include <android-base/unique_fd.h>
 #include <gtest/gtest_prod.h>
 #include <cstdint>
+#include <map>
 #include <string>
 #include <utility>
 #include <vector>
 
 // BootEventRecordStore manages the persistence of boot events to the record
-// store and the retrieval of all boot event records from the store.
+// store and the retrieval of all boot event records from the store. Records
+// are kept in a single append-only log file fronted by an in-memory index;
+// appends are batched and written out when the store is destroyed.
 class BootEventRecordStore {
  public:
   // A BootEventRecord consists of the event name and the timestamp the event
@@ -33,6 +37,7 @@ class BootEventRecordStore {
   typedef std::pair<std::string, int32_t> BootEventRecord;
 
   BootEventRecordStore();
+  ~BootEventRecordStore();
 
   // Persists the boot |event| in the record store.
   void AddBootEvent(const std::string& event);
@@ -56,16 +61,34 @@ class BootEventRecordStore {
   FRIEND_TEST(BootEventRecordStoreTest, AddBootEventWithValue);
   FRIEND_TEST(BootEventRecordStoreTest, GetBootEvent);
   FRIEND_TEST(BootEventRecordStoreTest, GetBootEventNoFileContent);
+  FRIEND_TEST(BootEventRecordStoreTest, PersistsAcrossInstances);
+  FRIEND_TEST(BootEventRecordStoreTest, MigratesLegacyRecords);
 
-  // Sets the filesystem path of the record store.
+  // Sets the filesystem path of the record store and loads the index from
+  // it, absorbing any records left in the legacy one-file-per-event format.
   void SetStorePath(const std::string& path);
 
   // Constructs the full path of the given boot |event|.
   std::string GetBootEventPath(const std::string& event) const;
 
+  // Loads the in-memory index from the record log and legacy record files.
+  void LoadRecords();
+
+  // Appends the buffered records to the record log.
+  void Flush();
+
   // The filesystem path of the record store.
   std::string store_path_;
 
+  // The latest value of every known event.
+  std::map<std::string, int32_t> index_;
+
+  // Records added but not yet appended to the record log.
+  std::string pending_;
+
+  // The record log, opened for appending.
+  android::base::unique_fd record_fd_;
+
   DISALLOW_COPY_AND_ASSIGN(BootEventRecordStore);
 };
 
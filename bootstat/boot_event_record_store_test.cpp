@@ -209,6 +209,51 @@ TEST_F(BootEventRecordStoreTest, GetBootEvent) {
   EXPECT_DEATH(store.GetBootEvent("carboniferous", nullptr), std::string());
 }
 
+// Tests that records written by one store instance are visible to a store
+// instance created later, i.e. that buffered records reach the record log.
+TEST_F(BootEventRecordStoreTest, PersistsAcrossInstances) {
+  {
+    BootEventRecordStore store;
+    store.SetStorePath(GetStorePathForTesting());
+    store.AddBootEventWithValue("ordovician", 485);
+    store.AddBootEventWithValue("ordovician", 486);
+  }
+
+  BootEventRecordStore store;
+  store.SetStorePath(GetStorePathForTesting());
+
+  BootEventRecordStore::BootEventRecord record;
+  bool result = store.GetBootEvent("ordovician", &record);
+  EXPECT_EQ(true, result);
+  EXPECT_EQ("ordovician", record.first);
+  EXPECT_EQ(486, record.second);
+}
+
+// Tests that legacy one-file-per-event records present when the store is
+// loaded are migrated into the record log and removed.
+TEST_F(BootEventRecordStoreTest, MigratesLegacyRecords) {
+  {
+    BootEventRecordStore store;
+    store.SetStorePath(GetStorePathForTesting());
+    EXPECT_TRUE(CreateEmptyBootEventRecord(store.GetBootEventPath("silurian"), 443));
+  }
+
+  BootEventRecordStore store;
+  store.SetStorePath(GetStorePathForTesting());
+
+  BootEventRecordStore::BootEventRecord record;
+  bool result = store.GetBootEvent("silurian", &record);
+  EXPECT_EQ(true, result);
+  EXPECT_EQ("silurian", record.first);
+  EXPECT_EQ(443, record.second);
+
+  // The legacy record file is gone; only the record log remains.
+  EXPECT_EQ(-1, access(store.GetBootEventPath("silurian").c_str(), F_OK));
+
+  auto events = store.GetAllBootEvents();
+  ASSERT_EQ(1U, events.size());
+}
+
 // Tests that the BootEventRecordStore is capable of handling an older record
 // protocol which does not contain file contents.
 TEST_F(BootEventRecordStoreTest, GetBootEventNoFileContent) {
@@ -154,9 +154,8 @@ const std::unordered_map<std::string_view, AtomInfo> kBootEventToAtomInfo = {
 
 // Scans the boot event record store for record files and logs each boot event
 // via EventLog.
-void LogBootEvents() {
-  BootEventRecordStore boot_event_store;
-  auto events = boot_event_store.GetAllBootEvents();
+void LogBootEvents(BootEventRecordStore* boot_event_store) {
+  auto events = boot_event_store->GetAllBootEvents();
   std::vector<std::string_view> notSupportedEvents;
   for (const auto& event : events) {
     const auto& name = event.first;
@@ -184,24 +183,23 @@ void LogBootEvents() {
 // Records the named boot |event| to the record store. If |value| is non-empty
 // and is a proper string representation of an integer value, the converted
 // integer value is associated with the boot event.
-void RecordBootEventFromCommandLine(const std::string& event, const std::string& value_str) {
-  BootEventRecordStore boot_event_store;
+void RecordBootEventFromCommandLine(BootEventRecordStore* boot_event_store,
+                                    const std::string& event, const std::string& value_str) {
   if (!value_str.empty()) {
     int32_t value = 0;
     if (android::base::ParseInt(value_str, &value)) {
-      boot_event_store.AddBootEventWithValue(event, value);
+      boot_event_store->AddBootEventWithValue(event, value);
     }
   } else {
-    boot_event_store.AddBootEvent(event);
+    boot_event_store->AddBootEvent(event);
   }
 }
 
-void PrintBootEvents() {
+void PrintBootEvents(BootEventRecordStore* boot_event_store) {
   printf("Boot events:\n");
   printf("------------\n");
 
-  BootEventRecordStore boot_event_store;
-  auto events = boot_event_store.GetAllBootEvents();
+  auto events = boot_event_store->GetAllBootEvents();
   for (auto i = events.cbegin(); i != events.cend(); ++i) {
     printf("%s\t%d\n", i->first.c_str(), i->second);
   }
@@ -1104,7 +1102,7 @@ std::string BootReasonStrToReason(const std::string& boot_reason) {
 // bookkeeping required to track when a system update has occurred by storing
 // the UTC timestamp of the system build date and comparing against the current
 // system build date.
-std::string CalculateBootCompletePrefix() {
+std::string CalculateBootCompletePrefix(BootEventRecordStore* boot_event_store) {
   static const std::string kBuildDateKey = "build_date";
   std::string boot_complete_prefix = "boot_complete";
 
@@ -1114,15 +1112,14 @@ std::string CalculateBootCompletePrefix() {
     return std::string();
   }
 
-  BootEventRecordStore boot_event_store;
   BootEventRecordStore::BootEventRecord record;
-  if (!boot_event_store.GetBootEvent(kBuildDateKey, &record)) {
+  if (!boot_event_store->GetBootEvent(kBuildDateKey, &record)) {
     boot_complete_prefix = "factory_reset_" + boot_complete_prefix;
-    boot_event_store.AddBootEventWithValue(kBuildDateKey, build_date);
+    boot_event_store->AddBootEventWithValue(kBuildDateKey, build_date);
     BootReasonAddToHistory("reboot,factory_reset");
   } else if (build_date != record.second) {
     boot_complete_prefix = "ota_" + boot_complete_prefix;
-    boot_event_store.AddBootEventWithValue(kBuildDateKey, build_date);
+    boot_event_store->AddBootEventWithValue(kBuildDateKey, build_date);
     BootReasonAddToHistory("reboot,ota");
   }
 
@@ -1278,8 +1275,7 @@ android::base::boot_clock::duration GetUptime() {
 
 // Records several metrics related to the time it takes to boot the device,
 // including disambiguating boot time on encrypted or non-encrypted devices.
-void RecordBootComplete() {
-  BootEventRecordStore boot_event_store;
+void RecordBootComplete(BootEventRecordStore* boot_event_store) {
   BootEventRecordStore::BootEventRecord record;
 
   auto uptime_ns = GetUptime();
@@ -1287,55 +1283,55 @@ void RecordBootComplete() {
   time_t current_time_utc = time(nullptr);
   time_t time_since_last_boot = 0;
 
-  if (boot_event_store.GetBootEvent("last_boot_time_utc", &record)) {
+  if (boot_event_store->GetBootEvent("last_boot_time_utc", &record)) {
     time_t last_boot_time_utc = record.second;
     time_since_last_boot = difftime(current_time_utc, last_boot_time_utc);
-    boot_event_store.AddBootEventWithValue("time_since_last_boot", time_since_last_boot);
+    boot_event_store->AddBootEventWithValue("time_since_last_boot", time_since_last_boot);
   }
 
-  boot_event_store.AddBootEventWithValue("last_boot_time_utc", current_time_utc);
+  boot_event_store->AddBootEventWithValue("last_boot_time_utc", current_time_utc);
 
   // The boot_complete metric has two variants: boot_complete and
   // ota_boot_complete.  The latter signifies that the device is booting after
   // a system update.
-  std::string boot_complete_prefix = CalculateBootCompletePrefix();
+  std::string boot_complete_prefix = CalculateBootCompletePrefix(boot_event_store);
   if (boot_complete_prefix.empty()) {
     // The system is hosed because the build date property could not be read.
     return;
   }
 
   // post_decrypt_time_elapsed is only logged on encrypted devices.
-  if (boot_event_store.GetBootEvent("post_decrypt_time_elapsed", &record)) {
+  if (boot_event_store->GetBootEvent("post_decrypt_time_elapsed", &record)) {
     // Log the amount of time elapsed until the device is decrypted, which
     // includes the variable amount of time the user takes to enter the
     // decryption password.
-    boot_event_store.AddBootEventWithValue("boot_decryption_complete", uptime_s.count());
+    boot_event_store->AddBootEventWithValue("boot_decryption_complete", uptime_s.count());
 
     // Subtract the decryption time to normalize the boot cycle timing.
     std::chrono::seconds boot_complete = std::chrono::seconds(uptime_s.count() - record.second);
-    boot_event_store.AddBootEventWithValue(boot_complete_prefix + "_post_decrypt",
+    boot_event_store->AddBootEventWithValue(boot_complete_prefix + "_post_decrypt",
                                            boot_complete.count());
   } else {
-    boot_event_store.AddBootEventWithValue(boot_complete_prefix + "_no_encryption",
+    boot_event_store->AddBootEventWithValue(boot_complete_prefix + "_no_encryption",
                                            uptime_s.count());
   }
 
   // Record the total time from device startup to boot complete, regardless of
   // encryption state.
-  boot_event_store.AddBootEventWithValue(boot_complete_prefix, uptime_s.count());
+  boot_event_store->AddBootEventWithValue(boot_complete_prefix, uptime_s.count());
 
-  RecordInitBootTimeProp(&boot_event_store, "ro.boottime.init");
-  RecordInitBootTimeProp(&boot_event_store, "ro.boottime.init.first_stage");
-  RecordInitBootTimeProp(&boot_event_store, "ro.boottime.init.selinux");
-  RecordInitBootTimeProp(&boot_event_store, "ro.boottime.init.cold_boot_wait");
+  RecordInitBootTimeProp(boot_event_store, "ro.boottime.init");
+  RecordInitBootTimeProp(boot_event_store, "ro.boottime.init.first_stage");
+  RecordInitBootTimeProp(boot_event_store, "ro.boottime.init.selinux");
+  RecordInitBootTimeProp(boot_event_store, "ro.boottime.init.cold_boot_wait");
 
   const BootloaderTimingMap bootloader_timings = GetBootLoaderTimings();
   int32_t bootloader_boot_duration = GetBootloaderTime(bootloader_timings);
-  RecordBootloaderTimings(&boot_event_store, bootloader_timings);
+  RecordBootloaderTimings(boot_event_store, bootloader_timings);
 
   auto uptime_ms = std::chrono::duration_cast<std::chrono::milliseconds>(uptime_ns);
   auto absolute_boot_time = GetAbsoluteBootTime(bootloader_timings, uptime_ms);
-  RecordAbsoluteBootTime(&boot_event_store, absolute_boot_time);
+  RecordAbsoluteBootTime(boot_event_store, absolute_boot_time);
 
   auto boot_end_time_point = std::chrono::system_clock::now().time_since_epoch();
   auto boot_end_time = std::chrono::duration_cast<std::chrono::milliseconds>(boot_end_time_point);
@@ -1346,7 +1342,7 @@ void RecordBootComplete() {
 
 // Records the boot_reason metric by querying the ro.boot.bootreason system
 // property.
-void RecordBootReason() {
+void RecordBootReason(BootEventRecordStore* boot_event_store) {
   const auto reason = android::base::GetProperty(bootloader_reboot_reason_property, "");
 
   if (reason.empty()) {
@@ -1365,13 +1361,12 @@ void RecordBootReason() {
 
   // Log the raw bootloader_boot_reason property value.
   int32_t boot_reason = BootReasonStrToEnum(reason);
-  BootEventRecordStore boot_event_store;
-  boot_event_store.AddBootEventWithValue("boot_reason", boot_reason);
+  boot_event_store->AddBootEventWithValue("boot_reason", boot_reason);
 
   // Log the scrubbed system_boot_reason.
   const auto system_reason = android::base::GetProperty(system_reboot_reason_property, "");
   int32_t system_boot_reason = BootReasonStrToEnum(system_reason);
-  boot_event_store.AddBootEventWithValue("system_boot_reason", system_boot_reason);
+  boot_event_store->AddBootEventWithValue("system_boot_reason", system_boot_reason);
 
   if (reason == "") {
     android::base::SetProperty(bootloader_reboot_reason_property, system_reason);
@@ -1381,8 +1376,7 @@ void RecordBootReason() {
 // Records two metrics related to the user resetting a device: the time at
 // which the device is reset, and the time since the user last reset the
 // device.  The former is only set once per-factory reset.
-void RecordFactoryReset() {
-  BootEventRecordStore boot_event_store;
+void RecordFactoryReset(BootEventRecordStore* boot_event_store) {
   BootEventRecordStore::BootEventRecord record;
 
   time_t current_time_utc = time(nullptr);
@@ -1398,7 +1392,7 @@ void RecordFactoryReset() {
 
     // Logging via BootEventRecordStore to see if using android::metricslogger::LogHistogram
     // is losing records somehow.
-    boot_event_store.AddBootEventWithValue("factory_reset_current_time_failure",
+    boot_event_store->AddBootEventWithValue("factory_reset_current_time_failure",
                                            std::abs(current_time_utc));
     return;
   } else {
@@ -1410,13 +1404,13 @@ void RecordFactoryReset() {
 
     // Logging via BootEventRecordStore to see if using android::metricslogger::LogHistogram
     // is losing records somehow.
-    boot_event_store.AddBootEventWithValue("factory_reset_current_time", current_time_utc);
+    boot_event_store->AddBootEventWithValue("factory_reset_current_time", current_time_utc);
   }
 
   // The factory_reset boot event does not exist after the device is reset, so
   // use this signal to mark the time of the factory reset.
-  if (!boot_event_store.GetBootEvent("factory_reset", &record)) {
-    boot_event_store.AddBootEventWithValue("factory_reset", current_time_utc);
+  if (!boot_event_store->GetBootEvent("factory_reset", &record)) {
+    boot_event_store->AddBootEventWithValue("factory_reset", current_time_utc);
 
     // Don't log the time_since_factory_reset until some time has elapsed.
     // The data is not meaningful yet and skews the histogram buckets.
@@ -1434,10 +1428,10 @@ void RecordFactoryReset() {
 
   // Logging via BootEventRecordStore to see if using android::metricslogger::LogHistogram
   // is losing records somehow.
-  boot_event_store.AddBootEventWithValue("factory_reset_record_value", factory_reset_utc);
+  boot_event_store->AddBootEventWithValue("factory_reset_record_value", factory_reset_utc);
 
   time_t time_since_factory_reset = difftime(current_time_utc, factory_reset_utc);
-  boot_event_store.AddBootEventWithValue("time_since_factory_reset", time_since_factory_reset);
+  boot_event_store->AddBootEventWithValue("time_since_factory_reset", time_since_factory_reset);
 }
 
 // List the associated boot reason(s), if arg is nullptr then all.
@@ -1484,6 +1478,10 @@ int main(int argc, char** argv) {
       // clang-format on
   };
 
+  // One record store shared by every action in this invocation, so a batched
+  // command line (as used by bootstat.rc) loads and flushes the store once.
+  BootEventRecordStore boot_event_store;
+
   std::string boot_event;
   std::string value;
   int opt = 0;
@@ -1499,11 +1497,11 @@ int main(int argc, char** argv) {
         } else if (option_name == system_boot_reason_str) {
           SetSystemBootReason();
         } else if (option_name == boot_complete_str) {
-          RecordBootComplete();
+          RecordBootComplete(&boot_event_store);
         } else if (option_name == boot_reason_str) {
-          RecordBootReason();
+          RecordBootReason(&boot_event_store);
         } else if (option_name == factory_reset_str) {
-          RecordFactoryReset();
+          RecordFactoryReset(&boot_event_store);
         } else if (option_name == boot_reason_enum_str) {
           PrintBootReasonEnum(optarg);
         } else {
@@ -1518,12 +1516,12 @@ int main(int argc, char** argv) {
       }
 
       case 'l': {
-        LogBootEvents();
+        LogBootEvents(&boot_event_store);
         break;
       }
 
       case 'p': {
-        PrintBootEvents();
+        PrintBootEvents(&boot_event_store);
         break;
       }
 
@@ -1547,7 +1545,7 @@ int main(int argc, char** argv) {
   }
 
   if (!boot_event.empty()) {
-    RecordBootEventFromCommandLine(boot_event, value);
+    RecordBootEventFromCommandLine(&boot_event_store, boot_event, value);
   }
 
   return 0;
@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <bootstat/bootstat.h>
+
+#include "boot_event_record_store.h"
+
+namespace android {
+namespace bootstat {
+
+// A store is opened per call rather than held open: callers log rarely, and
+// a short-lived store keeps the record log consistent with concurrent
+// bootstat invocations (the store flushes on destruction).
+
+void LogBootEvent(const std::string& event) {
+  BootEventRecordStore boot_event_store;
+  boot_event_store.AddBootEvent(event);
+}
+
+void LogBootEventWithValue(const std::string& event, int32_t value) {
+  BootEventRecordStore boot_event_store;
+  boot_event_store.AddBootEventWithValue(event, value);
+}
+
+}  // namespace bootstat
+}  // namespace android
@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BOOTSTAT_BOOTSTAT_H_
+#define BOOTSTAT_BOOTSTAT_H_
+
+#include <cstdint>
+#include <string>
+
+// In-process boot event logging for daemons that link libbootstat, so
+// recording an event does not require forking /system/bin/bootstat. These
+// are equivalent to "bootstat -r <event>" / "bootstat -r <event>
+// --value <value>"; the caller needs write access to /data/misc/bootstat.
+
+namespace android {
+namespace bootstat {
+
+// Records the boot |event| with the current uptime in the record store.
+void LogBootEvent(const std::string& event);
+
+// Records the boot |event| with the given |value| in the record store.
+void LogBootEventWithValue(const std::string& event, int32_t value);
+
+}  // namespace bootstat
+}  // namespace android
+
+#endif  // BOOTSTAT_BOOTSTAT_H_
@@ -42,6 +42,8 @@ struct fs_config_entry {
 };
 
 static struct fs_config_entry* canned_config = NULL;
+static int canned_used = 0;
+static struct fs_config_entry* empty_path_config = NULL;
 static char *target_out_path = NULL;
 
 /* Each line in the canned file should be a path plus three ints (uid,
@@ -57,25 +59,28 @@ static char *target_out_path = NULL;
 static int verbose = 0;
 static int total_size = 0;
 
+static int compare_canned(const void* a, const void* b)
+{
+    return strcmp(((const struct fs_config_entry*)a)->name,
+                  ((const struct fs_config_entry*)b)->name);
+}
+
 static void fix_stat(const char *path, struct stat *s)
 {
     uint64_t capabilities;
     if (canned_config) {
         // Use the list of file uid/gid/modes loaded from the file
-        // given with -f.
-
-        struct fs_config_entry* empty_path_config = NULL;
-        struct fs_config_entry* p;
-        for (p = canned_config; p->name; ++p) {
-            if (!p->name[0]) {
-                empty_path_config = p;
-            }
-            if (strcmp(p->name, path) == 0) {
-                s->st_uid = p->uid;
-                s->st_gid = p->gid;
-                s->st_mode = p->mode | (s->st_mode & ~07777);
-                return;
-            }
+        // given with -f.  The list is sorted by name after loading,
+        // so each entry is a binary search rather than a linear scan.
+
+        struct fs_config_entry key = { .name = (char*) path };
+        struct fs_config_entry* p = bsearch(&key, canned_config, canned_used,
+                                            sizeof(*canned_config), compare_canned);
+        if (p) {
+            s->st_uid = p->uid;
+            s->st_gid = p->gid;
+            s->st_mode = p->mode | (s->st_mode & ~07777);
+            return;
         }
         s->st_uid = empty_path_config->uid;
         s->st_gid = empty_path_config->gid;
@@ -325,6 +330,14 @@ static void read_canned_config(char* filename)
         if (canned_config == NULL) die("failed to reallocate memory");
     }
     canned_config[used].name = NULL;
+    canned_used = used;
+
+    // Sort for the bsearch in fix_stat; the default (empty path) entry
+    // sorts first, look it up once here rather than per file.
+    qsort(canned_config, canned_used, sizeof(*canned_config), compare_canned);
+    if (canned_used > 0 && !canned_config[0].name[0]) {
+        empty_path_config = &canned_config[0];
+    }
 
     fclose(f);
 }
@@ -332,6 +345,11 @@ static void read_canned_config(char* filename)
 
 int main(int argc, char *argv[])
 {
+    // A ramdisk is tens of megabytes of mostly small entries; give stdio a
+    // large output buffer so the archive goes out in big writes instead of
+    // one small write per header, pad and file body.
+    setvbuf(stdout, NULL, _IOFBF, 1024 * 1024);
+
     argc--;
     argv++;
 
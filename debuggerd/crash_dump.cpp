@@ -195,6 +195,7 @@ static pid_t g_target_thread = -1;
 static bool g_tombstoned_connected = false;
 static unique_fd g_tombstoned_socket;
 static unique_fd g_output_fd;
+static unique_fd g_record_fd;
 
 static void DefuseSignalHandlers() {
   // Don't try to dump ourselves.
@@ -439,16 +440,6 @@ int main(int argc, char** argv) {
   //       unwind, do not make this too small. b/62828735
   alarm(30);
 
-  // Get the process name (aka cmdline).
-  std::string process_name = get_process_name(g_target_thread);
-
-  // Collect the list of open files.
-  OpenFilesList open_files;
-  {
-    ATRACE_NAME("open files");
-    populate_open_files_list(&open_files, g_target_thread);
-  }
-
   // In order to reduce the duration that we pause the process for, we ptrace
   // the threads, fetch their registers and associated information, and then
   // fork a separate process as a snapshot of the process's address space.
@@ -478,7 +469,6 @@ int main(int argc, char** argv) {
       info.pid = target_process;
       info.tid = thread;
       info.uid = getuid();
-      info.process_name = process_name;
       info.thread_name = get_thread_name(thread);
 
       if (!ptrace_interrupt(thread, &info.signo)) {
@@ -516,6 +506,24 @@ int main(int argc, char** argv) {
     }
   }
 
+  // Scan /proc for everything else we need now that the threads are stopped.
+  // These reads can take tens of milliseconds for fd-heavy processes, so they
+  // happen after the seize to keep the time from crash to thread inspection
+  // short; the state they capture is the same either way.
+
+  // Get the process name (aka cmdline).
+  std::string process_name = get_process_name(g_target_thread);
+  for (auto& [tid, thread] : thread_info) {
+    thread.process_name = process_name;
+  }
+
+  // Collect the list of open files.
+  OpenFilesList open_files;
+  {
+    ATRACE_NAME("open files");
+    populate_open_files_list(&open_files, g_target_thread);
+  }
+
   // Trace the pseudothread with PTRACE_O_TRACECLONE and tell it to fork.
   if (!ptrace_seize_thread(target_proc_fd, pseudothread_tid, &error, PTRACE_O_TRACECLONE)) {
     LOG(FATAL) << "failed to seize pseudothread: " << error;
@@ -561,8 +569,8 @@ int main(int argc, char** argv) {
   {
     ATRACE_NAME("tombstoned_connect");
     LOG(INFO) << "obtaining output fd from tombstoned, type: " << dump_type;
-    g_tombstoned_connected =
-        tombstoned_connect(g_target_thread, &g_tombstoned_socket, &g_output_fd, dump_type);
+    g_tombstoned_connected = tombstoned_connect(g_target_thread, &g_tombstoned_socket, &g_output_fd,
+                                                &g_record_fd, dump_type);
   }
 
   if (g_tombstoned_connected) {
@@ -615,8 +623,8 @@ int main(int argc, char** argv) {
 
     {
       ATRACE_NAME("engrave_tombstone");
-      engrave_tombstone(std::move(g_output_fd), &unwinder, thread_info, g_target_thread, process_info,
-                        &open_files, &amfd_data);
+      engrave_tombstone(std::move(g_output_fd), std::move(g_record_fd), &unwinder, vm_pid,
+                        thread_info, g_target_thread, process_info, &open_files, &amfd_data);
     }
   }
 
@@ -18,11 +18,14 @@
 #include <errno.h>
 #include <sched.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
+#include <atomic>
 #include <chrono>
 #include <thread>
+#include <vector>
 
 #include <benchmark/benchmark.h>
 #include <debuggerd/client.h>
@@ -63,7 +66,10 @@ static std::chrono::duration<double> GetMaximumPause(std::atomic<ThreadState>& s
   return max_diff;
 }
 
-static void PerformDump() {
+static void PerformDump(DebuggerdDumpType dump_type) {
+  // Tombstones of processes with many threads can legitimately take a while.
+  int timeout_ms = (dump_type == kDebuggerdTombstone) ? 10000 : 1000;
+
   pid_t target = getpid();
   pid_t forkpid = fork();
   if (forkpid == -1) {
@@ -84,7 +90,7 @@ static void PerformDump() {
       err(1, "failed to open /dev/null");
     }
 
-    if (!debuggerd_trigger_dump(target, kDebuggerdNativeBacktrace, 1000, std::move(output_fd))) {
+    if (!debuggerd_trigger_dump(target, dump_type, timeout_ms, std::move(output_fd))) {
       errx(1, "failed to trigger dump");
     }
 
@@ -119,10 +125,78 @@ static void BM_maximum_pause_noop(benchmark::State& state) {
 }
 
 static void BM_maximum_pause_debuggerd(benchmark::State& state) {
-  BM_maximum_pause_impl(state, []() { PerformDump(); });
+  BM_maximum_pause_impl(state, []() { PerformDump(kDebuggerdNativeBacktrace); });
+}
+
+// End-to-end `debuggerd -b` latency: signal delivery, crash_dump attach,
+// unwind, and the result making it back to the requester.
+static void BM_backtrace_latency(benchmark::State& state) {
+  for (auto _ : state) {
+    PerformDump(kDebuggerdNativeBacktrace);
+  }
+}
+
+// Tombstone generation time as a function of how many sibling threads have
+// to be unwound.
+static void BM_tombstone_latency_threads(benchmark::State& state) {
+  std::atomic<bool> stop(false);
+  std::vector<std::thread> threads;
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    threads.emplace_back([&stop]() {
+      while (!stop.load()) {
+        std::this_thread::sleep_for(100ms);
+      }
+    });
+  }
+
+  for (auto _ : state) {
+    PerformDump(kDebuggerdTombstone);
+  }
+
+  stop.store(true);
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+// Backtrace latency as a function of map count, to catch regressions in
+// /proc/<pid>/maps parsing.
+static void BM_backtrace_latency_maps(benchmark::State& state) {
+  std::vector<void*> maps;
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    // Alternate protections so that the kernel can't merge adjacent mappings.
+    void* map = mmap(nullptr, getpagesize(), (i % 2 == 0) ? PROT_NONE : PROT_READ,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) {
+      state.SkipWithError("failed to mmap");
+      break;
+    }
+    maps.push_back(map);
+  }
+
+  for (auto _ : state) {
+    PerformDump(kDebuggerdNativeBacktrace);
+  }
+
+  for (void* map : maps) {
+    munmap(map, getpagesize());
+  }
 }
 
 BENCHMARK(BM_maximum_pause_noop)->Iterations(128)->UseManualTime();
 BENCHMARK(BM_maximum_pause_debuggerd)->Iterations(128)->UseManualTime();
-
+BENCHMARK(BM_backtrace_latency)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_tombstone_latency_threads)
+    ->Arg(1)
+    ->Arg(8)
+    ->Arg(32)
+    ->Arg(128)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_backtrace_latency_maps)
+    ->Arg(0)
+    ->Arg(1024)
+    ->Arg(8192)
+    ->Unit(benchmark::kMillisecond);
+
+// Pass --benchmark_format=json for machine-readable output.
 BENCHMARK_MAIN();
@@ -624,6 +624,14 @@ void debuggerd_init(debuggerd_callbacks_t* callbacks) {
     fatal_errno("failed to mprotect debuggerd thread stack");
   }
 
+  // Pin the stack so that the crash path doesn't have to fault it in (or worse,
+  // wait for it to be swapped back in under memory pressure). This can fail if
+  // the process is already at RLIMIT_MEMLOCK, in which case we just take our
+  // chances; don't log, since this runs during the startup of every process.
+  mlock(stack, PAGE_SIZE * thread_stack_pages);
+  prctl(PR_SET_VMA, PR_SET_VMA_ANON_NAME, thread_stack_allocation,
+        PAGE_SIZE * (thread_stack_pages + 2), "debuggerd pseudothread stack");
+
   // Stack grows negatively, set it to the last byte in the page...
   stack = (stack + thread_stack_pages * PAGE_SIZE - 1);
   // and align it.
@@ -43,8 +43,14 @@ constexpr size_t kMaxFrames = 256;
  */
 int open_tombstone(std::string* path);
 
-/* Creates a tombstone file and writes the crash dump to it. */
-void engrave_tombstone(android::base::unique_fd output_fd, unwindstack::Unwinder* unwinder,
+/* Creates a tombstone file and writes the crash dump to it.
+ * |unwind_pid| is the pid |unwinder| was created for; it is used to build
+ * additional unwinders when sibling threads are unwound in parallel.
+ * If |record_fd| is valid, a structured copy of the dump (see
+ * tombstone_record.h) is streamed to it as the dump proceeds.
+ */
+void engrave_tombstone(android::base::unique_fd output_fd, android::base::unique_fd record_fd,
+                       unwindstack::Unwinder* unwinder, pid_t unwind_pid,
                        const std::map<pid_t, ThreadInfo>& thread_info, pid_t target_thread,
                        const ProcessInfo& process_info, OpenFilesList* open_files,
                        std::string* amfd_data);
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <string>
+
+// Structured tombstone output, for consumers that would otherwise have to
+// regex-parse the text tombstone.
+//
+// The file is a TombstoneRecordFileHeader followed by a sequence of
+// length-delimited records, each a TombstoneRecordHeader followed by
+// |size| bytes of payload. The payload is one of the fixed-layout structs
+// below, with its variable-length strings appended directly after it (their
+// lengths are in the struct). Records are written incrementally as the dump
+// proceeds, so a file truncated by a killed crash_dump is still parseable up
+// to the truncation point. All fields are in the byte order of the crashing
+// process.
+
+constexpr uint32_t kTombstoneRecordMagic = 0x30524254;  // "TBR0"
+constexpr uint32_t kTombstoneRecordVersion = 1;
+
+struct __attribute__((__packed__)) TombstoneRecordFileHeader {
+  uint32_t magic;
+  uint32_t version;
+};
+
+enum class TombstoneRecordType : uint32_t {
+  kProcess = 1,
+  kMap = 2,
+  kThread = 3,
+  kFrame = 4,
+};
+
+struct __attribute__((__packed__)) TombstoneRecordHeader {
+  TombstoneRecordType type;
+  uint32_t size;
+};
+
+// One per file, first record. Followed by the process name.
+struct __attribute__((__packed__)) TombstoneProcessRecord {
+  int32_t pid;
+  int32_t crashing_tid;
+  uint32_t uid;
+  int32_t signo;
+  int32_t si_code;
+  uint64_t fault_address;
+  uint32_t process_name_len;
+};
+
+// One per mapping. Followed by the map name.
+struct __attribute__((__packed__)) TombstoneMapRecord {
+  uint64_t start;
+  uint64_t end;
+  uint64_t offset;
+  uint32_t flags;
+  uint32_t name_len;
+};
+
+// One per thread, followed by that thread's kFrame records in call order.
+// Followed by the thread name.
+struct __attribute__((__packed__)) TombstoneThreadRecord {
+  int32_t tid;
+  uint32_t frame_count;
+  uint32_t name_len;
+};
+
+// Followed by the function name, then the map name.
+struct __attribute__((__packed__)) TombstoneFrameRecord {
+  uint32_t num;
+  uint64_t pc;
+  uint64_t rel_pc;
+  uint64_t sp;
+  uint64_t function_offset;
+  uint64_t map_start;
+  uint64_t map_end;
+  uint32_t function_name_len;
+  uint32_t map_name_len;
+};
+
+class TombstoneRecordWriter {
+ public:
+  // Writes the file header. |fd| is borrowed, not owned.
+  explicit TombstoneRecordWriter(int fd);
+
+  // Writes one record; |strings| holds the variable-length tails declared in
+  // the record struct, already concatenated in declaration order. Becomes a
+  // no-op after the first failure.
+  bool Write(TombstoneRecordType type, const void* record, size_t record_size,
+             const std::string& strings);
+
+ private:
+  int fd_;
+  bool ok_;
+};
@@ -32,8 +32,13 @@
 #include <sys/stat.h>
 #include <time.h>
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <android-base/file.h>
 #include <android-base/logging.h>
@@ -57,6 +62,7 @@
 #include "libdebuggerd/gwp_asan.h"
 #include "libdebuggerd/open_files_list.h"
 #include "libdebuggerd/scudo.h"
+#include "libdebuggerd/tombstone_record.h"
 #include "libdebuggerd/utility.h"
 #include "util.h"
 
@@ -369,7 +375,8 @@ void dump_memory_and_code(log_t* log, unwindstack::Maps* maps, unwindstack::Memo
 }
 
 static bool dump_thread(log_t* log, unwindstack::Unwinder* unwinder, const ThreadInfo& thread_info,
-                        const ProcessInfo& process_info, bool primary_thread) {
+                        const ProcessInfo& process_info, bool primary_thread,
+                        bool already_unwound) {
   log->current_tid = thread_info.tid;
   if (!primary_thread) {
     _LOG(log, logtype::THREAD, "--- --- --- --- --- --- --- --- --- --- --- --- --- --- --- ---\n");
@@ -402,10 +409,12 @@ static bool dump_thread(log_t* log, unwindstack::Unwinder* unwinder, const Threa
 
   dump_registers(log, thread_info.registers.get());
 
-  // Unwind will mutate the registers, so make a copy first.
-  std::unique_ptr<unwindstack::Regs> regs_copy(thread_info.registers->Clone());
-  unwinder->SetRegs(regs_copy.get());
-  unwinder->Unwind();
+  if (!already_unwound) {
+    // Unwind will mutate the registers, so make a copy first.
+    std::unique_ptr<unwindstack::Regs> regs_copy(thread_info.registers->Clone());
+    unwinder->SetRegs(regs_copy.get());
+    unwinder->Unwind();
+  }
   if (unwinder->NumFrames() == 0) {
     _LOG(log, logtype::THREAD, "Failed to unwind\n");
     if (unwinder->LastErrorCode() != unwindstack::ERROR_NONE) {
@@ -589,14 +598,106 @@ void engrave_tombstone_ucontext(int tombstone_fd, uint64_t abort_msg_address, si
 
   ProcessInfo process_info;
   process_info.abort_msg_address = abort_msg_address;
-  engrave_tombstone(unique_fd(dup(tombstone_fd)), &unwinder, threads, tid, process_info, nullptr,
-                    nullptr);
+  engrave_tombstone(unique_fd(dup(tombstone_fd)), unique_fd(), &unwinder, pid, threads, tid,
+                    process_info, nullptr, nullptr);
 }
 
-void engrave_tombstone(unique_fd output_fd, unwindstack::Unwinder* unwinder,
-                       const std::map<pid_t, ThreadInfo>& threads, pid_t target_thread,
-                       const ProcessInfo& process_info, OpenFilesList* open_files,
-                       std::string* amfd_data) {
+// Unwinds all of the non-crashing threads on a pool of worker threads. The unwinds are
+// independent of each other and dominate tombstone generation time for processes with many
+// threads, but the tombstone output must stay in tid order, so every thread is unwound into
+// its own unwinder here and the results are logged serially by the caller. Threads whose
+// unwinder fails to initialize are left out of |unwinders| and get unwound in the serial pass.
+static void unwind_sibling_threads(
+    pid_t unwind_pid, const std::map<pid_t, ThreadInfo>& threads, pid_t target_thread,
+    std::map<pid_t, std::unique_ptr<unwindstack::UnwinderFromPid>>* unwinders) {
+  std::vector<const ThreadInfo*> siblings;
+  for (const auto& [tid, thread_info] : threads) {
+    if (tid != target_thread) {
+      siblings.push_back(&thread_info);
+    }
+  }
+  if (siblings.empty()) {
+    return;
+  }
+
+  std::mutex unwinders_mutex;
+  std::atomic<size_t> next(0);
+  auto unwind_worker = [&]() {
+    for (size_t i = next.fetch_add(1); i < siblings.size(); i = next.fetch_add(1)) {
+      const ThreadInfo& thread_info = *siblings[i];
+      auto unwinder = std::make_unique<unwindstack::UnwinderFromPid>(
+          kMaxFrames, unwind_pid, unwindstack::Regs::CurrentArch());
+      if (!unwinder->Init()) {
+        continue;
+      }
+      // Unwind will mutate the registers, so make a copy first.
+      std::unique_ptr<unwindstack::Regs> regs_copy(thread_info.registers->Clone());
+      unwinder->SetRegs(regs_copy.get());
+      unwinder->Unwind();
+
+      std::lock_guard<std::mutex> lock(unwinders_mutex);
+      unwinders->emplace(thread_info.tid, std::move(unwinder));
+    }
+  };
+
+  size_t worker_count =
+      std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), siblings.size());
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < worker_count; ++i) {
+    workers.emplace_back(unwind_worker);
+  }
+  unwind_worker();
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+}
+
+static void record_maps(TombstoneRecordWriter* writer, unwindstack::Maps* maps) {
+  for (auto const& map_info : *maps) {
+    TombstoneMapRecord record = {
+        .start = map_info->start,
+        .end = map_info->end,
+        .offset = map_info->offset,
+        .flags = static_cast<uint32_t>(map_info->flags),
+        .name_len = static_cast<uint32_t>(map_info->name.size()),
+    };
+    writer->Write(TombstoneRecordType::kMap, &record, sizeof(record), map_info->name);
+  }
+}
+
+// Writes a thread record followed by one frame record per unwound frame.
+// |unwinder| must still hold the frames for this thread.
+static void record_thread(TombstoneRecordWriter* writer, const ThreadInfo& thread_info,
+                          unwindstack::Unwinder* unwinder) {
+  TombstoneThreadRecord thread_record = {
+      .tid = thread_info.tid,
+      .frame_count = static_cast<uint32_t>(unwinder->NumFrames()),
+      .name_len = static_cast<uint32_t>(thread_info.thread_name.size()),
+  };
+  writer->Write(TombstoneRecordType::kThread, &thread_record, sizeof(thread_record),
+                thread_info.thread_name);
+
+  for (const auto& frame : unwinder->frames()) {
+    TombstoneFrameRecord frame_record = {
+        .num = static_cast<uint32_t>(frame.num),
+        .pc = frame.pc,
+        .rel_pc = frame.rel_pc,
+        .sp = frame.sp,
+        .function_offset = frame.function_offset,
+        .map_start = frame.map_start,
+        .map_end = frame.map_end,
+        .function_name_len = static_cast<uint32_t>(frame.function_name.size()),
+        .map_name_len = static_cast<uint32_t>(frame.map_name.size()),
+    };
+    writer->Write(TombstoneRecordType::kFrame, &frame_record, sizeof(frame_record),
+                  frame.function_name + frame.map_name);
+  }
+}
+
+void engrave_tombstone(unique_fd output_fd, unique_fd record_fd, unwindstack::Unwinder* unwinder,
+                       pid_t unwind_pid, const std::map<pid_t, ThreadInfo>& threads,
+                       pid_t target_thread, const ProcessInfo& process_info,
+                       OpenFilesList* open_files, std::string* amfd_data) {
   // Don't copy log messages to tombstone unless this is a development device.
   bool want_logs = GetBoolProperty("ro.debuggable", false);
 
@@ -615,7 +716,34 @@ void engrave_tombstone(unique_fd output_fd, unwindstack::Unwinder* unwinder,
     LOG(FATAL) << "failed to find target thread";
   }
 
-  dump_thread(&log, unwinder, it->second, process_info, true);
+  std::map<pid_t, std::unique_ptr<unwindstack::UnwinderFromPid>> sibling_unwinders;
+  unwind_sibling_threads(unwind_pid, threads, target_thread, &sibling_unwinders);
+
+  std::unique_ptr<TombstoneRecordWriter> record_writer;
+  if (record_fd != -1) {
+    record_writer = std::make_unique<TombstoneRecordWriter>(record_fd.get());
+
+    const siginfo_t* si = it->second.siginfo;
+    TombstoneProcessRecord process_record = {
+        .pid = it->second.pid,
+        .crashing_tid = target_thread,
+        .uid = static_cast<uint32_t>(it->second.uid),
+        .signo = si ? si->si_signo : 0,
+        .si_code = si ? si->si_code : 0,
+        .fault_address = (si && signal_has_si_addr(si)) ? reinterpret_cast<uint64_t>(si->si_addr) : 0,
+        .process_name_len = static_cast<uint32_t>(it->second.process_name.size()),
+    };
+    record_writer->Write(TombstoneRecordType::kProcess, &process_record, sizeof(process_record),
+                         it->second.process_name);
+    record_maps(record_writer.get(), unwinder->GetMaps());
+  }
+
+  dump_thread(&log, unwinder, it->second, process_info, true, false);
+
+  // The main unwinder still holds the crashing thread's frames.
+  if (record_writer) {
+    record_thread(record_writer.get(), it->second, unwinder);
+  }
 
   if (want_logs) {
     dump_logs(&log, it->second.pid, 50);
@@ -626,7 +754,18 @@ void engrave_tombstone(unique_fd output_fd, unwindstack::Unwinder* unwinder,
       continue;
     }
 
-    dump_thread(&log, unwinder, thread_info, process_info, false);
+    auto unwinder_it = sibling_unwinders.find(tid);
+    unwindstack::Unwinder* thread_unwinder;
+    if (unwinder_it != sibling_unwinders.end()) {
+      thread_unwinder = unwinder_it->second.get();
+      dump_thread(&log, thread_unwinder, thread_info, process_info, false, true);
+    } else {
+      thread_unwinder = unwinder;
+      dump_thread(&log, thread_unwinder, thread_info, process_info, false, false);
+    }
+    if (record_writer) {
+      record_thread(record_writer.get(), thread_info, thread_unwinder);
+    }
   }
 
   if (open_files) {
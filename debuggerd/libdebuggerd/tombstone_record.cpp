@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "DEBUG"
+
+#include "libdebuggerd/tombstone_record.h"
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+
+using android::base::WriteFully;
+
+TombstoneRecordWriter::TombstoneRecordWriter(int fd) : fd_(fd) {
+  TombstoneRecordFileHeader file_header = {
+      .magic = kTombstoneRecordMagic,
+      .version = kTombstoneRecordVersion,
+  };
+  ok_ = WriteFully(fd_, &file_header, sizeof(file_header));
+  if (!ok_) {
+    PLOG(ERROR) << "failed to write tombstone record file header";
+  }
+}
+
+bool TombstoneRecordWriter::Write(TombstoneRecordType type, const void* record, size_t record_size,
+                                  const std::string& strings) {
+  if (!ok_) {
+    return false;
+  }
+
+  TombstoneRecordHeader header = {
+      .type = type,
+      .size = static_cast<uint32_t>(record_size + strings.size()),
+  };
+  if (!WriteFully(fd_, &header, sizeof(header)) || !WriteFully(fd_, record, record_size) ||
+      !WriteFully(fd_, strings.data(), strings.size())) {
+    PLOG(ERROR) << "failed to write tombstone record";
+    ok_ = false;
+  }
+  return ok_;
+}
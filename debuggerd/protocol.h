@@ -42,6 +42,12 @@ enum class CrashPacketType : uint8_t {
   // kPerformDump sends along an output fd via cmsg(3).
   kPerformDump = 128,
   kAbortDump,
+
+  // Same as kPerformDump, but sends two fds: the text output fd, followed by
+  // an fd for the structured record output (see libdebuggerd/tombstone_record.h).
+  // Sent instead of kPerformDump when tombstoned wants a structured tombstone
+  // written alongside the text one.
+  kPerformStructuredDump,
 };
 
 struct DumpRequest {
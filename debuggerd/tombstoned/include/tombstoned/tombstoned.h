@@ -25,4 +25,10 @@
 bool tombstoned_connect(pid_t pid, android::base::unique_fd* tombstoned_socket,
                         android::base::unique_fd* output_fd, DebuggerdDumpType dump_type);
 
+// As above, but |record_fd| receives the structured record output fd if
+// tombstoned asks for a structured tombstone (and is cleared otherwise).
+bool tombstoned_connect(pid_t pid, android::base::unique_fd* tombstoned_socket,
+                        android::base::unique_fd* output_fd, android::base::unique_fd* record_fd,
+                        DebuggerdDumpType dump_type);
+
 bool tombstoned_notify_completion(int tombstoned_socket);
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <dirent.h>
 #include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -21,11 +22,18 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <array>
+#include <condition_variable>
 #include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include <event2/event.h>
 #include <event2/listener.h>
@@ -35,8 +43,10 @@
 #include <android-base/logging.h>
 #include <android-base/properties.h>
 #include <android-base/stringprintf.h>
+#include <android-base/strings.h>
 #include <android-base/unique_fd.h>
 #include <cutils/sockets.h>
+#include <zlib.h>
 
 #include "debuggerd/handler.h"
 #include "dump_type.h"
@@ -45,6 +55,7 @@
 
 #include "intercept_manager.h"
 
+using android::base::GetBoolProperty;
 using android::base::GetIntProperty;
 using android::base::SendFileDescriptors;
 using android::base::StringPrintf;
@@ -57,6 +68,33 @@ enum CrashStatus {
   kCrashStatusQueued,
 };
 
+// Worker thread that compresses completed dumps and enforces each queue's
+// on-disk size budget, so that neither ever happens on the event loop while
+// a crashing process is waiting on us.
+static void queue_artifact_work(std::function<void()> work) {
+  static std::mutex work_mutex;
+  static std::condition_variable work_cv;
+  static std::deque<std::function<void()>> work_queue;
+  static std::thread worker([]() {
+    for (;;) {
+      std::function<void()> work;
+      {
+        std::unique_lock<std::mutex> lock(work_mutex);
+        work_cv.wait(lock, []() { return !work_queue.empty(); });
+        work = std::move(work_queue.front());
+        work_queue.pop_front();
+      }
+      work();
+    }
+  });
+
+  {
+    std::lock_guard<std::mutex> lock(work_mutex);
+    work_queue.push_back(std::move(work));
+  }
+  work_cv.notify_one();
+}
+
 // Ownership of Crash is a bit messy.
 // It's either owned by an active event that must have a timeout, or owned by
 // queued_requests, in the case that multiple crashes come in at the same time.
@@ -65,6 +103,8 @@ struct Crash {
 
   std::string crash_tombstone_path;
   unique_fd crash_tombstone_fd;
+  std::string crash_record_path;
+  unique_fd crash_record_fd;
   unique_fd crash_socket_fd;
   pid_t crash_pid;
   event* crash_event = nullptr;
@@ -75,14 +115,15 @@ struct Crash {
 class CrashQueue {
  public:
   CrashQueue(const std::string& dir_path, const std::string& file_name_prefix, size_t max_artifacts,
-             size_t max_concurrent_dumps)
+             size_t max_concurrent_dumps, size_t max_total_size_kb)
       : file_name_prefix_(file_name_prefix),
         dir_path_(dir_path),
         dir_fd_(open(dir_path.c_str(), O_DIRECTORY | O_RDONLY | O_CLOEXEC)),
         max_artifacts_(max_artifacts),
         next_artifact_(0),
         max_concurrent_dumps_(max_concurrent_dumps),
-        num_concurrent_dumps_(0) {
+        num_concurrent_dumps_(0),
+        max_total_size_kb_(max_total_size_kb) {
     if (dir_fd_ == -1) {
       PLOG(FATAL) << "failed to open directory: " << dir_path;
     }
@@ -101,14 +142,21 @@ class CrashQueue {
   static CrashQueue* for_tombstones() {
     static CrashQueue queue("/data/tombstones", "tombstone_" /* file_name_prefix */,
                             GetIntProperty("tombstoned.max_tombstone_count", 32),
-                            1 /* max_concurrent_dumps */);
+                            1 /* max_concurrent_dumps */,
+                            GetIntProperty("tombstoned.max_tombstone_total_kb", 65536));
     return &queue;
   }
 
   static CrashQueue* for_anrs() {
+    // ANR traces are written by the dumping processes themselves; tombstoned
+    // only brokers the output fds. A low concurrency limit here needlessly
+    // serializes full-system ANR collection, so allow plenty of dumps in
+    // flight (but always fewer than the number of artifact slots, which the
+    // constructor requires).
     static CrashQueue queue("/data/anr", "trace_" /* file_name_prefix */,
                             GetIntProperty("tombstoned.max_anr_count", 64),
-                            4 /* max_concurrent_dumps */);
+                            GetIntProperty("tombstoned.max_concurrent_anr_dumps", 16, 1, 63),
+                            GetIntProperty("tombstoned.max_anr_total_kb", 65536));
     return &queue;
   }
 
@@ -137,6 +185,19 @@ class CrashQueue {
     return file_name;
   }
 
+  // Called after an artifact has been linked into place. Compression and the
+  // size budget are handled off the event loop: the crasher has already been
+  // told its dump is done, so this work is invisible to it.
+  void finalize_artifact(const std::string& path) {
+    bool compress = GetBoolProperty("tombstoned.compress_completed_dumps", false);
+    queue_artifact_work([this, path, compress]() {
+      if (compress) {
+        compress_artifact(path);
+      }
+      enforce_size_limit();
+    });
+  }
+
   bool maybe_enqueue_crash(Crash* crash) {
     if (num_concurrent_dumps_ == max_concurrent_dumps_) {
       queued_requests_.push_back(crash);
@@ -159,6 +220,112 @@ class CrashQueue {
   void on_crash_completed() { --num_concurrent_dumps_; }
 
  private:
+  // Replaces |path| with a gzipped copy, leaving the original in place if
+  // anything goes wrong. Runs on the artifact worker thread.
+  static void compress_artifact(const std::string& path) {
+    unique_fd input(open(path.c_str(), O_RDONLY | O_CLOEXEC));
+    if (input == -1) {
+      PLOG(ERROR) << "failed to open " << path << " for compression";
+      return;
+    }
+
+    std::string gz_path = path + ".gz";
+    unique_fd output_fd(open(gz_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0640));
+    if (output_fd == -1) {
+      PLOG(ERROR) << "failed to create " << gz_path;
+      return;
+    }
+
+    // gzclose closes the underlying fd.
+    gzFile output = gzdopen(output_fd.release(), "w");
+    if (output == nullptr) {
+      LOG(ERROR) << "gzdopen failed for " << gz_path;
+      unlink(gz_path.c_str());
+      return;
+    }
+
+    bool ok = true;
+    char buf[65536];
+    ssize_t bytes_read;
+    while ((bytes_read = TEMP_FAILURE_RETRY(read(input.get(), buf, sizeof(buf)))) > 0) {
+      if (gzwrite(output, buf, bytes_read) != bytes_read) {
+        LOG(ERROR) << "failed to write to " << gz_path;
+        ok = false;
+        break;
+      }
+    }
+    if (bytes_read == -1) {
+      PLOG(ERROR) << "failed to read " << path;
+      ok = false;
+    }
+
+    if (gzclose(output) != Z_OK) {
+      LOG(ERROR) << "failed to finish " << gz_path;
+      ok = false;
+    }
+
+    if (!ok) {
+      unlink(gz_path.c_str());
+      return;
+    }
+
+    if (unlink(path.c_str()) != 0) {
+      PLOG(ERROR) << "failed to unlink " << path << " after compression";
+    }
+  }
+
+  // Deletes the oldest artifacts until the directory fits in the size budget.
+  // Runs on the artifact worker thread; only touches const members.
+  void enforce_size_limit() {
+    if (max_total_size_kb_ == 0) {
+      return;
+    }
+
+    std::unique_ptr<DIR, decltype(&closedir)> dir(opendir(dir_path_.c_str()), closedir);
+    if (!dir) {
+      PLOG(ERROR) << "failed to open directory: " << dir_path_;
+      return;
+    }
+
+    struct ArtifactEntry {
+      std::string name;
+      time_t mtime;
+      off_t size;
+    };
+    std::vector<ArtifactEntry> entries;
+    off_t total_size = 0;
+
+    dirent* entry;
+    while ((entry = readdir(dir.get())) != nullptr) {
+      if (!android::base::StartsWith(entry->d_name, file_name_prefix_)) {
+        continue;
+      }
+      struct stat st;
+      if (fstatat(dirfd(dir.get()), entry->d_name, &st, 0) != 0 || !S_ISREG(st.st_mode)) {
+        continue;
+      }
+      entries.push_back({entry->d_name, st.st_mtime, st.st_size});
+      total_size += st.st_size;
+    }
+
+    std::sort(entries.begin(), entries.end(),
+              [](const ArtifactEntry& a, const ArtifactEntry& b) { return a.mtime < b.mtime; });
+
+    // Always keep the most recent artifact, no matter how big it is.
+    size_t i = 0;
+    while (total_size > static_cast<off_t>(max_total_size_kb_) * 1024 &&
+           i + 1 < entries.size()) {
+      if (unlinkat(dirfd(dir.get()), entries[i].name.c_str(), 0) != 0) {
+        PLOG(ERROR) << "failed to unlink " << dir_path_ << "/" << entries[i].name;
+      } else {
+        LOG(INFO) << "deleted " << dir_path_ << "/" << entries[i].name
+                  << " to stay under size limit";
+        total_size -= entries[i].size;
+      }
+      ++i;
+    }
+  }
+
   void find_oldest_artifact() {
     size_t oldest_tombstone = 0;
     time_t oldest_time = std::numeric_limits<time_t>::max();
@@ -166,7 +333,8 @@ class CrashQueue {
     for (size_t i = 0; i < max_artifacts_; ++i) {
       std::string path = StringPrintf("%s/%s%02zu", dir_path_.c_str(), file_name_prefix_.c_str(), i);
       struct stat st;
-      if (stat(path.c_str(), &st) != 0) {
+      // The artifact may have been compressed after it was linked into place.
+      if (stat(path.c_str(), &st) != 0 && stat((path + ".gz").c_str(), &st) != 0) {
         if (errno == ENOENT) {
           oldest_tombstone = i;
           break;
@@ -196,6 +364,8 @@ class CrashQueue {
   const size_t max_concurrent_dumps_;
   size_t num_concurrent_dumps_;
 
+  const size_t max_total_size_kb_;
+
   std::deque<Crash*> queued_requests_;
 
   DISALLOW_COPY_AND_ASSIGN(CrashQueue);
@@ -211,6 +381,7 @@ static void crash_completed_cb(evutil_socket_t sockfd, short ev, void* arg);
 
 static void perform_request(Crash* crash) {
   unique_fd output_fd;
+  unique_fd record_fd;
   bool intercepted =
       intercept_manager->GetIntercept(crash->crash_pid, crash->crash_type, &output_fd);
   if (!intercepted) {
@@ -220,15 +391,28 @@ static void perform_request(Crash* crash) {
     } else {
       std::tie(crash->crash_tombstone_path, output_fd) = CrashQueue::for_crash(crash)->get_output();
       crash->crash_tombstone_fd.reset(dup(output_fd.get()));
+
+      if (crash->crash_type == kDebuggerdTombstone &&
+          GetBoolProperty("tombstoned.structured_tombstones", false)) {
+        std::tie(crash->crash_record_path, record_fd) = CrashQueue::for_crash(crash)->get_output();
+        crash->crash_record_fd.reset(dup(record_fd.get()));
+      }
     }
   }
 
   TombstonedCrashPacket response = {
     .packet_type = CrashPacketType::kPerformDump
   };
-  ssize_t rc =
-      SendFileDescriptors(crash->crash_socket_fd, &response, sizeof(response), output_fd.get());
+  ssize_t rc;
+  if (record_fd != -1) {
+    response.packet_type = CrashPacketType::kPerformStructuredDump;
+    rc = SendFileDescriptors(crash->crash_socket_fd, &response, sizeof(response), output_fd.get(),
+                             record_fd.get());
+  } else {
+    rc = SendFileDescriptors(crash->crash_socket_fd, &response, sizeof(response), output_fd.get());
+  }
   output_fd.reset();
+  record_fd.reset();
 
   if (rc == -1) {
     PLOG(WARNING) << "failed to send response to CrashRequest";
@@ -372,6 +556,17 @@ static void crash_completed_cb(evutil_socket_t sockfd, short ev, void* arg) {
       goto fail;
     }
 
+    // A previous occupant of this slot may have been compressed, or have had
+    // a structured record written alongside it.
+    rc = unlink((tombstone_path + ".gz").c_str());
+    if (rc != 0 && errno != ENOENT) {
+      PLOG(ERROR) << "failed to unlink compressed tombstone at " << tombstone_path << ".gz";
+    }
+    rc = unlink((tombstone_path + ".rec").c_str());
+    if (rc != 0 && errno != ENOENT) {
+      PLOG(ERROR) << "failed to unlink tombstone record at " << tombstone_path << ".rec";
+    }
+
     rc = linkat(AT_FDCWD, fd_path.c_str(), AT_FDCWD, tombstone_path.c_str(), AT_SYMLINK_FOLLOW);
     if (rc != 0) {
       PLOG(ERROR) << "failed to link tombstone";
@@ -384,6 +579,18 @@ static void crash_completed_cb(evutil_socket_t sockfd, short ev, void* arg) {
         // to this message must be carefully considered.
         LOG(ERROR) << "Tombstone written to: " << tombstone_path;
       }
+
+      if (crash->crash_record_fd != -1) {
+        std::string record_fd_path =
+            StringPrintf("/proc/self/fd/%d", crash->crash_record_fd.get());
+        std::string record_path = tombstone_path + ".rec";
+        if (linkat(AT_FDCWD, record_fd_path.c_str(), AT_FDCWD, record_path.c_str(),
+                   AT_SYMLINK_FOLLOW) != 0) {
+          PLOG(ERROR) << "failed to link tombstone record";
+        }
+      }
+
+      CrashQueue::for_crash(crash)->finalize_artifact(tombstone_path);
     }
 
     // If we don't have O_TMPFILE, we need to clean up after ourselves.
@@ -393,6 +600,13 @@ static void crash_completed_cb(evutil_socket_t sockfd, short ev, void* arg) {
         PLOG(ERROR) << "failed to unlink temporary tombstone at " << crash->crash_tombstone_path;
       }
     }
+    if (!crash->crash_record_path.empty()) {
+      rc = unlink(crash->crash_record_path.c_str());
+      if (rc != 0) {
+        PLOG(ERROR) << "failed to unlink temporary tombstone record at "
+                    << crash->crash_record_path;
+      }
+    }
   }
 
 fail:
@@ -20,6 +20,7 @@
 #include <unistd.h>
 
 #include <utility>
+#include <vector>
 
 #include <android-base/cmsg.h>
 #include <android-base/unique_fd.h>
@@ -29,11 +30,16 @@
 #include "protocol.h"
 #include "util.h"
 
-using android::base::ReceiveFileDescriptors;
+using android::base::ReceiveFileDescriptorVector;
 using android::base::unique_fd;
 
 bool tombstoned_connect(pid_t pid, unique_fd* tombstoned_socket, unique_fd* output_fd,
                         DebuggerdDumpType dump_type) {
+  return tombstoned_connect(pid, tombstoned_socket, output_fd, nullptr, dump_type);
+}
+
+bool tombstoned_connect(pid_t pid, unique_fd* tombstoned_socket, unique_fd* output_fd,
+                        unique_fd* record_fd, DebuggerdDumpType dump_type) {
   unique_fd sockfd(
       socket_local_client((dump_type != kDebuggerdJavaBacktrace ? kTombstonedCrashSocketName
                                                                 : kTombstonedJavaTraceSocketName),
@@ -54,8 +60,9 @@ bool tombstoned_connect(pid_t pid, unique_fd* tombstoned_socket, unique_fd* outp
     return false;
   }
 
-  unique_fd tmp_output_fd;
-  ssize_t rc = ReceiveFileDescriptors(sockfd, &packet, sizeof(packet), &tmp_output_fd);
+  // tombstoned sends a second fd along with kPerformStructuredDump.
+  std::vector<unique_fd> received_fds;
+  ssize_t rc = ReceiveFileDescriptorVector(sockfd, &packet, sizeof(packet), 2, &received_fds);
   if (rc == -1) {
     async_safe_format_log(ANDROID_LOG_ERROR, "libc",
                           "failed to read response to DumpRequest packet: %s", strerror(errno));
@@ -68,6 +75,22 @@ bool tombstoned_connect(pid_t pid, unique_fd* tombstoned_socket, unique_fd* outp
     return false;
   }
 
+  size_t expected_fds = (packet.packet_type == CrashPacketType::kPerformStructuredDump) ? 2 : 1;
+  if (received_fds.size() != expected_fds) {
+    async_safe_format_log(ANDROID_LOG_ERROR, "libc",
+                          "received %zu fds from tombstoned (expected %zu)", received_fds.size(),
+                          expected_fds);
+    return false;
+  }
+
+  unique_fd tmp_output_fd = std::move(received_fds[0]);
+  if (record_fd) {
+    record_fd->reset();
+    if (received_fds.size() == 2) {
+      *record_fd = std::move(received_fds[1]);
+    }
+  }
+
   // Make the fd O_APPEND so that our output is guaranteed to be at the end of a file.
   // (This also makes selinux rules consistent, because selinux distinguishes between writing to
   // a regular fd, and writing to an fd with O_APPEND).
@@ -35,6 +35,8 @@
 #define FB_CMD_OEM "oem"
 #define FB_CMD_GSI "gsi"
 #define FB_CMD_SNAPSHOT_UPDATE "snapshot-update"
+#define FB_CMD_FLASH_DIGESTS "flash-digests"
+#define FB_CMD_BENCHMARK_WRITE "benchmark-write"
 
 #define RESPONSE_OKAY "OKAY"
 #define RESPONSE_FAIL "FAIL"
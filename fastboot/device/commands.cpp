@@ -19,8 +19,11 @@
 #include <sys/socket.h>
 #include <sys/un.h>
 
+#include <algorithm>
+#include <chrono>
 #include <unordered_set>
 
+#include <android-base/file.h>
 #include <android-base/logging.h>
 #include <android-base/parseint.h>
 #include <android-base/properties.h>
@@ -37,6 +40,7 @@
 #include <liblp/liblp.h>
 #include <libsnapshot/snapshot.h>
 #include <uuid/uuid.h>
+#include <zlib.h>
 
 #include "constants.h"
 #include "fastboot_device.h"
@@ -578,6 +582,115 @@ bool FlashHandler(FastbootDevice* device, const std::vector<std::string>& args)
     return device->WriteStatus(FastbootResult::OKAY, "Flashing succeeded");
 }
 
+// Limits for flash-digests, so a bad chunk size can't make us allocate or
+// stream an unbounded amount.
+static constexpr uint64_t kMaxFlashDigestChunkSize = 256 * 1024 * 1024;
+static constexpr uint64_t kMaxFlashDigestChunks = 65536;
+static constexpr uint64_t kFlashDigestsPerLine = 8;
+
+// flash-digests:<partition>:<chunk-size-hex>:<length-hex>
+//
+// Reports a CRC32 per |chunk-size| chunk of the first |length| bytes the
+// partition currently holds, as INFO lines of space-separated hex digests.
+// The host uses them to resend only the chunks an interrupted flash left
+// missing or mismatched.
+bool FlashDigestsHandler(FastbootDevice* device, const std::vector<std::string>& args) {
+    if (args.size() < 4) {
+        return device->WriteStatus(FastbootResult::FAIL, "Invalid arguments");
+    }
+
+    if (GetDeviceLockStatus()) {
+        return device->WriteStatus(FastbootResult::FAIL,
+                                   "Command not available on locked devices");
+    }
+
+    uint64_t chunk_size;
+    uint64_t length;
+    if (!android::base::ParseUint("0x" + args[2], &chunk_size) ||
+        !android::base::ParseUint("0x" + args[3], &length)) {
+        return device->WriteStatus(FastbootResult::FAIL, "Invalid size");
+    }
+    if (chunk_size == 0 || (chunk_size % 4096) != 0 || chunk_size > kMaxFlashDigestChunkSize) {
+        return device->WriteStatus(FastbootResult::FAIL, "Invalid chunk size");
+    }
+
+    PartitionHandle handle;
+    if (!OpenPartition(device, args[1], &handle)) {
+        return device->WriteStatus(FastbootResult::FAIL, "Partition doesn't exist");
+    }
+
+    length = std::min(length, get_block_device_size(handle.fd()));
+    uint64_t chunk_count = (length + chunk_size - 1) / chunk_size;
+    if (chunk_count > kMaxFlashDigestChunks) {
+        return device->WriteStatus(FastbootResult::FAIL, "Too many chunks");
+    }
+
+    std::vector<char> chunk(chunk_size);
+    std::string line;
+    for (uint64_t i = 0; i < chunk_count; ++i) {
+        size_t read_length = std::min(chunk_size, length - i * chunk_size);
+        if (!android::base::ReadFully(handle.fd(), chunk.data(), read_length)) {
+            return device->WriteStatus(FastbootResult::FAIL, "Couldn't read partition");
+        }
+        uint32_t digest =
+                crc32(0, reinterpret_cast<const unsigned char*>(chunk.data()), read_length);
+        line += android::base::StringPrintf(line.empty() ? "%08x" : " %08x", digest);
+        if ((i + 1) % kFlashDigestsPerLine == 0 || i + 1 == chunk_count) {
+            if (!device->WriteInfo(line)) {
+                return false;
+            }
+            line.clear();
+        }
+    }
+
+    return device->WriteOkay(std::to_string(chunk_count));
+}
+
+// benchmark-write:<partition>
+//
+// Writes the staged download buffer to |partition| and reports the achieved
+// write bandwidth, so device-side write speed can be measured in isolation
+// from the transport. Destroys the partition contents, like flash.
+bool BenchmarkWriteHandler(FastbootDevice* device, const std::vector<std::string>& args) {
+    if (args.size() < 2) {
+        return device->WriteStatus(FastbootResult::FAIL, "Invalid arguments");
+    }
+
+    if (GetDeviceLockStatus()) {
+        return device->WriteStatus(FastbootResult::FAIL,
+                                   "Command not available on locked devices");
+    }
+
+    const auto& data = device->download_data();
+    if (data.empty()) {
+        return device->WriteStatus(FastbootResult::FAIL, "No data staged");
+    }
+
+    const auto& partition_name = args[1];
+    if (IsProtectedPartitionDuringMerge(device, partition_name)) {
+        auto message =
+                "Cannot write " + partition_name + " while a snapshot update is in progress";
+        return device->WriteFail(message);
+    }
+
+    PartitionHandle handle;
+    if (!OpenPartition(device, partition_name, &handle)) {
+        return device->WriteStatus(FastbootResult::FAIL, "Partition doesn't exist");
+    }
+
+    size_t length = std::min<uint64_t>(data.size(), get_block_device_size(handle.fd()));
+    auto start = std::chrono::steady_clock::now();
+    if (!android::base::WriteFully(handle.fd(), data.data(), length)) {
+        return device->WriteStatus(FastbootResult::FAIL, "Couldn't write partition");
+    }
+    fsync(handle.fd());
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    return device->WriteOkay(android::base::StringPrintf(
+            "%zu bytes in %.3fs (%.1f MB/s)", length, elapsed.count(),
+            length / elapsed.count() / 1024 / 1024));
+}
+
 bool UpdateSuperHandler(FastbootDevice* device, const std::vector<std::string>& args) {
     if (args.size() < 2) {
         return device->WriteFail("Invalid arguments");
@@ -43,6 +43,8 @@ bool RebootRecoveryHandler(FastbootDevice* device, const std::vector<std::string
 bool GetVarHandler(FastbootDevice* device, const std::vector<std::string>& args);
 bool EraseHandler(FastbootDevice* device, const std::vector<std::string>& args);
 bool FlashHandler(FastbootDevice* device, const std::vector<std::string>& args);
+bool FlashDigestsHandler(FastbootDevice* device, const std::vector<std::string>& args);
+bool BenchmarkWriteHandler(FastbootDevice* device, const std::vector<std::string>& args);
 bool CreatePartitionHandler(FastbootDevice* device, const std::vector<std::string>& args);
 bool DeletePartitionHandler(FastbootDevice* device, const std::vector<std::string>& args);
 bool ResizePartitionHandler(FastbootDevice* device, const std::vector<std::string>& args);
@@ -61,6 +61,8 @@ FastbootDevice::FastbootDevice()
               {FB_CMD_OEM, OemCmdHandler},
               {FB_CMD_GSI, GsiHandler},
               {FB_CMD_SNAPSHOT_UPDATE, SnapshotUpdateHandler},
+              {FB_CMD_FLASH_DIGESTS, FlashDigestsHandler},
+              {FB_CMD_BENCHMARK_WRITE, BenchmarkWriteHandler},
       }),
       boot_control_hal_(IBootControl::getService()),
       health_hal_(get_health_service()),
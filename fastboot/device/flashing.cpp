@@ -28,6 +28,7 @@
 #include <android-base/file.h>
 #include <android-base/logging.h>
 #include <android-base/strings.h>
+#include <asyncio/AsyncIO_uring.h>
 #include <ext4_utils/ext4_utils.h>
 #include <fs_mgr_overlayfs.h>
 #include <fstab/fstab.h>
@@ -72,55 +73,192 @@ void WipeOverlayfsForPartition(FastbootDevice* device, const std::string& partit
     }
 }
 
-}  // namespace
+// Writes flashed data to the block device through io_uring, keeping several
+// extents in flight so that parsing the next sparse chunk overlaps the
+// writeback of earlier ones instead of waiting on one synchronous write at a
+// time. Writes are positional, so sparse skip chunks just advance the offset.
+//
+// Falls back to synchronous pwrite on kernels without io_uring (the ring
+// cannot be created) or without IORING_OP_WRITE (the completions fail with
+// EINVAL); in both cases every extent is still written exactly once.
+class PartitionWriter {
+  public:
+    explicit PartitionWriter(int fd) : fd_(fd) {
+        ring_created_ = io_uring_queue_init(kQueueDepth, 0, 0, &queue_) == 0;
+        use_ring_ = ring_created_;
+    }
 
-int FlashRawDataChunk(int fd, const char* data, size_t len) {
-    size_t ret = 0;
-    while (ret < len) {
-        int this_len = std::min(static_cast<size_t>(1048576UL * 8), len - ret);
-        int this_ret = write(fd, data, this_len);
-        if (this_ret < 0) {
-            PLOG(ERROR) << "Failed to flash data of len " << len;
-            return -1;
+    ~PartitionWriter() {
+        Finish();
+        if (ring_created_) {
+            io_uring_queue_exit(&queue_);
         }
-        data += this_ret;
-        ret += this_ret;
     }
-    return 0;
-}
 
-int FlashRawData(int fd, const std::vector<char>& downloaded_data) {
-    int ret = FlashRawDataChunk(fd, downloaded_data.data(), downloaded_data.size());
-    if (ret < 0) {
-        return -errno;
+    // Queues |len| bytes at the current write position. |data| must stay
+    // valid until Finish(); it points into the download buffer, which
+    // outlives the flash. Returns 0 or a negative errno.
+    int Write(const char* data, size_t len) {
+        while (len > 0 && !error_) {
+            size_t extent_len = std::min(kExtentSize, len);
+            if (use_ring_) {
+                if (!QueueExtent(data, extent_len)) {
+                    continue;  // a slot was freed up or the ring was abandoned
+                }
+            } else if (!SyncWrite(data, extent_len, offset_)) {
+                break;
+            }
+            data += extent_len;
+            offset_ += extent_len;
+            len -= extent_len;
+        }
+        return error_;
     }
-    return ret;
-}
+
+    // Advances the write position over a don't-care gap (sparse skip chunk).
+    void Skip(size_t len) { offset_ += len; }
+
+    // Waits for every queued extent and returns the first error, if any.
+    int Finish() {
+        while (in_flight_ > 0) {
+            Reap(1);
+        }
+        return error_;
+    }
+
+  private:
+    static constexpr unsigned kQueueDepth = 8;
+    static constexpr size_t kExtentSize = 1048576;
+
+    struct Extent {
+        const char* data;
+        size_t len;
+        uint64_t offset;
+        bool queued;
+    };
+
+    // Submits one extent, or reaps a completion to make room for it. Returns
+    // true if the extent was written or queued and the caller may advance.
+    bool QueueExtent(const char* data, size_t len) {
+        int slot = -1;
+        for (unsigned i = 0; i < kQueueDepth; ++i) {
+            if (!extents_[i].queued) {
+                slot = i;
+                break;
+            }
+        }
+        io_uring_sqe* sqe = slot >= 0 ? io_uring_get_sqe(&queue_) : nullptr;
+        if (sqe == nullptr) {
+            Reap(1);
+            return false;
+        }
+
+        extents_[slot] = {data, len, offset_, true};
+        io_uring_prep_pwrite(sqe, fd_, data, len, offset_, slot);
+        if (io_uring_submit(&queue_) < 0) {
+            PLOG(ERROR) << "io_uring submit failed, falling back to pwrite";
+            extents_[slot].queued = false;
+            use_ring_ = false;
+            Finish();
+            return SyncWrite(data, len, offset_);
+        }
+        in_flight_++;
+        return true;
+    }
+
+    void Reap(unsigned min_nr) {
+        io_uring_cqe cqes[kQueueDepth];
+        int n;
+        do {
+            n = io_uring_getevents(&queue_, min_nr, kQueueDepth, cqes);
+        } while (n < 0 && errno == EINTR);
+        if (n < 0) {
+            // Completions are unrecoverable at this point; fail the flash
+            // rather than wait forever.
+            PLOG(ERROR) << "io_uring getevents failed";
+            if (!error_) error_ = -errno;
+            in_flight_ = 0;
+            return;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            Extent& extent = extents_[cqes[i].user_data];
+            extent.queued = false;
+            in_flight_--;
+
+            int res = cqes[i].res;
+            if (res == static_cast<int>(extent.len)) {
+                continue;
+            }
+            if (res == -EINVAL || res == -EOPNOTSUPP) {
+                // The kernel has io_uring but not IORING_OP_WRITE; redo this
+                // extent synchronously and stop using the ring.
+                use_ring_ = false;
+                SyncWrite(extent.data, extent.len, extent.offset);
+            } else if (res < 0) {
+                if (!error_) error_ = res;
+            } else {
+                // Short write; finish the extent synchronously.
+                SyncWrite(extent.data + res, extent.len - res, extent.offset + res);
+            }
+        }
+    }
+
+    bool SyncWrite(const char* data, size_t len, uint64_t offset) {
+        while (len > 0) {
+            ssize_t n = TEMP_FAILURE_RETRY(pwrite(fd_, data, std::min(kExtentSize, len), offset));
+            if (n < 0) {
+                PLOG(ERROR) << "Failed to flash data of len " << len;
+                if (!error_) error_ = -errno;
+                return false;
+            }
+            data += n;
+            offset += n;
+            len -= n;
+        }
+        return true;
+    }
+
+    int fd_;
+    bool ring_created_ = false;
+    bool use_ring_ = false;
+    io_uring_queue queue_;
+    Extent extents_[kQueueDepth] = {};
+    uint64_t offset_ = 0;
+    unsigned in_flight_ = 0;
+    int error_ = 0;
+};
+
+}  // namespace
 
 int WriteCallback(void* priv, const void* data, size_t len) {
-    int fd = reinterpret_cast<long long>(priv);
+    auto writer = static_cast<PartitionWriter*>(priv);
     if (!data) {
-        return lseek64(fd, len, SEEK_CUR) >= 0 ? 0 : -errno;
+        writer->Skip(len);
+        return 0;
     }
-    return FlashRawDataChunk(fd, reinterpret_cast<const char*>(data), len);
+    return writer->Write(reinterpret_cast<const char*>(data), len);
 }
 
-int FlashSparseData(int fd, std::vector<char>& downloaded_data) {
+int FlashSparseData(PartitionWriter* writer, std::vector<char>& downloaded_data) {
     struct sparse_file* file = sparse_file_import_buf(downloaded_data.data(), true, false);
     if (!file) {
         return -ENOENT;
     }
-    return sparse_file_callback(file, false, false, WriteCallback, reinterpret_cast<void*>(fd));
+    return sparse_file_callback(file, false, false, WriteCallback, writer);
 }
 
 int FlashBlockDevice(int fd, std::vector<char>& downloaded_data) {
-    lseek64(fd, 0, SEEK_SET);
+    PartitionWriter writer(fd);
+    int ret;
     if (downloaded_data.size() >= sizeof(SPARSE_HEADER_MAGIC) &&
         *reinterpret_cast<uint32_t*>(downloaded_data.data()) == SPARSE_HEADER_MAGIC) {
-        return FlashSparseData(fd, downloaded_data);
+        ret = FlashSparseData(&writer, downloaded_data);
     } else {
-        return FlashRawData(fd, downloaded_data);
+        ret = writer.Write(downloaded_data.data(), downloaded_data.size());
     }
+    int result = writer.Finish();
+    return ret ? ret : result;
 }
 
 static void CopyAVBFooter(std::vector<char>* data, const uint64_t block_device_size) {
@@ -17,6 +17,8 @@
 #include "tcp_client.h"
 #include "constants.h"
 
+#include <algorithm>
+
 #include <android-base/errors.h>
 #include <android-base/logging.h>
 #include <android-base/parseint.h>
@@ -25,10 +27,19 @@
 #include <android-base/strings.h>
 
 static constexpr int kDefaultPort = 5554;
-static constexpr int kProtocolVersion = 1;
+static constexpr int kProtocolVersion = 2;
+static constexpr int kMinProtocolVersion = 1;
 static constexpr int kHandshakeTimeoutMs = 2000;
 static constexpr size_t kHandshakeLength = 4;
 
+// Protocol version 2 multi-stream downloads; see fastboot/tcp.cpp for the host side and the wire
+// format. The host announces its extra data connections with "MSnn" after the handshake, each one
+// is confirmed with a "STRM" tag exchange, and a message length header with the top bit set means
+// the payload is striped round-robin across the streams in kStripeChunkSize pieces.
+static constexpr size_t kStripeChunkSize = 256 * 1024;
+static constexpr uint64_t kStripedMessageFlag = uint64_t{1} << 63;
+static constexpr uint64_t kMessageLengthMask = (uint64_t{1} << 56) - 1;
+
 // Extract the big-endian 8-byte message length into a 64-bit number.
 static uint64_t ExtractMessageLength(const void* buffer) {
     uint64_t ret = 0;
@@ -67,7 +78,22 @@ ssize_t ClientTcpTransport::Read(void* data, size_t len) {
 
             char buffer[8];
             if (socket_->ReceiveAll(buffer, 8, 0) == 8) {
-                message_bytes_left_ = ExtractMessageLength(buffer);
+                uint64_t header = ExtractMessageLength(buffer);
+                if (header & kStripedMessageFlag) {
+                    ssize_t bytes_read = ReadStriped(
+                            header, reinterpret_cast<char*>(data) + total_read, len - total_read);
+                    if (bytes_read == -1) {
+                        socket_.reset(nullptr);
+                        streams_.clear();
+                        return -1;
+                    }
+                    total_read += bytes_read;
+                    if (!downloading_ || total_read == len) {
+                        return total_read;
+                    }
+                    continue;
+                }
+                message_bytes_left_ = header;
             } else {
                 // If connection is closed by host, Receive will return 0 immediately.
                 socket_.reset(nullptr);
@@ -99,6 +125,29 @@ ssize_t ClientTcpTransport::Read(void* data, size_t len) {
     return total_read;
 }
 
+ssize_t ClientTcpTransport::ReadStriped(uint64_t header, char* data, size_t len) {
+    size_t stream_count = (header >> 56) & 0x7f;
+    uint64_t message_length = header & kMessageLengthMask;
+    if (stream_count == 0 || stream_count > streams_.size() || message_length > len) {
+        LOG(ERROR) << "Invalid striped message header";
+        return -1;
+    }
+
+    uint64_t remaining = message_length;
+    size_t stream = 0;
+    while (remaining > 0) {
+        size_t chunk = std::min(uint64_t{kStripeChunkSize}, remaining);
+        if (streams_[stream]->ReceiveAll(data, chunk, 0) != static_cast<ssize_t>(chunk)) {
+            return -1;
+        }
+        data += chunk;
+        remaining -= chunk;
+        stream = (stream + 1) % stream_count;
+    }
+
+    return message_length;
+}
+
 ssize_t ClientTcpTransport::Write(const void* data, size_t len) {
     if (socket_ == nullptr || len > SSIZE_MAX) {
         return -1;
@@ -127,6 +176,7 @@ int ClientTcpTransport::Close() {
     if (socket_ == nullptr) {
         return -1;
     }
+    streams_.clear();
     socket_.reset(nullptr);
 
     return 0;
@@ -157,7 +207,7 @@ void ClientTcpTransport::ListenFastbootSocket() {
         }
 
         int version = 0;
-        if (!android::base::ParseInt(buffer + 2, &version) || version < kProtocolVersion) {
+        if (!android::base::ParseInt(buffer + 2, &version) || version < kMinProtocolVersion) {
             LOG(ERROR) << "Unknown TCP protocol version " << buffer + 2
                        << ", our version: " << kProtocolVersion;
             socket_.reset(nullptr);
@@ -171,6 +221,39 @@ void ClientTcpTransport::ListenFastbootSocket() {
             continue;
         }
 
+        // On a version 2 host, read the stream announcement and accept the data stream
+        // connections it opened. A failed stream is only logged: the host drops the striped
+        // path when a confirmation is missing, and the control connection still works.
+        streams_.clear();
+        if (version >= 2) {
+            char ms_buffer[kHandshakeLength + 1];
+            ms_buffer[kHandshakeLength] = '\0';
+            int stream_count = 0;
+            if (socket_->ReceiveAll(ms_buffer, kHandshakeLength, kHandshakeTimeoutMs) !=
+                        static_cast<ssize_t>(kHandshakeLength) ||
+                memcmp(ms_buffer, "MS", 2) != 0 ||
+                !android::base::ParseInt(ms_buffer + 2, &stream_count)) {
+                PLOG(ERROR) << "No stream announcement received";
+                socket_.reset(nullptr);
+                continue;
+            }
+
+            for (int i = 0; i < stream_count; ++i) {
+                std::unique_ptr<Socket> stream = service_->Accept();
+                char tag[kHandshakeLength + 1];
+                tag[kHandshakeLength] = '\0';
+                if (stream == nullptr ||
+                    stream->ReceiveAll(tag, kHandshakeLength, kHandshakeTimeoutMs) !=
+                            static_cast<ssize_t>(kHandshakeLength) ||
+                    memcmp(tag, "STRM", kHandshakeLength) != 0 ||
+                    !stream->Send("STRM", kHandshakeLength)) {
+                    PLOG(ERROR) << "Failed to accept data stream " << i;
+                    break;
+                }
+                streams_.push_back(std::move(stream));
+            }
+        }
+
         break;
     }
 }
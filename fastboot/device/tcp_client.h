@@ -16,6 +16,7 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 
 #include "socket.h"
 #include "transport.h"
@@ -33,8 +34,13 @@ class ClientTcpTransport : public Transport {
   private:
     void ListenFastbootSocket();
 
+    // Reads a message striped across the data streams, as described by the 8-byte |header|, into
+    // |data|. Returns the message length or -1 on error.
+    ssize_t ReadStriped(uint64_t header, char* data, size_t len);
+
     std::unique_ptr<Socket> service_;
     std::unique_ptr<Socket> socket_;
+    std::vector<std::unique_ptr<Socket>> streams_;
     uint64_t message_bytes_left_ = 0;
     bool downloading_ = false;
 
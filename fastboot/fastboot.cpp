@@ -44,7 +44,11 @@
 #include <unistd.h>
 
 #include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <functional>
+#include <future>
+#include <mutex>
 #include <regex>
 #include <string>
 #include <thread>
@@ -65,6 +69,7 @@
 #include <platform_tools_version.h>
 #include <sparse/sparse.h>
 #include <ziparchive/zip_archive.h>
+#include <zlib.h>
 
 #include "bootimg_utils.h"
 #include "constants.h"
@@ -413,6 +418,10 @@ static int show_help() {
             " snapshot-update merge      On devices that support snapshot-based updates, finish\n"
             "                            an in-progress update if it is in the \"merging\"\n"
             "                            phase.\n"
+            " benchmark [PARTITION]      Measure the flash pipeline stage by stage: host image\n"
+            "                            read, sparse split, download throughput, and, if a\n"
+            "                            partition is given, device-side write speed. Writing\n"
+            "                            destroys the partition contents.\n"
             "\n"
             "boot image:\n"
             " boot KERNEL [RAMDISK [SECOND]]\n"
@@ -1055,6 +1064,75 @@ static void copy_boot_avb_footer(const std::string& partition, struct fastboot_b
     lseek(fd, 0, SEEK_SET);
 }
 
+// Chunk size for resumable flashing; what the digests from flash-digests and
+// the resent sparse chunks are aligned to.
+static constexpr size_t kResumeChunkSize = 1024 * 1024;
+// Only probe the device for resumable state on images large enough for the
+// digest round trip to pay off.
+static constexpr int64_t kResumeFlashThreshold = 64 * 1024 * 1024;
+
+// Asks the device for per-chunk CRC32s of what |partition| already holds and
+// sends a sparse image that skips every chunk the device already has, so an
+// interrupted flash only resends the missing or mismatched pieces. Returns
+// false if the device does not support flash-digests or no chunk matches; the
+// caller then flashes the whole image as usual.
+static bool try_resumable_flash(const std::string& partition, struct fastboot_buffer* buf) {
+    std::string cmd =
+            android::base::StringPrintf("flash-digests:%s:%08zx:%08" PRIx64, partition.c_str(),
+                                        kResumeChunkSize, static_cast<uint64_t>(buf->sz));
+    std::vector<std::string> info;
+    if (fb->RawCommand(cmd, nullptr, &info) != fastboot::SUCCESS) {
+        return false;
+    }
+
+    std::vector<uint32_t> digests;
+    for (const auto& line : info) {
+        for (const auto& word : android::base::Split(line, " ")) {
+            if (word.empty()) continue;
+            uint32_t digest;
+            if (!android::base::ParseUint("0x" + word, &digest)) {
+                return false;
+            }
+            digests.push_back(digest);
+        }
+    }
+    size_t chunk_count = (buf->sz + kResumeChunkSize - 1) / kResumeChunkSize;
+    if (digests.size() != chunk_count) {
+        return false;
+    }
+
+    std::unique_ptr<sparse_file, decltype(&sparse_file_destroy)> s(
+            sparse_file_new(4096, buf->sz), sparse_file_destroy);
+    if (!s) {
+        return false;
+    }
+    std::vector<unsigned char> chunk(kResumeChunkSize);
+    size_t matched = 0;
+    for (size_t i = 0; i < chunk_count; ++i) {
+        int64_t offset = static_cast<int64_t>(i) * kResumeChunkSize;
+        size_t length = std::min(static_cast<int64_t>(kResumeChunkSize), buf->sz - offset);
+        if (pread(buf->fd, chunk.data(), length, offset) != static_cast<ssize_t>(length)) {
+            return false;
+        }
+        if (crc32(0, chunk.data(), length) == digests[i]) {
+            matched++;
+            continue;
+        }
+        if (sparse_file_add_fd(s.get(), buf->fd, offset, length, offset / 4096)) {
+            return false;
+        }
+    }
+    if (matched == 0) {
+        return false;
+    }
+
+    fprintf(stderr, "Device already has %zu/%zu chunks of %s, sending the rest\n", matched,
+            chunk_count, partition.c_str());
+    int64_t sz = sparse_file_len(s.get(), true, false);
+    fb->FlashPartition(partition, s.get(), sz, 1, 1);
+    return true;
+}
+
 static void flash_buf(const std::string& partition, struct fastboot_buffer *buf)
 {
     sparse_file** s;
@@ -1090,13 +1168,95 @@ static void flash_buf(const std::string& partition, struct fastboot_buffer *buf)
             break;
         }
         case FB_BUFFER_FD:
-            fb->FlashPartition(partition, buf->fd, buf->sz);
+            if (buf->sz < kResumeFlashThreshold || !try_resumable_flash(partition, buf)) {
+                fb->FlashPartition(partition, buf->fd, buf->sz);
+            }
             break;
         default:
             die("unknown buffer type: %d", buf->type);
     }
 }
 
+// Data size for the benchmark phases, clamped to max-download-size.
+static constexpr int64_t kBenchmarkSize = 256 * 1024 * 1024;
+
+static void report_benchmark(const char* phase, int64_t bytes, double seconds) {
+    fprintf(stderr, "benchmark: %-12s %8.1f MB/s (%" PRId64 " bytes in %.3fs)\n", phase,
+            bytes / seconds / 1024 / 1024, bytes, seconds);
+}
+
+// Times each stage of the flash pipeline in isolation: reading an image on
+// the host, splitting it into sparse files, pushing it over the transport,
+// and, when |partition| is given, raw device-side writes via the
+// benchmark-write command. The per-phase lines are stable for CI to diff.
+static void do_benchmark(const std::string& partition) {
+    int64_t size = kBenchmarkSize;
+    std::string max_download_size;
+    uint64_t limit;
+    if (fb->GetVar("max-download-size", &max_download_size) == fastboot::SUCCESS &&
+        android::base::ParseUint(fb_fix_numeric_var(max_download_size), &limit) && limit > 0 &&
+        limit < static_cast<uint64_t>(size)) {
+        size = limit;
+    }
+
+    // Stage a scratch file of incompressible data; generation is not timed.
+    TemporaryFile scratch;
+    std::vector<char> block(1024 * 1024);
+    uint32_t seed = 0x12345678;
+    for (auto& c : block) {
+        seed = seed * 1664525 + 1013904223;
+        c = seed >> 24;
+    }
+    for (int64_t written = 0; written < size; written += block.size()) {
+        if (!android::base::WriteFully(scratch.fd, block.data(), block.size())) {
+            die("Cannot write scratch file: %s", strerror(errno));
+        }
+    }
+
+    // Host read, as load_buf would do it. The scratch file was just written,
+    // so a warm page cache makes this an upper bound for host disk.
+    unique_fd fd(open(scratch.path, O_RDONLY | O_BINARY));
+    if (fd == -1) {
+        die("Cannot open scratch file: %s", strerror(errno));
+    }
+    double start = now();
+    for (int64_t remaining = size; remaining > 0; remaining -= block.size()) {
+        if (!android::base::ReadFully(fd.get(), block.data(), block.size())) {
+            die("Cannot read scratch file: %s", strerror(errno));
+        }
+    }
+    report_benchmark("host read", size, now() - start);
+
+    // Sparse split, as flashing an image larger than max-download-size would.
+    lseek(fd.get(), 0, SEEK_SET);
+    start = now();
+    sparse_file** s = load_sparse_files(fd.get(), size);
+    report_benchmark("sparse split", size, now() - start);
+    for (sparse_file** file = s; *file; file++) {
+        sparse_file_destroy(*file);
+    }
+    free(s);
+
+    // Raw transport throughput; leaves the data staged for benchmark-write.
+    lseek(fd.get(), 0, SEEK_SET);
+    start = now();
+    if (fb->Download(fd.get(), size) != fastboot::SUCCESS) {
+        die("Download failed: %s", fb->Error().c_str());
+    }
+    report_benchmark("download", size, now() - start);
+
+    if (!partition.empty()) {
+        std::string response;
+        start = now();
+        if (fb->RawCommand(FB_CMD_BENCHMARK_WRITE ":" + partition, &response) !=
+            fastboot::SUCCESS) {
+            die("benchmark-write failed: %s", fb->Error().c_str());
+        }
+        report_benchmark("device write", size, now() - start);
+        fprintf(stderr, "benchmark: device reports %s\n", response.c_str());
+    }
+}
+
 static std::string get_current_slot() {
     std::string current_slot;
     if (fb->GetVar("current-slot", &current_slot) != fastboot::SUCCESS) return "";
@@ -1316,11 +1476,23 @@ class FlashAllTool {
     void Flash();
 
   private:
+    // An image that has been loaded (including sparse decomposition) off the
+    // flashing thread, ready to be sent to the device.
+    struct PreparedImage {
+        const Image* image;
+        std::string slot;
+        fastboot_buffer buf;
+        std::vector<char> signature;
+        bool has_signature;
+        bool loaded;
+        int load_errno;
+    };
+
     void CheckRequirements();
     void DetermineSecondarySlot();
     void CollectImages();
     void FlashImages(const std::vector<std::pair<const Image*, std::string>>& images);
-    void FlashImage(const Image& image, const std::string& slot, fastboot_buffer* buf);
+    void FlashImage(PreparedImage* prepared);
     void UpdateSuperPartition();
 
     const ImageSource& source_;
@@ -1422,33 +1594,77 @@ void FlashAllTool::CollectImages() {
 }
 
 void FlashAllTool::FlashImages(const std::vector<std::pair<const Image*, std::string>>& images) {
-    for (const auto& [image, slot] : images) {
-        fastboot_buffer buf;
-        int fd = source_.OpenFile(image->img_name);
-        if (fd < 0 || !load_buf_fd(fd, &buf)) {
-            if (image->optional_if_no_image) {
+    // Loading an image is disk bound (reading the file and decomposing it
+    // into sparse chunks in load_buf_fd), while flashing it is bound by the
+    // USB link. Overlap the two by preparing upcoming images on a worker
+    // thread while this thread sends the current one. The queue is kept
+    // short so that at most a couple of images are resident at once; the
+    // sending stays on this thread since the fastboot connection is a
+    // single stream.
+    //
+    // Resolve the target sparse limit before the worker starts, so that
+    // load_buf_fd does not query the device while a transfer is in flight.
+    get_sparse_limit(0);
+
+    static constexpr size_t kMaxPreparedImages = 2;
+    std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    std::deque<PreparedImage> queue;
+
+    std::thread preparer([&, this] {
+        for (const auto& [image, slot] : images) {
+            PreparedImage prepared;
+            prepared.image = image;
+            prepared.slot = slot;
+            int fd = source_.OpenFile(image->img_name);
+            prepared.loaded = fd >= 0 && load_buf_fd(fd, &prepared.buf);
+            prepared.load_errno = errno;
+            // Read the signature here as well: the ImageSource (e.g. the zip
+            // archive) must only be touched from this thread.
+            prepared.has_signature =
+                    prepared.loaded && source_.ReadFile(image->sig_name, &prepared.signature);
+
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_cv.wait(lock, [&] { return queue.size() < kMaxPreparedImages; });
+            queue.push_back(std::move(prepared));
+            queue_cv.notify_all();
+        }
+    });
+
+    for (size_t i = 0; i < images.size(); ++i) {
+        PreparedImage prepared;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_cv.wait(lock, [&] { return !queue.empty(); });
+            prepared = std::move(queue.front());
+            queue.pop_front();
+            queue_cv.notify_all();
+        }
+        if (!prepared.loaded) {
+            if (prepared.image->optional_if_no_image) {
                 continue;
             }
-            die("could not load '%s': %s", image->img_name, strerror(errno));
+            die("could not load '%s': %s", prepared.image->img_name,
+                strerror(prepared.load_errno));
         }
-        FlashImage(*image, slot, &buf);
+        FlashImage(&prepared);
     }
+    preparer.join();
 }
 
-void FlashAllTool::FlashImage(const Image& image, const std::string& slot, fastboot_buffer* buf) {
+void FlashAllTool::FlashImage(PreparedImage* prepared) {
     auto flash = [&, this](const std::string& partition_name) {
-        std::vector<char> signature_data;
-        if (source_.ReadFile(image.sig_name, &signature_data)) {
-            fb->Download("signature", signature_data);
+        if (prepared->has_signature) {
+            fb->Download("signature", prepared->signature);
             fb->RawCommand("signature", "installing signature");
         }
 
         if (is_logical(partition_name)) {
-            fb->ResizePartition(partition_name, std::to_string(buf->image_size));
+            fb->ResizePartition(partition_name, std::to_string(prepared->buf.image_size));
         }
-        flash_buf(partition_name.c_str(), buf);
+        flash_buf(partition_name.c_str(), &prepared->buf);
     };
-    do_for_partitions(image.part_name, slot, flash, false);
+    do_for_partitions(prepared->image->part_name, prepared->slot, flash, false);
 }
 
 void FlashAllTool::UpdateSuperPartition() {
@@ -1578,17 +1794,23 @@ static unsigned fb_get_flash_block_size(std::string name) {
     return size;
 }
 
-static void fb_perform_format(
+// A queued format. The image is generated on a worker thread so that images
+// for several partitions can be built concurrently; flashing stays on the
+// calling thread.
+struct FormatTask {
+    std::string partition;
+    std::unique_ptr<TemporaryFile> output;
+    std::future<int> generation;
+};
+
+static bool fb_format_prepare(
                               const std::string& partition, int skip_if_not_supported,
                               const std::string& type_override, const std::string& size_override,
-                              const std::string& initial_dir) {
+                              const std::string& initial_dir, FormatTask* task) {
     std::string partition_type, partition_size;
 
-    struct fastboot_buffer buf;
     const char* errMsg = nullptr;
     const struct fs_generator* gen = nullptr;
-    TemporaryFile output;
-    unique_fd fd;
 
     unsigned int limit = INT_MAX;
     if (target_sparse_limit > 0 && target_sparse_limit < limit) {
@@ -1628,7 +1850,7 @@ static void fb_perform_format(
         if (skip_if_not_supported) {
             fprintf(stderr, "Erase successful, but not automatically formatting.\n");
             fprintf(stderr, "File system type %s not supported.\n", partition_type.c_str());
-            return;
+            return false;
         }
         die("Formatting is not supported for file system with type '%s'.",
             partition_type.c_str());
@@ -1643,20 +1865,12 @@ static void fb_perform_format(
     eraseBlkSize = fb_get_flash_block_size("erase-block-size");
     logicalBlkSize = fb_get_flash_block_size("logical-block-size");
 
-    if (fs_generator_generate(gen, output.path, size, initial_dir,
-            eraseBlkSize, logicalBlkSize)) {
-        die("Cannot generate image for %s", partition.c_str());
-    }
-
-    fd.reset(open(output.path, O_RDONLY));
-    if (fd == -1) {
-        die("Cannot open generated image: %s", strerror(errno));
-    }
-    if (!load_buf_fd(fd.release(), &buf)) {
-        die("Cannot read image: %s", strerror(errno));
-    }
-    flash_buf(partition, &buf);
-    return;
+    task->partition = partition;
+    task->output = std::make_unique<TemporaryFile>();
+    task->generation = std::async(std::launch::async, fs_generator_generate, gen,
+                                  task->output->path, size, initial_dir, eraseBlkSize,
+                                  logicalBlkSize);
+    return true;
 
 failed:
     if (skip_if_not_supported) {
@@ -1667,6 +1881,34 @@ failed:
     if (!skip_if_not_supported) {
         die("Command failed");
     }
+    return false;
+}
+
+static void fb_format_flash(FormatTask* task) {
+    if (task->generation.get()) {
+        die("Cannot generate image for %s", task->partition.c_str());
+    }
+
+    unique_fd fd(open(task->output->path, O_RDONLY));
+    if (fd == -1) {
+        die("Cannot open generated image: %s", strerror(errno));
+    }
+    struct fastboot_buffer buf;
+    if (!load_buf_fd(fd.release(), &buf)) {
+        die("Cannot read image: %s", strerror(errno));
+    }
+    flash_buf(task->partition, &buf);
+}
+
+static void fb_perform_format(
+                              const std::string& partition, int skip_if_not_supported,
+                              const std::string& type_override, const std::string& size_override,
+                              const std::string& initial_dir) {
+    FormatTask task;
+    if (fb_format_prepare(partition, skip_if_not_supported, type_override, size_override,
+                          initial_dir, &task)) {
+        fb_format_flash(&task);
+    }
 }
 
 static bool should_flash_in_userspace(const std::string& partition_name) {
@@ -2099,6 +2341,12 @@ int FastBootTool::Main(int argc, char* argv[]) {
         } else if (command == FB_CMD_SET_ACTIVE) {
             std::string slot = verify_slot(next_arg(&args), false);
             fb->SetActive(slot);
+        } else if (command == "benchmark") {
+            std::string partition;
+            if (!args.empty()) {
+                partition = next_arg(&args);
+            }
+            do_benchmark(partition);
         } else if (command == "stage") {
             std::string filename = next_arg(&args);
 
@@ -2169,7 +2417,13 @@ int FastBootTool::Main(int argc, char* argv[]) {
         if (force_flash) {
             CancelSnapshotIfNeeded();
         }
+        // Queries, erases and flashes stay on this thread, but the filesystem
+        // images are generated concurrently so that the flash pipeline only
+        // ever waits for the largest one.
         std::vector<std::string> partitions = { "userdata", "cache", "metadata" };
+        std::vector<std::unique_ptr<FormatTask>> format_tasks;
+        size_t max_parallel = std::max(1u, std::thread::hardware_concurrency());
+        std::string fbe_marker_dir;
         for (const auto& partition : partitions) {
             std::string partition_type;
             if (fb->GetVar("partition-type:" + partition, &partition_type) != fastboot::SUCCESS) {
@@ -2177,14 +2431,25 @@ int FastBootTool::Main(int argc, char* argv[]) {
             }
             if (partition_type.empty()) continue;
             fb->Erase(partition);
+            std::string initial_dir;
             if (partition == "userdata" && set_fbe_marker) {
                 fprintf(stderr, "setting FBE marker on initial userdata...\n");
-                std::string initial_userdata_dir = create_fbemarker_tmpdir();
-                fb_perform_format(partition, 1, partition_type, "", initial_userdata_dir);
-                delete_fbemarker_tmpdir(initial_userdata_dir);
-            } else {
-                fb_perform_format(partition, 1, partition_type, "", "");
+                fbe_marker_dir = create_fbemarker_tmpdir();
+                initial_dir = fbe_marker_dir;
+            }
+            if (format_tasks.size() >= max_parallel) {
+                format_tasks[format_tasks.size() - max_parallel]->generation.wait();
             }
+            auto task = std::make_unique<FormatTask>();
+            if (fb_format_prepare(partition, 1, partition_type, "", initial_dir, task.get())) {
+                format_tasks.push_back(std::move(task));
+            }
+        }
+        for (auto& task : format_tasks) {
+            fb_format_flash(task.get());
+        }
+        if (!fbe_marker_dir.empty()) {
+            delete_fbemarker_tmpdir(fbe_marker_dir);
         }
     }
     if (wants_set_active) {
@@ -545,34 +545,28 @@ RetCode FastBootDriver::ReadBuffer(void* buf, size_t size) {
 }
 
 int FastBootDriver::SparseWriteCallback(std::vector<char>& tpbuf, const char* data, size_t len) {
-    size_t total = 0;
-    size_t to_write = std::min(TRANSPORT_CHUNK_SIZE - tpbuf.size(), len);
-
-    // Handle the residual
-    tpbuf.insert(tpbuf.end(), data, data + to_write);
-    if (tpbuf.size() < TRANSPORT_CHUNK_SIZE) {  // Nothing enough to send rn
+    // Batch the small pieces (chunk headers, fill words) into tpbuf, but hand
+    // anything of at least a transport chunk straight to the transport. For
+    // data chunks libsparse passes a pointer into its mapping of the image
+    // file, so staging those here would memcpy every payload byte.
+    if (tpbuf.size() + len < TRANSPORT_CHUNK_SIZE) {
+        tpbuf.insert(tpbuf.end(), data, data + len);
         return 0;
     }
 
-    if (SendBuffer(tpbuf)) {
-        error_ = ErrnoStr("Send failed in SparseWriteCallback()");
-        return -1;
+    // Flush the residual first to keep the stream in order.
+    if (tpbuf.size()) {
+        if (SendBuffer(tpbuf)) {
+            error_ = ErrnoStr("Send failed in SparseWriteCallback()");
+            return -1;
+        }
+        tpbuf.clear();
     }
-    tpbuf.clear();
-    total += to_write;
 
-    // Now we need to send a multiple of chunk size
-    size_t nchunks = (len - total) / TRANSPORT_CHUNK_SIZE;
-    size_t nbytes = TRANSPORT_CHUNK_SIZE * nchunks;
-    if (nbytes && SendBuffer(data + total, nbytes)) {  // Don't send a ZLP
+    if (len && SendBuffer(data, len)) {  // Don't send a ZLP
         error_ = ErrnoStr("Send failed in SparseWriteCallback()");
         return -1;
     }
-    total += nbytes;
-
-    if (len - total > 0) {  // We have residual data to save for next time
-        tpbuf.assign(data + total, data + len);
-    }
 
     return 0;
 }
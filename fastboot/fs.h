@@ -6,5 +6,7 @@
 struct fs_generator;
 
 const struct fs_generator* fs_get_generator(const std::string& fs_type);
+// Runs the generator for one partition image. Only touches |fileName| and
+// subprocesses, so independent images may be generated concurrently.
 int fs_generator_generate(const struct fs_generator* gen, const char* fileName, long long partSize,
     const std::string& initial_dir, unsigned eraseBlkSize = 0, unsigned logicalBlkSize = 0);
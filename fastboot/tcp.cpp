@@ -28,15 +28,31 @@
 
 #include "tcp.h"
 
+#include <algorithm>
+
 #include <android-base/parseint.h>
 #include <android-base/stringprintf.h>
 
 namespace tcp {
 
-static constexpr int kProtocolVersion = 1;
+static constexpr int kProtocolVersion = 2;
+static constexpr int kMinProtocolVersion = 1;
 static constexpr size_t kHandshakeLength = 4;
 static constexpr int kHandshakeTimeoutMs = 2000;
 
+// Protocol version 2 adds multi-stream downloads: after the handshake the host dials extra data
+// connections and announces the count with a 4-byte "MSnn" message; the device confirms each one
+// with a "STRM" tag exchange. A host-to-device message whose length header has the top bit set is
+// striped round-robin across the data streams in kStripeChunkSize pieces (the header's next 7 bits
+// carry the stream count), which sidesteps the bandwidth-delay product limit of one connection on
+// high-latency links. Everything else, and everything on a version 1 peer, uses the single control
+// connection.
+static constexpr int kDefaultStreamCount = 4;
+static constexpr size_t kStripeChunkSize = 256 * 1024;
+static constexpr size_t kMinStripedWriteLength = 1024 * 1024;
+static constexpr uint64_t kStripedMessageFlag = uint64_t{1} << 63;
+static constexpr uint64_t kMessageLengthMask = (uint64_t{1} << 56) - 1;
+
 // Extract the big-endian 8-byte message length into a 64-bit number.
 static uint64_t ExtractMessageLength(const void* buffer) {
     uint64_t ret = 0;
@@ -57,7 +73,7 @@ class TcpTransport : public Transport {
   public:
     // Factory function so we can return nullptr if initialization fails.
     static std::unique_ptr<TcpTransport> NewTransport(std::unique_ptr<Socket> socket,
-                                                      std::string* error);
+                                                      StreamDialer dialer, std::string* error);
 
     ~TcpTransport() override = default;
 
@@ -67,21 +83,32 @@ class TcpTransport : public Transport {
     int Reset() override;
 
   private:
-    explicit TcpTransport(std::unique_ptr<Socket> sock) : socket_(std::move(sock)) {}
+    TcpTransport(std::unique_ptr<Socket> sock, StreamDialer dialer)
+        : socket_(std::move(sock)), dialer_(std::move(dialer)) {}
 
     // Connects to the device and performs the initial handshake. Returns false and fills |error|
     // on failure.
     bool InitializeProtocol(std::string* error);
 
+    // Opens and confirms the data streams used to stripe large downloads. Only a control channel
+    // failure is fatal; if a data stream cannot be set up we fall back to single-stream mode.
+    bool OpenStreams(std::string* error);
+
+    // Sends |length| bytes of |data| striped across the data streams.
+    ssize_t WriteStriped(const void* data, size_t length);
+
     std::unique_ptr<Socket> socket_;
+    StreamDialer dialer_;
+    std::vector<std::unique_ptr<Socket>> streams_;
     uint64_t message_bytes_left_ = 0;
 
     DISALLOW_COPY_AND_ASSIGN(TcpTransport);
 };
 
 std::unique_ptr<TcpTransport> TcpTransport::NewTransport(std::unique_ptr<Socket> socket,
-                                                         std::string* error) {
-    std::unique_ptr<TcpTransport> transport(new TcpTransport(std::move(socket)));
+                                                         StreamDialer dialer, std::string* error) {
+    std::unique_ptr<TcpTransport> transport(
+            new TcpTransport(std::move(socket), std::move(dialer)));
 
     if (!transport->InitializeProtocol(error)) {
         return nullptr;
@@ -115,16 +142,61 @@ bool TcpTransport::InitializeProtocol(std::string* error) {
     }
 
     int version = 0;
-    if (!android::base::ParseInt(buffer + 2, &version) || version < kProtocolVersion) {
+    if (!android::base::ParseInt(buffer + 2, &version) || version < kMinProtocolVersion) {
         *error = android::base::StringPrintf("Unknown TCP protocol version %s (host version %02d)",
                                              buffer + 2, kProtocolVersion);
         return false;
     }
 
+    // On a version 2 peer, continue with the multi-stream handshake. A version 1 peer expects no
+    // further handshake traffic and everything runs over the single control connection.
+    if (version >= 2 && !OpenStreams(error)) {
+        return false;
+    }
+
     error->clear();
     return true;
 }
 
+bool TcpTransport::OpenStreams(std::string* error) {
+    // Dial first, so the stream count we announce is one the device can actually accept: the
+    // connections queue up in the device's listen backlog in dial order.
+    std::vector<std::unique_ptr<Socket>> streams;
+    if (dialer_ != nullptr) {
+        for (int i = 0; i < kDefaultStreamCount; ++i) {
+            std::string stream_error;
+            std::unique_ptr<Socket> stream = dialer_(&stream_error);
+            if (stream == nullptr || !stream->Send("STRM", kHandshakeLength)) {
+                break;
+            }
+            streams.push_back(std::move(stream));
+        }
+    }
+
+    std::string announce(android::base::StringPrintf("MS%02zu", streams.size()));
+    if (!socket_->Send(announce.c_str(), kHandshakeLength)) {
+        *error = android::base::StringPrintf("Failed to send stream announcement (%s)",
+                                             Socket::GetErrorMessage().c_str());
+        return false;
+    }
+
+    // The device confirms each stream it accepted. Any mismatch means we cannot trust the striped
+    // path, so drop all the streams and continue single-stream; the control connection is intact.
+    for (auto& stream : streams) {
+        char buffer[kHandshakeLength + 1];
+        buffer[kHandshakeLength] = '\0';
+        if (stream->ReceiveAll(buffer, kHandshakeLength, kHandshakeTimeoutMs) !=
+                    static_cast<ssize_t>(kHandshakeLength) ||
+            memcmp(buffer, "STRM", kHandshakeLength) != 0) {
+            streams.clear();
+            break;
+        }
+    }
+
+    streams_ = std::move(streams);
+    return true;
+}
+
 ssize_t TcpTransport::Read(void* data, size_t length) {
     if (socket_ == nullptr) {
         return -1;
@@ -158,6 +230,10 @@ ssize_t TcpTransport::Write(const void* data, size_t length) {
         return -1;
     }
 
+    if (!streams_.empty() && length >= kMinStripedWriteLength) {
+        return WriteStriped(data, length);
+    }
+
     // Use multi-buffer writes for better performance.
     char header[8];
     EncodeMessageLength(length, header);
@@ -169,11 +245,39 @@ ssize_t TcpTransport::Write(const void* data, size_t length) {
     return length;
 }
 
+ssize_t TcpTransport::WriteStriped(const void* data, size_t length) {
+    char header[8];
+    EncodeMessageLength(kStripedMessageFlag | (uint64_t{streams_.size()} << 56) | length, header);
+    if (!socket_->Send(header, 8)) {
+        Close();
+        return -1;
+    }
+
+    // Round-robin the payload across the streams in fixed-size chunks. The chunks are small
+    // relative to the socket buffers, so all streams stay filled without any threading.
+    const char* buffer = reinterpret_cast<const char*>(data);
+    size_t remaining = length;
+    size_t stream = 0;
+    while (remaining > 0) {
+        size_t chunk = std::min(kStripeChunkSize, remaining);
+        if (!streams_[stream]->Send(buffer, chunk)) {
+            Close();
+            return -1;
+        }
+        buffer += chunk;
+        remaining -= chunk;
+        stream = (stream + 1) % streams_.size();
+    }
+
+    return length;
+}
+
 int TcpTransport::Close() {
     if (socket_ == nullptr) {
         return 0;
     }
 
+    streams_.clear();
     int result = socket_->Close();
     socket_.reset();
     return result;
@@ -184,19 +288,27 @@ int TcpTransport::Reset() {
 }
 
 std::unique_ptr<Transport> Connect(const std::string& hostname, int port, std::string* error) {
+    StreamDialer dialer = [hostname, port](std::string* dial_error) {
+        return Socket::NewClient(Socket::Protocol::kTcp, hostname, port, dial_error);
+    };
     return internal::Connect(Socket::NewClient(Socket::Protocol::kTcp, hostname, port, error),
-                             error);
+                             std::move(dialer), error);
 }
 
 namespace internal {
 
 std::unique_ptr<Transport> Connect(std::unique_ptr<Socket> sock, std::string* error) {
+    return Connect(std::move(sock), nullptr, error);
+}
+
+std::unique_ptr<Transport> Connect(std::unique_ptr<Socket> sock, StreamDialer dialer,
+                                   std::string* error) {
     if (sock == nullptr) {
         // If Socket creation failed |error| is already set.
         return nullptr;
     }
 
-    return TcpTransport::NewTransport(std::move(sock), error);
+    return TcpTransport::NewTransport(std::move(sock), std::move(dialer), error);
 }
 
 }  // namespace internal
@@ -28,6 +28,7 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <string>
 
@@ -40,6 +41,10 @@ namespace tcp {
 
 constexpr int kDefaultPort = 5554;
 
+// Opens an additional connection to the device for multi-stream downloads. Returns nullptr and
+// fills |error| on failure.
+using StreamDialer = std::function<std::unique_ptr<Socket>(std::string* error)>;
+
 // Returns a newly allocated Transport object connected to |hostname|:|port|. On failure, |error| is
 // filled and nullptr is returned.
 std::unique_ptr<Transport> Connect(const std::string& hostname, int port, std::string* error);
@@ -51,6 +56,11 @@ namespace internal {
 // Used for unit tests to create a Transport object that uses a SocketMock.
 std::unique_ptr<Transport> Connect(std::unique_ptr<Socket> sock, std::string* error);
 
+// As above, but with a |dialer| that provides the extra data stream connections, so tests can
+// exercise the multi-stream download path with mock sockets.
+std::unique_ptr<Transport> Connect(std::unique_ptr<Socket> sock, StreamDialer dialer,
+                                   std::string* error);
+
 }  // namespace internal
 
 }  // namespace tcp
@@ -34,7 +34,7 @@
 
 TEST(TcpConnectTest, TestSuccess) {
     std::unique_ptr<SocketMock> mock(new SocketMock);
-    mock->ExpectSend("FB01");
+    mock->ExpectSend("FB02");
     mock->AddReceive("FB01");
 
     std::string error;
@@ -44,8 +44,10 @@ TEST(TcpConnectTest, TestSuccess) {
 
 TEST(TcpConnectTest, TestNewerVersionSuccess) {
     std::unique_ptr<SocketMock> mock(new SocketMock);
-    mock->ExpectSend("FB01");
+    mock->ExpectSend("FB02");
     mock->AddReceive("FB99");
+    // With no stream dialer available the host announces zero data streams.
+    mock->ExpectSend("MS00");
 
     std::string error;
     EXPECT_NE(nullptr, tcp::internal::Connect(std::move(mock), &error));
@@ -54,7 +56,7 @@ TEST(TcpConnectTest, TestNewerVersionSuccess) {
 
 TEST(TcpConnectTest, TestSendFailure) {
     std::unique_ptr<SocketMock> mock(new SocketMock);
-    mock->ExpectSendFailure("FB01");
+    mock->ExpectSendFailure("FB02");
 
     std::string error;
     EXPECT_EQ(nullptr, tcp::internal::Connect(std::move(mock), &error));
@@ -63,7 +65,7 @@ TEST(TcpConnectTest, TestSendFailure) {
 
 TEST(TcpConnectTest, TestNoResponseFailure) {
     std::unique_ptr<SocketMock> mock(new SocketMock);
-    mock->ExpectSend("FB01");
+    mock->ExpectSend("FB02");
     mock->AddReceiveFailure();
 
     std::string error;
@@ -73,7 +75,7 @@ TEST(TcpConnectTest, TestNoResponseFailure) {
 
 TEST(TcpConnectTest, TestBadResponseFailure) {
     std::unique_ptr<SocketMock> mock(new SocketMock);
-    mock->ExpectSend("FB01");
+    mock->ExpectSend("FB02");
     mock->AddReceive("XX01");
 
     std::string error;
@@ -83,12 +85,81 @@ TEST(TcpConnectTest, TestBadResponseFailure) {
 
 TEST(TcpConnectTest, TestUnknownVersionFailure) {
     std::unique_ptr<SocketMock> mock(new SocketMock);
-    mock->ExpectSend("FB01");
+    mock->ExpectSend("FB02");
     mock->AddReceive("FB00");
 
     std::string error;
     EXPECT_EQ(nullptr, tcp::internal::Connect(std::move(mock), &error));
-    EXPECT_EQ("Unknown TCP protocol version 00 (host version 01)", error);
+    EXPECT_EQ("Unknown TCP protocol version 00 (host version 02)", error);
+}
+
+// Tests multi-stream negotiation and a write striped across the data streams.
+TEST(TcpConnectTest, TestMultiStreamWriteSuccess) {
+    std::unique_ptr<SocketMock> mock(new SocketMock);
+    mock->ExpectSend("FB02");
+    mock->AddReceive("FB02");
+    mock->ExpectSend("MS04");
+
+    // 1MiB payload striped as four 256KiB chunks, one per stream.
+    std::string data(0x100000, '\0');
+    for (size_t i = 0; i < data.length(); ++i) {
+        data[i] = i;
+    }
+    std::vector<SocketMock*> streams;
+    for (int i = 0; i < 4; ++i) {
+        SocketMock* stream = new SocketMock;
+        stream->ExpectSend("STRM");
+        stream->AddReceive("STRM");
+        stream->ExpectSend(data.substr(i * 0x40000, 0x40000));
+        streams.push_back(stream);
+    }
+
+    size_t next_stream = 0;
+    tcp::StreamDialer dialer = [&](std::string*) {
+        return std::unique_ptr<Socket>(streams[next_stream++]);
+    };
+
+    // Striped message header: top bit set, stream count 4, length 1MiB.
+    mock->ExpectSend(std::string{'\x84', 0, 0, 0, 0, 0x10, 0, 0});
+
+    std::string error;
+    std::unique_ptr<Transport> transport = tcp::internal::Connect(std::move(mock), dialer, &error);
+    ASSERT_NE(nullptr, transport);
+    ASSERT_EQ("", error);
+
+    EXPECT_EQ(static_cast<ssize_t>(data.length()), transport->Write(data.data(), data.length()));
+}
+
+// Tests that an unconfirmed data stream drops the host back to single-stream mode.
+TEST(TcpConnectTest, TestMultiStreamFallback) {
+    std::unique_ptr<SocketMock> mock(new SocketMock);
+    mock->ExpectSend("FB02");
+    mock->AddReceive("FB02");
+    mock->ExpectSend("MS01");
+
+    SocketMock* stream = new SocketMock;
+    stream->ExpectSend("STRM");
+    stream->AddReceiveFailure();
+
+    bool dialed = false;
+    tcp::StreamDialer dialer = [&](std::string*) -> std::unique_ptr<Socket> {
+        if (dialed) {
+            return nullptr;
+        }
+        dialed = true;
+        return std::unique_ptr<Socket>(stream);
+    };
+
+    // Large writes stay on the control connection with a plain header.
+    std::string data(0x100000, '\0');
+    mock->ExpectSend(std::string{0, 0, 0, 0, 0, 0x10, 0, 0} + data);
+
+    std::string error;
+    std::unique_ptr<Transport> transport = tcp::internal::Connect(std::move(mock), dialer, &error);
+    ASSERT_NE(nullptr, transport);
+    ASSERT_EQ("", error);
+
+    EXPECT_EQ(static_cast<ssize_t>(data.length()), transport->Write(data.data(), data.length()));
 }
 
 // Fixture to configure a SocketMock for a successful TCP connection.
@@ -96,7 +167,7 @@ class TcpTest : public ::testing::Test {
   protected:
     void SetUp() override {
         mock_ = new SocketMock;
-        mock_->ExpectSend("FB01");
+        mock_->ExpectSend("FB02");
         mock_->AddReceive("FB01");
 
         std::string error;
@@ -30,6 +30,7 @@
 #include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -85,6 +86,13 @@ using namespace std::chrono_literals;
 // kernel.
 #define MAX_USBFS_BULK_SIZE (16 * 1024)
 
+/* Number of URBs kept in flight on the bulk-out endpoint for large writes.
+ * Synchronous USBDEVFS_BULK leaves the bus idle between every 16KiB ioctl;
+ * a few outstanding URBs are enough to cover that gap, and each one pins
+ * its 16KiB of the caller's buffer in kernel memory while queued.
+ */
+#define MAX_USBFS_URBS_IN_FLIGHT 8
+
 struct usb_handle
 {
     char fname[64];
@@ -106,6 +114,9 @@ class LinuxUsbTransport : public UsbTransport {
     int WaitForDisconnect() override;
 
   private:
+    ssize_t WriteAsync(const unsigned char* data, size_t len);
+    int ReapUrb(struct usbdevfs_urb** urb);
+
     std::unique_ptr<usb_handle> handle_;
     const uint32_t ms_timeout_;
 
@@ -411,6 +422,14 @@ ssize_t LinuxUsbTransport::Write(const void* _data, size_t len)
         return -1;
     }
 
+    /* Anything larger than a single bulk ioctl is pipelined through the
+     * async URB ring; the synchronous path below keeps its semantics for
+     * command-sized writes (including zero-length ones).
+     */
+    if (len > MAX_USBFS_BULK_SIZE) {
+        return WriteAsync(data, len);
+    }
+
     do {
         int xfer;
         xfer = (len > MAX_USBFS_BULK_SIZE) ? MAX_USBFS_BULK_SIZE : len;
@@ -435,6 +454,120 @@ ssize_t LinuxUsbTransport::Write(const void* _data, size_t len)
     return count;
 }
 
+/* Reaps one completed URB, honoring ms_timeout_. usbfs signals POLLOUT once
+ * a completion is ready to reap, so polling first lets us keep the timeout
+ * that the synchronous bulk ioctl provided.
+ */
+int LinuxUsbTransport::ReapUrb(struct usbdevfs_urb** urb)
+{
+    struct pollfd pfd;
+    int n;
+
+    pfd.fd = handle_->desc;
+    pfd.events = POLLOUT;
+    pfd.revents = 0;
+
+    do {
+        n = poll(&pfd, 1, ms_timeout_ ? (int) ms_timeout_ : -1);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) {
+        if (n == 0) errno = ETIMEDOUT;
+        return -1;
+    }
+
+    do {
+        n = ioctl(handle_->desc, USBDEVFS_REAPURBNDELAY, urb);
+    } while (n < 0 && errno == EINTR);
+    return n;
+}
+
+ssize_t LinuxUsbTransport::WriteAsync(const unsigned char* data, size_t len)
+{
+    struct usbdevfs_urb urbs[MAX_USBFS_URBS_IN_FLIGHT];
+    struct usbdevfs_urb* free_list[MAX_USBFS_URBS_IN_FLIGHT];
+    unsigned num_free = MAX_USBFS_URBS_IN_FLIGHT;
+    unsigned in_flight = 0;
+    size_t count = 0;
+    int failed = 0;
+    unsigned i;
+
+    for (i = 0; i < MAX_USBFS_URBS_IN_FLIGHT; i++) {
+        free_list[i] = &urbs[i];
+    }
+
+    while ((len > 0 && !failed) || in_flight > 0) {
+        /* Keep the ring full while there is still data to submit. The URBs
+         * reference the caller's buffer directly; nothing is copied.
+         */
+        while (len > 0 && num_free > 0 && !failed) {
+            struct usbdevfs_urb* urb = free_list[num_free - 1];
+            unsigned xfer = (len > MAX_USBFS_BULK_SIZE) ? MAX_USBFS_BULK_SIZE : len;
+
+            memset(urb, 0, sizeof(*urb));
+            urb->type = USBDEVFS_URB_TYPE_BULK;
+            urb->endpoint = handle_->ep_out;
+            urb->buffer = (void*) data;
+            urb->buffer_length = xfer;
+
+            if (ioctl(handle_->desc, USBDEVFS_SUBMITURB, urb) != 0) {
+                DBG("ERROR: submit urb, errno = %d (%s)\n", errno, strerror(errno));
+                failed = 1;
+                break;
+            }
+            num_free--;
+            in_flight++;
+            data += xfer;
+            len -= xfer;
+        }
+
+        if (in_flight == 0) {
+            break;
+        }
+
+        struct usbdevfs_urb* done;
+        if (ReapUrb(&done) != 0) {
+            DBG("ERROR: reap urb, errno = %d (%s)\n", errno, strerror(errno));
+            failed = 1;
+            break;
+        }
+        in_flight--;
+        free_list[num_free++] = done;
+
+        if (done->status != 0 || (unsigned) done->actual_length != (unsigned) done->buffer_length) {
+            DBG("ERROR: urb status = %d, actual = %d of %d\n",
+                done->status, done->actual_length, done->buffer_length);
+            failed = 1;
+        } else {
+            count += done->actual_length;
+        }
+    }
+
+    /* The URBs live on this stack frame, so anything the kernel still owns
+     * must be cancelled and reaped before we return.
+     */
+    if (in_flight > 0) {
+        for (i = 0; i < MAX_USBFS_URBS_IN_FLIGHT; i++) {
+            unsigned j;
+            for (j = 0; j < num_free; j++) {
+                if (free_list[j] == &urbs[i]) break;
+            }
+            if (j == num_free) {
+                ioctl(handle_->desc, USBDEVFS_DISCARDURB, &urbs[i]);
+            }
+        }
+        while (in_flight > 0) {
+            struct usbdevfs_urb* done;
+            if (ioctl(handle_->desc, USBDEVFS_REAPURB, &done) != 0) {
+                if (errno == EINTR) continue;
+                break;  /* device gone; the kernel has killed the URBs */
+            }
+            in_flight--;
+        }
+    }
+
+    return failed ? -1 : (ssize_t) count;
+}
+
 ssize_t LinuxUsbTransport::Read(void* _data, size_t len)
 {
     unsigned char *data = (unsigned char*) _data;
@@ -25,6 +25,7 @@
 #include <unistd.h>
 #endif
 
+#include <algorithm>
 #include <functional>
 #include <thread>
 
@@ -52,6 +53,28 @@ bool PollForFile(const std::string& path, const std::chrono::milliseconds relati
     }
 }
 
+bool PollForFiles(const std::vector<std::string>& paths,
+                  const std::chrono::milliseconds relative_timeout) {
+    auto start_time = std::chrono::steady_clock::now();
+
+    while (true) {
+        bool all_exist = true;
+        for (const auto& path : paths) {
+            if (access(path.c_str(), F_OK) && errno == ENOENT) {
+                all_exist = false;
+                break;
+            }
+        }
+        if (all_exist) return true;
+
+        std::this_thread::sleep_for(50ms);
+
+        auto now = std::chrono::steady_clock::now();
+        auto time_elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - start_time);
+        if (time_elapsed > relative_timeout) return false;
+    }
+}
+
 bool PollForFileDeleted(const std::string& path, const std::chrono::milliseconds relative_timeout) {
     auto start_time = std::chrono::steady_clock::now();
 
@@ -210,8 +233,115 @@ int64_t OneShotInotify::RemainingMs() const {
     auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(remaining);
     return (relative_timeout_ - elapsed).count();
 }
+
+bool FileWaiter::EnsureWatches(const std::vector<std::string>& paths) {
+    if (inotify_fd_ < 0) {
+        unique_fd fd(inotify_init1(IN_CLOEXEC | IN_NONBLOCK));
+        if (fd < 0) {
+            PLOG(ERROR) << "inotify_init1 failed";
+            return false;
+        }
+        inotify_fd_ = std::move(fd);
+    }
+    for (const auto& path : paths) {
+        auto dir = android::base::Dirname(path);
+        if (watched_dirs_.count(dir)) continue;
+        int wd = inotify_add_watch(inotify_fd_, dir.c_str(), IN_CREATE);
+        if (wd < 0) {
+            PLOG(ERROR) << "inotify_add_watch failed: " << dir;
+            return false;
+        }
+        watched_dirs_.emplace(dir, wd);
+    }
+    return true;
+}
+
+bool FileWaiter::DrainEvents() {
+    // According to the manpage, this is enough to read at least one event.
+    static constexpr size_t kBufferSize = sizeof(struct inotify_event) + NAME_MAX + 1;
+    char buffer[kBufferSize];
+
+    do {
+        ssize_t rv = TEMP_FAILURE_RETRY(read(inotify_fd_, buffer, sizeof(buffer)));
+        if (rv <= 0) {
+            if (rv == 0 || errno == EAGAIN) {
+                return true;
+            }
+            PLOG(ERROR) << "read inotify failed";
+            return false;
+        }
+    } while (true);
+}
 #endif
 
+bool FileWaiter::WaitForFile(const std::string& path,
+                             const std::chrono::milliseconds relative_timeout) {
+    return WaitForFiles({path}, relative_timeout);
+}
+
+bool FileWaiter::WaitForFiles(const std::vector<std::string>& paths,
+                              const std::chrono::milliseconds relative_timeout) {
+#if defined(__linux__)
+    auto start_time = std::chrono::steady_clock::now();
+    auto remaining_ms = [&]() -> int64_t {
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start_time);
+        return (relative_timeout - elapsed).count();
+    };
+    auto poll_fallback = [&](const std::vector<std::string>& files) {
+        return PollForFiles(files, std::chrono::milliseconds(std::max<int64_t>(remaining_ms(), 0)));
+    };
+
+    // Discard any events queued up since the last wait; the access() checks
+    // below establish the current state of each path.
+    if (!EnsureWatches(paths) || !DrainEvents()) {
+        return poll_fallback(paths);
+    }
+
+    std::vector<std::string> pending;
+    for (const auto& path : paths) {
+        if (access(path.c_str(), F_OK) && errno == ENOENT) {
+            pending.emplace_back(path);
+        }
+    }
+
+    while (!pending.empty()) {
+        auto timeout = remaining_ms();
+        if (timeout <= 0) return false;
+
+        struct pollfd event = {
+                .fd = inotify_fd_,
+                .events = POLLIN,
+                .revents = 0,
+        };
+        int rv = poll(&event, 1, static_cast<int>(timeout));
+        if (rv <= 0) {
+            if (rv == 0 || errno == EINTR) {
+                continue;
+            }
+            PLOG(ERROR) << "poll for inotify failed";
+            return poll_fallback(pending);
+        }
+        if (event.revents & POLLERR) {
+            LOG(ERROR) << "error reading inotify events";
+            return poll_fallback(pending);
+        }
+        if (!DrainEvents()) {
+            return poll_fallback(pending);
+        }
+
+        // Complete whichever paths have appeared, in any order.
+        auto exists = [](const std::string& path) {
+            return !access(path.c_str(), F_OK) || errno != ENOENT;
+        };
+        pending.erase(std::remove_if(pending.begin(), pending.end(), exists), pending.end());
+    }
+    return true;
+#else
+    return PollForFiles(paths, relative_timeout);
+#endif
+}
+
 bool WaitForFile(const std::string& path, const std::chrono::milliseconds relative_timeout) {
 #if defined(__linux__)
     OneShotInotify inotify(path, IN_CREATE, relative_timeout);
@@ -221,6 +351,12 @@ bool WaitForFile(const std::string& path, const std::chrono::milliseconds relati
 #endif
 }
 
+bool WaitForFiles(const std::vector<std::string>& paths,
+                  const std::chrono::milliseconds relative_timeout) {
+    FileWaiter waiter;
+    return waiter.WaitForFiles(paths, relative_timeout);
+}
+
 // Wait at most |relative_timeout| milliseconds for |path| to stop existing.
 bool WaitForFileDeleted(const std::string& path, const std::chrono::milliseconds relative_timeout) {
 #if defined(__linux__)
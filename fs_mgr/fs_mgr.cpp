@@ -34,10 +34,14 @@
 #include <time.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <chrono>
+#include <condition_variable>
 #include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <string>
 #include <thread>
 #include <utility>
@@ -816,6 +820,134 @@ static bool fs_match(const std::string& in1, const std::string& in2) {
     return true;
 }
 
+// Runs prepare_fs_for_mount() (superblock reads, tune2fs and e2fsck/f2fs.fsck) for independent
+// fstab entries on worker threads ahead of the serial mount loop, so that the fsck of one
+// partition overlaps the fsck and mount of the others instead of serializing in fstab order.
+//
+// Only entries whose block device is already final are eligible: anything that the mount loop
+// rewrites before mounting (LABEL= translation, logical partitions, AVB/verity hashtrees,
+// checkpointed devices) is left for the loop to prepare inline.  Workers operate on copies of
+// the entries taken before the loop starts mutating the fstab, and each result is keyed by the
+// block device and consumed at most once, so a reformatted or rewritten entry simply falls back
+// to an inline prepare_fs_for_mount().  Mounts themselves stay strictly in fstab order, which
+// also keeps nested mount points correct.
+class PrepareFsPrefetcher {
+  public:
+    PrepareFsPrefetcher(const Fstab& fstab, int mount_mode) {
+        std::set<std::string> devices;
+        std::string last_mount_point;
+        for (size_t i = 0; i < fstab.size(); i++) {
+            const auto& entry = fstab[i];
+            bool first_for_mount_point = entry.mount_point != last_mount_point;
+            last_mount_point = entry.mount_point;
+            // Alternative entries for a mount point share a device and are only attempted
+            // after the first fails, so prefetch just the first of each group.
+            if (!first_for_mount_point) continue;
+            if (!IsEligible(entry, mount_mode)) continue;
+            if (!devices.emplace(entry.blk_device).second) continue;
+            tasks_.emplace_back(Task{i, entry, 0, false});
+        }
+
+        size_t thread_count =
+                std::min<size_t>(tasks_.size(), std::thread::hardware_concurrency() ?: 4);
+        for (size_t i = 0; i < thread_count; i++) {
+            threads_.emplace_back(&PrepareFsPrefetcher::Work, this);
+        }
+    }
+
+    ~PrepareFsPrefetcher() {
+        {
+            std::lock_guard lock(lock_);
+            // Don't start fscks that nobody will wait for if the mount loop bailed out early.
+            next_task_ = tasks_.size();
+        }
+        for (auto& thread : threads_) {
+            thread.join();
+        }
+    }
+
+    // Returns the prefetched fs_stat for fstab[i], waiting for the worker if it is still
+    // running, or runs prepare_fs_for_mount() inline if the entry wasn't prefetched or its
+    // block device has changed since.  Each prefetched result is consumed at most once, so
+    // replays after a reformat re-run the check.
+    int GetFsStat(const Fstab& fstab, size_t i) {
+        std::unique_lock lock(lock_);
+        for (auto& task : tasks_) {
+            if (task.index != i || task.consumed ||
+                task.entry.blk_device != fstab[i].blk_device) {
+                continue;
+            }
+            task.consumed = true;
+            while (!task.done) {
+                cv_.wait(lock);
+            }
+            return task.fs_stat;
+        }
+        lock.unlock();
+        return prepare_fs_for_mount(fstab[i].blk_device, fstab[i]);
+    }
+
+  private:
+    struct Task {
+        size_t index;
+        FstabEntry entry;
+        int fs_stat;
+        bool done;
+        bool consumed = false;
+    };
+
+    static bool IsEligible(const FstabEntry& entry, int mount_mode) {
+        // Mirror the mount loop's skip conditions; a prefetch that the loop never consumes is
+        // wasted work at best and a surprise fsck at worst.
+        if (entry.fs_mgr_flags.first_stage_mount) return false;
+        if (entry.fs_mgr_flags.vold_managed || entry.fs_mgr_flags.recovery_only) return false;
+        if ((mount_mode == MOUNT_MODE_LATE) && !entry.fs_mgr_flags.late_mount) return false;
+        if ((mount_mode == MOUNT_MODE_EARLY) && entry.fs_mgr_flags.late_mount) return false;
+        if (entry.fs_type == "swap" || entry.fs_type == "emmc" || entry.fs_type == "mtd") {
+            return false;
+        }
+        if (entry.mount_point == "/" || entry.mount_point == "/system") return false;
+        if (mount_mode == MOUNT_MODE_ONLY_USERDATA && entry.mount_point != "/data") return false;
+        // The block device must be final: these are all rewritten before mounting.
+        if (StartsWith(entry.blk_device, "LABEL=")) return false;
+        if (entry.fs_mgr_flags.logical) return false;
+        if (entry.fs_mgr_flags.avb || !entry.avb_keys.empty() || entry.fs_mgr_flags.verify) {
+            return false;
+        }
+        if (entry.fs_mgr_flags.checkpoint_blk || entry.fs_mgr_flags.checkpoint_fs) return false;
+        return true;
+    }
+
+    void Work() {
+        while (true) {
+            Task* task;
+            {
+                std::lock_guard lock(lock_);
+                if (next_task_ == tasks_.size()) return;
+                task = &tasks_[next_task_++];
+            }
+            if (task->entry.fs_mgr_flags.wait && !WaitForFile(task->entry.blk_device, 20s)) {
+                // Leave fs_stat at 0; the mount loop logs and skips the entry itself.
+                LWARNING << "Block device " << task->entry.blk_device
+                         << " did not appear during fsck prefetch";
+            } else {
+                task->fs_stat = prepare_fs_for_mount(task->entry.blk_device, task->entry);
+            }
+            {
+                std::lock_guard lock(lock_);
+                task->done = true;
+            }
+            cv_.notify_all();
+        }
+    }
+
+    std::mutex lock_;
+    std::condition_variable cv_;
+    std::vector<Task> tasks_;
+    size_t next_task_ = 0;
+    std::vector<std::thread> threads_;
+};
+
 // Tries to mount any of the consecutive fstab entries that match
 // the mountpoint of the one given by fstab[start_idx].
 //
@@ -824,7 +956,7 @@ static bool fs_match(const std::string& in1, const std::string& in2) {
 //     succeeded. In case of failure, it will be the start_idx.
 // Sets errno to match the 1st mount failure on failure.
 static bool mount_with_alternatives(const Fstab& fstab, int start_idx, int* end_idx,
-                                    int* attempted_idx) {
+                                    int* attempted_idx, PrepareFsPrefetcher* prefetcher) {
     unsigned long i;
     int mount_errno = 0;
     bool mounted = false;
@@ -843,7 +975,7 @@ static bool mount_with_alternatives(const Fstab& fstab, int start_idx, int* end_
             continue;
         }
 
-        int fs_stat = prepare_fs_for_mount(fstab[i].blk_device, fstab[i]);
+        int fs_stat = prefetcher->GetFsStat(fstab, i);
         if (fs_stat & FS_STAT_INVALID_MAGIC) {
             LERROR << __FUNCTION__
                    << "(): skipping mount due to invalid magic, mountpoint=" << fstab[i].mount_point
@@ -1327,6 +1459,9 @@ MountAllResult fs_mgr_mount_all(Fstab* fstab, int mount_mode) {
         return {FS_MGR_MNTALL_FAIL, userdata_mounted};
     }
 
+    // Start fscks of independent entries while the loop below works through the fstab in order.
+    PrepareFsPrefetcher prefetcher(*fstab, mount_mode);
+
     // Keep i int to prevent unsigned integer overflow from (i = top_idx - 1),
     // where top_idx is 0. It will give SIGABRT
     for (int i = 0; i < static_cast<int>(fstab->size()); i++) {
@@ -1432,7 +1567,8 @@ MountAllResult fs_mgr_mount_all(Fstab* fstab, int mount_mode) {
         int top_idx = i;
         int attempted_idx = -1;
 
-        bool mret = mount_with_alternatives(*fstab, i, &last_idx_inspected, &attempted_idx);
+        bool mret =
+                mount_with_alternatives(*fstab, i, &last_idx_inspected, &attempted_idx, &prefetcher);
         auto& attempted_entry = (*fstab)[attempted_idx];
         i = last_idx_inspected;
         int mount_errno = errno;
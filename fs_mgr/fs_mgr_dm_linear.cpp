@@ -31,6 +31,7 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <map>
 #include <sstream>
 
 #include <android-base/file.h>
@@ -93,6 +94,9 @@ bool CreateDmTableInternal(const CreateLogicalPartitionParams& params, DmTable*
     const auto& super_device = params.block_device;
 
     uint64_t sector = 0;
+    // Extents usually share a backing device, so resolve each source (which
+    // takes a realpath call) only once per table.
+    std::map<uint32_t, std::string> dev_strings;
     for (size_t i = 0; i < params.partition->num_extents; i++) {
         const auto& extent = params.metadata->extents[params.partition->first_extent_index + i];
         std::unique_ptr<DmTarget> target;
@@ -101,14 +105,19 @@ bool CreateDmTableInternal(const CreateLogicalPartitionParams& params, DmTable*
                 target = std::make_unique<DmTargetZero>(sector, extent.num_sectors);
                 break;
             case LP_TARGET_TYPE_LINEAR: {
-                const auto& block_device = params.metadata->block_devices[extent.target_source];
-                std::string dev_string;
-                if (!GetPhysicalPartitionDevicePath(params, block_device, super_device,
-                                                    &dev_string)) {
-                    LOG(ERROR) << "Unable to complete device-mapper table, unknown block device";
-                    return false;
+                auto iter = dev_strings.find(extent.target_source);
+                if (iter == dev_strings.end()) {
+                    const auto& block_device = params.metadata->block_devices[extent.target_source];
+                    std::string dev_string;
+                    if (!GetPhysicalPartitionDevicePath(params, block_device, super_device,
+                                                        &dev_string)) {
+                        LOG(ERROR)
+                                << "Unable to complete device-mapper table, unknown block device";
+                        return false;
+                    }
+                    iter = dev_strings.emplace(extent.target_source, std::move(dev_string)).first;
                 }
-                target = std::make_unique<DmTargetLinear>(sector, extent.num_sectors, dev_string,
+                target = std::make_unique<DmTargetLinear>(sector, extent.num_sectors, iter->second,
                                                           extent.target_data);
                 break;
             }
@@ -156,6 +165,8 @@ bool CreateLogicalPartitions(const LpMetadata& metadata, const std::string& supe
             .block_device = super_device,
             .metadata = &metadata,
     };
+
+    std::vector<const LpMetadataPartition*> partitions;
     for (const auto& partition : metadata.partitions) {
         if (!partition.num_extents) {
             LINFO << "Skipping zero-length logical partition: " << GetPartitionName(partition);
@@ -165,14 +176,33 @@ bool CreateLogicalPartitions(const LpMetadata& metadata, const std::string& supe
             LINFO << "Skipping disabled partition: " << GetPartitionName(partition);
             continue;
         }
+        partitions.emplace_back(&partition);
+    }
 
-        params.partition = &partition;
-
-        std::string ignore_path;
-        if (!CreateLogicalPartition(params, &ignore_path)) {
-            LERROR << "Could not create logical partition: " << GetPartitionName(partition);
+    // Build all of the tables up front and create the devices as one batch, so
+    // the uevents for the earlier partitions are handled while the remaining
+    // tables are loaded, instead of serializing ioctls and uevent waits per
+    // device.
+    std::vector<DmTable> tables(partitions.size());
+    std::vector<DeviceMapper::CreateDeviceRequest> requests;
+    for (size_t i = 0; i < partitions.size(); i++) {
+        params.partition = partitions[i];
+        if (!CreateDmTable(params, &tables[i])) {
+            LERROR << "Could not build dm table for logical partition: "
+                   << GetPartitionName(*partitions[i]);
             return false;
         }
+        requests.emplace_back(DeviceMapper::CreateDeviceRequest{
+                GetPartitionName(*partitions[i]), &tables[i], {}});
+    }
+
+    DeviceMapper& dm = DeviceMapper::Instance();
+    if (!dm.CreateDevices(&requests, params.timeout_ms)) {
+        LERROR << "Could not create logical partitions on " << super_device;
+        return false;
+    }
+    for (const auto& request : requests) {
+        LINFO << "Created logical partition " << request.name << " on device " << request.path;
     }
     return true;
 }
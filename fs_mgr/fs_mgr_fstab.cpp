@@ -17,10 +17,13 @@
 #include <ctype.h>
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/mount.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include <algorithm>
@@ -33,6 +36,7 @@
 #include <android-base/properties.h>
 #include <android-base/stringprintf.h>
 #include <android-base/strings.h>
+#include <android-base/unique_fd.h>
 #include <libgsi/libgsi.h>
 
 #include "fs_mgr_priv.h"
@@ -731,6 +735,8 @@ bool ReadFstabFromDt(Fstab* fstab, bool log) {
     return true;
 }
 
+constexpr const char kSkipMountConfig[] = "/system/system_ext/etc/init/config/skip_mount.cfg";
+
 #ifndef NO_SKIP_MOUNT
 // For GSI to skip mounting /product and /system_ext, until there are well-defined interfaces
 // between them and /system. Otherwise, the GSI flashed on /system might not be able to work with
@@ -739,8 +745,6 @@ bool ReadFstabFromDt(Fstab* fstab, bool log) {
 // /system/system_ext because GSI is a single system.img that includes the contents of system_ext
 // partition and product partition under /system/system_ext and /system/product, respectively.
 bool SkipMountingPartitions(Fstab* fstab) {
-    constexpr const char kSkipMountConfig[] = "/system/system_ext/etc/init/config/skip_mount.cfg";
-
     std::string skip_config;
     auto save_errno = errno;
     if (!ReadFileToString(kSkipMountConfig, &skip_config)) {
@@ -765,8 +769,228 @@ bool SkipMountingPartitions(Fstab* fstab) {
 }
 #endif
 
+// A serialized copy of the parsed default fstab, so that the many processes that link libfs_mgr
+// don't each re-read and re-tokenize the fstab file and the device tree overlays.  The cache lives
+// on the /dev tmpfs and so never survives a reboot, but the environment that shapes the parse does
+// change within one boot (first stage init has neither properties nor /system), so the header
+// records that environment and a mismatch falls back to a full parse.
+
+constexpr char kFstabCacheMagic[4] = {'F', 'S', 'T', 'B'};
+constexpr uint32_t kFstabCacheVersion = 1;
+constexpr char kDefaultFstabCachePath[] = "/dev/.default_fstab_cache";
+
+struct FstabCacheString {
+    uint32_t offset;
+    uint32_t size;
+};
+
+struct FstabCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t string_table_size;
+    // The environment fingerprint, see RecordFstabCacheEnvironment().
+    uint32_t first_api_level;
+    uint8_t in_recovery;
+    uint8_t gsi_booted;
+    uint8_t skip_mount_config_present;
+    uint8_t reserved;
+};
+
+// A fixed-size image of FstabEntry; the strings index into a table that follows the entry array.
+struct FstabCacheEntry {
+    uint64_t flags;
+    int64_t length;
+    int64_t zram_size;
+    int64_t reserved_size;
+    int64_t erase_blk_size;
+    int64_t logical_blk_size;
+    uint64_t zram_backingdev_size;
+    int32_t partnum;
+    int32_t swap_prio;
+    int32_t max_comp_streams;
+    uint32_t fs_mgr_flags;
+    FstabCacheString strings[14];
+};
+
+static_assert(sizeof(FstabEntry::FsMgrFlags) == sizeof(uint32_t));
+
+// Applies f to the string members of an FstabEntry, in a fixed order that the writer and the
+// reader of the cache agree on.
+template <typename Entry, typename F>
+void ForEachFstabEntryString(Entry& entry, F f) {
+    f(entry.blk_device);
+    f(entry.logical_partition_name);
+    f(entry.mount_point);
+    f(entry.fs_type);
+    f(entry.fs_options);
+    f(entry.fs_checkpoint_opts);
+    f(entry.key_loc);
+    f(entry.metadata_key_dir);
+    f(entry.metadata_encryption);
+    f(entry.label);
+    f(entry.encryption_options);
+    f(entry.sysfs_path);
+    f(entry.vbmeta_partition);
+    f(entry.avb_keys);
+}
+
+// Records the inputs beyond the fstab file itself that shape the parsed result, so that a cache
+// written by first stage init (no properties, no /system, no GSI indicator) isn't served to the
+// post-mount consumers, and vice versa.
+static void RecordFstabCacheEnvironment(FstabCacheHeader* header) {
+    header->first_api_level = android::base::GetIntProperty("ro.product.first_api_level", 0);
+    header->in_recovery = access("/system/bin/recovery", F_OK) == 0;
+    header->gsi_booted = access(gsi::kGsiBootedIndicatorFile, F_OK) == 0;
+    header->skip_mount_config_present = access(kSkipMountConfig, F_OK) == 0;
+}
+
+bool WriteFstabToCache(const Fstab& fstab, const std::string& path) {
+    std::string string_table;
+    std::vector<FstabCacheEntry> entries;
+    entries.reserve(fstab.size());
+    for (const auto& entry : fstab) {
+        FstabCacheEntry cache_entry = {};
+        cache_entry.flags = entry.flags;
+        cache_entry.length = entry.length;
+        cache_entry.zram_size = entry.zram_size;
+        cache_entry.reserved_size = entry.reserved_size;
+        cache_entry.erase_blk_size = entry.erase_blk_size;
+        cache_entry.logical_blk_size = entry.logical_blk_size;
+        cache_entry.zram_backingdev_size = entry.zram_backingdev_size;
+        cache_entry.partnum = entry.partnum;
+        cache_entry.swap_prio = entry.swap_prio;
+        cache_entry.max_comp_streams = entry.max_comp_streams;
+        memcpy(&cache_entry.fs_mgr_flags, &entry.fs_mgr_flags, sizeof(cache_entry.fs_mgr_flags));
+
+        size_t i = 0;
+        ForEachFstabEntryString(entry, [&](const std::string& s) {
+            cache_entry.strings[i].offset = string_table.size();
+            cache_entry.strings[i].size = s.size();
+            string_table += s;
+            ++i;
+        });
+        entries.emplace_back(cache_entry);
+    }
+
+    FstabCacheHeader header = {};
+    memcpy(header.magic, kFstabCacheMagic, sizeof(header.magic));
+    header.version = kFstabCacheVersion;
+    header.entry_count = fstab.size();
+    header.string_table_size = string_table.size();
+    RecordFstabCacheEnvironment(&header);
+
+    std::string blob;
+    blob.reserve(sizeof(header) + entries.size() * sizeof(FstabCacheEntry) + string_table.size());
+    blob.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    blob.append(reinterpret_cast<const char*>(entries.data()),
+                entries.size() * sizeof(FstabCacheEntry));
+    blob += string_table;
+
+    // Write to a temporary file and rename it into place so that concurrent readers never see a
+    // partially written cache.
+    std::string tmp_path = path + "." + std::to_string(getpid());
+    if (!android::base::WriteStringToFile(blob, tmp_path)) {
+        return false;
+    }
+    if (rename(tmp_path.c_str(), path.c_str()) != 0) {
+        unlink(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+static bool ParseFstabCache(const char* data, size_t size, Fstab* fstab) {
+    FstabCacheHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, kFstabCacheMagic, sizeof(header.magic)) != 0 ||
+        header.version != kFstabCacheVersion) {
+        return false;
+    }
+
+    FstabCacheHeader current = header;
+    RecordFstabCacheEnvironment(&current);
+    if (memcmp(&current, &header, sizeof(header)) != 0) {
+        // The cache was written under a different environment, e.g. by first stage init.
+        return false;
+    }
+
+    if (header.entry_count > (size - sizeof(header)) / sizeof(FstabCacheEntry)) {
+        return false;
+    }
+    size_t entries_size = header.entry_count * sizeof(FstabCacheEntry);
+    if (size != sizeof(header) + entries_size + header.string_table_size) {
+        return false;
+    }
+    const char* string_table = data + sizeof(header) + entries_size;
+
+    Fstab result;
+    result.reserve(header.entry_count);
+    for (uint32_t i = 0; i < header.entry_count; i++) {
+        FstabCacheEntry cache_entry;
+        memcpy(&cache_entry, data + sizeof(header) + i * sizeof(FstabCacheEntry),
+               sizeof(cache_entry));
+
+        FstabEntry entry;
+        entry.flags = cache_entry.flags;
+        entry.length = cache_entry.length;
+        entry.zram_size = cache_entry.zram_size;
+        entry.reserved_size = cache_entry.reserved_size;
+        entry.erase_blk_size = cache_entry.erase_blk_size;
+        entry.logical_blk_size = cache_entry.logical_blk_size;
+        entry.zram_backingdev_size = cache_entry.zram_backingdev_size;
+        entry.partnum = cache_entry.partnum;
+        entry.swap_prio = cache_entry.swap_prio;
+        entry.max_comp_streams = cache_entry.max_comp_streams;
+        memcpy(&entry.fs_mgr_flags, &cache_entry.fs_mgr_flags, sizeof(entry.fs_mgr_flags));
+
+        size_t string_index = 0;
+        bool valid = true;
+        ForEachFstabEntryString(entry, [&](std::string& s) {
+            const auto& ref = cache_entry.strings[string_index++];
+            if (ref.offset > header.string_table_size ||
+                ref.size > header.string_table_size - ref.offset) {
+                valid = false;
+                return;
+            }
+            // The strings are sized up front from the mapped region, which is the allocation
+            // the full parse spends most of its time avoiding to produce.
+            s.assign(string_table + ref.offset, ref.size);
+        });
+        if (!valid) {
+            return false;
+        }
+        result.emplace_back(std::move(entry));
+    }
+
+    *fstab = std::move(result);
+    return true;
+}
+
+bool ReadFstabFromCache(const std::string& path, Fstab* fstab) {
+    android::base::unique_fd fd(open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW));
+    if (fd < 0) {
+        return false;
+    }
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || static_cast<size_t>(sb.st_size) < sizeof(FstabCacheHeader)) {
+        return false;
+    }
+    size_t size = sb.st_size;
+    void* map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+    bool ok = ParseFstabCache(static_cast<const char*>(map), size, fstab);
+    munmap(map, size);
+    return ok;
+}
+
 // Loads the fstab file and combines with fstab entries passed in from device tree.
 bool ReadDefaultFstab(Fstab* fstab) {
+    if (ReadFstabFromCache(kDefaultFstabCachePath, fstab)) {
+        return true;
+    }
     Fstab dt_fstab;
     ReadFstabFromDt(&dt_fstab, false);
 
@@ -791,6 +1015,11 @@ bool ReadDefaultFstab(Fstab* fstab) {
         fstab->emplace_back(std::move(entry));
     }
 
+    if (!fstab->empty()) {
+        // Best effort: consumers without the privilege to write /dev just pay the parse.
+        WriteFstabToCache(*fstab, kDefaultFstabCachePath);
+    }
+
     return !fstab->empty();
 }
 
@@ -39,6 +39,7 @@
 #include <android-base/file.h>
 #include <android-base/macros.h>
 #include <android-base/properties.h>
+#include <android-base/stringprintf.h>
 #include <android-base/strings.h>
 #include <android-base/unique_fd.h>
 #include <ext4_utils/ext4_utils.h>
@@ -448,6 +449,72 @@ bool fs_mgr_overlayfs_has_logical(const Fstab& fstab) {
     return false;
 }
 
+// Cache of the last validated scratch backing, so that repeat remounts do
+// not re-probe physical candidates, ImageManager and super metadata on every
+// invocation.  The lp metadata tables checksum doubles as a generation
+// number: any change to the super partition table invalidates the cache.
+constexpr char kScratchStateCacheDir[] = "/metadata/gsi/remount";
+constexpr char kScratchStateCacheFile[] = "/metadata/gsi/remount/scratch_state";
+
+struct ScratchState {
+    std::string generation;
+    std::string backing;  // "physical", "super" or "data"
+    std::string device;
+};
+
+std::string GetSuperMetadataGeneration() {
+    auto slot_number = fs_mgr_overlayfs_slot_number();
+    auto super_device = fs_mgr_overlayfs_super_device(slot_number);
+    auto metadata = ReadMetadata(super_device, slot_number);
+    if (!metadata) return "";
+
+    std::string generation;
+    for (auto byte : metadata->header.tables_checksum) {
+        generation += android::base::StringPrintf("%02x", byte);
+    }
+    return generation;
+}
+
+void RemoveScratchStateCache() {
+    auto save_errno = errno;
+    unlink(kScratchStateCacheFile);
+    errno = save_errno;
+}
+
+bool LoadScratchStateCache(ScratchState* state) {
+    std::string content;
+    auto save_errno = errno;
+    if (!android::base::ReadFileToString(kScratchStateCacheFile, &content)) {
+        errno = save_errno;
+        return false;
+    }
+    auto fields = android::base::Split(android::base::Trim(content), " ");
+    if (fields.size() != 3) {
+        RemoveScratchStateCache();
+        return false;
+    }
+    state->generation = fields[0];
+    state->backing = fields[1];
+    state->device = fields[2];
+    return true;
+}
+
+// Best effort; /metadata may not be available (e.g. in recovery), in which
+// case the next invocation simply probes again.
+void SaveScratchStateCache(const std::string& backing, const std::string& device) {
+    if (device.empty()) return;
+    auto save_errno = errno;
+    mkdir("/metadata/gsi", 0700);
+    mkdir(kScratchStateCacheDir, 0700);
+    auto generation = GetSuperMetadataGeneration();
+    if (generation.empty()) generation = "none";  // e.g. no super partition
+    auto content = generation + " " + backing + " " + device + "\n";
+    if (!android::base::WriteStringToFile(content, kScratchStateCacheFile)) {
+        RemoveScratchStateCache();
+    }
+    errno = save_errno;
+}
+
 void fs_mgr_overlayfs_umount_scratch() {
     // Lazy umount will allow us to move on and possibly later
     // establish a new fresh mount without requiring a reboot should
@@ -469,6 +536,9 @@ bool fs_mgr_overlayfs_teardown_scratch(const std::string& overlay, bool* change)
         fs_mgr_overlayfs_umount_scratch();
     }
 
+    // The backing is going away, so any cached discovery state is stale.
+    RemoveScratchStateCache();
+
     const auto partition_name = android::base::Basename(kScratchMountPoint);
 
     auto images = IImageManager::Open("remount", 10s);
@@ -1106,12 +1176,66 @@ static bool CanUseSuperPartition(const Fstab& fstab, bool* is_virtual_ab) {
     return true;
 }
 
+// Fast path for fs_mgr_overlayfs_create_scratch(): reuse the backing a
+// previous invocation discovered and validated, without re-probing.
+static bool UseCachedScratch(std::string* scratch_device, bool* partition_exists) {
+    ScratchState state;
+    if (!LoadScratchStateCache(&state)) return false;
+
+    if (state.backing == "physical") {
+        if (!fs_mgr_rw_access(state.device)) return false;
+        *scratch_device = state.device;
+        *partition_exists = true;
+        return true;
+    }
+
+    // If the device is already mapped, its table was built from the current
+    // super metadata (or backing image), so there is nothing left to probe.
+    auto partition_name = android::base::Basename(kScratchMountPoint);
+    auto& dm = DeviceMapper::Instance();
+    if (dm.GetState(partition_name) != DmDeviceState::INVALID &&
+        dm.GetDmDevicePathByName(partition_name, scratch_device)) {
+        *partition_exists = true;
+        return true;
+    }
+
+    if (state.backing != "super") {
+        return false;
+    }
+
+    // Not mapped yet (e.g. the first remount after a reboot).  If the super
+    // partition table has not changed since the scratch partition was created
+    // and sized, map it directly and skip the allocation logic.
+    if (state.generation.empty() || state.generation != GetSuperMetadataGeneration()) {
+        RemoveScratchStateCache();
+        return false;
+    }
+    auto slot_number = fs_mgr_overlayfs_slot_number();
+    CreateLogicalPartitionParams params = {
+            .block_device = fs_mgr_overlayfs_super_device(slot_number),
+            .metadata_slot = slot_number,
+            .partition_name = partition_name,
+            .force_writable = true,
+            .timeout_ms = 10s,
+    };
+    if (!CreateLogicalPartition(params, scratch_device)) {
+        return false;
+    }
+    *partition_exists = true;
+    return true;
+}
+
 bool fs_mgr_overlayfs_create_scratch(const Fstab& fstab, std::string* scratch_device,
                                      bool* partition_exists, bool* change) {
+    if (UseCachedScratch(scratch_device, partition_exists)) {
+        return true;
+    }
+
     // Try a physical partition first.
     *scratch_device = GetPhysicalScratchDevice();
     if (!scratch_device->empty() && fs_mgr_rw_access(*scratch_device)) {
         *partition_exists = true;
+        SaveScratchStateCache("physical", *scratch_device);
         return true;
     }
 
@@ -1120,9 +1244,13 @@ bool fs_mgr_overlayfs_create_scratch(const Fstab& fstab, std::string* scratch_de
     if (CanUseSuperPartition(fstab, &is_virtual_ab)) {
         bool can_use_data = false;
         if (is_virtual_ab && FilesystemHasReliablePinning("/data", &can_use_data) && can_use_data) {
-            return CreateScratchOnData(scratch_device, partition_exists, change);
+            auto ok = CreateScratchOnData(scratch_device, partition_exists, change);
+            if (ok) SaveScratchStateCache("data", *scratch_device);
+            return ok;
         }
-        return CreateDynamicScratch(scratch_device, partition_exists, change);
+        auto ok = CreateDynamicScratch(scratch_device, partition_exists, change);
+        if (ok) SaveScratchStateCache("super", *scratch_device);
+        return ok;
     }
 
     errno = ENXIO;
@@ -15,7 +15,11 @@
 #pragma once
 
 #include <chrono>
+#include <map>
 #include <string>
+#include <vector>
+
+#include <android-base/unique_fd.h>
 
 namespace android {
 namespace fs_mgr {
@@ -25,10 +29,37 @@ namespace fs_mgr {
 // be a valid directory.
 bool WaitForFile(const std::string& path, const std::chrono::milliseconds relative_timeout);
 
+// Wait at most |relative_timeout| milliseconds for every path in |paths| to
+// exist, sharing one inotify instance and one poll loop. Paths may appear in
+// any order. Returns true only if all paths exist before the timeout.
+bool WaitForFiles(const std::vector<std::string>& paths,
+                  const std::chrono::milliseconds relative_timeout);
+
 // Wait at most |relative_timeout| milliseconds for |path| to stop existing.
 // Note that this only returns true if the inode itself no longer exists, i.e.,
 // all outstanding file descriptors have been closed.
 bool WaitForFileDeleted(const std::string& path, const std::chrono::milliseconds relative_timeout);
 
+// Persistent variant of WaitForFiles() for callers that repeatedly wait on
+// files appearing under the same set of directories (for example, dm-N nodes
+// under /dev/block). The inotify instance and its directory watches are kept
+// across calls, avoiding per-wait setup and teardown. Falls back to polling
+// if inotify is unavailable. Not thread-safe.
+class FileWaiter final {
+  public:
+    bool WaitForFile(const std::string& path, const std::chrono::milliseconds relative_timeout);
+    bool WaitForFiles(const std::vector<std::string>& paths,
+                      const std::chrono::milliseconds relative_timeout);
+
+  private:
+#if defined(__linux__)
+    bool EnsureWatches(const std::vector<std::string>& paths);
+    bool DrainEvents();
+
+    android::base::unique_fd inotify_fd_;
+    std::map<std::string, int> watched_dirs_;
+#endif
+};
+
 }  // namespace fs_mgr
 }  // namespace android
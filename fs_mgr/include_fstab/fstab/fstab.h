@@ -101,6 +101,11 @@ bool ReadFstabFromDt(Fstab* fstab, bool log = true);
 bool ReadDefaultFstab(Fstab* fstab);
 bool SkipMountingPartitions(Fstab* fstab);
 
+// Serialized parsed-fstab cache.  ReadDefaultFstab() maintains a per-boot cache on the /dev tmpfs
+// transparently; these are exposed for testing and for callers that manage their own cache files.
+bool WriteFstabToCache(const Fstab& fstab, const std::string& path);
+bool ReadFstabFromCache(const std::string& path, Fstab* fstab);
+
 FstabEntry* GetEntryForMountPoint(Fstab* fstab, const std::string& path);
 // The Fstab can contain multiple entries for the same mount point with different configurations.
 std::vector<FstabEntry*> GetEntriesForMountPoint(Fstab* fstab, const std::string& path);
@@ -145,6 +145,21 @@ static bool IsRecovery() {
     return access("/system/bin/recovery", F_OK) == 0;
 }
 
+// Pre-Q ueventd on non-A/B recoveries doesn't create the by-uuid symlinks, so
+// device readiness must be tested on the dm-N path instead.
+static bool UseLegacyDevicePathForWait() {
+    if (!IsRecovery()) {
+        return false;
+    }
+    bool non_ab_device = android::base::GetProperty("ro.build.ab_update", "").empty();
+    int sdk = android::base::GetIntProperty("ro.build.version.sdk", 0);
+    if (non_ab_device && sdk && sdk <= 29) {
+        LOG(INFO) << "Detected ueventd incompatibility, reverting to legacy libdm behavior.";
+        return true;
+    }
+    return false;
+}
+
 bool DeviceMapper::CreateDevice(const std::string& name, const DmTable& table, std::string* path,
                                 const std::chrono::milliseconds& timeout_ms) {
     std::string uuid = GenerateUuid();
@@ -166,16 +181,11 @@ bool DeviceMapper::CreateDevice(const std::string& name, const DmTable& table, s
         return true;
     }
 
-    if (IsRecovery()) {
-        bool non_ab_device = android::base::GetProperty("ro.build.ab_update", "").empty();
-        int sdk = android::base::GetIntProperty("ro.build.version.sdk", 0);
-        if (non_ab_device && sdk && sdk <= 29) {
-            LOG(INFO) << "Detected ueventd incompatibility, reverting to legacy libdm behavior.";
-            unique_path = *path;
-        }
+    if (UseLegacyDevicePathForWait()) {
+        unique_path = *path;
     }
 
-    if (!WaitForFile(unique_path, timeout_ms)) {
+    if (!waiter_.WaitForFile(unique_path, timeout_ms)) {
         LOG(ERROR) << "Failed waiting for device path: " << unique_path;
         DeleteDevice(name);
         return false;
@@ -183,6 +193,57 @@ bool DeviceMapper::CreateDevice(const std::string& name, const DmTable& table, s
     return true;
 }
 
+bool DeviceMapper::CreateDevices(std::vector<CreateDeviceRequest>* requests,
+                                 const std::chrono::milliseconds& timeout_ms) {
+    auto delete_devices = [this, requests](size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            DeleteDevice((*requests)[i].name);
+        }
+    };
+
+    // Issue all of the creation and table ioctls first; the kernel emits the
+    // uevents as we go, so ueventd works through them while we load the
+    // remaining tables instead of being waited on one device at a time.
+    std::vector<std::string> unique_paths;
+    for (size_t i = 0; i < requests->size(); i++) {
+        auto& request = (*requests)[i];
+        if (!CreateDevice(request.name, GenerateUuid())) {
+            delete_devices(i);
+            return false;
+        }
+        std::string unique_path;
+        if (!LoadTableAndActivate(request.name, *request.table) ||
+            !GetDeviceUniquePath(request.name, &unique_path) ||
+            !GetDmDevicePathByName(request.name, &request.path)) {
+            delete_devices(i + 1);
+            return false;
+        }
+        unique_paths.emplace_back(std::move(unique_path));
+    }
+
+    if (timeout_ms <= std::chrono::milliseconds::zero()) {
+        return true;
+    }
+
+    // Wait on all of the paths at once; nodes complete in whatever order
+    // ueventd processes them.
+    std::vector<std::string> wait_paths;
+    if (UseLegacyDevicePathForWait()) {
+        for (const auto& request : *requests) {
+            wait_paths.emplace_back(request.path);
+        }
+    } else {
+        wait_paths = std::move(unique_paths);
+    }
+    if (!waiter_.WaitForFiles(wait_paths, timeout_ms)) {
+        LOG(ERROR) << "Failed waiting for device paths: "
+                   << android::base::Join(wait_paths, ", ");
+        delete_devices(requests->size());
+        return false;
+    }
+    return true;
+}
+
 bool DeviceMapper::GetDeviceUniquePath(const std::string& name, std::string* path) {
     struct dm_ioctl io;
     InitIo(&io, name);
@@ -124,6 +124,40 @@ TEST(libdm, DmLinear) {
     ASSERT_TRUE(dev.Destroy());
 }
 
+TEST(libdm, CreateDevicesBatch) {
+    unique_fd tmp1(CreateTempFile("file_batch_1", 4096));
+    ASSERT_GE(tmp1, 0);
+    unique_fd tmp2(CreateTempFile("file_batch_2", 4096));
+    ASSERT_GE(tmp2, 0);
+
+    LoopDevice loop_a(tmp1, 10s);
+    ASSERT_TRUE(loop_a.valid());
+    LoopDevice loop_b(tmp2, 10s);
+    ASSERT_TRUE(loop_b.valid());
+
+    DmTable table_a;
+    ASSERT_TRUE(table_a.Emplace<DmTargetLinear>(0, 1, loop_a.device(), 0));
+    ASSERT_TRUE(table_a.valid());
+    DmTable table_b;
+    ASSERT_TRUE(table_b.Emplace<DmTargetLinear>(0, 1, loop_b.device(), 0));
+    ASSERT_TRUE(table_b.valid());
+
+    std::vector<DeviceMapper::CreateDeviceRequest> requests = {
+            {"libdm-test-batch-a", &table_a, {}},
+            {"libdm-test-batch-b", &table_b, {}},
+    };
+
+    auto& dm = DeviceMapper::Instance();
+    ASSERT_TRUE(dm.CreateDevices(&requests, 5s));
+    for (const auto& request : requests) {
+        EXPECT_FALSE(request.path.empty());
+        EXPECT_EQ(access(request.path.c_str(), F_OK), 0);
+    }
+    for (const auto& request : requests) {
+        EXPECT_TRUE(dm.DeleteDevice(request.name));
+    }
+}
+
 TEST(libdm, DmSuspendResume) {
     unique_fd tmp1(CreateTempFile("file_suspend_resume", 512));
     ASSERT_GE(tmp1, 0);
@@ -32,6 +32,8 @@
 #include <utility>
 #include <vector>
 
+#include <fs_mgr/file_wait.h>
+
 #include "dm_table.h"
 
 // The minimum expected device mapper major.minor version
@@ -140,6 +142,24 @@ class DeviceMapper final {
     // use the timeout variant above.
     bool CreateDevice(const std::string& name, const DmTable& table);
 
+    // One device in a CreateDevices() batch. |name| and |table| are inputs; on
+    // success |path| contains the result of GetDmDevicePathByName(), as with
+    // CreateDevice().
+    struct CreateDeviceRequest {
+        std::string name;
+        const DmTable* table = nullptr;
+        std::string path;
+    };
+
+    // Batch variant of CreateDevice(). Every requested device is created and
+    // its table loaded and activated before any waiting happens, so the
+    // uevent handling for one device overlaps the ioctls for the rest.
+    // |timeout_ms| is a single deadline for the whole batch, with the same
+    // semantics (including 0ms) as in CreateDevice(). On failure, every
+    // device in |requests| that had been created is deleted.
+    bool CreateDevices(std::vector<CreateDeviceRequest>* requests,
+                       const std::chrono::milliseconds& timeout_ms);
+
     // Loads the device mapper table from parameter into the underlying device
     // mapper device with given name and activate / resumes the device in the
     // process. A device with the given name must already exist.
@@ -255,6 +275,9 @@ class DeviceMapper final {
     DeviceMapper();
 
     int fd_;
+    // Kept across device creations so the inotify instance and its directory
+    // watches (e.g. on /dev/block/mapper/by-uuid) are set up only once.
+    android::fs_mgr::FileWaiter waiter_;
     // Non-copyable & Non-movable
     DeviceMapper(const DeviceMapper&) = delete;
     DeviceMapper& operator=(const DeviceMapper&) = delete;
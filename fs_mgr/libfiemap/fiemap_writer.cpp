@@ -20,6 +20,7 @@
 #include <fcntl.h>
 #include <linux/fs.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <sys/sysmacros.h>
@@ -57,9 +58,34 @@ static constexpr const uint32_t kUnsupportedExtentFlags =
 // Large file support must be enabled.
 static_assert(sizeof(off_t) == sizeof(uint64_t));
 
+// A validated extent map is cached in a sidecar file next to the image, so
+// that re-opening the image on a later boot does not force a filesystem-wide
+// sync through FIEMAP_FLAG_SYNC. The cache is keyed on the inode number, the
+// mtime and the inode generation of the image file, and is discarded if any
+// of them changed.
+static constexpr uint32_t kExtentCacheMagic = 0x66696d63;  // 'fimc'
+static constexpr uint32_t kExtentCacheVersion = 1;
+
+struct ExtentCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t ino;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint64_t generation;
+    uint64_t file_size;
+    uint32_t fs_type;
+    uint32_t num_extents;
+};
+
+static std::string ExtentCachePath(const std::string& file_path) {
+    return file_path + ".extents";
+}
+
 static inline void cleanup(const std::string& file_path, bool created) {
     if (created) {
         unlink(file_path.c_str());
+        FiemapWriter::RemoveExtentCache(file_path);
     }
 }
 
@@ -498,11 +524,103 @@ bool FiemapWriter::HasPinnedExtents(const std::string& file_path) {
     return IsFilePinned(fd, file_path, sfs.f_type);
 }
 
-static bool CountFiemapExtents(int file_fd, const std::string& file_path, uint32_t* num_extents) {
+static bool GetFileGeneration(int file_fd, uint64_t* generation) {
+    int version = 0;
+    if (ioctl(file_fd, FS_IOC_GETVERSION, &version) < 0) {
+        // Not supported by all filesystems (eg vfat); key the cache on the
+        // inode number and mtime only.
+        *generation = 0;
+        return errno == ENOTTY || errno == ENOTSUP;
+    }
+    *generation = static_cast<uint32_t>(version);
+    return true;
+}
+
+static bool LoadExtentCache(int file_fd, const std::string& file_path,
+                            std::vector<struct fiemap_extent>* extents) {
+    struct stat s;
+    if (fstat(file_fd, &s)) {
+        PLOG(ERROR) << "Failed to stat " << file_path;
+        return false;
+    }
+    uint64_t generation;
+    if (!GetFileGeneration(file_fd, &generation)) {
+        return false;
+    }
+
+    std::string contents;
+    if (!android::base::ReadFileToString(ExtentCachePath(file_path), &contents)) {
+        return false;
+    }
+    if (contents.size() < sizeof(ExtentCacheHeader)) {
+        return false;
+    }
+
+    ExtentCacheHeader header;
+    memcpy(&header, contents.data(), sizeof(header));
+    if (header.magic != kExtentCacheMagic || header.version != kExtentCacheVersion) {
+        return false;
+    }
+    if (header.ino != s.st_ino || header.mtime_sec != s.st_mtim.tv_sec ||
+        header.mtime_nsec != s.st_mtim.tv_nsec || header.generation != generation ||
+        header.file_size != static_cast<uint64_t>(s.st_size)) {
+        LOG(VERBOSE) << "Extent cache is stale for file: " << file_path;
+        return false;
+    }
+    if (!header.num_extents || header.num_extents > kMaxExtents ||
+        contents.size() !=
+                sizeof(header) + header.num_extents * sizeof(struct fiemap_extent)) {
+        return false;
+    }
+
+    extents->resize(header.num_extents);
+    memcpy(extents->data(), contents.data() + sizeof(header), contents.size() - sizeof(header));
+    return true;
+}
+
+static void SaveExtentCache(int file_fd, const std::string& file_path,
+                            const std::vector<struct fiemap_extent>& extents, uint32_t fs_type) {
+    // Failing to write the cache only costs a re-query on the next open, so
+    // all errors here are non-fatal.
+    struct stat s;
+    if (fstat(file_fd, &s)) {
+        return;
+    }
+    uint64_t generation;
+    if (!GetFileGeneration(file_fd, &generation)) {
+        return;
+    }
+
+    ExtentCacheHeader header = {};
+    header.magic = kExtentCacheMagic;
+    header.version = kExtentCacheVersion;
+    header.ino = s.st_ino;
+    header.mtime_sec = s.st_mtim.tv_sec;
+    header.mtime_nsec = s.st_mtim.tv_nsec;
+    header.generation = generation;
+    header.file_size = s.st_size;
+    header.fs_type = fs_type;
+    header.num_extents = extents.size();
+
+    std::string contents(reinterpret_cast<const char*>(&header), sizeof(header));
+    contents.append(reinterpret_cast<const char*>(extents.data()),
+                    extents.size() * sizeof(struct fiemap_extent));
+    if (!android::base::WriteStringToFile(contents, ExtentCachePath(file_path))) {
+        PLOG(WARNING) << "Failed to write extent cache for file: " << file_path;
+        unlink(ExtentCachePath(file_path).c_str());
+    }
+}
+
+void FiemapWriter::RemoveExtentCache(const std::string& file_path) {
+    unlink(ExtentCachePath(file_path).c_str());
+}
+
+static bool CountFiemapExtents(int file_fd, const std::string& file_path, uint32_t* num_extents,
+                               bool sync_flag) {
     struct fiemap fiemap = {};
     fiemap.fm_start = 0;
     fiemap.fm_length = UINT64_MAX;
-    fiemap.fm_flags = FIEMAP_FLAG_SYNC;
+    fiemap.fm_flags = sync_flag ? FIEMAP_FLAG_SYNC : 0;
     fiemap.fm_extent_count = 0;
 
     if (ioctl(file_fd, FS_IOC_FIEMAP, &fiemap)) {
@@ -576,9 +694,9 @@ static bool FiemapToExtents(struct fiemap* fiemap, std::vector<struct fiemap_ext
 }
 
 static bool ReadFiemap(int file_fd, const std::string& file_path,
-                       std::vector<struct fiemap_extent>* extents) {
+                       std::vector<struct fiemap_extent>* extents, bool sync_flag) {
     uint32_t num_extents;
-    if (!CountFiemapExtents(file_fd, file_path, &num_extents)) {
+    if (!CountFiemapExtents(file_fd, file_path, &num_extents, sync_flag)) {
         return false;
     }
     if (num_extents == 0) {
@@ -601,8 +719,9 @@ static bool ReadFiemap(int file_fd, const std::string& file_path,
     struct fiemap* fiemap = reinterpret_cast<struct fiemap*>(buffer.get());
     fiemap->fm_start = 0;
     fiemap->fm_length = UINT64_MAX;
-    // make sure file is synced to disk before we read the fiemap
-    fiemap->fm_flags = FIEMAP_FLAG_SYNC;
+    // Sync the file to disk before reading the fiemap, unless the caller has
+    // already flushed it (eg right after allocation).
+    fiemap->fm_flags = sync_flag ? FIEMAP_FLAG_SYNC : 0;
     fiemap->fm_extent_count = num_extents;
 
     if (ioctl(file_fd, FS_IOC_FIEMAP, fiemap)) {
@@ -772,22 +891,33 @@ FiemapStatus FiemapWriter::Open(const std::string& file_path, uint64_t file_size
 
     // now allocate the FiemapWriter and start setting it up
     FiemapUniquePtr fmap(new FiemapWriter());
-    switch (fs_type) {
-        case EXT4_SUPER_MAGIC:
-        case F2FS_SUPER_MAGIC:
-            if (!ReadFiemap(file_fd, abs_path, &fmap->extents_)) {
-                LOG(ERROR) << "Failed to read fiemap of file: " << abs_path;
-                cleanup(abs_path, create);
-                return FiemapStatus::Error();
-            }
-            break;
-        case MSDOS_SUPER_MAGIC:
-            if (!ReadFibmap(file_fd, abs_path, &fmap->extents_)) {
-                LOG(ERROR) << "Failed to read fibmap of file: " << abs_path;
-                cleanup(abs_path, create);
-                return FiemapStatus::Error();
-            }
-            break;
+    // The cache can only be trusted if the blocks cannot have moved since it
+    // was written; on f2fs that is the case only for pinned, unmoved files.
+    if (!create && IsFilePinned(file_fd, abs_path, fs_type) &&
+        LoadExtentCache(file_fd, abs_path, &fmap->extents_)) {
+        LOG(VERBOSE) << "Using cached extent map for file: " << abs_path;
+    } else {
+        switch (fs_type) {
+            case EXT4_SUPER_MAGIC:
+            case F2FS_SUPER_MAGIC:
+                // When creating, AllocateFile() has just fsync()ed the file,
+                // so the extra filesystem sync from FIEMAP_FLAG_SYNC can be
+                // skipped for every piece of a split image.
+                if (!ReadFiemap(file_fd, abs_path, &fmap->extents_, !create)) {
+                    LOG(ERROR) << "Failed to read fiemap of file: " << abs_path;
+                    cleanup(abs_path, create);
+                    return FiemapStatus::Error();
+                }
+                break;
+            case MSDOS_SUPER_MAGIC:
+                if (!ReadFibmap(file_fd, abs_path, &fmap->extents_)) {
+                    LOG(ERROR) << "Failed to read fibmap of file: " << abs_path;
+                    cleanup(abs_path, create);
+                    return FiemapStatus::Error();
+                }
+                break;
+        }
+        SaveExtentCache(file_fd, abs_path, fmap->extents_, fs_type);
     }
 
     fmap->file_path_ = abs_path;
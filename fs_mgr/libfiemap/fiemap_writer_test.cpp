@@ -59,7 +59,10 @@ class FiemapWriterTest : public ::testing::Test {
         testfile = gTestDir + "/"s + tinfo->name();
     }
 
-    void TearDown() override { unlink(testfile.c_str()); }
+    void TearDown() override {
+        unlink(testfile.c_str());
+        FiemapWriter::RemoveExtentCache(testfile);
+    }
 
     // name of the file we use for testing
     std::string testfile;
@@ -188,6 +191,33 @@ TEST_F(FiemapWriterTest, ExistingFile) {
     }
 }
 
+TEST_F(FiemapWriterTest, ExtentCache) {
+    std::vector<struct fiemap_extent> fresh;
+    {
+        auto ptr = FiemapWriter::Open(testfile, 1024 * 1024);
+        ASSERT_NE(ptr, nullptr);
+        fresh = ptr->extents();
+    }
+    // The second open can be served from the extent cache; either way the
+    // extents must be identical to a fresh query.
+    {
+        auto ptr = FiemapWriter::Open(testfile, 0, false);
+        ASSERT_NE(ptr, nullptr);
+        ASSERT_EQ(ptr->extents().size(), fresh.size());
+        for (size_t i = 0; i < fresh.size(); i++) {
+            EXPECT_EQ(ptr->extents()[i].fe_physical, fresh[i].fe_physical);
+            EXPECT_EQ(ptr->extents()[i].fe_length, fresh[i].fe_length);
+        }
+    }
+    // Removing the cache must fall back to a fresh query.
+    FiemapWriter::RemoveExtentCache(testfile);
+    {
+        auto ptr = FiemapWriter::Open(testfile, 0, false);
+        ASSERT_NE(ptr, nullptr);
+        EXPECT_EQ(ptr->extents().size(), fresh.size());
+    }
+}
+
 TEST_F(FiemapWriterTest, FileDeletedOnError) {
     auto callback = [](uint64_t, uint64_t) -> bool { return false; };
     auto ptr = FiemapWriter::Open(testfile, gBlockSize, true, std::move(callback));
@@ -65,6 +65,10 @@ class FiemapWriter final {
     // FiemapWriter::Open).
     static bool HasPinnedExtents(const std::string& file_path);
 
+    // Remove the on-disk extent cache for |file_path|, if any. This should be
+    // called when deleting a file that was opened through FiemapWriter.
+    static void RemoveExtentCache(const std::string& file_path);
+
     // Returns the underlying block device of a file. This will look past device-mapper layers
     // as long as each layer would not change block mappings (i.e., dm-crypt, dm-bow, and dm-
     // default-key tables are okay; dm-linear is not). If a mapping such as dm-linear is found,
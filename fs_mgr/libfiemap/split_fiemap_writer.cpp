@@ -193,6 +193,7 @@ bool SplitFiemap::RemoveSplitFiles(const std::string& file_path, std::string* me
     if (GetSplitFileList(file_path, &files)) {
         for (const auto& file : files) {
             ok &= android::base::RemoveFileIfExists(file, message);
+            FiemapWriter::RemoveExtentCache(file);
         }
     }
     ok &= android::base::RemoveFileIfExists(file_path, message);
@@ -300,6 +301,7 @@ SplitFiemap::~SplitFiemap() {
         file = nullptr;
 
         unlink(path.c_str());
+        FiemapWriter::RemoveExtentCache(path);
     }
 }
 
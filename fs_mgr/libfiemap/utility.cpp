@@ -70,6 +70,7 @@ FiemapStatus DetermineMaximumFileSize(const std::string& file_path, uint64_t* re
     // Close and delete the temporary file.
     writer = nullptr;
     unlink(file_path.c_str());
+    FiemapWriter::RemoveExtentCache(file_path);
 
     return FiemapStatus::Ok();
 }
@@ -52,6 +52,15 @@ namespace fs_mgr {
 template <typename Hasher>
 std::pair<size_t, bool> VerifyVbmetaDigest(const std::vector<VBMetaData>& vbmeta_images,
                                            const uint8_t* expected_digest) {
+    // Fast path: with no chained vbmeta there is only one image to digest.
+    if (vbmeta_images.size() == 1) {
+        const auto& vbmeta = vbmeta_images[0];
+        uint8_t digest[Hasher::DIGEST_SIZE];
+        Hasher::digest(vbmeta.data(), vbmeta.size(), digest);
+        bool matched = (memcmp(digest, expected_digest, Hasher::DIGEST_SIZE) == 0);
+        return std::make_pair(vbmeta.size(), matched);
+    }
+
     size_t total_size = 0;
     Hasher hasher;
     for (const auto& vbmeta : vbmeta_images) {
@@ -66,6 +75,14 @@ std::pair<size_t, bool> VerifyVbmetaDigest(const std::vector<VBMetaData>& vbmeta
 
 template <typename Hasher>
 std::pair<std::string, size_t> CalculateVbmetaDigest(const std::vector<VBMetaData>& vbmeta_images) {
+    // Fast path: with no chained vbmeta there is only one image to digest.
+    if (vbmeta_images.size() == 1) {
+        const auto& vbmeta = vbmeta_images[0];
+        uint8_t digest[Hasher::DIGEST_SIZE];
+        Hasher::digest(vbmeta.data(), vbmeta.size(), digest);
+        return std::make_pair(BytesToHex(digest, Hasher::DIGEST_SIZE), vbmeta.size());
+    }
+
     std::string digest;
     size_t total_size = 0;
 
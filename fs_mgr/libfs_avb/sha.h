@@ -21,6 +21,11 @@
 namespace android {
 namespace fs_mgr {
 
+// Thin wrappers over BoringSSL. Note that BoringSSL selects the best
+// implementation for the CPU at runtime (SHA-NI on x86, the ARMv8
+// cryptography extensions on arm64, NEON otherwise), so no additional
+// vectorized digest layer is needed here.
+
 class SHA256Hasher {
   private:
     SHA256_CTX sha256_ctx;
@@ -39,6 +44,11 @@ class SHA256Hasher {
         SHA256_Final(hash, &sha256_ctx);
         return hash;
     }
+
+    // One-shot digest of a single buffer, without streaming state.
+    static void digest(const uint8_t* data, size_t data_size, uint8_t* out) {
+        ::SHA256(data, data_size, out);
+    }
 };
 
 class SHA512Hasher {
@@ -59,6 +69,11 @@ class SHA512Hasher {
         SHA512_Final(hash, &sha512_ctx);
         return hash;
     }
+
+    // One-shot digest of a single buffer, without streaming state.
+    static void digest(const uint8_t* data, size_t data_size, uint8_t* out) {
+        ::SHA512(data, data_size, out);
+    }
 };
 
 }  // namespace fs_mgr
@@ -99,6 +99,7 @@ Partition::Partition(std::string_view name, std::string_view group_name, uint32_
     : name_(name), group_name_(group_name), attributes_(attributes), size_(0) {}
 
 void Partition::AddExtent(std::unique_ptr<Extent>&& extent) {
+    extents_epoch_++;
     size_ += extent->num_sectors() * LP_SECTOR_SIZE;
 
     if (LinearExtent* new_extent = extent->AsLinearExtent()) {
@@ -119,11 +120,13 @@ void Partition::AddExtent(std::unique_ptr<Extent>&& extent) {
 }
 
 void Partition::RemoveExtents() {
+    extents_epoch_++;
     size_ = 0;
     extents_.clear();
 }
 
 void Partition::ShrinkTo(uint64_t aligned_size) {
+    extents_epoch_++;
     if (aligned_size == 0) {
         RemoveExtents();
         return;
@@ -582,70 +585,103 @@ void MetadataBuilder::RemovePartition(std::string_view name) {
     for (auto iter = partitions_.begin(); iter != partitions_.end(); iter++) {
         if ((*iter)->name() == name) {
             partitions_.erase(iter);
+            // The removed partition's epoch no longer contributes to the sum
+            // ExtentsEpoch() computes, so invalidate the index explicitly.
+            extent_index_valid_ = false;
             return;
         }
     }
 }
 
-void MetadataBuilder::ExtentsToFreeList(const std::vector<Interval>& extents,
-                                        std::vector<Interval>* free_regions) const {
-    // Convert the extent list into a list of gaps between the extents; i.e.,
-    // the list of ranges that are free on the disk.
-    for (size_t i = 1; i < extents.size(); i++) {
-        const Interval& previous = extents[i - 1];
-        const Interval& current = extents[i];
-        DCHECK(previous.device_index == current.device_index);
-
-        uint64_t aligned;
-        if (!AlignSector(block_devices_[current.device_index], previous.end, &aligned)) {
-            LERROR << "Sector " << previous.end << " caused integer overflow.";
-            continue;
-        }
-        if (aligned >= current.start) {
-            // There is no gap between these two extents, try the next one.
-            // Note that we check with >= instead of >, since alignment may
-            // bump the ending sector past the beginning of the next extent.
-            continue;
+// Record [start, end) as allocated in |regions|, merging it with any
+// overlapping or adjacent regions so the map stays a disjoint union.
+static void InsertAllocatedRegion(std::map<uint64_t, uint64_t>* regions, uint64_t start,
+                                  uint64_t end) {
+    auto iter = regions->upper_bound(start);
+    if (iter != regions->begin()) {
+        auto previous = std::prev(iter);
+        if (previous->second >= start) {
+            start = previous->first;
+            end = std::max(end, previous->second);
+            iter = regions->erase(previous);
         }
+    }
+    while (iter != regions->end() && iter->first <= end) {
+        end = std::max(end, iter->second);
+        iter = regions->erase(iter);
+    }
+    regions->emplace(start, end);
+}
 
-        // The new interval represents the free space starting at the end of
-        // the previous interval, and ending at the start of the next interval.
-        free_regions->emplace_back(current.device_index, aligned, current.start);
+uint64_t MetadataBuilder::ExtentsEpoch() const {
+    // Each partition's epoch only ever increases, so an unchanged sum means no
+    // partition's extent list was modified behind our back (for example, by a
+    // caller invoking Partition::RemoveExtents() directly).
+    uint64_t epoch = 0;
+    for (const auto& partition : partitions_) {
+        epoch += partition->extents_epoch_;
     }
+    return epoch;
 }
 
-auto MetadataBuilder::GetFreeRegions() const -> std::vector<Interval> {
-    std::vector<Interval> free_regions;
+void MetadataBuilder::EnsureExtentIndex() const {
+    if (extent_index_valid_ && extent_index_.size() == block_devices_.size() &&
+        extent_index_epoch_ == ExtentsEpoch()) {
+        allocation_stats_.index_reuses++;
+        return;
+    }
 
-    // Collect all extents in the partition table, per-device, then sort them
-    // by starting sector.
-    std::vector<std::vector<Interval>> device_extents(block_devices_.size());
+    extent_index_.assign(block_devices_.size(), {});
     for (const auto& partition : partitions_) {
         for (const auto& extent : partition->extents()) {
             LinearExtent* linear = extent->AsLinearExtent();
             if (!linear) {
                 continue;
             }
-            CHECK(linear->device_index() < device_extents.size());
-            auto& extents = device_extents[linear->device_index()];
-            extents.emplace_back(linear->device_index(), linear->physical_sector(),
-                                 linear->physical_sector() + extent->num_sectors());
+            CHECK(linear->device_index() < extent_index_.size());
+            InsertAllocatedRegion(&extent_index_[linear->device_index()],
+                                  linear->physical_sector(), linear->end_sector());
         }
     }
+    extent_index_epoch_ = ExtentsEpoch();
+    extent_index_valid_ = true;
+    allocation_stats_.index_rebuilds++;
+}
 
-    // Add 0-length intervals for the first and last sectors. This will cause
-    // ExtentToFreeList() to treat the space in between as available.
-    for (size_t i = 0; i < device_extents.size(); i++) {
-        auto& extents = device_extents[i];
-        const auto& block_device = block_devices_[i];
+auto MetadataBuilder::GetFreeRegions() const -> std::vector<Interval> {
+    EnsureExtentIndex();
 
-        uint64_t first_sector = block_device.first_logical_sector;
+    // Walk the gaps between allocated regions on each device; i.e., the list
+    // of ranges that are free on the disk.
+    std::vector<Interval> free_regions;
+    for (size_t i = 0; i < extent_index_.size(); i++) {
+        const auto& block_device = block_devices_[i];
         uint64_t last_sector = block_device.size / LP_SECTOR_SIZE;
-        extents.emplace_back(i, first_sector, first_sector);
-        extents.emplace_back(i, last_sector, last_sector);
 
-        std::sort(extents.begin(), extents.end());
-        ExtentsToFreeList(extents, &free_regions);
+        auto add_gap = [&](uint64_t start, uint64_t end) {
+            uint64_t aligned;
+            if (!AlignSector(block_device, start, &aligned)) {
+                LERROR << "Sector " << start << " caused integer overflow.";
+                return;
+            }
+            // Note that we check with >= instead of >, since alignment may
+            // bump the starting sector past the end of the gap.
+            if (aligned >= end) {
+                return;
+            }
+            free_regions.emplace_back(i, aligned, end);
+        };
+
+        uint64_t previous_end = block_device.first_logical_sector;
+        for (const auto& [start, end] : extent_index_[i]) {
+            if (start > previous_end) {
+                add_gap(previous_end, start);
+            }
+            previous_end = std::max(previous_end, end);
+        }
+        if (previous_end < last_sector) {
+            add_gap(previous_end, last_sector);
+        }
     }
     return free_regions;
 }
@@ -769,10 +805,16 @@ bool MetadataBuilder::GrowPartition(Partition* partition, uint64_t aligned_size,
         return false;
     }
 
-    // Everything succeeded, so commit the new extents.
+    // Everything succeeded, so commit the new extents. The index is valid
+    // here (GetFreeRegions() above ensured it), so update it incrementally
+    // rather than letting the epoch mismatch force a rebuild.
+    allocation_stats_.extents_allocated += new_extents.size();
     for (auto& extent : new_extents) {
+        InsertAllocatedRegion(&extent_index_[extent->device_index()], extent->physical_sector(),
+                              extent->end_sector());
         partition->AddExtent(std::move(extent));
     }
+    extent_index_epoch_ = ExtentsEpoch();
     return true;
 }
 
@@ -1054,6 +1054,33 @@ TEST_F(BuilderTest, AlignFreeRegion) {
     EXPECT_EQ(e2->end_sector(), 4197368);
 }
 
+TEST_F(BuilderTest, AllocationStats) {
+    auto builder = MetadataBuilder::New(10_GiB, 65536, 2);
+    ASSERT_NE(builder, nullptr);
+
+    Partition* system = builder->AddPartition("system", 0);
+    ASSERT_NE(system, nullptr);
+    ASSERT_TRUE(builder->ResizePartition(system, 1_GiB));
+    Partition* vendor = builder->AddPartition("vendor", 0);
+    ASSERT_NE(vendor, nullptr);
+    ASSERT_TRUE(builder->ResizePartition(vendor, 1_GiB));
+
+    const auto& stats = builder->allocation_stats();
+    EXPECT_EQ(stats.extents_allocated, 2);
+    // The second allocation should have reused the incrementally-maintained
+    // free-region index instead of rescanning the partition table.
+    EXPECT_EQ(stats.index_rebuilds, 1);
+    EXPECT_GE(stats.index_reuses, 1);
+
+    // Mutating a partition directly must invalidate the index: the freed
+    // space has to be visible to the next allocation, which would not fit
+    // if the stale index were reused.
+    uint64_t rebuilds = stats.index_rebuilds;
+    system->RemoveExtents();
+    ASSERT_TRUE(builder->ResizePartition(system, 8_GiB));
+    EXPECT_GT(builder->allocation_stats().index_rebuilds, rebuilds);
+}
+
 TEST_F(BuilderTest, ResizeOverflow) {
     BlockDeviceInfo super("super", 8_GiB, 786432, 229376, 4096);
     std::vector<BlockDeviceInfo> block_devices = {super};
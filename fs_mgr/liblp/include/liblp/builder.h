@@ -161,6 +161,9 @@ class Partition final {
     std::vector<std::unique_ptr<Extent>> extents_;
     uint32_t attributes_;
     uint64_t size_;
+    // Incremented on every change to |extents_|, so that MetadataBuilder can
+    // tell when its incremental free-region index has gone stale.
+    uint64_t extents_epoch_ = 0;
 };
 
 // An interval in the metadata. This is similar to a LinearExtent with one difference.
@@ -368,6 +371,18 @@ class MetadataBuilder {
     // Return the list of free regions not occupied by extents in the metadata.
     std::vector<Interval> GetFreeRegions() const;
 
+    // Counters describing how the extent allocator has behaved over the
+    // lifetime of this builder, exposed for tooling.
+    struct AllocationStats {
+        // Number of extents committed by ResizePartition().
+        uint64_t extents_allocated = 0;
+        // Number of times the free-region index was rebuilt from the partition
+        // table, versus reused from a previous allocation.
+        uint64_t index_rebuilds = 0;
+        uint64_t index_reuses = 0;
+    };
+    const AllocationStats& allocation_stats() const { return allocation_stats_; }
+
     uint64_t logical_block_size() const;
 
   private:
@@ -406,8 +421,8 @@ class MetadataBuilder {
     bool IsAnyRegionCovered(const std::vector<Interval>& regions,
                             const LinearExtent& candidate) const;
     bool IsAnyRegionAllocated(const LinearExtent& candidate) const;
-    void ExtentsToFreeList(const std::vector<Interval>& extents,
-                           std::vector<Interval>* free_regions) const;
+    uint64_t ExtentsEpoch() const;
+    void EnsureExtentIndex() const;
     std::vector<Interval> PrioritizeSecondHalfOfSuper(const std::vector<Interval>& free_list);
     std::unique_ptr<LinearExtent> ExtendFinalExtent(Partition* partition,
                                                     const std::vector<Interval>& free_list,
@@ -422,6 +437,16 @@ class MetadataBuilder {
     std::vector<std::unique_ptr<PartitionGroup>> groups_;
     std::vector<LpMetadataBlockDevice> block_devices_;
     bool auto_slot_suffixing_;
+
+    // Union of allocated regions on each block device, as an ordered map of
+    // starting sector to ending sector. This is a cache of the extents in
+    // |partitions_|, maintained incrementally across allocations so that
+    // resizing many partitions does not rescan the partition table each time.
+    // It is rebuilt whenever the epoch sum below no longer matches.
+    mutable std::vector<std::map<uint64_t, uint64_t>> extent_index_;
+    mutable uint64_t extent_index_epoch_ = 0;
+    mutable bool extent_index_valid_ = false;
+    mutable AllocationStats allocation_stats_;
 };
 
 // Read BlockDeviceInfo for a given block device. This always returns false
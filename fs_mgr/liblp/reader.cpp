@@ -19,6 +19,7 @@
 #include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <unistd.h>
 
 #include <functional>
@@ -39,6 +40,10 @@ class Reader {
   public:
     virtual ~Reader(){};
     virtual bool ReadFully(void* buffer, size_t length) = 0;
+    // If the reader is backed by memory, returns a pointer to the next
+    // |length| bytes and advances past them, avoiding a copy. Otherwise,
+    // returns nullptr and the position is unchanged.
+    virtual const uint8_t* Direct(size_t) { return nullptr; }
 };
 
 class FileReader final : public Reader {
@@ -65,6 +70,15 @@ class MemoryReader final : public Reader {
         pos_ += length;
         return true;
     }
+    const uint8_t* Direct(size_t length) override {
+        if (size_ - pos_ < length) {
+            errno = EINVAL;
+            return nullptr;
+        }
+        const uint8_t* out = buffer_ + pos_;
+        pos_ += length;
+        return out;
+    }
 
   private:
     const uint8_t* buffer_;
@@ -261,20 +275,27 @@ static std::unique_ptr<LpMetadata> ParseMetadata(const LpMetadataGeometry& geome
         return nullptr;
     }
 
-    // Read the metadata payload. Allocation is fallible since the table size
-    // could be large.
-    std::unique_ptr<uint8_t[]> buffer(new (std::nothrow) uint8_t[header.tables_size]);
-    if (!buffer) {
-        LERROR << "Out of memory reading logical partition tables.";
-        return nullptr;
-    }
-    if (!reader->ReadFully(buffer.get(), header.tables_size)) {
-        PERROR << __PRETTY_FUNCTION__ << " read " << header.tables_size << "bytes failed";
-        return nullptr;
+    // Access the metadata payload. If the reader is backed by memory (for
+    // example, an mmap of the super partition), the tables are checksummed
+    // and parsed in place; otherwise they are copied into a buffer first.
+    // Allocation is fallible since the table size could be large.
+    std::unique_ptr<uint8_t[]> owned_buffer;
+    const uint8_t* tables = reader->Direct(header.tables_size);
+    if (!tables) {
+        owned_buffer.reset(new (std::nothrow) uint8_t[header.tables_size]);
+        if (!owned_buffer) {
+            LERROR << "Out of memory reading logical partition tables.";
+            return nullptr;
+        }
+        if (!reader->ReadFully(owned_buffer.get(), header.tables_size)) {
+            PERROR << __PRETTY_FUNCTION__ << " read " << header.tables_size << "bytes failed";
+            return nullptr;
+        }
+        tables = owned_buffer.get();
     }
 
     uint8_t checksum[32];
-    SHA256(buffer.get(), header.tables_size, checksum);
+    SHA256(tables, header.tables_size, checksum);
     if (memcmp(checksum, header.tables_checksum, sizeof(checksum)) != 0) {
         LERROR << "Logical partition metadata has invalid table checksum.";
         return nullptr;
@@ -287,7 +308,8 @@ static std::unique_ptr<LpMetadata> ParseMetadata(const LpMetadataGeometry& geome
 
     // ValidateTableSize ensured that |cursor| is valid for the number of
     // entries in the table.
-    uint8_t* cursor = buffer.get() + header.partitions.offset;
+    const uint8_t* cursor = tables + header.partitions.offset;
+    metadata->partitions.reserve(header.partitions.num_entries);
     for (size_t i = 0; i < header.partitions.num_entries; i++) {
         LpMetadataPartition partition;
         memcpy(&partition, cursor, sizeof(partition));
@@ -313,7 +335,8 @@ static std::unique_ptr<LpMetadata> ParseMetadata(const LpMetadataGeometry& geome
         metadata->partitions.push_back(partition);
     }
 
-    cursor = buffer.get() + header.extents.offset;
+    cursor = tables + header.extents.offset;
+    metadata->extents.reserve(header.extents.num_entries);
     for (size_t i = 0; i < header.extents.num_entries; i++) {
         LpMetadataExtent extent;
         memcpy(&extent, cursor, sizeof(extent));
@@ -328,7 +351,8 @@ static std::unique_ptr<LpMetadata> ParseMetadata(const LpMetadataGeometry& geome
         metadata->extents.push_back(extent);
     }
 
-    cursor = buffer.get() + header.groups.offset;
+    cursor = tables + header.groups.offset;
+    metadata->groups.reserve(header.groups.num_entries);
     for (size_t i = 0; i < header.groups.num_entries; i++) {
         LpMetadataPartitionGroup group = {};
         memcpy(&group, cursor, sizeof(group));
@@ -337,7 +361,8 @@ static std::unique_ptr<LpMetadata> ParseMetadata(const LpMetadataGeometry& geome
         metadata->groups.push_back(group);
     }
 
-    cursor = buffer.get() + header.block_devices.offset;
+    cursor = tables + header.block_devices.offset;
+    metadata->block_devices.reserve(header.block_devices.num_entries);
     for (size_t i = 0; i < header.block_devices.num_entries; i++) {
         LpMetadataBlockDevice device = {};
         memcpy(&device, cursor, sizeof(device));
@@ -373,9 +398,30 @@ std::unique_ptr<LpMetadata> ParseMetadata(const LpMetadataGeometry& geometry, in
     return ParseMetadata(geometry, &reader);
 }
 
-std::unique_ptr<LpMetadata> ReadPrimaryMetadata(int fd, const LpMetadataGeometry& geometry,
-                                                uint32_t slot_number) {
-    int64_t offset = GetPrimaryMetadataOffset(geometry, slot_number);
+// Parse a metadata slot at the given absolute offset. The slot is mapped
+// into memory so the tables can be checksummed and parsed in place, without
+// copying them through an intermediate buffer. If the descriptor cannot be
+// mapped (or the slot lies outside of it), this falls back to reading.
+static std::unique_ptr<LpMetadata> ParseMetadataAt(const LpMetadataGeometry& geometry, int fd,
+                                                   int64_t offset) {
+    uint64_t device_size;
+    if (GetDescriptorSize(fd, &device_size) &&
+        offset + geometry.metadata_max_size <= device_size) {
+        // |offset| is only sector-aligned, so map from the page boundary below
+        // it and parse at the adjusted address.
+        static const int64_t page_mask = sysconf(_SC_PAGESIZE) - 1;
+        int64_t aligned_offset = offset & ~page_mask;
+        size_t adjust = offset - aligned_offset;
+        size_t map_size = adjust + geometry.metadata_max_size;
+        void* map = mmap(nullptr, map_size, PROT_READ, MAP_SHARED, fd, aligned_offset);
+        if (map != MAP_FAILED) {
+            auto metadata = ParseMetadata(geometry, static_cast<uint8_t*>(map) + adjust,
+                                          geometry.metadata_max_size);
+            munmap(map, map_size);
+            return metadata;
+        }
+    }
+
     if (SeekFile64(fd, offset, SEEK_SET) < 0) {
         PERROR << __PRETTY_FUNCTION__ << " lseek failed: offset " << offset;
         return nullptr;
@@ -383,14 +429,14 @@ std::unique_ptr<LpMetadata> ReadPrimaryMetadata(int fd, const LpMetadataGeometry
     return ParseMetadata(geometry, fd);
 }
 
+std::unique_ptr<LpMetadata> ReadPrimaryMetadata(int fd, const LpMetadataGeometry& geometry,
+                                                uint32_t slot_number) {
+    return ParseMetadataAt(geometry, fd, GetPrimaryMetadataOffset(geometry, slot_number));
+}
+
 std::unique_ptr<LpMetadata> ReadBackupMetadata(int fd, const LpMetadataGeometry& geometry,
                                                uint32_t slot_number) {
-    int64_t offset = GetBackupMetadataOffset(geometry, slot_number);
-    if (SeekFile64(fd, offset, SEEK_SET) < 0) {
-        PERROR << __PRETTY_FUNCTION__ << " lseek failed: offset " << offset;
-        return nullptr;
-    }
-    return ParseMetadata(geometry, fd);
+    return ParseMetadataAt(geometry, fd, GetBackupMetadataOffset(geometry, slot_number));
 }
 
 namespace {
@@ -460,11 +506,7 @@ std::unique_ptr<LpMetadata> ReadMetadata(const IPartitionOpener& opener,
     std::unique_ptr<LpMetadata> metadata;
 
     for (const auto& offset : offsets) {
-        if (SeekFile64(fd, offset, SEEK_SET) < 0) {
-            PERROR << __PRETTY_FUNCTION__ << " lseek failed, offset " << offset;
-            continue;
-        }
-        if ((metadata = ParseMetadata(geometry, fd)) != nullptr) {
+        if ((metadata = ParseMetadataAt(geometry, fd, offset)) != nullptr) {
             break;
         }
     }
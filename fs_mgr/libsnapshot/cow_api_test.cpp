@@ -105,7 +105,7 @@ TEST_F(CowTest, ReadWrite) {
     ASSERT_EQ(op->compression, kCowCompressNone);
     ASSERT_EQ(op->data_length, 4096);
     ASSERT_EQ(op->new_block, 50);
-    ASSERT_EQ(op->source, 106);
+    ASSERT_EQ(op->source, 114);
     ASSERT_TRUE(reader.ReadData(*op, &sink));
     ASSERT_EQ(sink.stream(), data);
 
@@ -134,6 +134,49 @@ TEST_F(CowTest, ReadWrite) {
     ASSERT_TRUE(iter->Done());
 }
 
+TEST_F(CowTest, FindOp) {
+    CowOptions options;
+    CowWriter writer(options);
+
+    ASSERT_TRUE(writer.Initialize(cow_->fd));
+
+    std::string data = "This is some data, believe it";
+    data.resize(options.block_size, '\0');
+
+    ASSERT_TRUE(writer.AddCopy(10, 20));
+    ASSERT_TRUE(writer.AddRawBlocks(50, data.data(), data.size()));
+    ASSERT_TRUE(writer.AddZeroBlocks(51, 2));
+    // Overwrite block 10; the later op should win.
+    ASSERT_TRUE(writer.AddCopy(10, 30));
+    ASSERT_TRUE(writer.Flush());
+
+    ASSERT_EQ(lseek(cow_->fd, 0, SEEK_SET), 0);
+
+    CowReader reader;
+    ASSERT_TRUE(reader.Parse(cow_->fd));
+
+    auto op = reader.FindOp(10);
+    ASSERT_NE(op, nullptr);
+    ASSERT_EQ(op->type, kCowCopyOp);
+    ASSERT_EQ(op->source, 30);
+
+    op = reader.FindOp(50);
+    ASSERT_NE(op, nullptr);
+    ASSERT_EQ(op->type, kCowReplaceOp);
+
+    StringSink sink;
+    ASSERT_TRUE(reader.ReadData(*op, &sink));
+    ASSERT_EQ(sink.stream(), data);
+
+    op = reader.FindOp(52);
+    ASSERT_NE(op, nullptr);
+    ASSERT_EQ(op->type, kCowZeroOp);
+
+    // Blocks not touched by any operation.
+    ASSERT_EQ(reader.FindOp(9), nullptr);
+    ASSERT_EQ(reader.FindOp(53), nullptr);
+}
+
 TEST_F(CowTest, CompressGz) {
     CowOptions options;
     options.compression = "gz";
@@ -163,7 +206,7 @@ TEST_F(CowTest, CompressGz) {
     ASSERT_EQ(op->compression, kCowCompressGz);
     ASSERT_EQ(op->data_length, 56);  // compressed!
     ASSERT_EQ(op->new_block, 50);
-    ASSERT_EQ(op->source, 106);
+    ASSERT_EQ(op->source, 114);
     ASSERT_TRUE(reader.ReadData(*op, &sink));
     ASSERT_EQ(sink.stream(), data);
 
@@ -204,6 +247,81 @@ TEST_F(CowTest, CompressTwoBlocks) {
     ASSERT_TRUE(reader.ReadData(*op, &sink));
 }
 
+TEST_F(CowTest, CompressLz4) {
+    CowOptions options;
+    options.compression = "lz4";
+    CowWriter writer(options);
+
+    ASSERT_TRUE(writer.Initialize(cow_->fd));
+
+    std::string data = "This is some data, believe it";
+    data.resize(options.block_size, '\0');
+
+    ASSERT_TRUE(writer.AddRawBlocks(50, data.data(), data.size()));
+    ASSERT_TRUE(writer.Flush());
+
+    ASSERT_EQ(lseek(cow_->fd, 0, SEEK_SET), 0);
+
+    CowReader reader;
+    ASSERT_TRUE(reader.Parse(cow_->fd));
+
+    auto iter = reader.GetOpIter();
+    ASSERT_NE(iter, nullptr);
+    ASSERT_FALSE(iter->Done());
+    auto op = &iter->Get();
+
+    StringSink sink;
+
+    ASSERT_EQ(op->type, kCowReplaceOp);
+    ASSERT_EQ(op->compression, kCowCompressLz4);
+    ASSERT_LT(op->data_length, options.block_size);  // compressed!
+    ASSERT_EQ(op->new_block, 50);
+    ASSERT_TRUE(reader.ReadData(*op, &sink));
+    ASSERT_EQ(sink.stream(), data);
+
+    iter->Next();
+    ASSERT_TRUE(iter->Done());
+}
+
+TEST_F(CowTest, CompressManyBlocks) {
+    CowOptions options;
+    options.compression = "gz";
+    CowWriter writer(options);
+
+    ASSERT_TRUE(writer.Initialize(cow_->fd));
+
+    // Large enough to keep the compression worker pool busy.
+    constexpr size_t kNumBlocks = 512;
+    std::string data(options.block_size * kNumBlocks, '\0');
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = static_cast<char>(i / options.block_size);
+    }
+
+    ASSERT_TRUE(writer.AddRawBlocks(50, data.data(), data.size()));
+    ASSERT_TRUE(writer.Flush());
+
+    ASSERT_EQ(lseek(cow_->fd, 0, SEEK_SET), 0);
+
+    CowReader reader;
+    ASSERT_TRUE(reader.Parse(cow_->fd));
+
+    auto iter = reader.GetOpIter();
+    ASSERT_NE(iter, nullptr);
+    for (size_t i = 0; i < kNumBlocks; i++) {
+        ASSERT_FALSE(iter->Done());
+        auto op = &iter->Get();
+
+        StringSink sink;
+        ASSERT_EQ(op->type, kCowReplaceOp);
+        ASSERT_EQ(op->new_block, 50 + i);
+        ASSERT_TRUE(reader.ReadData(*op, &sink));
+        ASSERT_EQ(sink.stream(), data.substr(i * options.block_size, options.block_size));
+
+        iter->Next();
+    }
+    ASSERT_TRUE(iter->Done());
+}
+
 // Only return 1-byte buffers, to stress test the partial read logic in
 // CowReader.
 class HorribleStringSink : public StringSink {
@@ -20,6 +20,7 @@
 
 #include <android-base/logging.h>
 #include <brotli/decode.h>
+#include <lz4.h>
 #include <zlib.h>
 
 namespace android {
@@ -260,5 +261,58 @@ std::unique_ptr<IDecompressor> IDecompressor::Brotli() {
     return std::unique_ptr<IDecompressor>(new BrotliDecompressor());
 }
 
+// LZ4 block decoding needs the whole input and output up front, so this does
+// not derive from StreamDecompressor.
+class Lz4Decompressor final : public IDecompressor {
+  public:
+    bool Decompress(size_t output_bytes) override;
+};
+
+bool Lz4Decompressor::Decompress(size_t output_bytes) {
+    size_t stream_remaining = stream_->Size();
+    std::string input(stream_remaining, '\0');
+    char* input_pos = input.data();
+    while (stream_remaining) {
+        size_t read;
+        if (!stream_->Read(input_pos, stream_remaining, &read)) {
+            return false;
+        }
+        if (!read) {
+            LOG(ERROR) << "Stream ended prematurely";
+            return false;
+        }
+        input_pos += read;
+        stream_remaining -= read;
+    }
+
+    size_t buffer_size;
+    uint8_t* buffer = reinterpret_cast<uint8_t*>(sink_->GetBuffer(output_bytes, &buffer_size));
+    if (!buffer) {
+        LOG(ERROR) << "Could not acquire buffer from sink";
+        return false;
+    }
+    if (buffer_size < output_bytes) {
+        LOG(ERROR) << "LZ4 decompression needs a contiguous output buffer, got " << buffer_size
+                   << " of " << output_bytes << " bytes";
+        return false;
+    }
+
+    int rv = LZ4_decompress_safe(input.data(), reinterpret_cast<char*>(buffer), input.size(),
+                                 buffer_size);
+    if (rv < 0 || static_cast<size_t>(rv) != output_bytes) {
+        LOG(ERROR) << "LZ4_decompress_safe returned: " << rv;
+        return false;
+    }
+    if (!sink_->ReturnData(buffer, output_bytes)) {
+        LOG(ERROR) << "Could not return buffer to sink";
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<IDecompressor> IDecompressor::Lz4() {
+    return std::unique_ptr<IDecompressor>(new Lz4Decompressor());
+}
+
 }  // namespace snapshot
 }  // namespace android
@@ -14,9 +14,11 @@
 // limitations under the License.
 //
 
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <limits>
 
 #include <android-base/file.h>
@@ -30,6 +32,12 @@ namespace snapshot {
 
 CowReader::CowReader() : fd_(-1), header_(), fd_size_(0) {}
 
+CowReader::~CowReader() {
+    if (tail_map_) {
+        munmap(tail_map_, tail_map_size_);
+    }
+}
+
 static void SHA256(const void*, size_t, uint8_t[]) {
 #if 0
     SHA256_CTX c;
@@ -72,6 +80,14 @@ bool CowReader::Parse(android::base::borrowed_fd fd) {
         LOG(ERROR) << "ops size " << header_.ops_size << " is too large";
         return false;
     }
+    if (fd_size_ - header_.ops_offset - header_.ops_size < header_.index_size) {
+        LOG(ERROR) << "index size " << header_.index_size << " is too large";
+        return false;
+    }
+    if (header_.index_size % sizeof(CowBlockIndexEntry) != 0) {
+        LOG(ERROR) << "index size " << header_.index_size << " is not a multiple of entry size";
+        return false;
+    }
 
     if (header_.magic != kCowMagicNumber) {
         LOG(ERROR) << "Header Magic corrupted. Magic: " << header_.magic
@@ -117,7 +133,7 @@ bool CowReader::GetHeader(CowHeader* header) {
 
 class CowOpIter final : public ICowOpIter {
   public:
-    CowOpIter(std::unique_ptr<uint8_t[]>&& ops, size_t len);
+    CowOpIter(const uint8_t* ops, size_t len);
 
     bool Done() override;
     const CowOperation& Get() override;
@@ -126,14 +142,13 @@ class CowOpIter final : public ICowOpIter {
   private:
     bool HasNext();
 
-    std::unique_ptr<uint8_t[]> ops_;
     const uint8_t* pos_;
     const uint8_t* end_;
     bool done_;
 };
 
-CowOpIter::CowOpIter(std::unique_ptr<uint8_t[]>&& ops, size_t len)
-    : ops_(std::move(ops)), pos_(ops_.get()), end_(pos_ + len), done_(!HasNext()) {}
+CowOpIter::CowOpIter(const uint8_t* ops, size_t len)
+    : pos_(ops), end_(pos_ + len), done_(!HasNext()) {}
 
 bool CowOpIter::Done() {
     return done_;
@@ -156,27 +171,83 @@ const CowOperation& CowOpIter::Get() {
     return *reinterpret_cast<const CowOperation*>(pos_);
 }
 
-std::unique_ptr<ICowOpIter> CowReader::GetOpIter() {
-    if (lseek(fd_.get(), header_.ops_offset, SEEK_SET) < 0) {
-        PLOG(ERROR) << "lseek ops failed";
-        return nullptr;
+bool CowReader::LoadTail() {
+    if (ops_base_) {
+        return true;
     }
-    auto ops_buffer = std::make_unique<uint8_t[]>(header_.ops_size);
-    if (!android::base::ReadFully(fd_, ops_buffer.get(), header_.ops_size)) {
-        PLOG(ERROR) << "read ops failed";
-        return nullptr;
+
+    // Map the operation sequence and block index together, so that op lookups
+    // are served from file-backed pages rather than anonymous memory. If the
+    // mapping fails (eg, the descriptor does not support mmap), fall back to
+    // reading the region into a heap buffer.
+    size_t tail_size = header_.ops_size + header_.index_size;
+    static const off_t page_mask = sysconf(_SC_PAGESIZE) - 1;
+    off_t aligned_offset = header_.ops_offset & ~page_mask;
+    size_t adjust = header_.ops_offset - aligned_offset;
+    void* map = mmap(nullptr, tail_size + adjust, PROT_READ, MAP_SHARED, fd_.get(),
+                     aligned_offset);
+    if (map != MAP_FAILED) {
+        tail_map_ = map;
+        tail_map_size_ = tail_size + adjust;
+        ops_base_ = static_cast<const uint8_t*>(map) + adjust;
+    } else {
+        PLOG(WARNING) << "mmap ops failed, falling back to read";
+        if (lseek(fd_.get(), header_.ops_offset, SEEK_SET) < 0) {
+            PLOG(ERROR) << "lseek ops failed";
+            return false;
+        }
+        tail_buffer_ = std::make_unique<uint8_t[]>(tail_size);
+        if (!android::base::ReadFully(fd_, tail_buffer_.get(), tail_size)) {
+            PLOG(ERROR) << "read ops failed";
+            tail_buffer_ = nullptr;
+            return false;
+        }
+        ops_base_ = tail_buffer_.get();
     }
 
     uint8_t csum[32];
     memset(csum, 0, sizeof(uint8_t) * 32);
 
-    SHA256(ops_buffer.get(), header_.ops_size, csum);
+    SHA256(ops_base_, header_.ops_size, csum);
     if (memcmp(csum, header_.ops_checksum, sizeof(csum)) != 0) {
         LOG(ERROR) << "ops checksum does not match";
+        ops_base_ = nullptr;
+        return false;
+    }
+
+    if (header_.index_size) {
+        index_ = reinterpret_cast<const CowBlockIndexEntry*>(ops_base_ + header_.ops_size);
+        index_entries_ = header_.index_size / sizeof(CowBlockIndexEntry);
+    }
+    return true;
+}
+
+std::unique_ptr<ICowOpIter> CowReader::GetOpIter() {
+    if (!LoadTail()) {
+        return nullptr;
+    }
+    return std::make_unique<CowOpIter>(ops_base_, header_.ops_size);
+}
+
+const CowOperation* CowReader::FindOp(uint64_t new_block) {
+    if (!LoadTail() || !index_) {
         return nullptr;
     }
 
-    return std::make_unique<CowOpIter>(std::move(ops_buffer), header_.ops_size);
+    // Entries are sorted by (block, op index); the last entry for a block is
+    // the operation that takes effect.
+    auto it = std::upper_bound(index_, index_ + index_entries_, new_block,
+                               [](uint64_t block, const CowBlockIndexEntry& entry) {
+                                   return block < entry.new_block;
+                               });
+    if (it == index_) {
+        return nullptr;
+    }
+    --it;
+    if (it->new_block != new_block || it->op_index >= header_.num_ops) {
+        return nullptr;
+    }
+    return reinterpret_cast<const CowOperation*>(ops_base_ + it->op_index * sizeof(CowOperation));
 }
 
 bool CowReader::GetRawBytes(uint64_t offset, void* buffer, size_t len, size_t* read) {
@@ -241,6 +312,9 @@ bool CowReader::ReadData(const CowOperation& op, IByteSink* sink) {
         case kCowCompressBrotli:
             decompressor = IDecompressor::Brotli();
             break;
+        case kCowCompressLz4:
+            decompressor = IDecompressor::Lz4();
+            break;
         default:
             LOG(ERROR) << "Unknown compression type: " << op.compression;
             return false;
@@ -17,7 +17,9 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <limits>
+#include <tuple>
 
 #include <android-base/file.h>
 #include <android-base/logging.h>
@@ -25,6 +27,7 @@
 #include <brotli/encode.h>
 #include <libsnapshot/cow_reader.h>
 #include <libsnapshot/cow_writer.h>
+#include <lz4.h>
 #include <zlib.h>
 
 namespace android {
@@ -78,6 +81,10 @@ CowWriter::CowWriter(const CowOptions& options) : ICowWriter(options), fd_(-1) {
     SetupHeaders();
 }
 
+CowWriter::~CowWriter() {
+    StopCompressionThreads();
+}
+
 void CowWriter::SetupHeaders() {
     header_ = {};
     header_.magic = kCowMagicNumber;
@@ -92,6 +99,8 @@ bool CowWriter::ParseOptions() {
         compression_ = kCowCompressGz;
     } else if (options_.compression == "brotli") {
         compression_ = kCowCompressBrotli;
+    } else if (options_.compression == "lz4") {
+        compression_ = kCowCompressLz4;
     } else if (options_.compression == "none") {
         compression_ = kCowCompressNone;
     } else if (!options_.compression.empty()) {
@@ -112,6 +121,9 @@ bool CowWriter::Initialize(borrowed_fd fd, OpenMode mode) {
     if (!ParseOptions()) {
         return false;
     }
+    if (compression_ && compress_threads_.empty()) {
+        StartCompressionThreads();
+    }
 
     switch (mode) {
         case OpenMode::WRITE:
@@ -191,40 +203,53 @@ bool CowWriter::EmitRawBlocks(uint64_t new_block_start, const void* data, size_t
         return false;
     }
 
-    const uint8_t* iter = reinterpret_cast<const uint8_t*>(data);
-    for (size_t i = 0; i < size / header_.block_size; i++) {
-        CowOperation op = {};
-        op.type = kCowReplaceOp;
-        op.new_block = new_block_start + i;
-        op.source = pos;
+    size_t num_blocks = size / header_.block_size;
 
-        if (compression_) {
-            auto data = Compress(iter, header_.block_size);
-            if (data.empty()) {
-                PLOG(ERROR) << "AddRawBlocks: compression failed";
-                return false;
-            }
-            if (data.size() > std::numeric_limits<uint16_t>::max()) {
-                LOG(ERROR) << "Compressed block is too large: " << data.size() << " bytes";
-                return false;
-            }
-            if (!WriteRawData(data.data(), data.size())) {
-                PLOG(ERROR) << "AddRawBlocks: write failed";
-                return false;
-            }
-            op.compression = compression_;
-            op.data_length = static_cast<uint16_t>(data.size());
-            pos += data.size();
-        } else {
+    if (!compression_) {
+        for (size_t i = 0; i < num_blocks; i++) {
+            CowOperation op = {};
+            op.type = kCowReplaceOp;
+            op.new_block = new_block_start + i;
+            op.source = pos;
             op.data_length = static_cast<uint16_t>(header_.block_size);
             pos += header_.block_size;
+            AddOperation(op);
+        }
+        if (!WriteRawData(data, size)) {
+            PLOG(ERROR) << "AddRawBlocks: write failed";
+            return false;
+        }
+        return true;
+    }
+
+    // Compress all blocks on the worker pool, then assemble the results in
+    // block order and write them out as one batch.
+    std::vector<std::basic_string<uint8_t>> blocks;
+    if (!CompressBlocks(data, num_blocks, &blocks)) {
+        PLOG(ERROR) << "AddRawBlocks: compression failed";
+        return false;
+    }
+
+    std::basic_string<uint8_t> compressed;
+    for (size_t i = 0; i < num_blocks; i++) {
+        if (blocks[i].size() > std::numeric_limits<uint16_t>::max()) {
+            LOG(ERROR) << "Compressed block is too large: " << blocks[i].size() << " bytes";
+            return false;
         }
 
+        CowOperation op = {};
+        op.type = kCowReplaceOp;
+        op.new_block = new_block_start + i;
+        op.source = pos;
+        op.compression = compression_;
+        op.data_length = static_cast<uint16_t>(blocks[i].size());
+        pos += blocks[i].size();
         AddOperation(op);
-        iter += header_.block_size;
+
+        compressed += blocks[i];
     }
 
-    if (!compression_ && !WriteRawData(data, size)) {
+    if (!WriteRawData(compressed.data(), compressed.size())) {
         PLOG(ERROR) << "AddRawBlocks: write failed";
         return false;
     }
@@ -275,6 +300,22 @@ std::basic_string<uint8_t> CowWriter::Compress(const void* data, size_t length)
             }
             return std::basic_string<uint8_t>(buffer.get(), encoded_size);
         }
+        case kCowCompressLz4: {
+            auto bound = LZ4_compressBound(length);
+            if (bound <= 0) {
+                LOG(ERROR) << "LZ4_compressBound returned: " << bound;
+                return {};
+            }
+            auto buffer = std::make_unique<char[]>(bound);
+
+            auto rv = LZ4_compress_default(reinterpret_cast<const char*>(data), buffer.get(),
+                                           length, bound);
+            if (rv <= 0) {
+                LOG(ERROR) << "LZ4_compress_default returned: " << rv;
+                return {};
+            }
+            return std::basic_string<uint8_t>(reinterpret_cast<uint8_t*>(buffer.get()), rv);
+        }
         default:
             LOG(ERROR) << "unhandled compression type: " << compression_;
             break;
@@ -282,6 +323,105 @@ std::basic_string<uint8_t> CowWriter::Compress(const void* data, size_t length)
     return {};
 }
 
+void CowWriter::StartCompressionThreads() {
+    // The emitting thread claims blocks as well, so start one fewer worker
+    // than there are cores. With a single core the inline path is used.
+    size_t num_threads = (std::thread::hardware_concurrency() ?: 4) - 1;
+    for (size_t i = 0; i < num_threads; i++) {
+        compress_threads_.emplace_back(&CowWriter::CompressionThread, this);
+    }
+}
+
+void CowWriter::StopCompressionThreads() {
+    {
+        std::lock_guard<std::mutex> lock(compress_lock_);
+        compress_exit_ = true;
+    }
+    compress_cv_.notify_all();
+    for (auto& thread : compress_threads_) {
+        thread.join();
+    }
+    compress_threads_.clear();
+    compress_exit_ = false;
+}
+
+void CowWriter::CompressionThread() {
+    std::unique_lock<std::mutex> lock(compress_lock_);
+    while (true) {
+        compress_cv_.wait(lock, [this]() {
+            return compress_exit_ || compress_next_block_ < compress_num_blocks_;
+        });
+        if (compress_exit_) {
+            return;
+        }
+
+        size_t i = compress_next_block_++;
+        const uint8_t* block = compress_data_ + i * header_.block_size;
+
+        lock.unlock();
+        auto data = Compress(block, header_.block_size);
+        lock.lock();
+
+        if (data.empty()) {
+            compress_failed_ = true;
+        }
+        (*compress_results_)[i] = std::move(data);
+        if (++compress_blocks_done_ == compress_num_blocks_) {
+            compress_cv_.notify_all();
+        }
+    }
+}
+
+bool CowWriter::CompressBlocks(const void* data, size_t num_blocks,
+                               std::vector<std::basic_string<uint8_t>>* out) {
+    out->clear();
+    out->resize(num_blocks);
+
+    if (compress_threads_.empty()) {
+        const uint8_t* iter = reinterpret_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < num_blocks; i++) {
+            (*out)[i] = Compress(iter, header_.block_size);
+            if ((*out)[i].empty()) {
+                return false;
+            }
+            iter += header_.block_size;
+        }
+        return true;
+    }
+
+    std::unique_lock<std::mutex> lock(compress_lock_);
+    compress_data_ = reinterpret_cast<const uint8_t*>(data);
+    compress_num_blocks_ = num_blocks;
+    compress_next_block_ = 0;
+    compress_blocks_done_ = 0;
+    compress_results_ = out;
+    compress_failed_ = false;
+    compress_cv_.notify_all();
+
+    // Participate in the batch rather than just waiting on the workers.
+    while (compress_next_block_ < compress_num_blocks_) {
+        size_t i = compress_next_block_++;
+        const uint8_t* block = compress_data_ + i * header_.block_size;
+
+        lock.unlock();
+        auto data = Compress(block, header_.block_size);
+        lock.lock();
+
+        if (data.empty()) {
+            compress_failed_ = true;
+        }
+        (*compress_results_)[i] = std::move(data);
+        compress_blocks_done_++;
+    }
+    compress_cv_.wait(lock, [this]() { return compress_blocks_done_ == compress_num_blocks_; });
+
+    compress_data_ = nullptr;
+    compress_num_blocks_ = 0;
+    compress_next_block_ = 0;
+    compress_results_ = nullptr;
+    return !compress_failed_;
+}
+
 // TODO: Fix compilation issues when linking libcrypto library
 // when snapuserd is compiled as part of ramdisk.
 static void SHA256(const void*, size_t, uint8_t[]) {
@@ -294,7 +434,10 @@ static void SHA256(const void*, size_t, uint8_t[]) {
 }
 
 bool CowWriter::Flush() {
+    auto index = BuildBlockIndex();
+
     header_.ops_size = ops_.size();
+    header_.index_size = index.size() * sizeof(CowBlockIndexEntry);
 
     memset(header_.ops_checksum, 0, sizeof(uint8_t) * 32);
     memset(header_.header_checksum, 0, sizeof(uint8_t) * 32);
@@ -318,6 +461,10 @@ bool CowWriter::Flush() {
         PLOG(ERROR) << "write ops failed";
         return false;
     }
+    if (!WriteFully(fd_, index.data(), header_.index_size)) {
+        PLOG(ERROR) << "write block index failed";
+        return false;
+    }
 
     // Re-position for any subsequent writes.
     if (lseek(fd_.get(), header_.ops_offset, SEEK_SET) < 0) {
@@ -327,8 +474,24 @@ bool CowWriter::Flush() {
     return true;
 }
 
+std::vector<CowBlockIndexEntry> CowWriter::BuildBlockIndex() const {
+    std::vector<CowBlockIndexEntry> index;
+    index.reserve(header_.num_ops);
+
+    const auto* ops = reinterpret_cast<const CowOperation*>(ops_.data());
+    for (uint64_t i = 0; i < header_.num_ops; i++) {
+        index.emplace_back(CowBlockIndexEntry{ops[i].new_block, i});
+    }
+    std::sort(index.begin(), index.end(),
+              [](const CowBlockIndexEntry& a, const CowBlockIndexEntry& b) {
+                  return std::tie(a.new_block, a.op_index) < std::tie(b.new_block, b.op_index);
+              });
+    return index;
+}
+
 uint64_t CowWriter::GetCowSize() {
-    return header_.ops_offset + header_.num_ops * sizeof(CowOperation);
+    return header_.ops_offset +
+           header_.num_ops * (sizeof(CowOperation) + sizeof(CowBlockIndexEntry));
 }
 
 bool CowWriter::GetDataPos(uint64_t* pos) {
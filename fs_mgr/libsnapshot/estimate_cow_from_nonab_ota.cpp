@@ -18,11 +18,16 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <atomic>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include <android-base/file.h>
 #include <android-base/logging.h>
@@ -37,6 +42,7 @@
 DEFINE_string(source_tf, "", "Source target files (dir or zip file)");
 DEFINE_string(ota_tf, "", "Target files of the build for an OTA");
 DEFINE_string(compression, "gz", "Compression (options: none, gz, brotli)");
+DEFINE_int32(jobs, 0, "Number of partitions to analyze in parallel (0 = number of cores)");
 
 namespace android {
 namespace snapshot {
@@ -222,6 +228,11 @@ class NonAbEstimator final {
     std::string source_tf_path_;
     std::unique_ptr<TargetFilesPackage> ota_tf_;
     std::unique_ptr<TargetFilesPackage> source_tf_;
+
+    // Serializes access to the packages; zip extraction is not thread-safe.
+    std::mutex package_mutex_;
+    std::mutex size_mutex_;
+    std::map<std::string, uint64_t> partition_sizes_;
     uint64_t size_ = 0;
 };
 
@@ -230,15 +241,46 @@ bool NonAbEstimator::Run() {
         return false;
     }
 
-    auto partitions = ota_tf_->GetDynamicPartitionNames();
-    if (partitions.empty()) {
+    auto partition_set = ota_tf_->GetDynamicPartitionNames();
+    if (partition_set.empty()) {
         LOG(ERROR) << "No dynamic partitions found in META/misc_info.txt";
         return false;
     }
-    for (const auto& partition : partitions) {
-        if (!AnalyzePartition(partition)) {
-            return false;
+    std::vector<std::string> partitions(partition_set.begin(), partition_set.end());
+
+    size_t num_threads = FLAGS_jobs > 0 ? FLAGS_jobs : std::thread::hardware_concurrency();
+    num_threads = std::max<size_t>(1, std::min(num_threads, partitions.size()));
+
+    // Partitions are analyzed in parallel: each has its own CowWriter and image
+    // descriptors, so the only shared state is the packages and the size tally.
+    std::atomic<size_t> next_partition{0};
+    std::atomic<bool> ok{true};
+    auto worker = [&]() {
+        while (ok.load()) {
+            size_t index = next_partition.fetch_add(1);
+            if (index >= partitions.size()) {
+                break;
+            }
+            if (!AnalyzePartition(partitions[index])) {
+                ok = false;
+            }
         }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < num_threads; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    if (!ok) {
+        return false;
+    }
+
+    for (const auto& [partition, size] : partition_sizes_) {
+        std::cout << "Estimated COW size for " << partition << ": " << size << "\n";
     }
 
     int64_t size_in_mb = int64_t(double(size_) / 1024.0 / 1024.0);
@@ -272,18 +314,27 @@ static std::string SHA256(const std::string& input) {
 
 bool NonAbEstimator::AnalyzePartition(const std::string& partition_name) {
     auto path = "IMAGES/" + partition_name + ".img";
-    auto fd = ota_tf_->OpenImage(path);
-    if (fd < 0) {
-        return false;
-    }
 
+    unique_fd fd;
     unique_fd source_fd;
+    bool source_is_dynamic = false;
+    {
+        // Unpack images one partition at a time; everything after this only
+        // reads private descriptors.
+        std::lock_guard<std::mutex> lock(package_mutex_);
+        fd = ota_tf_->OpenImage(path);
+        if (fd < 0) {
+            return false;
+        }
+        if (source_tf_) {
+            source_is_dynamic = source_tf_->GetDynamicPartitionNames().count(partition_name) > 0;
+            source_fd = source_tf_->OpenImage(path);
+        }
+    }
+
     uint64_t source_size = 0;
     std::unordered_map<std::string, uint64_t> source_blocks;
     if (source_tf_) {
-        auto dap = source_tf_->GetDynamicPartitionNames();
-
-        source_fd = source_tf_->OpenImage(path);
         if (source_fd >= 0) {
             struct stat s;
             if (fstat(source_fd.get(), &s)) {
@@ -300,7 +351,7 @@ bool NonAbEstimator::AnalyzePartition(const std::string& partition_name) {
                 return false;
             }
         } else {
-            if (dap.count(partition_name)) {
+            if (source_is_dynamic) {
                 return false;
             }
             LOG(ERROR) << "Warning: " << partition_name
@@ -330,6 +381,7 @@ bool NonAbEstimator::AnalyzePartition(const std::string& partition_name) {
     std::string chunk(kBlockSize, '\0');
     std::string src_chunk(kBlockSize, '\0');
     uint64_t next_block_number = 0;
+    errno = 0;
     while (true) {
         if (!android::base::ReadFully(fd, chunk.data(), chunk.size())) {
             if (errno) {
@@ -385,7 +437,9 @@ bool NonAbEstimator::AnalyzePartition(const std::string& partition_name) {
         return false;
     }
 
+    std::lock_guard<std::mutex> lock(size_mutex_);
     size_ += s.st_size;
+    partition_sizes_[partition_name] = s.st_size;
     return true;
 }
 
@@ -394,6 +448,7 @@ std::unordered_map<std::string, uint64_t> NonAbEstimator::GetBlockMap(borrowed_f
 
     std::unordered_map<std::string, uint64_t> block_map;
     uint64_t block_number = 0;
+    errno = 0;
     while (true) {
         if (!android::base::ReadFully(fd, chunk.data(), chunk.size())) {
             if (errno) {
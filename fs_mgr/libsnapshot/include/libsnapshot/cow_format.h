@@ -21,7 +21,7 @@ namespace snapshot {
 
 static constexpr uint64_t kCowMagicNumber = 0x436f77634f572121ULL;
 static constexpr uint32_t kCowVersionMajor = 1;
-static constexpr uint32_t kCowVersionMinor = 0;
+static constexpr uint32_t kCowVersionMinor = 1;
 
 // This header appears as the first sequence of bytes in the COW. All fields
 // in the layout are little-endian encoded. The on-disk layout is:
@@ -33,6 +33,8 @@ static constexpr uint32_t kCowVersionMinor = 0;
 //      +-----------------------+
 //      | Operations (variable) |
 //      +-----------------------+
+//      | Block index (variable)|
+//      +-----------------------+
 //
 // The "raw data" occurs immediately after the header, and the operation
 // sequence occurs after the raw data. This ordering is intentional. While
@@ -40,6 +42,10 @@ static constexpr uint32_t kCowVersionMinor = 0;
 // metadata in memory. At the end, we can simply append the metadata and flush
 // the file. There is no need to create separate files to store the metadata
 // and block data.
+//
+// The block index contains one entry per operation, sorted by block number,
+// so that a reader can binary search for the operation affecting a block
+// without materializing the operation sequence in memory.
 struct CowHeader {
     uint64_t magic;
     uint16_t major_version;
@@ -55,6 +61,9 @@ struct CowHeader {
     uint64_t ops_size;
     uint64_t num_ops;
 
+    // Size of the block index, which begins at |ops_offset| + |ops_size|.
+    uint64_t index_size;
+
     // The size of block operations, in bytes.
     uint32_t block_size;
 
@@ -95,6 +104,14 @@ struct CowOperation {
     uint64_t source;
 } __attribute__((packed));
 
+// One entry in the block index. Entries are sorted by block number, then by
+// operation index, so the last matching entry for a block is the operation
+// that takes effect.
+struct CowBlockIndexEntry {
+    uint64_t new_block;
+    uint64_t op_index;
+} __attribute__((packed));
+
 static constexpr uint8_t kCowCopyOp = 1;
 static constexpr uint8_t kCowReplaceOp = 2;
 static constexpr uint8_t kCowZeroOp = 3;
@@ -102,6 +119,7 @@ static constexpr uint8_t kCowZeroOp = 3;
 static constexpr uint8_t kCowCompressNone = 0;
 static constexpr uint8_t kCowCompressGz = 1;
 static constexpr uint8_t kCowCompressBrotli = 2;
+static constexpr uint8_t kCowCompressLz4 = 3;
 
 }  // namespace snapshot
 }  // namespace android
@@ -84,25 +84,44 @@ class ICowOpIter {
 class CowReader : public ICowReader {
   public:
     CowReader();
+    ~CowReader() override;
 
     bool Parse(android::base::unique_fd&& fd);
     bool Parse(android::base::borrowed_fd fd);
 
     bool GetHeader(CowHeader* header) override;
 
-    // Create a CowOpIter object which contains header_.num_ops
-    // CowOperation objects. Get() returns a unique CowOperation object
-    // whose lifeteime depends on the CowOpIter object
+    // Create a CowOpIter object which iterates over header_.num_ops
+    // CowOperation objects. The operations are served from a file-backed
+    // mapping shared with this reader, so they remain valid for the
+    // lifetime of the CowReader rather than the iterator.
     std::unique_ptr<ICowOpIter> GetOpIter() override;
     bool ReadData(const CowOperation& op, IByteSink* sink) override;
 
+    // Find the last operation affecting |new_block| via binary search over
+    // the on-disk block index, without materializing the operation sequence.
+    // Returns null if no operation touches the block, or on error. The
+    // returned pointer is valid for the lifetime of the CowReader.
+    const CowOperation* FindOp(uint64_t new_block);
+
     bool GetRawBytes(uint64_t offset, void* buffer, size_t len, size_t* read);
 
   private:
+    // Map (or read, if mapping fails) the operation sequence and block
+    // index, and verify the ops checksum. Idempotent.
+    bool LoadTail();
+
     android::base::unique_fd owned_fd_;
     android::base::borrowed_fd fd_;
     CowHeader header_;
     uint64_t fd_size_;
+
+    void* tail_map_ = nullptr;
+    size_t tail_map_size_ = 0;
+    std::unique_ptr<uint8_t[]> tail_buffer_;
+    const uint8_t* ops_base_ = nullptr;
+    const CowBlockIndexEntry* index_ = nullptr;
+    size_t index_entries_ = 0;
 };
 
 }  // namespace snapshot
@@ -16,8 +16,12 @@
 
 #include <stdint.h>
 
+#include <condition_variable>
+#include <mutex>
 #include <optional>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <android-base/unique_fd.h>
 #include <libsnapshot/cow_format.h>
@@ -79,6 +83,7 @@ class CowWriter : public ICowWriter {
     enum class OpenMode { WRITE, APPEND };
 
     explicit CowWriter(const CowOptions& options);
+    ~CowWriter() override;
 
     // Set up the writer.
     bool Initialize(android::base::unique_fd&& fd, OpenMode mode = OpenMode::WRITE);
@@ -102,6 +107,15 @@ class CowWriter : public ICowWriter {
     bool WriteRawData(const void* data, size_t size);
     void AddOperation(const CowOperation& op);
     std::basic_string<uint8_t> Compress(const void* data, size_t length);
+    std::vector<CowBlockIndexEntry> BuildBlockIndex() const;
+
+    // Compress |num_blocks| consecutive blocks from |data| into |out|, using
+    // the worker pool if one was started. Results are in block order.
+    bool CompressBlocks(const void* data, size_t num_blocks,
+                        std::vector<std::basic_string<uint8_t>>* out);
+    void StartCompressionThreads();
+    void StopCompressionThreads();
+    void CompressionThread();
 
   private:
     android::base::unique_fd owned_fd_;
@@ -109,6 +123,20 @@ class CowWriter : public ICowWriter {
     CowHeader header_{};
     int compression_ = 0;
 
+    // Worker pool for compressing raw blocks off the emitting thread. The
+    // fields below describe the batch currently being compressed, and are
+    // guarded by |compress_lock_|.
+    std::vector<std::thread> compress_threads_;
+    std::mutex compress_lock_;
+    std::condition_variable compress_cv_;
+    const uint8_t* compress_data_ = nullptr;
+    size_t compress_num_blocks_ = 0;
+    size_t compress_next_block_ = 0;
+    size_t compress_blocks_done_ = 0;
+    std::vector<std::basic_string<uint8_t>>* compress_results_ = nullptr;
+    bool compress_failed_ = false;
+    bool compress_exit_ = false;
+
     // :TODO: this is not efficient, but stringstream ubsan aborts because some
     // bytes overflow a signed char.
     std::basic_string<uint8_t> ops_;
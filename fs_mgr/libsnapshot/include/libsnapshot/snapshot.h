@@ -508,6 +508,10 @@ class SnapshotManager final : public ISnapshotManager {
     UpdateState CheckMergeState(LockedFile* lock, const std::function<bool()>& before_cancel);
     UpdateState CheckTargetMergeState(LockedFile* lock, const std::string& name);
 
+    // Record merge progress observed between successive polls of |name|, so
+    // that per-partition throughput is exported via ISnapshotMergeStats.
+    void UpdateMergeThroughput(const std::string& name, const DmTargetSnapshot::Status& status);
+
     // Interact with status files under /metadata/ota/snapshots.
     bool WriteSnapshotStatus(LockedFile* lock, const SnapshotStatus& status);
     bool ReadSnapshotStatus(LockedFile* lock, const std::string& name, SnapshotStatus* status);
@@ -639,6 +643,14 @@ class SnapshotManager final : public ISnapshotManager {
     std::unique_ptr<IImageManager> images_;
     bool has_local_image_manager_ = false;
     bool in_factory_data_reset_ = false;
+
+    // Last observed merge progress of each snapshot, used to compute the
+    // throughput between successive polls within this process.
+    struct MergeObservation {
+        uint64_t sectors_allocated;
+        std::chrono::steady_clock::time_point time;
+    };
+    std::map<std::string, MergeObservation> merge_observations_;
 };
 
 }  // namespace snapshot
@@ -16,6 +16,7 @@
 
 #include <chrono>
 #include <memory>
+#include <string>
 
 #include <android/snapshot/snapshot.pb.h>
 #include <libsnapshot/snapshot.h>
@@ -32,6 +33,11 @@ class ISnapshotMergeStats {
     virtual void set_cow_file_size(uint64_t cow_file_size) = 0;
     virtual uint64_t cow_file_size() = 0;
 
+    // Record that |sectors_merged| sectors of |partition_name| merged over
+    // |total_time|. Accumulates across calls for the same partition.
+    virtual void RecordMergeThroughput(const std::string& partition_name, uint64_t sectors_merged,
+                                       std::chrono::milliseconds total_time) = 0;
+
     // Called when merge ends. Properly clean up permanent storage.
     class Result {
       public:
@@ -54,6 +60,8 @@ class SnapshotMergeStats : public ISnapshotMergeStats {
     void set_state(android::snapshot::UpdateState state) override;
     void set_cow_file_size(uint64_t cow_file_size) override;
     uint64_t cow_file_size() override;
+    void RecordMergeThroughput(const std::string& partition_name, uint64_t sectors_merged,
+                               std::chrono::milliseconds total_time) override;
     std::unique_ptr<Result> Finish() override;
 
   private:
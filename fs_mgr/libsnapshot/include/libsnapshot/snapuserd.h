@@ -22,8 +22,10 @@
 #include <cstring>
 #include <iostream>
 #include <limits>
+#include <list>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include <android-base/file.h>
@@ -58,6 +60,57 @@ class BufferSink : public IByteSink {
     size_t buffer_size_;
 };
 
+// IByteSink that decompresses one block into a caller-provided buffer,
+// typically an entry of the block cache below.
+class CacheSink final : public IByteSink {
+  public:
+    void SetBuffer(uint8_t* buffer, size_t size) {
+        buffer_ = buffer;
+        buffer_size_ = size;
+    }
+    void* GetBuffer(size_t requested, size_t* actual) override {
+        if (!buffer_ || requested > buffer_size_) {
+            *actual = 0;
+            return nullptr;
+        }
+        *actual = requested;
+        return buffer_;
+    }
+    bool ReturnData(void*, size_t) override { return true; }
+
+  private:
+    uint8_t* buffer_ = nullptr;
+    size_t buffer_size_ = 0;
+};
+
+// Fixed-capacity LRU cache of decompressed COW blocks, keyed by chunk ID.
+// Readahead fills it so that the remaining requests of a sequential stream
+// are served from memory instead of with one read+decompress each.
+class BlockCache {
+  public:
+    explicit BlockCache(size_t capacity) : capacity_(capacity) {}
+
+    // Return the cached block data, or null. A hit refreshes the entry.
+    uint8_t* Get(chunk_t chunk);
+
+    // Return a writable block-sized buffer for |chunk|, evicting the least
+    // recently used entry if the cache is full.
+    uint8_t* Insert(chunk_t chunk);
+
+    // Drop the entry for |chunk|, eg if filling it failed part-way.
+    void Remove(chunk_t chunk);
+
+  private:
+    struct Entry {
+        chunk_t chunk;
+        std::unique_ptr<uint8_t[]> data;
+    };
+
+    size_t capacity_;
+    std::list<Entry> entries_;
+    std::unordered_map<chunk_t, std::list<Entry>::iterator> index_;
+};
+
 class Snapuserd final {
   public:
     Snapuserd(const std::string& in_cow_device, const std::string& in_backing_store_device,
@@ -80,9 +133,10 @@ class Snapuserd final {
     std::string GetControlDevicePath() { return control_device_; }
 
   private:
-    int ProcessReplaceOp(const CowOperation* cow_op);
+    int ProcessReplaceOp(const CowOperation* cow_op, chunk_t chunk_key);
     int ProcessCopyOp(const CowOperation* cow_op);
     int ProcessZeroOp();
+    void ReadAhead(chunk_t chunk_key);
 
     std::string cow_device_;
     std::string backing_store_device_;
@@ -105,8 +159,15 @@ class Snapuserd final {
     // Value - cow operation
     std::vector<const CowOperation*> chunk_vec_;
 
+    // Cache up to 128 decompressed blocks (512k) and read ahead by up to
+    // 32 chunks (128k) of compressed data at a time.
+    static constexpr size_t kBlockCacheCapacity = 128;
+    static constexpr size_t kReadAheadChunks = 32;
+
     bool metadata_read_done_;
     BufferSink bufsink_;
+    BlockCache block_cache_{kBlockCacheCapacity};
+    CacheSink cachesink_;
 };
 
 }  // namespace snapshot
@@ -21,10 +21,15 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <atomic>
 #include <iostream>
 #include <limits>
+#include <map>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_set>
+#include <vector>
 
 #include <android-base/file.h>
 #include <android-base/logging.h>
@@ -53,6 +58,7 @@ static constexpr uint64_t kBlockSize = 4096;
 
 DEFINE_string(source_tf, "", "Source target files (dir or zip file) for incremental payloads");
 DEFINE_string(compression, "gz", "Compression type to use (none or gz)");
+DEFINE_int32(jobs, 0, "Number of partitions to convert in parallel (0 = number of cores)");
 
 void MyLogger(android::base::LogId, android::base::LogSeverity severity, const char*, const char*,
               unsigned int, const char* message) {
@@ -84,15 +90,23 @@ class PayloadConverter final {
     bool Run();
 
   private:
+    // Per-partition conversion state. Partitions are converted in parallel, so
+    // everything a worker mutates lives here rather than on the converter.
+    struct PartitionContext {
+        std::string partition_name;
+        std::unique_ptr<CowWriter> writer;
+        unique_fd source_image;
+    };
+
     bool OpenPayload();
     bool OpenSourceTargetFiles();
     bool ProcessPartition(const PartitionUpdate& update);
-    bool ProcessOperation(const InstallOperation& op);
-    bool ProcessZero(const InstallOperation& op);
-    bool ProcessCopy(const InstallOperation& op);
-    bool ProcessReplace(const InstallOperation& op);
-    bool ProcessDiff(const InstallOperation& op);
-    borrowed_fd OpenSourceImage();
+    bool ProcessOperation(PartitionContext* ctx, const InstallOperation& op);
+    bool ProcessZero(PartitionContext* ctx, const InstallOperation& op);
+    bool ProcessCopy(PartitionContext* ctx, const InstallOperation& op);
+    bool ProcessReplace(PartitionContext* ctx, const InstallOperation& op);
+    bool ProcessDiff(PartitionContext* ctx, const InstallOperation& op);
+    borrowed_fd OpenSourceImage(PartitionContext* ctx);
 
     std::string in_file_;
     std::string out_dir_;
@@ -103,10 +117,10 @@ class PayloadConverter final {
     unique_fd source_tf_fd_;
     std::unique_ptr<ZipArchive, decltype(&CloseArchive)> source_tf_zip_;
 
-    // Updated during ProcessPartition().
-    std::string partition_name_;
-    std::unique_ptr<CowWriter> writer_;
-    unique_fd source_image_;
+    // Serializes source image extraction; zip extraction is not thread-safe.
+    std::mutex source_tf_mutex_;
+    std::mutex summary_mutex_;
+    std::map<std::string, uint64_t> cow_sizes_;
 };
 
 bool PayloadConverter::Run() {
@@ -132,13 +146,45 @@ bool PayloadConverter::Run() {
         return false;
     }
 
-    for (const auto& update : manifest_.partitions()) {
-        if (!ProcessPartition(update)) {
-            return false;
+    size_t num_partitions = manifest_.partitions().size();
+    size_t num_threads = FLAGS_jobs > 0 ? FLAGS_jobs : std::thread::hardware_concurrency();
+    num_threads = std::max<size_t>(1, std::min(num_threads, num_partitions));
+
+    // Partitions are converted in parallel: each has its own CowWriter and
+    // source image, and payload reads use pread, so the only serialized step
+    // is extracting source images from the target files package.
+    std::atomic<size_t> next_partition{0};
+    std::atomic<bool> ok{true};
+    auto worker = [&]() {
+        while (ok.load()) {
+            size_t index = next_partition.fetch_add(1);
+            if (index >= num_partitions) {
+                break;
+            }
+            if (!ProcessPartition(manifest_.partitions(index))) {
+                ok = false;
+            }
         }
-        writer_ = nullptr;
-        source_image_.reset();
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < num_threads; i++) {
+        threads.emplace_back(worker);
     }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    if (!ok) {
+        return false;
+    }
+
+    uint64_t total_size = 0;
+    for (const auto& [partition, size] : cow_sizes_) {
+        std::cout << partition << ".cow: " << size << " bytes\n";
+        total_size += size;
+    }
+    std::cout << "Total COW size: " << total_size << " bytes\n";
     return true;
 }
 
@@ -190,40 +236,49 @@ bool PayloadConverter::ProcessPartition(const PartitionUpdate& update) {
     options.block_size = kBlockSize;
     options.compression = FLAGS_compression;
 
-    writer_ = std::make_unique<CowWriter>(options);
-    if (!writer_->Initialize(std::move(fd))) {
+    PartitionContext ctx;
+    ctx.partition_name = partition_name;
+    ctx.writer = std::make_unique<CowWriter>(options);
+    if (!ctx.writer->Initialize(std::move(fd))) {
         LOG(ERROR) << "Unable to initialize COW writer";
         return false;
     }
 
-    partition_name_ = partition_name;
-
     for (const auto& op : update.operations()) {
-        if (!ProcessOperation(op)) {
+        if (!ProcessOperation(&ctx, op)) {
             return false;
         }
     }
 
-    if (!writer_->Flush()) {
+    if (!ctx.writer->Flush()) {
         LOG(ERROR) << "Unable to finalize COW for " << partition_name;
         return false;
     }
+
+    struct stat s;
+    if (stat(path.c_str(), &s) < 0) {
+        PLOG(ERROR) << "stat failed: " << path;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(summary_mutex_);
+    cow_sizes_[partition_name] = s.st_size;
     return true;
 }
 
-bool PayloadConverter::ProcessOperation(const InstallOperation& op) {
+bool PayloadConverter::ProcessOperation(PartitionContext* ctx, const InstallOperation& op) {
     switch (op.type()) {
         case InstallOperation::SOURCE_COPY:
-            return ProcessCopy(op);
+            return ProcessCopy(ctx, op);
         case InstallOperation::BROTLI_BSDIFF:
         case InstallOperation::PUFFDIFF:
-            return ProcessDiff(op);
+            return ProcessDiff(ctx, op);
         case InstallOperation::REPLACE:
         case InstallOperation::REPLACE_XZ:
         case InstallOperation::REPLACE_BZ:
-            return ProcessReplace(op);
+            return ProcessReplace(ctx, op);
         case InstallOperation::ZERO:
-            return ProcessZero(op);
+            return ProcessZero(ctx, op);
         default:
             LOG(ERROR) << "Unsupported op: " << (int)op.type();
             return false;
@@ -231,9 +286,9 @@ bool PayloadConverter::ProcessOperation(const InstallOperation& op) {
     return true;
 }
 
-bool PayloadConverter::ProcessZero(const InstallOperation& op) {
+bool PayloadConverter::ProcessZero(PartitionContext* ctx, const InstallOperation& op) {
     for (const auto& extent : op.dst_extents()) {
-        if (!writer_->AddZeroBlocks(extent.start_block(), extent.num_blocks())) {
+        if (!ctx->writer->AddZeroBlocks(extent.start_block(), extent.num_blocks())) {
             LOG(ERROR) << "Could not add zero operation";
             return false;
         }
@@ -325,8 +380,8 @@ class PuffOutputStream final : public puffin::StreamInterface {
     size_t pos_;
 };
 
-bool PayloadConverter::ProcessDiff(const InstallOperation& op) {
-    auto source_image = OpenSourceImage();
+bool PayloadConverter::ProcessDiff(PartitionContext* ctx, const InstallOperation& op) {
+    auto source_image = OpenSourceImage(ctx);
     if (source_image < 0) {
         return false;
     }
@@ -338,14 +393,9 @@ bool PayloadConverter::ProcessDiff(const InstallOperation& op) {
     // Read source bytes.
     for (const auto& extent : op.src_extents()) {
         uint64_t offset = extent.start_block() * kBlockSize;
-        if (lseek(source_image.get(), offset, SEEK_SET) < 0) {
-            PLOG(ERROR) << "lseek source image failed";
-            return false;
-        }
-
         uint64_t size = extent.num_blocks() * kBlockSize;
         CHECK(src_length - src_pos >= size);
-        if (!android::base::ReadFully(source_image, src.get() + src_pos, size)) {
+        if (!android::base::ReadFullyAtOffset(source_image, src.get() + src_pos, size, offset)) {
             PLOG(ERROR) << "read source image failed";
             return false;
         }
@@ -353,13 +403,11 @@ bool PayloadConverter::ProcessDiff(const InstallOperation& op) {
     }
     CHECK(src_pos == src_length);
 
-    // Read patch bytes.
+    // Read patch bytes. The payload fd is shared between the partition workers,
+    // so reads must not move its file offset.
     auto patch = std::make_unique<uint8_t[]>(op.data_length());
-    if (lseek(in_fd_.get(), payload_offset_ + op.data_offset(), SEEK_SET) < 0) {
-        PLOG(ERROR) << "lseek payload failed";
-        return false;
-    }
-    if (!android::base::ReadFully(in_fd_, patch.get(), op.data_length())) {
+    if (!android::base::ReadFullyAtOffset(in_fd_, patch.get(), op.data_length(),
+                                          payload_offset_ + op.data_offset())) {
         PLOG(ERROR) << "read payload failed";
         return false;
     }
@@ -399,7 +447,7 @@ bool PayloadConverter::ProcessDiff(const InstallOperation& op) {
         uint64_t size = extent.num_blocks() * kBlockSize;
         CHECK(dest.size() - dest_pos >= size);
 
-        if (!writer_->AddRawBlocks(extent.start_block(), &dest[dest_pos], size)) {
+        if (!ctx->writer->AddRawBlocks(extent.start_block(), &dest[dest_pos], size)) {
             return false;
         }
         dest_pos += size;
@@ -407,14 +455,18 @@ bool PayloadConverter::ProcessDiff(const InstallOperation& op) {
     return true;
 }
 
-borrowed_fd PayloadConverter::OpenSourceImage() {
-    if (source_image_ >= 0) {
-        return source_image_;
+borrowed_fd PayloadConverter::OpenSourceImage(PartitionContext* ctx) {
+    if (ctx->source_image >= 0) {
+        return ctx->source_image;
     }
 
+    // Extract one source image at a time; the resulting descriptor is private
+    // to this partition's worker.
+    std::lock_guard<std::mutex> lock(source_tf_mutex_);
+
     unique_fd unzip_fd;
 
-    auto local_path = "IMAGES/" + partition_name_ + ".img";
+    auto local_path = "IMAGES/" + ctx->partition_name + ".img";
     if (source_tf_zip_) {
         {
             TemporaryFile tmp;
@@ -461,11 +513,11 @@ borrowed_fd PayloadConverter::OpenSourceImage() {
             LOG(ERROR) << "sparse_file_write failed";
             return -1;
         }
-        source_image_.reset(tmp.release());
+        ctx->source_image.reset(tmp.release());
     } else {
-        source_image_ = std::move(unzip_fd);
+        ctx->source_image = std::move(unzip_fd);
     }
-    return source_image_;
+    return ctx->source_image;
 }
 
 template <typename ContainerType>
@@ -496,7 +548,7 @@ class ExtentIter final {
     uint64_t dst_index_;
 };
 
-bool PayloadConverter::ProcessCopy(const InstallOperation& op) {
+bool PayloadConverter::ProcessCopy(PartitionContext* ctx, const InstallOperation& op) {
     ExtentIter dst_blocks(op.dst_extents());
 
     for (const auto& extent : op.src_extents()) {
@@ -508,7 +560,7 @@ bool PayloadConverter::ProcessCopy(const InstallOperation& op) {
                 return false;
             }
             if (src_block == dst_block) continue;
-            if (!writer_->AddCopy(dst_block, src_block)) {
+            if (!ctx->writer->AddCopy(dst_block, src_block)) {
                 LOG(ERROR) << "Could not add copy operation";
                 return false;
             }
@@ -517,15 +569,11 @@ bool PayloadConverter::ProcessCopy(const InstallOperation& op) {
     return true;
 }
 
-bool PayloadConverter::ProcessReplace(const InstallOperation& op) {
+bool PayloadConverter::ProcessReplace(PartitionContext* ctx, const InstallOperation& op) {
     auto buffer_size = op.data_length();
     auto buffer = std::make_unique<char[]>(buffer_size);
     uint64_t offs = payload_offset_ + op.data_offset();
-    if (lseek(in_fd_.get(), offs, SEEK_SET) < 0) {
-        PLOG(ERROR) << "lseek " << offs << " failed";
-        return false;
-    }
-    if (!android::base::ReadFully(in_fd_, buffer.get(), buffer_size)) {
+    if (!android::base::ReadFullyAtOffset(in_fd_, buffer.get(), buffer_size, offs)) {
         PLOG(ERROR) << "read " << buffer_size << " bytes from offset " << offs << "failed";
         return false;
     }
@@ -598,7 +646,8 @@ bool PayloadConverter::ProcessReplace(const InstallOperation& op) {
             LOG(ERROR) << "replace op ran out of input buffer";
             return false;
         }
-        if (!writer_->AddRawBlocks(extent.start_block(), buffer.get() + buffer_pos, extent_size)) {
+        if (!ctx->writer->AddRawBlocks(extent.start_block(), buffer.get() + buffer_pos,
+                                       extent_size)) {
             LOG(ERROR) << "failed to add raw blocks from replace op";
             return false;
         }
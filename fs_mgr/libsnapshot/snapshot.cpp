@@ -1000,9 +1000,14 @@ UpdateState SnapshotManager::CheckTargetMergeState(LockedFile* lock, const std::
             LOG(ERROR) << "Snapshot " << name << " is merging after being marked merge-complete.";
             return UpdateState::MergeFailed;
         }
+        UpdateMergeThroughput(name, status);
         return UpdateState::Merging;
     }
 
+    // Record the final tranche of progress for this partition.
+    UpdateMergeThroughput(name, status);
+    merge_observations_.erase(name);
+
     // Merging is done. First, update the status file to indicate the merge
     // is complete. We do this before calling OnSnapshotMergeComplete, even
     // though this means the write is potentially wasted work (since in the
@@ -1021,6 +1026,24 @@ UpdateState SnapshotManager::CheckTargetMergeState(LockedFile* lock, const std::
     return UpdateState::MergeCompleted;
 }
 
+void SnapshotManager::UpdateMergeThroughput(const std::string& name,
+                                            const DmTargetSnapshot::Status& status) {
+    // The kernel merges all partitions concurrently once their tables have
+    // been switched to snapshot-merge targets; here we just watch how fast
+    // each one is draining. |sectors_allocated| counts down towards
+    // |metadata_sectors| as chunks merge.
+    auto now = std::chrono::steady_clock::now();
+    auto iter = merge_observations_.find(name);
+    if (iter != merge_observations_.end() &&
+        status.sectors_allocated < iter->second.sectors_allocated) {
+        uint64_t merged = iter->second.sectors_allocated - status.sectors_allocated;
+        auto elapsed =
+                std::chrono::duration_cast<std::chrono::milliseconds>(now - iter->second.time);
+        GetSnapshotMergeStatsInstance()->RecordMergeThroughput(name, merged, elapsed);
+    }
+    merge_observations_[name] = {status.sectors_allocated, now};
+}
+
 std::string SnapshotManager::GetSnapshotBootIndicatorPath() {
     return metadata_dir_ + "/" + android::base::Basename(kBootIndicatorPath);
 }
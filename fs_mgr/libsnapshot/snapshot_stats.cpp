@@ -97,6 +97,28 @@ uint64_t SnapshotMergeStats::cow_file_size() {
     return report_.cow_file_size();
 }
 
+void SnapshotMergeStats::RecordMergeThroughput(const std::string& partition_name,
+                                               uint64_t sectors_merged,
+                                               std::chrono::milliseconds total_time) {
+    SnapshotMergeThroughput* entry = nullptr;
+    for (auto& throughput : *report_.mutable_merge_throughput()) {
+        if (throughput.name() == partition_name) {
+            entry = &throughput;
+            break;
+        }
+    }
+    if (!entry) {
+        entry = report_.add_merge_throughput();
+        entry->set_name(partition_name);
+    }
+    entry->set_sectors_merged(entry->sectors_merged() + sectors_merged);
+    entry->set_total_time_ms(entry->total_time_ms() + total_time.count());
+
+    // This is called on every merge poll, so don't flush to disk here; the
+    // data is telemetry and losing it on a crash is acceptable. It is
+    // persisted by the next WriteState() and reported at Finish().
+}
+
 class SnapshotMergeStatsResultImpl : public SnapshotMergeStats::Result {
   public:
     SnapshotMergeStatsResultImpl(const SnapshotMergeReport& report,
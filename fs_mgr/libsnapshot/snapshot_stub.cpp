@@ -121,6 +121,7 @@ class SnapshotMergeStatsStub : public ISnapshotMergeStats {
     void set_state(android::snapshot::UpdateState) override {}
     void set_cow_file_size(uint64_t) override {}
     uint64_t cow_file_size() override { return 0; }
+    void RecordMergeThroughput(const std::string&, uint64_t, std::chrono::milliseconds) override {}
     std::unique_ptr<Result> Finish() override { return nullptr; }
 };
 
@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include <fcntl.h>
+
 #include <csignal>
 
 #include <libsnapshot/snapuserd.h>
@@ -65,6 +67,41 @@ struct dm_user_header* BufferSink::GetHeaderPtr() {
     return header;
 }
 
+uint8_t* BlockCache::Get(chunk_t chunk) {
+    auto iter = index_.find(chunk);
+    if (iter == index_.end()) {
+        return nullptr;
+    }
+    entries_.splice(entries_.begin(), entries_, iter->second);
+    return iter->second->data.get();
+}
+
+uint8_t* BlockCache::Insert(chunk_t chunk) {
+    if (uint8_t* data = Get(chunk)) {
+        return data;
+    }
+    if (entries_.size() >= capacity_) {
+        // Evict the least recently used entry, re-using its buffer.
+        auto& lru = entries_.back();
+        index_.erase(lru.chunk);
+        lru.chunk = chunk;
+        entries_.splice(entries_.begin(), entries_, std::prev(entries_.end()));
+    } else {
+        entries_.push_front({chunk, std::make_unique<uint8_t[]>(BLOCK_SIZE)});
+    }
+    index_[chunk] = entries_.begin();
+    return entries_.front().data.get();
+}
+
+void BlockCache::Remove(chunk_t chunk) {
+    auto iter = index_.find(chunk);
+    if (iter == index_.end()) {
+        return;
+    }
+    entries_.erase(iter->second);
+    index_.erase(iter);
+}
+
 // Construct kernel COW header in memory
 // This header will be in sector 0. The IO
 // request will always be 4k. After constructing
@@ -85,10 +122,73 @@ int Snapuserd::ConstructKernelCowHeader() {
     return BLOCK_SIZE;
 }
 
+/*
+ * Replace-op data is laid out in the COW in the order the operations were
+ * written, so a run of consecutive replace chunks reads a contiguous extent
+ * of the data section. Hint the kernel to fetch the whole extent
+ * asynchronously, then decompress the run into the block cache so that the
+ * remaining requests of a sequential stream are served from memory.
+ */
+void Snapuserd::ReadAhead(chunk_t chunk_key) {
+    chunk_t chunk = chunk_key;
+    size_t run = 0;
+    uint64_t start = 0;
+    uint64_t end = 0;
+
+    while (chunk < chunk_vec_.size() && run < kReadAheadChunks) {
+        const CowOperation* cow_op = chunk_vec_[chunk];
+        // A null entry is a metadata chunk, which also ends the run.
+        if (cow_op == nullptr || cow_op->type != kCowReplaceOp) {
+            break;
+        }
+        if (run == 0) {
+            start = cow_op->source;
+        }
+        end = cow_op->source + cow_op->data_length;
+        run += 1;
+        chunk += 1;
+    }
+
+    if (run == 0) {
+        return;
+    }
+
+    // Best effort; the reads below succeed either way.
+    posix_fadvise(cow_fd_.get(), start, end - start, POSIX_FADV_WILLNEED);
+
+    for (chunk = chunk_key; run > 0; chunk += 1, run -= 1) {
+        if (block_cache_.Get(chunk) != nullptr) {
+            continue;
+        }
+        uint8_t* data = block_cache_.Insert(chunk);
+        cachesink_.SetBuffer(data, BLOCK_SIZE);
+        if (!reader_->ReadData(*chunk_vec_[chunk], &cachesink_)) {
+            // Don't cache a partially filled block; the caller will retry
+            // the read inline and surface the error.
+            block_cache_.Remove(chunk);
+            break;
+        }
+    }
+}
+
 // Start the replace operation. This will read the
 // internal COW format and if the block is compressed,
 // it will be de-compressed.
-int Snapuserd::ProcessReplaceOp(const CowOperation* cow_op) {
+int Snapuserd::ProcessReplaceOp(const CowOperation* cow_op, chunk_t chunk_key) {
+    void* buffer = bufsink_.GetPayloadBuffer(BLOCK_SIZE);
+    CHECK(buffer != nullptr);
+
+    uint8_t* cached = block_cache_.Get(chunk_key);
+    if (cached == nullptr) {
+        ReadAhead(chunk_key);
+        cached = block_cache_.Get(chunk_key);
+    }
+    if (cached != nullptr) {
+        memcpy(buffer, cached, BLOCK_SIZE);
+        return BLOCK_SIZE;
+    }
+
+    // Fall back to decompressing straight into the payload buffer.
     if (!reader_->ReadData(*cow_op, &bufsink_)) {
         LOG(ERROR) << "ReadData failed for chunk: " << cow_op->new_block;
         return -EIO;
@@ -164,7 +264,7 @@ int Snapuserd::ReadData(chunk_t chunk, size_t size) {
 
         switch (cow_op->type) {
             case kCowReplaceOp: {
-                result = ProcessReplaceOp(cow_op);
+                result = ProcessReplaceOp(cow_op, chunk_key);
                 break;
             }
 
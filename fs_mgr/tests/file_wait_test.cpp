@@ -15,6 +15,7 @@
 #include <chrono>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include <android-base/file.h>
 #include <android-base/unique_fd.h>
@@ -25,6 +26,7 @@ using namespace std::literals;
 using android::base::unique_fd;
 using android::fs_mgr::WaitForFile;
 using android::fs_mgr::WaitForFileDeleted;
+using android::fs_mgr::WaitForFiles;
 
 class FileWaitTest : public ::testing::Test {
   protected:
@@ -85,6 +87,45 @@ TEST_F(FileWaitTest, DeleteAsync) {
     thread.join();
 }
 
+TEST_F(FileWaitTest, WaitForFilesAsync) {
+    std::vector<std::string> paths = {test_file_ + ".a", test_file_ + ".b", test_file_ + ".c"};
+
+    // Create in reverse order, to check that paths complete out of order.
+    std::thread thread([&paths] {
+        for (auto it = paths.rbegin(); it != paths.rend(); it++) {
+            std::this_thread::sleep_for(200ms);
+            unique_fd fd(open(it->c_str(), O_CREAT | O_TRUNC | O_RDWR, 0700));
+        }
+    });
+    EXPECT_TRUE(WaitForFiles(paths, 3s));
+    thread.join();
+
+    EXPECT_FALSE(WaitForFiles({paths[0], test_file_ + ".wontexist"}, 200ms));
+
+    for (const auto& path : paths) {
+        unlink(path.c_str());
+    }
+}
+
+TEST_F(FileWaitTest, PersistentWaiter) {
+    android::fs_mgr::FileWaiter waiter;
+
+    unique_fd fd(open(test_file_.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0700));
+    ASSERT_GE(fd, 0);
+    EXPECT_TRUE(waiter.WaitForFile(test_file_, 500ms));
+
+    // Re-use the waiter; its directory watch survives the first wait.
+    std::string other_file = test_file_ + ".other";
+    std::thread thread([&other_file] {
+        std::this_thread::sleep_for(200ms);
+        unique_fd fd(open(other_file.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0700));
+    });
+    EXPECT_TRUE(waiter.WaitForFiles({other_file}, 3s));
+    thread.join();
+
+    unlink(other_file.c_str());
+}
+
 TEST_F(FileWaitTest, BadPath) {
     ASSERT_FALSE(WaitForFile("/this/path/does/not/exist", 5ms));
     EXPECT_EQ(errno, ENOENT);
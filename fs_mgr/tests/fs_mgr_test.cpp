@@ -1011,3 +1011,46 @@ TEST(fs_mgr, UserdataMountedFromDefaultFstab) {
     ASSERT_NE(nullptr, fs_mgr_get_mounted_entry_for_userdata(&fstab, block_device))
             << "/data wasn't mounted from default fstab";
 }
+
+TEST(fs_mgr, FstabCacheRoundTrip) {
+    Fstab fstab;
+
+    FstabEntry entry;
+    entry.blk_device = "/dev/block/by-name/system";
+    entry.mount_point = "/system";
+    entry.fs_type = "ext4";
+    entry.fs_options = "barrier=1";
+    entry.flags = MS_RDONLY;
+    entry.length = 123456;
+    entry.fs_mgr_flags.wait = true;
+    entry.fs_mgr_flags.avb = true;
+    fstab.emplace_back(entry);
+
+    entry = {};
+    entry.blk_device = "none";
+    entry.mount_point = "none";
+    entry.fs_type = "swap";
+    entry.zram_size = 1073741824;
+    entry.max_comp_streams = 8;
+    fstab.emplace_back(entry);
+
+    TemporaryFile tf;
+    ASSERT_TRUE(tf.fd != -1);
+    ASSERT_TRUE(WriteFstabToCache(fstab, tf.path));
+
+    Fstab cached;
+    ASSERT_TRUE(ReadFstabFromCache(tf.path, &cached));
+    ASSERT_EQ(fstab.size(), cached.size());
+    for (size_t i = 0; i < fstab.size(); i++) {
+        EXPECT_EQ(fstab[i].blk_device, cached[i].blk_device);
+        EXPECT_EQ(fstab[i].mount_point, cached[i].mount_point);
+        EXPECT_EQ(fstab[i].fs_type, cached[i].fs_type);
+        EXPECT_EQ(fstab[i].fs_options, cached[i].fs_options);
+        EXPECT_EQ(fstab[i].flags, cached[i].flags);
+        EXPECT_EQ(fstab[i].length, cached[i].length);
+        EXPECT_EQ(fstab[i].zram_size, cached[i].zram_size);
+        EXPECT_EQ(fstab[i].max_comp_streams, cached[i].max_comp_streams);
+        EXPECT_EQ(fstab[i].fs_mgr_flags.wait, cached[i].fs_mgr_flags.wait);
+        EXPECT_EQ(fstab[i].fs_mgr_flags.avb, cached[i].fs_mgr_flags.avb);
+    }
+}
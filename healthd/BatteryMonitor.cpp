@@ -25,6 +25,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <algorithm>
@@ -92,7 +93,8 @@ BatteryMonitor::BatteryMonitor()
       mBatteryDevicePresent(false),
       mBatteryFixedCapacity(0),
       mBatteryFixedTemperature(0),
-      mHealthInfo(std::make_unique<HealthInfo_2_1>()) {
+      mHealthInfo(std::make_unique<HealthInfo_2_1>()),
+      mLastUpdateLatencyUs(0) {
     initHealthInfo(mHealthInfo.get());
 }
 
@@ -174,10 +176,38 @@ BatteryHealth getBatteryHealth(const char* status) {
     return *ret;
 }
 
-int BatteryMonitor::readFromFile(const String8& path, std::string* buf) {
-    if (android::base::ReadFileToString(path.c_str(), buf)) {
-        *buf = android::base::Trim(*buf);
+int BatteryMonitor::readFromFile(const String8& path, std::string* buf, bool useFdCache) {
+    buf->clear();
+    if (path.isEmpty()) return 0;
+
+    if (!useFdCache) {
+        if (android::base::ReadFileToString(path.c_str(), buf)) {
+            *buf = android::base::Trim(*buf);
+        }
+        return buf->length();
+    }
+
+    int fd;
+    auto it = mFdCache.find(path);
+    if (it != mFdCache.end()) {
+        fd = it->second.get();
+    } else {
+        fd = TEMP_FAILURE_RETRY(open(path.string(), O_RDONLY | O_CLOEXEC));
+        if (fd == -1) return 0;
+        mFdCache.emplace(path, android::base::unique_fd(fd));
+    }
+
+    // Sysfs attributes are at most a page; rereading from offset zero on the
+    // kept-open fd refreshes the value without an open/close pair.
+    char data[4096];
+    ssize_t size = TEMP_FAILURE_RETRY(pread(fd, data, sizeof(data), 0));
+    if (size < 0) {
+        // The supply may have gone away; reopen on the next read.
+        mFdCache.erase(path);
+        return 0;
     }
+    buf->assign(data, size);
+    *buf = android::base::Trim(*buf);
     return buf->length();
 }
 
@@ -239,10 +269,96 @@ bool BatteryMonitor::isScopedPowerSupply(const char* name) {
     String8 path;
     path.appendFormat("%s/%s/scope", POWER_SUPPLY_SYSFS_PATH, name);
     std::string scope;
-    return (readFromFile(path, &scope) > 0 && scope == kScopeDevice);
+    return (readFromFile(path, &scope, false /* useFdCache */) > 0 && scope == kScopeDevice);
 }
 
 void BatteryMonitor::updateValues(void) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // The battery's uevent file lists every property value in one read; when
+    // its content is identical to the last poll, nothing battery-side changed
+    // and the per-property reads below can be skipped. The charger supplies
+    // are not covered by this uevent, so they are re-read either way.
+    bool batteryUnchanged = false;
+    if (!mBatteryUeventPath.isEmpty()) {
+        std::string uevent;
+        if (readFromFile(mBatteryUeventPath, &uevent) > 0) {
+            if (uevent == mLastBatteryUevent) {
+                batteryUnchanged = true;
+            } else {
+                mLastBatteryUevent = std::move(uevent);
+            }
+        }
+    }
+
+    HealthInfo_1_0& props = mHealthInfo->legacy.legacy;
+
+    if (batteryUnchanged) {
+        props.chargerAcOnline = false;
+        props.chargerUsbOnline = false;
+        props.chargerWirelessOnline = false;
+        props.maxChargingCurrent = 0;
+        props.maxChargingVoltage = 0;
+    } else {
+        updateBatteryValues();
+    }
+
+    double MaxPower = 0;
+
+    for (size_t i = 0; i < mChargerNames.size(); i++) {
+        String8 path;
+        path.appendFormat("%s/%s/online", POWER_SUPPLY_SYSFS_PATH,
+                          mChargerNames[i].string());
+        if (getIntField(path)) {
+            path.clear();
+            path.appendFormat("%s/%s/type", POWER_SUPPLY_SYSFS_PATH,
+                              mChargerNames[i].string());
+            switch(readPowerSupplyType(path)) {
+            case ANDROID_POWER_SUPPLY_TYPE_AC:
+                props.chargerAcOnline = true;
+                break;
+            case ANDROID_POWER_SUPPLY_TYPE_USB:
+                props.chargerUsbOnline = true;
+                break;
+            case ANDROID_POWER_SUPPLY_TYPE_WIRELESS:
+                props.chargerWirelessOnline = true;
+                break;
+            default:
+                KLOG_WARNING(LOG_TAG, "%s: Unknown power supply type\n",
+                             mChargerNames[i].string());
+            }
+            path.clear();
+            path.appendFormat("%s/%s/current_max", POWER_SUPPLY_SYSFS_PATH,
+                              mChargerNames[i].string());
+            int ChargingCurrent =
+                    (access(path.string(), R_OK) == 0) ? getIntField(path) : 0;
+
+            path.clear();
+            path.appendFormat("%s/%s/voltage_max", POWER_SUPPLY_SYSFS_PATH,
+                              mChargerNames[i].string());
+
+            int ChargingVoltage =
+                (access(path.string(), R_OK) == 0) ? getIntField(path) :
+                DEFAULT_VBUS_VOLTAGE;
+
+            double power = ((double)ChargingCurrent / MILLION) *
+                           ((double)ChargingVoltage / MILLION);
+            if (MaxPower < power) {
+                props.maxChargingCurrent = ChargingCurrent;
+                props.maxChargingVoltage = ChargingVoltage;
+                MaxPower = power;
+            }
+        }
+    }
+
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    mLastUpdateLatencyUs = (end.tv_sec - start.tv_sec) * 1000000 +
+                           (end.tv_nsec - start.tv_nsec) / 1000;
+}
+
+void BatteryMonitor::updateBatteryValues(void) {
     initHealthInfo(mHealthInfo.get());
 
     HealthInfo_1_0& props = mHealthInfo->legacy.legacy;
@@ -298,54 +414,6 @@ void BatteryMonitor::updateValues(void) {
 
     if (readFromFile(mHealthdConfig->batteryTechnologyPath, &buf) > 0)
         props.batteryTechnology = String8(buf.c_str());
-
-    double MaxPower = 0;
-
-    for (size_t i = 0; i < mChargerNames.size(); i++) {
-        String8 path;
-        path.appendFormat("%s/%s/online", POWER_SUPPLY_SYSFS_PATH,
-                          mChargerNames[i].string());
-        if (getIntField(path)) {
-            path.clear();
-            path.appendFormat("%s/%s/type", POWER_SUPPLY_SYSFS_PATH,
-                              mChargerNames[i].string());
-            switch(readPowerSupplyType(path)) {
-            case ANDROID_POWER_SUPPLY_TYPE_AC:
-                props.chargerAcOnline = true;
-                break;
-            case ANDROID_POWER_SUPPLY_TYPE_USB:
-                props.chargerUsbOnline = true;
-                break;
-            case ANDROID_POWER_SUPPLY_TYPE_WIRELESS:
-                props.chargerWirelessOnline = true;
-                break;
-            default:
-                KLOG_WARNING(LOG_TAG, "%s: Unknown power supply type\n",
-                             mChargerNames[i].string());
-            }
-            path.clear();
-            path.appendFormat("%s/%s/current_max", POWER_SUPPLY_SYSFS_PATH,
-                              mChargerNames[i].string());
-            int ChargingCurrent =
-                    (access(path.string(), R_OK) == 0) ? getIntField(path) : 0;
-
-            path.clear();
-            path.appendFormat("%s/%s/voltage_max", POWER_SUPPLY_SYSFS_PATH,
-                              mChargerNames[i].string());
-
-            int ChargingVoltage =
-                (access(path.string(), R_OK) == 0) ? getIntField(path) :
-                DEFAULT_VBUS_VOLTAGE;
-
-            double power = ((double)ChargingCurrent / MILLION) *
-                           ((double)ChargingVoltage / MILLION);
-            if (MaxPower < power) {
-                props.maxChargingCurrent = ChargingCurrent;
-                props.maxChargingVoltage = ChargingVoltage;
-                MaxPower = power;
-            }
-        }
-    }
 }
 
 void BatteryMonitor::logValues(void) {
@@ -377,9 +445,9 @@ void BatteryMonitor::logValues(void) {
         len = snprintf(dmesgline, sizeof(dmesgline), "battery none");
     }
 
-    snprintf(dmesgline + len, sizeof(dmesgline) - len, " chg=%s%s%s",
+    snprintf(dmesgline + len, sizeof(dmesgline) - len, " chg=%s%s%s upd=%dus",
              props.chargerAcOnline ? "a" : "", props.chargerUsbOnline ? "u" : "",
-             props.chargerWirelessOnline ? "w" : "");
+             props.chargerWirelessOnline ? "w" : "", mLastUpdateLatencyUs);
 
     KLOG_WARNING(LOG_TAG, "%s\n", dmesgline);
 }
@@ -563,6 +631,14 @@ void BatteryMonitor::init(struct healthd_config *hc) {
                 if (isScopedPowerSupply(name)) continue;
                 mBatteryDevicePresent = true;
 
+                if (mBatteryUeventPath.isEmpty()) {
+                    path.clear();
+                    path.appendFormat("%s/%s/uevent", POWER_SUPPLY_SYSFS_PATH,
+                                      name);
+                    if (access(path, R_OK) == 0)
+                        mBatteryUeventPath = path;
+                }
+
                 if (mHealthdConfig->batteryStatusPath.isEmpty()) {
                     path.clear();
                     path.appendFormat("%s/%s/status", POWER_SUPPLY_SYSFS_PATH,
@@ -80,6 +80,19 @@ HealthdDraw::~HealthdDraw() {}
 
 void HealthdDraw::redraw_screen(const animation* batt_anim, GRSurface* surf_unknown) {
     if (!graphics_available) return;
+
+    /* if every input of the frame matches what is already on screen, skip
+     * the clear/blit/flip; repeated frames are common (first_frame_repeats,
+     * single-image animations) and full redraws on a large panel cost
+     * enough CPU/GPU to slow charging */
+    std::string clock = clock_text(batt_anim);
+    if (last_drawn_valid_ && batt_anim->cur_frame == last_frame_ &&
+        batt_anim->cur_level == last_level_ && batt_anim->cur_status == last_status_ &&
+        clock == last_clock_) {
+        LOGV("skipping identical frame #%d\n", batt_anim->cur_frame);
+        return;
+    }
+
     clear_screen();
 
     /* try to display *something* */
@@ -89,10 +102,18 @@ void HealthdDraw::redraw_screen(const animation* batt_anim, GRSurface* surf_unkn
     else
         draw_battery(batt_anim);
     gr_flip();
+
+    last_drawn_valid_ = true;
+    last_frame_ = batt_anim->cur_frame;
+    last_level_ = batt_anim->cur_level;
+    last_status_ = batt_anim->cur_status;
+    last_clock_ = clock;
 }
 
 void HealthdDraw::blank_screen(bool blank) {
     if (!graphics_available) return;
+    /* the panel content can no longer be trusted once blanked */
+    last_drawn_valid_ = false;
     gr_fb_blank(blank);
 }
 
@@ -157,7 +178,7 @@ void HealthdDraw::determine_xy(const animation::text_field& field,
   }
 }
 
-void HealthdDraw::draw_clock(const animation* anim) {
+std::string HealthdDraw::clock_text(const animation* anim) {
     static constexpr char CLOCK_FORMAT[] = "%H:%M";
     static constexpr int CLOCK_LENGTH = 6;
 
@@ -165,7 +186,7 @@ void HealthdDraw::draw_clock(const animation* anim) {
 
     if (!graphics_available || field.font == nullptr || field.font->char_width == 0 ||
         field.font->char_height == 0)
-        return;
+        return "";
 
     time_t rawtime;
     time(&rawtime);
@@ -175,15 +196,24 @@ void HealthdDraw::draw_clock(const animation* anim) {
     size_t length = strftime(clock_str, CLOCK_LENGTH, CLOCK_FORMAT, time_info);
     if (length != CLOCK_LENGTH - 1) {
         LOGE("Could not format time\n");
-        return;
+        return "";
     }
 
+    return clock_str;
+}
+
+void HealthdDraw::draw_clock(const animation* anim) {
+    const animation::text_field& field = anim->text_clock;
+
+    std::string clock_str = clock_text(anim);
+    if (clock_str.empty()) return;
+
     int x, y;
-    determine_xy(field, length, &x, &y);
+    determine_xy(field, clock_str.size(), &x, &y);
 
-    LOGV("drawing clock %s %d %d\n", clock_str, x, y);
+    LOGV("drawing clock %s %d %d\n", clock_str.c_str(), x, y);
     gr_color(field.color_r, field.color_g, field.color_b, field.color_a);
-    draw_text(field.font, x, y, clock_str);
+    draw_text(field.font, x, y, clock_str.c_str());
 }
 
 void HealthdDraw::draw_percent(const animation* anim) {
@@ -17,6 +17,8 @@
 #ifndef HEALTHD_DRAW_H
 #define HEALTHD_DRAW_H
 
+#include <string>
+
 #include <linux/input.h>
 #include <minui/minui.h>
 
@@ -30,7 +32,10 @@ class HealthdDraw {
   HealthdDraw(animation* anim);
   virtual ~HealthdDraw();
 
-  // Redraws screen.
+  // Redraws screen. Skipped when the frame would be identical to the one
+  // already on screen (same animation frame, level, status and clock text),
+  // which is the common case while the first frame repeats or the battery
+  // image for the current level is shown across cycles.
   void redraw_screen(const animation* batt_anim, GRSurface* surf_unknown);
 
   // Blanks screen if true, unblanks if false.
@@ -58,6 +63,10 @@ class HealthdDraw {
   // Draws charger->surf_unknown or basic text.
   virtual void draw_unknown(GRSurface* surf_unknown);
 
+  // Returns the clock text the animation displays right now, or an empty
+  // string if no clock is drawn.
+  std::string clock_text(const animation* anim);
+
   // Pixel sizes of characters for default font.
   int char_width_;
   int char_height_;
@@ -76,6 +85,15 @@ class HealthdDraw {
 
   // true if minui init'ed OK, false if minui init failed
   bool graphics_available;
+
+ private:
+  // What redraw_screen last put on screen; used to elide identical redraws.
+  // Invalidated by blank_screen, since the panel content is no longer ours.
+  bool last_drawn_valid_ = false;
+  int last_frame_;
+  int last_level_;
+  int last_status_;
+  std::string last_clock_;
 };
 
 #endif  // HEALTHD_DRAW_H
@@ -391,8 +391,15 @@ void Charger::UpdateScreenState(int64_t now) {
         return;
     }
 
-    /* schedule next screen transition */
-    next_screen_transition_ = curr_time_ms() + disp_time;
+    /* schedule next screen transition, relative to the current deadline
+     * rather than the post-draw clock so per-frame draw time does not
+     * accumulate as drift across the animation; if we fell more than one
+     * period behind (e.g. a slow first draw), re-anchor on the clock
+     * instead of firing a burst of catch-up frames
+     */
+    if (next_screen_transition_ < 0) next_screen_transition_ = now;
+    next_screen_transition_ += disp_time;
+    if (next_screen_transition_ <= now) next_screen_transition_ = curr_time_ms() + disp_time;
 
     /* advance frame cntr to the next valid frame only if we are charging
      * if necessary, advance cycle cntr, and reset frame cntr
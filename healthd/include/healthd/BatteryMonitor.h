@@ -17,8 +17,11 @@
 #ifndef HEALTHD_BATTERYMONITOR_H
 #define HEALTHD_BATTERYMONITOR_H
 
+#include <map>
 #include <memory>
+#include <string>
 
+#include <android-base/unique_fd.h>
 #include <batteryservice/BatteryService.h>
 #include <utils/String8.h>
 #include <utils/Vector.h>
@@ -74,7 +77,20 @@ class BatteryMonitor {
     int mBatteryFixedTemperature;
     std::unique_ptr<android::hardware::health::V2_1::HealthInfo> mHealthInfo;
 
-    int readFromFile(const String8& path, std::string* buf);
+    // Sysfs fds opened on first use and then reused with pread, so periodic
+    // polling does not pay an open/close pair per property.
+    std::map<String8, android::base::unique_fd> mFdCache;
+
+    // Snapshot of the battery's uevent file from the last update; when it is
+    // unchanged, the per-property battery reads are skipped.
+    String8 mBatteryUeventPath;
+    std::string mLastBatteryUevent;
+
+    // Duration of the last updateValues() pass, reported by logValues().
+    int mLastUpdateLatencyUs;
+
+    void updateBatteryValues(void);
+    int readFromFile(const String8& path, std::string* buf, bool useFdCache = true);
     PowerSupplyType readPowerSupplyType(const String8& path);
     bool getBooleanField(const String8& path);
     int getIntField(const String8& path);
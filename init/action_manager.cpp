@@ -18,6 +18,8 @@
 
 #include <android-base/logging.h>
 
+#include "boot_trace.h"
+
 namespace android {
 namespace init {
 
@@ -37,9 +39,36 @@ ActionManager& ActionManager::GetInstance() {
 }
 
 void ActionManager::AddAction(std::unique_ptr<Action> action) {
+    auto lock = std::lock_guard{event_queue_lock_};
+    AddActionLocked(std::move(action));
+}
+
+void ActionManager::AddActionLocked(std::unique_ptr<Action> action) {
+    if (!action->event_trigger().empty()) {
+        event_trigger_index_[action->event_trigger()].emplace_back(action.get());
+    } else {
+        property_triggered_actions_.emplace_back(action.get());
+        for (const auto& [trigger_name, trigger_value] : action->property_triggers()) {
+            property_trigger_index_[trigger_name].emplace_back(action.get());
+        }
+    }
     actions_.emplace_back(std::move(action));
 }
 
+void ActionManager::RemoveActionLocked(const Action* action) {
+    auto erase_from = [action](std::vector<Action*>& actions) {
+        actions.erase(std::remove(actions.begin(), actions.end(), action), actions.end());
+    };
+    if (!action->event_trigger().empty()) {
+        erase_from(event_trigger_index_[action->event_trigger()]);
+    } else {
+        erase_from(property_triggered_actions_);
+        for (const auto& [trigger_name, trigger_value] : action->property_triggers()) {
+            erase_from(property_trigger_index_[trigger_name]);
+        }
+    }
+}
+
 void ActionManager::QueueEventTrigger(const std::string& trigger) {
     auto lock = std::lock_guard{event_queue_lock_};
     event_queue_.emplace(trigger);
@@ -61,7 +90,43 @@ void ActionManager::QueueBuiltinAction(BuiltinFunction func, const std::string&
     action->AddCommand(std::move(func), {name}, 0);
 
     event_queue_.emplace(action.get());
-    actions_.emplace_back(std::move(action));
+    AddActionLocked(std::move(action));
+}
+
+// Queues the actions that can match the event, in the order they were added.
+// Only the candidate lists indexed by the event's trigger are scanned, not
+// every registered action; with the thousands of property sets during boot
+// the full scan used to dominate event dispatch.
+void ActionManager::MatchEventLocked(
+        const std::variant<EventTrigger, PropertyChange, BuiltinAction>& event) {
+    auto check_candidates = [this, &event](const std::vector<Action*>& candidates) {
+        for (auto* action : candidates) {
+            if (std::visit([action](const auto& event) { return action->CheckEvent(event); },
+                           event)) {
+                current_executing_actions_.emplace(action);
+            }
+        }
+    };
+
+    if (auto* event_trigger = std::get_if<EventTrigger>(&event)) {
+        if (auto it = event_trigger_index_.find(*event_trigger);
+            it != event_trigger_index_.end()) {
+            check_candidates(it->second);
+        }
+    } else if (auto* property_change = std::get_if<PropertyChange>(&event)) {
+        const auto& name = property_change->first;
+        if (name.empty()) {
+            // QueueAllPropertyActions() matches every property triggered action.
+            check_candidates(property_triggered_actions_);
+        } else if (auto it = property_trigger_index_.find(name);
+                   it != property_trigger_index_.end()) {
+            check_candidates(it->second);
+        }
+    } else {
+        // A builtin action can only match itself, and cannot have been removed
+        // before its event is handled, since it is removed by executing it.
+        current_executing_actions_.emplace(std::get<BuiltinAction>(event));
+    }
 }
 
 void ActionManager::ExecuteOneCommand() {
@@ -69,12 +134,7 @@ void ActionManager::ExecuteOneCommand() {
         auto lock = std::lock_guard{event_queue_lock_};
         // Loop through the event queue until we have an action to execute
         while (current_executing_actions_.empty() && !event_queue_.empty()) {
-            for (const auto& action : actions_) {
-                if (std::visit([&action](const auto& event) { return action->CheckEvent(event); },
-                               event_queue_.front())) {
-                    current_executing_actions_.emplace(action.get());
-                }
-            }
+            MatchEventLocked(event_queue_.front());
             event_queue_.pop();
         }
     }
@@ -89,6 +149,7 @@ void ActionManager::ExecuteOneCommand() {
         std::string trigger_name = action->BuildTriggersString();
         LOG(INFO) << "processing action (" << trigger_name << ") from (" << action->filename()
                   << ":" << action->line() << ")";
+        RecordBootEvent("action " + trigger_name);
     }
 
     action->ExecuteOneCommand(current_command_);
@@ -101,6 +162,8 @@ void ActionManager::ExecuteOneCommand() {
         current_executing_actions_.pop();
         current_command_ = 0;
         if (action->oneshot()) {
+            auto lock = std::lock_guard{event_queue_lock_};
+            RemoveActionLocked(action);
             auto eraser = [&action](std::unique_ptr<Action>& a) { return a.get() == action; };
             actions_.erase(std::remove_if(actions_.begin(), actions_.end(), eraser),
                            actions_.end());
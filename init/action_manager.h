@@ -18,6 +18,7 @@
 
 #include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <android-base/thread_annotations.h>
@@ -50,7 +51,22 @@ class ActionManager {
     ActionManager(ActionManager const&) = delete;
     void operator=(ActionManager const&) = delete;
 
+    void AddActionLocked(std::unique_ptr<Action> action) REQUIRES(event_queue_lock_);
+    void RemoveActionLocked(const Action* action) REQUIRES(event_queue_lock_);
+    void MatchEventLocked(const std::variant<EventTrigger, PropertyChange, BuiltinAction>& event)
+            REQUIRES(event_queue_lock_);
+
     std::vector<std::unique_ptr<Action>> actions_;
+    // Indexes from trigger to the actions that could match an event carrying
+    // it, in the order the actions were added.  An event only ever scans its
+    // own candidate list rather than every registered action; CheckEvent()
+    // still validates the remaining trigger conditions per candidate.
+    std::unordered_map<std::string, std::vector<Action*>> event_trigger_index_
+            GUARDED_BY(event_queue_lock_);
+    std::unordered_map<std::string, std::vector<Action*>> property_trigger_index_
+            GUARDED_BY(event_queue_lock_);
+    // All actions without an event trigger, for QueueAllPropertyActions().
+    std::vector<Action*> property_triggered_actions_ GUARDED_BY(event_queue_lock_);
     std::queue<std::variant<EventTrigger, PropertyChange, BuiltinAction>> event_queue_
             GUARDED_BY(event_queue_lock_);
     mutable std::mutex event_queue_lock_;
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "boot_trace.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include <atomic>
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <android-base/unique_fd.h>
+
+namespace android {
+namespace init {
+
+namespace {
+
+// File format: the magic, a little-endian uint32 version, a little-endian uint32 event count,
+// then that many BootTraceEvent records in chronological order.
+constexpr char kBootTraceMagic[4] = {'B', 'T', 'R', 'C'};
+constexpr uint32_t kBootTraceVersion = 1;
+
+// Dump locations, tried in order.  /metrics is only present on devices with a dedicated metrics
+// partition; /data/bootchart is created unconditionally by init.rc.
+constexpr const char* kBootTracePaths[] = {
+        "/metrics/boot-trace",
+        "/data/bootchart/boot-trace",
+};
+
+struct BootTraceEvent {
+    uint64_t boottime_ns;
+    char tag[56];
+};
+static_assert(sizeof(BootTraceEvent) == 64);
+
+constexpr uint32_t kMaxBootTraceEvents = 2048;
+
+BootTraceEvent boot_trace_events[kMaxBootTraceEvents];
+std::atomic<uint32_t> next_boot_trace_event{0};
+
+}  // namespace
+
+void RecordBootEvent(std::string_view event) {
+    // fetch_add makes slot claiming lock-free; once the ring wraps, the oldest events are
+    // overwritten.  A dump that races a writer can at worst read one torn slot.
+    uint32_t index = next_boot_trace_event.fetch_add(1, std::memory_order_relaxed);
+    auto& entry = boot_trace_events[index % kMaxBootTraceEvents];
+
+    timespec now;
+    clock_gettime(CLOCK_BOOTTIME, &now);
+    entry.boottime_ns = now.tv_sec * 1000000000ULL + now.tv_nsec;
+
+    size_t length = std::min(event.size(), sizeof(entry.tag) - 1);
+    memcpy(entry.tag, event.data(), length);
+    entry.tag[length] = '\0';
+}
+
+void DumpBootTrace() {
+    uint32_t total = next_boot_trace_event.load(std::memory_order_relaxed);
+    uint32_t count = std::min(total, kMaxBootTraceEvents);
+
+    android::base::unique_fd fd;
+    for (const auto& path : kBootTracePaths) {
+        fd.reset(TEMP_FAILURE_RETRY(
+                open(path, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0640)));
+        if (fd != -1) break;
+    }
+    if (fd == -1) {
+        PLOG(ERROR) << "Unable to open a boot trace dump location";
+        return;
+    }
+
+    char header[sizeof(kBootTraceMagic) + 2 * sizeof(uint32_t)];
+    memcpy(header, kBootTraceMagic, sizeof(kBootTraceMagic));
+    uint32_t version_le = kBootTraceVersion;
+    uint32_t count_le = count;
+    memcpy(header + sizeof(kBootTraceMagic), &version_le, sizeof(version_le));
+    memcpy(header + sizeof(kBootTraceMagic) + sizeof(version_le), &count_le, sizeof(count_le));
+    if (!android::base::WriteFully(fd, header, sizeof(header))) {
+        PLOG(ERROR) << "Unable to write boot trace header";
+        return;
+    }
+
+    // Once the ring has wrapped, the oldest retained event is the slot the next write would
+    // claim.
+    uint32_t first = total > kMaxBootTraceEvents ? total % kMaxBootTraceEvents : 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        const auto& entry = boot_trace_events[(first + i) % kMaxBootTraceEvents];
+        if (!android::base::WriteFully(fd, &entry, sizeof(entry))) {
+            PLOG(ERROR) << "Unable to write boot trace events";
+            return;
+        }
+    }
+}
+
+}  // namespace init
+}  // namespace android
@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <string_view>
+
+namespace android {
+namespace init {
+
+// An always-on, low-overhead boot event tracer.  Unlike bootchart, which samples /proc and is too
+// heavy to leave enabled in production, this records fixed-size binary timestamped events into a
+// static ring buffer: a record is one CLOCK_BOOTTIME read and a bounded copy, cheap enough to keep
+// on every boot.  The ring is dumped to disk once the boot completes, so boot timelines can be
+// diffed across builds.
+
+// Records an event.  Tags longer than the fixed slot size are truncated.  Safe to call from any
+// thread.
+void RecordBootEvent(std::string_view event);
+
+// Writes the recorded events, oldest first, to the first writable dump location.
+void DumpBootTrace();
+
+}  // namespace init
+}  // namespace android
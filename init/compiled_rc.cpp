@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "compiled_rc.h"
+
+#include <string.h>
+
+#include "tokenizer.h"
+
+namespace android {
+namespace init {
+
+bool IsCompiledRc(const std::string& data) {
+    return data.size() >= sizeof(kCompiledRcMagic) &&
+           memcmp(data.data(), kCompiledRcMagic, sizeof(kCompiledRcMagic)) == 0;
+}
+
+static void AppendUint16(std::string* out, uint16_t value) {
+    out->push_back(static_cast<char>(value & 0xff));
+    out->push_back(static_cast<char>(value >> 8));
+}
+
+static void AppendUint32(std::string* out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out->push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+}
+
+Result<std::string> CompileRc(std::string data) {
+    std::string out(kCompiledRcMagic, sizeof(kCompiledRcMagic));
+    AppendUint32(&out, kCompiledRcVersion);
+
+    data.push_back('\n');
+    data.push_back('\0');
+
+    parse_state state;
+    state.line = 0;
+    state.ptr = data.data();
+    state.nexttoken = 0;
+
+    std::vector<std::string> args;
+    for (;;) {
+        switch (next_token(&state)) {
+            case T_EOF:
+                return out;
+            case T_NEWLINE:
+                state.line++;
+                if (args.empty()) break;
+                if (args.size() > UINT16_MAX) {
+                    return Error() << "too many tokens on line " << state.line;
+                }
+                AppendUint32(&out, static_cast<uint32_t>(state.line));
+                AppendUint16(&out, static_cast<uint16_t>(args.size()));
+                for (const auto& arg : args) {
+                    if (arg.size() > UINT16_MAX) {
+                        return Error() << "token too long on line " << state.line;
+                    }
+                    AppendUint16(&out, static_cast<uint16_t>(arg.size()));
+                    out.append(arg);
+                }
+                args.clear();
+                break;
+            case T_TEXT:
+                args.emplace_back(state.token());
+                break;
+        }
+    }
+}
+
+}  // namespace init
+}  // namespace android
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "result.h"
+
+namespace android {
+namespace init {
+
+// Compiled rc files hold the token stream a .rc file would produce, so init
+// can walk lines at boot without running the character-at-a-time tokenizer.
+// The layout after the header is a sequence of line records:
+//
+//   uint32 line_number
+//   uint16 argc (> 0)
+//   argc * { uint16 length, length bytes of token text }
+//
+// Integers are little-endian and records are unaligned. Tokens are stored
+// with escapes and line continuations already resolved, which is why the
+// compiled stream must be produced by the same tokenizer init ships.
+//
+// The leading magic byte is outside the printable range, so a compiled file
+// can never tokenize as valid rc text and a text file can never carry the
+// magic; the parser dispatches on it and falls back to text parsing (e.g. for
+// vendor overlays that aren't compiled) otherwise.
+inline constexpr char kCompiledRcMagic[4] = {'\x7f', 'R', 'C', 'C'};
+inline constexpr uint32_t kCompiledRcVersion = 1;
+
+// Returns whether the buffer carries the compiled rc magic.
+bool IsCompiledRc(const std::string& data);
+
+// Tokenizes rc text exactly as Parser::ParseData() would and serializes the
+// result into the compiled format. Used by host_init_verifier at build time.
+Result<std::string> CompileRc(std::string data);
+
+}  // namespace init
+}  // namespace android
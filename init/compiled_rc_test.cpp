@@ -0,0 +1,111 @@
+//
+// Copyright (C) 2021 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "compiled_rc.h"
+
+#include <string>
+#include <vector>
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+
+#include "parser.h"
+
+namespace android {
+namespace init {
+
+namespace {
+
+// Records every section and line it is handed, so that the text and compiled
+// parsing paths can be compared.
+class RecordingParser : public SectionParser {
+  public:
+    Result<void> ParseSection(std::vector<std::string>&& args, const std::string& filename,
+                              int line) override {
+        lines_.emplace_back(std::move(args));
+        return {};
+    }
+    Result<void> ParseLineSection(std::vector<std::string>&& args, int line) override {
+        lines_.emplace_back(std::move(args));
+        return {};
+    }
+
+    const std::vector<std::vector<std::string>>& lines() const { return lines_; }
+
+  private:
+    std::vector<std::vector<std::string>> lines_;
+};
+
+std::vector<std::vector<std::string>> ParseToLines(std::string data) {
+    Parser parser;
+    auto recorder = std::make_unique<RecordingParser>();
+    auto* recorder_ptr = recorder.get();
+    parser.AddSectionParser("on", std::move(recorder));
+
+    // ParseData() is private; go through a temporary file.
+    TemporaryFile tf;
+    EXPECT_TRUE(android::base::WriteStringToFile(data, tf.path));
+    EXPECT_TRUE(parser.ParseConfigFileInsecure(tf.path));
+    EXPECT_EQ(0u, parser.parse_error_count());
+    return recorder_ptr->lines();
+}
+
+}  // namespace
+
+TEST(compiled_rc, magic_detection) {
+    EXPECT_FALSE(IsCompiledRc(""));
+    EXPECT_FALSE(IsCompiledRc("on boot\n"));
+
+    auto compiled = CompileRc("on boot\n");
+    ASSERT_TRUE(compiled.ok()) << compiled.error();
+    EXPECT_TRUE(IsCompiledRc(*compiled));
+}
+
+TEST(compiled_rc, round_trip) {
+    std::string rc =
+            "on boot\n"
+            "    write /dev/kmsg \"hello world\"\n"
+            "    setprop test.prop ${other.prop}\n"
+            "\n"
+            "on property:sys.boot_completed=1\n"
+            "    start \\\n"
+            "        late_service\n";
+
+    auto compiled = CompileRc(rc);
+    ASSERT_TRUE(compiled.ok()) << compiled.error();
+
+    auto text_lines = ParseToLines(rc);
+    auto compiled_lines = ParseToLines(*compiled);
+    EXPECT_FALSE(text_lines.empty());
+    EXPECT_EQ(text_lines, compiled_lines);
+}
+
+TEST(compiled_rc, truncated_input_is_an_error) {
+    auto compiled = CompileRc("on boot\n    start foo\n");
+    ASSERT_TRUE(compiled.ok()) << compiled.error();
+
+    Parser parser;
+    parser.AddSectionParser("on", std::make_unique<RecordingParser>());
+
+    TemporaryFile tf;
+    ASSERT_TRUE(android::base::WriteStringToFile(compiled->substr(0, compiled->size() - 3),
+                                                 tf.path));
+    ASSERT_TRUE(parser.ParseConfigFileInsecure(tf.path));
+    EXPECT_GT(parser.parse_error_count(), 0u);
+}
+
+}  // namespace init
+}  // namespace android
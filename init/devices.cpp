@@ -17,6 +17,7 @@
 #include "devices.h"
 
 #include <errno.h>
+#include <fcntl.h>
 #include <fnmatch.h>
 #include <sys/sysmacros.h>
 #include <unistd.h>
@@ -32,6 +33,7 @@
 #include <android-base/logging.h>
 #include <android-base/stringprintf.h>
 #include <android-base/strings.h>
+#include <android-base/unique_fd.h>
 #include <private/android_filesystem_config.h>
 #include <selinux/android.h>
 #include <selinux/selinux.h>
@@ -49,6 +51,7 @@ using android::base::Realpath;
 using android::base::StartsWith;
 using android::base::StringPrintf;
 using android::base::Trim;
+using android::base::unique_fd;
 
 namespace android {
 namespace init {
@@ -154,6 +157,40 @@ bool Permissions::Match(const std::string& path) const {
     return path == name_;
 }
 
+void PermissionsTrie::Add(const Permissions& permissions, size_t index) {
+    if (permissions.wildcard_) {
+        wildcards_.emplace_back(index);
+        return;
+    }
+
+    auto* node = &root_;
+    for (char c : permissions.name_) {
+        auto& child = node->children[c];
+        if (!child) child = std::make_unique<TrieNode>();
+        node = child.get();
+    }
+    if (permissions.prefix_) {
+        node->prefix.emplace_back(index);
+    } else {
+        node->exact.emplace_back(index);
+    }
+}
+
+void PermissionsTrie::Find(const std::string& path, std::vector<size_t>* matches) const {
+    const auto* node = &root_;
+    for (char c : path) {
+        // A prefix rule ending at this node matches a strict prefix of the path.
+        matches->insert(matches->end(), node->prefix.begin(), node->prefix.end());
+
+        auto it = node->children.find(c);
+        if (it == node->children.end()) return;
+        node = it->second.get();
+    }
+    // Prefix rules equal to the whole path match too, per StartsWith().
+    matches->insert(matches->end(), node->prefix.begin(), node->prefix.end());
+    matches->insert(matches->end(), node->exact.begin(), node->exact.end());
+}
+
 bool SysfsPermissions::MatchWithSubsystem(const std::string& path,
                                           const std::string& subsystem) const {
     std::string path_basename = Basename(path);
@@ -164,17 +201,20 @@ bool SysfsPermissions::MatchWithSubsystem(const std::string& path,
     return Match(path);
 }
 
-void SysfsPermissions::SetPermissions(const std::string& path) const {
+void SysfsPermissions::SetPermissions(const std::string& path, int dirfd) const {
     std::string attribute_file = path + "/" + attribute_;
     LOG(VERBOSE) << "fixup " << attribute_file << " " << uid() << " " << gid() << " " << std::oct
                  << perm();
 
-    if (access(attribute_file.c_str(), F_OK) == 0) {
-        if (chown(attribute_file.c_str(), uid(), gid()) != 0) {
+    // Operations are relative to the device directory the caller already has open, so the
+    // kernel resolves the attribute name against dirfd rather than walking the long sysfs
+    // path again for every syscall of every matched rule.
+    if (faccessat(dirfd, attribute_.c_str(), F_OK, 0) == 0) {
+        if (fchownat(dirfd, attribute_.c_str(), uid(), gid(), 0) != 0) {
             PLOG(ERROR) << "chown(" << attribute_file << ", " << uid() << ", " << gid()
                         << ") failed";
         }
-        if (chmod(attribute_file.c_str(), perm()) != 0) {
+        if (fchmodat(dirfd, attribute_.c_str(), perm(), 0) != 0) {
             PLOG(ERROR) << "chmod(" << attribute_file << ", " << perm() << ") failed";
         }
     }
@@ -218,8 +258,31 @@ void DeviceHandler::FixupSysPermissions(const std::string& upath,
     // contain, so we prepend it...
     std::string path = "/sys" + upath;
 
-    for (const auto& s : sysfs_permissions_) {
-        if (s.MatchWithSubsystem(path, subsystem)) s.SetPermissions(path);
+    // The trie finds candidates by the concrete paths MatchWithSubsystem() compares against;
+    // each candidate is then re-checked with the full predicate, which also enforces that the
+    // rule's name mentions the subsystem for the /sys/class and /sys/bus forms.
+    std::vector<size_t> candidates = sysfs_permissions_trie_.wildcards();
+    sysfs_permissions_trie_.Find(path, &candidates);
+    std::string path_basename = Basename(path);
+    sysfs_permissions_trie_.Find("/sys/class/" + subsystem + "/" + path_basename, &candidates);
+    sysfs_permissions_trie_.Find("/sys/bus/" + subsystem + "/devices/" + path_basename,
+                                 &candidates);
+    // Apply matching rules in their ueventd.rc order.
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    // One open of the device directory serves every matched rule; if the directory is
+    // already gone there is nothing to fix up and all of the per-attribute syscalls are
+    // skipped.
+    unique_fd dirfd;
+    for (auto index : candidates) {
+        const auto& s = sysfs_permissions_[index];
+        if (!s.MatchWithSubsystem(path, subsystem)) continue;
+        if (dirfd.get() == -1) {
+            dirfd.reset(open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+            if (dirfd.get() == -1) break;
+        }
+        s.SetPermissions(path, dirfd.get());
     }
 
     if (!skip_restorecon_ && access(path.c_str(), F_OK) == 0) {
@@ -232,13 +295,23 @@ void DeviceHandler::FixupSysPermissions(const std::string& upath,
 
 std::tuple<mode_t, uid_t, gid_t> DeviceHandler::GetDevicePermissions(
     const std::string& path, const std::vector<std::string>& links) const {
-    // Search the perms list in reverse so that ueventd.$hardware can override ueventd.rc.
-    for (auto it = dev_permissions_.crbegin(); it != dev_permissions_.crend(); ++it) {
-        if (it->Match(path) || std::any_of(links.cbegin(), links.cend(),
-                                           [it](const auto& link) { return it->Match(link); })) {
-            return {it->perm(), it->uid(), it->gid()};
+    std::vector<size_t> matches;
+    dev_permissions_trie_.Find(path, &matches);
+    for (const auto& link : links) {
+        dev_permissions_trie_.Find(link, &matches);
+    }
+    for (auto index : dev_permissions_trie_.wildcards()) {
+        const auto& p = dev_permissions_[index];
+        if (p.Match(path) || std::any_of(links.cbegin(), links.cend(),
+                                         [&p](const auto& link) { return p.Match(link); })) {
+            matches.emplace_back(index);
         }
     }
+    if (!matches.empty()) {
+        // The highest index wins so that ueventd.$hardware can override ueventd.rc.
+        const auto& p = dev_permissions_[*std::max_element(matches.begin(), matches.end())];
+        return {p.perm(), p.uid(), p.gid()};
+    }
     /* Default if nothing found. */
     return {0600, 0, 0};
 }
@@ -532,7 +605,14 @@ DeviceHandler::DeviceHandler(std::vector<Permissions> dev_permissions,
       subsystems_(std::move(subsystems)),
       boot_devices_(std::move(boot_devices)),
       skip_restorecon_(skip_restorecon),
-      sysfs_mount_point_("/sys") {}
+      sysfs_mount_point_("/sys") {
+    for (size_t i = 0; i < dev_permissions_.size(); ++i) {
+        dev_permissions_trie_.Add(dev_permissions_[i], i);
+    }
+    for (size_t i = 0; i < sysfs_permissions_.size(); ++i) {
+        sysfs_permissions_trie_.Add(sysfs_permissions_[i], i);
+    }
+}
 
 DeviceHandler::DeviceHandler()
     : DeviceHandler(std::vector<Permissions>{}, std::vector<SysfsPermissions>{},
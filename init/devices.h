@@ -21,6 +21,8 @@
 #include <sys/types.h>
 
 #include <algorithm>
+#include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
@@ -36,6 +38,7 @@ namespace init {
 
 class Permissions {
   public:
+    friend class PermissionsTrie;
     friend void TestPermissions(const Permissions& expected, const Permissions& test);
 
     Permissions(const std::string& name, mode_t perm, uid_t uid, gid_t gid);
@@ -67,12 +70,44 @@ class SysfsPermissions : public Permissions {
         : Permissions(name, perm, uid, gid), attribute_(attribute) {}
 
     bool MatchWithSubsystem(const std::string& path, const std::string& subsystem) const;
-    void SetPermissions(const std::string& path) const;
+    // Applies the rule to the attribute inside the device directory at |path|, which the
+    // caller has open as |dirfd|; |path| itself is only used for log messages.
+    void SetPermissions(const std::string& path, int dirfd) const;
 
   private:
     const std::string attribute_;
 };
 
+// An index over a list of Permissions that avoids scanning every rule with fnmatch() for each
+// uevent.  Exact rule names and prefix rules ("name*") are stored in a character trie, so looking
+// up the rules matching a path visits at most one node per character of the path.  Rules with a
+// wildcard anywhere else still require fnmatch() and are reported via wildcards() for the caller
+// to scan linearly; they are rare in practice.
+class PermissionsTrie {
+  public:
+    // Adds a rule to the index.  |index| is the rule's position in the caller's list and is what
+    // Find() reports; rule precedence is left to the caller.
+    void Add(const Permissions& permissions, size_t index);
+
+    // Appends to |matches| the indices of every exact and prefix rule matching |path|, in no
+    // particular order.  Wildcard rules are not considered.
+    void Find(const std::string& path, std::vector<size_t>* matches) const;
+
+    const std::vector<size_t>& wildcards() const { return wildcards_; }
+
+  private:
+    struct TrieNode {
+        std::map<char, std::unique_ptr<TrieNode>> children;
+        // Rules whose name is exactly the path spelled out by this node.
+        std::vector<size_t> exact;
+        // Prefix rules whose name (minus the trailing '*') is the path spelled out by this node.
+        std::vector<size_t> prefix;
+    };
+
+    TrieNode root_;
+    std::vector<size_t> wildcards_;
+};
+
 class Subsystem {
   public:
     friend class SubsystemParser;
@@ -134,6 +169,8 @@ class DeviceHandler : public UeventHandler {
 
     std::vector<Permissions> dev_permissions_;
     std::vector<SysfsPermissions> sysfs_permissions_;
+    PermissionsTrie dev_permissions_trie_;
+    PermissionsTrie sysfs_permissions_trie_;
     std::vector<Subsystem> subsystems_;
     std::set<std::string> boot_devices_;
     bool skip_restorecon_;
@@ -273,6 +273,36 @@ TEST(device_handler, DevPermissionsMatchWildcardPrefix) {
     EXPECT_EQ(1000U, permissions.gid());
 }
 
+TEST(device_handler, PermissionsTrieFindExactAndPrefix) {
+    std::vector<Permissions> permissions = {
+            Permissions("/dev/null", 0666, 0, 0),
+            Permissions("/dev/dri/*", 0666, 0, 1000),
+            Permissions("/dev/dri/card0", 0660, 0, 1000),
+            Permissions("/dev/device*name", 0666, 0, 1000),
+    };
+    PermissionsTrie trie;
+    for (size_t i = 0; i < permissions.size(); ++i) {
+        trie.Add(permissions[i], i);
+    }
+
+    auto find = [&trie](const std::string& path) {
+        std::vector<size_t> matches;
+        trie.Find(path, &matches);
+        std::sort(matches.begin(), matches.end());
+        return matches;
+    };
+
+    EXPECT_EQ((std::vector<size_t>{0}), find("/dev/null"));
+    EXPECT_EQ((std::vector<size_t>{}), find("/dev/nullsuffix"));
+    EXPECT_EQ((std::vector<size_t>{1}), find("/dev/dri/some_dri_device"));
+    // A prefix rule matches a path equal to the prefix itself.
+    EXPECT_EQ((std::vector<size_t>{1}), find("/dev/dri/"));
+    EXPECT_EQ((std::vector<size_t>{1, 2}), find("/dev/dri/card0"));
+    // Inner wildcards are not indexed in the trie; they are reported for a linear scan.
+    EXPECT_EQ((std::vector<size_t>{}), find("/dev/device123name"));
+    EXPECT_EQ((std::vector<size_t>{3}), trie.wildcards());
+}
+
 TEST(device_handler, SysfsPermissionsMatchWithSubsystemNormal) {
     // /sys/devices/virtual/input/input*   enable      0660  root   input
     SysfsPermissions permissions("/sys/devices/virtual/input/input*", "enable", 0660, 0, 1001);
@@ -19,6 +19,7 @@
 #include <stdint.h>
 #include <sys/epoll.h>
 
+#include <algorithm>
 #include <chrono>
 #include <functional>
 #include <map>
@@ -38,19 +39,33 @@ Result<void> Epoll::Open() {
     return {};
 }
 
-Result<void> Epoll::RegisterHandler(int fd, std::function<void()> handler, uint32_t events) {
+Result<void> Epoll::RegisterHandler(int fd, std::function<void()> handler, uint32_t events,
+                                    Priority priority) {
     if (!events) {
         return Error() << "Must specify events";
     }
-    auto [it, inserted] = epoll_handlers_.emplace(fd, std::move(handler));
+    auto [it, inserted] = epoll_handlers_.emplace(fd, Info{});
     if (!inserted) {
         return Error() << "Cannot specify two epoll handlers for a given FD";
     }
+    Info& info = it->second;
+    info.priority = priority;
+    // The registered handler is wrapped so that each dispatch is timed; Wait() hands the wrapper
+    // back to the caller, who invokes it as before.
+    info.handler = [&info, inner = std::move(handler)]() {
+        auto start = std::chrono::steady_clock::now();
+        inner();
+        auto duration = std::chrono::steady_clock::now() - start;
+        info.stats.dispatch_count++;
+        info.stats.total_time += duration;
+        info.stats.max_time = std::max(info.stats.max_time,
+                                       std::chrono::nanoseconds(duration));
+    };
     epoll_event ev;
     ev.events = events;
     // std::map's iterators do not get invalidated until erased, so we use the
-    // pointer to the std::function in the map directly for epoll_ctl.
-    ev.data.ptr = reinterpret_cast<void*>(&it->second);
+    // pointer to the Info in the map directly for epoll_ctl.
+    ev.data.ptr = reinterpret_cast<void*>(&info);
     if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) == -1) {
         Result<void> result = ErrnoError() << "epoll_ctl failed to add fd";
         epoll_handlers_.erase(fd);
@@ -81,13 +96,35 @@ Result<std::vector<std::function<void()>*>> Epoll::Wait(
     if (num_events == -1) {
         return ErrnoError() << "epoll_wait failed";
     }
-    std::vector<std::function<void()>*> pending_functions;
+    // All ready fds are collected before anything is dispatched, so a handler for one fd sees the
+    // full set for this iteration.  Duplicate wakeups for the same fd (possible when a handler
+    // re-arms its fd) are coalesced into a single dispatch.
+    std::vector<Info*> pending;
     for (int i = 0; i < num_events; ++i) {
-        pending_functions.emplace_back(reinterpret_cast<std::function<void()>*>(ev[i].data.ptr));
+        auto info = reinterpret_cast<Info*>(ev[i].data.ptr);
+        if (std::find(pending.begin(), pending.end(), info) == pending.end()) {
+            pending.emplace_back(info);
+        }
+    }
+    // Stable sort keeps registration order within a priority class.
+    std::stable_sort(pending.begin(), pending.end(),
+                     [](const Info* a, const Info* b) { return a->priority < b->priority; });
+
+    std::vector<std::function<void()>*> pending_functions;
+    for (auto info : pending) {
+        pending_functions.emplace_back(&info->handler);
     }
 
     return pending_functions;
 }
 
+std::map<int, Epoll::HandlerStats> Epoll::ExportHandlerStats() const {
+    std::map<int, HandlerStats> stats;
+    for (const auto& [fd, info] : epoll_handlers_) {
+        stats.emplace(fd, info.stats);
+    }
+    return stats;
+}
+
 }  // namespace init
 }  // namespace android
@@ -34,17 +34,44 @@ namespace init {
 
 class Epoll {
   public:
+    // Dispatch order within one Wait() call.  kHigh handlers (e.g. the signalfd) run before
+    // kDefault, which run before kBatch (e.g. property sockets), so a storm on a batch fd cannot
+    // delay child reaping past a single handler invocation.
+    enum class Priority : uint8_t {
+        kHigh = 0,
+        kDefault = 1,
+        kBatch = 2,
+    };
+
+    // Cumulative per-fd dispatch cost, kept since registration.  Durations are wall-clock time
+    // spent inside the handler, not time spent waiting to be dispatched.
+    struct HandlerStats {
+        uint64_t dispatch_count = 0;
+        std::chrono::nanoseconds total_time = std::chrono::nanoseconds(0);
+        std::chrono::nanoseconds max_time = std::chrono::nanoseconds(0);
+    };
+
     Epoll();
 
     Result<void> Open();
-    Result<void> RegisterHandler(int fd, std::function<void()> handler, uint32_t events = EPOLLIN);
+    Result<void> RegisterHandler(int fd, std::function<void()> handler, uint32_t events = EPOLLIN,
+                                 Priority priority = Priority::kDefault);
     Result<void> UnregisterHandler(int fd);
     Result<std::vector<std::function<void()>*>> Wait(
             std::optional<std::chrono::milliseconds> timeout);
 
+    std::map<int, HandlerStats> ExportHandlerStats() const;
+
   private:
+    struct Info {
+        // Wraps the registered handler with latency accounting; this is what Wait() hands back.
+        std::function<void()> handler;
+        Priority priority;
+        HandlerStats stats;
+    };
+
     android::base::unique_fd epoll_fd_;
-    std::map<int, std::function<void()>> epoll_handlers_;
+    std::map<int, Info> epoll_handlers_;
 };
 
 }  // namespace init
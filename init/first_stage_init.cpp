@@ -29,6 +29,7 @@
 
 #include <filesystem>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <android-base/chrono_utils.h>
@@ -152,11 +153,20 @@ bool LoadKernelModules(bool recovery, bool want_console) {
     // /lib/modules/5.4-gki.
     std::sort(module_dirs.begin(), module_dirs.end());
 
+    // Loading is strict unless a console is wanted for debugging; the strict
+    // path can use the dependency-aware parallel loader.
+    auto load_modules = [&](Modprobe& m) {
+        if (want_console) {
+            return m.LoadListedModules(false);
+        }
+        return m.LoadModulesParallel(std::thread::hardware_concurrency() ?: 4);
+    };
+
     for (const auto& module_dir : module_dirs) {
         std::string dir_path = MODULE_BASE_DIR "/";
         dir_path.append(module_dir);
         Modprobe m({dir_path}, GetModuleLoadList(recovery, dir_path));
-        bool retval = m.LoadListedModules(!want_console);
+        bool retval = load_modules(m);
         int modules_loaded = m.GetModuleCount();
         if (modules_loaded > 0) {
             return retval;
@@ -164,7 +174,7 @@ bool LoadKernelModules(bool recovery, bool want_console) {
     }
 
     Modprobe m({MODULE_BASE_DIR}, GetModuleLoadList(recovery, MODULE_BASE_DIR));
-    bool retval = m.LoadListedModules(!want_console);
+    bool retval = load_modules(m);
     int modules_loaded = m.GetModuleCount();
     if (modules_loaded > 0) {
         return retval;
@@ -26,6 +26,7 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <android-base/chrono_utils.h>
@@ -107,6 +108,11 @@ class FirstStageMount {
     virtual bool GetDmVerityDevices(std::set<std::string>* devices) = 0;
     virtual bool SetUpDmVerity(FstabEntry* fstab_entry) = 0;
 
+    // Starts any verification work that can overlap with device creation and
+    // logical partition setup.  Called once after InitDevices() has created
+    // the block devices the verification needs to read.
+    virtual void StartAvbPreload() {}
+
     bool need_dm_verity_;
     bool dsu_not_on_userdata_ = false;
 
@@ -135,15 +141,21 @@ class FirstStageMountVBootV2 : public FirstStageMount {
     friend void SetInitAvbVersionInRecovery();
 
     FirstStageMountVBootV2(Fstab fstab);
-    ~FirstStageMountVBootV2() override = default;
+    ~FirstStageMountVBootV2() override;
 
   protected:
     bool GetDmVerityDevices(std::set<std::string>* devices) override;
     bool SetUpDmVerity(FstabEntry* fstab_entry) override;
+    void StartAvbPreload() override;
     bool InitAvbHandle();
 
     std::vector<std::string> vbmeta_partitions_;
     AvbUniquePtr avb_handle_;
+    // Loads and verifies the vbmeta images on a worker thread, overlapping
+    // with logical partition creation and the /metadata mount; joined by
+    // InitAvbHandle() before the handle is first used.
+    std::thread avb_preload_thread_;
+    AvbUniquePtr preloaded_avb_handle_;
 };
 
 // Static Functions
@@ -250,6 +262,8 @@ bool FirstStageMount::DoFirstStageMount() {
 
     if (!InitDevices()) return false;
 
+    StartAvbPreload();
+
     if (!MountPartitions()) return false;
 
     return true;
@@ -686,6 +700,25 @@ FirstStageMountVBootV2::FirstStageMountVBootV2(Fstab fstab)
     }
 }
 
+FirstStageMountVBootV2::~FirstStageMountVBootV2() {
+    // The preload thread may still be running if mounting failed before any
+    // partition needed the handle.
+    if (avb_preload_thread_.joinable()) {
+        avb_preload_thread_.join();
+    }
+}
+
+// Reading and verifying the vbmeta images (including all chained partitions)
+// is the bulk of the serialized AVB cost and only needs the vbmeta block
+// devices created by InitDevices(), so it can run concurrently with logical
+// partition creation and the /metadata mount.
+void FirstStageMountVBootV2::StartAvbPreload() {
+    if (!need_dm_verity_ || avb_handle_ || avb_preload_thread_.joinable()) {
+        return;
+    }
+    avb_preload_thread_ = std::thread([this] { preloaded_avb_handle_ = AvbHandle::Open(); });
+}
+
 bool FirstStageMountVBootV2::GetDmVerityDevices(std::set<std::string>* devices) {
     need_dm_verity_ = false;
 
@@ -783,7 +816,12 @@ bool FirstStageMountVBootV2::SetUpDmVerity(FstabEntry* fstab_entry) {
 bool FirstStageMountVBootV2::InitAvbHandle() {
     if (avb_handle_) return true;  // Returns true if the handle is already initialized.
 
-    avb_handle_ = AvbHandle::Open();
+    if (avb_preload_thread_.joinable()) {
+        avb_preload_thread_.join();
+        avb_handle_ = std::move(preloaded_avb_handle_);
+    } else {
+        avb_handle_ = AvbHandle::Open();
+    }
 
     if (!avb_handle_) {
         PLOG(ERROR) << "Failed to open AvbHandle";
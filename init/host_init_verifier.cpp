@@ -22,10 +22,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <algorithm>
+#include <atomic>
 #include <fstream>
 #include <iostream>
 #include <iterator>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <android-base/file.h>
@@ -40,6 +43,7 @@
 #include "action_manager.h"
 #include "action_parser.h"
 #include "check_builtins.h"
+#include "compiled_rc.h"
 #include "host_import_parser.h"
 #include "host_init_stubs.h"
 #include "interface_utils.h"
@@ -94,11 +98,12 @@ static std::vector<std::pair<std::string, int>> GetVendorPasswd() {
 }
 
 passwd* getpwnam(const char* login) {  // NOLINT: implementing bad function.
-    // This isn't thread safe, but that's okay for our purposes.
-    static char static_name[32] = "";
-    static char static_dir[32] = "/";
-    static char static_shell[32] = "/system/bin/sh";
-    static passwd static_passwd = {
+    // Not reentrant, like the real getpwnam, but thread_local so that the
+    // verification worker threads don't stomp on each other's results.
+    thread_local char static_name[32] = "";
+    thread_local char static_dir[32] = "/";
+    thread_local char static_shell[32] = "/system/bin/sh";
+    thread_local passwd static_passwd = {
         .pw_name = static_name,
         .pw_dir = static_dir,
         .pw_shell = static_shell,
@@ -148,12 +153,14 @@ static Result<void> check_stub(const BuiltinArguments& args) {
 #include "generated_stub_builtin_function_map.h"
 
 void PrintUsage() {
-    std::cout << "usage: host_init_verifier [options] <init rc file>\n"
+    std::cout << "usage: host_init_verifier [options] <init rc file> [<init rc file> ...]\n"
                  "\n"
-                 "Tests an init script for correctness\n"
+                 "Tests one or more init scripts for correctness.  Independent scripts are\n"
+                 "verified in parallel.\n"
                  "\n"
                  "-p FILE\tSearch this passwd file for users and groups\n"
                  "--property_contexts=FILE\t Use this file for property_contexts\n"
+                 "--compile=FILE\t After successful verification, write a compiled rc file\n"
               << std::endl;
 }
 
@@ -180,6 +187,26 @@ Result<InterfaceInheritanceHierarchyMap> ReadInterfaceInheritanceHierarchy() {
 
 const PropertyInfoArea* property_info_area;
 
+// Parses and checks a single rc file with its own ActionManager and ServiceList,
+// so independent files can be verified concurrently.  Returns the number of errors.
+static size_t VerifyRcFile(const std::string& path,
+                           const InterfaceInheritanceHierarchyMap& hierarchy) {
+    ActionManager action_manager;
+    ServiceList service_list;
+    Parser parser;
+    parser.AddSectionParser("service",
+                            std::make_unique<ServiceParser>(&service_list, nullptr, hierarchy));
+    parser.AddSectionParser("on", std::make_unique<ActionParser>(&action_manager, nullptr));
+    parser.AddSectionParser("import", std::make_unique<HostImportParser>());
+
+    if (!parser.ParseConfigFileInsecure(path)) {
+        LOG(ERROR) << "Failed to open init rc script '" << path << "'";
+        return 1;
+    }
+    return parser.parse_error_count() + action_manager.CheckAllCommands() +
+           service_list.CheckAllCommands();
+}
+
 void HandlePropertyContexts(const std::string& filename,
                             std::vector<PropertyInfoEntry>* property_infos) {
     auto file_contents = std::string();
@@ -203,12 +230,15 @@ int main(int argc, char** argv) {
     android::base::SetMinimumLogSeverity(android::base::ERROR);
 
     auto property_infos = std::vector<PropertyInfoEntry>();
+    std::string compiled_output;
 
     while (true) {
         static const char kPropertyContexts[] = "property-contexts=";
+        static const char kCompile[] = "compile=";
         static const struct option long_options[] = {
                 {"help", no_argument, nullptr, 'h'},
                 {kPropertyContexts, required_argument, nullptr, 0},
+                {kCompile, required_argument, nullptr, 0},
                 {nullptr, 0, nullptr, 0},
         };
 
@@ -223,6 +253,8 @@ int main(int argc, char** argv) {
             case 0:
                 if (long_options[option_index].name == kPropertyContexts) {
                     HandlePropertyContexts(optarg, &property_infos);
+                } else if (long_options[option_index].name == kCompile) {
+                    compiled_output = optarg;
                 }
                 break;
             case 'h':
@@ -240,11 +272,18 @@ int main(int argc, char** argv) {
     argc -= optind;
     argv += optind;
 
-    if (argc != 1) {
+    if (argc < 1) {
         PrintUsage();
         return EXIT_FAILURE;
     }
 
+    if (!compiled_output.empty() && argc != 1) {
+        LOG(ERROR) << "--compile only supports a single input rc file";
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::string> rc_files(argv, argv + argc);
+
     auto interface_inheritance_hierarchy_map = ReadInterfaceInheritanceHierarchy();
     if (!interface_inheritance_hierarchy_map.ok()) {
         LOG(ERROR) << interface_inheritance_hierarchy_map.error();
@@ -264,24 +303,58 @@ int main(int argc, char** argv) {
 
     const BuiltinFunctionMap& function_map = GetBuiltinFunctionMap();
     Action::set_function_map(&function_map);
-    ActionManager& am = ActionManager::GetInstance();
-    ServiceList& sl = ServiceList::GetInstance();
-    Parser parser;
-    parser.AddSectionParser("service", std::make_unique<ServiceParser>(
-                                               &sl, nullptr, *interface_inheritance_hierarchy_map));
-    parser.AddSectionParser("on", std::make_unique<ActionParser>(&am, nullptr));
-    parser.AddSectionParser("import", std::make_unique<HostImportParser>());
 
-    if (!parser.ParseConfigFileInsecure(*argv)) {
-        LOG(ERROR) << "Failed to open init rc script '" << *argv << "'";
-        return EXIT_FAILURE;
+    // Each file is independent, so hand them out to a worker pool and collect
+    // the per-file error counts afterwards.
+    std::vector<size_t> failures(rc_files.size());
+    std::atomic<size_t> next_file = 0;
+    auto verify_files = [&] {
+        size_t i;
+        while ((i = next_file.fetch_add(1)) < rc_files.size()) {
+            failures[i] = VerifyRcFile(rc_files[i], *interface_inheritance_hierarchy_map);
+        }
+    };
+
+    size_t thread_count = std::min<size_t>(rc_files.size(),
+                                           std::thread::hardware_concurrency() ?: 4);
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < thread_count; ++i) {
+        threads.emplace_back(verify_files);
+    }
+    verify_files();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    bool failed = false;
+    for (size_t i = 0; i < rc_files.size(); ++i) {
+        if (failures[i] > 0) {
+            LOG(ERROR) << "Failed to parse init script '" << rc_files[i] << "' with "
+                       << failures[i] << " errors";
+            failed = true;
+        }
     }
-    size_t failures = parser.parse_error_count() + am.CheckAllCommands() + sl.CheckAllCommands();
-    if (failures > 0) {
-        LOG(ERROR) << "Failed to parse init script '" << *argv << "' with " << failures
-                   << " errors";
+    if (failed) {
         return EXIT_FAILURE;
     }
+
+    if (!compiled_output.empty()) {
+        std::string rc_contents;
+        if (!ReadFileToString(rc_files.front(), &rc_contents)) {
+            PLOG(ERROR) << "Failed to read init rc script '" << rc_files.front() << "'";
+            return EXIT_FAILURE;
+        }
+        auto compiled = CompileRc(std::move(rc_contents));
+        if (!compiled.ok()) {
+            LOG(ERROR) << "Failed to compile init rc script '" << rc_files.front()
+                       << "': " << compiled.error();
+            return EXIT_FAILURE;
+        }
+        if (!android::base::WriteStringToFile(*compiled, compiled_output)) {
+            PLOG(ERROR) << "Failed to write compiled rc file '" << compiled_output << "'";
+            return EXIT_FAILURE;
+        }
+    }
     return EXIT_SUCCESS;
 }
 
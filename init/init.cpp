@@ -26,12 +26,14 @@
 #include <sys/eventfd.h>
 #include <sys/mount.h>
 #include <sys/signalfd.h>
+#include <sys/timerfd.h>
 #include <sys/types.h>
 #include <unistd.h>
 
 #define _REALLY_INCLUDE_SYS__SYSTEM_PROPERTIES_H_
 #include <sys/_system_properties.h>
 
+#include <atomic>
 #include <functional>
 #include <map>
 #include <memory>
@@ -58,6 +60,7 @@
 #include <selinux/android.h>
 
 #include "action_parser.h"
+#include "boot_trace.h"
 #include "builtins.h"
 #include "epoll.h"
 #include "first_stage_init.h"
@@ -103,6 +106,10 @@ static int property_triggers_enabled = 0;
 static int signal_fd = -1;
 static int property_fd = -1;
 
+// Set from the property thread when the framework declares boot complete; the main loop logs the
+// per-handler epoll latency totals once, next to the boot trace dump.
+static std::atomic<bool> dump_epoll_stats{false};
+
 struct PendingControlMessage {
     std::string message;
     std::string name;
@@ -139,6 +146,50 @@ static void WakeMainInitThread() {
     TEMP_FAILURE_RETRY(write(wake_main_thread_fd, &counter, sizeof(counter)));
 }
 
+// Process action deadlines (service restarts and timeouts) are delivered by a CLOCK_BOOTTIME
+// timerfd instead of by shortening the epoll timeout.  The timer only needs re-arming when the
+// earliest deadline changes, so steady-state wakeups drop to zero, and CLOCK_BOOTTIME keeps
+// counting across suspend, which relative epoll timeouts do not.
+static int process_action_timer_fd = -1;
+static void InstallProcessActionTimer(Epoll* epoll) {
+    process_action_timer_fd = timerfd_create(CLOCK_BOOTTIME, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (process_action_timer_fd == -1) {
+        PLOG(FATAL) << "Failed to create timerfd for process actions";
+    }
+    auto clear_timerfd = [] {
+        uint64_t expirations;
+        // Waking the main loop is all that is needed; it re-evaluates process actions each pass.
+        TEMP_FAILURE_RETRY(read(process_action_timer_fd, &expirations, sizeof(expirations)));
+    };
+
+    if (auto result = epoll->RegisterHandler(process_action_timer_fd, clear_timerfd);
+        !result.ok()) {
+        LOG(FATAL) << result.error();
+    }
+}
+
+static void ArmProcessActionTimer(std::optional<boot_clock::time_point> deadline) {
+    static std::optional<boot_clock::time_point> armed_deadline;
+    // An already-due deadline is re-armed unconditionally so that it fires again immediately,
+    // matching the retry behavior of the 0ms epoll timeout this replaces.
+    if (deadline == armed_deadline && (!deadline || *deadline > boot_clock::now())) return;
+
+    itimerspec timer = {};
+    if (deadline) {
+        auto since_epoch = deadline->time_since_epoch();
+        auto seconds = std::chrono::duration_cast<std::chrono::seconds>(since_epoch);
+        timer.it_value.tv_sec = seconds.count();
+        timer.it_value.tv_nsec = (since_epoch - seconds).count();
+        // An all-zero it_value disarms the timer; the deadline epoch itself cannot be missed.
+        if (timer.it_value.tv_sec == 0 && timer.it_value.tv_nsec == 0) timer.it_value.tv_nsec = 1;
+    }
+    if (timerfd_settime(process_action_timer_fd, TFD_TIMER_ABSTIME, &timer, nullptr) == -1) {
+        PLOG(ERROR) << "Failed to arm process action timer";
+        return;
+    }
+    armed_deadline = deadline;
+}
+
 static class PropWaiterState {
   public:
     bool StartWaiting(const char* name, const char* value) {
@@ -336,6 +387,14 @@ void PropertyChanged(const std::string& name, const std::string& value) {
         trigger_shutdown(value);
     }
 
+    // The boot trace covers everything up to the framework declaring boot complete; dump it once
+    // so the timeline of this boot can be compared against other builds.
+    if (name == "sys.boot_completed" && value == "1") {
+        DumpBootTrace();
+        dump_epoll_stats = true;
+        WakeMainInitThread();
+    }
+
     if (property_triggers_enabled) {
         ActionManager::GetInstance().QueuePropertyChange(name, value);
         WakeMainInitThread();
@@ -631,7 +690,10 @@ static void InstallSignalFdHandler(Epoll* epoll) {
         PLOG(FATAL) << "failed to create signalfd";
     }
 
-    if (auto result = epoll->RegisterHandler(signal_fd, HandleSignalFd); !result.ok()) {
+    // High priority: reaping children must not queue behind property or keychord traffic.
+    if (auto result = epoll->RegisterHandler(signal_fd, HandleSignalFd, EPOLLIN,
+                                             Epoll::Priority::kHigh);
+        !result.ok()) {
         LOG(FATAL) << result.error();
     }
 }
@@ -806,6 +868,7 @@ int SecondStageMain(int argc, char** argv) {
 
     InstallSignalFdHandler(&epoll);
     InstallInitNotifier(&epoll);
+    InstallProcessActionTimer(&epoll);
     StartPropertyService(&property_fd);
 
     // Make the time that init stages started available for bootstat to log.
@@ -903,14 +966,8 @@ int SecondStageMain(int argc, char** argv) {
             am.ExecuteOneCommand();
         }
         if (!IsShuttingDown()) {
-            auto next_process_action_time = HandleProcessActions();
-
-            // If there's a process that needs restarting, wake up in time for that.
-            if (next_process_action_time) {
-                epoll_timeout = std::chrono::ceil<std::chrono::milliseconds>(
-                        *next_process_action_time - boot_clock::now());
-                if (*epoll_timeout < 0ms) epoll_timeout = 0ms;
-            }
+            // If there's a process that needs restarting, the timer wakes us in time for that.
+            ArmProcessActionTimer(HandleProcessActions());
         }
 
         if (!(prop_waiter_state.MightBeWaiting() || Service::is_exec_service_running())) {
@@ -930,6 +987,19 @@ int SecondStageMain(int argc, char** argv) {
                 (*function)();
             }
         }
+        if (dump_epoll_stats.exchange(false)) {
+            for (const auto& [fd, stats] : epoll.ExportHandlerStats()) {
+                LOG(INFO) << "epoll handler fd " << fd << ": " << stats.dispatch_count
+                          << " dispatches, "
+                          << std::chrono::duration_cast<std::chrono::microseconds>(
+                                     stats.total_time)
+                                     .count()
+                          << "us total, "
+                          << std::chrono::duration_cast<std::chrono::microseconds>(stats.max_time)
+                                     .count()
+                          << "us max";
+            }
+        }
         if (!IsShuttingDown()) {
             HandleControlMessages();
             SetUsbController();
@@ -24,6 +24,7 @@
 #include <android-base/stringprintf.h>
 #include <android-base/strings.h>
 
+#include "compiled_rc.h"
 #include "tokenizer.h"
 #include "util.h"
 
@@ -40,7 +41,69 @@ void Parser::AddSingleLineParser(const std::string& prefix, LineCallback callbac
     line_callbacks_.emplace_back(prefix, std::move(callback));
 }
 
+void Parser::EndSection(SectionState* state, const std::string& filename) {
+    state->bad_section_found = false;
+    if (state->section_parser == nullptr) return;
+
+    if (auto result = state->section_parser->EndSection(); !result.ok()) {
+        parse_error_count_++;
+        LOG(ERROR) << filename << ": " << state->section_start_line << ": " << result.error();
+    }
+
+    state->section_parser = nullptr;
+    state->section_start_line = -1;
+}
+
+void Parser::ParseLine(std::vector<std::string>&& args, const std::string& filename, int line,
+                       SectionState* state) {
+    // If we have a line matching a prefix we recognize, call its callback and unset any
+    // current section parsers.  This is meant for /sys/ and /dev/ line entries for
+    // uevent.
+    auto line_callback = std::find_if(
+        line_callbacks_.begin(), line_callbacks_.end(),
+        [&args](const auto& c) { return android::base::StartsWith(args[0], c.first); });
+    if (line_callback != line_callbacks_.end()) {
+        EndSection(state, filename);
+
+        if (auto result = line_callback->second(std::move(args)); !result.ok()) {
+            parse_error_count_++;
+            LOG(ERROR) << filename << ": " << line << ": " << result.error();
+        }
+    } else if (section_parsers_.count(args[0])) {
+        EndSection(state, filename);
+        state->section_parser = section_parsers_[args[0]].get();
+        state->section_start_line = line;
+        if (auto result = state->section_parser->ParseSection(std::move(args), filename, line);
+            !result.ok()) {
+            parse_error_count_++;
+            LOG(ERROR) << filename << ": " << line << ": " << result.error();
+            state->section_parser = nullptr;
+            state->bad_section_found = true;
+        }
+    } else if (state->section_parser) {
+        if (auto result = state->section_parser->ParseLineSection(std::move(args), line);
+            !result.ok()) {
+            parse_error_count_++;
+            LOG(ERROR) << filename << ": " << line << ": " << result.error();
+        }
+    } else if (!state->bad_section_found) {
+        parse_error_count_++;
+        LOG(ERROR) << filename << ": " << line << ": Invalid section keyword found";
+    }
+}
+
+void Parser::EndFileCallbacks() {
+    for (const auto& [section_name, section_parser] : section_parsers_) {
+        section_parser->EndFile();
+    }
+}
+
 void Parser::ParseData(const std::string& filename, std::string* data) {
+    if (IsCompiledRc(*data)) {
+        ParseCompiledData(filename, *data);
+        return;
+    }
+
     data->push_back('\n');
     data->push_back('\0');
 
@@ -49,86 +112,97 @@ void Parser::ParseData(const std::string& filename, std::string* data) {
     state.ptr = data->data();
     state.nexttoken = 0;
 
-    SectionParser* section_parser = nullptr;
-    int section_start_line = -1;
+    SectionState section_state;
     std::vector<std::string> args;
 
-    // If we encounter a bad section start, there is no valid parser object to parse the subsequent
-    // sections, so we must suppress errors until the next valid section is found.
-    bool bad_section_found = false;
-
-    auto end_section = [&] {
-        bad_section_found = false;
-        if (section_parser == nullptr) return;
-
-        if (auto result = section_parser->EndSection(); !result.ok()) {
-            parse_error_count_++;
-            LOG(ERROR) << filename << ": " << section_start_line << ": " << result.error();
-        }
-
-        section_parser = nullptr;
-        section_start_line = -1;
-    };
-
     for (;;) {
         switch (next_token(&state)) {
             case T_EOF:
-                end_section();
-
-                for (const auto& [section_name, section_parser] : section_parsers_) {
-                    section_parser->EndFile();
-                }
-
+                EndSection(&section_state, filename);
+                EndFileCallbacks();
                 return;
-            case T_NEWLINE: {
+            case T_NEWLINE:
                 state.line++;
                 if (args.empty()) break;
-                // If we have a line matching a prefix we recognize, call its callback and unset any
-                // current section parsers.  This is meant for /sys/ and /dev/ line entries for
-                // uevent.
-                auto line_callback = std::find_if(
-                    line_callbacks_.begin(), line_callbacks_.end(),
-                    [&args](const auto& c) { return android::base::StartsWith(args[0], c.first); });
-                if (line_callback != line_callbacks_.end()) {
-                    end_section();
-
-                    if (auto result = line_callback->second(std::move(args)); !result.ok()) {
-                        parse_error_count_++;
-                        LOG(ERROR) << filename << ": " << state.line << ": " << result.error();
-                    }
-                } else if (section_parsers_.count(args[0])) {
-                    end_section();
-                    section_parser = section_parsers_[args[0]].get();
-                    section_start_line = state.line;
-                    if (auto result =
-                                section_parser->ParseSection(std::move(args), filename, state.line);
-                        !result.ok()) {
-                        parse_error_count_++;
-                        LOG(ERROR) << filename << ": " << state.line << ": " << result.error();
-                        section_parser = nullptr;
-                        bad_section_found = true;
-                    }
-                } else if (section_parser) {
-                    if (auto result = section_parser->ParseLineSection(std::move(args), state.line);
-                        !result.ok()) {
-                        parse_error_count_++;
-                        LOG(ERROR) << filename << ": " << state.line << ": " << result.error();
-                    }
-                } else if (!bad_section_found) {
-                    parse_error_count_++;
-                    LOG(ERROR) << filename << ": " << state.line
-                               << ": Invalid section keyword found";
-                }
+                ParseLine(std::move(args), filename, state.line, &section_state);
                 args.clear();
                 break;
-            }
             case T_TEXT:
-                args.emplace_back(state.text);
+                // Constructing from the view sizes the string up front instead of re-scanning
+                // the buffer for the terminating NUL.
+                args.emplace_back(state.token());
                 break;
         }
     }
 }
 
+// Walks a compiled rc token stream (see compiled_rc.h). The stream is decoded
+// in place; the only allocations are the argument strings handed to the
+// section parsers, which the text path performs as well.
+void Parser::ParseCompiledData(const std::string& filename, const std::string& data) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data.data());
+    const uint8_t* end = p + data.size();
+    p += sizeof(kCompiledRcMagic);
+
+    auto report = [this, &filename](const char* error) {
+        parse_error_count_++;
+        LOG(ERROR) << filename << ": " << error;
+    };
+
+    if (end - p < 4) {
+        report("truncated compiled rc file");
+        return;
+    }
+    uint32_t version = p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    p += 4;
+    if (version != kCompiledRcVersion) {
+        report("unsupported compiled rc version");
+        return;
+    }
+
+    SectionState section_state;
+    while (p < end) {
+        if (end - p < 6) {
+            report("truncated compiled rc file");
+            break;
+        }
+        uint32_t line = p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+        uint16_t argc = p[4] | (p[5] << 8);
+        p += 6;
+        if (argc == 0) {
+            report("invalid compiled rc record");
+            break;
+        }
+
+        std::vector<std::string> args;
+        args.reserve(argc);
+        bool truncated = false;
+        for (uint16_t i = 0; i < argc; ++i) {
+            if (end - p < 2) {
+                truncated = true;
+                break;
+            }
+            uint16_t length = p[0] | (p[1] << 8);
+            p += 2;
+            if (end - p < length) {
+                truncated = true;
+                break;
+            }
+            args.emplace_back(reinterpret_cast<const char*>(p), length);
+            p += length;
+        }
+        if (truncated) {
+            report("truncated compiled rc file");
+            break;
+        }
+
+        ParseLine(std::move(args), filename, static_cast<int>(line), &section_state);
+    }
+
+    EndSection(&section_state, filename);
+    EndFileCallbacks();
+}
+
 bool Parser::ParseConfigFileInsecure(const std::string& path) {
     std::string config_contents;
     if (!android::base::ReadFileToString(path, &config_contents)) {
@@ -82,7 +82,22 @@ class Parser {
     size_t parse_error_count() const { return parse_error_count_; }
 
   private:
+    // Tracks the section being parsed across lines; shared between the text
+    // and compiled parsing paths.
+    struct SectionState {
+        SectionParser* section_parser = nullptr;
+        int section_start_line = -1;
+        // If we encounter a bad section start, there is no valid parser object to parse the
+        // subsequent sections, so we must suppress errors until the next valid section is found.
+        bool bad_section_found = false;
+    };
+
+    void EndSection(SectionState* state, const std::string& filename);
+    void ParseLine(std::vector<std::string>&& args, const std::string& filename, int line,
+                   SectionState* state);
+    void EndFileCallbacks();
     void ParseData(const std::string& filename, std::string* data);
+    void ParseCompiledData(const std::string& filename, const std::string& data);
     bool ParseConfigDir(const std::string& path);
 
     std::map<std::string, std::unique_ptr<SectionParser>> section_parsers_;
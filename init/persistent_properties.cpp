@@ -46,6 +46,11 @@ namespace {
 
 constexpr const char kLegacyPersistentPropertyDir[] = "/data/property";
 
+// Individual property sets are journaled as one small appending write each
+// rather than rewriting the whole persistent property file; once the journal
+// grows past this size it is folded back into the main file.
+constexpr uint64_t kJournalMaxSize = 32768;
+
 void AddPersistentProperty(const std::string& name, const std::string& value,
                            PersistentProperties* persistent_properties) {
     auto persistent_property_record = persistent_properties->add_properties();
@@ -53,6 +58,103 @@ void AddPersistentProperty(const std::string& name, const std::string& value,
     persistent_property_record->set_value(value);
 }
 
+void UpdateOrAddPersistentProperty(const std::string& name, const std::string& value,
+                                   PersistentProperties* persistent_properties) {
+    auto it = std::find_if(persistent_properties->mutable_properties()->begin(),
+                           persistent_properties->mutable_properties()->end(),
+                           [&name](const auto& record) { return record.name() == name; });
+    if (it != persistent_properties->mutable_properties()->end()) {
+        it->set_name(name);
+        it->set_value(value);
+    } else {
+        AddPersistentProperty(name, value, persistent_properties);
+    }
+}
+
+std::string PersistentPropertyJournalFilename() {
+    return persistent_property_filename + ".journal";
+}
+
+// Appends a single property set to the journal as a length-framed
+// PersistentProperties message and returns the resulting journal size.  The
+// framing lets replay recover every entry before a torn tail write.
+Result<uint64_t> AppendPersistentPropertyJournal(const std::string& name,
+                                                 const std::string& value) {
+    PersistentProperties entry;
+    AddPersistentProperty(name, value, &entry);
+    std::string serialized_entry;
+    if (!entry.SerializeToString(&serialized_entry)) {
+        return Error() << "Unable to serialize journal entry";
+    }
+
+    std::string framed_entry;
+    uint32_t length = serialized_entry.size();
+    for (size_t i = 0; i < sizeof(length); ++i) {
+        framed_entry.push_back(static_cast<char>((length >> (8 * i)) & 0xff));
+    }
+    framed_entry += serialized_entry;
+
+    unique_fd fd(TEMP_FAILURE_RETRY(open(PersistentPropertyJournalFilename().c_str(),
+                                         O_WRONLY | O_APPEND | O_CREAT | O_NOFOLLOW | O_CLOEXEC,
+                                         0600)));
+    if (fd == -1) {
+        return ErrnoError() << "Could not open journal file";
+    }
+    if (!WriteStringToFd(framed_entry, fd)) {
+        return ErrnoError() << "Unable to write journal entry";
+    }
+    fsync(fd);
+
+    struct stat sb;
+    if (fstat(fd, &sb) == -1) {
+        return ErrnoError() << "Unable to stat journal file";
+    }
+    return sb.st_size;
+}
+
+// Applies the journaled property sets, in order, on top of the given
+// properties.  Returns the number of entries applied.  Replay stops at the
+// first entry that cannot be decoded, which covers a write torn by a power
+// cut; everything before it is still recovered.
+size_t ReplayPersistentPropertyJournal(PersistentProperties* persistent_properties) {
+    std::string journal_contents;
+    if (!android::base::ReadFileToString(PersistentPropertyJournalFilename(),
+                                         &journal_contents)) {
+        return 0;
+    }
+
+    size_t entries_applied = 0;
+    size_t offset = 0;
+    while (offset < journal_contents.size()) {
+        if (journal_contents.size() - offset < sizeof(uint32_t)) {
+            LOG(ERROR) << "Torn persistent property journal entry; discarding tail";
+            break;
+        }
+        uint32_t length = 0;
+        for (size_t i = 0; i < sizeof(length); ++i) {
+            length |= static_cast<uint8_t>(journal_contents[offset + i]) << (8 * i);
+        }
+        offset += sizeof(length);
+        if (journal_contents.size() - offset < length) {
+            LOG(ERROR) << "Torn persistent property journal entry; discarding tail";
+            break;
+        }
+
+        PersistentProperties entry;
+        if (!entry.ParseFromArray(journal_contents.data() + offset, length)) {
+            LOG(ERROR) << "Could not parse persistent property journal entry; discarding tail";
+            break;
+        }
+        offset += length;
+
+        for (const auto& record : entry.properties()) {
+            UpdateOrAddPersistentProperty(record.name(), record.value(), persistent_properties);
+        }
+        ++entries_applied;
+    }
+    return entries_applied;
+}
+
 Result<PersistentProperties> LoadLegacyPersistentProperties() {
     std::unique_ptr<DIR, decltype(&closedir)> dir(opendir(kLegacyPersistentPropertyDir), closedir);
     if (!dir) {
@@ -193,6 +295,11 @@ Result<void> WritePersistentPropertyFile(const PersistentProperties& persistent_
         return Error(saved_errno) << "Unable to rename persistent property file";
     }
 
+    // The full state just written supersedes any journaled sets, so remove the journal.  If we
+    // crash before the unlink reaches storage, replaying the journal over the new file only
+    // re-applies values the file already contains.
+    unlink(PersistentPropertyJournalFilename().c_str());
+
     // rename() is atomic with regards to the kernel's filesystem buffers, but the parent
     // directories must be fsync()'ed otherwise, the rename is not necessarily written to storage.
     // Note in this case, that the source and destination directories are the same, so only one
@@ -207,25 +314,28 @@ Result<void> WritePersistentPropertyFile(const PersistentProperties& persistent_
     return {};
 }
 
-// Persistent properties are not written often, so we rather not keep any data in memory and read
-// then rewrite the persistent property file for each update.
+// Each update is one small appending journal write; the full property file is only rewritten
+// when the journal grows past kJournalMaxSize (or if journaling fails), which bounds the write
+// amplification of frequent persist.* sets.
 void WritePersistentProperty(const std::string& name, const std::string& value) {
-    auto persistent_properties = LoadPersistentPropertyFile();
+    auto journal_size = AppendPersistentPropertyJournal(name, value);
+    if (journal_size.ok() && *journal_size <= kJournalMaxSize) {
+        return;
+    }
+    if (!journal_size.ok()) {
+        LOG(ERROR) << "Could not journal persistent property: " << journal_size.error();
+    }
 
+    // Compact: fold the journal (and this update) back into the property file.
+    auto persistent_properties = LoadPersistentPropertyFile();
     if (!persistent_properties.ok()) {
         LOG(ERROR) << "Recovering persistent properties from memory: "
                    << persistent_properties.error();
         persistent_properties = LoadPersistentPropertiesFromMemory();
-    }
-    auto it = std::find_if(persistent_properties->mutable_properties()->begin(),
-                           persistent_properties->mutable_properties()->end(),
-                           [&name](const auto& record) { return record.name() == name; });
-    if (it != persistent_properties->mutable_properties()->end()) {
-        it->set_name(name);
-        it->set_value(value);
     } else {
-        AddPersistentProperty(name, value, &persistent_properties.value());
+        ReplayPersistentPropertyJournal(&persistent_properties.value());
     }
+    UpdateOrAddPersistentProperty(name, value, &persistent_properties.value());
 
     if (auto result = WritePersistentPropertyFile(*persistent_properties); !result.ok()) {
         LOG(ERROR) << "Could not store persistent property: " << result.error();
@@ -235,17 +345,28 @@ void WritePersistentProperty(const std::string& name, const std::string& value)
 PersistentProperties LoadPersistentProperties() {
     auto persistent_properties = LoadPersistentPropertyFile();
 
+    bool loaded_legacy = false;
     if (!persistent_properties.ok()) {
         LOG(ERROR) << "Could not load single persistent property file, trying legacy directory: "
                    << persistent_properties.error();
         persistent_properties = LoadLegacyPersistentProperties();
-        if (!persistent_properties.ok()) {
+        if (persistent_properties.ok()) {
+            loaded_legacy = true;
+        } else {
             LOG(ERROR) << "Unable to load legacy persistent properties: "
                        << persistent_properties.error();
-            return {};
+            // Fall through with no properties; sets journaled before a failed write of the
+            // main file can still be recovered below.
+            persistent_properties = PersistentProperties{};
         }
+    }
+
+    // Replay journaled sets on top of whatever base loaded, then compact so each boot starts
+    // with an empty journal.
+    size_t journal_entries = ReplayPersistentPropertyJournal(&persistent_properties.value());
+    if (loaded_legacy || journal_entries > 0) {
         if (auto result = WritePersistentPropertyFile(*persistent_properties); result.ok()) {
-            RemoveLegacyPersistentPropertyFiles();
+            if (loaded_legacy) RemoveLegacyPersistentPropertyFiles();
         } else {
             LOG(ERROR) << "Unable to write single persistent property file: " << result.error();
             // Fall through so that we still set the properties that we've read.
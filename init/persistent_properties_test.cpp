@@ -17,6 +17,7 @@
 #include "persistent_properties.h"
 
 #include <errno.h>
+#include <unistd.h>
 
 #include <vector>
 
@@ -135,6 +136,64 @@ TEST(persistent_properties, UpdateProperty) {
     CheckPropertiesEqual(persistent_properties_expected, read_back_properties);
 }
 
+TEST(persistent_properties, JournaledUpdatesAreReplayedAndCompacted) {
+    TemporaryFile tf;
+    ASSERT_TRUE(tf.fd != -1);
+    persistent_property_filename = tf.path;
+    std::string journal_filename = std::string(tf.path) + ".journal";
+
+    std::vector<std::pair<std::string, std::string>> persistent_properties = {
+        {"persist.sys.locale", "en-US"},
+    };
+    ASSERT_RESULT_OK(
+            WritePersistentPropertyFile(VectorToPersistentProperties(persistent_properties)));
+
+    // Each set should land in the journal without rewriting the main file.
+    WritePersistentProperty("persist.sys.locale", "pt-BR");
+    WritePersistentProperty("persist.sys.timezone", "America/Sao_Paulo");
+    EXPECT_EQ(0, access(journal_filename.c_str(), F_OK));
+
+    std::vector<std::pair<std::string, std::string>> persistent_properties_expected = {
+        {"persist.sys.locale", "pt-BR"},
+        {"persist.sys.timezone", "America/Sao_Paulo"},
+    };
+
+    auto read_back_properties = LoadPersistentProperties();
+    CheckPropertiesEqual(persistent_properties_expected, read_back_properties);
+
+    // Loading compacts the journal into the main file.
+    EXPECT_EQ(-1, access(journal_filename.c_str(), F_OK));
+    read_back_properties = LoadPersistentProperties();
+    CheckPropertiesEqual(persistent_properties_expected, read_back_properties);
+}
+
+TEST(persistent_properties, TornJournalEntryIsDiscarded) {
+    TemporaryFile tf;
+    ASSERT_TRUE(tf.fd != -1);
+    persistent_property_filename = tf.path;
+    std::string journal_filename = std::string(tf.path) + ".journal";
+
+    ASSERT_RESULT_OK(WritePersistentPropertyFile(
+            VectorToPersistentProperties({{"persist.sys.locale", "en-US"}})));
+
+    WritePersistentProperty("persist.sys.timezone", "America/Sao_Paulo");
+
+    // Simulate a write torn by a power cut: chop bytes off the final entry.
+    std::string journal_contents;
+    ASSERT_TRUE(android::base::ReadFileToString(journal_filename, &journal_contents));
+    ASSERT_TRUE(android::base::WriteStringToFile(
+            journal_contents + journal_contents.substr(0, journal_contents.size() - 2),
+            journal_filename));
+
+    std::vector<std::pair<std::string, std::string>> persistent_properties_expected = {
+        {"persist.sys.locale", "en-US"},
+        {"persist.sys.timezone", "America/Sao_Paulo"},
+    };
+
+    auto read_back_properties = LoadPersistentProperties();
+    CheckPropertiesEqual(persistent_properties_expected, read_back_properties);
+}
+
 TEST(persistent_properties, UpdatePropertyBadParse) {
     TemporaryFile tf;
     ASSERT_TRUE(tf.fd != -1);
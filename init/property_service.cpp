@@ -55,6 +55,7 @@
 #include <android-base/properties.h>
 #include <android-base/stringprintf.h>
 #include <android-base/strings.h>
+#include <private/android_filesystem_config.h>
 #include <property_info_parser/property_info_parser.h>
 #include <property_info_serializer/property_info_serializer.h>
 #include <selinux/android.h>
@@ -68,6 +69,7 @@
 #include "property_type.h"
 #include "proto_utils.h"
 #include "second_stage_resources.h"
+#include "selabel.h"
 #include "selinux.h"
 #include "subcontext.h"
 #include "system/core/init/property_service.pb.h"
@@ -89,6 +91,7 @@ using android::properties::BuildTrie;
 using android::properties::ParsePropertyInfoFile;
 using android::properties::PropertyInfoAreaFile;
 using android::properties::PropertyInfoEntry;
+using android::properties::PropertyInfoLookupCache;
 using android::sysprop::InitProperties::is_userspace_reboot_supported;
 
 namespace android {
@@ -96,7 +99,11 @@ namespace init {
 
 static bool persistent_properties_loaded = false;
 
+// Restricted property socket for system clients; see StartPropertyService().
+static constexpr const char kPropertyServiceForSystemSocket[] = "property_service_for_system";
+
 static int property_set_fd = -1;
+static int property_set_for_system_fd = -1;
 static int from_init_socket = -1;
 static int init_socket = -1;
 static bool accept_messages = false;
@@ -105,6 +112,11 @@ static std::thread property_service_thread;
 
 static PropertyInfoAreaFile property_info_area;
 
+// Property sets cluster under the same prefixes, so memoizing the last trie walk saves most of
+// the per-segment binary searches.  Lookups happen both on the property service thread and on
+// init's main thread (InitPropertySet, property file parsing), hence thread_local.
+static thread_local PropertyInfoLookupCache property_info_lookup_cache;
+
 struct PropertyAuditData {
     const ucred* cr;
     const char* name;
@@ -135,7 +147,8 @@ void StopSendingMessages() {
 
 bool CanReadProperty(const std::string& source_context, const std::string& name) {
     const char* target_context = nullptr;
-    property_info_area->GetPropertyInfo(name.c_str(), &target_context, nullptr);
+    property_info_area->GetPropertyInfo(name.c_str(), &target_context, nullptr,
+                                        &property_info_lookup_cache);
 
     PropertyAuditData audit_data;
 
@@ -230,7 +243,8 @@ class AsyncRestorecon {
             paths_.pop();
 
             lock.unlock();
-            if (selinux_android_restorecon(path.c_str(), SELINUX_ANDROID_RESTORECON_RECURSE) != 0) {
+            if (!SelabelRestoreconParallel(path, SELINUX_ANDROID_RESTORECON_RECURSE,
+                                           std::thread::hardware_concurrency() ?: 4)) {
                 LOG(ERROR) << "Asynchronous restorecon of '" << path << "' failed'";
             }
             android::base::SetProperty(kRestoreconProperty, path);
@@ -453,7 +467,8 @@ uint32_t CheckPermissions(const std::string& name, const std::string& value,
 
     const char* target_context = nullptr;
     const char* type = nullptr;
-    property_info_area->GetPropertyInfo(name.c_str(), &target_context, &type);
+    property_info_area->GetPropertyInfo(name.c_str(), &target_context, &type,
+                                        &property_info_lookup_cache);
 
     if (!CheckMacPerms(name, target_context, source_context.c_str(), cr)) {
         *error = "SELinux permission check failed";
@@ -516,14 +531,9 @@ uint32_t HandlePropertySet(const std::string& name, const std::string& value,
     return PropertySet(name, value, error);
 }
 
-static void handle_property_set_fd() {
+static void HandlePropertyConnection(int s) {
     static constexpr uint32_t kDefaultSocketTimeout = 2000; /* ms */
 
-    int s = accept4(property_set_fd, nullptr, nullptr, SOCK_CLOEXEC);
-    if (s == -1) {
-        return;
-    }
-
     ucred cr;
     socklen_t cr_size = sizeof(cr);
     if (getsockopt(s, SOL_SOCKET, SO_PEERCRED, &cr, &cr_size) < 0) {
@@ -609,6 +619,25 @@ static void handle_property_set_fd() {
     }
 }
 
+static void handle_property_set_for_system_fd() {
+    int s;
+    while ((s = accept4(property_set_for_system_fd, nullptr, nullptr, SOCK_CLOEXEC)) != -1) {
+        HandlePropertyConnection(s);
+    }
+}
+
+static void handle_property_set_fd() {
+    // Drain every connection queued on the socket in one pass instead of taking one epoll
+    // wakeup per setprop; boot-time bursts of hundreds of sets are applied back to back.
+    int s;
+    while ((s = accept4(property_set_fd, nullptr, nullptr, SOCK_CLOEXEC)) != -1) {
+        // The restricted socket is the priority lane: anything queued there (e.g. a
+        // sys.powerctl set from system_server) is handled before the next bulk connection.
+        handle_property_set_for_system_fd();
+        HandlePropertyConnection(s);
+    }
+}
+
 uint32_t InitPropertySet(const std::string& name, const std::string& value) {
     uint32_t result = 0;
     ucred cr = {.pid = 1, .uid = 0, .gid = 0};
@@ -1132,6 +1161,16 @@ void PropertyInit() {
         LOG(FATAL) << "Failed to load serialized property info file";
     }
 
+    // Touch every page of the mapped property info area now, while init is the only process
+    // running, rather than taking the faults one at a time on the property service thread once
+    // boot-critical services start setting properties.  The serializer lays hot trie nodes out
+    // in the leading pages, so even a partial read-ahead covers most lookups.
+    auto* property_info_pages =
+            reinterpret_cast<const volatile char*>(property_info_area.operator->());
+    for (size_t i = 0; i < property_info_area->size(); i += 4096) {
+        property_info_pages[i];
+    }
+
     // If arguments are passed both on the command line and in DT,
     // properties set in DT always have priority over the command-line ones.
     ProcessKernelDt();
@@ -1181,7 +1220,17 @@ static void PropertyServiceThread() {
         LOG(FATAL) << result.error();
     }
 
-    if (auto result = epoll.RegisterHandler(property_set_fd, handle_property_set_fd);
+    // The public property sockets are batch priority so that a property storm cannot starve
+    // messages from init on init_socket.
+    if (auto result = epoll.RegisterHandler(property_set_fd, handle_property_set_fd, EPOLLIN,
+                                            Epoll::Priority::kBatch);
+        !result.ok()) {
+        LOG(FATAL) << result.error();
+    }
+
+    if (auto result = epoll.RegisterHandler(property_set_for_system_fd,
+                                            handle_property_set_for_system_fd, EPOLLIN,
+                                            Epoll::Priority::kBatch);
         !result.ok()) {
         LOG(FATAL) << result.error();
     }
@@ -1223,6 +1272,21 @@ void StartPropertyService(int* epoll_socket) {
 
     listen(property_set_fd, 8);
 
+    // A second, system-only socket that is drained ahead of the public one, so that critical
+    // sets such as sys.powerctl never wait behind bulk setprop traffic from other clients.
+    // Clients that do not know about this socket simply keep using the public one.
+    if (auto result =
+                CreateSocket(kPropertyServiceForSystemSocket,
+                             SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, false, 0660, 0,
+                             AID_SYSTEM, {});
+        result.ok()) {
+        property_set_for_system_fd = *result;
+    } else {
+        LOG(FATAL) << "start_property_service socket creation failed: " << result.error();
+    }
+
+    listen(property_set_for_system_fd, 8);
+
     auto new_thread = std::thread{PropertyServiceThread};
     property_service_thread.swap(new_thread);
 }
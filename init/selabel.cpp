@@ -16,6 +16,19 @@
 
 #include "selabel.h"
 
+#include <dirent.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
 #include <selinux/android.h>
 
 namespace android {
@@ -24,7 +37,50 @@ namespace init {
 namespace {
 
 selabel_handle* sehandle = nullptr;
-}
+
+// Shared state between the directory walker and the labeling threads of
+// SelabelRestoreconParallel().
+struct RestoreconWorkQueue {
+    void Push(std::string path) {
+        {
+            auto guard = std::lock_guard{lock};
+            paths.emplace_back(std::move(path));
+        }
+        cv.notify_one();
+    }
+
+    void Finish() {
+        {
+            auto guard = std::lock_guard{lock};
+            done = true;
+        }
+        cv.notify_all();
+    }
+
+    void Work(int flags) {
+        auto guard = std::unique_lock{lock};
+        while (true) {
+            cv.wait(guard, [this] { return !paths.empty() || done; });
+            if (paths.empty()) return;
+            auto path = std::move(paths.front());
+            paths.pop_front();
+
+            guard.unlock();
+            if (selinux_android_restorecon(path.c_str(), flags) < 0) {
+                result = errno;
+            }
+            guard.lock();
+        }
+    }
+
+    std::mutex lock;
+    std::condition_variable cv;
+    std::deque<std::string> paths;
+    bool done = false;
+    std::atomic<int> result{0};
+};
+
+}  // namespace
 
 // selinux_android_file_context_handle() takes on the order of 10+ms to run, so we want to cache
 // its value.  selinux_android_restorecon() also needs an sehandle for file context look up.  It
@@ -75,5 +131,89 @@ bool SelabelLookupFileContextBestMatch(const std::string& key,
     return true;
 }
 
+// A parallel counterpart to selinux_android_restorecon() with
+// SELINUX_ANDROID_RESTORECON_RECURSE: the calling thread walks the tree breadth first and labels
+// each directory before descending into it, so a directory's context is always restored before
+// the contexts of its contents; everything else is handed to a pool of labeling threads, whose
+// relative order does not matter.  The walk does not consult or write the security.sehash xattr,
+// i.e. it behaves as if SELINUX_ANDROID_RESTORECON_SKIP_SEHASH were set, and it does not
+// implement SELINUX_ANDROID_RESTORECON_SKIPCE's subtree pruning; callers needing either should
+// call selinux_android_restorecon() directly.
+bool SelabelRestoreconParallel(const std::string& path, int flags, int nthreads) {
+    if (!(flags & SELINUX_ANDROID_RESTORECON_RECURSE)) {
+        return selinux_android_restorecon(path.c_str(), flags) == 0;
+    }
+    // Each call below labels a single inode; recursion is handled by the walk.
+    int entry_flags =
+            flags & ~(SELINUX_ANDROID_RESTORECON_RECURSE | SELINUX_ANDROID_RESTORECON_SKIP_SEHASH);
+
+    struct stat root_stat;
+    if (lstat(path.c_str(), &root_stat) < 0) {
+        return false;
+    }
+
+    RestoreconWorkQueue queue;
+    std::vector<std::thread> threads;
+    for (int i = 1; i < nthreads; ++i) {
+        threads.emplace_back(&RestoreconWorkQueue::Work, &queue, entry_flags);
+    }
+
+    if (selinux_android_restorecon(path.c_str(), entry_flags) < 0) {
+        queue.result = errno;
+    }
+
+    std::deque<std::string> pending_dirs;
+    if (S_ISDIR(root_stat.st_mode)) {
+        pending_dirs.emplace_back(path);
+    }
+    while (!pending_dirs.empty()) {
+        auto dir = std::move(pending_dirs.front());
+        pending_dirs.pop_front();
+
+        std::unique_ptr<DIR, decltype(&closedir)> d(opendir(dir.c_str()), closedir);
+        if (!d) {
+            queue.result = errno;
+            continue;
+        }
+        while (struct dirent* entry = readdir(d.get())) {
+            if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, "..")) continue;
+            auto child = dir + "/" + entry->d_name;
+
+            struct stat st;
+            if (lstat(child.c_str(), &st) < 0) {
+                queue.result = errno;
+                continue;
+            }
+            if (!(flags & SELINUX_ANDROID_RESTORECON_CROSS_FILESYSTEMS) &&
+                st.st_dev != root_stat.st_dev) {
+                continue;
+            }
+            if (S_ISDIR(st.st_mode)) {
+                // Label the directory here, on the walking thread, so that it is relabeled
+                // before anything within it.
+                if (selinux_android_restorecon(child.c_str(), entry_flags) < 0) {
+                    queue.result = errno;
+                }
+                pending_dirs.emplace_back(std::move(child));
+            } else {
+                queue.Push(std::move(child));
+            }
+        }
+    }
+
+    queue.Finish();
+    // The walking thread joins the labeling pool until the queue drains.
+    queue.Work(entry_flags);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    if (queue.result != 0) {
+        errno = queue.result;
+        return false;
+    }
+    return true;
+}
+
 }  // namespace init
 }  // namespace android
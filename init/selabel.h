@@ -27,6 +27,7 @@ bool SelabelLookupFileContext(const std::string& key, int type, std::string* res
 bool SelabelLookupFileContextBestMatch(const std::string& key,
                                        const std::vector<std::string>& aliases, int type,
                                        std::string* result);
+bool SelabelRestoreconParallel(const std::string& path, int flags, int nthreads);
 
 }  // namespace init
 }  // namespace android
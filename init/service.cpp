@@ -36,6 +36,7 @@
 #include <processgroup/processgroup.h>
 #include <selinux/selinux.h>
 
+#include "boot_trace.h"
 #include "lmkd_service.h"
 #include "service_list.h"
 #include "util.h"
@@ -256,6 +257,16 @@ void Service::SetProcessAttributesAndCaps() {
     }
 }
 
+void Service::CloseDescriptorCache() {
+    if (!descriptor_cache_) return;
+    descriptor_cache_.reset();
+    descriptor_cache_context_.clear();
+    for (const auto& socket : sockets_) {
+        auto path = ANDROID_SOCKET_DIR "/" + socket.name;
+        unlink(path.c_str());
+    }
+}
+
 void Service::Reap(const siginfo_t& siginfo) {
     if (!(flags_ & SVC_ONESHOT) || (flags_ & SVC_RESTART)) {
         KillProcessGroup(SIGKILL, false);
@@ -270,10 +281,14 @@ void Service::Reap(const siginfo_t& siginfo) {
         }
     }
 
-    // Remove any socket resources we may have created.
-    for (const auto& socket : sockets_) {
-        auto path = ANDROID_SOCKET_DIR "/" + socket.name;
-        unlink(path.c_str());
+    // Cached sockets stay open and bound so the next Start() can republish them without
+    // recreating them; their filesystem entries must stay in place for that.
+    if (!descriptor_cache_) {
+        // Remove any socket resources we may have created.
+        for (const auto& socket : sockets_) {
+            auto path = ANDROID_SOCKET_DIR "/" + socket.name;
+            unlink(path.c_str());
+        }
     }
 
     for (const auto& f : reap_callbacks_) {
@@ -391,6 +406,28 @@ Result<void> Service::ExecStart() {
     return {};
 }
 
+Result<std::string> Service::ComputeProcessContext() const {
+    if (!seclabel_.empty()) {
+        return seclabel_;
+    }
+    return ComputeContextFromExecutable(args_[0]);
+}
+
+// The context a service runs in depends only on its executable's label (or an
+// explicit seclabel option), so it can be computed before Start().  The
+// getfilecon()/security_compute_create() round trips are the bulk of the
+// parent-side work when starting a class of services; class_start computes
+// them on worker threads before its serial start loop.  Errors are not
+// reported here: Start() recomputes and reports them in its usual place.
+void Service::PrefetchProcessContext() {
+    if (flags_ & SVC_RUNNING) {
+        return;
+    }
+    if (auto context = ComputeProcessContext(); context.ok()) {
+        prefetched_context_ = std::move(*context);
+    }
+}
+
 Result<void> Service::Start() {
     auto reboot_on_failure = make_scope_guard([this] {
         if (on_failure_reboot_target_) {
@@ -424,6 +461,8 @@ Result<void> Service::Start() {
         return {};
     }
 
+    RecordBootEvent("starting service " + name_);
+
     bool needs_console = (flags_ & SVC_CONSOLE);
     if (needs_console) {
         if (proc_attr_.console.empty()) {
@@ -447,10 +486,11 @@ Result<void> Service::Start() {
     }
 
     std::string scon;
-    if (!seclabel_.empty()) {
-        scon = seclabel_;
+    if (!prefetched_context_.empty()) {
+        scon = std::move(prefetched_context_);
+        prefetched_context_.clear();
     } else {
-        auto result = ComputeContextFromExecutable(args_[0]);
+        auto result = ComputeProcessContext();
         if (!result.ok()) {
             return result.error();
         }
@@ -479,21 +519,32 @@ Result<void> Service::Start() {
 
     LOG(INFO) << "starting service '" << name_ << "'...";
 
-    std::vector<Descriptor> descriptors;
-    for (const auto& socket : sockets_) {
-        if (auto result = socket.Create(scon); result.ok()) {
-            descriptors.emplace_back(std::move(*result));
-        } else {
-            LOG(INFO) << "Could not create socket '" << socket.name << "': " << result.error();
-        }
+    // Cached descriptors were created with the process context of the previous start; if the
+    // context changed, their SELinux labels are stale and they must be rebuilt.
+    if (descriptor_cache_ && descriptor_cache_context_ != scon) {
+        CloseDescriptorCache();
     }
 
-    for (const auto& file : files_) {
-        if (auto result = file.Create(); result.ok()) {
-            descriptors.emplace_back(std::move(*result));
-        } else {
-            LOG(INFO) << "Could not open file '" << file.name << "': " << result.error();
+    if (!descriptor_cache_) {
+        std::vector<Descriptor> descriptors;
+        for (const auto& socket : sockets_) {
+            if (auto result = socket.Create(scon); result.ok()) {
+                descriptors.emplace_back(std::move(*result));
+            } else {
+                LOG(INFO) << "Could not create socket '" << socket.name << "': " << result.error();
+            }
         }
+
+        for (const auto& file : files_) {
+            if (auto result = file.Create(); result.ok()) {
+                descriptors.emplace_back(std::move(*result));
+            } else {
+                LOG(INFO) << "Could not open file '" << file.name << "': " << result.error();
+            }
+        }
+
+        descriptor_cache_ = std::move(descriptors);
+        descriptor_cache_context_ = scon;
     }
 
     pid_t pid = -1;
@@ -516,7 +567,7 @@ Result<void> Service::Start() {
             setenv(key.c_str(), value.c_str(), 1);
         }
 
-        for (const auto& descriptor : descriptors) {
+        for (const auto& descriptor : *descriptor_cache_) {
             descriptor.Publish();
         }
 
@@ -610,6 +661,7 @@ Result<void> Service::Start() {
         LmkdRegister(name_, proc_attr_.uid, pid_, oom_score_adjust_);
     }
 
+    RecordBootEvent("started service " + name_);
     NotifyStateChange("running");
     reboot_on_failure.Disable();
     return {};
@@ -78,6 +78,10 @@ class Service {
     bool IsRunning() { return (flags_ & SVC_RUNNING) != 0; }
     bool IsEnabled() { return (flags_ & SVC_DISABLED) == 0; }
     Result<void> ExecStart();
+    // Computes and caches the SELinux process context Start() will use.  Safe
+    // to call from a worker thread, so that class_start can overlap the
+    // context computations of the services it is about to start.
+    void PrefetchProcessContext();
     Result<void> Start();
     Result<void> StartIfNotDisabled();
     Result<void> StartIfPostData();
@@ -139,6 +143,8 @@ class Service {
     }
 
   private:
+    Result<std::string> ComputeProcessContext() const;
+    void CloseDescriptorCache();
     void NotifyStateChange(const std::string& new_state) const;
     void StopOrReset(int how);
     void KillProcessGroup(int signal, bool report_oneshot = false);
@@ -161,9 +167,18 @@ class Service {
     NamespaceInfo namespaces_;
 
     std::string seclabel_;
+    // Context computed ahead of time by PrefetchProcessContext(); consumed by
+    // the next Start().
+    std::string prefetched_context_;
 
     std::vector<SocketDescriptor> sockets_;
     std::vector<FileDescriptor> files_;
+    // Descriptors created by the last Start() are kept open across restarts of the same service
+    // definition, so crash-looping and frequently-restarted oneshot services skip the socket and
+    // file setup cost each cycle.  Rebuilt if the process security context changes; a reloaded
+    // definition is a new Service object and starts with an empty cache.
+    std::optional<std::vector<Descriptor>> descriptor_cache_;
+    std::string descriptor_cache_context_;
     std::vector<std::pair<std::string, std::string>> environment_vars_;
 
     Action onrestart_;  // Commands to execute on restart.
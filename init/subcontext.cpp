@@ -16,12 +16,23 @@
 
 #include "subcontext.h"
 
+#include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <linux/memfd.h>
 #include <poll.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
 #include <sys/time.h>
 #include <sys/resource.h>
 #include <unistd.h>
 
+#include <atomic>
+#include <chrono>
+#include <optional>
+
 #include <android-base/file.h>
 #include <android-base/logging.h>
 #include <android-base/properties.h>
@@ -50,8 +61,121 @@ using android::base::Split;
 using android::base::StartsWith;
 using android::base::unique_fd;
 
+using namespace std::chrono_literals;
+
 namespace android {
 namespace init {
+
+namespace {
+
+long FutexWait(std::atomic<uint32_t>* addr, uint32_t expected, const timespec* timeout = nullptr) {
+    return syscall(__NR_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAIT, expected, timeout,
+                   nullptr, 0);
+}
+
+void FutexWake(std::atomic<uint32_t>* addr) {
+    syscall(__NR_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAKE, INT_MAX, nullptr, nullptr,
+            0);
+}
+
+// Whether the peer's end of the setup socket has been closed, which is how we
+// detect that it died while blocked on the shared-memory channel.
+bool SocketClosed(int fd) {
+    pollfd ufd = {.fd = fd, .events = 0, .revents = 0};
+    if (TEMP_FAILURE_RETRY(poll(&ufd, 1, 0)) <= 0) {
+        return false;
+    }
+    return ufd.revents & (POLLHUP | POLLERR | POLLNVAL);
+}
+
+}  // namespace
+
+// A single-producer single-consumer ring of message slots, shared between init
+// and a subcontext.  Both sides block on futexes, so a steady-state
+// command/result exchange costs a pair of futex syscalls per direction instead
+// of the send/poll/recv round trip of the setup socket, and up to kNumSlots
+// commands can be queued ahead of the reader.
+struct SubcontextChannelRing {
+    static constexpr uint32_t kNumSlots = 8;  // must be a power of two
+    static constexpr uint32_t kSlotDataSize = 4096 - sizeof(uint32_t);
+    // Marks a message too large for a slot.  Its payload travels over the
+    // setup socket instead; the slot only preserves ordering.
+    static constexpr uint32_t kViaSocket = UINT32_MAX;
+
+    struct Message {
+        bool via_socket;
+        std::string data;
+    };
+
+    // Queues a message, blocking if the ring is full.  Returns false if the
+    // message did not fit in a slot and must be sent over the setup socket.
+    bool Write(const std::string& message) {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        uint32_t tail;
+        while ((tail = tail_.load(std::memory_order_acquire)) == head - kNumSlots) {
+            FutexWait(&tail_, tail);
+        }
+
+        auto& slot = slots_[head % kNumSlots];
+        if (message.size() > kSlotDataSize) {
+            slot.size = kViaSocket;
+        } else {
+            slot.size = message.size();
+            memcpy(slot.data, message.data(), message.size());
+        }
+        head_.store(head + 1, std::memory_order_release);
+        FutexWake(&head_);
+        return slot.size != kViaSocket;
+    }
+
+    // Dequeues the next message, waiting up to timeout for one to arrive so
+    // that callers can periodically check whether the peer is still alive.
+    std::optional<Message> Read(std::chrono::milliseconds timeout) {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        while (head_.load(std::memory_order_acquire) == tail) {
+            timespec ts = {.tv_sec = static_cast<time_t>(timeout.count() / 1000),
+                           .tv_nsec = static_cast<long>((timeout.count() % 1000) * 1000000)};
+            if (FutexWait(&head_, tail, &ts) == -1 && errno == ETIMEDOUT) {
+                return {};
+            }
+        }
+
+        const auto& slot = slots_[tail % kNumSlots];
+        auto message = Message{};
+        if (slot.size == kViaSocket) {
+            message.via_socket = true;
+        } else {
+            message.via_socket = false;
+            message.data.assign(slot.data, slot.size);
+        }
+        tail_.store(tail + 1, std::memory_order_release);
+        FutexWake(&tail_);
+        return message;
+    }
+
+  private:
+    std::atomic<uint32_t> head_;  // next slot the writer fills
+    std::atomic<uint32_t> tail_;  // next slot the reader drains
+    struct Slot {
+        uint32_t size;
+        char data[kSlotDataSize];
+    };
+    Slot slots_[kNumSlots];
+};
+
+struct SubcontextChannel {
+    SubcontextChannelRing to_subcontext;
+    SubcontextChannelRing to_init;
+};
+
+static Result<SubcontextChannel*> MapSubcontextChannel(int fd) {
+    void* map = mmap(nullptr, sizeof(SubcontextChannel), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        return ErrnoError() << "Could not map subcontext channel";
+    }
+    return static_cast<SubcontextChannel*>(map);
+}
+
 namespace {
 
 std::string shutdown_command;
@@ -60,8 +184,12 @@ static std::unique_ptr<Subcontext> subcontext;
 
 class SubcontextProcess {
   public:
-    SubcontextProcess(const BuiltinFunctionMap* function_map, std::string context, int init_fd)
-        : function_map_(function_map), context_(std::move(context)), init_fd_(init_fd){};
+    SubcontextProcess(const BuiltinFunctionMap* function_map, std::string context, int init_fd,
+                      SubcontextChannel* channel)
+        : function_map_(function_map),
+          context_(std::move(context)),
+          init_fd_(init_fd),
+          channel_(channel){};
     void MainLoop();
 
   private:
@@ -73,6 +201,7 @@ class SubcontextProcess {
     const BuiltinFunctionMap* function_map_;
     const std::string context_;
     const int init_fd_;
+    SubcontextChannel* channel_;
 };
 
 void SubcontextProcess::RunCommand(const SubcontextCommand::ExecuteCommand& execute_command,
@@ -117,31 +246,35 @@ void SubcontextProcess::ExpandArgs(const SubcontextCommand::ExpandArgsCommand& e
 }
 
 void SubcontextProcess::MainLoop() {
-    pollfd ufd[1];
-    ufd[0].events = POLLIN;
-    ufd[0].fd = init_fd_;
-
     while (true) {
-        ufd[0].revents = 0;
-        int nr = TEMP_FAILURE_RETRY(poll(ufd, arraysize(ufd), -1));
-        if (nr == 0) continue;
-        if (nr < 0) {
-            PLOG(FATAL) << "poll() of subcontext socket failed, continuing";
+        auto message = channel_->to_subcontext.Read(10s);
+        if (!message) {
+            // No command for a while.  If init closed its end of the setup
+            // socket, let's exit quietly. If this was accidental, init will
+            // restart us. If init died, this avoids calling abort(3)
+            // unnecessarily.
+            if (SocketClosed(init_fd_)) {
+                return;
+            }
+            continue;
         }
 
-        auto init_message = ReadMessage(init_fd_);
-        if (!init_message.ok()) {
-            if (init_message.error().code() == 0) {
-                // If the init file descriptor was closed, let's exit quietly. If
-                // this was accidental, init will restart us. If init died, this
-                // avoids calling abort(3) unnecessarily.
-                return;
+        auto init_message = std::string();
+        if (message->via_socket) {
+            auto result = ReadMessage(init_fd_);
+            if (!result.ok()) {
+                if (result.error().code() == 0) {
+                    return;
+                }
+                LOG(FATAL) << "Could not read message from init: " << result.error();
             }
-            LOG(FATAL) << "Could not read message from init: " << init_message.error();
+            init_message = std::move(*result);
+        } else {
+            init_message = std::move(message->data);
         }
 
         auto subcontext_command = SubcontextCommand();
-        if (!subcontext_command.ParseFromString(*init_message)) {
+        if (!subcontext_command.ParseFromString(init_message)) {
             LOG(FATAL) << "Unable to parse message from init";
         }
 
@@ -165,8 +298,10 @@ void SubcontextProcess::MainLoop() {
             shutdown_command.clear();
         }
 
-        if (auto result = SendMessage(init_fd_, reply); !result.ok()) {
-            LOG(FATAL) << "Failed to send message to init: " << result.error();
+        if (!channel_->to_init.Write(reply.SerializeAsString())) {
+            if (auto result = SendMessage(init_fd_, reply); !result.ok()) {
+                LOG(FATAL) << "Failed to send message to init: " << result.error();
+            }
         }
     }
 }
@@ -174,16 +309,23 @@ void SubcontextProcess::MainLoop() {
 }  // namespace
 
 int SubcontextMain(int argc, char** argv, const BuiltinFunctionMap* function_map) {
-    if (argc < 4) LOG(FATAL) << "Fewer than 4 args specified to subcontext (" << argc << ")";
+    if (argc < 5) LOG(FATAL) << "Fewer than 5 args specified to subcontext (" << argc << ")";
 
     auto context = std::string(argv[2]);
     auto init_fd = std::atoi(argv[3]);
+    auto channel_fd = std::atoi(argv[4]);
+
+    auto channel = MapSubcontextChannel(channel_fd);
+    if (!channel.ok()) {
+        LOG(FATAL) << channel.error();
+    }
+    close(channel_fd);
 
     SelabelInitialize();
 
     trigger_shutdown = [](const std::string& command) { shutdown_command = command; };
 
-    auto subcontext_process = SubcontextProcess(function_map, context, init_fd);
+    auto subcontext_process = SubcontextProcess(function_map, context, init_fd, *channel);
     // Restore prio before main loop
     setpriority(PRIO_PROCESS, 0, 0);
     subcontext_process.MainLoop();
@@ -197,6 +339,23 @@ void Subcontext::Fork() {
         return;
     }
 
+    unique_fd channel_fd(syscall(__NR_memfd_create, "subcontext_channel", MFD_CLOEXEC));
+    if (channel_fd < 0) {
+        PLOG(FATAL) << "Could not create subcontext channel";
+        return;
+    }
+    if (ftruncate(channel_fd, sizeof(SubcontextChannel)) < 0) {
+        PLOG(FATAL) << "Could not size subcontext channel";
+        return;
+    }
+    auto channel = MapSubcontextChannel(channel_fd);
+    if (!channel.ok()) {
+        LOG(FATAL) << channel.error();
+        return;
+    }
+    // memfd pages start zeroed, so both rings start out empty.
+    channel_ = *channel;
+
     auto result = fork();
 
     if (result == -1) {
@@ -211,6 +370,11 @@ void Subcontext::Fork() {
             PLOG(FATAL) << "Could not dup child_fd";
         }
 
+        int child_channel_fd = dup(channel_fd);  // NOLINT(android-cloexec-dup)
+        if (child_channel_fd < 0) {
+            PLOG(FATAL) << "Could not dup child_channel_fd";
+        }
+
         // We don't switch contexts if we're running the unit tests.  We don't use std::optional,
         // since we still need a real context string to pass to the builtin functions.
         if (context_ != kTestContext) {
@@ -227,8 +391,10 @@ void Subcontext::Fork() {
 #endif
         auto init_path = GetExecutablePath();
         auto child_fd_string = std::to_string(child_fd);
-        const char* args[] = {init_path.c_str(), "subcontext", context_.c_str(),
-                              child_fd_string.c_str(), nullptr};
+        auto child_channel_fd_string = std::to_string(child_channel_fd);
+        const char* args[] = {init_path.c_str(),        "subcontext",
+                              context_.c_str(),         child_fd_string.c_str(),
+                              child_channel_fd_string.c_str(), nullptr};
         execv(init_path.data(), const_cast<char**>(args));
 
         PLOG(FATAL) << "Could not execv subcontext init";
@@ -246,6 +412,10 @@ void Subcontext::Restart() {
     }
     pid_ = 0;
     socket_.reset();
+    if (channel_) {
+        munmap(channel_, sizeof(SubcontextChannel));
+        channel_ = nullptr;
+    }
     Fork();
 }
 
@@ -259,19 +429,37 @@ bool Subcontext::PathMatchesSubcontext(const std::string& path) {
 }
 
 Result<SubcontextReply> Subcontext::TransmitMessage(const SubcontextCommand& subcontext_command) {
-    if (auto result = SendMessage(socket_, subcontext_command); !result.ok()) {
-        Restart();
-        return ErrnoError() << "Failed to send message to subcontext";
+    if (!channel_->to_subcontext.Write(subcontext_command.SerializeAsString())) {
+        if (auto result = SendMessage(socket_, subcontext_command); !result.ok()) {
+            Restart();
+            return ErrnoError() << "Failed to send message to subcontext";
+        }
     }
 
-    auto subcontext_message = ReadMessage(socket_);
-    if (!subcontext_message.ok()) {
-        Restart();
-        return Error() << "Failed to receive result from subcontext: " << subcontext_message.error();
+    std::optional<SubcontextChannelRing::Message> message;
+    while (!(message = channel_->to_init.Read(250ms))) {
+        // The subcontext can't hang up the channel like it would a socket, so
+        // check the setup socket for liveness while waiting for its reply.
+        if (SocketClosed(socket_)) {
+            Restart();
+            return Error() << "Failed to receive result from subcontext: subcontext died";
+        }
+    }
+
+    auto subcontext_message = std::string();
+    if (message->via_socket) {
+        auto result = ReadMessage(socket_);
+        if (!result.ok()) {
+            Restart();
+            return Error() << "Failed to receive result from subcontext: " << result.error();
+        }
+        subcontext_message = std::move(*result);
+    } else {
+        subcontext_message = std::move(message->data);
     }
 
     auto subcontext_reply = SubcontextReply{};
-    if (!subcontext_reply.ParseFromString(*subcontext_message)) {
+    if (!subcontext_reply.ParseFromString(subcontext_message)) {
         Restart();
         return Error() << "Unable to parse message from subcontext";
     }
@@ -34,6 +34,8 @@ static constexpr const char kInitContext[] = "u:r:init:s0";
 static constexpr const char kVendorContext[] = "u:r:vendor_init:s0";
 static constexpr const char kTestContext[] = "test-test-test";
 
+struct SubcontextChannel;
+
 class Subcontext {
   public:
     Subcontext(std::vector<std::string> path_prefixes, std::string context)
@@ -57,6 +59,9 @@ class Subcontext {
     std::string context_;
     pid_t pid_;
     android::base::unique_fd socket_;
+    // Shared-memory rings for command/result exchange; the socket above is
+    // kept for setup, oversized messages, and liveness checks.
+    SubcontextChannel* channel_ = nullptr;
 };
 
 int SubcontextMain(int argc, char** argv, const BuiltinFunctionMap* function_map);
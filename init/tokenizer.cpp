@@ -46,6 +46,7 @@ int next_token(struct parse_state *state)
 
 textdone:
     state->ptr = x;
+    state->text_end = s;
     *s = 0;
     return T_TEXT;
 text:
@@ -17,6 +17,8 @@
 #ifndef _INIT_TOKENIZER_H_
 #define _INIT_TOKENIZER_H_
 
+#include <string_view>
+
 #define T_EOF 0
 #define T_TEXT 1
 #define T_NEWLINE 2
@@ -28,8 +30,14 @@ struct parse_state
 {
     char *ptr;
     char *text;
+    char *text_end;
     int line;
     int nexttoken;
+
+    // The most recent T_TEXT token as a view of the input buffer, valid until the next call to
+    // next_token().  The tokenizer already records where the token ends, so this avoids
+    // re-scanning for the terminating NUL when the token is consumed.
+    std::string_view token() const { return std::string_view(text, text_end - text); }
 };
 
 int next_token(struct parse_state *state);
@@ -49,7 +49,10 @@ void RunTest(const std::string& data, const std::vector<std::vector<std::string>
                 current_line.clear();
                 break;
             case T_TEXT:
-                current_line.emplace_back(state.text);
+                // Consume through the string_view accessor so every test also verifies that
+                // token() spans exactly the NUL-terminated token text.
+                EXPECT_EQ(state.token(), std::string_view{state.text}) << data;
+                current_line.emplace_back(state.token());
                 break;
         }
     }
@@ -33,6 +33,14 @@ struct Uevent {
     int partition_num;
     int major;
     int minor;
+
+    bool operator==(const Uevent& other) const {
+        return action == other.action && path == other.path && subsystem == other.subsystem &&
+               firmware == other.firmware && partition_name == other.partition_name &&
+               device_name == other.device_name && modalias == other.modalias &&
+               partition_num == other.partition_num && major == other.major &&
+               minor == other.minor;
+    }
 };
 
 }  // namespace init
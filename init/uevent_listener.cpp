@@ -22,6 +22,7 @@
 #include <unistd.h>
 
 #include <memory>
+#include <unordered_map>
 
 #include <android-base/logging.h>
 #include <cutils/uevent.h>
@@ -86,6 +87,47 @@ static void ParseEvent(const char* msg, Uevent* uevent) {
     }
 }
 
+void CompactUevents(std::vector<Uevent>* uevents) {
+    std::vector<bool> dropped(uevents->size(), false);
+    // For each devpath whose most recent events in the batch began with an "add", the indices of
+    // those events, in order.  Only such runs may be cancelled by a later "remove".
+    std::unordered_map<std::string, std::vector<size_t>> pending_adds;
+
+    for (size_t i = 0; i < uevents->size(); ++i) {
+        const auto& uevent = (*uevents)[i];
+        auto it = pending_adds.find(uevent.path);
+
+        if (uevent.action == "add") {
+            if (it != pending_adds.end() &&
+                (*uevents)[it->second.front()] == uevent) {
+                dropped[i] = true;
+                continue;
+            }
+            pending_adds[uevent.path] = {i};
+        } else if (uevent.action == "remove") {
+            if (it != pending_adds.end()) {
+                for (auto index : it->second) {
+                    dropped[index] = true;
+                }
+                dropped[i] = true;
+                pending_adds.erase(it);
+            }
+        } else {
+            if (it != pending_adds.end()) {
+                it->second.emplace_back(i);
+            }
+        }
+    }
+
+    size_t next = 0;
+    for (size_t i = 0; i < uevents->size(); ++i) {
+        if (dropped[i]) continue;
+        if (next != i) (*uevents)[next] = std::move((*uevents)[i]);
+        ++next;
+    }
+    uevents->resize(next);
+}
+
 UeventListener::UeventListener(size_t uevent_socket_rcvbuf_size) {
     device_fd_.reset(uevent_open_socket(uevent_socket_rcvbuf_size, true));
     if (device_fd_ == -1) {
@@ -223,5 +265,57 @@ void UeventListener::Poll(const ListenerCallback& callback,
     }
 }
 
+// Like Poll(), but everything queued on the socket is drained into a batch and compacted with
+// CompactUevents() before any of it is dispatched, rather than fully processing one uevent per
+// read.  This suppresses the redundant work that bursts of duplicate or self-cancelling events
+// would otherwise cause.
+void UeventListener::PollBatched(const ListenerCallback& callback,
+                                 const std::optional<std::chrono::milliseconds> relative_timeout) const {
+    using namespace std::chrono;
+
+    pollfd ufd;
+    ufd.events = POLLIN;
+    ufd.fd = device_fd_;
+
+    auto start_time = steady_clock::now();
+
+    while (true) {
+        ufd.revents = 0;
+
+        int timeout_ms = -1;
+        if (relative_timeout) {
+            auto now = steady_clock::now();
+            auto time_elapsed = duration_cast<milliseconds>(now - start_time);
+            if (time_elapsed > *relative_timeout) return;
+
+            auto remaining_timeout = *relative_timeout - time_elapsed;
+            timeout_ms = remaining_timeout.count();
+        }
+
+        int nr = poll(&ufd, 1, timeout_ms);
+        if (nr == 0) return;
+        if (nr < 0) {
+            PLOG(ERROR) << "poll() of uevent socket failed, continuing";
+            continue;
+        }
+        if (ufd.revents & POLLIN) {
+            uevent_batch_.clear();
+
+            Uevent uevent;
+            ReadUeventResult result;
+            while ((result = ReadUevent(&uevent)) != ReadUeventResult::kFailed) {
+                // Skip processing the uevent if it is invalid.
+                if (result == ReadUeventResult::kInvalid) continue;
+                uevent_batch_.emplace_back(std::move(uevent));
+            }
+
+            CompactUevents(&uevent_batch_);
+            for (const auto& queued : uevent_batch_) {
+                if (callback(queued) == ListenerAction::kStop) return;
+            }
+        }
+    }
+}
+
 }  // namespace init
 }  // namespace android
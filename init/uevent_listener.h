@@ -22,6 +22,7 @@
 #include <chrono>
 #include <functional>
 #include <optional>
+#include <vector>
 
 #include <android-base/unique_fd.h>
 
@@ -45,6 +46,16 @@ enum class ReadUeventResult {
 
 using ListenerCallback = std::function<ListenerAction(const Uevent&)>;
 
+// Removes redundant events from a batch drained from the uevent socket, preserving the relative
+// order of everything that remains:
+// 1) An "add" identical to the most recent kept "add" for the same devpath is dropped; these are
+//    common when uevent regeneration races with the real events during cold boot.
+// 2) An "add" followed in the same batch by a "remove" for the same devpath is dropped along with
+//    the "remove" and any events for that devpath in between, as the device is already gone.
+// A devpath whose first event in the batch is not an "add" is never compacted, so a "remove"
+// matching an "add" dispatched from an earlier batch is always delivered.
+void CompactUevents(std::vector<Uevent>* uevents);
+
 class UeventListener {
   public:
     UeventListener(size_t uevent_socket_rcvbuf_size);
@@ -54,12 +65,16 @@ class UeventListener {
                                             const ListenerCallback& callback) const;
     void Poll(const ListenerCallback& callback,
               const std::optional<std::chrono::milliseconds> relative_timeout = {}) const;
+    void PollBatched(const ListenerCallback& callback,
+                     const std::optional<std::chrono::milliseconds> relative_timeout = {}) const;
 
   private:
     ReadUeventResult ReadUevent(Uevent* uevent) const;
     ListenerAction RegenerateUeventsForDir(DIR* d, const ListenerCallback& callback) const;
 
     android::base::unique_fd device_fd_;
+    // Reused by PollBatched() across drains to avoid reallocating per batch.
+    mutable std::vector<Uevent> uevent_batch_;
 };
 
 }  // namespace init
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "uevent_listener.h"
+
+#include <gtest/gtest.h>
+
+namespace android {
+namespace init {
+
+namespace {
+
+Uevent MakeUevent(const std::string& action, const std::string& path) {
+    Uevent uevent;
+    uevent.action = action;
+    uevent.path = path;
+    uevent.partition_num = -1;
+    uevent.major = -1;
+    uevent.minor = -1;
+    return uevent;
+}
+
+}  // namespace
+
+TEST(uevent_listener, CompactUeventsCollapsesDuplicateAdds) {
+    std::vector<Uevent> uevents = {
+            MakeUevent("add", "/devices/platform/soc/a"),
+            MakeUevent("add", "/devices/platform/soc/b"),
+            MakeUevent("add", "/devices/platform/soc/a"),
+    };
+
+    CompactUevents(&uevents);
+
+    ASSERT_EQ(2u, uevents.size());
+    EXPECT_EQ("/devices/platform/soc/a", uevents[0].path);
+    EXPECT_EQ("/devices/platform/soc/b", uevents[1].path);
+}
+
+TEST(uevent_listener, CompactUeventsCancelsAddRemovePairs) {
+    std::vector<Uevent> uevents = {
+            MakeUevent("add", "/devices/platform/soc/a"),
+            MakeUevent("change", "/devices/platform/soc/a"),
+            MakeUevent("add", "/devices/platform/soc/b"),
+            MakeUevent("remove", "/devices/platform/soc/a"),
+    };
+
+    CompactUevents(&uevents);
+
+    // The device came and went within the batch, so only the unrelated add remains.
+    ASSERT_EQ(1u, uevents.size());
+    EXPECT_EQ("add", uevents[0].action);
+    EXPECT_EQ("/devices/platform/soc/b", uevents[0].path);
+}
+
+TEST(uevent_listener, CompactUeventsKeepsReAdd) {
+    std::vector<Uevent> uevents = {
+            MakeUevent("add", "/devices/platform/soc/a"),
+            MakeUevent("remove", "/devices/platform/soc/a"),
+            MakeUevent("add", "/devices/platform/soc/a"),
+    };
+
+    CompactUevents(&uevents);
+
+    ASSERT_EQ(1u, uevents.size());
+    EXPECT_EQ("add", uevents[0].action);
+}
+
+TEST(uevent_listener, CompactUeventsKeepsUnmatchedRemove) {
+    // The matching add was dispatched from an earlier batch; the remove must go through.
+    std::vector<Uevent> uevents = {
+            MakeUevent("change", "/devices/platform/soc/a"),
+            MakeUevent("remove", "/devices/platform/soc/a"),
+    };
+
+    CompactUevents(&uevents);
+
+    ASSERT_EQ(2u, uevents.size());
+    EXPECT_EQ("change", uevents[0].action);
+    EXPECT_EQ("remove", uevents[1].action);
+}
+
+}  // namespace init
+}  // namespace android
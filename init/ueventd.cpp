@@ -187,6 +187,9 @@ void ColdBoot::RegenerateUevents() {
         uevent_queue_.emplace_back(uevent);
         return ListenerAction::kContinue;
     });
+    // Regeneration can race with the real uevents and deliver the same device more than once;
+    // compact the queue so the handler subprocesses don't repeat mknod/selabel work.
+    CompactUevents(&uevent_queue_);
 }
 
 void ColdBoot::ForkSubProcesses() {
@@ -323,7 +326,7 @@ int ueventd_main(int argc, char** argv) {
 
     // Restore prio before main loop
     setpriority(PRIO_PROCESS, 0, 0);
-    uevent_listener.Poll([&uevent_handlers](const Uevent& uevent) {
+    uevent_listener.PollBatched([&uevent_handlers](const Uevent& uevent) {
         for (auto& uevent_handler : uevent_handlers) {
             uevent_handler->HandleUevent(uevent);
         }
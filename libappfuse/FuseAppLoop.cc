@@ -19,7 +19,13 @@
 #include <sys/eventfd.h>
 #include <sys/stat.h>
 
+#include <condition_variable>
+#include <deque>
+#include <thread>
+#include <vector>
+
 #include <android-base/logging.h>
+#include <android-base/macros.h>
 #include <android-base/unique_fd.h>
 
 #include "libappfuse/EpollController.h"
@@ -85,11 +91,7 @@ bool HandleWrite(FuseAppLoop* loop, FuseBuffer* buffer, FuseAppLoopCallback* cal
     return true;
 }
 
-bool HandleMessage(FuseAppLoop* loop, FuseBuffer* buffer, int fd, FuseAppLoopCallback* callback) {
-    if (!buffer->request.Read(fd)) {
-        return false;
-    }
-
+bool DispatchMessage(FuseAppLoop* loop, FuseBuffer* buffer, int fd, FuseAppLoopCallback* callback) {
     const uint32_t opcode = buffer->request.header.opcode;
     LOG(VERBOSE) << "Read a fuse packet, opcode=" << opcode;
     switch (opcode) {
@@ -127,11 +129,124 @@ bool HandleMessage(FuseAppLoop* loop, FuseBuffer* buffer, int fd, FuseAppLoopCal
     }
 }
 
+bool HandleMessage(FuseAppLoop* loop, FuseBuffer* buffer, int fd, FuseAppLoopCallback* callback) {
+    if (!buffer->request.Read(fd)) {
+        return false;
+    }
+
+    return DispatchMessage(loop, buffer, fd, callback);
+}
+
 } // namespace
 
+// Routes requests read by the |Start| thread to a small pool of worker
+// threads. A request always goes to the worker picked by its nodeid, so
+// operations on one file are handled in the order they arrived while files
+// on different workers proceed in parallel.
+class FuseAppDispatcher {
+  public:
+    FuseAppDispatcher(FuseAppLoop* loop, FuseAppLoopCallback* callback, int fd, int thread_count)
+        : loop_(loop), callback_(callback), fd_(fd) {
+        workers_.resize(thread_count);
+        for (auto& worker : workers_) {
+            worker.reset(new Worker());
+            worker->thread = std::thread(&FuseAppDispatcher::Run, this, worker.get());
+        }
+    }
+
+    // Lets every worker drain its queue, then joins them.
+    ~FuseAppDispatcher() {
+        for (auto& worker : workers_) {
+            {
+                std::lock_guard<std::mutex> lock(worker->mutex);
+                worker->exit = true;
+            }
+            worker->cond.notify_one();
+        }
+        for (auto& worker : workers_) {
+            worker->thread.join();
+        }
+    }
+
+    // Returns a buffer to read the next request into, reusing a previously
+    // recycled one when possible so that a streaming workload does not
+    // allocate 128KB per request.
+    std::unique_ptr<FuseBuffer> ObtainBuffer() {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        if (buffer_pool_.empty()) {
+            return std::unique_ptr<FuseBuffer>(new FuseBuffer());
+        }
+        std::unique_ptr<FuseBuffer> buffer = std::move(buffer_pool_.back());
+        buffer_pool_.pop_back();
+        return buffer;
+    }
+
+    void Dispatch(std::unique_ptr<FuseBuffer> buffer) {
+        Worker* const worker =
+            workers_[buffer->request.header.nodeid % workers_.size()].get();
+        {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+            worker->queue.push_back(std::move(buffer));
+        }
+        worker->cond.notify_one();
+    }
+
+  private:
+    struct Worker {
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable cond;
+        std::deque<std::unique_ptr<FuseBuffer>> queue;
+        bool exit = false;
+    };
+
+    void Run(Worker* worker) {
+        while (true) {
+            std::unique_ptr<FuseBuffer> buffer;
+            {
+                std::unique_lock<std::mutex> lock(worker->mutex);
+                worker->cond.wait(lock,
+                                  [worker] { return worker->exit || !worker->queue.empty(); });
+                if (worker->queue.empty()) {
+                    return;
+                }
+                buffer = std::move(worker->queue.front());
+                worker->queue.pop_front();
+            }
+            if (!DispatchMessage(loop_, buffer.get(), fd_, callback_)) {
+                loop_->Break();
+            }
+            RecycleBuffer(std::move(buffer));
+        }
+    }
+
+    void RecycleBuffer(std::unique_ptr<FuseBuffer> buffer) {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        if (buffer_pool_.size() < workers_.size() * 2) {
+            buffer_pool_.push_back(std::move(buffer));
+        }
+    }
+
+    FuseAppLoop* const loop_;
+    FuseAppLoopCallback* const callback_;
+    const int fd_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+
+    std::mutex pool_mutex_;
+    std::vector<std::unique_ptr<FuseBuffer>> buffer_pool_;
+
+    DISALLOW_COPY_AND_ASSIGN(FuseAppDispatcher);
+};
+
 FuseAppLoopCallback::~FuseAppLoopCallback() = default;
 
-FuseAppLoop::FuseAppLoop(base::unique_fd&& fd) : fd_(std::move(fd)) {}
+FuseAppLoop::FuseAppLoop(base::unique_fd&& fd) : fd_(std::move(fd)), dispatch_thread_count_(0) {}
+
+FuseAppLoop::~FuseAppLoop() = default;
+
+void FuseAppLoop::SetDispatchThreadCount(int count) {
+    dispatch_thread_count_ = count;
+}
 
 void FuseAppLoop::Break() {
     const int64_t value = 1;
@@ -223,6 +338,10 @@ void FuseAppLoop::Start(FuseAppLoopCallback* callback) {
     last_event = 0;
     break_event = 0;
 
+    if (dispatch_thread_count_ > 0) {
+        dispatcher_.reset(new FuseAppDispatcher(this, callback, fd_, dispatch_thread_count_));
+    }
+
     FuseBuffer buffer;
     while (true) {
         if (!epoll_controller->Wait(1)) {
@@ -236,11 +355,20 @@ void FuseAppLoop::Start(FuseAppLoopCallback* callback) {
             break;
         }
 
-        if (!HandleMessage(this, &buffer, fd_, callback)) {
+        if (dispatcher_) {
+            std::unique_ptr<FuseBuffer> dispatch_buffer = dispatcher_->ObtainBuffer();
+            if (!dispatch_buffer->request.Read(fd_)) {
+                break;
+            }
+            dispatcher_->Dispatch(std::move(dispatch_buffer));
+        } else if (!HandleMessage(this, &buffer, fd_, callback)) {
             break;
         }
     }
 
+    // Joins the workers after they drain their queues.
+    dispatcher_.reset();
+
     LOG(VERBOSE) << "FuseAppLoop exit";
 }
 
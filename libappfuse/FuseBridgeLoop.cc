@@ -58,6 +58,15 @@ void GetObservedEvents(FuseBridgeState state, int* device_events, int* proxy_eve
     }
 }
 
+// Maximum number of proxy replies to forward on one epoll wake-up. Both ends
+// of a bridge carry whole FUSE messages whose headers have to be parsed in
+// user space, so the payload cannot bypass |buffer_|; what can be saved is the
+// epoll round trip per message. While an app streams reads or writes the
+// proxy stays ahead of the loop, and draining the socket here amortizes
+// epoll_wait over every reply already queued. The cap keeps one busy mount
+// from starving the other bridges on the same loop.
+constexpr int kMaxProxyMessagesPerWakeup = 16;
+
 void LogResponseError(const std::string& message, const FuseResponse& response) {
     LOG(ERROR) << message << ": header.len=" << response.header.len
                << " header.error=" << response.header.error
@@ -132,42 +141,46 @@ class FuseBridgeEntry {
     friend class BridgeEpollController;
 
     FuseBridgeState ReadFromProxy() {
-        switch (buffer_.response.ReadOrAgain(proxy_fd_)) {
-            case ResultOrAgain::kSuccess:
-                break;
-            case ResultOrAgain::kFailure:
-                return FuseBridgeState::kClosing;
-            case ResultOrAgain::kAgain:
-                return FuseBridgeState::kWaitToReadProxy;
-        }
+        for (int i = 0; i < kMaxProxyMessagesPerWakeup; ++i) {
+            switch (buffer_.response.ReadOrAgain(proxy_fd_)) {
+                case ResultOrAgain::kSuccess:
+                    break;
+                case ResultOrAgain::kFailure:
+                    return FuseBridgeState::kClosing;
+                case ResultOrAgain::kAgain:
+                    // The proxy socket is drained.
+                    return i == 0 ? FuseBridgeState::kWaitToReadProxy
+                                  : FuseBridgeState::kWaitToReadEither;
+            }
 
-        if (!buffer_.response.Write(device_fd_)) {
-            LogResponseError("Failed to write a reply from proxy to device", buffer_.response);
-            return FuseBridgeState::kClosing;
-        }
+            if (!buffer_.response.Write(device_fd_)) {
+                LogResponseError("Failed to write a reply from proxy to device", buffer_.response);
+                return FuseBridgeState::kClosing;
+            }
 
-        auto it = opcode_map_.find(buffer_.response.header.unique);
-        if (it != opcode_map_.end()) {
-            switch (it->second) {
-                case FUSE_OPEN:
-                    if (buffer_.response.header.error == fuse::kFuseSuccess) {
-                        open_count_++;
-                    }
-                    break;
+            auto it = opcode_map_.find(buffer_.response.header.unique);
+            if (it != opcode_map_.end()) {
+                switch (it->second) {
+                    case FUSE_OPEN:
+                        if (buffer_.response.header.error == fuse::kFuseSuccess) {
+                            open_count_++;
+                        }
+                        break;
 
-                case FUSE_RELEASE:
-                    if (open_count_ > 0) {
-                        open_count_--;
-                    } else {
-                        LOG(WARNING) << "Unexpected FUSE_RELEASE before opening a file.";
+                    case FUSE_RELEASE:
+                        if (open_count_ > 0) {
+                            open_count_--;
+                        } else {
+                            LOG(WARNING) << "Unexpected FUSE_RELEASE before opening a file.";
+                            break;
+                        }
+                        if (open_count_ == 0) {
+                            return FuseBridgeState::kClosing;
+                        }
                         break;
-                    }
-                    if (open_count_ == 0) {
-                        return FuseBridgeState::kClosing;
-                    }
-                    break;
+                }
+                opcode_map_.erase(it);
             }
-            opcode_map_.erase(it);
         }
 
         return FuseBridgeState::kWaitToReadEither;
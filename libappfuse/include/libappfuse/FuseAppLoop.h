@@ -28,6 +28,7 @@ namespace android {
 namespace fuse {
 
 class EpollController;
+class FuseAppDispatcher;
 
 class FuseAppLoopCallback {
  public:
@@ -45,10 +46,18 @@ class FuseAppLoopCallback {
 class FuseAppLoop final {
   public:
     FuseAppLoop(base::unique_fd&& fd);
+    ~FuseAppLoop();
 
     void Start(FuseAppLoopCallback* callback);
     void Break();
 
+    // Number of worker threads invoking the callback; 0 (the default) handles
+    // every request on the thread which invokes |Start|. Requests are routed
+    // to a worker by nodeid, so operations on one file keep their order while
+    // a slow read on one file no longer stalls the others. The callback must
+    // tolerate being invoked on multiple threads. Call before |Start|.
+    void SetDispatchThreadCount(int count);
+
     bool ReplySimple(uint64_t unique, int32_t result);
     bool ReplyLookup(uint64_t unique, uint64_t inode, int64_t size);
     bool ReplyGetAttr(uint64_t unique, uint64_t inode, int64_t size, int mode);
@@ -60,6 +69,9 @@ class FuseAppLoop final {
     base::unique_fd fd_;
     base::unique_fd break_fd_;
 
+    std::unique_ptr<FuseAppDispatcher> dispatcher_;
+    int dispatch_thread_count_;
+
     // Lock for multi-threading.
     std::mutex mutex_;
 };
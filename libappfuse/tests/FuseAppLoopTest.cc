@@ -17,10 +17,12 @@
 #include "libappfuse/FuseAppLoop.h"
 
 #include <sys/socket.h>
+#include <unistd.h>
 
 #include <android-base/logging.h>
 #include <android-base/unique_fd.h>
 #include <gtest/gtest.h>
+#include <set>
 #include <thread>
 
 #include "libappfuse/EpollController.h"
@@ -80,6 +82,45 @@ class Callback : public FuseAppLoopCallback {
   }
 };
 
+class DispatchCallback : public FuseAppLoopCallback {
+ public:
+  FuseAppLoop* loop;
+
+  void OnGetAttr(uint64_t seq, uint64_t inode ATTRIBUTE_UNUSED) override {
+      EXPECT_TRUE(loop->ReplySimple(seq, 0));
+  }
+
+  void OnLookup(uint64_t unique, uint64_t inode ATTRIBUTE_UNUSED) override {
+      EXPECT_TRUE(loop->ReplySimple(unique, 0));
+  }
+
+  void OnFsync(uint64_t seq, uint64_t inode ATTRIBUTE_UNUSED) override {
+      EXPECT_TRUE(loop->ReplySimple(seq, 0));
+  }
+
+  void OnWrite(uint64_t seq, uint64_t inode ATTRIBUTE_UNUSED, uint64_t offset ATTRIBUTE_UNUSED,
+               uint32_t size ATTRIBUTE_UNUSED, const void* data ATTRIBUTE_UNUSED) override {
+      EXPECT_TRUE(loop->ReplyWrite(seq, 0));
+  }
+
+  void OnRead(uint64_t seq, uint64_t inode, uint64_t offset ATTRIBUTE_UNUSED,
+              uint32_t size ATTRIBUTE_UNUSED) override {
+      // Delay replies on one file to check that it does not stall the other.
+      if (inode == 10) {
+          usleep(100 * 1000);
+      }
+      EXPECT_TRUE(loop->ReplySimple(seq, 0));
+  }
+
+  void OnOpen(uint64_t seq, uint64_t inode) override {
+      EXPECT_TRUE(loop->ReplyOpen(seq, inode));
+  }
+
+  void OnRelease(uint64_t seq, uint64_t inode ATTRIBUTE_UNUSED) override {
+      EXPECT_TRUE(loop->ReplySimple(seq, 0));
+  }
+};
+
 class FuseAppLoopTest : public ::testing::Test {
  protected:
    std::thread thread_;
@@ -282,6 +323,48 @@ TEST_F(FuseAppLoopTest, Write) {
   CheckCallback(sizeof(fuse_write_in), FUSE_WRITE, sizeof(fuse_write_out));
 }
 
+TEST(FuseAppLoopDispatchTest, ParallelRequests) {
+    constexpr uint64_t kNumRequests = 16;
+
+    base::unique_fd sockets[2];
+    ASSERT_TRUE(SetupMessageSockets(&sockets));
+
+    FuseAppLoop loop(std::move(sockets[1]));
+    loop.SetDispatchThreadCount(2);
+    DispatchCallback callback;
+    callback.loop = &loop;
+    std::thread thread([&] { loop.Start(&callback); });
+
+    // Interleave slow reads on inode 10 (see DispatchCallback::OnRead) with
+    // fast reads on inode 11.
+    FuseRequest request;
+    for (uint64_t i = 0; i < kNumRequests; ++i) {
+        request.Reset(sizeof(fuse_read_in), FUSE_READ, i + 1);
+        request.header.nodeid = 10 + i % 2;
+        ASSERT_TRUE(request.Write(sockets[0]));
+    }
+
+    // All requests must be replied to, whichever worker handled them, and
+    // replies for one inode must arrive in request order.
+    std::set<uint64_t> uniques;
+    uint64_t last_slow_unique = 0;
+    uint64_t last_fast_unique = 0;
+    FuseResponse response;
+    for (uint64_t i = 0; i < kNumRequests; ++i) {
+        ASSERT_TRUE(response.Read(sockets[0]));
+        EXPECT_EQ(kFuseSuccess, response.header.error);
+        uint64_t& last_unique =
+            response.header.unique % 2 == 1 ? last_slow_unique : last_fast_unique;
+        EXPECT_LT(last_unique, response.header.unique);
+        last_unique = response.header.unique;
+        uniques.insert(response.header.unique);
+    }
+    EXPECT_EQ(kNumRequests, uniques.size());
+
+    sockets[0].reset();
+    thread.join();
+}
+
 TEST_F(FuseAppLoopTest, Break) {
     // Ensure that the loop started.
     request_.Reset(sizeof(fuse_open_in), FUSE_OPEN, 1);
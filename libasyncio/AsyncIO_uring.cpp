@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <asyncio/AsyncIO_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstdint>
+#include <cstring>
+
+/* Sysroots older than the kernel they run on may lack the syscall numbers;
+ * they are identical across architectures. */
+#ifndef __NR_io_uring_setup
+#define __NR_io_uring_setup 425
+#endif
+#ifndef __NR_io_uring_enter
+#define __NR_io_uring_enter 426
+#endif
+#ifndef __NR_io_uring_register
+#define __NR_io_uring_register 427
+#endif
+
+int io_uring_setup(unsigned entries, io_uring_params* params) {
+    return syscall(__NR_io_uring_setup, entries, params);
+}
+
+int io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0);
+}
+
+int io_uring_register(int ring_fd, unsigned opcode, const void* arg, unsigned nr_args) {
+    return syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args);
+}
+
+int io_uring_queue_init(unsigned entries, unsigned flags, unsigned sq_thread_idle,
+                        io_uring_queue* queue) {
+    memset(queue, 0, sizeof(*queue));
+    queue->ring_fd = -1;
+
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = flags;
+    if (flags & IORING_SETUP_SQPOLL) {
+        params.sq_thread_idle = sq_thread_idle;
+    }
+
+    const int ring_fd = io_uring_setup(entries, &params);
+    if (ring_fd < 0) {
+        return -1;
+    }
+
+    queue->ring_fd = ring_fd;
+    queue->flags = params.flags;
+    queue->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    queue->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    queue->sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+
+    /* Newer kernels serve both rings from one mapping. */
+    bool single_mmap = false;
+#ifdef IORING_FEAT_SINGLE_MMAP
+    single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+#endif
+    if (single_mmap && queue->cq_ring_size > queue->sq_ring_size) {
+        queue->sq_ring_size = queue->cq_ring_size;
+    }
+
+    queue->sq_ring_ptr = mmap(nullptr, queue->sq_ring_size, PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    if (queue->sq_ring_ptr == MAP_FAILED) {
+        queue->sq_ring_ptr = nullptr;
+        io_uring_queue_exit(queue);
+        return -1;
+    }
+    if (single_mmap) {
+        queue->cq_ring_ptr = queue->sq_ring_ptr;
+    } else {
+        queue->cq_ring_ptr = mmap(nullptr, queue->cq_ring_size, PROT_READ | PROT_WRITE,
+                                  MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+        if (queue->cq_ring_ptr == MAP_FAILED) {
+            queue->cq_ring_ptr = nullptr;
+            io_uring_queue_exit(queue);
+            return -1;
+        }
+    }
+    queue->sqes = static_cast<io_uring_sqe*>(mmap(nullptr, queue->sqes_size,
+                                                  PROT_READ | PROT_WRITE,
+                                                  MAP_SHARED | MAP_POPULATE, ring_fd,
+                                                  IORING_OFF_SQES));
+    if (queue->sqes == MAP_FAILED) {
+        queue->sqes = nullptr;
+        io_uring_queue_exit(queue);
+        return -1;
+    }
+
+    char* const sq_ptr = static_cast<char*>(queue->sq_ring_ptr);
+    queue->sq_head = reinterpret_cast<unsigned*>(sq_ptr + params.sq_off.head);
+    queue->sq_tail = reinterpret_cast<unsigned*>(sq_ptr + params.sq_off.tail);
+    queue->sq_flags = reinterpret_cast<unsigned*>(sq_ptr + params.sq_off.flags);
+    queue->sq_array = reinterpret_cast<unsigned*>(sq_ptr + params.sq_off.array);
+    queue->sq_ring_mask = *reinterpret_cast<unsigned*>(sq_ptr + params.sq_off.ring_mask);
+    queue->sq_entries = params.sq_entries;
+
+    char* const cq_ptr = static_cast<char*>(queue->cq_ring_ptr);
+    queue->cq_head = reinterpret_cast<unsigned*>(cq_ptr + params.cq_off.head);
+    queue->cq_tail = reinterpret_cast<unsigned*>(cq_ptr + params.cq_off.tail);
+    queue->cqes = reinterpret_cast<io_uring_cqe*>(cq_ptr + params.cq_off.cqes);
+    queue->cq_ring_mask = *reinterpret_cast<unsigned*>(cq_ptr + params.cq_off.ring_mask);
+    queue->cq_entries = params.cq_entries;
+
+    queue->sqe_tail = *queue->sq_tail;
+    return 0;
+}
+
+int io_uring_queue_exit(io_uring_queue* queue) {
+    if (queue->sqes) {
+        munmap(queue->sqes, queue->sqes_size);
+    }
+    if (queue->cq_ring_ptr && queue->cq_ring_ptr != queue->sq_ring_ptr) {
+        munmap(queue->cq_ring_ptr, queue->cq_ring_size);
+    }
+    if (queue->sq_ring_ptr) {
+        munmap(queue->sq_ring_ptr, queue->sq_ring_size);
+    }
+    int result = 0;
+    if (queue->ring_fd != -1) {
+        result = close(queue->ring_fd);
+    }
+    memset(queue, 0, sizeof(*queue));
+    queue->ring_fd = -1;
+    return result;
+}
+
+io_uring_sqe* io_uring_get_sqe(io_uring_queue* queue) {
+    const unsigned head = __atomic_load_n(queue->sq_head, __ATOMIC_ACQUIRE);
+    if (queue->sqe_tail - head >= queue->sq_entries) {
+        return nullptr;
+    }
+    return &queue->sqes[queue->sqe_tail++ & queue->sq_ring_mask];
+}
+
+int io_uring_submit(io_uring_queue* queue) {
+    unsigned tail = *queue->sq_tail;
+    const unsigned to_submit = queue->sqe_tail - tail;
+    for (; tail != queue->sqe_tail; tail++) {
+        queue->sq_array[tail & queue->sq_ring_mask] = tail & queue->sq_ring_mask;
+    }
+    /* Publish the new tail before the kernel looks at the entries. */
+    __atomic_store_n(queue->sq_tail, tail, __ATOMIC_RELEASE);
+
+    if (queue->flags & IORING_SETUP_SQPOLL) {
+        if (__atomic_load_n(queue->sq_flags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP) {
+            if (io_uring_enter(queue->ring_fd, to_submit, 0, IORING_ENTER_SQ_WAKEUP) < 0) {
+                return -1;
+            }
+        }
+        /* The poll thread picks the entries up without a syscall. */
+        return to_submit;
+    }
+    return io_uring_enter(queue->ring_fd, to_submit, 0, 0);
+}
+
+int io_uring_getevents(io_uring_queue* queue, unsigned min_nr, unsigned max_nr,
+                       io_uring_cqe* events) {
+    unsigned count = 0;
+    while (true) {
+        unsigned head = *queue->cq_head;
+        const unsigned tail = __atomic_load_n(queue->cq_tail, __ATOMIC_ACQUIRE);
+        while (head != tail && count < max_nr) {
+            events[count++] = queue->cqes[head & queue->cq_ring_mask];
+            head++;
+        }
+        /* Hand the reaped slots back to the kernel. */
+        __atomic_store_n(queue->cq_head, head, __ATOMIC_RELEASE);
+
+        if (count >= min_nr || count == max_nr) {
+            return count;
+        }
+        if (io_uring_enter(queue->ring_fd, 0, min_nr - count, IORING_ENTER_GETEVENTS) < 0) {
+            return count != 0 ? static_cast<int>(count) : -1;
+        }
+    }
+}
+
+int io_uring_register_buffers(io_uring_queue* queue, const iovec* iovecs, unsigned nr) {
+    return io_uring_register(queue->ring_fd, IORING_REGISTER_BUFFERS, iovecs, nr);
+}
+
+int io_uring_unregister_buffers(io_uring_queue* queue) {
+    return io_uring_register(queue->ring_fd, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+}
+
+void io_uring_prep(io_uring_sqe* sqe, uint8_t opcode, int fd, const void* buf, uint64_t count,
+                   int64_t offset, uint64_t user_data) {
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(buf);
+    sqe->len = count;
+    sqe->off = offset;
+    sqe->user_data = user_data;
+}
+
+void io_uring_prep_pread(io_uring_sqe* sqe, int fd, void* buf, size_t count, long long offset,
+                         uint64_t user_data) {
+    io_uring_prep(sqe, IORING_OP_READ, fd, buf, count, offset, user_data);
+}
+
+void io_uring_prep_pwrite(io_uring_sqe* sqe, int fd, const void* buf, size_t count,
+                          long long offset, uint64_t user_data) {
+    io_uring_prep(sqe, IORING_OP_WRITE, fd, buf, count, offset, user_data);
+}
+
+void io_uring_prep_pread_fixed(io_uring_sqe* sqe, int fd, void* buf, size_t count,
+                               long long offset, uint64_t user_data, unsigned buf_index) {
+    io_uring_prep(sqe, IORING_OP_READ_FIXED, fd, buf, count, offset, user_data);
+    sqe->buf_index = buf_index;
+}
+
+void io_uring_prep_pwrite_fixed(io_uring_sqe* sqe, int fd, const void* buf, size_t count,
+                                long long offset, uint64_t user_data, unsigned buf_index) {
+    io_uring_prep(sqe, IORING_OP_WRITE_FIXED, fd, buf, count, offset, user_data);
+    sqe->buf_index = buf_index;
+}
+
+void io_uring_prep_cancel(io_uring_sqe* sqe, uint64_t user_data, uint64_t cancel_user_data) {
+    io_uring_prep(sqe, IORING_OP_ASYNC_CANCEL, -1, nullptr, 0, 0, cancel_user_data);
+    sqe->addr = user_data;
+}
\ No newline at end of file
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _ASYNCIO_URING_H
+#define _ASYNCIO_URING_H
+
+#include <linux/io_uring.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/cdefs.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Provides an io_uring engine next to the legacy aio wrappers in AsyncIO.h,
+ * in the same raw-syscall style (no liburing dependency). All functions
+ * follow the syscall convention: -1 with errno set on failure.
+ */
+
+int io_uring_setup(unsigned entries, struct io_uring_params* params);
+int io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags);
+int io_uring_register(int ring_fd, unsigned opcode, const void* arg, unsigned nr_args);
+
+/**
+ * One submission/completion ring pair. Fill it with io_uring_queue_init and
+ * treat the members as read-only; they describe the rings shared with the
+ * kernel.
+ */
+struct io_uring_queue {
+    int ring_fd;
+    unsigned flags;
+
+    /* Submission queue. */
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_flags;
+    unsigned* sq_array;
+    struct io_uring_sqe* sqes;
+    unsigned sq_ring_mask;
+    unsigned sq_entries;
+    unsigned sqe_tail;
+
+    /* Completion queue. */
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    struct io_uring_cqe* cqes;
+    unsigned cq_ring_mask;
+    unsigned cq_entries;
+
+    /* Mapping bookkeeping for io_uring_queue_exit. */
+    void* sq_ring_ptr;
+    size_t sq_ring_size;
+    void* cq_ring_ptr;
+    size_t cq_ring_size;
+    size_t sqes_size;
+};
+
+/**
+ * Creates the ring with |entries| submission slots. |flags| is passed through
+ * to io_uring_setup (e.g. IORING_SETUP_SQPOLL); |sq_thread_idle| is the
+ * SQPOLL kernel thread idle time in milliseconds and is ignored without
+ * IORING_SETUP_SQPOLL.
+ */
+int io_uring_queue_init(unsigned entries, unsigned flags, unsigned sq_thread_idle,
+                        struct io_uring_queue* queue);
+int io_uring_queue_exit(struct io_uring_queue* queue);
+
+/**
+ * Returns the next free submission entry, or NULL if the ring is full. The
+ * entry stays owned by the caller until io_uring_submit.
+ */
+struct io_uring_sqe* io_uring_get_sqe(struct io_uring_queue* queue);
+
+/**
+ * Submits every entry handed out by io_uring_get_sqe since the last call.
+ * Returns the number of submitted entries. With IORING_SETUP_SQPOLL this
+ * only enters the kernel when the poll thread went to sleep.
+ */
+int io_uring_submit(struct io_uring_queue* queue);
+
+/**
+ * Reaps completions, blocking until at least |min_nr| (0 just polls) and
+ * copying at most |max_nr| into |events|. Returns the number reaped.
+ */
+int io_uring_getevents(struct io_uring_queue* queue, unsigned min_nr, unsigned max_nr,
+                       struct io_uring_cqe* events);
+
+/**
+ * Registers |nr| buffers for the *_fixed prep variants below, which skip the
+ * per-operation page pinning of the plain reads and writes.
+ */
+int io_uring_register_buffers(struct io_uring_queue* queue, const struct iovec* iovecs,
+                              unsigned nr);
+int io_uring_unregister_buffers(struct io_uring_queue* queue);
+
+void io_uring_prep(struct io_uring_sqe* sqe, uint8_t opcode, int fd, const void* buf,
+                   uint64_t count, int64_t offset, uint64_t user_data);
+void io_uring_prep_pread(struct io_uring_sqe* sqe, int fd, void* buf, size_t count,
+                         long long offset, uint64_t user_data);
+void io_uring_prep_pwrite(struct io_uring_sqe* sqe, int fd, const void* buf, size_t count,
+                          long long offset, uint64_t user_data);
+void io_uring_prep_pread_fixed(struct io_uring_sqe* sqe, int fd, void* buf, size_t count,
+                               long long offset, uint64_t user_data, unsigned buf_index);
+void io_uring_prep_pwrite_fixed(struct io_uring_sqe* sqe, int fd, const void* buf, size_t count,
+                                long long offset, uint64_t user_data, unsigned buf_index);
+
+/** Cancels the operation submitted with |user_data|; the result arrives as a
+ * completion for the cancel entry itself. */
+void io_uring_prep_cancel(struct io_uring_sqe* sqe, uint64_t user_data,
+                          uint64_t cancel_user_data);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif  // _ASYNCIO_URING_H
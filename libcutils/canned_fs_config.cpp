@@ -24,6 +24,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 typedef struct {
     const char* path;
@@ -37,14 +43,108 @@ static Path* canned_data = NULL;
 static int canned_alloc = 0;
 static int canned_used = 0;
 
+// Precompiled format: a header, entries sorted by path, hash bucket heads
+// (chained through CannedEntry::next) and an interned string pool, all in
+// one mmap-able file so tools skip the parse and strdup of every line.
+#define CANNED_FS_CONFIG_MAGIC "CannedFC"
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t bucket_count;  // power of two
+    uint32_t string_pool_size;
+    uint32_t reserved[2];   // keeps the entries 8-byte aligned
+} CannedHeader;
+
+typedef struct {
+    uint64_t capabilities;
+    uint32_t path_offset;   // into the string pool
+    uint32_t next;          // next entry in the same bucket, or UINT32_MAX
+    uint32_t uid;
+    uint32_t gid;
+    uint32_t mode;
+    uint32_t reserved;
+} CannedEntry;
+
+static const CannedHeader* canned_mmap = NULL;
+static size_t canned_mmap_size = 0;
+static const CannedEntry* canned_entries = NULL;
+static const uint32_t* canned_buckets = NULL;
+static const char* canned_strings = NULL;
+
+static uint32_t path_hash(const char* path) {
+    // FNV-1a
+    uint32_t h = 2166136261u;
+    while (*path) {
+        h ^= (unsigned char)*path++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
 static int path_compare(const void* a, const void* b) {
     return strcmp(((Path*)a)->path, ((Path*)b)->path);
 }
 
+#if !defined(_WIN32)
+// Maps fn and wires up the index pointers. Returns 0 on success, 1 if fn is
+// not in the precompiled format (caller falls back to the text parser), -1
+// on a malformed precompiled file.
+static int load_canned_fs_config_mmap(const char* fn) {
+    const CannedHeader* hdr;
+    struct stat st;
+    size_t need;
+    void* map;
+    int fd;
+
+    fd = open(fn, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return 1;
+
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(CannedHeader)) {
+        close(fd);
+        return 1;
+    }
+
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return 1;
+
+    hdr = (const CannedHeader*)map;
+    if (memcmp(hdr->magic, CANNED_FS_CONFIG_MAGIC, sizeof(hdr->magic)) != 0) {
+        munmap(map, st.st_size);
+        return 1;
+    }
+
+    need = sizeof(CannedHeader) + (size_t)hdr->entry_count * sizeof(CannedEntry) +
+           (size_t)hdr->bucket_count * sizeof(uint32_t) + hdr->string_pool_size;
+    if (hdr->version != 1 || hdr->bucket_count == 0 ||
+            (hdr->bucket_count & (hdr->bucket_count - 1)) != 0 ||
+            hdr->string_pool_size == 0 || need > (size_t)st.st_size ||
+            ((const char*)map)[need - 1] != '\0') {
+        fprintf(stderr, "malformed canned fs_config %s\n", fn);
+        munmap(map, st.st_size);
+        return -1;
+    }
+
+    canned_mmap = hdr;
+    canned_mmap_size = st.st_size;
+    canned_entries = (const CannedEntry*)(hdr + 1);
+    canned_buckets = (const uint32_t*)(canned_entries + hdr->entry_count);
+    canned_strings = (const char*)(canned_buckets + hdr->bucket_count);
+    return 0;
+}
+#endif
+
 int load_canned_fs_config(const char* fn) {
     char buf[PATH_MAX + 200];
     FILE* f;
 
+#if !defined(_WIN32)
+    int mapped = load_canned_fs_config_mmap(fn);
+    if (mapped <= 0) return mapped;
+#endif
+
     f = fopen(fn, "r");
     if (f == NULL) {
         fprintf(stderr, "failed to open %s: %s\n", fn, strerror(errno));
@@ -89,6 +189,73 @@ int load_canned_fs_config(const char* fn) {
     return 0;
 }
 
+#if !defined(_WIN32)
+int save_canned_fs_config(const char* fn) {
+    CannedHeader hdr;
+    CannedEntry* entries;
+    uint32_t* buckets;
+    uint32_t pool_size;
+    FILE* f;
+    int i, ok;
+
+    if (canned_data == NULL) {
+        fprintf(stderr, "no canned fs_config loaded\n");
+        return -1;
+    }
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, CANNED_FS_CONFIG_MAGIC, sizeof(hdr.magic));
+    hdr.version = 1;
+    hdr.entry_count = canned_used;
+    hdr.bucket_count = 1;
+    while (hdr.bucket_count < (uint32_t)canned_used) hdr.bucket_count <<= 1;
+
+    entries = (CannedEntry*) calloc(canned_used ? canned_used : 1, sizeof(CannedEntry));
+    buckets = (uint32_t*) malloc(hdr.bucket_count * sizeof(uint32_t));
+    memset(buckets, 0xff, hdr.bucket_count * sizeof(uint32_t));
+
+    pool_size = 0;
+    for (i = 0; i < canned_used; i++) {
+        uint32_t b = path_hash(canned_data[i].path) & (hdr.bucket_count - 1);
+        entries[i].capabilities = canned_data[i].capabilities;
+        entries[i].path_offset = pool_size;
+        entries[i].next = buckets[b];
+        entries[i].uid = canned_data[i].uid;
+        entries[i].gid = canned_data[i].gid;
+        entries[i].mode = canned_data[i].mode;
+        buckets[b] = i;
+        pool_size += strlen(canned_data[i].path) + 1;
+    }
+    hdr.string_pool_size = pool_size ? pool_size : 1;
+
+    f = fopen(fn, "wb");
+    if (f == NULL) {
+        fprintf(stderr, "failed to open %s: %s\n", fn, strerror(errno));
+        free(entries);
+        free(buckets);
+        return -1;
+    }
+
+    ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1 &&
+         (canned_used == 0 ||
+          fwrite(entries, sizeof(CannedEntry), canned_used, f) == (size_t)canned_used) &&
+         fwrite(buckets, sizeof(uint32_t), hdr.bucket_count, f) == hdr.bucket_count;
+    for (i = 0; ok && i < canned_used; i++) {
+        ok = fwrite(canned_data[i].path, strlen(canned_data[i].path) + 1, 1, f) == 1;
+    }
+    if (ok && pool_size == 0) ok = fwrite("", 1, 1, f) == 1;
+
+    free(entries);
+    free(buckets);
+
+    if (fclose(f) != 0 || !ok) {
+        fprintf(stderr, "failed to write %s: %s\n", fn, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+#endif
+
 static const int kDebugCannedFsConfig = 0;
 
 void canned_fs_config(const char* path, int dir, const char* target_out_path,
@@ -97,6 +264,25 @@ void canned_fs_config(const char* path, int dir, const char* target_out_path,
 
     key.path = path;
     if (path[0] == '/') key.path++; // canned paths lack the leading '/'
+
+    if (canned_mmap != NULL) {
+        uint32_t i = canned_buckets[path_hash(key.path) & (canned_mmap->bucket_count - 1)];
+        while (i != UINT32_MAX) {
+            const CannedEntry* e = canned_entries + i;
+            if (strcmp(canned_strings + e->path_offset, key.path) == 0) break;
+            i = e->next;
+        }
+        if (i == UINT32_MAX) {
+            fprintf(stderr, "failed to find [%s] in canned fs_config\n", path);
+            exit(1);
+        }
+        *uid = canned_entries[i].uid;
+        *gid = canned_entries[i].gid;
+        *mode = canned_entries[i].mode;
+        *capabilities = canned_entries[i].capabilities;
+        return;
+    }
+
     p = (Path*) bsearch(&key, canned_data, canned_used, sizeof(Path), path_compare);
     if (p == NULL) {
         fprintf(stderr, "failed to find [%s] in canned fs_config\n", path);
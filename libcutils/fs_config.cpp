@@ -32,7 +32,9 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 
+#include <algorithm>
 #include <string>
+#include <vector>
 
 #include <android-base/strings.h>
 #include <log/log.h>
@@ -266,6 +268,11 @@ static bool is_partition(const std::string& path) {
     return false;
 }
 
+// Prefixes under which a path may also match rules for the partition it
+// logically belongs to, e.g. "system/vendor/bin/sh" matches "vendor/bin/*".
+static constexpr const char* kLogicalPartitions[] = {"system/product/", "system/system_ext/",
+                                                     "system/vendor/", "vendor/odm/"};
+
 // alias prefixes of "<partition>/<stuff>" to "system/<partition>/<stuff>" or
 // "system/<partition>/<stuff>" to "<partition>/<stuff>"
 static bool fs_config_cmp(bool dir, const char* prefix, size_t len, const char* path, size_t plen) {
@@ -294,8 +301,6 @@ static bool fs_config_cmp(bool dir, const char* prefix, size_t len, const char*
     if (fnmatch(pattern.c_str(), input.c_str(), fnm_flags) == 0) return true;
 
     // Check match between logical partition's files and patterns.
-    static constexpr const char* kLogicalPartitions[] = {"system/product/", "system/system_ext/",
-                                                         "system/vendor/", "vendor/odm/"};
     for (auto& logical_partition : kLogicalPartitions) {
         if (StartsWith(input, logical_partition)) {
             std::string input_in_partition = input.substr(input.find('/') + 1);
@@ -311,6 +316,107 @@ static bool fs_config_cmp(bool dir, const char* prefix, size_t len, const char*
 auto __for_testing_only__fs_config_cmp = fs_config_cmp;
 #endif
 
+// Index over android_dirs/android_files. fnmatch without FNM_PATHNAME is
+// anchored, so a pattern whose first segment is literal can only match paths
+// whose first segment (or logical-partition alias thereof) is that same
+// literal. Rules are therefore grouped by first literal segment into a
+// sorted table probed with binary search; rules whose first segment contains
+// a glob character are consulted for every path. Buckets keep rule indices
+// in table order so the "first match" semantics of the tables survive.
+struct fs_path_index {
+    std::vector<std::string> segments;           // sorted, distinct first segments
+    std::vector<std::vector<uint16_t>> buckets;  // rule indices, in table order
+    std::vector<uint16_t> wildcards;             // rules with a glob in the first segment
+    const fs_path_config* table;
+    uint16_t fallback;  // the terminating catch-all rule
+};
+
+static std::string fs_path_first_segment(const char* path, size_t len) {
+    const char* slash = static_cast<const char*>(memchr(path, '/', len));
+    return std::string(path, slash ? static_cast<size_t>(slash - path) : len);
+}
+
+static fs_path_index fs_path_index_build(const fs_path_config* table) {
+    fs_path_index index;
+    index.table = table;
+
+    std::vector<std::pair<std::string, uint16_t>> grouped;
+    uint16_t idx = 0;
+    for (; table[idx].prefix; ++idx) {
+        std::string segment = fs_path_first_segment(table[idx].prefix, strlen(table[idx].prefix));
+        if (segment.find_first_of("*?[") != std::string::npos) {
+            index.wildcards.push_back(idx);
+        } else {
+            grouped.emplace_back(std::move(segment), idx);
+        }
+    }
+    index.fallback = idx;
+
+    std::stable_sort(grouped.begin(), grouped.end(),
+                     [](const auto& a, const auto& b) { return a.first < b.first; });
+    for (auto& entry : grouped) {
+        if (index.segments.empty() || index.segments.back() != entry.first) {
+            index.segments.push_back(entry.first);
+            index.buckets.emplace_back();
+        }
+        index.buckets.back().push_back(entry.second);
+    }
+    return index;
+}
+
+static const std::vector<uint16_t>* fs_path_index_bucket(const fs_path_index& index,
+                                                         const std::string& segment) {
+    auto it = std::lower_bound(index.segments.begin(), index.segments.end(), segment);
+    if (it == index.segments.end() || *it != segment) return nullptr;
+    return &index.buckets[it - index.segments.begin()];
+}
+
+static const fs_path_config* fs_path_index_lookup(bool dir, const char* path, size_t plen) {
+    static const fs_path_index dir_index = fs_path_index_build(android_dirs);
+    static const fs_path_index file_index = fs_path_index_build(android_files);
+    const fs_path_index& index = dir ? dir_index : file_index;
+
+    std::string input(path, plen);
+    const std::vector<uint16_t>* primary = fs_path_index_bucket(index, fs_path_first_segment(path, plen));
+
+    // A path under a logical partition may also match rules for the
+    // partition it belongs to (see fs_config_cmp).
+    const std::vector<uint16_t>* alias = nullptr;
+    for (auto& logical_partition : kLogicalPartitions) {
+        if (StartsWith(input, logical_partition)) {
+            std::string input_in_partition = input.substr(input.find('/') + 1);
+            if (!is_partition(input_in_partition)) continue;
+            alias = fs_path_index_bucket(
+                    index, fs_path_first_segment(input_in_partition.c_str(), input_in_partition.size()));
+            break;
+        }
+    }
+
+    // The three candidate lists are disjoint and each is in table order:
+    // walk them in ascending rule index so the first table match wins.
+    size_t pi = 0, ai = 0, wi = 0;
+    while (true) {
+        uint16_t next = index.fallback;
+        if (primary && pi < primary->size()) next = std::min(next, (*primary)[pi]);
+        if (alias && ai < alias->size()) next = std::min(next, (*alias)[ai]);
+        if (wi < index.wildcards.size()) next = std::min(next, index.wildcards[wi]);
+        if (next == index.fallback) break;
+
+        if (primary && pi < primary->size() && (*primary)[pi] == next) pi++;
+        else if (alias && ai < alias->size() && (*alias)[ai] == next) ai++;
+        else wi++;
+
+        const fs_path_config* pc = &index.table[next];
+        if (fs_config_cmp(dir, pc->prefix, strlen(pc->prefix), path, plen)) {
+            return pc;
+        }
+    }
+    return &index.table[index.fallback];
+}
+#ifndef __ANDROID_VNDK__
+auto __for_testing_only__fs_config_lookup = fs_path_index_lookup;
+#endif
+
 void fs_config(const char* path, int dir, const char* target_out_path, unsigned* uid, unsigned* gid,
                unsigned* mode, uint64_t* capabilities) {
     const struct fs_path_config* pc;
@@ -366,13 +472,86 @@ void fs_config(const char* path, int dir, const char* target_out_path, unsigned*
         close(fd);
     }
 
-    for (pc = dir ? android_dirs : android_files; pc->prefix; pc++) {
-        if (fs_config_cmp(dir, pc->prefix, strlen(pc->prefix), path, plen)) {
-            break;
-        }
-    }
+    pc = fs_path_index_lookup(dir, path, plen);
     *uid = pc->uid;
     *gid = pc->gid;
     *mode = (*mode & (~07777)) | pc->mode;
     *capabilities = pc->capabilities;
 }
+
+void fs_config_bulk(const char* const* paths, size_t count, int dir, const char* target_out_path,
+                    struct fs_config_result* results) {
+    // Parse the override files once instead of re-reading them per path.
+    struct override_entry {
+        uint16_t mode;
+        uint16_t uid;
+        uint16_t gid;
+        uint64_t capabilities;
+        std::string prefix;
+    };
+    std::vector<override_entry> overrides;
+
+    for (size_t which = 0; which < (sizeof(conf) / sizeof(conf[0])); ++which) {
+        struct fs_path_config_from_file header;
+
+        int fd = fs_config_open(dir, which, target_out_path);
+        if (fd < 0) continue;
+
+        while (TEMP_FAILURE_RETRY(read(fd, &header, sizeof(header))) == sizeof(header)) {
+            char* prefix;
+            uint16_t host_len = header.len;
+            ssize_t len, remainder = host_len - sizeof(header);
+            if (remainder <= 0) {
+                ALOGE("%s len is corrupted", conf[which][dir]);
+                break;
+            }
+            prefix = static_cast<char*>(calloc(1, remainder));
+            if (!prefix) {
+                ALOGE("%s out of memory", conf[which][dir]);
+                break;
+            }
+            if (TEMP_FAILURE_RETRY(read(fd, prefix, remainder)) != remainder) {
+                free(prefix);
+                ALOGE("%s prefix is truncated", conf[which][dir]);
+                break;
+            }
+            len = strnlen(prefix, remainder);
+            if (len >= remainder) {  // missing a terminating null
+                free(prefix);
+                ALOGE("%s is corrupted", conf[which][dir]);
+                break;
+            }
+            overrides.push_back({header.mode, header.uid, header.gid, header.capabilities,
+                                 std::string(prefix, len)});
+            free(prefix);
+        }
+        close(fd);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        const char* path = paths[i];
+        if (path[0] == '/') {
+            path++;
+        }
+        size_t plen = strlen(path);
+
+        bool overridden = false;
+        for (const auto& entry : overrides) {
+            if (fs_config_cmp(dir, entry.prefix.c_str(), entry.prefix.size(), path, plen)) {
+                results[i].uid = entry.uid;
+                results[i].gid = entry.gid;
+                results[i].mode = (results[i].mode & (~07777)) | entry.mode;
+                results[i].capabilities = entry.capabilities;
+                overridden = true;
+                break;
+            }
+        }
+        if (overridden) continue;
+
+        const fs_path_config* pc = fs_path_index_lookup(dir, path, plen);
+        results[i].uid = pc->uid;
+        results[i].gid = pc->gid;
+        results[i].mode = (results[i].mode & (~07777)) | pc->mode;
+        results[i].capabilities = pc->capabilities;
+    }
+}
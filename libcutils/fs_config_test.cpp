@@ -258,3 +258,65 @@ TEST(fs_config, odm_files_alias) {
 TEST(fs_config, system_alias) {
     EXPECT_FALSE(check_fs_config_cmp(fs_config_cmp_tests));
 }
+
+extern const fs_path_config* (*__for_testing_only__fs_config_lookup)(bool, const char*, size_t);
+
+// The indexed lookup must return exactly what a linear first-match scan of
+// the table would.
+static const fs_path_config* brute_force_lookup(const fs_path_config* paths, bool dir,
+                                                const char* path) {
+    for (; paths->prefix; ++paths) {
+        if (__for_testing_only__fs_config_cmp(dir, paths->prefix, strlen(paths->prefix), path,
+                                              strlen(path))) {
+            break;
+        }
+    }
+    return paths;
+}
+
+static void check_lookup_matches_scan(const fs_path_config* paths, bool dir) {
+    static const char* queries[] = {
+            "system/bin/sh",
+            "system/bin",
+            "system/vendor/bin/wifi",
+            "system/vendor/lib/hw",
+            "system/product/bin/foo",
+            "system/system_ext/bin/foo",
+            "vendor/odm/bin/wifi",
+            "vendor/bin/toybox",
+            "vendor/apex/com.example/bin/tool",
+            "system/apex/com.example/bin/tool",
+            "product/apex/com.example/bin/tool",
+            "data/media/Music/song.mp3",
+            "data/media/0/photo.jpg",
+            "data/nativetest/tests.txt",
+            "data/nativetest64/suite/case",
+            "data/local/tmp/foo",
+            "data/misc/dhcp/leases",
+            "init.rc",
+            "init",
+            "fstab.qcom",
+            "default.prop",
+            "odm/build.prop",
+            "odm/etc/fs_config_files",
+            "bin/toolbox",
+            "sdcard",
+            "no/such/path",
+            "",
+    };
+    for (auto& query : queries) {
+        const fs_path_config* expected = brute_force_lookup(paths, dir, query);
+        const fs_path_config* actual = __for_testing_only__fs_config_lookup(dir, query, strlen(query));
+        EXPECT_EQ(expected, actual) << (dir ? "dirs" : "files") << " query \"" << query << "\": "
+                                    << "expected \"" << (expected->prefix ?: "<default>")
+                                    << "\" got \"" << (actual->prefix ?: "<default>") << "\"";
+    }
+}
+
+TEST(fs_config, indexed_dir_lookup_matches_linear_scan) {
+    check_lookup_matches_scan(__for_testing_only__android_dirs, true);
+}
+
+TEST(fs_config, indexed_file_lookup_matches_linear_scan) {
+    check_lookup_matches_scan(__for_testing_only__android_files, false);
+}
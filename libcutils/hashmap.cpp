@@ -19,61 +19,111 @@
 #include <assert.h>
 #include <errno.h>
 #include <pthread.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
 
+/* Open-addressed (robin hood) table over a flat entry array: no per-entry
+ * malloc, probe sequences stay short because inserts steal slots from
+ * entries that are closer to their ideal bucket, and removal backward-shifts
+ * the cluster instead of using tombstones.
+ *
+ * A map is one or more shards. Plain maps have a single shard and are
+ * unsynchronized, exactly like the old chained implementation: callers use
+ * hashmapLock/hashmapUnlock. Maps from hashmapCreateSharded() lock only the
+ * touched shard inside each operation.
+ */
+
 typedef struct Entry Entry;
 struct Entry {
     void* key;
-    int hash;
     void* value;
-    Entry* next;
+    int hash;
+    /* Distance from the ideal bucket plus one; 0 marks an empty slot. */
+    uint32_t dib;
+};
+
+typedef struct Shard Shard;
+struct Shard {
+    Entry* entries;
+    size_t capacity; /* power of 2 */
+    size_t size;
+    pthread_mutex_t lock; /* taken by operations only on sharded maps */
 };
 
 struct Hashmap {
-    Entry** buckets;
-    size_t bucketCount;
     int (*hash)(void* key);
     bool (*equals)(void* keyA, void* keyB);
-    pthread_mutex_t lock;
-    size_t size;
+    Shard* shards;
+    size_t shardCount; /* power of 2 */
+    bool concurrent;
 };
 
-Hashmap* hashmapCreate(size_t initialCapacity,
+static size_t roundUpToPowerOfTwo(size_t minimum) {
+    size_t value = 1;
+    while (value < minimum) {
+        value <<= 1;
+    }
+    return value;
+}
+
+static Hashmap* createMap(size_t initialCapacity, size_t shardCount, bool concurrent,
         int (*hash)(void* key), bool (*equals)(void* keyA, void* keyB)) {
     assert(hash != NULL);
     assert(equals != NULL);
 
-    Hashmap* map = static_cast<Hashmap*>(malloc(sizeof(Hashmap)));
+    Hashmap* map = static_cast<Hashmap*>(calloc(1, sizeof(Hashmap)));
     if (map == NULL) {
         return NULL;
     }
 
-    // 0.75 load factor.
-    size_t minimumBucketCount = initialCapacity * 4 / 3;
-    map->bucketCount = 1;
-    while (map->bucketCount <= minimumBucketCount) {
-        // Bucket count must be power of 2.
-        map->bucketCount <<= 1;
-    }
+    map->hash = hash;
+    map->equals = equals;
+    map->shardCount = roundUpToPowerOfTwo(shardCount);
+    map->concurrent = concurrent;
 
-    map->buckets = static_cast<Entry**>(calloc(map->bucketCount, sizeof(Entry*)));
-    if (map->buckets == NULL) {
+    map->shards = static_cast<Shard*>(calloc(map->shardCount, sizeof(Shard)));
+    if (map->shards == NULL) {
         free(map);
         return NULL;
     }
 
-    map->size = 0;
+    // 0.75 load factor, split across the shards.
+    size_t perShard = (initialCapacity + map->shardCount - 1) / map->shardCount;
+    size_t capacity = roundUpToPowerOfTwo(perShard * 4 / 3 + 1);
 
-    map->hash = hash;
-    map->equals = equals;
-
-    pthread_mutex_init(&map->lock, nullptr);
+    for (size_t i = 0; i < map->shardCount; i++) {
+        Shard* shard = &map->shards[i];
+        shard->entries = static_cast<Entry*>(calloc(capacity, sizeof(Entry)));
+        if (shard->entries == NULL) {
+            while (i-- > 0) {
+                free(map->shards[i].entries);
+            }
+            free(map->shards);
+            free(map);
+            return NULL;
+        }
+        shard->capacity = capacity;
+        pthread_mutex_init(&shard->lock, nullptr);
+    }
 
     return map;
 }
 
+Hashmap* hashmapCreate(size_t initialCapacity,
+        int (*hash)(void* key), bool (*equals)(void* keyA, void* keyB)) {
+    return createMap(initialCapacity, 1, false, hash, equals);
+}
+
+Hashmap* hashmapCreateSharded(size_t initialCapacity, size_t shardCount,
+        int (*hash)(void* key), bool (*equals)(void* keyA, void* keyB)) {
+    if (shardCount < 1) {
+        shardCount = 1;
+    }
+    return createMap(initialCapacity, shardCount, true, hash, equals);
+}
+
 /**
  * Hashes the given key.
  */
@@ -93,61 +143,123 @@ static inline int hashKey(Hashmap* map, void* key) {
     return h;
 }
 
-static inline size_t calculateIndex(size_t bucketCount, int hash) {
-    return ((size_t) hash) & (bucketCount - 1);
+static inline size_t calculateIndex(size_t capacity, int hash) {
+    return ((size_t) hash) & (capacity - 1);
 }
 
-static void expandIfNecessary(Hashmap* map) {
-    // If the load factor exceeds 0.75...
-    if (map->size > (map->bucketCount * 3 / 4)) {
-        // Start off with a 0.33 load factor.
-        size_t newBucketCount = map->bucketCount << 1;
-        Entry** newBuckets = static_cast<Entry**>(calloc(newBucketCount, sizeof(Entry*)));
-        if (newBuckets == NULL) {
-            // Abort expansion.
-            return;
+static inline Shard* shardFor(Hashmap* map, int hash) {
+    // The high bits are independent of the in-shard index bits.
+    return &map->shards[(((unsigned int) hash) >> 16) & (map->shardCount - 1)];
+}
+
+static inline void lockShard(Hashmap* map, Shard* shard) {
+    if (map->concurrent) {
+        pthread_mutex_lock(&shard->lock);
+    }
+}
+
+static inline void unlockShard(Hashmap* map, Shard* shard) {
+    if (map->concurrent) {
+        pthread_mutex_unlock(&shard->lock);
+    }
+}
+
+static inline bool equalKeys(void* keyA, int hashA, void* keyB, int hashB,
+        bool (*equals)(void*, void*)) {
+    if (keyA == keyB) {
+        return true;
+    }
+    if (hashA != hashB) {
+        return false;
+    }
+    return equals(keyA, keyB);
+}
+
+/* Returns the slot holding (key, hash), or SIZE_MAX if absent. */
+static size_t findSlot(Hashmap* map, Shard* shard, void* key, int hash) {
+    size_t index = calculateIndex(shard->capacity, hash);
+    uint32_t dib = 1;
+    while (true) {
+        Entry* entry = &shard->entries[index];
+        if (entry->dib == 0 || entry->dib < dib) {
+            // An empty slot, or an entry closer to home than we would be:
+            // the robin hood invariant says the key cannot be further on.
+            return SIZE_MAX;
         }
+        if (equalKeys(entry->key, entry->hash, key, hash, map->equals)) {
+            return index;
+        }
+        index = (index + 1) & (shard->capacity - 1);
+        dib++;
+    }
+}
 
-        // Move over existing entries.
-        size_t i;
-        for (i = 0; i < map->bucketCount; i++) {
-            Entry* entry = map->buckets[i];
-            while (entry != NULL) {
-                Entry* next = entry->next;
-                size_t index = calculateIndex(newBucketCount, entry->hash);
-                entry->next = newBuckets[index];
-                newBuckets[index] = entry;
-                entry = next;
-            }
+/* Inserts an entry known not to be present, displacing richer entries. */
+static void insertEntry(Shard* shard, Entry entry) {
+    size_t index = calculateIndex(shard->capacity, entry.hash);
+    entry.dib = 1;
+    while (true) {
+        Entry* slot = &shard->entries[index];
+        if (slot->dib == 0) {
+            *slot = entry;
+            return;
         }
+        if (slot->dib < entry.dib) {
+            Entry displaced = *slot;
+            *slot = entry;
+            entry = displaced;
+        }
+        index = (index + 1) & (shard->capacity - 1);
+        entry.dib++;
+    }
+}
 
-        // Copy over internals.
-        free(map->buckets);
-        map->buckets = newBuckets;
-        map->bucketCount = newBucketCount;
+static bool expandIfNecessary(Shard* shard) {
+    // If the load factor exceeds 0.75...
+    if (shard->size <= (shard->capacity * 3 / 4)) {
+        return true;
+    }
+
+    size_t newCapacity = shard->capacity << 1;
+    Entry* newEntries = static_cast<Entry*>(calloc(newCapacity, sizeof(Entry)));
+    if (newEntries == NULL) {
+        // Abort expansion; the table still works as long as at least one
+        // slot stays empty (probes and displacement need a terminator).
+        return shard->size + 1 < shard->capacity;
+    }
+
+    Entry* oldEntries = shard->entries;
+    size_t oldCapacity = shard->capacity;
+    shard->entries = newEntries;
+    shard->capacity = newCapacity;
+    for (size_t i = 0; i < oldCapacity; i++) {
+        if (oldEntries[i].dib != 0) {
+            insertEntry(shard, oldEntries[i]);
+        }
     }
+    free(oldEntries);
+    return true;
 }
 
 void hashmapLock(Hashmap* map) {
-    pthread_mutex_lock(&map->lock);
+    for (size_t i = 0; i < map->shardCount; i++) {
+        pthread_mutex_lock(&map->shards[i].lock);
+    }
 }
 
 void hashmapUnlock(Hashmap* map) {
-    pthread_mutex_unlock(&map->lock);
+    size_t i = map->shardCount;
+    while (i-- > 0) {
+        pthread_mutex_unlock(&map->shards[i].lock);
+    }
 }
 
 void hashmapFree(Hashmap* map) {
-    size_t i;
-    for (i = 0; i < map->bucketCount; i++) {
-        Entry* entry = map->buckets[i];
-        while (entry != NULL) {
-            Entry* next = entry->next;
-            free(entry);
-            entry = next;
-        }
+    for (size_t i = 0; i < map->shardCount; i++) {
+        free(map->shards[i].entries);
+        pthread_mutex_destroy(&map->shards[i].lock);
     }
-    free(map->buckets);
-    pthread_mutex_destroy(&map->lock);
+    free(map->shards);
     free(map);
 }
 
@@ -166,109 +278,103 @@ int hashmapHash(void* key, size_t keySize) {
     return h;
 }
 
-static Entry* createEntry(void* key, int hash, void* value) {
-    Entry* entry = static_cast<Entry*>(malloc(sizeof(Entry)));
-    if (entry == NULL) {
-        return NULL;
+void* hashmapPut(Hashmap* map, void* key, void* value) {
+    int hash = hashKey(map, key);
+    Shard* shard = shardFor(map, hash);
+    lockShard(map, shard);
+
+    // Replace existing entry.
+    size_t index = findSlot(map, shard, key, hash);
+    if (index != SIZE_MAX) {
+        Entry* entry = &shard->entries[index];
+        void* oldValue = entry->value;
+        entry->value = value;
+        unlockShard(map, shard);
+        return oldValue;
     }
-    entry->key = key;
-    entry->hash = hash;
-    entry->value = value;
-    entry->next = NULL;
-    return entry;
-}
 
-static inline bool equalKeys(void* keyA, int hashA, void* keyB, int hashB,
-        bool (*equals)(void*, void*)) {
-    if (keyA == keyB) {
-        return true;
-    }
-    if (hashA != hashB) {
-        return false;
+    // Add a new entry.
+    if (!expandIfNecessary(shard)) {
+        unlockShard(map, shard);
+        errno = ENOMEM;
+        return NULL;
     }
-    return equals(keyA, keyB);
+    Entry entry = {key, value, hash, 0};
+    insertEntry(shard, entry);
+    shard->size++;
+
+    unlockShard(map, shard);
+    return NULL;
 }
 
-void* hashmapPut(Hashmap* map, void* key, void* value) {
+void* hashmapGet(Hashmap* map, void* key) {
     int hash = hashKey(map, key);
-    size_t index = calculateIndex(map->bucketCount, hash);
-
-    Entry** p = &(map->buckets[index]);
-    while (true) {
-        Entry* current = *p;
-
-        // Add a new entry.
-        if (current == NULL) {
-            *p = createEntry(key, hash, value);
-            if (*p == NULL) {
-                errno = ENOMEM;
-                return NULL;
-            }
-            map->size++;
-            expandIfNecessary(map);
-            return NULL;
-        }
-
-        // Replace existing entry.
-        if (equalKeys(current->key, current->hash, key, hash, map->equals)) {
-            void* oldValue = current->value;
-            current->value = value;
-            return oldValue;
-        }
+    Shard* shard = shardFor(map, hash);
+    lockShard(map, shard);
 
-        // Move to next entry.
-        p = &current->next;
+    void* value = NULL;
+    size_t index = findSlot(map, shard, key, hash);
+    if (index != SIZE_MAX) {
+        value = shard->entries[index].value;
     }
-}
 
-void* hashmapGet(Hashmap* map, void* key) {
-    int hash = hashKey(map, key);
-    size_t index = calculateIndex(map->bucketCount, hash);
+    unlockShard(map, shard);
+    return value;
+}
 
-    Entry* entry = map->buckets[index];
-    while (entry != NULL) {
-        if (equalKeys(entry->key, entry->hash, key, hash, map->equals)) {
-            return entry->value;
+/* Empties 'index' and backward-shifts the rest of its cluster. */
+static void removeSlot(Shard* shard, size_t index) {
+    while (true) {
+        size_t next = (index + 1) & (shard->capacity - 1);
+        Entry* nextEntry = &shard->entries[next];
+        if (nextEntry->dib <= 1) {
+            break;
         }
-        entry = entry->next;
+        shard->entries[index] = *nextEntry;
+        shard->entries[index].dib--;
+        index = next;
     }
-
-    return NULL;
+    shard->entries[index].dib = 0;
+    shard->size--;
 }
 
 void* hashmapRemove(Hashmap* map, void* key) {
     int hash = hashKey(map, key);
-    size_t index = calculateIndex(map->bucketCount, hash);
-
-    // Pointer to the current entry.
-    Entry** p = &(map->buckets[index]);
-    Entry* current;
-    while ((current = *p) != NULL) {
-        if (equalKeys(current->key, current->hash, key, hash, map->equals)) {
-            void* value = current->value;
-            *p = current->next;
-            free(current);
-            map->size--;
-            return value;
-        }
-
-        p = &current->next;
+    Shard* shard = shardFor(map, hash);
+    lockShard(map, shard);
+
+    void* value = NULL;
+    size_t index = findSlot(map, shard, key, hash);
+    if (index != SIZE_MAX) {
+        value = shard->entries[index].value;
+        removeSlot(shard, index);
     }
 
-    return NULL;
+    unlockShard(map, shard);
+    return value;
 }
 
 void hashmapForEach(Hashmap* map, bool (*callback)(void* key, void* value, void* context),
                     void* context) {
-    size_t i;
-    for (i = 0; i < map->bucketCount; i++) {
-        Entry* entry = map->buckets[i];
-        while (entry != NULL) {
-            Entry *next = entry->next;
-            if (!callback(entry->key, entry->value, context)) {
+    for (size_t s = 0; s < map->shardCount; s++) {
+        Shard* shard = &map->shards[s];
+        lockShard(map, shard);
+        for (size_t i = 0; i < shard->capacity; i++) {
+            if (shard->entries[i].dib == 0) {
+                continue;
+            }
+            size_t sizeBefore = shard->size;
+            if (!callback(shard->entries[i].key, shard->entries[i].value, context)) {
+                unlockShard(map, shard);
                 return;
             }
-            entry = next;
+            if (shard->size < sizeBefore) {
+                // The callback removed the current entry (legal on
+                // unsharded maps); the backward shift may have pulled a
+                // not-yet-visited entry into this slot.
+                i--;
+            }
         }
+        unlockShard(map, shard);
     }
 }
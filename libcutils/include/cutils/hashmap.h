@@ -44,6 +44,17 @@ typedef struct Hashmap Hashmap;
 Hashmap* hashmapCreate(size_t initialCapacity,
         int (*hash)(void* key), bool (*equals)(void* keyA, void* keyB));
 
+/**
+ * Like hashmapCreate, but the map is split into shardCount (rounded up to a
+ * power of two) independently locked shards, and every operation locks only
+ * the shard it touches. Such a map is safe to use from multiple threads
+ * without hashmapLock, which on a sharded map locks every shard. Callbacks
+ * passed to hashmapForEach run with the shard lock held and must not call
+ * back into the map.
+ */
+Hashmap* hashmapCreateSharded(size_t initialCapacity, size_t shardCount,
+        int (*hash)(void* key), bool (*equals)(void* keyA, void* keyB));
+
 /**
  * Frees the hash map. Does not free the keys or values themselves.
  */
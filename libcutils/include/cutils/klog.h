@@ -29,6 +29,18 @@ void klog_write(int level, const char *fmt, ...)
     __attribute__ ((format(printf, 2, 3)));
 void klog_writev(int level, const struct iovec* iov, int iov_count);
 
+/* Buffered sink: between klog_buffer_begin() and klog_buffer_end(), records
+ * accumulate in memory instead of costing one (console-synchronous) syscall
+ * each, and are written out on klog_buffer_flush(), on klog_buffer_end(), at
+ * the autoflush severity (numerically <= the given level, default
+ * KLOG_ERROR_LEVEL), or when the buffer fills. Not thread safe: intended for
+ * single-threaded early-boot bursts (init, ueventd coldboot).
+ */
+void klog_buffer_begin(void);
+void klog_buffer_flush(void);
+void klog_buffer_end(void);
+void klog_set_autoflush_level(int level);
+
 __END_DECLS
 
 #define KLOG_ERROR_LEVEL   3
@@ -28,6 +28,19 @@ extern "C" {
 size_t strlcpy(char *dst, const char *src, size_t size);
 #endif
 
+/* Fills dst with the 16-bit value. size is in bytes and must be a multiple
+ * of 2; dst must be 2-byte aligned. Used for RGB565 fills. */
+void android_memset16(uint16_t* dst, uint16_t value, size_t size);
+
+/* Fills dst with the 32-bit value. size is in bytes and must be a multiple
+ * of 4; dst must be 4-byte aligned. */
+void android_memset32(uint32_t* dst, uint32_t value, size_t size);
+
+/* Copies 16-bit pixels from src to dst, swapping the two bytes of each
+ * pixel (for RGB565 targets with the opposite byte order). size is in bytes
+ * and must be a multiple of 2; the ranges must not overlap. */
+void android_memcpy16_swap(uint16_t* dst, const uint16_t* src, size_t size);
+
 // Disables memory mitigations for the entire process, and logs appropriately.
 void process_disable_memory_mitigations();
 
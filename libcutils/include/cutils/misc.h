@@ -28,6 +28,22 @@ extern "C" {
          */
 extern void *load_file(const char *fn, unsigned *sz);
 
+#ifndef _WIN32
+        /* Like load_file, but returns a private read-only mapping of the
+         * file (still NUL-terminated) instead of a malloc'd copy, so pages
+         * are only faulted in as they are touched. A non-zero prefault
+         * asks the kernel to read the whole file ahead (MADV_WILLNEED).
+         * Release the result with unload_file_mmap, not free.
+         * Returns 0 on failure.
+         */
+extern void *load_file_mmap(const char *fn, unsigned *sz, int prefault);
+
+        /* Unmaps a mapping returned by load_file_mmap; sz must be the
+         * size it reported.
+         */
+extern void unload_file_mmap(void *data, unsigned sz);
+#endif
+
         /* This is the range of UIDs (and GIDs) that are reserved
          * for assigning to applications.
          */
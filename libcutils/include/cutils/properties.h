@@ -106,6 +106,30 @@ int64_t property_get_int64(const char *key, int64_t default_value);
 **/
 int32_t property_get_int32(const char *key, int32_t default_value);
 
+/* property_cache_t: per-call-site state for property_get_cached. Must be
+** zero-initialized (e.g. static storage) before first use and dedicated to a
+** single key. Not thread safe: use one cache per thread or synchronize
+** externally.
+*/
+typedef struct property_cache {
+    const void* pi;         /* found property, NULL until it first appears */
+    uint32_t area_serial;   /* area serial at the last failed lookup */
+    uint32_t serial;        /* property serial of the cached value */
+    uint32_t flags;
+    int len;
+    char value[PROPERTY_VALUE_MAX];
+} property_cache_t;
+
+/* property_get_cached: like property_get, but amortizes the property lookup
+** across calls. The prop_info pointer is resolved once and the stored value
+** is reread only when the property's serial changes; a missing property is
+** looked up again only after the global area serial changes (i.e. some
+** property was created or deleted). Intended for hot paths that poll the
+** same property repeatedly.
+*/
+int property_get_cached(const char* key, property_cache_t* cache, char* value,
+                        const char* default_value);
+
 /* property_set: returns 0 on success, < 0 on failure
 */
 int property_set(const char *key, const char *value);
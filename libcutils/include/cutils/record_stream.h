@@ -21,20 +21,33 @@
 #ifndef _CUTILS_RECORD_STREAM_H
 #define _CUTILS_RECORD_STREAM_H
 
+#include <stddef.h>
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-#include <stddef.h>
-
 typedef struct RecordStream RecordStream;
 
 extern RecordStream *record_stream_new(int fd, size_t maxRecordLen);
 extern void record_stream_free(RecordStream *p_rs);
 
-extern int record_stream_get_next (RecordStream *p_rs, void ** p_outRecord, 
+extern int record_stream_get_next (RecordStream *p_rs, void ** p_outRecord,
                                     size_t *p_outRecordLen);
 
+#ifndef _WIN32
+/* Drains every complete buffered record at once, reading from the stream
+ * once if none is pending. Fills up to maxRecords iovecs with pointers into
+ * the stream's buffer; they stay valid until the next call on the stream.
+ * Returns the record count, 0 on end of stream, or -1 with errno set
+ * (EAGAIN if only an incomplete record is available). */
+extern int record_stream_get_all (RecordStream *p_rs, struct iovec *records,
+                                    int maxRecords);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
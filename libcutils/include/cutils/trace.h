@@ -148,6 +148,25 @@ extern int atrace_marker_fd;
 void atrace_init();
 uint64_t atrace_get_enabled_tags();
 
+/**
+ * Batch trace events on the current thread. Between ATRACE_BATCH_BEGIN() and
+ * ATRACE_BATCH_END(), events recorded through the ATRACE_* macros below are
+ * encoded into a per-thread buffer and written to trace_marker in batches
+ * instead of costing a syscall each, which keeps tracing overhead out of
+ * tight loops (e.g. per-frame rendering work). Because the kernel stamps
+ * trace_marker lines at write time, batched records carry explicit
+ * record-time timestamps in the extended format the container backend
+ * already emits (ph|pid|tid|ts|tts|...). The buffer flushes when it fills,
+ * on ATRACE_BATCH_FLUSH(), on ATRACE_BATCH_END(), and when the thread exits.
+ */
+#define ATRACE_BATCH_BEGIN() atrace_batch_begin()
+#define ATRACE_BATCH_FLUSH() atrace_batch_flush()
+#define ATRACE_BATCH_END() atrace_batch_end()
+
+void atrace_batch_begin();
+void atrace_batch_flush();
+void atrace_batch_end();
+
 /**
  * Test if a given tag is currently enabled.
  * Returns nonzero if the tag is enabled, otherwise zero.
@@ -24,10 +24,19 @@
 extern "C" {
 #endif
 
+/* Most messages uevent_kernel_recv_batch will accept per call. */
+#define UEVENT_RECV_BATCH_MAX 64
+
+/* Bytes of each message uevent_attach_subsystem_filter scans in-kernel. */
+#define UEVENT_FILTER_SCAN_BYTES 256
+
 int uevent_open_socket(int buf_sz, bool passcred);
+int uevent_attach_subsystem_filter(int socket, const char* subsystem);
 ssize_t uevent_kernel_multicast_recv(int socket, void *buffer, size_t length);
 ssize_t uevent_kernel_multicast_uid_recv(int socket, void *buffer, size_t length, uid_t *uid);
 ssize_t uevent_kernel_recv(int socket, void *buffer, size_t length, bool require_group, uid_t *uid);
+ssize_t uevent_kernel_recv_batch(int socket, void *buffer_pool, size_t buffer_size, size_t count,
+                                 ssize_t *lengths, bool require_group);
 
 #ifdef __cplusplus
 }
@@ -25,4 +25,11 @@ int load_canned_fs_config(const char* fn);
 void canned_fs_config(const char* path, int dir, const char* target_out_path, unsigned* uid,
                       unsigned* gid, unsigned* mode, uint64_t* capabilities);
 
+#ifndef _WIN32
+// Writes the loaded config in a precompiled mmap-able form (sorted entries
+// plus a hash index over interned paths). load_canned_fs_config detects the
+// format and maps it directly, skipping the per-line parse.
+int save_canned_fs_config(const char* fn);
+#endif
+
 __END_DECLS
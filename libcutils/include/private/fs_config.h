@@ -21,6 +21,7 @@
 
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 #include <sys/cdefs.h>
 
@@ -47,4 +48,22 @@ __BEGIN_DECLS
 void fs_config(const char* path, int dir, const char* target_out_path, unsigned* uid, unsigned* gid,
                unsigned* mode, uint64_t* capabilities);
 
+/*
+ * Bulk variant of fs_config() for tools walking whole file lists (e.g. every
+ * entry of a system image). Looks up count paths in one call, filling one
+ * result per path; results are identical to calling fs_config() per path,
+ * but the runtime override files are parsed only once for the whole batch.
+ * Like fs_config(), the mode field is updated in place: non-permission bits
+ * the caller put there are preserved.
+ */
+struct fs_config_result {
+    unsigned uid;
+    unsigned gid;
+    unsigned mode;
+    uint64_t capabilities;
+};
+
+void fs_config_bulk(const char* const* paths, size_t count, int dir, const char* target_out_path,
+                    struct fs_config_result* results);
+
 __END_DECLS
@@ -19,6 +19,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -42,12 +43,91 @@ static int __open_klog(void) {
     return TEMP_FAILURE_RETRY(open(kmsg_device, O_WRONLY | O_CLOEXEC));
 }
 
+static int __get_klog_fd(void) {
+    static int klog_fd = __open_klog();
+    return klog_fd;
+}
+
 #define LOG_BUF_MAX 512
 
+/* Buffered sink. /dev/kmsg writes are synchronous with the console, so a
+ * coldboot burst of a few hundred records costs real wall-clock time on the
+ * caller. While buffering is on, records are framed into this buffer (two
+ * length bytes, then the payload) and written out later in one tight loop.
+ * The kernel treats each write() to /dev/kmsg as a single record, so the
+ * flush still issues one syscall per record; the win is moving them off the
+ * caller's critical path and keeping the fast path malloc- and syscall-free.
+ */
+#define KLOG_BUFFER_SIZE 16384
+
+static bool klog_buffering = false;
+static int klog_autoflush_level = KLOG_ERROR_LEVEL;
+static char* klog_buffer;
+static size_t klog_buffer_used;
+
+void klog_buffer_begin(void) {
+    if (klog_buffer == NULL) {
+        klog_buffer = static_cast<char*>(malloc(KLOG_BUFFER_SIZE));
+    }
+    if (klog_buffer != NULL) klog_buffering = true;
+}
+
+void klog_buffer_flush(void) {
+    if (klog_buffer_used == 0) return;
+
+    int fd = __get_klog_fd();
+    if (fd != -1) {
+        size_t off = 0;
+        while (off < klog_buffer_used) {
+            uint16_t len;
+            memcpy(&len, klog_buffer + off, sizeof(len));
+            off += sizeof(len);
+            TEMP_FAILURE_RETRY(write(fd, klog_buffer + off, len));
+            off += len;
+        }
+    }
+    klog_buffer_used = 0;
+}
+
+void klog_buffer_end(void) {
+    klog_buffer_flush();
+    klog_buffering = false;
+}
+
+void klog_set_autoflush_level(int level) {
+    klog_autoflush_level = level;
+}
+
+static bool klog_buffer_record(int level, const struct iovec* iov, int iov_count) {
+    size_t total = 0;
+    for (int i = 0; i < iov_count; i++) {
+        total += iov[i].iov_len;
+    }
+    if (total > UINT16_MAX) return false;
+
+    if (sizeof(uint16_t) + total > KLOG_BUFFER_SIZE - klog_buffer_used) {
+        klog_buffer_flush();
+        if (sizeof(uint16_t) + total > KLOG_BUFFER_SIZE) return false;
+    }
+
+    uint16_t len = total;
+    memcpy(klog_buffer + klog_buffer_used, &len, sizeof(len));
+    klog_buffer_used += sizeof(len);
+    for (int i = 0; i < iov_count; i++) {
+        memcpy(klog_buffer + klog_buffer_used, iov[i].iov_base, iov[i].iov_len);
+        klog_buffer_used += iov[i].iov_len;
+    }
+
+    if (level <= klog_autoflush_level) klog_buffer_flush();
+    return true;
+}
+
 void klog_writev(int level, const struct iovec* iov, int iov_count) {
     if (level > klog_level) return;
 
-    static int klog_fd = __open_klog();
+    if (klog_buffering && klog_buffer_record(level, iov, iov_count)) return;
+
+    int klog_fd = __get_klog_fd();
     if (klog_fd == -1) return;
     TEMP_FAILURE_RETRY(writev(klog_fd, iov, iov_count));
 }
@@ -17,9 +17,15 @@
 
 #include <cutils/misc.h>
 
+#include <limits.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <fcntl.h>
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 void *load_file(const char *fn, unsigned *_sz)
 {
@@ -51,3 +57,61 @@ oops:
     if(data != 0) free(data);
     return 0;
 }
+
+#if !defined(_WIN32)
+/* Like load_file, but the data is a private read-only mapping instead of a
+** malloc'd copy, so pages are faulted in on demand (or up front when
+** prefault is set) and nothing is copied. The mapping always has a NUL
+** just past the end: when the file size is a page multiple the file is
+** mapped over a zero-filled anonymous region one page larger, otherwise
+** the zero fill of the last page provides it.
+*/
+void *load_file_mmap(const char *fn, unsigned *_sz, int prefault)
+{
+    void *data;
+    struct stat st;
+    size_t sz;
+    size_t pagesize;
+    int fd;
+
+    fd = open(fn, O_RDONLY | O_CLOEXEC);
+    if(fd < 0) return 0;
+
+    if(fstat(fd, &st) < 0) goto oops;
+    if((uint64_t)st.st_size > UINT_MAX - 1) goto oops;
+    sz = st.st_size;
+
+    pagesize = sysconf(_SC_PAGESIZE);
+    if(sz % pagesize != 0) {
+        /* the zero fill of the last page is the NUL terminator */
+        data = mmap(NULL, sz + 1, PROT_READ, MAP_PRIVATE, fd, 0);
+    } else {
+        data = mmap(NULL, sz + pagesize, PROT_READ,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(data != MAP_FAILED && sz != 0
+                && mmap(data, sz, PROT_READ, MAP_PRIVATE | MAP_FIXED,
+                        fd, 0) == MAP_FAILED) {
+            munmap(data, sz + pagesize);
+            data = MAP_FAILED;
+        }
+    }
+    if(data == MAP_FAILED) goto oops;
+    close(fd);
+
+    if(prefault) madvise(data, sz + 1, MADV_WILLNEED);
+
+    if(_sz) *_sz = sz;
+    return data;
+
+oops:
+    close(fd);
+    return 0;
+}
+
+void unload_file_mmap(void *data, unsigned sz)
+{
+    /* munmap rounds the length up to a page boundary, which also covers
+     * the anonymous terminator page when sz is a page multiple */
+    munmap(data, (size_t)sz + 1);
+}
+#endif /* !defined(_WIN32) */
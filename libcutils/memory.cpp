@@ -22,6 +22,199 @@
 #include <bionic/malloc.h>
 #endif
 
+#if defined(__i386__) || defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// 16/32-bit fills and the byte-swapping 16-bit copy used by display code.
+// Sizes are in bytes; counts below are in elements. Each op has a scalar
+// tail shared by all the vector kernels.
+
+static void android_memset16_scalar(uint16_t* dst, uint16_t value, size_t count) {
+    while (count-- != 0) {
+        *dst++ = value;
+    }
+}
+
+static void android_memset32_scalar(uint32_t* dst, uint32_t value, size_t count) {
+    while (count-- != 0) {
+        *dst++ = value;
+    }
+}
+
+static void android_memcpy16_swap_scalar(uint16_t* dst, const uint16_t* src, size_t count) {
+    while (count-- != 0) {
+        *dst++ = __builtin_bswap16(*src++);
+    }
+}
+
+#if defined(__i386__) || defined(__x86_64__)
+
+// SSE2 is baseline on both Android x86 ABIs; AVX2 is picked at runtime.
+static bool memory_has_avx2() {
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+}
+
+__attribute__((target("avx2")))
+static void android_memset16_avx2(uint16_t* dst, uint16_t value, size_t count) {
+    __m256i v = _mm256_set1_epi16(value);
+    while (count >= 32) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), v);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 16), v);
+        dst += 32;
+        count -= 32;
+    }
+    android_memset16_scalar(dst, value, count);
+}
+
+static void android_memset16_sse2(uint16_t* dst, uint16_t value, size_t count) {
+    __m128i v = _mm_set1_epi16(value);
+    while (count >= 16) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), v);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 8), v);
+        dst += 16;
+        count -= 16;
+    }
+    android_memset16_scalar(dst, value, count);
+}
+
+__attribute__((target("avx2")))
+static void android_memset32_avx2(uint32_t* dst, uint32_t value, size_t count) {
+    __m256i v = _mm256_set1_epi32(value);
+    while (count >= 16) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), v);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 8), v);
+        dst += 16;
+        count -= 16;
+    }
+    android_memset32_scalar(dst, value, count);
+}
+
+static void android_memset32_sse2(uint32_t* dst, uint32_t value, size_t count) {
+    __m128i v = _mm_set1_epi32(value);
+    while (count >= 8) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), v);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4), v);
+        dst += 8;
+        count -= 8;
+    }
+    android_memset32_scalar(dst, value, count);
+}
+
+__attribute__((target("avx2")))
+static void android_memcpy16_swap_avx2(uint16_t* dst, const uint16_t* src, size_t count) {
+    while (count >= 16) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+        v = _mm256_or_si256(_mm256_slli_epi16(v, 8), _mm256_srli_epi16(v, 8));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), v);
+        dst += 16;
+        src += 16;
+        count -= 16;
+    }
+    android_memcpy16_swap_scalar(dst, src, count);
+}
+
+static void android_memcpy16_swap_sse2(uint16_t* dst, const uint16_t* src, size_t count) {
+    while (count >= 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), v);
+        dst += 8;
+        src += 8;
+        count -= 8;
+    }
+    android_memcpy16_swap_scalar(dst, src, count);
+}
+
+#elif defined(__aarch64__)
+
+static void android_memset16_neon(uint16_t* dst, uint16_t value, size_t count) {
+    uint16x8_t v = vdupq_n_u16(value);
+    while (count >= 32) {
+        vst1q_u16(dst, v);
+        vst1q_u16(dst + 8, v);
+        vst1q_u16(dst + 16, v);
+        vst1q_u16(dst + 24, v);
+        dst += 32;
+        count -= 32;
+    }
+    android_memset16_scalar(dst, value, count);
+}
+
+static void android_memset32_neon(uint32_t* dst, uint32_t value, size_t count) {
+    uint32x4_t v = vdupq_n_u32(value);
+    while (count >= 16) {
+        vst1q_u32(dst, v);
+        vst1q_u32(dst + 4, v);
+        vst1q_u32(dst + 8, v);
+        vst1q_u32(dst + 12, v);
+        dst += 16;
+        count -= 16;
+    }
+    android_memset32_scalar(dst, value, count);
+}
+
+static void android_memcpy16_swap_neon(uint16_t* dst, const uint16_t* src, size_t count) {
+    while (count >= 8) {
+        uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(src));
+        vst1q_u8(reinterpret_cast<uint8_t*>(dst), vrev16q_u8(v));
+        dst += 8;
+        src += 8;
+        count -= 8;
+    }
+    android_memcpy16_swap_scalar(dst, src, count);
+}
+
+#endif
+
+void android_memset16(uint16_t* dst, uint16_t value, size_t size) {
+    size_t count = size / sizeof(uint16_t);
+#if defined(__i386__) || defined(__x86_64__)
+    if (memory_has_avx2()) {
+        android_memset16_avx2(dst, value, count);
+    } else {
+        android_memset16_sse2(dst, value, count);
+    }
+#elif defined(__aarch64__)
+    android_memset16_neon(dst, value, count);
+#else
+    android_memset16_scalar(dst, value, count);
+#endif
+}
+
+void android_memset32(uint32_t* dst, uint32_t value, size_t size) {
+    size_t count = size / sizeof(uint32_t);
+#if defined(__i386__) || defined(__x86_64__)
+    if (memory_has_avx2()) {
+        android_memset32_avx2(dst, value, count);
+    } else {
+        android_memset32_sse2(dst, value, count);
+    }
+#elif defined(__aarch64__)
+    android_memset32_neon(dst, value, count);
+#else
+    android_memset32_scalar(dst, value, count);
+#endif
+}
+
+void android_memcpy16_swap(uint16_t* dst, const uint16_t* src, size_t size) {
+    size_t count = size / sizeof(uint16_t);
+#if defined(__i386__) || defined(__x86_64__)
+    if (memory_has_avx2()) {
+        android_memcpy16_swap_avx2(dst, src, count);
+    } else {
+        android_memcpy16_swap_sse2(dst, src, count);
+    }
+#elif defined(__aarch64__)
+    android_memcpy16_swap_neon(dst, src, count);
+#else
+    android_memcpy16_swap_scalar(dst, src, count);
+#endif
+}
+
 void process_disable_memory_mitigations() {
     bool success = false;
 #ifdef __BIONIC__
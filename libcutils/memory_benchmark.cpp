@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cutils/memory.h>
+
+#include <string.h>
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+// A 720x1280 RGB565 frame is 1.8MB; the small sizes cover partial-row fills.
+
+static void BM_memset16(benchmark::State& state) {
+    size_t size = state.range(0);
+    std::vector<uint16_t> dst(size / sizeof(uint16_t));
+    while (state.KeepRunning()) {
+        android_memset16(dst.data(), 0x1234, size);
+        benchmark::DoNotOptimize(dst.data());
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_memset16)->Arg(64)->Arg(4096)->Arg(64 * 1024)->Arg(1840 * 1024);
+
+static void BM_memset32(benchmark::State& state) {
+    size_t size = state.range(0);
+    std::vector<uint32_t> dst(size / sizeof(uint32_t));
+    while (state.KeepRunning()) {
+        android_memset32(dst.data(), 0x12345678, size);
+        benchmark::DoNotOptimize(dst.data());
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_memset32)->Arg(64)->Arg(4096)->Arg(64 * 1024)->Arg(1840 * 1024);
+
+static void BM_memcpy16_swap(benchmark::State& state) {
+    size_t size = state.range(0);
+    std::vector<uint16_t> src(size / sizeof(uint16_t), 0x1234);
+    std::vector<uint16_t> dst(size / sizeof(uint16_t));
+    while (state.KeepRunning()) {
+        android_memcpy16_swap(dst.data(), src.data(), size);
+        benchmark::DoNotOptimize(dst.data());
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_memcpy16_swap)->Arg(64)->Arg(4096)->Arg(64 * 1024)->Arg(1840 * 1024);
+
+// memset baseline for the same sizes.
+static void BM_memset(benchmark::State& state) {
+    size_t size = state.range(0);
+    std::vector<uint8_t> dst(size);
+    while (state.KeepRunning()) {
+        memset(dst.data(), 0x12, size);
+        benchmark::DoNotOptimize(dst.data());
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_memset)->Arg(64)->Arg(4096)->Arg(64 * 1024)->Arg(1840 * 1024);
+
+BENCHMARK_MAIN();
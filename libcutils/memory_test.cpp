@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cutils/memory.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+// Lengths straddling every vector kernel width plus scalar tails.
+static const size_t kCounts[] = {0, 1, 2, 3, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 64, 1000};
+
+TEST(memory, android_memset16) {
+    for (size_t count : kCounts) {
+        // Guard elements on both sides catch overruns.
+        std::vector<uint16_t> buf(count + 2, 0xdead);
+        android_memset16(buf.data() + 1, 0x1234, count * sizeof(uint16_t));
+
+        EXPECT_EQ(0xdead, buf.front()) << "count " << count;
+        EXPECT_EQ(0xdead, buf.back()) << "count " << count;
+        for (size_t i = 0; i < count; i++) {
+            ASSERT_EQ(0x1234, buf[i + 1]) << "count " << count << " index " << i;
+        }
+    }
+}
+
+TEST(memory, android_memset32) {
+    for (size_t count : kCounts) {
+        std::vector<uint32_t> buf(count + 2, 0xdeadbeef);
+        android_memset32(buf.data() + 1, 0x12345678, count * sizeof(uint32_t));
+
+        EXPECT_EQ(0xdeadbeef, buf.front()) << "count " << count;
+        EXPECT_EQ(0xdeadbeef, buf.back()) << "count " << count;
+        for (size_t i = 0; i < count; i++) {
+            ASSERT_EQ(0x12345678U, buf[i + 1]) << "count " << count << " index " << i;
+        }
+    }
+}
+
+TEST(memory, android_memcpy16_swap) {
+    for (size_t count : kCounts) {
+        std::vector<uint16_t> src(count);
+        for (size_t i = 0; i < count; i++) {
+            src[i] = static_cast<uint16_t>(i * 2654435761U);
+        }
+        std::vector<uint16_t> dst(count + 2, 0xdead);
+        android_memcpy16_swap(dst.data() + 1, src.data(), count * sizeof(uint16_t));
+
+        EXPECT_EQ(0xdead, dst.front()) << "count " << count;
+        EXPECT_EQ(0xdead, dst.back()) << "count " << count;
+        for (size_t i = 0; i < count; i++) {
+            ASSERT_EQ(__builtin_bswap16(src[i]), dst[i + 1]) << "count " << count << " index " << i;
+        }
+    }
+}
@@ -96,6 +96,57 @@ int property_get(const char* key, char* value, const char* default_value) {
 #define _REALLY_INCLUDE_SYS__SYSTEM_PROPERTIES_H_
 #include <sys/_system_properties.h>
 
+enum {
+    // A lookup has been attempted and area_serial is valid.
+    CACHE_FLAG_LOOKED_UP = 1 << 0,
+    // value/len/serial hold a previously read value.
+    CACHE_FLAG_HAS_VALUE = 1 << 1,
+};
+
+static void property_get_cached_callback(void* raw_cache, const char* /*name*/, const char* value,
+                                         unsigned serial) {
+    property_cache_t* cache = reinterpret_cast<property_cache_t*>(raw_cache);
+    cache->len = snprintf(cache->value, sizeof(cache->value), "%s", value);
+    cache->serial = serial;
+}
+
+int property_get_cached(const char* key, property_cache_t* cache, char* value,
+                        const char* default_value) {
+    if (!key || !cache) return property_get(key, value, default_value);
+
+    const prop_info* pi = reinterpret_cast<const prop_info*>(cache->pi);
+    if (pi == nullptr) {
+        // Only repeat the trie walk for a missing property after the area
+        // serial says some property was created or deleted.
+        uint32_t area_serial = __system_property_area_serial();
+        if (!(cache->flags & CACHE_FLAG_LOOKED_UP) || cache->area_serial != area_serial) {
+            cache->area_serial = area_serial;
+            cache->flags |= CACHE_FLAG_LOOKED_UP;
+            pi = __system_property_find(key);
+            cache->pi = pi;
+        }
+    }
+
+    if (pi != nullptr) {
+        uint32_t serial = __system_property_serial(pi);
+        if (!(cache->flags & CACHE_FLAG_HAS_VALUE) || serial != cache->serial) {
+            __system_property_read_callback(pi, property_get_cached_callback, cache);
+            cache->flags |= CACHE_FLAG_HAS_VALUE;
+        }
+        if (cache->len > 0) {
+            memcpy(value, cache->value, cache->len + 1);
+            return cache->len;
+        }
+    }
+
+    if (default_value) {
+        snprintf(value, PROPERTY_VALUE_MAX, "%s", default_value);
+        return strlen(value);
+    }
+    value[0] = '\0';
+    return 0;
+}
+
 struct callback_data {
     void (*callback)(const char* name, const char* value, void* cookie);
     void* cookie;
@@ -115,4 +166,12 @@ int property_list(void (*fn)(const char* name, const char* value, void* cookie),
     return __system_property_foreach(property_list_callback, &data);
 }
 
+#else
+
+int property_get_cached(const char* key, property_cache_t* cache, char* value,
+                        const char* default_value) {
+    (void)cache;
+    return property_get(key, value, default_value);
+}
+
 #endif
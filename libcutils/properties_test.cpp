@@ -376,4 +376,55 @@ TEST_F(PropertiesTest, property_get_int32) {
     }
 }
 
+TEST_F(PropertiesTest, property_get_cached) {
+    property_cache_t cache = {};
+
+    // Missing property falls back to the default.
+    ResetValue();
+    int len = property_get_cached(PROPERTY_TEST_KEY ".cached", &cache, mValue,
+                                  PROPERTY_TEST_VALUE_DEFAULT);
+    EXPECT_EQ((int)strlen(PROPERTY_TEST_VALUE_DEFAULT), len);
+    EXPECT_STREQ(PROPERTY_TEST_VALUE_DEFAULT, mValue);
+
+    // Creating the property bumps the area serial, so the cache notices it.
+    ASSERT_OK(property_set(PROPERTY_TEST_KEY ".cached", "hello_world"));
+    ResetValue();
+    len = property_get_cached(PROPERTY_TEST_KEY ".cached", &cache, mValue,
+                              PROPERTY_TEST_VALUE_DEFAULT);
+    EXPECT_EQ((int)strlen("hello_world"), len);
+    EXPECT_STREQ("hello_world", mValue);
+
+    // Repeated reads are served from the cache and still match.
+    for (int i = 0; i < 3; i++) {
+        ResetValue();
+        len = property_get_cached(PROPERTY_TEST_KEY ".cached", &cache, mValue,
+                                  PROPERTY_TEST_VALUE_DEFAULT);
+        EXPECT_EQ((int)strlen("hello_world"), len);
+        EXPECT_STREQ("hello_world", mValue);
+    }
+
+    // Updating the property bumps its serial, so the cache rereads it.
+    ASSERT_OK(property_set(PROPERTY_TEST_KEY ".cached", "goodbye"));
+    ResetValue();
+    len = property_get_cached(PROPERTY_TEST_KEY ".cached", &cache, mValue,
+                              PROPERTY_TEST_VALUE_DEFAULT);
+    EXPECT_EQ((int)strlen("goodbye"), len);
+    EXPECT_STREQ("goodbye", mValue);
+
+    // Clearing the value makes the default visible again.
+    ASSERT_OK(property_set(PROPERTY_TEST_KEY ".cached", ""));
+    ResetValue();
+    len = property_get_cached(PROPERTY_TEST_KEY ".cached", &cache, mValue,
+                              PROPERTY_TEST_VALUE_DEFAULT);
+    EXPECT_EQ((int)strlen(PROPERTY_TEST_VALUE_DEFAULT), len);
+    EXPECT_STREQ(PROPERTY_TEST_VALUE_DEFAULT, mValue);
+
+    // A null cache degrades to a plain property_get.
+    ResetValue();
+    len = property_get_cached(PROPERTY_TEST_KEY ".cached", nullptr, mValue,
+                              PROPERTY_TEST_VALUE_DEFAULT);
+    EXPECT_EQ((int)strlen(PROPERTY_TEST_VALUE_DEFAULT), len);
+    EXPECT_STREQ(PROPERTY_TEST_VALUE_DEFAULT, mValue);
+}
+
 } // namespace android
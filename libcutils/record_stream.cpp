@@ -2,16 +2,16 @@
 **
 ** Copyright 2006, The Android Open Source Project
 **
-** Licensed under the Apache License, Version 2.0 (the "License"); 
-** you may not use this file except in compliance with the License. 
-** You may obtain a copy of the License at 
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
 **
-**     http://www.apache.org/licenses/LICENSE-2.0 
+**     http://www.apache.org/licenses/LICENSE-2.0
 **
-** Unless required by applicable law or agreed to in writing, software 
-** distributed under the License is distributed on an "AS IS" BASIS, 
-** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. 
-** See the License for the specific language governing permissions and 
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
 ** limitations under the License.
 */
 
@@ -31,6 +31,12 @@
 
 #define HEADER_SIZE 4
 
+/* The buffer holds several maximum-size records so a single read can
+ * deliver a whole burst. Records are consumed by advancing a cursor; bytes
+ * only move when a partial record is stranded against the end of the
+ * buffer, and then less than one record's worth is copied to the front. */
+#define NUM_BUFFERED_RECORDS 4
+
 struct RecordStream {
     int fd;
     size_t maxRecordLen;
@@ -40,6 +46,8 @@ struct RecordStream {
     unsigned char *unconsumed;
     unsigned char *read_end;
     unsigned char *buffer_end;
+
+    int overflowed; /* a record header exceeded maxRecordLen */
 };
 
 
@@ -53,11 +61,12 @@ extern RecordStream *record_stream_new(int fd, size_t maxRecordLen)
 
     ret->fd = fd;
     ret->maxRecordLen = maxRecordLen;
-    ret->buffer = (unsigned char *)malloc (maxRecordLen + HEADER_SIZE);
-    
+    ret->buffer = (unsigned char *)malloc (
+            NUM_BUFFERED_RECORDS * (maxRecordLen + HEADER_SIZE));
+
     ret->unconsumed = ret->buffer;
     ret->read_end = ret->buffer;
-    ret->buffer_end = ret->buffer + maxRecordLen + HEADER_SIZE;
+    ret->buffer_end = ret->buffer + NUM_BUFFERED_RECORDS * (maxRecordLen + HEADER_SIZE);
 
     return ret;
 }
@@ -71,18 +80,26 @@ extern void record_stream_free(RecordStream *rs)
 
 
 /* returns NULL; if there isn't a full record in the buffer */
-static unsigned char * getEndOfRecord (unsigned char *p_begin,
+static unsigned char * getEndOfRecord (RecordStream *p_rs,
+                                            unsigned char *p_begin,
                                             unsigned char *p_end)
 {
     size_t len;
+    uint32_t net_len;
     unsigned char * p_ret;
 
     if (p_end < p_begin + HEADER_SIZE) {
         return NULL;
     }
 
-    //First four bytes are length
-    len = ntohl(*((uint32_t *)p_begin));
+    /* First four bytes are length; the record start is not aligned */
+    memcpy(&net_len, p_begin, sizeof(net_len));
+    len = ntohl(net_len);
+
+    if (len > p_rs->maxRecordLen) {
+        p_rs->overflowed = 1;
+        return NULL;
+    }
 
     p_ret = p_begin + HEADER_SIZE + len;
 
@@ -97,7 +114,7 @@ static void *getNextRecord (RecordStream *p_rs, size_t *p_outRecordLen)
 {
     unsigned char *record_start, *record_end;
 
-    record_end = getEndOfRecord (p_rs->unconsumed, p_rs->read_end);
+    record_end = getEndOfRecord (p_rs, p_rs->unconsumed, p_rs->read_end);
 
     if (record_end != NULL) {
         /* one full line in the buffer */
@@ -112,6 +129,24 @@ static void *getNextRecord (RecordStream *p_rs, size_t *p_outRecordLen)
     return NULL;
 }
 
+/* Makes room for the next read. Consumed records are reclaimed with cursor
+ * resets; only a partial record stranded at the end of the buffer is ever
+ * copied. */
+static void makeRoom (RecordStream *p_rs)
+{
+    if (p_rs->unconsumed == p_rs->read_end) {
+        /* fully drained */
+        p_rs->unconsumed = p_rs->buffer;
+        p_rs->read_end = p_rs->buffer;
+    } else if (p_rs->read_end == p_rs->buffer_end) {
+        size_t toMove = p_rs->read_end - p_rs->unconsumed;
+
+        memmove(p_rs->buffer, p_rs->unconsumed, toMove);
+        p_rs->read_end = p_rs->buffer + toMove;
+        p_rs->unconsumed = p_rs->buffer;
+    }
+}
+
 /**
  * Reads the next record from stream fd
  * Records are prefixed by a 16-bit big endian length value
@@ -121,11 +156,13 @@ static void *getNextRecord (RecordStream *p_rs, size_t *p_outRecordLen)
  *
  * p_outRecord and p_outRecordLen may not be NULL
  *
+ * The record stays valid until the next call on this stream.
+ *
  * Return 0 on success, -1 on fail
  * Returns 0 with *p_outRecord set to NULL on end of stream
  * Returns -1 / errno = EAGAIN if it needs to read again
  */
-int record_stream_get_next (RecordStream *p_rs, void ** p_outRecord, 
+int record_stream_get_next (RecordStream *p_rs, void ** p_outRecord,
                                     size_t *p_outRecordLen)
 {
     void *ret;
@@ -140,10 +177,7 @@ int record_stream_get_next (RecordStream *p_rs, void ** p_outRecord,
         return 0;
     }
 
-    // if the buffer is full and we don't have a full record
-    if (p_rs->unconsumed == p_rs->buffer 
-        && p_rs->read_end == p_rs->buffer_end
-    ) {
+    if (p_rs->overflowed) {
         // this should never happen
         //ALOGE("max record length exceeded\n");
         assert (0);
@@ -151,18 +185,7 @@ int record_stream_get_next (RecordStream *p_rs, void ** p_outRecord,
         return -1;
     }
 
-    if (p_rs->unconsumed != p_rs->buffer) {
-        // move remainder to the beginning of the buffer
-        size_t toMove;
-
-        toMove = p_rs->read_end - p_rs->unconsumed;
-        if (toMove) {
-            memmove(p_rs->buffer, p_rs->unconsumed, toMove);
-        }
-
-        p_rs->read_end = p_rs->buffer + toMove;
-        p_rs->unconsumed = p_rs->buffer;
-    }
+    makeRoom (p_rs);
 
     countRead = read (p_rs->fd, p_rs->read_end, p_rs->buffer_end - p_rs->read_end);
 
@@ -177,11 +200,84 @@ int record_stream_get_next (RecordStream *p_rs, void ** p_outRecord,
     ret = getNextRecord (p_rs, p_outRecordLen);
 
     if (ret == NULL) {
+        if (p_rs->overflowed) {
+            assert (0);
+            errno = EFBIG;
+            return -1;
+        }
         /* not enough of a buffer to for a whole command */
         errno = EAGAIN;
         return -1;
     }
 
-    *p_outRecord = ret;        
+    *p_outRecord = ret;
     return 0;
 }
+
+#if !defined(_WIN32)
+/**
+ * Like record_stream_get_next, but drains every complete record at once:
+ * returns all records already buffered, reading from the stream once if
+ * none is pending, so a single read can yield many records with no
+ * intermediate copies. Fills up to maxRecords entries of records with
+ * pointers into the stream's buffer; they stay valid until the next call
+ * on this stream.
+ *
+ * Returns the number of records, 0 on end of stream, or -1 with errno set
+ * (EAGAIN if only an incomplete record is available).
+ */
+int record_stream_get_all (RecordStream *p_rs, struct iovec *records,
+                                    int maxRecords)
+{
+    void *record;
+    size_t recordLen;
+    ssize_t countRead;
+    int count = 0;
+
+    if (maxRecords <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (;;) {
+        while (count < maxRecords
+                && (record = getNextRecord (p_rs, &recordLen)) != NULL) {
+            records[count].iov_base = record;
+            records[count].iov_len = recordLen;
+            count++;
+        }
+
+        if (count > 0) {
+            return count;
+        }
+
+        if (p_rs->overflowed) {
+            assert (0);
+            errno = EFBIG;
+            return -1;
+        }
+
+        makeRoom (p_rs);
+
+        countRead = read (p_rs->fd, p_rs->read_end,
+                p_rs->buffer_end - p_rs->read_end);
+
+        if (countRead <= 0) {
+            /* note: end-of-stream drops through here too */
+            return countRead;
+        }
+
+        p_rs->read_end += countRead;
+
+        if (getEndOfRecord (p_rs, p_rs->unconsumed, p_rs->read_end) == NULL) {
+            if (p_rs->overflowed) {
+                assert (0);
+                errno = EFBIG;
+                return -1;
+            }
+            errno = EAGAIN;
+            return -1;
+        }
+    }
+}
+#endif /* !defined(_WIN32) */
@@ -44,8 +44,33 @@ static void *released_pointer;
 #define RELEASE_OWNERSHIP(x)
 #endif
 
+/* Audio HALs create and destroy a str_parms per setParameters call, and the
+ * typical map holds only a handful of pairs. Small maps therefore live in an
+ * arena: all keys and values are NUL-terminated strings in one slab, entries
+ * are slab offsets (so reallocation cannot dangle them), and lookup is a
+ * linear scan that compares a cached first byte before the full strcmp.
+ * Destroying a small map frees the slab and the struct instead of 2N
+ * strdup'd strings. Maps that outgrow the arena spill into the hashmap the
+ * old implementation always used.
+ */
+#define SMALL_PARMS_MAX_ENTRIES 16
+#define SMALL_PARMS_INITIAL_SLAB 64
+
+struct small_entry {
+    uint32_t key_off;
+    uint32_t value_off;
+};
+
 struct str_parms {
+    /* Non-NULL once the parms have spilled; the arena below is then dead. */
     Hashmap *map;
+
+    char *slab;
+    uint32_t slab_size;
+    uint32_t slab_used;
+    uint8_t first_byte[SMALL_PARMS_MAX_ENTRIES];
+    struct small_entry entries[SMALL_PARMS_MAX_ENTRIES];
+    int num_entries;
 };
 
 
@@ -67,18 +92,120 @@ static int str_hash_fn(void *str)
     return (int)hash;
 }
 
-struct str_parms *str_parms_create(void)
+static inline char *small_key(struct str_parms *str_parms, int i)
+{
+    return str_parms->slab + str_parms->entries[i].key_off;
+}
+
+static inline char *small_value(struct str_parms *str_parms, int i)
+{
+    return str_parms->slab + str_parms->entries[i].value_off;
+}
+
+static int small_find(struct str_parms *str_parms, const char *key)
+{
+    uint8_t first = (uint8_t)key[0];
+
+    for (int i = 0; i < str_parms->num_entries; i++) {
+        if (str_parms->first_byte[i] == first && !strcmp(small_key(str_parms, i), key))
+            return i;
+    }
+    return -1;
+}
+
+/* Copies str into the slab, growing it if needed, and returns the offset. */
+static int small_append(struct str_parms *str_parms, const char *str, uint32_t *off)
+{
+    size_t len = strlen(str) + 1;
+
+    if (str_parms->slab_used + len > str_parms->slab_size) {
+        uint32_t new_size = str_parms->slab_size ? str_parms->slab_size
+                                                 : SMALL_PARMS_INITIAL_SLAB;
+        while (str_parms->slab_used + len > new_size)
+            new_size <<= 1;
+        char* new_slab = static_cast<char*>(realloc(str_parms->slab, new_size));
+        if (!new_slab)
+            return -ENOMEM;
+        str_parms->slab = new_slab;
+        str_parms->slab_size = new_size;
+    }
+
+    *off = str_parms->slab_used;
+    memcpy(str_parms->slab + str_parms->slab_used, str, len);
+    str_parms->slab_used += len;
+    return 0;
+}
+
+static bool free_pair(void *key, void *value, void * /*context*/)
+{
+    free(key);
+    free(value);
+    return true;
+}
+
+/* Moves the arena entries into a hashmap so the parms can keep growing.
+ * The slab is left in place (callers may still hold tokens into it); it is
+ * freed in str_parms_destroy. */
+static int spill_to_map(struct str_parms *str_parms)
 {
-    str_parms* s = static_cast<str_parms*>(calloc(1, sizeof(str_parms)));
-    if (!s) return NULL;
+    Hashmap *map = hashmapCreate(SMALL_PARMS_MAX_ENTRIES * 2, str_hash_fn, str_eq);
+    if (!map)
+        return -ENOMEM;
+
+    for (int i = 0; i < str_parms->num_entries; i++) {
+        char *key = strdup(small_key(str_parms, i));
+        char *value = strdup(small_value(str_parms, i));
+
+        if (!key || !value) {
+            free(key);
+            free(value);
+            hashmapForEach(map, free_pair, NULL);
+            hashmapFree(map);
+            return -ENOMEM;
+        }
+        /* Arena keys are unique, so this never replaces. */
+        hashmapPut(map, key, value);
+        RELEASE_OWNERSHIP(key);
+        RELEASE_OWNERSHIP(value);
+    }
+
+    str_parms->map = map;
+    str_parms->num_entries = 0;
+    return 0;
+}
 
-    s->map = hashmapCreate(5, str_hash_fn, str_eq);
-    if (!s->map) {
-        free(s);
-        return NULL;
+/* Returns 0 on success, -ENOMEM, or -EOVERFLOW when the arena is full and
+ * the caller must spill to the hashmap first. */
+static int small_put(struct str_parms *str_parms, const char *key, const char *value)
+{
+    uint32_t key_off, value_off;
+
+    int i = small_find(str_parms, key);
+    if (i >= 0) {
+        /* Replace: the old value's bytes stay in the slab until destroy. */
+        if (small_append(str_parms, value, &value_off))
+            return -ENOMEM;
+        str_parms->entries[i].value_off = value_off;
+        return 0;
     }
 
-    return s;
+    if (str_parms->num_entries == SMALL_PARMS_MAX_ENTRIES)
+        return -EOVERFLOW;
+
+    if (small_append(str_parms, key, &key_off) ||
+        small_append(str_parms, value, &value_off))
+        return -ENOMEM;
+
+    str_parms->first_byte[str_parms->num_entries] = (uint8_t)key[0];
+    str_parms->entries[str_parms->num_entries].key_off = key_off;
+    str_parms->entries[str_parms->num_entries].value_off = value_off;
+    str_parms->num_entries++;
+    return 0;
+}
+
+struct str_parms *str_parms_create(void)
+{
+    return static_cast<str_parms*>(calloc(1, sizeof(str_parms)));
 }
 
 struct remove_ctxt {
@@ -118,6 +245,19 @@ do_remove:
 
 void str_parms_del(struct str_parms *str_parms, const char *key)
 {
+    if (!str_parms->map) {
+        int i = small_find(str_parms, key);
+        if (i >= 0) {
+            int remaining = str_parms->num_entries - i - 1;
+            memmove(&str_parms->entries[i], &str_parms->entries[i + 1],
+                    remaining * sizeof(str_parms->entries[0]));
+            memmove(&str_parms->first_byte[i], &str_parms->first_byte[i + 1],
+                    remaining * sizeof(str_parms->first_byte[0]));
+            str_parms->num_entries--;
+        }
+        return;
+    }
+
     struct remove_ctxt ctxt = {
         .str_parms = str_parms,
         .key = key,
@@ -127,64 +267,82 @@ void str_parms_del(struct str_parms *str_parms, const char *key)
 
 void str_parms_destroy(struct str_parms *str_parms)
 {
-    struct remove_ctxt ctxt = {
-        .str_parms = str_parms,
-    };
-
-    hashmapForEach(str_parms->map, remove_pair, &ctxt);
-    hashmapFree(str_parms->map);
+    if (str_parms->map) {
+        struct remove_ctxt ctxt = {
+            .str_parms = str_parms,
+        };
+        hashmapForEach(str_parms->map, remove_pair, &ctxt);
+        hashmapFree(str_parms->map);
+    }
+    free(str_parms->slab);
     free(str_parms);
 }
 
 struct str_parms *str_parms_create_str(const char *_string)
 {
     struct str_parms *str_parms;
-    char *str;
     char *kvpair;
     char *tmpstr;
     int items = 0;
+    size_t len;
 
     str_parms = str_parms_create();
     if (!str_parms)
         goto err_create_str_parms;
 
-    str = strdup(_string);
-    if (!str)
-        goto err_strdup;
+    /* One slab holds the whole string; tokens become entries in place. */
+    len = strlen(_string) + 1;
+    str_parms->slab = static_cast<char*>(malloc(len));
+    if (!str_parms->slab)
+        goto err_alloc_slab;
+    memcpy(str_parms->slab, _string, len);
+    str_parms->slab_size = len;
+    str_parms->slab_used = len;
 
     ALOGV("%s: source string == '%s'\n", __func__, _string);
 
-    kvpair = strtok_r(str, ";", &tmpstr);
+    kvpair = strtok_r(str_parms->slab, ";", &tmpstr);
     while (kvpair && *kvpair) {
         char *eq = strchr(kvpair, '='); /* would love strchrnul */
         char *value;
-        char *key;
-        void *old_val;
+        int i;
 
         if (eq == kvpair)
             goto next_pair;
 
         if (eq) {
-            key = strndup(kvpair, eq - kvpair);
-            if (*(++eq))
-                value = strdup(eq);
-            else
-                value = strdup("");
+            *eq = '\0';
+            value = eq + 1;
         } else {
-            key = strdup(kvpair);
-            value = strdup("");
+            /* No '=': the value aliases the key's terminating NUL. */
+            value = kvpair + strlen(kvpair);
         }
 
-        /* if we replaced a value, free it */
-        old_val = hashmapPut(str_parms->map, key, value);
-        RELEASE_OWNERSHIP(value);
-        if (old_val) {
-            free(old_val);
-            free(key);
-        } else {
-            RELEASE_OWNERSHIP(key);
+        if (!str_parms->map) {
+            i = small_find(str_parms, kvpair);
+            if (i >= 0) {
+                str_parms->entries[i].value_off = value - str_parms->slab;
+                goto added;
+            }
+            if (str_parms->num_entries < SMALL_PARMS_MAX_ENTRIES) {
+                str_parms->first_byte[str_parms->num_entries] = (uint8_t)kvpair[0];
+                str_parms->entries[str_parms->num_entries].key_off =
+                        kvpair - str_parms->slab;
+                str_parms->entries[str_parms->num_entries].value_off =
+                        value - str_parms->slab;
+                str_parms->num_entries++;
+                goto added;
+            }
+            /* Unusually large map; the remaining tokens still live in the
+             * slab, which spill_to_map leaves intact. */
+            if (spill_to_map(str_parms))
+                goto err_spill;
         }
 
+        if (str_parms_add_str(str_parms, kvpair, value))
+            goto err_spill;
+
+added:
         items++;
 next_pair:
         kvpair = strtok_r(NULL, ";", &tmpstr);
@@ -193,11 +351,10 @@ next_pair:
     if (!items)
         ALOGV("%s: no items found in string\n", __func__);
 
-    free(str);
-
     return str_parms;
 
-err_strdup:
+err_spill:
+err_alloc_slab:
     str_parms_destroy(str_parms);
 err_create_str_parms:
     return NULL;
@@ -210,6 +367,15 @@ int str_parms_add_str(struct str_parms *str_parms, const char *key,
     void *tmp_val = NULL;
     void *old_val = NULL;
 
+    if (!str_parms->map) {
+        int ret = small_put(str_parms, key, value);
+        if (ret != -EOVERFLOW)
+            return ret;
+        ret = spill_to_map(str_parms);
+        if (ret)
+            return ret;
+    }
+
     // strdup and hashmapPut both set errno on failure.
     // Set errno to 0 so we can recognize whether anything went wrong.
     int saved_errno = errno;
@@ -278,15 +444,24 @@ int str_parms_add_float(struct str_parms *str_parms, const char *key,
     return ret;
 }
 
+static char *str_parms_lookup(struct str_parms *str_parms, const char *key)
+{
+    if (!str_parms->map) {
+        int i = small_find(str_parms, key);
+        return (i >= 0) ? small_value(str_parms, i) : NULL;
+    }
+    // TODO: hashmapGet should take a const* key.
+    return static_cast<char*>(hashmapGet(str_parms->map, (void*)key));
+}
+
 int str_parms_has_key(struct str_parms *str_parms, const char *key) {
-    return hashmapGet(str_parms->map, (void *)key) != NULL;
+    return str_parms_lookup(str_parms, key) != NULL;
 }
 
 int str_parms_get_str(struct str_parms *str_parms, const char *key, char *val,
                       int len)
 {
-    // TODO: hashmapGet should take a const* key.
-    char* value = static_cast<char*>(hashmapGet(str_parms->map, (void*)key));
+    char *value = str_parms_lookup(str_parms, key);
     if (value)
         return strlcpy(val, value, len);
 
@@ -297,8 +472,7 @@ int str_parms_get_int(struct str_parms *str_parms, const char *key, int *val)
 {
     char *end;
 
-    // TODO: hashmapGet should take a const* key.
-    char* value = static_cast<char*>(hashmapGet(str_parms->map, (void*)key));
+    char *value = str_parms_lookup(str_parms, key);
     if (!value)
         return -ENOENT;
 
@@ -315,8 +489,7 @@ int str_parms_get_float(struct str_parms *str_parms, const char *key,
     float out;
     char *end;
 
-    // TODO: hashmapGet should take a const* key.
-    char* value = static_cast<char*>(hashmapGet(str_parms->map, (void*)(key)));
+    char *value = str_parms_lookup(str_parms, key);
     if (!value)
         return -ENOENT;
 
@@ -354,7 +527,15 @@ static bool combine_strings(void *key, void *value, void *context)
 char *str_parms_to_str(struct str_parms *str_parms)
 {
     char *str = NULL;
-    hashmapForEach(str_parms->map, combine_strings, &str);
+
+    if (!str_parms->map) {
+        for (int i = 0; i < str_parms->num_entries; i++) {
+            if (!combine_strings(small_key(str_parms, i), small_value(str_parms, i), &str))
+                break;
+        }
+    } else {
+        hashmapForEach(str_parms->map, combine_strings, &str);
+    }
     return (str != NULL) ? str : strdup("");
 }
 
@@ -365,5 +546,10 @@ static bool dump_entry(void* key, void* value, void* /*context*/) {
 
 void str_parms_dump(struct str_parms *str_parms)
 {
+    if (!str_parms->map) {
+        for (int i = 0; i < str_parms->num_entries; i++)
+            dump_entry(small_key(str_parms, i), small_value(str_parms, i), NULL);
+        return;
+    }
     hashmapForEach(str_parms->map, dump_entry, str_parms);
 }
@@ -71,30 +71,60 @@ void atrace_setup()
 
 void atrace_begin_body(const char* name)
 {
+    if (CC_UNLIKELY(atrace_batch.active)) {
+        WRITE_MSG_BATCHED("B", "|", "%s", name, "");
+        return;
+    }
+
     WRITE_MSG("B|%d|", "%s", name, "");
 }
 
 void atrace_end_body()
 {
+    if (CC_UNLIKELY(atrace_batch.active)) {
+        WRITE_MSG_BATCHED("E", "", "%s", "", "");
+        return;
+    }
+
     WRITE_MSG("E|%d", "%s", "", "");
 }
 
 void atrace_async_begin_body(const char* name, int32_t cookie)
 {
+    if (CC_UNLIKELY(atrace_batch.active)) {
+        WRITE_MSG_BATCHED("S", "|", "|%" PRId32, name, cookie);
+        return;
+    }
+
     WRITE_MSG("S|%d|", "|%" PRId32, name, cookie);
 }
 
 void atrace_async_end_body(const char* name, int32_t cookie)
 {
+    if (CC_UNLIKELY(atrace_batch.active)) {
+        WRITE_MSG_BATCHED("F", "|", "|%" PRId32, name, cookie);
+        return;
+    }
+
     WRITE_MSG("F|%d|", "|%" PRId32, name, cookie);
 }
 
 void atrace_int_body(const char* name, int32_t value)
 {
+    if (CC_UNLIKELY(atrace_batch.active)) {
+        WRITE_MSG_BATCHED("C", "|", "|%" PRId32, name, value);
+        return;
+    }
+
     WRITE_MSG("C|%d|", "|%" PRId32, name, value);
 }
 
 void atrace_int64_body(const char* name, int64_t value)
 {
+    if (CC_UNLIKELY(atrace_batch.active)) {
+        WRITE_MSG_BATCHED("C", "|", "|%" PRId64, name, value);
+        return;
+    }
+
     WRITE_MSG("C|%d|", "|%" PRId64, name, value);
 }
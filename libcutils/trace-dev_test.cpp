@@ -292,3 +292,42 @@ TEST_F(TraceDevTest, atrace_int64_body_truncated) {
   expected += android::base::StringPrintf("%.*s|17179869183", expected_len, name.c_str());
   ASSERT_STREQ(expected.c_str(), actual.c_str());
 }
+
+TEST_F(TraceDevTest, atrace_batch_defers_and_flushes) {
+  atrace_batch_begin();
+  atrace_begin_body("fake_name");
+  atrace_end_body();
+
+  // Nothing reaches trace_marker until the batch flushes.
+  ASSERT_EQ(0, lseek(atrace_marker_fd, 0, SEEK_CUR));
+
+  atrace_batch_end();
+
+  std::string actual;
+  ASSERT_EQ(0, lseek(atrace_marker_fd, 0, SEEK_SET));
+  ASSERT_TRUE(android::base::ReadFdToString(atrace_marker_fd, &actual));
+
+  // Batched records carry explicit tid and record-time timestamps:
+  // B|pid|tid|ts|tts|name followed by E|pid|tid|ts|tts.
+  std::string prefix = android::base::StringPrintf("B|%d|%d|", getpid(), gettid());
+  ASSERT_EQ(0U, actual.find(prefix));
+  ASSERT_NE(std::string::npos, actual.find("|fake_name"));
+  ASSERT_NE(std::string::npos, actual.find(android::base::StringPrintf("E|%d|%d|", getpid(), gettid())));
+}
+
+TEST_F(TraceDevTest, atrace_batch_end_returns_to_direct_writes) {
+  atrace_batch_begin();
+  atrace_begin_body("batched");
+  atrace_batch_end();
+
+  off_t after_batch = lseek(atrace_marker_fd, 0, SEEK_CUR);
+  ASSERT_LT(0, after_batch);
+
+  atrace_begin_body("direct");
+
+  ASSERT_EQ(0, lseek(atrace_marker_fd, 0, SEEK_SET));
+  std::string actual;
+  ASSERT_TRUE(android::base::ReadFdToString(atrace_marker_fd, &actual));
+  std::string expected = android::base::StringPrintf("B|%d|direct", getpid());
+  ASSERT_EQ(actual.size() - expected.size(), actual.find(expected));
+}
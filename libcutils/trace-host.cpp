@@ -30,6 +30,9 @@ void atrace_async_begin_body(const char* /*name*/, int32_t /*cookie*/) {}
 void atrace_async_end_body(const char* /*name*/, int32_t /*cookie*/) {}
 void atrace_int_body(const char* /*name*/, int32_t /*value*/) {}
 void atrace_int64_body(const char* /*name*/, int64_t /*value*/) {}
+void atrace_batch_begin() { }
+void atrace_batch_flush() { }
+void atrace_batch_end() { }
 void atrace_init() {}
 uint64_t atrace_get_enabled_tags()
 {
@@ -19,12 +19,14 @@
 #include <errno.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <strings.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <unistd.h>
 
+#include <linux/filter.h>
 #include <linux/netlink.h>
 
 extern "C" {
@@ -92,6 +94,156 @@ out:
     return -1;
 }
 
+/**
+ * Drains the socket's backlog with one recvmmsg call: receives up to count
+ * messages (capped at UEVENT_RECV_BATCH_MAX), applying the same
+ * kernel-origin checks as uevent_kernel_recv to each. Message i lands at
+ * (char*)buffer_pool + i * buffer_size, and lengths[i] is set to its size.
+ * Messages failing the origin check are zeroed and get lengths[i] == 0
+ * instead of failing the whole batch.
+ *
+ * Blocks until at least one message arrives, then returns however many are
+ * pending. Returns the number of messages received (including dropped
+ * ones), or -1 with errno set on error.
+ */
+ssize_t uevent_kernel_recv_batch(int socket, void* buffer_pool, size_t buffer_size, size_t count,
+                                 ssize_t* lengths, bool require_group) {
+    struct mmsghdr msgs[UEVENT_RECV_BATCH_MAX];
+    struct iovec iovs[UEVENT_RECV_BATCH_MAX];
+    struct sockaddr_nl addrs[UEVENT_RECV_BATCH_MAX];
+    char controls[UEVENT_RECV_BATCH_MAX][CMSG_SPACE(sizeof(struct ucred))];
+
+    if (count > UEVENT_RECV_BATCH_MAX) {
+        count = UEVENT_RECV_BATCH_MAX;
+    }
+    if (count == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(msgs, 0, count * sizeof(msgs[0]));
+    for (size_t i = 0; i < count; i++) {
+        iovs[i].iov_base = (char*)buffer_pool + i * buffer_size;
+        iovs[i].iov_len = buffer_size;
+        msgs[i].msg_hdr.msg_name = &addrs[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_control = controls[i];
+        msgs[i].msg_hdr.msg_controllen = sizeof(controls[i]);
+    }
+
+    int n = TEMP_FAILURE_RETRY(recvmmsg(socket, msgs, count, MSG_WAITFORONE, NULL));
+    if (n <= 0) {
+        return n;
+    }
+
+    for (int i = 0; i < n; i++) {
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msgs[i].msg_hdr);
+        bool valid = cmsg != NULL && cmsg->cmsg_type == SCM_CREDENTIALS;
+        if (valid && addrs[i].nl_pid != 0) {
+            /* ignore non-kernel */
+            valid = false;
+        }
+        if (valid && require_group && addrs[i].nl_groups == 0) {
+            /* ignore unicast messages when requested */
+            valid = false;
+        }
+        if (valid) {
+            lengths[i] = msgs[i].msg_len;
+        } else {
+            /* clear residual potentially malicious data */
+            bzero((char*)buffer_pool + i * buffer_size, buffer_size);
+            lengths[i] = 0;
+        }
+    }
+
+    return n;
+}
+
+/**
+ * Attaches a classic BPF filter to the socket that drops, in the kernel,
+ * uevents whose "SUBSYSTEM=" attribute does not match the given subsystem,
+ * so a daemon interested in a single subsystem (e.g. healthd and
+ * "power_supply") is not woken for unrelated device churn.
+ *
+ * The filter scans the first UEVENT_FILTER_SCAN_BYTES of each message for
+ * "\0SUBSYSTEM=<subsystem>\0"; the kernel emits that attribute right after
+ * ACTION= and DEVPATH=, so it fits in the window for any sane devpath.
+ * Classic BPF has no loops, so the scan is unrolled one comparison chain
+ * per byte offset, and the whole program must fit the socket option memory
+ * budget (net.core.optmem_max, 20KB by default). To stay within it, each
+ * chain probes three words of the needle -- its start, middle, and tail
+ * (the tail word covers the closing NUL, so "power_supply_ext" does not
+ * pass a "power_supply" filter) -- rather than every byte. This is a
+ * prefilter: it never drops a matching uevent, but a pathological message
+ * could slip through, so callers keep their user-space subsystem check.
+ *
+ * Attach the filter immediately after uevent_open_socket: messages that
+ * were queued before the filter was in place are still delivered.
+ *
+ * Returns 0 on success, -1 with errno set on failure; subsystem names
+ * longer than 20 bytes are rejected with EINVAL.
+ */
+int uevent_attach_subsystem_filter(int socket, const char* subsystem) {
+    char needle[32];
+    size_t needle_len;
+    struct sock_filter* insns;
+    struct sock_fprog prog;
+    size_t count, i;
+
+    if (subsystem == NULL || subsystem[0] == '\0') {
+        errno = EINVAL;
+        return -1;
+    }
+    /* Leading NUL anchors the attribute boundary; the trailing NUL from
+     * snprintf is part of the needle and rejects prefix matches. */
+    needle_len = 1 + strlen("SUBSYSTEM=") + strlen(subsystem) + 1;
+    if (needle_len > sizeof(needle)) {
+        errno = EINVAL;
+        return -1;
+    }
+    needle[0] = '\0';
+    snprintf(needle + 1, sizeof(needle) - 1, "SUBSYSTEM=%s", subsystem);
+
+    /* needle_len is at least 13 ("\0SUBSYSTEM=x\0"), so the three probes
+     * are always in range; for short names they simply overlap. */
+    size_t probes[3] = {0, needle_len / 2 - 2, needle_len - 4};
+    count = UEVENT_FILTER_SCAN_BYTES * (2 * 3 + 1) + 1;
+
+    insns = (struct sock_filter*)calloc(count, sizeof(*insns));
+    if (insns == NULL) {
+        return -1;
+    }
+
+    i = 0;
+    for (size_t off = 0; off < UEVENT_FILTER_SCAN_BYTES; off++) {
+        /* Loads past the end of a short message make the program return 0
+         * (drop), which is correct: no earlier offset matched. */
+        for (size_t c = 0; c < 3; c++) {
+            const uint8_t* p = (const uint8_t*)needle + probes[c];
+            uint32_t val =
+                (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+            insns[i++] = (struct sock_filter)BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
+                                                      (uint32_t)(off + probes[c]));
+            /* On mismatch jump to the start of the next offset's chain,
+             * over this chain's remaining probes and its accept. */
+            insns[i++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, val, 0,
+                                                      (uint8_t)(2 * (3 - c) - 1));
+        }
+        insns[i++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, 0xffffffff);
+    }
+    insns[i++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, 0);
+
+    prog.len = (unsigned short)count;
+    prog.filter = insns;
+    int rc = setsockopt(socket, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog));
+    int saved_errno = errno;
+    free(insns);
+    errno = saved_errno;
+    return rc;
+}
+
 int uevent_open_socket(int buf_sz, bool passcred) {
     struct sockaddr_nl addr;
     int on = passcred;
@@ -16,6 +16,7 @@
 
 #pragma once
 
+#include <mutex>
 #include <set>
 #include <string>
 #include <unordered_map>
@@ -27,6 +28,7 @@ class Modprobe {
     Modprobe(const std::vector<std::string>&, const std::string load_file = "modules.load");
 
     bool LoadListedModules(bool strict = true);
+    bool LoadModulesParallel(int num_threads);
     bool LoadWithAliases(const std::string& module_name, bool strict,
                          const std::string& parameters = "");
     bool Remove(const std::string& module_name);
@@ -40,6 +42,7 @@ class Modprobe {
 
   private:
     std::string MakeCanonical(const std::string& module_path);
+    bool IsLoaded(const std::string& canonical_name);
     bool InsmodWithDeps(const std::string& module_name, const std::string& parameters);
     bool Insmod(const std::string& path_name, const std::string& parameters);
     bool Rmmod(const std::string& module_name);
@@ -65,6 +68,9 @@ class Modprobe {
     std::vector<std::string> module_load_;
     std::unordered_map<std::string, std::string> module_options_;
     std::set<std::string> module_blocklist_;
+    // Held while reading or writing module_loaded_ and module_count_, which
+    // LoadModulesParallel() touches from its worker threads.
+    std::mutex module_loaded_lock_;
     std::unordered_set<std::string> module_loaded_;
     int module_count_ = 0;
     bool blocklist_enabled = false;
@@ -21,8 +21,11 @@
 #include <sys/syscall.h>
 
 #include <algorithm>
+#include <map>
+#include <mutex>
 #include <set>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <android-base/chrono_utils.h>
@@ -227,14 +230,30 @@ void Modprobe::ParseCfg(const std::string& cfg,
         return;
     }
 
-    std::vector<std::string> lines = android::base::Split(cfg_contents, "\n");
-    for (const std::string line : lines) {
-        if (line.empty() || line[0] == '#') {
+    // Tokenize in one pass over the file contents instead of materializing a
+    // line vector and re-splitting each line; args is reused across lines so
+    // a large modules.dep costs one string per token, not per character seen.
+    std::vector<std::string> args;
+    size_t pos = 0;
+    while (pos < cfg_contents.size()) {
+        size_t eol = cfg_contents.find('\n', pos);
+        if (eol == std::string::npos) {
+            eol = cfg_contents.size();
+        }
+        if (eol == pos || cfg_contents[pos] == '#') {
+            pos = eol + 1;
             continue;
         }
-        const std::vector<std::string> args = android::base::Split(line, " ");
-        if (args.empty()) continue;
+        args.clear();
+        size_t start = pos;
+        for (size_t i = pos; i <= eol; ++i) {
+            if (i == eol || cfg_contents[i] == ' ') {
+                args.emplace_back(cfg_contents, start, i - start);
+                start = i + 1;
+            }
+        }
         f(args);
+        pos = eol + 1;
     }
     return;
 }
@@ -395,10 +414,15 @@ bool Modprobe::InsmodWithDeps(const std::string& module_name, const std::string&
     return true;
 }
 
+bool Modprobe::IsLoaded(const std::string& canonical_name) {
+    auto lock = std::lock_guard{module_loaded_lock_};
+    return module_loaded_.count(canonical_name) > 0;
+}
+
 bool Modprobe::LoadWithAliases(const std::string& module_name, bool strict,
                                const std::string& parameters) {
     auto canonical_name = MakeCanonical(module_name);
-    if (module_loaded_.count(canonical_name)) {
+    if (IsLoaded(canonical_name)) {
         return true;
     }
 
@@ -410,7 +434,7 @@ bool Modprobe::LoadWithAliases(const std::string& module_name, bool strict,
     for (const auto& [alias, aliased_module] : module_aliases_) {
         if (fnmatch(alias.c_str(), module_name.c_str(), 0) != 0) continue;
         LOG(VERBOSE) << "Found alias for '" << module_name << "': '" << aliased_module;
-        if (module_loaded_.count(MakeCanonical(aliased_module))) continue;
+        if (IsLoaded(MakeCanonical(aliased_module))) continue;
         modules_to_load.emplace(aliased_module);
     }
 
@@ -438,6 +462,73 @@ bool Modprobe::LoadListedModules(bool strict) {
     return ret;
 }
 
+// Loads the listed modules and their dependencies with up to num_threads
+// worker threads.  modules.dep lists the full dependency closure of each
+// module with the deepest dependency last, so the last unloaded dependency of
+// every pending module depends on nothing that is still unloaded.  Each round
+// loads that set of modules in parallel, then pops it from the closures,
+// walking the dependency graphs bottom up.  Failures are strict, matching
+// LoadListedModules(true).
+bool Modprobe::LoadModulesParallel(int num_threads) {
+    bool ret = true;
+    std::map<std::string, std::vector<std::string>> mod_with_deps;
+
+    for (const auto& module : module_load_) {
+        auto dependencies = GetDependencies(MakeCanonical(module));
+        if (dependencies.empty()) {
+            LOG(ERROR) << "Module " << module << " not in dependency file";
+            return false;
+        }
+        mod_with_deps[MakeCanonical(module)] = dependencies;
+    }
+
+    while (!mod_with_deps.empty()) {
+        std::vector<std::string> modules_to_load;
+        for (const auto& [module, dependencies] : mod_with_deps) {
+            auto dep_name = MakeCanonical(dependencies.back());
+            if (std::find(modules_to_load.begin(), modules_to_load.end(), dep_name) ==
+                modules_to_load.end()) {
+                modules_to_load.emplace_back(dep_name);
+            }
+        }
+
+        std::mutex work_lock;
+        bool round_ok = true;
+        auto worker = [&] {
+            auto lock = std::unique_lock{work_lock};
+            while (!modules_to_load.empty()) {
+                auto module = std::move(modules_to_load.back());
+                modules_to_load.pop_back();
+                lock.unlock();
+                bool loaded = LoadWithAliases(module, true);
+                lock.lock();
+                if (!loaded) round_ok = false;
+            }
+        };
+
+        std::vector<std::thread> threads;
+        int thread_count = std::min<int>(num_threads, modules_to_load.size());
+        for (int i = 1; i < thread_count; ++i) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        if (!round_ok) {
+            LOG(ERROR) << "LoadModulesParallel was unable to load all modules";
+            return false;
+        }
+
+        for (auto it = mod_with_deps.begin(); it != mod_with_deps.end();) {
+            it->second.pop_back();
+            it = it->second.empty() ? mod_with_deps.erase(it) : std::next(it);
+        }
+    }
+    return ret;
+}
+
 bool Modprobe::Remove(const std::string& module_name) {
     auto dependencies = GetDependencies(MakeCanonical(module_name));
     if (dependencies.empty()) {
@@ -17,6 +17,9 @@
 #include <sys/stat.h>
 #include <sys/syscall.h>
 
+#include <mutex>
+
+#include <android-base/chrono_utils.h>
 #include <android-base/file.h>
 #include <android-base/logging.h>
 #include <android-base/unique_fd.h>
@@ -50,10 +53,12 @@ bool Modprobe::Insmod(const std::string& path_name, const std::string& parameter
     }
 
     LOG(INFO) << "Loading module " << path_name << " with args '" << options << "'";
+    android::base::Timer t;
     int ret = syscall(__NR_finit_module, fd.get(), options.c_str(), 0);
     if (ret != 0) {
         if (errno == EEXIST) {
             // Module already loaded
+            auto lock = std::lock_guard{module_loaded_lock_};
             module_loaded_.emplace(canonical_name);
             return true;
         }
@@ -61,7 +66,8 @@ bool Modprobe::Insmod(const std::string& path_name, const std::string& parameter
         return false;
     }
 
-    LOG(INFO) << "Loaded kernel module " << path_name;
+    LOG(INFO) << "Loaded kernel module " << path_name << " in " << t;
+    auto lock = std::lock_guard{module_loaded_lock_};
     module_loaded_.emplace(canonical_name);
     module_count_++;
     return true;
@@ -74,6 +80,7 @@ bool Modprobe::Rmmod(const std::string& module_name) {
         PLOG(ERROR) << "Failed to remove module '" << module_name << "'";
         return false;
     }
+    auto lock = std::lock_guard{module_loaded_lock_};
     module_loaded_.erase(canonical_name);
     return true;
 }
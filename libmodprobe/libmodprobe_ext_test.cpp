@@ -17,6 +17,7 @@
 #include <sys/stat.h>
 #include <sys/syscall.h>
 
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -34,6 +35,8 @@ std::string Modprobe::GetKernelCmdline(void) {
 }
 
 bool Modprobe::Insmod(const std::string& path_name, const std::string& parameters) {
+    // modules_loaded is shared between LoadModulesParallel()'s workers.
+    auto lock = std::lock_guard{module_loaded_lock_};
     auto deps = GetDependencies(MakeCanonical(path_name));
     if (deps.empty()) {
         return false;
@@ -61,6 +64,7 @@ bool Modprobe::Insmod(const std::string& path_name, const std::string& parameter
 }
 
 bool Modprobe::Rmmod(const std::string& module_name) {
+    auto lock = std::lock_guard{module_loaded_lock_};
     for (auto it = modules_loaded.begin(); it != modules_loaded.end(); it++) {
         if (*it == module_name || android::base::StartsWith(*it, module_name + " ")) {
             modules_loaded.erase(it);
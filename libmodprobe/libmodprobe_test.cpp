@@ -180,6 +180,61 @@ TEST(libmodprobe, Test) {
     EXPECT_FALSE(m.LoadWithAliases("test4", true));
 }
 
+TEST(libmodprobe, LoadModulesParallel) {
+    kernel_cmdline = "";
+    modules_loaded.clear();
+    test_modules = {
+            "/test1.ko", "/test2.ko", "/test3.ko", "/test4.ko",
+            "/test5.ko", "/test6.ko", "/test7.ko", "/test8.ko",
+    };
+
+    const std::string modules_dep =
+            "test1.ko:\n"
+            "test2.ko:\n"
+            "test3.ko: test2.ko test1.ko\n"
+            "test4.ko: test1.ko\n"
+            "test5.ko:\n"
+            "test6.ko: test5.ko\n"
+            "test7.ko: test6.ko test5.ko\n"
+            "test8.ko:\n";
+
+    const std::string modules_load =
+            "test3.ko\n"
+            "test4.ko\n"
+            "test7.ko\n"
+            "test8.ko\n";
+
+    TemporaryDir dir;
+    auto dir_path = std::string(dir.path);
+    ASSERT_TRUE(android::base::WriteStringToFile(modules_dep, dir_path + "/modules.dep", 0600,
+                                                 getuid(), getgid()));
+    ASSERT_TRUE(android::base::WriteStringToFile(modules_load, dir_path + "/modules.load", 0600,
+                                                 getuid(), getgid()));
+
+    for (auto i = test_modules.begin(); i != test_modules.end(); ++i) {
+        *i = dir.path + *i;
+    }
+
+    Modprobe m({dir.path});
+    EXPECT_TRUE(m.LoadModulesParallel(4));
+    EXPECT_EQ(8, m.GetModuleCount());
+
+    // Ordering between independent modules is not deterministic, but every
+    // dependency must have been loaded before its dependent.
+    auto index_of = [&](const std::string& module) {
+        for (size_t i = 0; i < modules_loaded.size(); ++i) {
+            if (android::base::StartsWith(modules_loaded[i], dir_path + "/" + module)) return i;
+        }
+        return modules_loaded.size();
+    };
+    ASSERT_EQ(8u, modules_loaded.size());
+    EXPECT_LT(index_of("test1.ko"), index_of("test3.ko"));
+    EXPECT_LT(index_of("test2.ko"), index_of("test3.ko"));
+    EXPECT_LT(index_of("test1.ko"), index_of("test4.ko"));
+    EXPECT_LT(index_of("test5.ko"), index_of("test6.ko"));
+    EXPECT_LT(index_of("test6.ko"), index_of("test7.ko"));
+}
+
 TEST(libmodprobe, ModuleDepLineWithoutColonIsSkipped) {
     TemporaryDir dir;
     auto dir_path = std::string(dir.path);
@@ -22,6 +22,7 @@
 #include <netinet/ip_icmp.h>
 #include <netinet/tcp.h>
 #include <netinet/udp.h>
+#include <string.h>
 
 #include "netutils/checksum.h"
 
@@ -32,20 +33,47 @@
  *   len         - length of data
  */
 uint32_t ip_checksum_add(uint32_t current, const void* data, int len) {
-    uint32_t checksum = current;
+    uint64_t checksum = current;
     int left = len;
-    const uint16_t* data_16 = data;
-
-    while (left > 1) {
-        checksum += *data_16;
-        data_16++;
+    const uint8_t* ptr = data;
+
+    /* Sum 32 bits at a time into a 64-bit accumulator; since 2^16 is
+     * congruent to 1 modulo 0xffff, the result folds to the same 16-bit
+     * ones' complement sum as the word-at-a-time loop this replaces.
+     * memcpy keeps the loads alignment-safe and compiles to plain word
+     * loads that the compiler can vectorize. */
+    while (left >= 8) {
+        uint32_t w0, w1;
+        memcpy(&w0, ptr, sizeof(w0));
+        memcpy(&w1, ptr + 4, sizeof(w1));
+        checksum += (uint64_t)w0 + w1;
+        ptr += 8;
+        left -= 8;
+    }
+    if (left >= 4) {
+        uint32_t w;
+        memcpy(&w, ptr, sizeof(w));
+        checksum += w;
+        ptr += 4;
+        left -= 4;
+    }
+    if (left >= 2) {
+        uint16_t w;
+        memcpy(&w, ptr, sizeof(w));
+        checksum += w;
+        ptr += 2;
         left -= 2;
     }
     if (left) {
-        checksum += *(uint8_t*)data_16;
+        checksum += *ptr;
     }
 
-    return checksum;
+    /* Fold the carries back in so the returned partial sum stays congruent
+     * to the original 16-bit sum and safe to pass back into this function. */
+    checksum = (checksum >> 32) + (checksum & 0xffffffff);
+    checksum += checksum >> 32;
+
+    return (uint32_t)checksum;
 }
 
 /* function: ip_checksum_fold
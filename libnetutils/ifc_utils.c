@@ -28,6 +28,7 @@
 #include <netdb.h>
 #include <netinet/in.h>
 #include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -54,8 +55,14 @@
 
 static int ifc_ctl_sock = -1;
 static int ifc_ctl_sock6 = -1;
+static int ifc_ctl_sock_refs = 0;
+static int ifc_ctl_sock6_refs = 0;
 static pthread_mutex_t ifc_sock_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
 static pthread_mutex_t ifc_sock6_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+static int ifc_nl_sock = -1;
+static uint32_t ifc_nl_seq = 0;
+static pthread_mutex_t ifc_nl_sock_mutex = PTHREAD_MUTEX_INITIALIZER;
 void printerr(char *fmt, ...);
 
 #define DBG 0
@@ -133,6 +140,11 @@ int ifc_init(void)
             printerr("socket() failed: %s\n", strerror(errno));
         }
     }
+    if (ifc_ctl_sock >= 0) {
+        /* init/close pairs nest (the mutex is recursive); the socket is
+         * closed when the outermost pair ends */
+        ifc_ctl_sock_refs++;
+    }
 
     ret = ifc_ctl_sock < 0 ? -1 : 0;
     if (DBG) printerr("ifc_init_returning %d", ret);
@@ -148,13 +160,16 @@ int ifc_init6(void)
             printerr("socket() failed: %s\n", strerror(errno));
         }
     }
+    if (ifc_ctl_sock6 >= 0) {
+        ifc_ctl_sock6_refs++;
+    }
     return ifc_ctl_sock6 < 0 ? -1 : 0;
 }
 
 void ifc_close(void)
 {
     if (DBG) printerr("ifc_close");
-    if (ifc_ctl_sock != -1) {
+    if (ifc_ctl_sock != -1 && --ifc_ctl_sock_refs == 0) {
         (void)close(ifc_ctl_sock);
         ifc_ctl_sock = -1;
     }
@@ -163,7 +178,7 @@ void ifc_close(void)
 
 void ifc_close6(void)
 {
-    if (ifc_ctl_sock6 != -1) {
+    if (ifc_ctl_sock6 != -1 && --ifc_ctl_sock6_refs == 0) {
         (void)close(ifc_ctl_sock6);
         ifc_ctl_sock6 = -1;
     }
@@ -259,9 +274,8 @@ int ifc_set_addr(const char *name, in_addr_t addr)
  */
 int ifc_act_on_address(int action, const char* name, const char* address, int prefixlen,
                        bool nodad) {
-    int ifindex, s, len, ret;
+    int ifindex, len, ret;
     struct sockaddr_storage ss;
-    int saved_errno;
     void *addr;
     size_t addrlen;
     struct {
@@ -332,34 +346,53 @@ int ifc_act_on_address(int action, const char* name, const char* address, int pr
         memcpy(RTA_DATA(rta), addr, addrlen);
     }
 
-    s = socket(PF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
-    if (s < 0) {
-        return -errno;
+    // The netlink socket is kept open across calls; each transaction is one
+    // send and one matching ack under the mutex.
+    pthread_mutex_lock(&ifc_nl_sock_mutex);
+
+    if (ifc_nl_sock == -1) {
+        ifc_nl_sock = socket(PF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+        if (ifc_nl_sock < 0) {
+            ret = -errno;
+            pthread_mutex_unlock(&ifc_nl_sock_mutex);
+            return ret;
+        }
     }
 
-    if (send(s, &req, req.n.nlmsg_len, 0) < 0) {
-        saved_errno = errno;
-        close(s);
-        return -saved_errno;
+    req.n.nlmsg_seq = ++ifc_nl_seq;
+
+    if (send(ifc_nl_sock, &req, req.n.nlmsg_len, 0) < 0) {
+        ret = -errno;
+        goto err_close;
     }
 
     char buf[NLMSG_ALIGN(sizeof(struct nlmsgerr)) + sizeof(req)];
-    len = recv(s, buf, sizeof(buf), 0);
-    saved_errno = errno;
-    close(s);
+    len = recv(ifc_nl_sock, buf, sizeof(buf), 0);
     if (len < 0) {
-        return -saved_errno;
+        ret = -errno;
+        goto err_close;
     }
 
     // Parse the acknowledgement to find the return code.
     nh = (struct nlmsghdr *) buf;
-    if (!NLMSG_OK(nh, (unsigned) len) || nh->nlmsg_type != NLMSG_ERROR) {
-        return -EINVAL;
+    if (!NLMSG_OK(nh, (unsigned) len) || nh->nlmsg_type != NLMSG_ERROR ||
+        nh->nlmsg_seq != req.n.nlmsg_seq) {
+        // Out of sync with the kernel; don't reuse this socket.
+        ret = -EINVAL;
+        goto err_close;
     }
     err = NLMSG_DATA(nh);
 
     // Return code is negative errno.
-    return err->error;
+    ret = err->error;
+    pthread_mutex_unlock(&ifc_nl_sock_mutex);
+    return ret;
+
+err_close:
+    close(ifc_nl_sock);
+    ifc_nl_sock = -1;
+    pthread_mutex_unlock(&ifc_nl_sock_mutex);
+    return ret;
 }
 
 // Returns zero on success and negative errno on failure.
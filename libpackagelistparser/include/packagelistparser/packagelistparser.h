@@ -78,4 +78,35 @@ bool packagelist_parse_file(const char* path, bool (*callback)(pkg_info* info, v
 /** Frees the given `pkg_info`. */
 void packagelist_free(pkg_info* info);
 
+typedef struct pkg_list {
+  /** Number of packages. */
+  size_t cnt;
+
+  /** Array of packages, sorted by uid. */
+  pkg_info* infos;
+} pkg_list;
+
+/**
+ * Parses the system's default package list into a single allocation.
+ * Entry strings point into that allocation; do not call packagelist_free()
+ * on individual entries. Release everything with packagelist_free_list().
+ */
+bool packagelist_read(pkg_list** list);
+
+/**
+ * Parses the given package list into a single allocation.
+ * Entry strings point into that allocation; do not call packagelist_free()
+ * on individual entries. Release everything with packagelist_free_list().
+ */
+bool packagelist_read_file(const char* path, pkg_list** list);
+
+/**
+ * Returns the first entry with the given uid, or null if there is none.
+ * Entries sharing a uid (via sharedUserId) are adjacent after the result.
+ */
+const pkg_info* packagelist_find_by_uid(const pkg_list* list, uid_t uid);
+
+/** Frees the given `pkg_list` and every entry in it. */
+void packagelist_free_list(pkg_list* list);
+
 __END_DECLS
@@ -19,10 +19,14 @@
 #include <packagelistparser/packagelistparser.h>
 
 #include <errno.h>
+#include <fcntl.h>
 #include <inttypes.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/limits.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <memory>
 
@@ -138,3 +142,189 @@ void packagelist_free(pkg_info* info) {
   delete[] info->gids.gids;
   free(info);
 }
+
+// A pkg_list plus the storage every entry points into: the file contents
+// (strings are NUL-terminated in place) and one shared gid pool.
+struct pkg_list_impl {
+  pkg_list pub;
+  char* buf;
+  gid_t* gid_pool;
+};
+
+static char* next_token(char** rest) {
+  char* token;
+  while ((token = strsep(rest, " \t")) != nullptr && *token == '\0') {
+  }
+  return token;
+}
+
+static bool parse_line_in_place(const char* path, size_t line_number, char* line, pkg_info* info,
+                                gid_t** gid_pool) {
+  char* name = next_token(&line);
+  char* uid_str = next_token(&line);
+  char* debuggable_str = next_token(&line);
+  char* data_dir = next_token(&line);
+  char* seinfo = next_token(&line);
+  char* gids_str = next_token(&line);
+  char* profileable_str = next_token(&line);
+  char* version_code_str = next_token(&line);
+
+  // The final fields are optional (and not usually present).
+  if (!gids_str) {
+    ALOGE("%s:%zu: too few fields in line", path, line_number);
+    return false;
+  }
+
+  char* end;
+  unsigned long uid = strtoul(uid_str, &end, 10);
+  if (end == uid_str || *end != '\0') {
+    ALOGE("%s:%zu: invalid uid", path, line_number);
+    return false;
+  }
+  if (uid > UID_MAX) {
+    ALOGE("%s:%zu: uid %lu > UID_MAX", path, line_number, uid);
+    return false;
+  }
+
+  info->name = name;
+  info->uid = uid;
+  info->debuggable = strtol(debuggable_str, nullptr, 10);
+  info->data_dir = data_dir;
+  info->seinfo = seinfo;
+  if (profileable_str) info->profileable_from_shell = strtol(profileable_str, nullptr, 10);
+  if (version_code_str) info->version_code = strtol(version_code_str, nullptr, 10);
+
+  // The gids are carved out of the shared pool rather than allocated per entry.
+  if (strcmp(gids_str, "none") != 0) {
+    info->gids.gids = *gid_pool;
+    while (true) {
+      unsigned long gid = strtoul(gids_str, &end, 10);
+      if (gid > GID_MAX) {
+        ALOGE("%s:%zu: gid %lu > GID_MAX", path, line_number, gid);
+        return false;
+      }
+      info->gids.gids[info->gids.cnt++] = gid;
+
+      if (*end == '\0') break;
+      if (*end != ',') return false;
+      gids_str = end + 1;
+    }
+    *gid_pool += info->gids.cnt;
+  }
+
+  return true;
+}
+
+static int compare_uid(const void* a, const void* b) {
+  uid_t lhs = static_cast<const pkg_info*>(a)->uid;
+  uid_t rhs = static_cast<const pkg_info*>(b)->uid;
+  return (lhs > rhs) - (lhs < rhs);
+}
+
+bool packagelist_read_file(const char* path, pkg_list** list) {
+  *list = nullptr;
+
+  int fd = TEMP_FAILURE_RETRY(open(path, O_RDONLY | O_CLOEXEC));
+  if (fd == -1) {
+    ALOGE("couldn't open '%s': %s", path, strerror(errno));
+    return false;
+  }
+
+  struct stat sb;
+  if (fstat(fd, &sb) == -1) {
+    ALOGE("couldn't stat '%s': %s", path, strerror(errno));
+    close(fd);
+    return false;
+  }
+
+  auto impl_free = [](pkg_list_impl* impl) { packagelist_free_list(&impl->pub); };
+  std::unique_ptr<pkg_list_impl, decltype(impl_free)> impl(
+      static_cast<pkg_list_impl*>(calloc(1, sizeof(pkg_list_impl))), impl_free);
+  if (!impl) {
+    close(fd);
+    return false;
+  }
+
+  impl->buf = static_cast<char*>(malloc(sb.st_size + 1));
+  if (!impl->buf) {
+    close(fd);
+    return false;
+  }
+
+  size_t size = 0;
+  while (size < static_cast<size_t>(sb.st_size)) {
+    ssize_t n = TEMP_FAILURE_RETRY(read(fd, impl->buf + size, sb.st_size - size));
+    if (n == -1) {
+      ALOGE("couldn't read '%s': %s", path, strerror(errno));
+      close(fd);
+      return false;
+    }
+    if (n == 0) break;
+    size += n;
+  }
+  close(fd);
+  impl->buf[size] = '\0';
+
+  // Size the entry array and gid pool from one counting pass.
+  size_t lines = 0;
+  size_t commas = 0;
+  for (size_t i = 0; i < size; ++i) {
+    if (impl->buf[i] == '\n') ++lines;
+    if (impl->buf[i] == ',') ++commas;
+  }
+  if (size > 0 && impl->buf[size - 1] != '\n') ++lines;
+
+  impl->pub.infos = static_cast<pkg_info*>(calloc(lines ? lines : 1, sizeof(pkg_info)));
+  impl->gid_pool = static_cast<gid_t*>(calloc(commas + lines + 1, sizeof(gid_t)));
+  if (!impl->pub.infos || !impl->gid_pool) return false;
+
+  size_t line_number = 0;
+  gid_t* gid_pool = impl->gid_pool;
+  char* pos = impl->buf;
+  while (pos < impl->buf + size) {
+    ++line_number;
+    char* eol = static_cast<char*>(memchr(pos, '\n', impl->buf + size - pos));
+    if (eol) *eol = '\0';
+
+    if (!parse_line_in_place(path, line_number, pos, &impl->pub.infos[impl->pub.cnt], &gid_pool)) {
+      return false;
+    }
+    ++impl->pub.cnt;
+
+    pos = eol ? eol + 1 : impl->buf + size;
+  }
+
+  qsort(impl->pub.infos, impl->pub.cnt, sizeof(pkg_info), compare_uid);
+
+  *list = &impl.release()->pub;
+  return true;
+}
+
+bool packagelist_read(pkg_list** list) {
+  return packagelist_read_file("/data/system/packages.list", list);
+}
+
+const pkg_info* packagelist_find_by_uid(const pkg_list* list, uid_t uid) {
+  size_t lo = 0;
+  size_t hi = list->cnt;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (list->infos[mid].uid < uid) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (lo == list->cnt || list->infos[lo].uid != uid) return nullptr;
+  return &list->infos[lo];
+}
+
+void packagelist_free_list(pkg_list* list) {
+  if (!list) return;
+
+  pkg_list_impl* impl = reinterpret_cast<pkg_list_impl*>(list);
+  free(impl->buf);
+  free(impl->gid_pool);
+  free(impl->pub.infos);
+  free(impl);
+}
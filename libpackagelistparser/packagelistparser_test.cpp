@@ -132,3 +132,53 @@ TEST(packagelistparser, system_package_list) {
 TEST(packagelistparser, packagelist_free_nullptr) {
   packagelist_free(nullptr);
 }
+
+TEST(packagelistparser, read_file) {
+  TemporaryFile tf;
+  android::base::WriteStringToFile(
+      // Deliberately out of uid order to check sorting.
+      "com.test.a0 10014 0 /data/user/0/com.test.a0 platform:privapp:targetSdkVersion=19 none\n"
+      "com.test.a1 10007 1 /data/user/0/com.test.a1 platform:privapp:targetSdkVersion=21 1023\n"
+      "com.test.a2 10011 0 /data/user/0/com.test.a2 media:privapp:targetSdkVersion=30 "
+      "2001,1065,1023,3003,3007,1024\n"
+      "com.test.a3 10022 0 /data/user/0/com.test.a3 selabel:blah none 1 123\n",
+      tf.path);
+
+  pkg_list* list;
+  ASSERT_TRUE(packagelist_read_file(tf.path, &list));
+  ASSERT_EQ(4U, list->cnt);
+
+  // Sorted by uid, so com.test.a1 (10007) comes first.
+  ASSERT_STREQ("com.test.a1", list->infos[0].name);
+  ASSERT_STREQ("com.test.a2", list->infos[1].name);
+  ASSERT_STREQ("com.test.a0", list->infos[2].name);
+  ASSERT_STREQ("com.test.a3", list->infos[3].name);
+
+  ASSERT_EQ(10007, list->infos[0].uid);
+  ASSERT_TRUE(list->infos[0].debuggable);
+  ASSERT_STREQ("/data/user/0/com.test.a1", list->infos[0].data_dir);
+  ASSERT_STREQ("platform:privapp:targetSdkVersion=21", list->infos[0].seinfo);
+  ASSERT_EQ(1U, list->infos[0].gids.cnt);
+  ASSERT_EQ(1023U, list->infos[0].gids.gids[0]);
+  ASSERT_FALSE(list->infos[0].profileable_from_shell);
+  ASSERT_EQ(0, list->infos[0].version_code);
+
+  ASSERT_EQ(6U, list->infos[1].gids.cnt);
+  ASSERT_EQ(2001U, list->infos[1].gids.gids[0]);
+  ASSERT_EQ(1024U, list->infos[1].gids.gids[5]);
+
+  ASSERT_EQ(0U, list->infos[3].gids.cnt);
+  ASSERT_TRUE(list->infos[3].profileable_from_shell);
+  ASSERT_EQ(123, list->infos[3].version_code);
+
+  const pkg_info* found = packagelist_find_by_uid(list, 10011);
+  ASSERT_TRUE(found != nullptr);
+  ASSERT_STREQ("com.test.a2", found->name);
+  ASSERT_TRUE(packagelist_find_by_uid(list, 10012) == nullptr);
+
+  packagelist_free_list(list);
+}
+
+TEST(packagelistparser, packagelist_free_list_nullptr) {
+  packagelist_free_list(nullptr);
+}
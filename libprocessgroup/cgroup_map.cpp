@@ -154,6 +154,15 @@ CgroupMap& CgroupMap::GetInstance() {
 bool CgroupMap::LoadRcFile() {
     if (!loaded_) {
         loaded_ = (ACgroupFile_getVersion() != 0);
+        if (loaded_) {
+            // Index the controllers by name once; the descriptor array in the
+            // mapped RC file is immutable for the lifetime of the process.
+            auto controller_count = ACgroupFile_getControllerCount();
+            for (uint32_t i = 0; i < controller_count; ++i) {
+                const ACgroupController* controller = ACgroupFile_getController(i);
+                controller_index_.emplace(ACgroupController_getName(controller), controller);
+            }
+        }
     }
     return loaded_;
 }
@@ -192,13 +201,10 @@ CgroupController CgroupMap::FindController(const std::string& name) const {
         return CgroupController(nullptr);
     }
 
-    auto controller_count = ACgroupFile_getControllerCount();
-    for (uint32_t i = 0; i < controller_count; ++i) {
-        const ACgroupController* controller = ACgroupFile_getController(i);
-        if (name == ACgroupController_getName(controller)) {
-            return CgroupController(controller);
-        }
+    auto it = controller_index_.find(name);
+    if (it == controller_index_.end()) {
+        return CgroupController(nullptr);
     }
 
-    return CgroupController(nullptr);
+    return CgroupController(it->second);
 }
@@ -23,6 +23,7 @@
 #include <memory>
 #include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include <android/cgrouprc.h>
@@ -62,9 +63,12 @@ class CgroupMap {
 
     static CgroupMap& GetInstance();
     CgroupController FindController(const std::string& name) const;
+    bool IsLoaded() const { return loaded_; }
 
   private:
     bool loaded_ = false;
+    // controller name -> descriptor, built once when the RC file is loaded
+    std::unordered_map<std::string, const ACgroupController*> controller_index_;
     CgroupMap();
     bool LoadRcFile();
     void Print() const;
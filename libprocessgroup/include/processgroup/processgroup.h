@@ -30,6 +30,9 @@ bool CgroupGetAttributePath(const std::string& attr_name, std::string* path);
 bool CgroupGetAttributePathForTask(const std::string& attr_name, int tid, std::string* path);
 
 bool SetTaskProfiles(int tid, const std::vector<std::string>& profiles, bool use_fd_cache = false);
+// Applies the same profiles to every tid, resolving the profile names only once.
+bool SetTaskProfilesBatch(const std::vector<int>& tids, const std::vector<std::string>& profiles,
+                          bool use_fd_cache = false);
 bool SetProcessProfiles(uid_t uid, pid_t pid, const std::vector<std::string>& profiles);
 
 #ifndef __ANDROID_VNDK__
@@ -38,6 +41,11 @@ static constexpr const char* CGROUPS_RC_PATH = "/dev/cgroup_info/cgroup.rc";
 
 bool UsePerAppMemcg();
 
+// Force loading of the cgroup description so processes forked afterwards (e.g. Zygote children)
+// inherit a warm, fully indexed handle instead of redoing the lazy discovery on first use.
+// Returns false when cgroup.rc is unavailable.
+bool CgroupPreload();
+
 // Drop the fd cache of cgroup path. It is used for when resource caching is enabled and a process
 // loses the access to the path, the access checking (See SetCgroupAction::EnableResourceCaching)
 // should be active again. E.g. Zygote specialization for child process.
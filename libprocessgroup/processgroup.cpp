@@ -22,10 +22,12 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h>
+#include <poll.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -36,12 +38,14 @@
 #include <set>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include <android-base/file.h>
 #include <android-base/logging.h>
 #include <android-base/properties.h>
 #include <android-base/stringprintf.h>
 #include <android-base/strings.h>
+#include <android-base/unique_fd.h>
 #include <cutils/android_filesystem_config.h>
 #include <processgroup/processgroup.h>
 #include <task_profiles.h>
@@ -49,6 +53,7 @@
 using android::base::GetBoolProperty;
 using android::base::StartsWith;
 using android::base::StringPrintf;
+using android::base::unique_fd;
 using android::base::WriteStringToFile;
 
 using namespace std::chrono_literals;
@@ -111,6 +116,10 @@ static bool isMemoryCgroupSupported() {
     return memcg_supported;
 }
 
+bool CgroupPreload() {
+    return CgroupMap::GetInstance().IsLoaded();
+}
+
 void DropTaskProfilesResourceCaching() {
     TaskProfiles::GetInstance().DropResourceCaching();
 }
@@ -123,6 +132,11 @@ bool SetTaskProfiles(int tid, const std::vector<std::string>& profiles, bool use
     return TaskProfiles::GetInstance().SetTaskProfiles(tid, profiles, use_fd_cache);
 }
 
+bool SetTaskProfilesBatch(const std::vector<int>& tids, const std::vector<std::string>& profiles,
+                          bool use_fd_cache) {
+    return TaskProfiles::GetInstance().SetTaskProfilesBatch(tids, profiles, use_fd_cache);
+}
+
 static std::string ConvertUidToPath(const char* cgroup, uid_t uid) {
     return StringPrintf("%s/uid_%d", cgroup, uid);
 }
@@ -227,10 +241,65 @@ static bool MkdirAndChown(const std::string& path, mode_t mode, uid_t uid, gid_t
     return true;
 }
 
+#ifndef __NR_pidfd_open
+#define __NR_pidfd_open 434
+#endif
+
+static int pidfd_open(pid_t pid, unsigned int flags) {
+    return syscall(__NR_pidfd_open, pid, flags);
+}
+
+// Opens a pidfd for every process in pids that is still alive.
+// Returns false if the kernel does not support pidfd_open.
+static bool CollectPidfds(const std::set<pid_t>& pids, std::vector<unique_fd>* pidfds) {
+    for (const auto pid : pids) {
+        unique_fd pidfd(TEMP_FAILURE_RETRY(pidfd_open(pid, 0)));
+        if (pidfd >= 0) {
+            pidfds->push_back(std::move(pidfd));
+        } else if (errno == ENOSYS) {
+            pidfds->clear();
+            return false;
+        }
+        // Other errors mean the process is already gone; nothing to wait for.
+    }
+    return true;
+}
+
+// Blocks until every process behind pidfds has exited or the deadline passes.
+// Returns true if all of them have exited.
+static bool WaitForProcessesExit(std::vector<unique_fd>* pidfds,
+                                 std::chrono::steady_clock::time_point deadline) {
+    while (!pidfds->empty()) {
+        auto timeout = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now());
+        if (timeout.count() <= 0) {
+            return false;
+        }
+
+        std::vector<pollfd> fds(pidfds->size());
+        for (size_t i = 0; i < pidfds->size(); i++) {
+            fds[i] = {.fd = (*pidfds)[i], .events = POLLIN};
+        }
+
+        int ready = TEMP_FAILURE_RETRY(poll(fds.data(), fds.size(), timeout.count()));
+        if (ready <= 0) {
+            return false;
+        }
+
+        for (size_t i = fds.size(); i-- > 0;) {
+            if (fds[i].revents) {
+                pidfds->erase(pidfds->begin() + i);
+            }
+        }
+    }
+    return true;
+}
+
 // Returns number of processes killed on success
 // Returns 0 if there are no processes in the process cgroup left to kill
 // Returns -1 on error
-static int DoKillProcessGroupOnce(const char* cgroup, uid_t uid, int initialPid, int signal) {
+static int DoKillProcessGroupOnce(const char* cgroup, uid_t uid, int initialPid, int signal,
+                                  std::vector<unique_fd>* pidfds = nullptr) {
     auto path = ConvertUidPidToPath(cgroup, uid, initialPid) + PROCESSGROUP_CGROUP_PROCS_FILE;
     std::unique_ptr<FILE, decltype(&fclose)> fd(fopen(path.c_str(), "re"), fclose);
     if (!fd) {
@@ -277,6 +346,13 @@ static int DoKillProcessGroupOnce(const char* cgroup, uid_t uid, int initialPid,
         }
     }
 
+    // Open pidfds before signalling so the caller can block on the actual
+    // exits instead of polling cgroup.procs. On kernels without pidfd_open
+    // the vector stays empty and the caller falls back to polling.
+    if (pidfds != nullptr && CollectPidfds(pgids, pidfds)) {
+        CollectPidfds(pids, pidfds);
+    }
+
     // Kill all process groups.
     for (const auto pgid : pgids) {
         LOG(VERBOSE) << "Killing process group " << -pgid << " in uid " << uid
@@ -320,16 +396,33 @@ static int KillProcessGroup(uid_t uid, int initialPid, int signal, int retries,
         *max_processes = 0;
     }
 
+    std::chrono::steady_clock::time_point deadline = start + retries * 5ms;
+
     int retry = retries;
     int processes;
-    while ((processes = DoKillProcessGroupOnce(cgroup, uid, initialPid, signal)) > 0) {
+    std::vector<unique_fd> pidfds;
+    while ((processes = DoKillProcessGroupOnce(cgroup, uid, initialPid, signal,
+                                               retry > 0 ? &pidfds : nullptr)) > 0) {
         if (max_processes != nullptr && processes > *max_processes) {
             *max_processes = processes;
         }
         LOG(VERBOSE) << "Killed " << processes << " processes for processgroup " << initialPid;
         if (retry > 0) {
-            std::this_thread::sleep_for(5ms);
-            --retry;
+            if (!pidfds.empty()) {
+                // Block until the signalled processes have actually exited,
+                // then take another pass to catch anything forked after the
+                // cgroup.procs snapshot was taken.
+                if (!WaitForProcessesExit(&pidfds, deadline)) {
+                    // Deadline reached with processes still alive; do one
+                    // final unwaited pass to count what remains.
+                    retry = 0;
+                }
+                pidfds.clear();
+            } else {
+                // pidfd_open is unavailable; poll cgroup.procs as before.
+                std::this_thread::sleep_for(5ms);
+                --retry;
+            }
         } else {
             break;
         }
@@ -59,13 +59,15 @@ bool ProfileAttribute::GetPathForTask(int tid, std::string* path) const {
         return true;
     }
 
+    *path = GetPathForSubgroup(subgroup);
+    return true;
+}
+
+std::string ProfileAttribute::GetPathForSubgroup(const std::string& subgroup) const {
     if (subgroup.empty()) {
-        *path = StringPrintf("%s/%s", controller()->path(), file_name_.c_str());
-    } else {
-        *path = StringPrintf("%s/%s/%s", controller()->path(), subgroup.c_str(),
-                             file_name_.c_str());
+        return StringPrintf("%s/%s", controller()->path(), file_name_.c_str());
     }
-    return true;
+    return StringPrintf("%s/%s/%s", controller()->path(), subgroup.c_str(), file_name_.c_str());
 }
 
 bool SetClampsAction::ExecuteForProcess(uid_t, pid_t) const {
@@ -122,13 +124,41 @@ bool SetAttributeAction::ExecuteForProcess(uid_t, pid_t pid) const {
 }
 
 bool SetAttributeAction::ExecuteForTask(int tid) const {
-    std::string path;
+    std::string subgroup;
 
-    if (!attribute_->GetPathForTask(tid, &path)) {
+    if (!attribute_->controller()->GetTaskGroup(tid, &subgroup)) {
         LOG(ERROR) << "Failed to find cgroup for tid " << tid;
         return false;
     }
 
+    {
+        std::lock_guard<std::mutex> lock(fd_mutex_);
+        if (cache_enabled_) {
+            auto it = fd_cache_.find(subgroup);
+            if (it == fd_cache_.end()) {
+                std::string path = attribute_->GetPathForSubgroup(subgroup);
+                unique_fd fd(TEMP_FAILURE_RETRY(open(path.c_str(), O_WRONLY | O_CLOEXEC)));
+                if (fd < 0) {
+                    PLOG(WARNING) << "Failed to cache fd '" << path << "'";
+                }
+                // Negative results are cached too, so an inaccessible
+                // attribute is not reopened on every profile application.
+                it = fd_cache_.emplace(subgroup, std::move(fd)).first;
+            }
+            if (it->second >= 0) {
+                if (TEMP_FAILURE_RETRY(write(it->second, value_.c_str(), value_.length())) < 0) {
+                    PLOG(ERROR) << "Failed to write '" << value_ << "' to attribute "
+                                << attribute_->file_name();
+                    // The group might have been removed; reopen on the next call.
+                    fd_cache_.erase(it);
+                    return false;
+                }
+                return true;
+            }
+        }
+    }
+
+    std::string path = attribute_->GetPathForSubgroup(subgroup);
     if (!WriteStringToFile(value_, path)) {
         PLOG(ERROR) << "Failed to write '" << value_ << "' to " << path;
         return false;
@@ -137,6 +167,17 @@ bool SetAttributeAction::ExecuteForTask(int tid) const {
     return true;
 }
 
+void SetAttributeAction::EnableResourceCaching() {
+    std::lock_guard<std::mutex> lock(fd_mutex_);
+    cache_enabled_ = true;
+}
+
+void SetAttributeAction::DropResourceCaching() {
+    std::lock_guard<std::mutex> lock(fd_mutex_);
+    fd_cache_.clear();
+    cache_enabled_ = false;
+}
+
 bool SetCgroupAction::IsAppDependentPath(const std::string& path) {
     return path.find("<uid>", 0) != std::string::npos || path.find("<pid>", 0) != std::string::npos;
 }
@@ -558,3 +599,31 @@ bool TaskProfiles::SetTaskProfiles(int tid, const std::vector<std::string>& prof
     }
     return true;
 }
+
+bool TaskProfiles::SetTaskProfilesBatch(const std::vector<int>& tids,
+                                        const std::vector<std::string>& profiles,
+                                        bool use_fd_cache) {
+    // Resolve the profile names once so the per-tid loop is just the writes.
+    std::vector<std::pair<TaskProfile*, const std::string*>> resolved;
+    resolved.reserve(profiles.size());
+    for (const auto& name : profiles) {
+        TaskProfile* profile = GetProfile(name);
+        if (profile == nullptr) {
+            PLOG(WARNING) << "Failed to find " << name << "task profile";
+            continue;
+        }
+        if (use_fd_cache) {
+            profile->EnableResourceCaching();
+        }
+        resolved.emplace_back(profile, &name);
+    }
+
+    for (const auto tid : tids) {
+        for (const auto& [profile, name] : resolved) {
+            if (!profile->ExecuteForTask(tid)) {
+                PLOG(WARNING) << "Failed to apply " << *name << " task profile to tid " << tid;
+            }
+        }
+    }
+    return true;
+}
@@ -36,6 +36,7 @@ class ProfileAttribute {
     void Reset(const CgroupController& controller, const std::string& file_name);
 
     bool GetPathForTask(int tid, std::string* path) const;
+    std::string GetPathForSubgroup(const std::string& subgroup) const;
 
   private:
     CgroupController controller_;
@@ -98,14 +99,20 @@ class SetTimerSlackAction : public ProfileAction {
 class SetAttributeAction : public ProfileAction {
   public:
     SetAttributeAction(const ProfileAttribute* attribute, const std::string& value)
-        : attribute_(attribute), value_(value) {}
+        : attribute_(attribute), value_(value), cache_enabled_(false) {}
 
     virtual bool ExecuteForProcess(uid_t uid, pid_t pid) const;
     virtual bool ExecuteForTask(int tid) const;
+    virtual void EnableResourceCaching();
+    virtual void DropResourceCaching();
 
   private:
     const ProfileAttribute* attribute_;
     std::string value_;
+    bool cache_enabled_;
+    // attribute fds keyed by the task's subgroup, kept while caching is enabled
+    mutable std::map<std::string, android::base::unique_fd> fd_cache_;
+    mutable std::mutex fd_mutex_;
 };
 
 // Set cgroup profile element
@@ -181,6 +188,8 @@ class TaskProfiles {
     void DropResourceCaching() const;
     bool SetProcessProfiles(uid_t uid, pid_t pid, const std::vector<std::string>& profiles);
     bool SetTaskProfiles(int tid, const std::vector<std::string>& profiles, bool use_fd_cache);
+    bool SetTaskProfilesBatch(const std::vector<int>& tids, const std::vector<std::string>& profiles,
+                              bool use_fd_cache);
 
   private:
     std::map<std::string, std::shared_ptr<TaskProfile>> profiles_;
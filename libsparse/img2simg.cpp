@@ -17,6 +17,7 @@
 #define _FILE_OFFSET_BITS 64
 #define _LARGEFILE64_SOURCE 1
 
+#include <errno.h>
 #include <fcntl.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -27,6 +28,7 @@
 #include <unistd.h>
 
 #include <sparse/sparse.h>
+#include "output_file.h"
 
 #ifndef O_BINARY
 #define O_BINARY 0
@@ -41,6 +43,108 @@ void usage() {
   fprintf(stderr, "Usage: img2simg <raw_image_file> <sparse_image_file> [<block_size>]\n");
 }
 
+/* One-pass conversion: blocks are classified as they are read and streamed
+ * straight out through a sparse_writer, so memory stays bounded by the read
+ * buffer instead of a backed_block list covering the whole image. */
+static int convert_streaming(int in, int out, unsigned int block_size, off64_t len) {
+  struct sparse_writer* w;
+  char* buf;
+  size_t buf_size;
+  off64_t remain = len;
+  int ret = 0;
+
+  w = sparse_writer_open(out, block_size, len);
+  if (!w) {
+    return -ENOMEM;
+  }
+
+  buf_size = (16 * 1024 * 1024 / block_size) * block_size;
+  if (buf_size == 0) {
+    buf_size = block_size;
+  }
+  buf = reinterpret_cast<char*>(malloc(buf_size));
+  if (!buf) {
+    sparse_writer_close(w);
+    return -ENOMEM;
+  }
+
+  while (remain > 0 && ret == 0) {
+    size_t to_read = remain > (off64_t)buf_size ? buf_size : remain;
+    size_t off = 0;
+
+    ret = read_all(in, buf, to_read);
+    if (ret < 0) {
+      break;
+    }
+
+    while (off < to_read && ret == 0) {
+      size_t run_len = block_size;
+      uint32_t* block = reinterpret_cast<uint32_t*>(buf + off);
+      bool fill = false;
+
+      if (to_read - off >= block_size) {
+        fill = true;
+        for (size_t i = 1; i < block_size / sizeof(uint32_t); i++) {
+          if (block[0] != block[i]) {
+            fill = false;
+            break;
+          }
+        }
+      } else {
+        /* Final partial block. */
+        run_len = to_read - off;
+      }
+
+      if (fill) {
+        /* Merge adjacent blocks with the same fill value. */
+        while (off + run_len + block_size <= to_read) {
+          uint32_t* next = reinterpret_cast<uint32_t*>(buf + off + run_len);
+          bool same = true;
+          for (size_t i = 0; i < block_size / sizeof(uint32_t); i++) {
+            if (next[i] != block[0]) {
+              same = false;
+              break;
+            }
+          }
+          if (!same) break;
+          run_len += block_size;
+        }
+        ret = sparse_writer_add_fill(w, block[0], run_len);
+      } else {
+        /* Extend the run until the next fill block. */
+        while (off + run_len + block_size <= to_read) {
+          uint32_t* next = reinterpret_cast<uint32_t*>(buf + off + run_len);
+          bool next_fill = true;
+          for (size_t i = 1; i < block_size / sizeof(uint32_t); i++) {
+            if (next[0] != next[i]) {
+              next_fill = false;
+              break;
+            }
+          }
+          if (next_fill) break;
+          run_len += block_size;
+        }
+        if (off + run_len + block_size > to_read && to_read - off > run_len) {
+          /* Take a trailing partial block with it. */
+          run_len = to_read - off;
+        }
+        ret = sparse_writer_add_data(w, buf + off, run_len);
+      }
+
+      off += run_len;
+    }
+
+    remain -= to_read;
+  }
+
+  free(buf);
+  if (ret < 0) {
+    sparse_writer_close(w);
+    return ret;
+  }
+  return sparse_writer_close(w);
+}
+
 int main(int argc, char* argv[]) {
   int in;
   int out;
@@ -86,6 +190,21 @@ int main(int argc, char* argv[]) {
   len = lseek64(in, 0, SEEK_END);
   lseek64(in, 0, SEEK_SET);
 
+  if (strcmp(argv[1], "-") != 0 && strcmp(argv[2], "-") != 0 && len >= 0) {
+    /* Both ends are seekable files: stream chunks out as the input is
+     * classified instead of building the block list in memory. */
+    ret = convert_streaming(in, out, block_size, len);
+    if (ret) {
+      fprintf(stderr, "Failed to write sparse file\n");
+      exit(-1);
+    }
+
+    close(in);
+    close(out);
+
+    exit(0);
+  }
+
   s = sparse_file_new(block_size, len);
   if (!s) {
     fprintf(stderr, "Failed to create sparse file\n");
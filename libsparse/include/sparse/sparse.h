@@ -319,6 +319,75 @@ struct sparse_file *sparse_file_import_auto(int fd, bool crc, bool verbose);
 int sparse_file_resparse(struct sparse_file *in_s, unsigned int max_len,
 		struct sparse_file **out_s, int out_s_count);
 
+struct sparse_writer;
+
+/**
+ * sparse_writer_open - stream a sparse file to a file descriptor
+ *
+ * @fd - file descriptor to write to
+ * @block_size - minimum size of a chunk
+ * @len - size of the expanded sparse file
+ *
+ * One-pass alternative to filling in a sparse file cookie and calling
+ * sparse_file_write: each chunk is emitted as it is added, so nothing is
+ * accumulated in memory.  Chunks must be added in order of increasing block
+ * and must be multiples of block_size, except for a final partial block.
+ * The chunk count in the sparse file header is patched once the writer is
+ * closed, so fd must be seekable.
+ *
+ * Returns a sparse writer cookie on success, NULL on error.
+ */
+struct sparse_writer *sparse_writer_open(int fd, unsigned int block_size, int64_t len);
+
+/**
+ * sparse_writer_add_data - stream a data chunk
+ *
+ * @w - sparse writer cookie
+ * @data - pointer to the data
+ * @len - length of the data
+ *
+ * The data is written out before returning, so the buffer may be reused by
+ * the caller.  Lengths larger than the maximum chunk size are split into
+ * multiple chunks.
+ *
+ * Returns 0 on success, negative errno on error.
+ */
+int sparse_writer_add_data(struct sparse_writer *w, void *data, uint64_t len);
+
+/**
+ * sparse_writer_add_fill - stream a fill chunk
+ *
+ * @w - sparse writer cookie
+ * @fill_val - 32 bit fill data
+ * @len - length of the fill region
+ *
+ * Returns 0 on success, negative errno on error.
+ */
+int sparse_writer_add_fill(struct sparse_writer *w, uint32_t fill_val, uint64_t len);
+
+/**
+ * sparse_writer_skip - stream a don't-care chunk
+ *
+ * @w - sparse writer cookie
+ * @len - length of the skipped region
+ *
+ * Returns 0 on success, negative errno on error.
+ */
+int sparse_writer_skip(struct sparse_writer *w, uint64_t len);
+
+/**
+ * sparse_writer_close - finish the sparse file and destroy the writer
+ *
+ * @w - sparse writer cookie
+ *
+ * Emits a don't-care chunk for any region after the last added chunk, patches
+ * the chunk count into the sparse file header and destroys the writer.  The
+ * file descriptor is left open.
+ *
+ * Returns 0 on success, negative errno on error.
+ */
+int sparse_writer_close(struct sparse_writer *w);
+
 /**
  * sparse_file_verbose - set a sparse file cookie to print verbose errors
  *
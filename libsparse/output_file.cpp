@@ -18,16 +18,22 @@
 #define _LARGEFILE64_SOURCE 1
 
 #include <algorithm>
+#include <condition_variable>
+#include <deque>
 #include <fcntl.h>
 #include <inttypes.h>
 #include <limits.h>
+#include <mutex>
+#include <new>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <thread>
 #include <unistd.h>
+#include <vector>
 #include <zlib.h>
 
 #include "defs.h"
@@ -297,6 +303,168 @@ static struct output_file_ops callback_file_ops = {
     .close = callback_file_close,
 };
 
+/* A write-behind wrapper that runs another output_file's operations on a
+ * worker thread, so callers overlap chunk preparation (read, decompress,
+ * checksum) with storage writes. Operations are performed strictly in queue
+ * order; write data is staged through a small pool of fixed-size buffers and
+ * the caller only blocks once every buffer is in flight. A failed operation
+ * is reported by a subsequent one, the same way gzwrite defers errors.
+ */
+static constexpr size_t kAsyncBufferSize = 1024 * 1024;
+static constexpr size_t kAsyncBufferCount = 4;
+
+enum async_op_type { ASYNC_OP_WRITE, ASYNC_OP_SKIP, ASYNC_OP_PAD };
+
+struct async_op {
+  enum async_op_type type;
+  std::vector<char> buf; /* ASYNC_OP_WRITE only */
+  size_t len;            /* ASYNC_OP_WRITE only */
+  int64_t arg;           /* ASYNC_OP_SKIP and ASYNC_OP_PAD */
+};
+
+struct async_state {
+  std::thread worker;
+  std::mutex lock;
+  std::condition_variable work_avail;
+  std::condition_variable space_avail;
+  std::deque<struct async_op> queue;
+  std::vector<std::vector<char>> free_bufs;
+  bool shutdown = false;
+  int error = 0;
+};
+
+struct output_file_async {
+  struct output_file out;
+  struct output_file* inner;
+  struct async_state* state;
+};
+
+#define to_output_file_async(_o) container_of((_o), struct output_file_async, out)
+
+static void async_file_worker(struct output_file_async* outa) {
+  struct async_state* state = outa->state;
+
+  std::unique_lock<std::mutex> lock(state->lock);
+  while (true) {
+    if (state->queue.empty()) {
+      if (state->shutdown) break;
+      state->work_avail.wait(lock);
+      continue;
+    }
+    struct async_op op = std::move(state->queue.front());
+    state->queue.pop_front();
+    int error = state->error;
+    lock.unlock();
+
+    int ret = 0;
+    if (!error) {
+      switch (op.type) {
+        case ASYNC_OP_WRITE:
+          ret = outa->inner->ops->write(outa->inner, op.buf.data(), op.len);
+          break;
+        case ASYNC_OP_SKIP:
+          ret = outa->inner->ops->skip(outa->inner, op.arg);
+          break;
+        case ASYNC_OP_PAD:
+          ret = outa->inner->ops->pad(outa->inner, op.arg);
+          break;
+      }
+    }
+
+    lock.lock();
+    if (ret < 0 && !state->error) state->error = ret;
+    if (op.type == ASYNC_OP_WRITE) {
+      state->free_bufs.emplace_back(std::move(op.buf));
+      state->space_avail.notify_one();
+    }
+  }
+}
+
+static int async_file_open(struct output_file* out, int fd) {
+  struct output_file_async* outa = to_output_file_async(out);
+
+  return outa->inner->ops->open(outa->inner, fd);
+}
+
+static int async_file_write(struct output_file* out, void* data, size_t len) {
+  struct output_file_async* outa = to_output_file_async(out);
+  struct async_state* state = outa->state;
+  const char* ptr = reinterpret_cast<const char*>(data);
+
+  while (len > 0) {
+    std::unique_lock<std::mutex> lock(state->lock);
+    while (state->free_bufs.empty() && !state->error) {
+      state->space_avail.wait(lock);
+    }
+    if (state->error) {
+      return state->error;
+    }
+    std::vector<char> buf = std::move(state->free_bufs.back());
+    state->free_bufs.pop_back();
+    lock.unlock();
+
+    size_t count = std::min(len, kAsyncBufferSize);
+    memcpy(buf.data(), ptr, count);
+
+    lock.lock();
+    state->queue.push_back({ASYNC_OP_WRITE, std::move(buf), count, 0});
+    state->work_avail.notify_one();
+    lock.unlock();
+
+    ptr += count;
+    len -= count;
+  }
+
+  return 0;
+}
+
+static int async_file_queue(struct output_file_async* outa, enum async_op_type type, int64_t arg) {
+  struct async_state* state = outa->state;
+
+  std::lock_guard<std::mutex> lock(state->lock);
+  if (state->error) {
+    return state->error;
+  }
+  state->queue.push_back({type, {}, 0, arg});
+  state->work_avail.notify_one();
+  return 0;
+}
+
+static int async_file_skip(struct output_file* out, int64_t cnt) {
+  return async_file_queue(to_output_file_async(out), ASYNC_OP_SKIP, cnt);
+}
+
+static int async_file_pad(struct output_file* out, int64_t len) {
+  return async_file_queue(to_output_file_async(out), ASYNC_OP_PAD, len);
+}
+
+static void async_file_close(struct output_file* out) {
+  struct output_file_async* outa = to_output_file_async(out);
+  struct async_state* state = outa->state;
+
+  {
+    std::lock_guard<std::mutex> lock(state->lock);
+    state->shutdown = true;
+    state->work_avail.notify_one();
+  }
+  state->worker.join();
+  if (state->error) {
+    error("deferred write failure: %d", state->error);
+  }
+  delete state;
+
+  outa->inner->ops->close(outa->inner);
+  free(outa);
+}
+
+static struct output_file_ops async_file_ops = {
+    .open = async_file_open,
+    .skip = async_file_skip,
+    .pad = async_file_pad,
+    .write = async_file_write,
+    .close = async_file_close,
+};
+
 int read_all(int fd, void* buf, size_t len) {
   size_t total = 0;
   int ret;
@@ -588,6 +756,39 @@ static struct output_file* output_file_new_normal(void) {
   return &outn->out;
 }
 
+static struct output_file* output_file_new_async(void) {
+  struct output_file* inner = output_file_new_normal();
+  if (!inner) {
+    return nullptr;
+  }
+
+  struct output_file_async* outa =
+      reinterpret_cast<struct output_file_async*>(calloc(1, sizeof(struct output_file_async)));
+  if (!outa) {
+    error_errno("malloc struct outa");
+    inner->ops->close(inner);
+    return nullptr;
+  }
+
+  struct async_state* state = new (std::nothrow) async_state();
+  if (!state) {
+    error_errno("malloc async_state");
+    inner->ops->close(inner);
+    free(outa);
+    return nullptr;
+  }
+  for (size_t i = 0; i < kAsyncBufferCount; i++) {
+    state->free_bufs.emplace_back(kAsyncBufferSize);
+  }
+
+  outa->out.ops = &async_file_ops;
+  outa->inner = inner;
+  outa->state = state;
+  state->worker = std::thread(async_file_worker, outa);
+
+  return &outa->out;
+}
+
 struct output_file* output_file_open_callback(int (*write)(void*, const void*, size_t), void* priv,
                                               unsigned int block_size, int64_t len, int gz __unused,
                                               int sparse, int chunks, int crc) {
@@ -622,7 +823,7 @@ struct output_file* output_file_open_fd(int fd, unsigned int block_size, int64_t
   if (gz) {
     out = output_file_new_gz();
   } else {
-    out = output_file_new_normal();
+    out = output_file_new_async() ?: output_file_new_normal();
   }
   if (!out) {
     return nullptr;
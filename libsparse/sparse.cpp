@@ -14,9 +14,15 @@
  * limitations under the License.
  */
 
+#define _FILE_OFFSET_BITS 64
+#define _LARGEFILE64_SOURCE 1
+
 #include <assert.h>
+#include <errno.h>
 #include <stdlib.h>
+#include <unistd.h>
 
+#include <android-base/mapped_file.h>
 #include <sparse/sparse.h>
 
 #include "defs.h"
@@ -27,6 +33,16 @@
 #include "sparse_defs.h"
 #include "sparse_format.h"
 
+#if defined(__APPLE__) && defined(__MACH__)
+#define lseek64 lseek
+#define off64_t off_t
+#endif
+
+#define SPARSE_HEADER_MAJOR_VER 1
+#define SPARSE_HEADER_MINOR_VER 0
+#define SPARSE_HEADER_LEN (sizeof(sparse_header_t))
+#define CHUNK_HEADER_LEN (sizeof(chunk_header_t))
+
 struct sparse_file* sparse_file_new(unsigned int block_size, int64_t len) {
   struct sparse_file* s = reinterpret_cast<sparse_file*>(calloc(sizeof(struct sparse_file), 1));
   if (!s) {
@@ -47,6 +63,7 @@ struct sparse_file* sparse_file_new(unsigned int block_size, int64_t len) {
 
 void sparse_file_destroy(struct sparse_file* s) {
   backed_block_list_destroy(s->backed_block_list);
+  delete reinterpret_cast<android::base::MappedFile*>(s->backing_map);
   free(s);
 }
 
@@ -355,6 +372,112 @@ int sparse_file_resparse(struct sparse_file* in_s, unsigned int max_len, struct
   return c;
 }
 
+/* Streams chunks straight to an output_file as they are added, so converting
+ * an image holds no backed_block list.  The chunk count is not known until the
+ * end, so the header is written with a count of zero and patched in
+ * sparse_writer_close(), which is why the writer requires a seekable fd and
+ * does not offer gz or crc modes. */
+struct sparse_writer {
+  struct output_file* out;
+  int fd;
+  unsigned int block_size;
+  int64_t len;       /* size of the expanded file */
+  int64_t offset;    /* bytes covered by emitted chunks, block aligned */
+  unsigned int chunk_cnt;
+};
+
+struct sparse_writer* sparse_writer_open(int fd, unsigned int block_size, int64_t len) {
+  struct sparse_writer* w =
+      reinterpret_cast<sparse_writer*>(calloc(sizeof(struct sparse_writer), 1));
+  if (!w) {
+    return nullptr;
+  }
+
+  w->out = output_file_open_fd(fd, block_size, len, false, true, 0, false);
+  if (!w->out) {
+    free(w);
+    return nullptr;
+  }
+
+  w->fd = fd;
+  w->block_size = block_size;
+  w->len = len;
+
+  return w;
+}
+
+int sparse_writer_add_data(struct sparse_writer* w, void* data, uint64_t len) {
+  char* ptr = reinterpret_cast<char*>(data);
+
+  while (len > 0) {
+    uint64_t chunk = len > MAX_BACKED_BLOCK_SIZE ? MAX_BACKED_BLOCK_SIZE : len;
+    int ret = write_data_chunk(w->out, chunk, ptr);
+    if (ret < 0) {
+      return ret;
+    }
+    w->offset += ALIGN(chunk, w->block_size);
+    w->chunk_cnt++;
+    ptr += chunk;
+    len -= chunk;
+  }
+
+  return 0;
+}
+
+int sparse_writer_add_fill(struct sparse_writer* w, uint32_t fill_val, uint64_t len) {
+  int ret = write_fill_chunk(w->out, len, fill_val);
+  if (ret < 0) {
+    return ret;
+  }
+  w->offset += ALIGN(len, w->block_size);
+  w->chunk_cnt++;
+  return 0;
+}
+
+int sparse_writer_skip(struct sparse_writer* w, uint64_t len) {
+  int ret = write_skip_chunk(w->out, len);
+  if (ret < 0) {
+    return ret;
+  }
+  w->offset += len;
+  w->chunk_cnt++;
+  return 0;
+}
+
+int sparse_writer_close(struct sparse_writer* w) {
+  int ret = 0;
+  int64_t aligned_len = ALIGN(w->len, (int64_t)w->block_size);
+
+  if (w->offset < aligned_len) {
+    ret = sparse_writer_skip(w, aligned_len - w->offset);
+  }
+
+  output_file_close(w->out);
+
+  if (ret == 0) {
+    /* Patch the final chunk count into the header written at open. */
+    sparse_header_t sparse_header = {
+        .magic = SPARSE_HEADER_MAGIC,
+        .major_version = SPARSE_HEADER_MAJOR_VER,
+        .minor_version = SPARSE_HEADER_MINOR_VER,
+        .file_hdr_sz = SPARSE_HEADER_LEN,
+        .chunk_hdr_sz = CHUNK_HEADER_LEN,
+        .blk_sz = w->block_size,
+        .total_blks = static_cast<unsigned>(DIV_ROUND_UP(w->len, w->block_size)),
+        .total_chunks = w->chunk_cnt,
+        .image_checksum = 0};
+
+    if (lseek64(w->fd, 0, SEEK_SET) < 0 ||
+        write(w->fd, &sparse_header, sizeof(sparse_header)) !=
+                (ssize_t)sizeof(sparse_header)) {
+      ret = -errno;
+    }
+  }
+
+  free(w);
+  return ret;
+}
+
 void sparse_file_verbose(struct sparse_file* s) {
   s->verbose = true;
 }
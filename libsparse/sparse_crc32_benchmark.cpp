@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "sparse_crc32.h"
+
+static void BM_sparse_crc32(benchmark::State& state) {
+  std::vector<uint8_t> buf(state.range(0));
+  for (size_t i = 0; i < buf.size(); i++) {
+    buf[i] = static_cast<uint8_t>(i);
+  }
+
+  uint32_t crc = 0;
+  while (state.KeepRunning()) {
+    crc = sparse_crc32(crc, buf.data(), buf.size());
+  }
+  benchmark::DoNotOptimize(crc);
+  state.SetBytesProcessed(state.iterations() * buf.size());
+}
+BENCHMARK(BM_sparse_crc32)->Arg(4096)->Arg(1024 * 1024);
+
+BENCHMARK_MAIN();
@@ -30,6 +30,11 @@ struct sparse_file {
 
   struct backed_block_list* backed_block_list;
   struct output_file* out;
+
+  /* When the input was mmapped for zero-copy reading, the mapping (an
+   * android::base::MappedFile) is owned here so that it outlives the backed
+   * blocks pointing into it.  Released in sparse_file_destroy(). */
+  void* backing_map;
 };
 
 #ifdef __cplusplus
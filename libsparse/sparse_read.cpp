@@ -24,12 +24,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <algorithm>
+#include <memory>
 #include <string>
 
 #include <sparse/sparse.h>
 
+#include "android-base/mapped_file.h"
 #include "android-base/stringprintf.h"
 #include "defs.h"
 #include "output_file.h"
@@ -122,41 +125,73 @@ class SparseFileBufSource : public SparseFileSource {
  private:
   char* buf;
   int64_t offset;
+  int64_t remaining;
 
  public:
-  SparseFileBufSource(char* buf) : buf(buf), offset(0) {}
+  /* The legacy sparse_file_read_buf() and sparse_file_import_buf() interfaces
+   * do not carry a buffer length, so reads through them stay unchecked. */
+  SparseFileBufSource(char* buf, int64_t avail = INT64_MAX)
+      : buf(buf), offset(0), remaining(avail) {}
   ~SparseFileBufSource() override {}
 
   void Seek(int64_t off) override {
     buf += off;
     offset += off;
+    remaining -= off;
   }
 
   int64_t GetOffset() override { return offset; }
 
   int SetOffset(int64_t off) override {
     buf += off - offset;
+    remaining += offset - off;
     offset = off;
     return 0;
   }
 
   int AddToSparseFile(struct sparse_file* s, int64_t len, unsigned int block) override {
+    if (len > remaining) {
+      return -EOVERFLOW;
+    }
     return sparse_file_add_data(s, buf, len, block);
   }
 
   int ReadValue(void* ptr, int len) override {
+    if (len > remaining) {
+      return -EOVERFLOW;
+    }
     memcpy(ptr, buf, len);
     Seek(len);
     return 0;
   }
 
   int GetCrc32(uint32_t* crc32, int64_t len) override {
+    if (len > remaining) {
+      return -EOVERFLOW;
+    }
     *crc32 = sparse_crc32(*crc32, buf, len);
     Seek(len);
     return 0;
   }
 };
 
+/* Maps a regular file so chunk data can be referenced in place rather than
+ * copied through copybuf.  Returns null for pipes, sockets, empty files and
+ * descriptors not positioned at the start of the file, in which case the
+ * caller falls back to reading through the fd.  On success the caller must
+ * hand the mapping to the sparse_file (s->backing_map), since the backed
+ * blocks point into it; it is released in sparse_file_destroy(). */
+static std::unique_ptr<android::base::MappedFile> sparse_file_map_fd(int fd) {
+  struct stat st;
+  if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+    return nullptr;
+  }
+  if (lseek64(fd, 0, SEEK_CUR) != 0) {
+    return nullptr;
+  }
+  return android::base::MappedFile::FromFd(fd, 0, st.st_size, PROT_READ);
+}
+
 static void verbose_error(bool verbose, int err, const char* fmt, ...) {
   if (!verbose) return;
 
@@ -410,8 +445,54 @@ static int sparse_file_read_sparse(struct sparse_file* s, SparseFileSource* sour
   return 0;
 }
 
+static int sparse_file_read_normal_map(struct sparse_file* s, char* data) {
+  unsigned int block = 0;
+  int64_t remain = s->len;
+  int64_t offset = 0;
+  unsigned int to_read;
+  unsigned int i;
+  bool sparse_block;
+
+  while (remain > 0) {
+    to_read = std::min(remain, (int64_t)(s->block_size));
+    uint32_t* buf = (uint32_t*)(data + offset);
+
+    if (to_read == s->block_size) {
+      sparse_block = true;
+      for (i = 1; i < s->block_size / sizeof(uint32_t); i++) {
+        if (buf[0] != buf[i]) {
+          sparse_block = false;
+          break;
+        }
+      }
+    } else {
+      sparse_block = false;
+    }
+
+    if (sparse_block) {
+      /* TODO: add flag to use skip instead of fill for buf[0] == 0 */
+      sparse_file_add_fill(s, buf[0], to_read, block);
+    } else {
+      sparse_file_add_data(s, data + offset, to_read, block);
+    }
+
+    remain -= to_read;
+    offset += to_read;
+    block++;
+  }
+
+  return 0;
+}
+
 static int sparse_file_read_normal(struct sparse_file* s, int fd) {
   int ret;
+
+  if (auto map = sparse_file_map_fd(fd); map && (int64_t)map->size() >= s->len) {
+    char* data = map->data();
+    s->backing_map = map.release();
+    return sparse_file_read_normal_map(s, data);
+  }
+
   uint32_t* buf = (uint32_t*)malloc(s->block_size);
   unsigned int block = 0;
   int64_t remain = s->len;
@@ -467,6 +548,14 @@ int sparse_file_read(struct sparse_file* s, int fd, bool sparse, bool crc) {
   }
 
   if (sparse) {
+    if (auto map = sparse_file_map_fd(fd)) {
+      /* Attach the mapping before parsing: backed blocks created below point
+       * into it, so it must survive until sparse_file_destroy() even if
+       * parsing fails partway through. */
+      SparseFileBufSource source(map->data(), map->size());
+      s->backing_map = map.release();
+      return sparse_file_read_sparse(s, &source, crc);
+    }
     SparseFileFdSource source(fd);
     return sparse_file_read_sparse(s, &source, crc);
   } else {
@@ -536,6 +625,16 @@ static struct sparse_file* sparse_file_import_source(SparseFileSource* source, b
 }
 
 struct sparse_file* sparse_file_import(int fd, bool verbose, bool crc) {
+  if (auto map = sparse_file_map_fd(fd)) {
+    SparseFileBufSource source(map->data(), map->size());
+    struct sparse_file* s = sparse_file_import_source(&source, verbose, crc);
+    if (s) {
+      /* The backed blocks point into the mapping, so the sparse_file owns it
+       * from here on. */
+      s->backing_map = map.release();
+    }
+    return s;
+  }
   SparseFileFdSource source(fd);
   return sparse_file_import_source(&source, verbose, crc);
 }
@@ -18,7 +18,8 @@
 
 #include "SocketListener.h"
 
-#include <vector>
+#include <string_view>
+#include <unordered_map>
 
 class FrameworkCommand;
 class SocketClient;
@@ -33,7 +34,9 @@ public:
 private:
     int mCommandCount;
     bool mWithSeq;
-    std::vector<FrameworkCommand*> mCommands;
+    // Keyed by the command's own name storage, so lookup is one hash with
+    // no allocation.
+    std::unordered_map<std::string_view, FrameworkCommand*> mCommands;
     bool mSkipToNextNullByte;
 
 public:
@@ -43,10 +43,35 @@ private:
     char *mSubsystem;
     char *mParams[NL_PARAMS_MAX];
 
+    /* ASCII uevents are sliced in place: the strings above then point into
+     * the caller's receive buffer instead of being strdup'd, and must not
+     * be freed. Binary messages still own their synthesized strings. */
+    bool mOwnsStrings;
+
+    /* Lazily built by the first findParam() call. */
+    struct ParamIndexEntry {
+        const char *name;
+        size_t nameLen;
+        const char *value;
+    };
+    ParamIndexEntry mParamIndex[NL_PARAMS_MAX];
+    int mParamIndexCount;
+
+    /* Object pool free list; see obtain()/release(). */
+    NetlinkEvent *mNextFree;
+
 public:
     NetlinkEvent();
     virtual ~NetlinkEvent();
 
+    /* Fetches an event from a process-wide pool (or allocates one), so
+     * uevent storms don't hit the allocator per message. Return it with
+     * release(); events obtained this way must not be deleted. */
+    static NetlinkEvent *obtain();
+    void release();
+
+    /* Note: for ASCII messages the decoded strings point into buffer, so
+     * buffer must stay valid for as long as the event is queried. */
     bool decode(char *buffer, int size, int format = NetlinkListener::NETLINK_FORMAT_ASCII);
     const char *findParam(const char *paramName);
 
@@ -56,6 +81,7 @@ public:
     void dump();
 
  protected:
+    void clear();
     bool parseBinaryNetlinkMessage(char *buffer, int size);
     bool parseAsciiNetlinkMessage(char *buffer, int size);
     bool parseIfInfoMessage(const struct nlmsghdr *nh);
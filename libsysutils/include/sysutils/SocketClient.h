@@ -6,11 +6,19 @@
 #include <sys/types.h>
 #include <sys/uio.h>
 
+#include <deque>
+#include <string>
+
 class SocketClient {
     int             mSocket;
     bool            mSocketOwned;
     pthread_mutex_t mWriteMutex;
 
+    // Messages deferred by queueData, flushed in vectored batches by
+    // flushSendQueue (guarded by mWriteMutex).
+    std::deque<std::string> mSendQueue;
+    size_t          mSendQueueBytes;
+
     // Peer process ID
     pid_t mPid;
 
@@ -61,6 +69,16 @@ public:
     // iovec contents not preserved through call
     int sendDatav(struct iovec *iov, int iovcnt);
 
+    // Broadcast batching: queueData copies the bytes to a per-client queue
+    // instead of writing them now, and flushSendQueue writes everything
+    // queued with as few writev calls as possible. SocketListener queues
+    // broadcasts and flushes once the socket reports writable, so a slow
+    // subscriber doesn't stall the broadcasting thread. On a write error
+    // the queue is dropped (as an immediate failed send would be).
+    int queueData(const void *data, int len);
+    int flushSendQueue();
+    bool hasPendingData();
+
     // Optional reference counting.  Reference count starts at 1.  If
     // it's decremented to 0, it deletes itself.
     // SocketListener creates a SocketClient (at refcount 1) and calls
@@ -17,8 +17,12 @@
 #define _SOCKETLISTENER_H
 
 #include <pthread.h>
+#include <stdint.h>
 
+#include <deque>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <sysutils/SocketClient.h>
 #include "SocketClientCommand.h"
@@ -32,6 +36,17 @@ class SocketListener {
     int                     mCtrlPipe[2];
     pthread_t               mThread;
     bool                    mUseCmdNum;
+    int                     mEpollFd;
+
+    // Optional worker pool for onDataAvailable dispatch. Client fds are
+    // registered EPOLLONESHOT, so one client is never processed on two
+    // workers at once.
+    int                     mDispatchThreadCount;
+    std::vector<pthread_t>  mDispatchThreads;
+    std::deque<std::pair<SocketClient*, uint32_t>> mDispatchQueue;
+    pthread_mutex_t         mDispatchLock;
+    pthread_cond_t          mDispatchCond;
+    bool                    mDispatchExit;
 
 public:
     SocketListener(const char *socketName, bool listen);
@@ -43,6 +58,11 @@ public:
     int startListener(int backlog);
     int stopListener();
 
+    // Number of worker threads dispatching onDataAvailable; 0 (the default)
+    // processes clients serially on the listener thread. Call before
+    // startListener.
+    void setDispatchThreadCount(int count);
+
     void sendBroadcast(int code, const char *msg, bool addErrno);
 
     void runOnEachSocket(SocketClientCommand *command);
@@ -54,6 +74,7 @@ protected:
 
 private:
     static void *threadStart(void *obj);
+    static void *dispatchThreadStart(void *obj);
 
     // Add all clients to a separate list, so we don't have to hold the lock
     // while processing it.
@@ -61,6 +82,9 @@ private:
 
     bool release(SocketClient *c, bool wakeup);
     void runListener();
+    void runDispatcher();
+    void processClient(SocketClient *c, uint32_t revents);
+    int registerEpollFd(int fd, bool oneshot);
     void init(const char *socketName, int socketFd, bool listen, bool useCmdNum);
 };
 #endif
@@ -88,22 +88,24 @@ bool FrameworkListener::onDataAvailable(SocketClient *c) {
 }
 
 void FrameworkListener::registerCmd(FrameworkCommand *cmd) {
-    mCommands.push_back(cmd);
+    // first registration of a name wins, as with the old list walk
+    mCommands.emplace(cmd->getCommand(), cmd);
 }
 
 void FrameworkListener::dispatchCommand(SocketClient *cli, char *data) {
     int argc = 0;
     char *argv[FrameworkListener::CMD_ARGS_MAX];
+    /* All tokens are unescaped back to back into this one slab and argv
+     * points into it, so dispatch performs no allocation. */
     char tmp[CMD_BUF_SIZE];
     char *p = data;
     char *q = tmp;
+    char *token = tmp;
     char *qlimit = tmp + sizeof(tmp) - 1;
     bool esc = false;
     bool quote = false;
     bool haveCmdNum = !mWithSeq;
 
-    memset(argv, 0, sizeof(argv));
-    memset(tmp, 0, sizeof(tmp));
     while(*p) {
         if (*p == '\\') {
             if (esc) {
@@ -126,7 +128,7 @@ void FrameworkListener::dispatchCommand(SocketClient *cli, char *data) {
                 *q++ = '\\';
             } else {
                 cli->sendMsg(500, "Unsupported escape sequence", false);
-                goto out;
+                return;
             }
             p++;
             esc = false;
@@ -146,23 +148,22 @@ void FrameworkListener::dispatchCommand(SocketClient *cli, char *data) {
             goto overflow;
         *q = *p++;
         if (!quote && *q == ' ') {
-            *q = '\0';
+            *q++ = '\0';
             if (!haveCmdNum) {
                 char *endptr;
-                int cmdNum = (int)strtol(tmp, &endptr, 0);
+                int cmdNum = (int)strtol(token, &endptr, 0);
                 if (endptr == nullptr || *endptr != '\0') {
                     cli->sendMsg(500, "Invalid sequence number", false);
-                    goto out;
+                    return;
                 }
                 cli->setCmdNum(cmdNum);
                 haveCmdNum = true;
             } else {
                 if (argc >= CMD_ARGS_MAX)
                     goto overflow;
-                argv[argc++] = strdup(tmp);
+                argv[argc++] = token;
             }
-            memset(tmp, 0, sizeof(tmp));
-            q = tmp;
+            token = q;
             continue;
         }
         q++;
@@ -171,7 +172,7 @@ void FrameworkListener::dispatchCommand(SocketClient *cli, char *data) {
     *q = '\0';
     if (argc >= CMD_ARGS_MAX)
         goto overflow;
-    argv[argc++] = strdup(tmp);
+    argv[argc++] = token;
 #if 0
     for (int k = 0; k < argc; k++) {
         SLOGD("arg[%d] = '%s'", k, argv[k]);
@@ -180,31 +181,28 @@ void FrameworkListener::dispatchCommand(SocketClient *cli, char *data) {
 
     if (quote) {
         cli->sendMsg(500, "Unclosed quotes error", false);
-        goto out;
+        return;
     }
 
     if (errorRate && (++mCommandCount % errorRate == 0)) {
         /* ignore this command - let the timeout handler handle it */
         SLOGE("Faking a timeout");
-        goto out;
+        return;
     }
 
-    for (auto* c : mCommands) {
-        if (!strcmp(argv[0], c->getCommand())) {
+    {
+        auto it = mCommands.find(argv[0]);
+        if (it != mCommands.end()) {
+            FrameworkCommand* c = it->second;
             if (c->runCommand(cli, argc, argv)) {
                 SLOGW("Handler '%s' error (%s)", c->getCommand(), strerror(errno));
             }
-            goto out;
+            return;
         }
     }
     cli->sendMsg(500, "Command not recognized", false);
-out:
-    int j;
-    for (j = 0; j < argc; j++)
-        free(argv[j]);
     return;
 
 overflow:
     cli->sendMsg(500, "Command too long", false);
-    goto out;
 }
@@ -29,6 +29,7 @@
 #include <net/if.h>
 #include <netinet/icmp6.h>
 #include <netinet/in.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/socket.h>
@@ -61,24 +62,83 @@ typedef struct ulog_packet_msg {
 
 using android::base::ParseInt;
 
+/* A handful of events covers a storm: one is in flight per listener, the
+ * rest absorb short-lived nesting. */
+static const int MAX_POOL_SIZE = 8;
+static NetlinkEvent* sPool = nullptr;
+static int sPoolSize = 0;
+static pthread_mutex_t sPoolLock = PTHREAD_MUTEX_INITIALIZER;
+
 NetlinkEvent::NetlinkEvent() {
     mAction = Action::kUnknown;
     memset(mParams, 0, sizeof(mParams));
     mPath = nullptr;
     mSubsystem = nullptr;
+    mOwnsStrings = true;
+    mParamIndexCount = -1;
+    mNextFree = nullptr;
 }
 
 NetlinkEvent::~NetlinkEvent() {
+    clear();
+}
+
+/* Frees any owned strings and returns the event to its freshly-constructed
+ * state so it can be reused. */
+void NetlinkEvent::clear() {
     int i;
-    if (mPath)
-        free(mPath);
-    if (mSubsystem)
-        free(mSubsystem);
-    for (i = 0; i < NL_PARAMS_MAX; i++) {
-        if (!mParams[i])
-            break;
-        free(mParams[i]);
+    if (mOwnsStrings) {
+        if (mPath)
+            free(mPath);
+        if (mSubsystem)
+            free(mSubsystem);
+        for (i = 0; i < NL_PARAMS_MAX; i++) {
+            if (!mParams[i])
+                break;
+            free(mParams[i]);
+        }
+    }
+    mAction = Action::kUnknown;
+    memset(mParams, 0, sizeof(mParams));
+    mPath = nullptr;
+    mSubsystem = nullptr;
+    mOwnsStrings = true;
+    mParamIndexCount = -1;
+}
+
+NetlinkEvent* NetlinkEvent::obtain() {
+    NetlinkEvent* evt;
+
+    pthread_mutex_lock(&sPoolLock);
+    evt = sPool;
+    if (evt) {
+        sPool = evt->mNextFree;
+        sPoolSize--;
+    }
+    pthread_mutex_unlock(&sPoolLock);
+
+    if (!evt) {
+        evt = new NetlinkEvent();
+    } else {
+        evt->mNextFree = nullptr;
+    }
+    return evt;
+}
+
+void NetlinkEvent::release() {
+    clear();
+
+    pthread_mutex_lock(&sPoolLock);
+    if (sPoolSize < MAX_POOL_SIZE) {
+        mNextFree = sPool;
+        sPool = this;
+        sPoolSize++;
+        pthread_mutex_unlock(&sPoolLock);
+        return;
     }
+    pthread_mutex_unlock(&sPoolLock);
+
+    delete this;
 }
 
 void NetlinkEvent::dump() {
@@ -639,6 +699,10 @@ bool NetlinkEvent::parseAsciiNetlinkMessage(char *buffer, int size) {
     /* Ensure the buffer is zero-terminated, the code below depends on this */
     buffer[size-1] = '\0';
 
+    /* The strings below are slices of the caller's buffer, not copies; see
+     * the note on decode(). */
+    mOwnsStrings = false;
+
     end = s + size;
     while (s < end) {
         if (first) {
@@ -649,7 +713,7 @@ bool NetlinkEvent::parseAsciiNetlinkMessage(char *buffer, int size) {
                     return false;
                 }
             }
-            mPath = strdup(p+1);
+            mPath = const_cast<char*>(p+1);
             first = 0;
         } else {
             const char* a;
@@ -665,9 +729,9 @@ bool NetlinkEvent::parseAsciiNetlinkMessage(char *buffer, int size) {
                     SLOGE("NetlinkEvent::parseAsciiNetlinkMessage: failed to parse SEQNUM=%s", a);
                 }
             } else if ((a = HAS_CONST_PREFIX(s, end, "SUBSYSTEM=")) != nullptr) {
-                mSubsystem = strdup(a);
+                mSubsystem = const_cast<char*>(a);
             } else if (param_idx < NL_PARAMS_MAX) {
-                mParams[param_idx++] = strdup(s);
+                mParams[param_idx++] = const_cast<char*>(s);
             }
         }
         s += strlen(s) + 1;
@@ -676,6 +740,7 @@ bool NetlinkEvent::parseAsciiNetlinkMessage(char *buffer, int size) {
 }
 
 bool NetlinkEvent::decode(char *buffer, int size, int format) {
+    clear();
     if (format == NetlinkListener::NETLINK_FORMAT_BINARY
             || format == NetlinkListener::NETLINK_FORMAT_BINARY_UNICAST) {
         return parseBinaryNetlinkMessage(buffer, size);
@@ -685,11 +750,25 @@ bool NetlinkEvent::decode(char *buffer, int size, int format) {
 }
 
 const char *NetlinkEvent::findParam(const char *paramName) {
+    /* Split each param at its '=' once, so repeated lookups compare the
+     * key by length + memcmp instead of rescanning the whole string. */
+    if (mParamIndexCount < 0) {
+        mParamIndexCount = 0;
+        for (int i = 0; i < NL_PARAMS_MAX && mParams[i] != nullptr; ++i) {
+            const char *eq = strchr(mParams[i], '=');
+            if (!eq)
+                continue;
+            mParamIndex[mParamIndexCount].name = mParams[i];
+            mParamIndex[mParamIndexCount].nameLen = eq - mParams[i];
+            mParamIndex[mParamIndexCount].value = eq + 1;
+            mParamIndexCount++;
+        }
+    }
+
     size_t len = strlen(paramName);
-    for (int i = 0; i < NL_PARAMS_MAX && mParams[i] != nullptr; ++i) {
-        const char *ptr = mParams[i] + len;
-        if (!strncmp(mParams[i], paramName, len) && *ptr == '=')
-            return ++ptr;
+    for (int i = 0; i < mParamIndexCount; ++i) {
+        if (mParamIndex[i].nameLen == len && !memcmp(mParamIndex[i].name, paramName, len))
+            return mParamIndex[i].value;
     }
 
     SLOGE("NetlinkEvent::FindParam(): Parameter '%s' not found", paramName);
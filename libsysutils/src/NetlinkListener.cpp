@@ -61,7 +61,7 @@ bool NetlinkListener::onDataAvailable(SocketClient *cli)
         return false;
     }
 
-    NetlinkEvent *evt = new NetlinkEvent();
+    NetlinkEvent *evt = NetlinkEvent::obtain();
     if (evt->decode(mBuffer, count, mFormat)) {
         onEvent(evt);
     } else if (mFormat != NETLINK_FORMAT_BINARY) {
@@ -70,6 +70,6 @@ bool NetlinkListener::onDataAvailable(SocketClient *cli)
         SLOGE("Error decoding NetlinkEvent");
     }
 
-    delete evt;
+    evt->release();
     return true;
 }
@@ -40,10 +40,16 @@ SocketClient::SocketClient(int socket, bool owned, bool useCmdNum) {
     init(socket, owned, useCmdNum);
 }
 
+/* Cap on queued broadcast bytes; past this, queueData flushes inline. */
+static const size_t MAX_SEND_QUEUE_BYTES = 256 * 1024;
+/* Messages per writev when flushing the queue. */
+static const int SEND_QUEUE_FLUSH_BATCH = 64;
+
 void SocketClient::init(int socket, bool owned, bool useCmdNum) {
     mSocket = socket;
     mSocketOwned = owned;
     mUseCmdNum = useCmdNum;
+    mSendQueueBytes = 0;
     pthread_mutex_init(&mWriteMutex, nullptr);
     pthread_mutex_init(&mRefCountMutex, nullptr);
     mPid = -1;
@@ -190,6 +196,66 @@ int SocketClient::sendDatav(struct iovec *iov, int iovcnt) {
     return rc;
 }
 
+int SocketClient::queueData(const void *data, int len) {
+    if (len <= 0) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&mWriteMutex);
+    mSendQueue.emplace_back((const char *) data, len);
+    mSendQueueBytes += len;
+    bool overflow = mSendQueueBytes > MAX_SEND_QUEUE_BYTES;
+    pthread_mutex_unlock(&mWriteMutex);
+
+    /* a subscriber this far behind gets a blocking write instead */
+    if (overflow) {
+        return flushSendQueue();
+    }
+    return 0;
+}
+
+int SocketClient::flushSendQueue() {
+    struct iovec iov[SEND_QUEUE_FLUSH_BATCH];
+    int rc = 0;
+
+    pthread_mutex_lock(&mWriteMutex);
+    while (!mSendQueue.empty()) {
+        int count = 0;
+        for (const std::string& msg : mSendQueue) {
+            if (count == SEND_QUEUE_FLUSH_BATCH) {
+                break;
+            }
+            iov[count].iov_base = const_cast<char *>(msg.data());
+            iov[count].iov_len = msg.size();
+            count++;
+        }
+
+        rc = sendDataLockedv(iov, count);
+        if (rc != 0) {
+            /* drop what's left, as an immediate failed send would have */
+            mSendQueue.clear();
+            mSendQueueBytes = 0;
+            break;
+        }
+
+        for (int i = 0; i < count; i++) {
+            mSendQueueBytes -= mSendQueue.front().size();
+            mSendQueue.pop_front();
+        }
+    }
+    pthread_mutex_unlock(&mWriteMutex);
+
+    return rc;
+}
+
+bool SocketClient::hasPendingData() {
+    pthread_mutex_lock(&mWriteMutex);
+    bool pending = !mSendQueue.empty();
+    pthread_mutex_unlock(&mWriteMutex);
+
+    return pending;
+}
+
 int SocketClient::sendDataLockedv(struct iovec *iov, int iovcnt) {
 
     if (mSocket < 0) {
@@ -19,7 +19,7 @@
 #include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <sys/poll.h>
+#include <sys/epoll.h>
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <sys/types.h>
@@ -53,7 +53,14 @@ void SocketListener::init(const char *socketName, int socketFd, bool listen, boo
     mSocketName = socketName;
     mSock = socketFd;
     mUseCmdNum = useCmdNum;
+    mCtrlPipe[0] = -1;
+    mCtrlPipe[1] = -1;
+    mEpollFd = -1;
+    mDispatchThreadCount = 0;
+    mDispatchExit = false;
     pthread_mutex_init(&mClientsLock, nullptr);
+    pthread_mutex_init(&mDispatchLock, nullptr);
+    pthread_cond_init(&mDispatchCond, nullptr);
 }
 
 SocketListener::~SocketListener() {
@@ -64,11 +71,27 @@ SocketListener::~SocketListener() {
         close(mCtrlPipe[0]);
         close(mCtrlPipe[1]);
     }
+    if (mEpollFd != -1) close(mEpollFd);
     for (auto pair : mClients) {
         pair.second->decRef();
     }
 }
 
+void SocketListener::setDispatchThreadCount(int count) {
+    mDispatchThreadCount = count > 0 ? count : 0;
+}
+
+int SocketListener::registerEpollFd(int fd, bool oneshot) {
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN | (oneshot ? EPOLLONESHOT : 0);
+    ev.data.fd = fd;
+    if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        SLOGE("epoll_ctl add %d failed (%s)", fd, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
 int SocketListener::startListener() {
     return startListener(4);
 }
@@ -100,6 +123,27 @@ int SocketListener::startListener(int backlog) {
         return -1;
     }
 
+    mEpollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (mEpollFd < 0) {
+        SLOGE("epoll_create1 failed (%s)", strerror(errno));
+        return -1;
+    }
+    // Clients are one-shot so a fd queued to the worker pool isn't reported
+    // again until that worker re-arms it.
+    if (registerEpollFd(mCtrlPipe[0], false) || registerEpollFd(mSock, !mListen)) {
+        return -1;
+    }
+
+    mDispatchExit = false;
+    for (int i = 0; i < mDispatchThreadCount; i++) {
+        pthread_t t;
+        if (pthread_create(&t, nullptr, SocketListener::dispatchThreadStart, this)) {
+            SLOGE("pthread_create (%s)", strerror(errno));
+            return -1;
+        }
+        mDispatchThreads.push_back(t);
+    }
+
     if (pthread_create(&mThread, nullptr, SocketListener::threadStart, this)) {
         SLOGE("pthread_create (%s)", strerror(errno));
         return -1;
@@ -123,10 +167,24 @@ int SocketListener::stopListener() {
         SLOGE("Error joining to listener thread (%s)", strerror(errno));
         return -1;
     }
+
+    if (!mDispatchThreads.empty()) {
+        pthread_mutex_lock(&mDispatchLock);
+        mDispatchExit = true;
+        pthread_cond_broadcast(&mDispatchCond);
+        pthread_mutex_unlock(&mDispatchLock);
+        for (pthread_t t : mDispatchThreads) {
+            pthread_join(t, nullptr);
+        }
+        mDispatchThreads.clear();
+    }
+
     close(mCtrlPipe[0]);
     close(mCtrlPipe[1]);
     mCtrlPipe[0] = -1;
     mCtrlPipe[1] = -1;
+    close(mEpollFd);
+    mEpollFd = -1;
 
     if (mSocketName && mSock > -1) {
         close(mSock);
@@ -149,78 +207,121 @@ void *SocketListener::threadStart(void *obj) {
 }
 
 void SocketListener::runListener() {
-    while (true) {
-        std::vector<pollfd> fds;
-
-        pthread_mutex_lock(&mClientsLock);
-        fds.reserve(2 + mClients.size());
-        fds.push_back({.fd = mCtrlPipe[0], .events = POLLIN});
-        if (mListen) fds.push_back({.fd = mSock, .events = POLLIN});
-        for (auto pair : mClients) {
-            // NB: calling out to an other object with mClientsLock held (safe)
-            const int fd = pair.second->getSocket();
-            if (fd != pair.first) SLOGE("fd mismatch: %d != %d", fd, pair.first);
-            fds.push_back({.fd = fd, .events = POLLIN});
-        }
-        pthread_mutex_unlock(&mClientsLock);
+    struct epoll_event events[32];
 
+    while (true) {
         SLOGV("mListen=%d, mSocketName=%s", mListen, mSocketName);
-        int rc = TEMP_FAILURE_RETRY(poll(fds.data(), fds.size(), -1));
+        int rc = TEMP_FAILURE_RETRY(
+                epoll_wait(mEpollFd, events, sizeof(events) / sizeof(events[0]), -1));
         if (rc < 0) {
-            SLOGE("poll failed (%s) mListen=%d", strerror(errno), mListen);
+            SLOGE("epoll_wait failed (%s) mListen=%d", strerror(errno), mListen);
             sleep(1);
             continue;
         }
 
-        if (fds[0].revents & (POLLIN | POLLERR)) {
-            char c = CtrlPipe_Shutdown;
-            TEMP_FAILURE_RETRY(read(mCtrlPipe[0], &c, 1));
-            if (c == CtrlPipe_Shutdown) {
-                break;
+        bool shutdown = false;
+        for (int i = 0; i < rc; i++) {
+            const int fd = events[i].data.fd;
+
+            if (fd == mCtrlPipe[0]) {
+                char c = CtrlPipe_Shutdown;
+                TEMP_FAILURE_RETRY(read(mCtrlPipe[0], &c, 1));
+                if (c == CtrlPipe_Shutdown) shutdown = true;
+                continue;
             }
-            continue;
-        }
-        if (mListen && (fds[1].revents & (POLLIN | POLLERR))) {
-            int c = TEMP_FAILURE_RETRY(accept4(mSock, nullptr, nullptr, SOCK_CLOEXEC));
-            if (c < 0) {
-                SLOGE("accept failed (%s)", strerror(errno));
-                sleep(1);
+
+            if (mListen && fd == mSock) {
+                int c = TEMP_FAILURE_RETRY(accept4(mSock, nullptr, nullptr, SOCK_CLOEXEC));
+                if (c < 0) {
+                    SLOGE("accept failed (%s)", strerror(errno));
+                    sleep(1);
+                    continue;
+                }
+                SocketClient* client = new SocketClient(c, true, mUseCmdNum);
+                pthread_mutex_lock(&mClientsLock);
+                mClients[c] = client;
+                pthread_mutex_unlock(&mClientsLock);
+                if (registerEpollFd(c, true)) release(client, false);
                 continue;
             }
+
+            SocketClient* client;
             pthread_mutex_lock(&mClientsLock);
-            mClients[c] = new SocketClient(c, true, mUseCmdNum);
+            auto it = mClients.find(fd);
+            if (it == mClients.end()) {
+                SLOGE("fd vanished: %d", fd);
+                pthread_mutex_unlock(&mClientsLock);
+                continue;
+            }
+            client = it->second;
+            client->incRef();
             pthread_mutex_unlock(&mClientsLock);
-        }
 
-        // Add all active clients to the pending list first, so we can release
-        // the lock before invoking the callbacks.
-        std::vector<SocketClient*> pending;
-        pthread_mutex_lock(&mClientsLock);
-        const int size = fds.size();
-        for (int i = mListen ? 2 : 1; i < size; ++i) {
-            const struct pollfd& p = fds[i];
-            if (p.revents & (POLLIN | POLLERR)) {
-                auto it = mClients.find(p.fd);
-                if (it == mClients.end()) {
-                    SLOGE("fd vanished: %d", p.fd);
-                    continue;
-                }
-                SocketClient* c = it->second;
-                pending.push_back(c);
-                c->incRef();
+            const uint32_t revents = events[i].events;
+            if (mDispatchThreads.empty()) {
+                processClient(client, revents);
+            } else {
+                pthread_mutex_lock(&mDispatchLock);
+                mDispatchQueue.emplace_back(client, revents);
+                pthread_cond_signal(&mDispatchCond);
+                pthread_mutex_unlock(&mDispatchLock);
             }
         }
-        pthread_mutex_unlock(&mClientsLock);
+        if (shutdown) break;
+    }
+}
 
-        for (SocketClient* c : pending) {
-            // Process it, if false is returned, remove from the map
-            SLOGV("processing fd %d", c->getSocket());
-            if (!onDataAvailable(c)) {
-                release(c, false);
-            }
-            c->decRef();
+void *SocketListener::dispatchThreadStart(void *obj) {
+    SocketListener *me = reinterpret_cast<SocketListener *>(obj);
+
+    me->runDispatcher();
+    pthread_exit(nullptr);
+    return nullptr;
+}
+
+void SocketListener::runDispatcher() {
+    while (true) {
+        pthread_mutex_lock(&mDispatchLock);
+        while (mDispatchQueue.empty() && !mDispatchExit) {
+            pthread_cond_wait(&mDispatchCond, &mDispatchLock);
+        }
+        if (mDispatchQueue.empty()) {
+            // exiting, and the queue is drained
+            pthread_mutex_unlock(&mDispatchLock);
+            break;
+        }
+        std::pair<SocketClient*, uint32_t> work = mDispatchQueue.front();
+        mDispatchQueue.pop_front();
+        pthread_mutex_unlock(&mDispatchLock);
+
+        processClient(work.first, work.second);
+    }
+}
+
+// Handles one epoll report for a client and consumes the caller's
+// reference: flushes queued broadcasts when writable, then runs the
+// onDataAvailable callback when readable.
+void SocketListener::processClient(SocketClient* c, uint32_t revents) {
+    if (revents & EPOLLOUT) {
+        if (c->flushSendQueue()) {
+            SLOGW("Error sending queued broadcast (%s)", strerror(errno));
         }
     }
+    if (revents & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+        // Process it, if false is returned, remove from the map
+        SLOGV("processing fd %d", c->getSocket());
+        if (!onDataAvailable(c)) {
+            release(c, false);
+        }
+    }
+    // Re-arm the one-shot entry; fails harmlessly with ENOENT when the
+    // client was just released and removed from the epoll set. The fd can't
+    // be reused yet because we still hold a reference.
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN | (c->hasPendingData() ? EPOLLOUT : 0) | EPOLLONESHOT;
+    ev.data.fd = c->getSocket();
+    epoll_ctl(mEpollFd, EPOLL_CTL_MOD, c->getSocket(), &ev);
+    c->decRef();
 }
 
 bool SocketListener::release(SocketClient* c, bool wakeup) {
@@ -233,6 +334,9 @@ bool SocketListener::release(SocketClient* c, bool wakeup) {
         ret = (mClients.erase(c->getSocket()) != 0);
         pthread_mutex_unlock(&mClientsLock);
         if (ret) {
+            // Takes effect immediately, even mid-epoll_wait, so no fd that
+            // is being torn down is ever handed to a worker.
+            epoll_ctl(mEpollFd, EPOLL_CTL_DEL, c->getSocket(), nullptr);
             ret = c->decRef();
             if (wakeup) {
                 char b = CtrlPipe_Wakeup;
@@ -258,13 +362,45 @@ std::vector<SocketClient*> SocketListener::snapshotClients() {
 }
 
 void SocketListener::sendBroadcast(int code, const char *msg, bool addErrno) {
+    // broadcasts are unsolicited and should not include a cmd number, so
+    // the bytes are identical for every client: format once
+    char *buf;
+    int len;
+    if (addErrno) {
+        len = asprintf(&buf, "%d %s (%s)", code, msg, strerror(errno));
+    } else {
+        len = asprintf(&buf, "%d %s", code, msg);
+    }
+    if (len < 0) {
+        SLOGW("Error formatting broadcast (%s)", strerror(errno));
+        return;
+    }
+
     for (SocketClient* c : snapshotClients()) {
-        // broadcasts are unsolicited and should not include a cmd number
-        if (c->sendMsg(code, msg, addErrno, false)) {
-            SLOGW("Error sending broadcast (%s)", strerror(errno));
+        if (mEpollFd == -1) {
+            // not started yet; write directly
+            if (c->sendData(buf, len + 1)) {
+                SLOGW("Error sending broadcast (%s)", strerror(errno));
+            }
+        } else {
+            // Queue the message and let the listener flush it when the
+            // socket reports writable, so one slow subscriber doesn't
+            // stall this thread.
+            c->queueData(buf, len + 1);
+            struct epoll_event ev = {};
+            ev.events = EPOLLIN | EPOLLOUT | EPOLLONESHOT;
+            ev.data.fd = c->getSocket();
+            if (epoll_ctl(mEpollFd, EPOLL_CTL_MOD, c->getSocket(), &ev) < 0) {
+                // released concurrently or mid-callback re-arm race; the
+                // flush below (or the next re-arm) still delivers it
+                if (c->flushSendQueue()) {
+                    SLOGW("Error sending broadcast (%s)", strerror(errno));
+                }
+            }
         }
         c->decRef();
     }
+    free(buf);
 }
 
 void SocketListener::runOnEachSocket(SocketClientCommand *command) {
@@ -0,0 +1,260 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks for the libutils primitives everything else sits on, each
+// reporting an "allocs/op" counter so allocation regressions show up next to
+// time regressions.  The counter works by interposing the allocator entry
+// points: the dynamic linker resolves malloc/calloc/realloc from libutils.so
+// to the definitions in this binary, which count and forward to the libc
+// implementations.
+
+#include <dlfcn.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+
+#include <utils/Looper.h>
+#include <utils/LruCache.h>
+#include <utils/RefBase.h>
+#include <utils/String16.h>
+#include <utils/String8.h>
+#include <utils/Unicode.h>
+
+#include <benchmark/benchmark.h>
+
+#include "SharedBuffer.h"
+
+static std::atomic<uint64_t> gAllocCount(0);
+
+extern "C" {
+
+typedef void* (*MallocFn)(size_t);
+typedef void* (*CallocFn)(size_t, size_t);
+typedef void* (*ReallocFn)(void*, size_t);
+typedef void (*FreeFn)(void*);
+
+static MallocFn gRealMalloc;
+static CallocFn gRealCalloc;
+static ReallocFn gRealRealloc;
+static FreeFn gRealFree;
+static bool gResolving;
+
+// dlsym() itself allocates on some libcs; those bootstrap requests are served
+// from a small static arena that free() recognizes and ignores.
+static char gBootstrapArena[4096];
+static size_t gBootstrapUsed;
+
+static bool inBootstrapArena(void* ptr) {
+    return ptr >= static_cast<void*>(gBootstrapArena) &&
+           ptr < static_cast<void*>(gBootstrapArena + sizeof(gBootstrapArena));
+}
+
+static void* bootstrapAlloc(size_t size) {
+    size = (size + 15) & ~static_cast<size_t>(15);
+    if (gBootstrapUsed + size > sizeof(gBootstrapArena)) {
+        abort();
+    }
+    void* ptr = gBootstrapArena + gBootstrapUsed;
+    gBootstrapUsed += size;
+    return ptr;
+}
+
+static void resolveRealAllocators() {
+    gResolving = true;
+    gRealCalloc = reinterpret_cast<CallocFn>(dlsym(RTLD_NEXT, "calloc"));
+    gRealMalloc = reinterpret_cast<MallocFn>(dlsym(RTLD_NEXT, "malloc"));
+    gRealRealloc = reinterpret_cast<ReallocFn>(dlsym(RTLD_NEXT, "realloc"));
+    gRealFree = reinterpret_cast<FreeFn>(dlsym(RTLD_NEXT, "free"));
+    gResolving = false;
+}
+
+void* malloc(size_t size) {
+    if (gRealMalloc == nullptr) {
+        if (gResolving) return bootstrapAlloc(size);
+        resolveRealAllocators();
+    }
+    gAllocCount.fetch_add(1, std::memory_order_relaxed);
+    return gRealMalloc(size);
+}
+
+void* calloc(size_t n, size_t size) {
+    if (gRealCalloc == nullptr) {
+        if (gResolving) return bootstrapAlloc(n * size);  // static storage is already zeroed
+        resolveRealAllocators();
+    }
+    gAllocCount.fetch_add(1, std::memory_order_relaxed);
+    return gRealCalloc(n, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    if (gRealRealloc == nullptr) {
+        resolveRealAllocators();
+    }
+    gAllocCount.fetch_add(1, std::memory_order_relaxed);
+    return gRealRealloc(ptr, size);
+}
+
+void free(void* ptr) {
+    if (ptr == nullptr || inBootstrapArena(ptr)) {
+        return;
+    }
+    if (gRealFree == nullptr) {
+        resolveRealAllocators();
+    }
+    gRealFree(ptr);
+}
+
+}  // extern "C"
+
+namespace {
+
+// Reports the allocations made since construction as an avg-per-iteration
+// benchmark counter.
+class AllocCounter {
+public:
+    AllocCounter() : mStart(gAllocCount.load(std::memory_order_relaxed)) {}
+
+    void report(benchmark::State& state) {
+        state.counters["allocs/op"] = benchmark::Counter(
+                static_cast<double>(gAllocCount.load(std::memory_order_relaxed) - mStart),
+                benchmark::Counter::kAvgIterations);
+    }
+
+private:
+    uint64_t mStart;
+};
+
+class TestObject : public android::RefBase {
+public:
+    int value = 0;
+};
+
+class CountingHandler : public android::MessageHandler {
+public:
+    void handleMessage(const android::Message&) override { handled++; }
+
+    size_t handled = 0;
+};
+
+}  // namespace
+
+static void BM_String8_construct_concat(benchmark::State& state) {
+    AllocCounter allocs;
+    while (state.KeepRunning()) {
+        android::String8 s("com.android.example");
+        s.append("/service");
+        benchmark::DoNotOptimize(s.string());
+    }
+    allocs.report(state);
+}
+BENCHMARK(BM_String8_construct_concat);
+
+static void BM_String16_from_utf8(benchmark::State& state) {
+    AllocCounter allocs;
+    while (state.KeepRunning()) {
+        android::String16 s("com.android.example.service");
+        benchmark::DoNotOptimize(s.string());
+    }
+    allocs.report(state);
+}
+BENCHMARK(BM_String16_from_utf8);
+
+static void BM_SharedBuffer_churn(benchmark::State& state) {
+    const size_t size = state.range(0);
+    AllocCounter allocs;
+    while (state.KeepRunning()) {
+        android::SharedBuffer* buffer = android::SharedBuffer::alloc(size);
+        benchmark::DoNotOptimize(buffer->data());
+        buffer->release();
+    }
+    allocs.report(state);
+}
+BENCHMARK(BM_SharedBuffer_churn)->Arg(64)->Arg(4096);
+
+static void BM_LruCache_hit(benchmark::State& state) {
+    android::LruCache<int, int> cache(1024);
+    for (int i = 0; i < 1024; i++) {
+        cache.put(i, i);
+    }
+
+    AllocCounter allocs;
+    int key = 0;
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(cache.get(key));
+        key = (key + 1) & 1023;
+    }
+    allocs.report(state);
+}
+BENCHMARK(BM_LruCache_hit);
+
+static void BM_LruCache_miss(benchmark::State& state) {
+    android::LruCache<int, int> cache(1024);
+    for (int i = 0; i < 1024; i++) {
+        cache.put(i, i);
+    }
+
+    AllocCounter allocs;
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(cache.get(-1));
+    }
+    allocs.report(state);
+}
+BENCHMARK(BM_LruCache_miss);
+
+static void BM_RefBase_sp_traffic(benchmark::State& state) {
+    android::sp<TestObject> obj = new TestObject();
+
+    AllocCounter allocs;
+    while (state.KeepRunning()) {
+        android::sp<TestObject> copy = obj;
+        benchmark::DoNotOptimize(copy.get());
+    }
+    allocs.report(state);
+}
+BENCHMARK(BM_RefBase_sp_traffic);
+
+static void BM_Unicode_utf8_to_utf16(benchmark::State& state) {
+    const char* utf8 = "com.android.example.service";
+    const size_t utf8Len = strlen(utf8);
+    char16_t utf16[64];
+
+    AllocCounter allocs;
+    while (state.KeepRunning()) {
+        ssize_t utf16Len = utf8_to_utf16_length(reinterpret_cast<const uint8_t*>(utf8), utf8Len);
+        utf8_to_utf16(reinterpret_cast<const uint8_t*>(utf8), utf8Len, utf16, utf16Len + 1);
+        benchmark::DoNotOptimize(utf16[0]);
+    }
+    allocs.report(state);
+}
+BENCHMARK(BM_Unicode_utf8_to_utf16);
+
+static void BM_Looper_post_dispatch(benchmark::State& state) {
+    android::sp<android::Looper> looper = new android::Looper(true);
+    android::sp<CountingHandler> handler = new CountingHandler();
+    android::Message msg(0);
+
+    AllocCounter allocs;
+    while (state.KeepRunning()) {
+        looper->sendMessage(handler, msg);
+        looper->pollOnce(0);
+    }
+    allocs.report(state);
+}
+BENCHMARK(BM_Looper_post_dispatch);
+
+BENCHMARK_MAIN();
@@ -22,6 +22,8 @@
 #include <gtest/gtest.h>
 #include <utils/BitSet.h>
 
+#include <vector>
+
 namespace android {
 
 class BitSet32Test : public testing::Test {
@@ -268,4 +270,106 @@ TEST_F(BitSet64Test, GetIndexOfBit) {
     EXPECT_EQ(2U, b1.getIndexOfBit(40));
 }
 
+TEST_F(BitSet32Test, ForEachMarkedBit) {
+    b1.markBit(0);
+    b1.markBit(17);
+    b1.markBit(31);
+
+    std::vector<uint32_t> bits;
+    b1.forEachMarkedBit([&bits](uint32_t n) { bits.push_back(n); });
+    EXPECT_EQ(std::vector<uint32_t>({0, 17, 31}), bits);
+    // The visit must not consume the set.
+    EXPECT_EQ(3u, b1.count());
+}
+
+TEST_F(BitSet64Test, ForEachMarkedBit) {
+    b1.markBit(1);
+    b1.markBit(32);
+    b1.markBit(63);
+
+    std::vector<uint32_t> bits;
+    b1.forEachMarkedBit([&bits](uint32_t n) { bits.push_back(n); });
+    EXPECT_EQ(std::vector<uint32_t>({1, 32, 63}), bits);
+    EXPECT_EQ(3u, b1.count());
+}
+
+class BitSet128Test : public testing::Test {
+protected:
+    BitSet128 b1;
+    BitSet128 b2;
+    virtual void TearDown() {
+        b1.clear();
+        b2.clear();
+    }
+};
+
+TEST_F(BitSet128Test, MarkHasClear) {
+    EXPECT_TRUE(b1.isEmpty());
+    b1.markBit(0);
+    b1.markBit(63);
+    b1.markBit(64);
+    b1.markBit(127);
+    EXPECT_EQ(4u, b1.count());
+    EXPECT_TRUE(b1.hasBit(0) && b1.hasBit(63) && b1.hasBit(64) && b1.hasBit(127));
+    EXPECT_FALSE(b1.hasBit(62) || b1.hasBit(65));
+
+    b1.clearBit(63);
+    EXPECT_FALSE(b1.hasBit(63));
+    EXPECT_EQ(3u, b1.count());
+    b1.clear();
+    EXPECT_TRUE(b1.isEmpty());
+}
+
+TEST_F(BitSet128Test, FirstAndLastMarkedBit) {
+    b1.markBit(70);
+    b1.markBit(100);
+    EXPECT_EQ(70u, b1.firstMarkedBit());
+    EXPECT_EQ(100u, b1.lastMarkedBit());
+
+    EXPECT_EQ(70u, b1.clearFirstMarkedBit());
+    EXPECT_EQ(100u, b1.firstMarkedBit());
+}
+
+TEST_F(BitSet128Test, BitWiseOps) {
+    b1.markBit(5);
+    b1.markBit(80);
+    b2.markBit(80);
+    b2.markBit(127);
+
+    BitSet128 andSet = b1 & b2;
+    EXPECT_EQ(1u, andSet.count());
+    EXPECT_TRUE(andSet.hasBit(80));
+
+    BitSet128 orSet = b1 | b2;
+    EXPECT_EQ(3u, orSet.count());
+    EXPECT_TRUE((b2 | b1) == orSet);
+    EXPECT_TRUE(b1 != b2);
+
+    b1 |= b2;
+    EXPECT_EQ(3u, b1.count());
+}
+
+TEST_F(BitSet128Test, ForEachMarkedBitCrossesWords) {
+    const std::vector<uint32_t> expected = {0, 63, 64, 65, 127};
+    for (uint32_t n : expected) {
+        b1.markBit(n);
+    }
+
+    std::vector<uint32_t> bits;
+    b1.forEachMarkedBit([&bits](uint32_t n) { bits.push_back(n); });
+    EXPECT_EQ(expected, bits);
+    EXPECT_EQ(expected.size(), static_cast<size_t>(b1.count()));
+}
+
+TEST_F(BitSet128Test, FillAndClear) {
+    EXPECT_FALSE(b1.isFull());
+    for (uint32_t n = 0; n < 128; n++) {
+        b1.markBit(n);
+    }
+    EXPECT_TRUE(b1.isFull());
+    EXPECT_EQ(128u, b1.count());
+    b1.clear();
+    EXPECT_TRUE(b1.isEmpty());
+}
+
 } // namespace android
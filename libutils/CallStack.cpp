@@ -21,12 +21,44 @@
 #include <utils/Log.h>
 
 #include <backtrace/Backtrace.h>
+#include <backtrace/BacktraceMap.h>
 
 #define CALLSTACK_WEAK  // Don't generate weak definitions.
 #include <utils/CallStack.h>
 
+#include <unistd.h>
+
+#include <atomic>
+
 namespace android {
 
+// Bumped by CaptureContext::invalidateAll() so that cached maps created
+// before a remap are re-parsed on their next use.
+static std::atomic<uint32_t> gMapGeneration(1);
+
+CallStack::CaptureContext::CaptureContext() : mMapGeneration(0) {
+}
+
+CallStack::CaptureContext::~CaptureContext() {
+}
+
+void CallStack::CaptureContext::invalidate() {
+    mMap.reset();
+}
+
+void CallStack::CaptureContext::invalidateAll() {
+    gMapGeneration.fetch_add(1, std::memory_order_release);
+}
+
+BacktraceMap* CallStack::CaptureContext::getMap() {
+    const uint32_t generation = gMapGeneration.load(std::memory_order_acquire);
+    if (mMap == nullptr || mMapGeneration != generation) {
+        mMap.reset(BacktraceMap::Create(getpid()));
+        mMapGeneration = generation;
+    }
+    return mMap.get();
+}
+
 CallStack::CallStack() {
 }
 
@@ -39,7 +71,7 @@ CallStack::~CallStack() {
 }
 
 void CallStack::update(int32_t ignoreDepth, pid_t tid) {
-    mFrameLines.clear();
+    clear();
 
     std::unique_ptr<Backtrace> backtrace(Backtrace::Create(BACKTRACE_CURRENT_PROCESS, tid));
     if (!backtrace->Unwind(ignoreDepth)) {
@@ -50,6 +82,36 @@ void CallStack::update(int32_t ignoreDepth, pid_t tid) {
     }
 }
 
+void CallStack::update(CaptureContext& context, int32_t ignoreDepth, pid_t tid) {
+    clear();
+
+    std::unique_ptr<Backtrace> backtrace(
+            Backtrace::Create(BACKTRACE_CURRENT_PROCESS, tid, context.getMap()));
+    if (!backtrace->Unwind(ignoreDepth)) {
+        ALOGW("%s: Failed to unwind callstack.", __FUNCTION__);
+    }
+    // Keep the unwound frames and render them on first use: with the map
+    // cached, building a String8 per frame is what dominates capture cost.
+    mUnformatted = std::move(backtrace);
+}
+
+void CallStack::formatUnformatted() const {
+    if (mUnformatted == nullptr) {
+        return;
+    }
+    for (size_t i = 0; i < mUnformatted->NumFrames(); i++) {
+      mFrameLines.push_back(String8(mUnformatted->FormatFrameData(i).c_str()));
+    }
+    mUnformatted = nullptr;
+}
+
+size_t CallStack::size() const {
+    if (mUnformatted != nullptr) {
+        return mUnformatted->NumFrames();
+    }
+    return mFrameLines.size();
+}
+
 void CallStack::log(const char* logtag, android_LogPriority priority, const char* prefix) const {
     LogPrinter printer(logtag, priority, prefix, /*ignoreBlankLines*/false);
     print(printer);
@@ -70,6 +132,7 @@ String8 CallStack::toString(const char* prefix) const {
 }
 
 void CallStack::print(Printer& printer) const {
+    formatUnformatted();
     for (size_t i = 0; i < mFrameLines.size(); i++) {
         printer.printLine(mFrameLines[i]);
     }
@@ -133,9 +133,10 @@ FileMap::~FileMap(void)
 //
 // Returns "false" on failure.
 bool FileMap::create(const char* origFileName, int fd, off64_t offset, size_t length,
-        bool readOnly)
+        bool readOnly, uint32_t options)
 {
 #if defined(__MINGW32__)
+    (void) options;     // mapping hints are not supported on Windows
     int     adjust;
     off64_t adjOffset;
     size_t  adjLength;
@@ -198,6 +199,9 @@ bool FileMap::create(const char* origFileName, int fd, off64_t offset, size_t le
     int flags = MAP_SHARED;
     int prot = PROT_READ;
     if (!readOnly) prot |= PROT_WRITE;
+#if defined(MAP_POPULATE)
+    if (options & CREATE_POPULATE) flags |= MAP_POPULATE;
+#endif
 
     void* ptr = mmap64(nullptr, adjLength, prot, flags, fd, adjOffset);
     if (ptr == MAP_FAILED) {
@@ -210,6 +214,26 @@ bool FileMap::create(const char* origFileName, int fd, off64_t offset, size_t le
         }
     }
     mBasePtr = ptr;
+
+    // Apply the remaining hints now so readahead starts before the first
+    // access.  These are advisory: log and carry on if the kernel refuses.
+    if (ptr != nullptr) {
+        if (options & CREATE_ADVISE_SEQUENTIAL) {
+            if (madvise(ptr, adjLength, MADV_SEQUENTIAL) != 0)
+                ALOGW("madvise(MADV_SEQUENTIAL) failed: %s\n", strerror(errno));
+        }
+#if defined(MADV_HUGEPAGE)
+        if (options & CREATE_HUGEPAGE) {
+            if (madvise(ptr, adjLength, MADV_HUGEPAGE) != 0)
+                ALOGW("madvise(MADV_HUGEPAGE) failed: %s\n", strerror(errno));
+        }
+#endif
+        // Last, so readahead queued by WILLNEED sees the other policies.
+        if (options & CREATE_ADVISE_WILLNEED) {
+            if (madvise(ptr, adjLength, MADV_WILLNEED) != 0)
+                ALOGW("madvise(MADV_WILLNEED) failed: %s\n", strerror(errno));
+        }
+    }
 #endif // !defined(__MINGW32__)
 
     mFileName = origFileName != nullptr ? strdup(origFileName) : nullptr;
@@ -65,3 +65,22 @@ TEST(FileMap, offset_overflow) {
     android::FileMap m;
     ASSERT_FALSE(m.create("test", tf.fd, offset, length, true));
 }
+
+TEST(FileMap, create_options) {
+    TemporaryFile tf;
+    ASSERT_TRUE(tf.fd != -1);
+
+    std::string content(64 * 1024, 'x');
+    ASSERT_TRUE(android::base::WriteStringToFd(content, tf.fd));
+
+    // All of the creation-time hints are advisory, so create() must succeed
+    // and expose the same data regardless of kernel support for them.
+    android::FileMap m;
+    ASSERT_TRUE(m.create("test", tf.fd, 0, content.size(), true,
+                         android::FileMap::CREATE_ADVISE_SEQUENTIAL |
+                                 android::FileMap::CREATE_ADVISE_WILLNEED |
+                                 android::FileMap::CREATE_HUGEPAGE |
+                                 android::FileMap::CREATE_POPULATE));
+    ASSERT_EQ(content.size(), m.getDataLength());
+    ASSERT_EQ(0, memcmp(m.getDataPtr(), content.data(), content.size()));
+}
@@ -20,6 +20,7 @@
  **/
 
 #include <stdlib.h>
+#include <string.h>
 #include <utils/JenkinsHash.h>
 
 namespace android {
@@ -70,5 +71,115 @@ uint32_t JenkinsHashMixShorts(uint32_t hash, const uint16_t* shorts, size_t size
     return hash;
 }
 
+/* Implementation of QuickHash64, a wyhash-style bulk hash. Reads are byte
+ * order dependent, which is fine because the values are in-process only. */
+
+static const uint64_t kQuickHashSecret[4] = {0xa0761d6478bd642full, 0xe7037ed1a0b428dbull,
+                                             0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull};
+
+/* Folds the 128 bit product of a and b back to 64 bits. */
+#ifdef __clang__
+__attribute__((no_sanitize("integer")))
+#endif
+static inline uint64_t QuickHashFold(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t)a * b;
+    return (uint64_t)(r >> 64) ^ (uint64_t)r;
+#else
+    uint64_t ha = a >> 32, la = (uint32_t)a;
+    uint64_t hb = b >> 32, lb = (uint32_t)b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32);
+    uint64_t carry = (t < rl);
+    uint64_t lo = t + (rm1 << 32);
+    carry += (lo < t);
+    uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+    return hi ^ lo;
+#endif
+}
+
+static inline uint64_t QuickHashRead8(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t QuickHashRead4(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t QuickHashRead3(const uint8_t* p, size_t size) {
+    return (((uint64_t)p[0]) << 16) | (((uint64_t)p[size >> 1]) << 8) | p[size - 1];
+}
+
+#ifdef __clang__
+__attribute__((no_sanitize("integer")))
+#endif
+uint64_t QuickHash64(const void* data, size_t size, uint64_t seed) {
+    const uint8_t* p = (const uint8_t*)data;
+    seed ^= QuickHashFold(seed ^ kQuickHashSecret[0], kQuickHashSecret[1]);
+
+    uint64_t a, b;
+    if (size <= 16) {
+        /* Overlapping reads cover every length from 0 to 16 branch-free. */
+        if (size >= 4) {
+            a = (QuickHashRead4(p) << 32) | QuickHashRead4(p + ((size >> 3) << 2));
+            b = (QuickHashRead4(p + size - 4) << 32) |
+                QuickHashRead4(p + size - 4 - ((size >> 3) << 2));
+        } else if (size > 0) {
+            a = QuickHashRead3(p, size);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = size;
+        if (i > 48) {
+            /* Three independent accumulators keep the multipliers pipelined. */
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = QuickHashFold(QuickHashRead8(p) ^ kQuickHashSecret[1],
+                                     QuickHashRead8(p + 8) ^ seed);
+                see1 = QuickHashFold(QuickHashRead8(p + 16) ^ kQuickHashSecret[2],
+                                     QuickHashRead8(p + 24) ^ see1);
+                see2 = QuickHashFold(QuickHashRead8(p + 32) ^ kQuickHashSecret[3],
+                                     QuickHashRead8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = QuickHashFold(QuickHashRead8(p) ^ kQuickHashSecret[1],
+                                 QuickHashRead8(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        a = QuickHashRead8(p + i - 16);
+        b = QuickHashRead8(p + i - 8);
+    }
+
+    a ^= kQuickHashSecret[1];
+    b ^= seed;
+    return QuickHashFold(kQuickHashSecret[1] ^ size, QuickHashFold(a, b));
+}
+
+hash_t QuickHashBytes(const uint8_t* bytes, size_t size) {
+    uint64_t hash = QuickHash64(bytes, size, 0);
+    return (hash_t)(hash ^ (hash >> 32));
+}
+
+uint32_t QuickHashMixBytes(uint32_t hash, const uint8_t* bytes, size_t size) {
+    uint64_t mixed = QuickHash64(bytes, size, hash);
+    return (uint32_t)(mixed ^ (mixed >> 32));
+}
+
+uint32_t QuickHashMixShorts(uint32_t hash, const uint16_t* shorts, size_t size) {
+    return QuickHashMixBytes(hash, reinterpret_cast<const uint8_t*>(shorts),
+                             size * sizeof(uint16_t));
+}
+
 }
 
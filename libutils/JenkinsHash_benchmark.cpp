@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include <utils/JenkinsHash.h>
+
+#include <benchmark/benchmark.h>
+
+// Key sizes mirror the 8-64 byte string keys that dominate hashtable usage.
+
+static void BM_JenkinsHashMixBytes(benchmark::State& state) {
+    const size_t size = state.range(0);
+    uint8_t key[64];
+    memset(key, 'x', sizeof(key));
+
+    while (state.KeepRunning()) {
+        uint32_t hash = android::JenkinsHashMixBytes(0, key, size);
+        benchmark::DoNotOptimize(android::JenkinsHashWhiten(hash));
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_JenkinsHashMixBytes)->Arg(8)->Arg(16)->Arg(32)->Arg(64);
+
+static void BM_QuickHashBytes(benchmark::State& state) {
+    const size_t size = state.range(0);
+    uint8_t key[64];
+    memset(key, 'x', sizeof(key));
+
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(android::QuickHashBytes(key, size));
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_QuickHashBytes)->Arg(8)->Arg(16)->Arg(32)->Arg(64);
+
+BENCHMARK_MAIN();
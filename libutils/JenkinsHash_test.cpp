@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2026 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "JenkinsHash_test"
+
+#include <string.h>
+
+#include <set>
+#include <string>
+
+#include <utils/JenkinsHash.h>
+
+#include <gtest/gtest.h>
+
+namespace android {
+
+TEST(JenkinsHashTest, QuickHash64_Deterministic) {
+    const char* data = "The quick brown fox jumps over the lazy dog";
+    for (size_t size = 0; size <= strlen(data); size++) {
+        EXPECT_EQ(QuickHash64(data, size, 0), QuickHash64(data, size, 0)) << "size " << size;
+    }
+}
+
+TEST(JenkinsHashTest, QuickHash64_SeedChangesResult) {
+    const char* data = "some key";
+    EXPECT_NE(QuickHash64(data, strlen(data), 0), QuickHash64(data, strlen(data), 1));
+}
+
+TEST(JenkinsHashTest, QuickHash64_LengthIsSignificant) {
+    // A buffer of zeros must hash differently at every length, including
+    // lengths that only differ in bytes covered by overlapping reads.
+    char zeros[64] = {};
+    std::set<uint64_t> seen;
+    for (size_t size = 0; size <= sizeof(zeros); size++) {
+        seen.insert(QuickHash64(zeros, size, 0));
+    }
+    EXPECT_EQ(seen.size(), sizeof(zeros) + 1);
+}
+
+TEST(JenkinsHashTest, QuickHash64_EveryBytePosition) {
+    // Flipping any single byte must change the hash.
+    char data[48] = {};
+    const uint64_t baseline = QuickHash64(data, sizeof(data), 0);
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = 1;
+        EXPECT_NE(QuickHash64(data, sizeof(data), 0), baseline) << "byte " << i;
+        data[i] = 0;
+    }
+}
+
+TEST(JenkinsHashTest, QuickHashMixShorts_MatchesBytes) {
+    const uint16_t shorts[] = {u'h', u'e', u'l', u'l', u'o'};
+    EXPECT_EQ(QuickHashMixShorts(42, shorts, 5),
+              QuickHashMixBytes(42, reinterpret_cast<const uint8_t*>(shorts),
+                                5 * sizeof(uint16_t)));
+}
+
+TEST(JenkinsHashTest, QuickHashBytes_ShortKeysSpread) {
+    // 8-64 byte string keys should not collide in a small corpus.
+    std::set<hash_t> seen;
+    size_t count = 0;
+    for (int i = 0; i < 1000; i++) {
+        std::string key = "com.android.example.service" + std::to_string(i);
+        seen.insert(QuickHashBytes(reinterpret_cast<const uint8_t*>(key.data()), key.size()));
+        count++;
+    }
+    EXPECT_EQ(seen.size(), count);
+}
+
+}  // namespace android
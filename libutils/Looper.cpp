@@ -62,6 +62,8 @@ static pthread_key_t gTLSKey = 0;
 Looper::Looper(bool allowNonCallbacks)
     : mAllowNonCallbacks(allowNonCallbacks),
       mSendingMessage(false),
+      mStagedMessages(nullptr),
+      mStagedWakePending(false),
       mPolling(false),
       mEpollRebuildRequired(false),
       mNextRequestSeq(0),
@@ -75,6 +77,13 @@ Looper::Looper(bool allowNonCallbacks)
 }
 
 Looper::~Looper() {
+    // Free any messages still staged by sendMessageAtTime().
+    StagedMessage* staged = mStagedMessages.exchange(nullptr, std::memory_order_acquire);
+    while (staged != nullptr) {
+        StagedMessage* next = staged->next;
+        delete staged;
+        staged = next;
+    }
 }
 
 void Looper::initTLSKey() {
@@ -303,6 +312,7 @@ Done: ;
 
     // Invoke pending message callbacks.
     mNextMessageUptime = LLONG_MAX;
+    drainStagedMessagesLocked();
     while (mMessageEnvelopes.size() != 0) {
         nsecs_t now = systemTime(SYSTEM_TIME_MONOTONIC);
         const MessageEnvelope& messageEnvelope = mMessageEnvelopes.itemAt(0);
@@ -327,6 +337,9 @@ Done: ;
 
             mLock.lock();
             mSendingMessage = false;
+            // Pick up messages posted while the lock was dropped so the next
+            // wakeup time below accounts for them.
+            drainStagedMessagesLocked();
             result = POLL_CALLBACK;
         } else {
             // The last message left at the head of the queue determines the next wakeup time.
@@ -590,30 +603,61 @@ void Looper::sendMessageAtTime(nsecs_t uptime, const sp<MessageHandler>& handler
             this, uptime, handler.get(), message.what);
 #endif
 
-    size_t i = 0;
-    { // acquire lock
-        AutoMutex _l(mLock);
+    // Stage the message on the lock-free stack; the looper thread merges
+    // staged messages into mMessageEnvelopes when it drains.  This keeps
+    // concurrent senders from contending on mLock and from doing the ordered
+    // insertion themselves.
+    StagedMessage* staged = new StagedMessage(uptime, handler, message);
+    staged->next = mStagedMessages.load(std::memory_order_relaxed);
+    while (!mStagedMessages.compare_exchange_weak(staged->next, staged,
+                                                  std::memory_order_release,
+                                                  std::memory_order_relaxed)) {
+    }
 
-        size_t messageCount = mMessageEnvelopes.size();
-        while (i < messageCount && uptime >= mMessageEnvelopes.itemAt(i).uptime) {
-            i += 1;
-        }
+    // A burst of posts needs only one wakeup: the flag stays set until the
+    // looper clears it at the start of a drain, and a post that finds it
+    // already set is guaranteed to be picked up by that drain.
+    if (!mStagedWakePending.exchange(true, std::memory_order_seq_cst)) {
+        wake();
+    }
+}
+
+void Looper::drainStagedMessagesLocked() {
+    if (mStagedMessages.load(std::memory_order_relaxed) == nullptr
+            && !mStagedWakePending.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    // Clear the wake flag before taking the list so that a message staged
+    // after this point raises a fresh wakeup.
+    mStagedWakePending.store(false, std::memory_order_seq_cst);
+    StagedMessage* staged = mStagedMessages.exchange(nullptr, std::memory_order_acquire);
+
+    // The stack is newest-first; reverse it to recover posting order so that
+    // messages with equal uptimes are delivered in the order they were sent.
+    StagedMessage* reversed = nullptr;
+    while (staged != nullptr) {
+        StagedMessage* next = staged->next;
+        staged->next = reversed;
+        reversed = staged;
+        staged = next;
+    }
 
-        MessageEnvelope messageEnvelope(uptime, handler, message);
-        mMessageEnvelopes.insertAt(messageEnvelope, i, 1);
+    while (reversed != nullptr) {
+        StagedMessage* next = reversed->next;
 
-        // Optimization: If the Looper is currently sending a message, then we can skip
-        // the call to wake() because the next thing the Looper will do after processing
-        // messages is to decide when the next wakeup time should be.  In fact, it does
-        // not even matter whether this code is running on the Looper thread.
-        if (mSendingMessage) {
-            return;
+        size_t i = 0;
+        size_t messageCount = mMessageEnvelopes.size();
+        while (i < messageCount && reversed->uptime >= mMessageEnvelopes.itemAt(i).uptime) {
+            i += 1;
         }
-    } // release lock
+        mMessageEnvelopes.insertAt(
+                MessageEnvelope(reversed->uptime, std::move(reversed->handler),
+                                reversed->message),
+                i, 1);
 
-    // Wake the poll loop only when we enqueue a new message at the head.
-    if (i == 0) {
-        wake();
+        delete reversed;
+        reversed = next;
     }
 }
 
@@ -624,6 +668,7 @@ void Looper::removeMessages(const sp<MessageHandler>& handler) {
 
     { // acquire lock
         AutoMutex _l(mLock);
+        drainStagedMessagesLocked();
 
         for (size_t i = mMessageEnvelopes.size(); i != 0; ) {
             const MessageEnvelope& messageEnvelope = mMessageEnvelopes.itemAt(--i);
@@ -641,6 +686,7 @@ void Looper::removeMessages(const sp<MessageHandler>& handler, int what) {
 
     { // acquire lock
         AutoMutex _l(mLock);
+        drainStagedMessagesLocked();
 
         for (size_t i = mMessageEnvelopes.size(); i != 0; ) {
             const MessageEnvelope& messageEnvelope = mMessageEnvelopes.itemAt(--i);
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <utils/Looper.h>
+#include <utils/Timers.h>
+
+#include <atomic>
+#include <thread>
+
+namespace {
+
+class CountingHandler : public android::MessageHandler {
+public:
+    void handleMessage(const android::Message&) override {
+        handled.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::atomic<size_t> handled{0};
+};
+
+class LatencyHandler : public android::MessageHandler {
+public:
+    void handleMessage(const android::Message&) override {
+        deliveredAt.store(systemTime(SYSTEM_TIME_MONOTONIC), std::memory_order_release);
+    }
+
+    std::atomic<nsecs_t> deliveredAt{0};
+};
+
+}  // namespace
+
+// Sender-side cost of posting a message from a thread other than the one
+// running the loop.
+void BM_send_message_cross_thread(benchmark::State& state) {
+    android::sp<android::Looper> looper = new android::Looper(true);
+    android::sp<CountingHandler> handler = new CountingHandler();
+    std::atomic<bool> done(false);
+    std::thread loopThread([&] {
+        while (!done.load(std::memory_order_relaxed)) {
+            looper->pollOnce(100);
+        }
+    });
+
+    android::Message msg(0);
+    size_t sent = 0;
+    while (state.KeepRunning()) {
+        looper->sendMessage(handler, msg);
+        sent++;
+    }
+
+    while (handler->handled.load(std::memory_order_relaxed) < sent) {
+        std::this_thread::yield();
+    }
+    done.store(true, std::memory_order_relaxed);
+    looper->wake();
+    loopThread.join();
+}
+BENCHMARK(BM_send_message_cross_thread);
+
+// End-to-end latency from sendMessage() on one thread to handleMessage() on
+// the loop thread.  Reported as manual time so the distribution reflects
+// delivery latency rather than sender throughput.
+void BM_post_latency_cross_thread(benchmark::State& state) {
+    android::sp<android::Looper> looper = new android::Looper(true);
+    android::sp<LatencyHandler> handler = new LatencyHandler();
+    std::atomic<bool> done(false);
+    std::thread loopThread([&] {
+        while (!done.load(std::memory_order_relaxed)) {
+            looper->pollOnce(100);
+        }
+    });
+
+    android::Message msg(0);
+    while (state.KeepRunning()) {
+        handler->deliveredAt.store(0, std::memory_order_relaxed);
+        const nsecs_t postedAt = systemTime(SYSTEM_TIME_MONOTONIC);
+        looper->sendMessage(handler, msg);
+        nsecs_t deliveredAt;
+        while ((deliveredAt = handler->deliveredAt.load(std::memory_order_acquire)) == 0) {
+        }
+        state.SetIterationTime((deliveredAt - postedAt) / 1e9);
+    }
+
+    done.store(true, std::memory_order_relaxed);
+    looper->wake();
+    loopThread.join();
+}
+BENCHMARK(BM_post_latency_cross_thread)->UseManualTime();
+
+BENCHMARK_MAIN();
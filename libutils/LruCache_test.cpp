@@ -456,4 +456,106 @@ TEST_F(LruCacheTest, DontCopyKeyInGet) {
     cache.get(KeyFailsOnCopy(0));
 }
 
+TEST_F(LruCacheTest, ProtectedSegmentSurvivesScan) {
+    LruCache<SimpleKey, StringValue> cache(4);
+    cache.setProtectedCapacity(2);
+
+    cache.put(1, "one");
+    cache.put(2, "two");
+    // A hit promotes to the protected segment.
+    EXPECT_STREQ("one", cache.get(1));
+    EXPECT_STREQ("two", cache.get(2));
+
+    // A scan of never-reused keys churns only the probationary segment.
+    for (int i = 100; i < 120; i++) {
+        cache.put(i, "scan");
+    }
+
+    EXPECT_STREQ("one", cache.get(1));
+    EXPECT_STREQ("two", cache.get(2));
+    EXPECT_EQ(4u, cache.size());
+}
+
+TEST_F(LruCacheTest, ProtectedOverflowDemotes) {
+    LruCache<SimpleKey, StringValue> cache(4);
+    cache.setProtectedCapacity(1);
+
+    cache.put(1, "one");
+    cache.put(2, "two");
+    EXPECT_STREQ("one", cache.get(1));
+    // Promoting 2 overflows the protected segment and demotes 1 to probationary MRU.
+    EXPECT_STREQ("two", cache.get(2));
+
+    cache.put(3, "three");
+    cache.put(4, "four");
+    cache.put(5, "five");  // evicts probationary LRU, which is the demoted 1
+
+    EXPECT_EQ(nullptr, cache.get(1));
+    EXPECT_STREQ("two", cache.get(2));
+    EXPECT_EQ(4u, cache.size());
+}
+
+TEST_F(LruCacheTest, DisablingProtectedSegmentMergesEntries) {
+    LruCache<SimpleKey, StringValue> cache(4);
+    cache.setProtectedCapacity(2);
+
+    cache.put(1, "one");
+    cache.put(2, "two");
+    EXPECT_STREQ("one", cache.get(1));
+    EXPECT_STREQ("two", cache.get(2));
+
+    cache.setProtectedCapacity(0);
+    EXPECT_EQ(2u, cache.size());
+    EXPECT_STREQ("one", cache.get(1));
+    EXPECT_STREQ("two", cache.get(2));
+}
+
+TEST_F(LruCacheTest, PinnedEntrySkippedByEviction) {
+    LruCache<SimpleKey, StringValue> cache(2);
+
+    cache.put(1, "one");
+    cache.put(2, "two");
+    EXPECT_TRUE(cache.pin(1));
+
+    cache.put(3, "three");  // evicts 2; 1 is pinned even though it is the LRU entry
+
+    EXPECT_STREQ("one", cache.get(1));
+    EXPECT_EQ(nullptr, cache.get(2));
+    EXPECT_STREQ("three", cache.get(3));
+}
+
+TEST_F(LruCacheTest, PinnedEntrySkippedByRemoveOldest) {
+    LruCache<SimpleKey, StringValue> cache(100);
+
+    cache.put(1, "one");
+    cache.put(2, "two");
+    EXPECT_TRUE(cache.pin(1));
+
+    cache.removeOldest();
+    EXPECT_STREQ("one", cache.get(1));
+    EXPECT_EQ(nullptr, cache.get(2));
+
+    EXPECT_TRUE(cache.unpin(1));
+    cache.removeOldest();
+    EXPECT_EQ(nullptr, cache.get(1));
+    EXPECT_EQ(0u, cache.size());
+}
+
+TEST_F(LruCacheTest, PinNonMember) {
+    LruCache<SimpleKey, StringValue> cache(100);
+
+    cache.put(1, "one");
+    EXPECT_FALSE(cache.pin(2));
+    EXPECT_FALSE(cache.unpin(2));
+}
+
+TEST_F(LruCacheTest, PinnedEntryStillRemovedExplicitly) {
+    LruCache<SimpleKey, StringValue> cache(100);
+
+    cache.put(1, "one");
+    EXPECT_TRUE(cache.pin(1));
+    EXPECT_TRUE(cache.remove(1));
+    EXPECT_EQ(nullptr, cache.get(1));
+}
+
 }
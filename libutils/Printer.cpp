@@ -21,7 +21,13 @@
 #include <utils/String8.h>
 #include <utils/Log.h>
 
+#include <errno.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
 
 namespace android {
 
@@ -120,6 +126,95 @@ void FdPrinter::printLine(const char* string) {
 #endif
 }
 
+/*
+ * Implementation of BufferedFdPrinter
+ */
+BufferedFdPrinter::BufferedFdPrinter(int fd, unsigned int indent, const char* prefix) :
+        mFd(fd), mBufferedBytes(0) {
+
+    if (fd < 0) {
+        ALOGW("%s: File descriptor out of range (%d)", __FUNCTION__, fd);
+    }
+
+    // <indent><prefix><line> -- same layout as FdPrinter
+    mLinePrefix.assign(indent, ' ');
+    mLinePrefix.append(prefix ?: "");
+}
+
+BufferedFdPrinter::~BufferedFdPrinter() {
+    flush();
+}
+
+void BufferedFdPrinter::printLine(const char* string) {
+    if (string == nullptr) {
+        ALOGW("%s: NULL string passed in", __FUNCTION__);
+        return;
+    }
+
+    std::string line;
+    line.reserve(mLinePrefix.size() + strlen(string) + 1);
+    line.append(mLinePrefix);
+    line.append(string);
+    line.push_back('\n');
+
+    mBufferedBytes += line.size();
+    mLines.push_back(std::move(line));
+
+    if (mBufferedBytes >= FLUSH_THRESHOLD) {
+        flush();
+    }
+}
+
+void BufferedFdPrinter::flush() {
+    if (mLines.empty()) {
+        return;
+    } else if (mFd < 0) {
+        ALOGW("%s: File descriptor out of range (%d)", __FUNCTION__, mFd);
+        mLines.clear();
+        mBufferedBytes = 0;
+        return;
+    }
+
+#ifndef _WIN32
+    for (size_t i = 0; i < mLines.size(); i += MAX_IOVECS) {
+        struct iovec iov[MAX_IOVECS];
+        size_t count = mLines.size() - i;
+        if (count > MAX_IOVECS) {
+            count = MAX_IOVECS;
+        }
+        for (size_t j = 0; j < count; ++j) {
+            iov[j].iov_base = const_cast<char*>(mLines[i + j].data());
+            iov[j].iov_len = mLines[i + j].size();
+        }
+
+        struct iovec* cur = iov;
+        size_t remaining = count;
+        while (remaining > 0) {
+            ssize_t written = TEMP_FAILURE_RETRY(writev(mFd, cur, remaining));
+            if (written < 0) {
+                ALOGW("%s: writev failed: %s", __FUNCTION__, strerror(errno));
+                mLines.clear();
+                mBufferedBytes = 0;
+                return;
+            }
+            // Skip fully written iovecs and adjust the first partial one.
+            while (remaining > 0 && static_cast<size_t>(written) >= cur->iov_len) {
+                written -= cur->iov_len;
+                ++cur;
+                --remaining;
+            }
+            if (remaining > 0) {
+                cur->iov_base = static_cast<char*>(cur->iov_base) + written;
+                cur->iov_len -= written;
+            }
+        }
+    }
+#endif
+
+    mLines.clear();
+    mBufferedBytes = 0;
+}
+
 /*
  * Implementation of String8Printer
  */
@@ -22,7 +22,12 @@
 #include <dirent.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
 #include <memory>
+#include <thread>
+#include <vector>
 
 #include <utils/Printer.h>
 
@@ -35,6 +40,9 @@ enum {
 
     // Dump related prettiness constants
     IGNORE_DEPTH_CURRENT_THREAD = 2,
+
+    // Upper bound on threads used for concurrent capture/formatting.
+    MAX_DUMP_WORKERS = 4,
 };
 
 static const char* CALL_STACK_PREFIX = "  ";
@@ -99,6 +107,37 @@ static String8 getThreadName(pid_t tid) {
     return String8(procName);
 }
 
+/*
+ * Run work(i) for each i in [0, count) on up to MAX_DUMP_WORKERS threads.
+ * Falls back to the calling thread for trivially small batches.
+ */
+static void runOnWorkerPool(size_t count, const std::function<void(size_t)>& work) {
+    const size_t numWorkers =
+            std::min({count, static_cast<size_t>(MAX_DUMP_WORKERS),
+                      static_cast<size_t>(std::max(1u, std::thread::hardware_concurrency()))});
+    if (numWorkers <= 1) {
+        for (size_t i = 0; i < count; ++i) {
+            work(i);
+        }
+        return;
+    }
+
+    std::atomic<size_t> nextIndex(0);
+    std::vector<std::thread> workers;
+    workers.reserve(numWorkers);
+    for (size_t w = 0; w < numWorkers; ++w) {
+        workers.emplace_back([&]() {
+            size_t i;
+            while ((i = nextIndex.fetch_add(1, std::memory_order_relaxed)) < count) {
+                work(i);
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
 static String8 getTimeString(struct tm tm) {
     char timestr[MAX_TIME_STRING];
     // i.e. '2013-10-22 14:42:05'
@@ -169,24 +208,45 @@ void ProcessCallStack::update() {
                   __FUNCTION__, strerror(-idx));
             continue;
         }
+    }
 
-        ThreadInfo& threadInfo = mThreadMap.editValueAt(static_cast<size_t>(idx));
-
-        /*
-         * Ignore CallStack::update and ProcessCallStack::update for current thread
-         * - Every other thread doesn't need this since we call update off-thread
-         */
-        int ignoreDepth = (selfPid == tid) ? IGNORE_DEPTH_CURRENT_THREAD : 0;
+    /*
+     * Capture the other threads' stacks concurrently: each per-tid unwind is
+     * independent, and sequential capture freezes heavily threaded processes
+     * for the whole dump.  Resolve the slots up front so the workers never
+     * touch the map itself.
+     */
+    std::vector<std::pair<pid_t, ThreadInfo*>> pending;
+    pending.reserve(mThreadMap.size());
+    for (size_t i = 0; i < mThreadMap.size(); ++i) {
+        pid_t tid = mThreadMap.keyAt(i);
+        ThreadInfo& threadInfo = mThreadMap.editValueAt(i);
+        if (tid == selfPid) {
+            /*
+             * Ignore CallStack::update and ProcessCallStack::update for current thread
+             * - Capture it here rather than from a worker so the ignore depth
+             *   stays meaningful
+             */
+            threadInfo.callStack.update(IGNORE_DEPTH_CURRENT_THREAD, tid);
+            threadInfo.threadName = getThreadName(tid);
+            continue;
+        }
+        pending.push_back(std::make_pair(tid, &threadInfo));
+    }
 
-        // Update thread's call stacks
-        threadInfo.callStack.update(ignoreDepth, tid);
+    runOnWorkerPool(pending.size(), [&pending](size_t i) {
+        // One cached process map per worker thread; formatting is deferred
+        // to print time (and parallelized there, see printInternal).
+        thread_local CallStack::CaptureContext context;
 
-        // Read/save thread name
-        threadInfo.threadName = getThreadName(tid);
+        pid_t tid = pending[i].first;
+        ThreadInfo* threadInfo = pending[i].second;
+        threadInfo->callStack.update(context, /*ignoreDepth*/ 0, tid);
+        threadInfo->threadName = getThreadName(tid);
 
         ALOGV("%s: Got call stack for tid %d (size %zu)",
-              __FUNCTION__, tid, threadInfo.callStack.size());
-    }
+              __FUNCTION__, tid, threadInfo->callStack.size());
+    });
 }
 
 void ProcessCallStack::log(const char* logtag, android_LogPriority priority,
@@ -205,6 +265,12 @@ void ProcessCallStack::print(Printer& printer) const {
 }
 
 void ProcessCallStack::printInternal(Printer& printer, Printer& csPrinter) const {
+    // Stacks captured via a CaptureContext haven't been rendered to text
+    // yet; do that on the worker pool before the sequential dump below.
+    runOnWorkerPool(mThreadMap.size(), [this](size_t i) {
+        mThreadMap.valueAt(i).callStack.format();
+    });
+
     dumpProcessHeader(printer, getpid(),
                       getTimeString(mTimeUpdated).string());
 
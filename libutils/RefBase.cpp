@@ -660,6 +660,36 @@ bool RefBase::weakref_type::attemptIncStrong(const void* id)
     return true;
 }
 
+BitSet64 RefBase::weakref_type::attemptIncStrong(weakref_type* const* refs,
+                                                 const void* const* ids, size_t n)
+{
+    LOG_ALWAYS_FATAL_IF(n > 64, "attemptIncStrong() batch of %zu entries exceeds 64", n);
+
+    BitSet64 promoted;
+    for (size_t i = 0; i < n; i++) {
+        weakref_impl* const impl = static_cast<weakref_impl*>(refs[i]);
+        if (impl == nullptr) {
+            continue;
+        }
+        // The caller holds a weak reference on every entry, so mStrong can be
+        // read before we take a weak reference of our own.  An object with a
+        // "normal" lifetime whose strong count has reached zero can never be
+        // revived; reject it here rather than paying attemptIncStrong()'s
+        // incWeak()/decWeak() round trip to discover the same thing.  Objects
+        // with extended lifetimes must take the full path, which consults
+        // onIncStrongAttempted().
+        int32_t curCount = impl->mStrong.load(std::memory_order_relaxed);
+        if (curCount <= 0 && (impl->mFlags.load(std::memory_order_relaxed) &
+                              OBJECT_LIFETIME_MASK) == OBJECT_LIFETIME_STRONG) {
+            continue;
+        }
+        if (refs[i]->attemptIncStrong(ids[i])) {
+            promoted.markBit(i);
+        }
+    }
+    return promoted;
+}
+
 bool RefBase::weakref_type::attemptIncWeak(const void* id)
 {
     weakref_impl* const impl = static_cast<weakref_impl*>(this);
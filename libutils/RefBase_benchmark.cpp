@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <utils/LightRefBase.h>
+#include <utils/RefBase.h>
+
+#include <vector>
+
+namespace {
+
+class Full : public android::RefBase {};
+
+// The slim layout: one inline count, no weakref_impl, no wp<> support.
+class Light : public android::LightRefBase<Light> {};
+
+}  // namespace
+
+// Cost of copying an sp<> to a RefBase-derived object: incStrong (which
+// also takes a weak reference) on copy, decStrong on destruction.
+static void BM_sp_copy_RefBase(benchmark::State& state) {
+    android::sp<Full> obj = new Full();
+    while (state.KeepRunning()) {
+        android::sp<Full> copy = obj;
+        benchmark::DoNotOptimize(copy.get());
+    }
+}
+BENCHMARK(BM_sp_copy_RefBase);
+
+// Same copy against the slim layout.
+static void BM_sp_copy_LightRefBase(benchmark::State& state) {
+    android::sp<Light> obj = new Light();
+    while (state.KeepRunning()) {
+        android::sp<Light> copy = obj;
+        benchmark::DoNotOptimize(copy.get());
+    }
+}
+BENCHMARK(BM_sp_copy_LightRefBase);
+
+// A bare incStrong/decStrong pair, without the sp<> wrapper.
+static void BM_incdec_RefBase(benchmark::State& state) {
+    android::sp<Full> obj = new Full();
+    while (state.KeepRunning()) {
+        obj->incStrong(&obj);
+        obj->decStrong(&obj);
+    }
+}
+BENCHMARK(BM_incdec_RefBase);
+
+static void BM_incdec_LightRefBase(benchmark::State& state) {
+    android::sp<Light> obj = new Light();
+    while (state.KeepRunning()) {
+        obj->incStrong(&obj);
+        obj->decStrong(&obj);
+    }
+}
+BENCHMARK(BM_incdec_LightRefBase);
+
+// Cost of promoting a wp<> back to an sp<>, the operation that the
+// weakref_impl indirection in RefBase exists to support.
+static void BM_wp_promote(benchmark::State& state) {
+    android::sp<Full> obj = new Full();
+    android::wp<Full> weak = obj;
+    while (state.KeepRunning()) {
+        android::sp<Full> strong = weak.promote();
+        benchmark::DoNotOptimize(strong.get());
+    }
+}
+BENCHMARK(BM_wp_promote);
+
+// Notification fan-out over an observer list where half the observers have
+// died, first promoting element-wise and then with the batch API, which
+// rejects dead entries without the weak count round trip.
+static void buildObserverList(std::vector<android::sp<Full>>* owners,
+                              std::vector<android::wp<Full>>* observers) {
+    for (size_t i = 0; i < 64; i++) {
+        android::sp<Full> obj = new Full();
+        observers->push_back(android::wp<Full>(obj));
+        if (i % 2 == 0) {
+            owners->push_back(obj);  // Odd entries die when obj goes out of scope.
+        }
+    }
+}
+
+static void BM_wp_promote_list(benchmark::State& state) {
+    std::vector<android::sp<Full>> owners;
+    std::vector<android::wp<Full>> observers;
+    buildObserverList(&owners, &observers);
+    while (state.KeepRunning()) {
+        for (const auto& weak : observers) {
+            android::sp<Full> strong = weak.promote();
+            benchmark::DoNotOptimize(strong.get());
+        }
+    }
+}
+BENCHMARK(BM_wp_promote_list);
+
+static void BM_wp_promote_batch(benchmark::State& state) {
+    std::vector<android::sp<Full>> owners;
+    std::vector<android::wp<Full>> observers;
+    buildObserverList(&owners, &observers);
+    android::sp<Full> promoted[64];
+    while (state.KeepRunning()) {
+        android::BitSet64 set =
+                android::wp<Full>::promote(observers.data(), promoted, observers.size());
+        benchmark::DoNotOptimize(set.value);
+        for (auto& strong : promoted) {
+            strong.clear();
+        }
+    }
+}
+BENCHMARK(BM_wp_promote_batch);
+
+BENCHMARK_MAIN();
@@ -128,6 +128,75 @@ TEST(RefBase, WeakCopies) {
     ASSERT_FALSE(isDeleted) << "Deletion on wp destruction should no longer occur";
 }
 
+// A Foo whose lifetime is extended by weak references; promotion of a dead
+// entry must go through onIncStrongAttempted() rather than the batch fast
+// rejection.
+class FooWeakLifetime : public RefBase {
+public:
+    FooWeakLifetime(bool* deleted_check) : mDeleted(deleted_check) {
+        *mDeleted = false;
+        extendObjectLifetime(OBJECT_LIFETIME_WEAK);
+    }
+
+    ~FooWeakLifetime() {
+        *mDeleted = true;
+    }
+private:
+    bool* mDeleted;
+};
+
+TEST(RefBase, BatchPromote) {
+    bool isDeleted[4];
+    sp<Foo> sp1(new Foo(&isDeleted[0]));
+    sp<Foo> sp2(new Foo(&isDeleted[1]));
+    wp<Foo> weak[5];
+    weak[0] = sp1;
+    weak[1] = sp2;
+    weak[2] = new Foo(&isDeleted[2]);  // Dies immediately below.
+    {
+        sp<Foo> doomed(weak[2].promote());
+    }
+    ASSERT_TRUE(isDeleted[2]);
+    // weak[3] stays null; weak[4] refers to an object that never had a strong
+    // reference, which promotes via the INITIAL_STRONG_VALUE path.
+    weak[4] = new Foo(&isDeleted[3]);
+
+    sp<Foo> promoted[5];
+    BitSet64 set = wp<Foo>::promote(weak, promoted, 5);
+    EXPECT_EQ(3U, set.count());
+    EXPECT_TRUE(set.hasBit(0));
+    EXPECT_TRUE(set.hasBit(1));
+    EXPECT_FALSE(set.hasBit(2));
+    EXPECT_FALSE(set.hasBit(3));
+    EXPECT_TRUE(set.hasBit(4));
+    EXPECT_EQ(sp1, promoted[0]);
+    EXPECT_EQ(sp2, promoted[1]);
+    EXPECT_EQ(nullptr, promoted[2].get());
+    EXPECT_EQ(nullptr, promoted[3].get());
+    EXPECT_EQ(weak[4], promoted[4]);
+    EXPECT_EQ(2, sp1->getStrongCount());
+
+    // Results overwrite whatever dst held, including failures.
+    promoted[2] = sp1;
+    set = wp<Foo>::promote(weak, promoted, 5);
+    EXPECT_EQ(3U, set.count());
+    EXPECT_EQ(nullptr, promoted[2].get());
+
+    // An object with an extended lifetime is revivable after its last strong
+    // reference is dropped, so the batch must not reject it as dead.
+    bool weakLifetimeDeleted;
+    wp<FooWeakLifetime> weakLifetime(new FooWeakLifetime(&weakLifetimeDeleted));
+    {
+        sp<FooWeakLifetime> strong(weakLifetime.promote());
+        ASSERT_NE(nullptr, strong.get());
+    }
+    ASSERT_FALSE(weakLifetimeDeleted);
+    sp<FooWeakLifetime> revived[1];
+    BitSet64 revivedSet = wp<FooWeakLifetime>::promote(&weakLifetime, revived, 1);
+    EXPECT_EQ(1U, revivedSet.count());
+    EXPECT_NE(nullptr, revived[0].get());
+}
+
 TEST(RefBase, Comparisons) {
     bool isDeleted, isDeleted2, isDeleted3;
     Foo* foo = new Foo(&isDeleted);
@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <utils/JenkinsHash.h>
+#include <utils/ShardedLruCache.h>
+
+namespace {
+
+typedef int SimpleKey;
+typedef const char* StringValue;
+
+}  // namespace
+
+namespace android {
+
+typedef ShardedLruCache<SimpleKey, StringValue> SimpleShardedCache;
+
+class EntryRemovedCounter : public OnEntryRemoved<SimpleKey, StringValue> {
+public:
+    void operator()(SimpleKey& /* key */, StringValue& /* value */) override {
+        removedCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::atomic<size_t> removedCount{0};
+};
+
+class ShardedLruCacheTest : public testing::Test {
+protected:
+    virtual void SetUp() {
+    }
+
+    virtual void TearDown() {
+    }
+};
+
+TEST_F(ShardedLruCacheTest, Empty) {
+    SimpleShardedCache cache(100);
+
+    StringValue value;
+    EXPECT_FALSE(cache.get(0, &value));
+    EXPECT_EQ(0u, cache.size());
+}
+
+TEST_F(ShardedLruCacheTest, Simple) {
+    SimpleShardedCache cache(100);
+
+    cache.put(1, "one");
+    cache.put(2, "two");
+    cache.put(3, "three");
+
+    StringValue value = nullptr;
+    ASSERT_TRUE(cache.get(2, &value));
+    EXPECT_STREQ("two", value);
+    ASSERT_TRUE(cache.get(1, &value));
+    EXPECT_STREQ("one", value);
+    ASSERT_TRUE(cache.get(3, &value));
+    EXPECT_STREQ("three", value);
+    EXPECT_EQ(3u, cache.size());
+}
+
+TEST_F(ShardedLruCacheTest, RemoveSucceeds) {
+    SimpleShardedCache cache(100);
+    cache.put(1, "one");
+
+    EXPECT_TRUE(cache.remove(1));
+
+    StringValue value;
+    EXPECT_EQ(0u, cache.size());
+    EXPECT_FALSE(cache.get(1, &value));
+}
+
+TEST_F(ShardedLruCacheTest, DoesntRemoveMissingKey) {
+    SimpleShardedCache cache(100);
+    cache.put(1, "one");
+
+    EXPECT_FALSE(cache.remove(2));
+    EXPECT_EQ(1u, cache.size());
+}
+
+TEST_F(ShardedLruCacheTest, SingleShardEvictsLeastRecentlyUsed) {
+    SimpleShardedCache cache(2, 1);
+    ASSERT_EQ(1u, cache.shardCount());
+
+    cache.put(1, "one");
+    cache.put(2, "two");
+
+    // Touch 1 so that 2 becomes the eviction candidate.
+    StringValue value;
+    ASSERT_TRUE(cache.get(1, &value));
+    cache.put(3, "three");
+
+    EXPECT_FALSE(cache.get(2, &value));
+    EXPECT_TRUE(cache.get(1, &value));
+    EXPECT_TRUE(cache.get(3, &value));
+}
+
+TEST_F(ShardedLruCacheTest, ShardCountRoundsUpToPowerOfTwo) {
+    SimpleShardedCache cache(100, 5);
+    EXPECT_EQ(8u, cache.shardCount());
+}
+
+TEST_F(ShardedLruCacheTest, EvictionKeepsSizeBounded) {
+    const uint32_t maxCapacity = 64;
+    SimpleShardedCache cache(maxCapacity);
+
+    for (int i = 0; i < 1000; i++) {
+        cache.put(i, "value");
+    }
+
+    // Each shard holds at most ceil(maxCapacity / shardCount) entries.
+    uint32_t shardCapacity = (maxCapacity + cache.shardCount() - 1) / cache.shardCount();
+    EXPECT_LE(cache.size(), shardCapacity * cache.shardCount());
+    EXPECT_GT(cache.size(), 0u);
+}
+
+TEST_F(ShardedLruCacheTest, ClearInvokesListenerForAllEntries) {
+    SimpleShardedCache cache(SimpleShardedCache::kUnlimitedCapacity);
+    EntryRemovedCounter counter;
+    cache.setOnEntryRemovedListener(&counter);
+
+    for (int i = 0; i < 100; i++) {
+        cache.put(i, "value");
+    }
+    cache.clear();
+
+    EXPECT_EQ(100u, counter.removedCount.load());
+    EXPECT_EQ(0u, cache.size());
+}
+
+TEST_F(ShardedLruCacheTest, ConcurrentPutGetRemove) {
+    const int kThreads = 4;
+    const int kIterations = 5000;
+    SimpleShardedCache cache(256);
+    EntryRemovedCounter counter;
+    cache.setOnEntryRemovedListener(&counter);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; t++) {
+        threads.emplace_back([&cache, t] {
+            StringValue value;
+            for (int i = 0; i < kIterations; i++) {
+                int key = t * kIterations + i;
+                cache.put(key, "value");
+                cache.get(key, &value);
+                if ((i % 3) == 0) {
+                    cache.remove(key);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    size_t remaining = cache.size();
+    cache.clear();
+
+    // Every insertion was either explicitly removed, evicted, or cleared, and
+    // the listener saw each of them exactly once.
+    EXPECT_EQ(static_cast<size_t>(kThreads) * kIterations, counter.removedCount.load());
+    EXPECT_EQ(0u, cache.size());
+    EXPECT_LE(remaining, 256u + cache.shardCount());
+}
+
+}  // namespace android
@@ -27,6 +27,51 @@
 
 namespace android {
 
+/*
+ * Vector growth and String edits churn through many small SharedBuffers, so
+ * allocations up to kMaxPooledSize bytes are rounded up to a power-of-two
+ * size class and recycled through per-thread freelists instead of going back
+ * to malloc.  Retention is bounded: each class caches at most
+ * kMaxCachedPerClass chunks, and whatever a thread still holds is returned
+ * to malloc when the thread exits.
+ */
+static constexpr size_t kMinPooledSize = 8;
+static constexpr size_t kMaxPooledSize = 256;
+static constexpr size_t kNumPoolClasses = 6;  // 8, 16, 32, 64, 128, 256
+static constexpr size_t kMaxCachedPerClass = 8;
+
+namespace {
+struct BufferPool {
+    void* head[kNumPoolClasses] = {};
+    size_t count[kNumPoolClasses] = {};
+
+    ~BufferPool() {
+        for (size_t i = 0; i < kNumPoolClasses; i++) {
+            void* chunk = head[i];
+            while (chunk != nullptr) {
+                void* next = *static_cast<void**>(chunk);
+                free(chunk);
+                chunk = next;
+            }
+        }
+    }
+};
+}  // anonymous namespace
+
+static thread_local BufferPool gBufferPool;
+
+/* Returns the tag stored in mReserved for a pooled capacity (class index
+ * plus one), or 0 when 'capacity' is not a pooled size class. */
+static uint32_t poolClassFor(size_t capacity) {
+    if (capacity < kMinPooledSize || capacity > kMaxPooledSize) return 0;
+    if ((capacity & (capacity - 1)) != 0) return 0;
+    return static_cast<uint32_t>(__builtin_ctzl(capacity >> 3)) + 1;
+}
+
+static size_t pooledCapacity(uint32_t poolClass) {
+    return kMinPooledSize << (poolClass - 1);
+}
+
 SharedBuffer* SharedBuffer::alloc(size_t size)
 {
     // Don't overflow if the combined size of the buffer / header is larger than
@@ -34,13 +79,29 @@ SharedBuffer* SharedBuffer::alloc(size_t size)
     LOG_ALWAYS_FATAL_IF((size >= (SIZE_MAX - sizeof(SharedBuffer))),
                         "Invalid buffer size %zu", size);
 
-    SharedBuffer* sb = static_cast<SharedBuffer *>(malloc(sizeof(SharedBuffer) + size));
+    size_t capacity = size;
+    if (size <= kMaxPooledSize) {
+        capacity = kMinPooledSize;
+        while (capacity < size) capacity <<= 1;
+    }
+    const uint32_t poolClass = poolClassFor(capacity);
+
+    SharedBuffer* sb;
+    if (poolClass != 0 && gBufferPool.head[poolClass - 1] != nullptr) {
+        void* chunk = gBufferPool.head[poolClass - 1];
+        gBufferPool.head[poolClass - 1] = *static_cast<void**>(chunk);
+        gBufferPool.count[poolClass - 1]--;
+        sb = static_cast<SharedBuffer*>(chunk);
+    } else {
+        sb = static_cast<SharedBuffer*>(malloc(sizeof(SharedBuffer) + capacity));
+    }
     if (sb) {
         // Should be std::atomic_init(&sb->mRefs, 1);
         // But that generates a warning with some compilers.
         // The following is OK on Android-supported platforms.
         sb->mRefs.store(1, std::memory_order_relaxed);
         sb->mSize = size;
+        sb->mReserved = poolClass;
         sb->mClientMetadata = 0;
     }
     return sb;
@@ -49,7 +110,16 @@ SharedBuffer* SharedBuffer::alloc(size_t size)
 
 void SharedBuffer::dealloc(const SharedBuffer* released)
 {
-    free(const_cast<SharedBuffer*>(released));
+    SharedBuffer* sb = const_cast<SharedBuffer*>(released);
+    const uint32_t poolClass = sb->mReserved;
+    if (poolClass != 0 && gBufferPool.count[poolClass - 1] < kMaxCachedPerClass) {
+        // The chunk is dead, so its head doubles as the freelist link.
+        *reinterpret_cast<void**>(sb) = gBufferPool.head[poolClass - 1];
+        gBufferPool.head[poolClass - 1] = sb;
+        gBufferPool.count[poolClass - 1]++;
+        return;
+    }
+    free(sb);
 }
 
 SharedBuffer* SharedBuffer::edit() const
@@ -75,9 +145,15 @@ SharedBuffer* SharedBuffer::editResize(size_t newSize) const
         LOG_ALWAYS_FATAL_IF((newSize >= (SIZE_MAX - sizeof(SharedBuffer))),
                             "Invalid buffer size %zu", newSize);
 
+        if (buf->mReserved != 0 && newSize <= pooledCapacity(buf->mReserved)) {
+            // The pooled chunk already has room.
+            buf->mSize = newSize;
+            return buf;
+        }
         buf = (SharedBuffer*)realloc(buf, sizeof(SharedBuffer) + newSize);
         if (buf != nullptr) {
             buf->mSize = newSize;
+            buf->mReserved = poolClassFor(newSize);
             return buf;
         }
     }
@@ -102,6 +102,8 @@ private:
         // Must be sized to preserve correct alignment.
         mutable std::atomic<int32_t>        mRefs;
                 size_t                      mSize;
+        // Pool size class tag when the allocation came from the small-buffer
+        // freelist (see SharedBuffer.cpp), 0 otherwise.
                 uint32_t                    mReserved;
 public:
         // mClientMetadata is reserved for client use.  It is initialized to 0
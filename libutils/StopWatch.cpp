@@ -30,7 +30,12 @@
 
 namespace android {
 
-StopWatch::StopWatch(const char* name, int clock) : mName(name), mClock(clock) {
+StopWatch::StopWatch(const char* name, int clock) : mName(name), mClock(clock), mBatch(nullptr) {
+    reset();
+}
+
+StopWatch::StopWatch(const char* name, TimestampBatch& batch)
+    : mName(name), mClock(batch.clock()), mBatch(&batch) {
     reset();
 }
 
@@ -67,13 +72,18 @@ nsecs_t StopWatch::lap()
 
 nsecs_t StopWatch::elapsedTime() const
 {
-    return systemTime(mClock) - mStartTime;
+    return now() - mStartTime;
 }
 
 void StopWatch::reset()
 {
     mNumLaps = 0;
-    mStartTime = systemTime(mClock);
+    mStartTime = now();
+}
+
+nsecs_t StopWatch::now() const
+{
+    return mBatch ? mBatch->timestamp() : systemTime(mClock);
 }
 
 
@@ -93,7 +93,11 @@ String16::String16()
 String16::String16(const String16& o)
     : mString(o.mString)
 {
-    acquire();
+    if (mString != nullptr) {
+        acquire();
+    } else {
+        memcpy(mData, o.mData, sizeof(mData));
+    }
 }
 
 String16::String16(const String16& o, size_t len, size_t begin)
@@ -102,23 +106,34 @@ String16::String16(const String16& o, size_t len, size_t begin)
     setTo(o, len, begin);
 }
 
-String16::String16(const char16_t* o) : mString(allocFromUTF16(o, strlen16(o))) {}
+String16::String16(const char16_t* o)
+    : mString(getEmptyString())
+{
+    setTo(o, strlen16(o));
+}
 
-String16::String16(const char16_t* o, size_t len) : mString(allocFromUTF16(o, len)) {}
+String16::String16(const char16_t* o, size_t len)
+    : mString(getEmptyString())
+{
+    setTo(o, len);
+}
 
 String16::String16(const String8& o)
-    : mString(allocFromUTF8(o.string(), o.size()))
+    : mString(getEmptyString())
 {
+    setFromUTF8(o.string(), o.size());
 }
 
 String16::String16(const char* o)
-    : mString(allocFromUTF8(o, strlen(o)))
+    : mString(getEmptyString())
 {
+    setFromUTF8(o, strlen(o));
 }
 
 String16::String16(const char* o, size_t len)
-    : mString(allocFromUTF8(o, len))
+    : mString(getEmptyString())
 {
+    setFromUTF8(o, len);
 }
 
 String16::~String16()
@@ -128,7 +143,9 @@ String16::~String16()
 
 size_t String16::size() const
 {
-    if (isStaticString()) {
+    if (mString == nullptr) {
+        return strlen16(mData);
+    } else if (isStaticString()) {
         return staticStringSize();
     } else {
         return SharedBuffer::sizeFromData(mString) / sizeof(char16_t) - 1;
@@ -137,9 +154,14 @@ size_t String16::size() const
 
 void String16::setTo(const String16& other)
 {
+    if (&other == this) return;
     release();
     mString = other.mString;
-    acquire();
+    if (mString != nullptr) {
+        acquire();
+    } else {
+        memcpy(mData, other.mData, sizeof(mData));
+    }
 }
 
 status_t String16::setTo(const String16& other, size_t len, size_t begin)
@@ -175,6 +197,17 @@ status_t String16::setTo(const char16_t* other, size_t len)
         abort();
     }
 
+    /* Strings with embedded NULs cannot be stored inline because the inline
+     * length is derived from the terminator. */
+    if (len != 0 && len < kSSOBufSize && strnlen16(other, len) == len) {
+        /* Copy before releasing: 'other' may point into the current storage. */
+        memmove(mData, other, len*sizeof(char16_t));
+        mData[len] = 0;
+        release();
+        mString = nullptr;
+        return OK;
+    }
+
     SharedBuffer* buf = static_cast<SharedBuffer*>(editResize((len + 1) * sizeof(char16_t)));
     if (buf) {
         char16_t* str = (char16_t*)buf->data();
@@ -186,6 +219,33 @@ status_t String16::setTo(const char16_t* other, size_t len)
     return NO_MEMORY;
 }
 
+status_t String16::setFromUTF8(const char* u8str, size_t u8len)
+{
+    const uint8_t* u8cur = (const uint8_t*) u8str;
+    const ssize_t u16len = u8len == 0 ? 0 : utf8_to_utf16_length(u8cur, u8len);
+    if (u16len <= 0) {
+        release();
+        mString = getEmptyString();
+        return OK;
+    }
+
+    if (static_cast<size_t>(u16len) < kSSOBufSize) {
+        char16_t tmp[kSSOBufSize];
+        utf8_to_utf16(u8cur, u8len, tmp, static_cast<size_t>(u16len) + 1);
+        if (strnlen16(tmp, u16len) == static_cast<size_t>(u16len)) {
+            release();
+            mString = nullptr;
+            memcpy(mData, tmp, (static_cast<size_t>(u16len) + 1) * sizeof(char16_t));
+            return OK;
+        }
+    }
+
+    char16_t* str = allocFromUTF8(u8str, u8len);
+    release();
+    mString = str;
+    return OK;
+}
+
 status_t String16::append(const String16& other)
 {
     const size_t myLen = size();
@@ -202,6 +262,13 @@ status_t String16::append(const String16& other)
         abort();
     }
 
+    if (mString == nullptr && myLen + otherLen < kSSOBufSize &&
+            strnlen16(other.string(), otherLen) == otherLen) {
+        /* memmove: 'other' may be this string. */
+        memmove(mData + myLen, other.string(), (otherLen+1)*sizeof(char16_t));
+        return OK;
+    }
+
     SharedBuffer* buf =
             static_cast<SharedBuffer*>(editResize((myLen + otherLen + 1) * sizeof(char16_t)));
     if (buf) {
@@ -228,6 +295,14 @@ status_t String16::append(const char16_t* chrs, size_t otherLen)
         abort();
     }
 
+    if (mString == nullptr && myLen + otherLen < kSSOBufSize &&
+            strnlen16(chrs, otherLen) == otherLen) {
+        /* memmove: 'chrs' may point into the current storage. */
+        memmove(mData + myLen, chrs, otherLen*sizeof(char16_t));
+        mData[myLen+otherLen] = 0;
+        return OK;
+    }
+
     SharedBuffer* buf =
             static_cast<SharedBuffer*>(editResize((myLen + otherLen + 1) * sizeof(char16_t)));
     if (buf) {
@@ -313,24 +388,30 @@ bool String16::startsWith(const String16& prefix) const
 {
     const size_t ps = prefix.size();
     if (ps > size()) return false;
-    return strzcmp16(mString, ps, prefix.string(), ps) == 0;
+    return strzcmp16(string(), ps, prefix.string(), ps) == 0;
 }
 
 bool String16::startsWith(const char16_t* prefix) const
 {
     const size_t ps = strlen16(prefix);
     if (ps > size()) return false;
-    return strncmp16(mString, prefix, ps) == 0;
+    return strncmp16(string(), prefix, ps) == 0;
 }
 
 bool String16::contains(const char16_t* chrs) const
 {
-    return strstr16(mString, chrs) != nullptr;
+    return strstr16(string(), chrs) != nullptr;
 }
 
 void* String16::edit() {
     SharedBuffer* buf;
-    if (isStaticString()) {
+    if (mString == nullptr) {
+        const size_t copySize = (strlen16(mData) + 1) * sizeof(char16_t);
+        buf = static_cast<SharedBuffer*>(alloc(copySize));
+        if (buf) {
+            memcpy(buf->data(), mData, copySize);
+        }
+    } else if (isStaticString()) {
         buf = static_cast<SharedBuffer*>(alloc((size() + 1) * sizeof(char16_t)));
         if (buf) {
             memcpy(buf->data(), mString, (size() + 1) * sizeof(char16_t));
@@ -344,7 +425,16 @@ void* String16::edit() {
 
 void* String16::editResize(size_t newSize) {
     SharedBuffer* buf;
-    if (isStaticString()) {
+    if (mString == nullptr) {
+        size_t copySize = (strlen16(mData) + 1) * sizeof(char16_t);
+        if (newSize < copySize) {
+            copySize = newSize;
+        }
+        buf = static_cast<SharedBuffer*>(alloc(newSize));
+        if (buf) {
+            memcpy(buf->data(), mData, copySize);
+        }
+    } else if (isStaticString()) {
         size_t copySize = (size() + 1) * sizeof(char16_t);
         if (newSize < copySize) {
             copySize = newSize;
@@ -362,19 +452,21 @@ void* String16::editResize(size_t newSize) {
 
 void String16::acquire()
 {
-    if (!isStaticString()) {
+    if (mString != nullptr && !isStaticString()) {
         SharedBuffer::bufferFromData(mString)->acquire();
     }
 }
 
 void String16::release()
 {
-    if (!isStaticString()) {
+    if (mString != nullptr && !isStaticString()) {
         SharedBuffer::bufferFromData(mString)->release();
     }
 }
 
 bool String16::isStaticString() const {
+    // Inline strings have no out-of-line storage at all.
+    if (mString == nullptr) return false;
     // See String16.h for notes on the memory layout of String16::StaticData and
     // SharedBuffer.
     static_assert(sizeof(SharedBuffer) - offsetof(SharedBuffer, mClientMetadata) == 4);
@@ -399,12 +491,17 @@ status_t String16::makeLower()
         const char16_t v = str[i];
         if (v >= 'A' && v <= 'Z') {
             if (!edited) {
-                SharedBuffer* buf = static_cast<SharedBuffer*>(edit());
-                if (!buf) {
-                    return NO_MEMORY;
+                if (mString == nullptr) {
+                    /* Inline storage is uniquely owned; edit it in place. */
+                    edited = mData;
+                } else {
+                    SharedBuffer* buf = static_cast<SharedBuffer*>(edit());
+                    if (!buf) {
+                        return NO_MEMORY;
+                    }
+                    edited = (char16_t*)buf->data();
+                    mString = str = edited;
                 }
-                edited = (char16_t*)buf->data();
-                mString = str = edited;
             }
             edited[i] = tolower((char)v);
         }
@@ -420,12 +517,17 @@ status_t String16::replaceAll(char16_t replaceThis, char16_t withThis)
     for (size_t i=0; i<N; i++) {
         if (str[i] == replaceThis) {
             if (!edited) {
-                SharedBuffer* buf = static_cast<SharedBuffer*>(edit());
-                if (!buf) {
-                    return NO_MEMORY;
+                if (mString == nullptr) {
+                    /* Inline storage is uniquely owned; edit it in place. */
+                    edited = mData;
+                } else {
+                    SharedBuffer* buf = static_cast<SharedBuffer*>(edit());
+                    if (!buf) {
+                        return NO_MEMORY;
+                    }
+                    edited = (char16_t*)buf->data();
+                    mString = str = edited;
                 }
-                edited = (char16_t*)buf->data();
-                mString = str = edited;
             }
             edited[i] = withThis;
         }
@@ -446,6 +548,12 @@ status_t String16::remove(size_t len, size_t begin)
         return OK;
     }
 
+    if (mString == nullptr) {
+        memmove(mData, mData+begin, len*sizeof(char16_t));
+        mData[len] = 0;
+        return OK;
+    }
+
     if (begin > 0) {
         SharedBuffer* buf = static_cast<SharedBuffer*>(editResize((N + 1) * sizeof(char16_t)));
         if (!buf) {
@@ -40,146 +40,86 @@ namespace android {
 // to OS_PATH_SEPARATOR.
 #define RES_PATH_SEPARATOR '/'
 
-static inline char* getEmptyString() {
-    static SharedBuffer* gEmptyStringBuf = [] {
-        SharedBuffer* buf = SharedBuffer::alloc(1);
-        char* str = static_cast<char*>(buf->data());
-        *str = 0;
-        return buf;
-    }();
-
-    gEmptyStringBuf->acquire();
-    return static_cast<char*>(gEmptyStringBuf->data());
-}
-
-// ---------------------------------------------------------------------------
-
-static char* allocFromUTF8(const char* in, size_t len)
-{
-    if (len > 0) {
-        if (len == SIZE_MAX) {
-            return nullptr;
-        }
-        SharedBuffer* buf = SharedBuffer::alloc(len+1);
-        ALOG_ASSERT(buf, "Unable to allocate shared buffer");
-        if (buf) {
-            char* str = (char*)buf->data();
-            memcpy(str, in, len);
-            str[len] = 0;
-            return str;
-        }
-        return nullptr;
-    }
-
-    return getEmptyString();
-}
-
-static char* allocFromUTF16(const char16_t* in, size_t len)
-{
-    if (len == 0) return getEmptyString();
-
-     // Allow for closing '\0'
-    const ssize_t resultStrLen = utf16_to_utf8_length(in, len) + 1;
-    if (resultStrLen < 1) {
-        return getEmptyString();
-    }
-
-    SharedBuffer* buf = SharedBuffer::alloc(resultStrLen);
-    ALOG_ASSERT(buf, "Unable to allocate shared buffer");
-    if (!buf) {
-        return getEmptyString();
-    }
-
-    char* resultStr = (char*)buf->data();
-    utf16_to_utf8(in, len, resultStr, resultStrLen);
-    return resultStr;
-}
-
-static char* allocFromUTF32(const char32_t* in, size_t len)
-{
-    if (len == 0) {
-        return getEmptyString();
-    }
-
-    const ssize_t resultStrLen = utf32_to_utf8_length(in, len) + 1;
-    if (resultStrLen < 1) {
-        return getEmptyString();
-    }
-
-    SharedBuffer* buf = SharedBuffer::alloc(resultStrLen);
-    ALOG_ASSERT(buf, "Unable to allocate shared buffer");
-    if (!buf) {
-        return getEmptyString();
-    }
-
-    char* resultStr = (char*) buf->data();
-    utf32_to_utf8(in, len, resultStr, resultStrLen);
-
-    return resultStr;
-}
-
-// ---------------------------------------------------------------------------
-
 String8::String8()
-    : mString(getEmptyString())
+    : mString(nullptr)
 {
+    mData[0] = 0;
 }
 
 String8::String8(const String8& o)
     : mString(o.mString)
 {
-    SharedBuffer::bufferFromData(mString)->acquire();
+    if (mString) {
+        SharedBuffer::bufferFromData(mString)->acquire();
+    } else {
+        memcpy(mData, o.mData, kSSOBufSize);
+    }
 }
 
 String8::String8(const char* o)
-    : mString(allocFromUTF8(o, strlen(o)))
+    : mString(nullptr)
 {
-    if (mString == nullptr) {
-        mString = getEmptyString();
-    }
+    mData[0] = 0;
+    setInternal(o, strlen(o));
 }
 
 String8::String8(const char* o, size_t len)
-    : mString(allocFromUTF8(o, len))
+    : mString(nullptr)
 {
-    if (mString == nullptr) {
-        mString = getEmptyString();
-    }
+    mData[0] = 0;
+    setInternal(o, len);
 }
 
 String8::String8(const String16& o)
-    : mString(allocFromUTF16(o.string(), o.size()))
+    : mString(nullptr)
 {
+    mData[0] = 0;
+    setFromUTF16(o.string(), o.size());
 }
 
 String8::String8(const char16_t* o)
-    : mString(allocFromUTF16(o, strlen16(o)))
+    : mString(nullptr)
 {
+    mData[0] = 0;
+    setFromUTF16(o, strlen16(o));
 }
 
 String8::String8(const char16_t* o, size_t len)
-    : mString(allocFromUTF16(o, len))
+    : mString(nullptr)
 {
+    mData[0] = 0;
+    setFromUTF16(o, len);
 }
 
 String8::String8(const char32_t* o)
-    : mString(allocFromUTF32(o, strlen32(o)))
+    : mString(nullptr)
 {
+    mData[0] = 0;
+    setFromUTF32(o, strlen32(o));
 }
 
 String8::String8(const char32_t* o, size_t len)
-    : mString(allocFromUTF32(o, len))
+    : mString(nullptr)
 {
+    mData[0] = 0;
+    setFromUTF32(o, len);
 }
 
 String8::~String8()
 {
-    SharedBuffer::bufferFromData(mString)->release();
+    releaseStorage();
+}
+
+void String8::releaseStorage()
+{
+    if (mString) {
+        SharedBuffer::bufferFromData(mString)->release();
+    }
 }
 
 size_t String8::length() const
 {
-    return SharedBuffer::sizeFromData(mString)-1;
+    return mString ? SharedBuffer::sizeFromData(mString)-1 : strlen(mData);
 }
 
 String8 String8::format(const char* fmt, ...)
@@ -201,59 +141,148 @@ String8 String8::formatV(const char* fmt, va_list args)
 }
 
 void String8::clear() {
-    SharedBuffer::bufferFromData(mString)->release();
-    mString = getEmptyString();
+    releaseStorage();
+    mString = nullptr;
+    mData[0] = 0;
 }
 
 void String8::setTo(const String8& other)
 {
-    SharedBuffer::bufferFromData(other.mString)->acquire();
-    SharedBuffer::bufferFromData(mString)->release();
-    mString = other.mString;
+    if (&other == this) return;
+
+    if (other.mString) {
+        SharedBuffer::bufferFromData(other.mString)->acquire();
+        releaseStorage();
+        mString = other.mString;
+    } else {
+        releaseStorage();
+        mString = nullptr;
+        memcpy(mData, other.mData, kSSOBufSize);
+    }
 }
 
 status_t String8::setTo(const char* other)
 {
-    const char *newString = allocFromUTF8(other, strlen(other));
-    SharedBuffer::bufferFromData(mString)->release();
-    mString = newString;
-    if (mString) return OK;
-
-    mString = getEmptyString();
-    return NO_MEMORY;
+    return setInternal(other, strlen(other));
 }
 
 status_t String8::setTo(const char* other, size_t len)
 {
-    const char *newString = allocFromUTF8(other, len);
-    SharedBuffer::bufferFromData(mString)->release();
-    mString = newString;
-    if (mString) return OK;
-
-    mString = getEmptyString();
-    return NO_MEMORY;
+    return setInternal(other, len);
 }
 
 status_t String8::setTo(const char16_t* other, size_t len)
 {
-    const char *newString = allocFromUTF16(other, len);
-    SharedBuffer::bufferFromData(mString)->release();
-    mString = newString;
-    if (mString) return OK;
-
-    mString = getEmptyString();
-    return NO_MEMORY;
+    return setFromUTF16(other, len);
 }
 
 status_t String8::setTo(const char32_t* other, size_t len)
 {
-    const char *newString = allocFromUTF32(other, len);
-    SharedBuffer::bufferFromData(mString)->release();
-    mString = newString;
-    if (mString) return OK;
+    return setFromUTF32(other, len);
+}
 
-    mString = getEmptyString();
-    return NO_MEMORY;
+status_t String8::setInternal(const char* other, size_t numChars)
+{
+    if (numChars < kSSOBufSize) {
+        // Copy before releasing: 'other' may point into the current storage.
+        memmove(mData, other, numChars);
+        mData[numChars] = 0;
+        releaseStorage();
+        mString = nullptr;
+        return OK;
+    }
+
+    if (numChars == SIZE_MAX) {
+        clear();
+        return NO_MEMORY;
+    }
+
+    SharedBuffer* buf = SharedBuffer::alloc(numChars+1);
+    ALOG_ASSERT(buf, "Unable to allocate shared buffer");
+    if (!buf) {
+        clear();
+        return NO_MEMORY;
+    }
+
+    char* str = (char*)buf->data();
+    memcpy(str, other, numChars);
+    str[numChars] = 0;
+    releaseStorage();
+    mString = str;
+    return OK;
+}
+
+status_t String8::setFromUTF16(const char16_t* other, size_t numChars)
+{
+    if (numChars == 0) {
+        clear();
+        return OK;
+    }
+
+    // Allow for closing '\0'
+    const ssize_t resultStrLen = utf16_to_utf8_length(other, numChars) + 1;
+    if (resultStrLen < 1) {
+        clear();
+        return OK;
+    }
+
+    if ((size_t)resultStrLen <= kSSOBufSize) {
+        char tmp[kSSOBufSize];
+        utf16_to_utf8(other, numChars, tmp, resultStrLen);
+        releaseStorage();
+        mString = nullptr;
+        memcpy(mData, tmp, resultStrLen);
+        return OK;
+    }
+
+    SharedBuffer* buf = SharedBuffer::alloc(resultStrLen);
+    ALOG_ASSERT(buf, "Unable to allocate shared buffer");
+    if (!buf) {
+        clear();
+        return NO_MEMORY;
+    }
+
+    char* str = (char*)buf->data();
+    utf16_to_utf8(other, numChars, str, resultStrLen);
+    releaseStorage();
+    mString = str;
+    return OK;
+}
+
+status_t String8::setFromUTF32(const char32_t* other, size_t numChars)
+{
+    if (numChars == 0) {
+        clear();
+        return OK;
+    }
+
+    const ssize_t resultStrLen = utf32_to_utf8_length(other, numChars) + 1;
+    if (resultStrLen < 1) {
+        clear();
+        return OK;
+    }
+
+    if ((size_t)resultStrLen <= kSSOBufSize) {
+        char tmp[kSSOBufSize];
+        utf32_to_utf8(other, numChars, tmp, resultStrLen);
+        releaseStorage();
+        mString = nullptr;
+        memcpy(mData, tmp, resultStrLen);
+        return OK;
+    }
+
+    SharedBuffer* buf = SharedBuffer::alloc(resultStrLen);
+    ALOG_ASSERT(buf, "Unable to allocate shared buffer");
+    if (!buf) {
+        clear();
+        return NO_MEMORY;
+    }
+
+    char* str = (char*)buf->data();
+    utf32_to_utf8(other, numChars, str, resultStrLen);
+    releaseStorage();
+    mString = str;
+    return OK;
 }
 
 status_t String8::append(const String8& other)
@@ -331,6 +360,25 @@ status_t String8::real_append(const char* other, size_t otherLen)
 {
     const size_t myLen = bytes();
 
+    if (!mString) {
+        if (myLen + otherLen < kSSOBufSize) {
+            memcpy(mData + myLen, other, otherLen);
+            mData[myLen + otherLen] = '\0';
+            return OK;
+        }
+
+        SharedBuffer* buf = SharedBuffer::alloc(myLen+otherLen+1);
+        if (!buf) {
+            return NO_MEMORY;
+        }
+        char* str = (char*)buf->data();
+        memcpy(str, mData, myLen);
+        memcpy(str + myLen, other, otherLen);
+        str[myLen + otherLen] = '\0';
+        mString = str;
+        return OK;
+    }
+
     SharedBuffer* buf = SharedBuffer::bufferFromData(mString)
         ->editResize(myLen+otherLen+1);
     if (buf) {
@@ -346,6 +394,22 @@ status_t String8::real_append(const char* other, size_t otherLen)
 
 char* String8::lockBuffer(size_t size)
 {
+    if (!mString) {
+        if (size < kSSOBufSize) {
+            return mData;
+        }
+
+        // Promote to a SharedBuffer, preserving the current contents.
+        SharedBuffer* buf = SharedBuffer::alloc(size+1);
+        if (!buf) {
+            return nullptr;
+        }
+        char* str = (char*)buf->data();
+        memcpy(str, mData, kSSOBufSize);
+        mString = str;
+        return str;
+    }
+
     SharedBuffer* buf = SharedBuffer::bufferFromData(mString)
         ->editResize(size+1);
     if (buf) {
@@ -358,12 +422,20 @@ char* String8::lockBuffer(size_t size)
 
 void String8::unlockBuffer()
 {
-    unlockBuffer(strlen(mString));
+    unlockBuffer(strlen(c_str()));
 }
 
 status_t String8::unlockBuffer(size_t size)
 {
     if (size != this->size()) {
+        if (!mString) {
+            if (size >= kSSOBufSize) {
+                return NO_MEMORY;
+            }
+            mData[size] = 0;
+            return OK;
+        }
+
         SharedBuffer* buf = SharedBuffer::bufferFromData(mString)
             ->editResize(size+1);
         if (! buf) {
@@ -384,9 +456,10 @@ ssize_t String8::find(const char* other, size_t start) const
     if (start >= len) {
         return -1;
     }
-    const char* s = mString+start;
+    const char* str = c_str();
+    const char* s = str+start;
     const char* p = strstr(s, other);
-    return p ? p-mString : -1;
+    return p ? p-str : -1;
 }
 
 bool String8::removeAll(const char* other) {
@@ -487,7 +560,7 @@ void String8::setPathName(const char* name, size_t len)
 String8 String8::getPathLeaf(void) const
 {
     const char* cp;
-    const char*const buf = mString;
+    const char*const buf = c_str();
 
     cp = strrchr(buf, OS_PATH_SEPARATOR);
     if (cp == nullptr)
@@ -499,7 +572,7 @@ String8 String8::getPathLeaf(void) const
 String8 String8::getPathDir(void) const
 {
     const char* cp;
-    const char*const str = mString;
+    const char*const str = c_str();
 
     cp = strrchr(str, OS_PATH_SEPARATOR);
     if (cp == nullptr)
@@ -511,7 +584,7 @@ String8 String8::getPathDir(void) const
 String8 String8::walkPath(String8* outRemains) const
 {
     const char* cp;
-    const char*const str = mString;
+    const char*const str = c_str();
     const char* buf = str;
 
     cp = strchr(buf, OS_PATH_SEPARATOR);
@@ -541,7 +614,7 @@ char* String8::find_extension(void) const
 {
     const char* lastSlash;
     const char* lastDot;
-    const char* const str = mString;
+    const char* const str = c_str();
 
     // only look at the filename
     lastSlash = strrchr(str, OS_PATH_SEPARATOR);
@@ -573,7 +646,7 @@ String8 String8::getPathExtension(void) const
 String8 String8::getBasePath(void) const
 {
     char* ext;
-    const char* const str = mString;
+    const char* const str = c_str();
 
     ext = find_extension();
     if (ext == nullptr)
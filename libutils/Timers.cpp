@@ -23,6 +23,8 @@
 #include <stdlib.h>
 #include <time.h>
 
+#include <atomic>
+
 #include <android-base/macros.h>
 
 static constexpr size_t clock_id_max = 5;
@@ -42,6 +44,18 @@ nsecs_t systemTime(int clock) {
     clock_gettime(clocks[clock], &t);
     return nsecs_t(t.tv_sec)*1000000000LL + t.tv_nsec;
 }
+nsecs_t systemTimeCoarse(int clock) {
+    checkClockId(clock);
+    // Only the realtime and monotonic clocks have coarse variants; the
+    // others take the precise read.
+    static constexpr clockid_t clocks[] = {CLOCK_REALTIME_COARSE, CLOCK_MONOTONIC_COARSE,
+                                           CLOCK_PROCESS_CPUTIME_ID, CLOCK_THREAD_CPUTIME_ID,
+                                           CLOCK_BOOTTIME};
+    static_assert(clock_id_max == arraysize(clocks));
+    timespec t = {};
+    clock_gettime(clocks[clock], &t);
+    return nsecs_t(t.tv_sec)*1000000000LL + t.tv_nsec;
+}
 #else
 nsecs_t systemTime(int clock) {
     // TODO: is this ever called with anything but REALTIME on mac/windows?
@@ -54,8 +68,26 @@ nsecs_t systemTime(int clock) {
     gettimeofday(&t, nullptr);
     return nsecs_t(t.tv_sec)*1000000000LL + nsecs_t(t.tv_usec)*1000LL;
 }
+
+nsecs_t systemTimeCoarse(int clock) {
+    // No coarse clocks on mac/windows.
+    return systemTime(clock);
+}
 #endif
 
+// Written by systemTimeCacheRefresh(), read by systemTimeCached().
+static std::atomic<nsecs_t> gCachedCoarseTime(0);
+
+nsecs_t systemTimeCached(void) {
+    return gCachedCoarseTime.load(std::memory_order_relaxed);
+}
+
+nsecs_t systemTimeCacheRefresh(void) {
+    nsecs_t now = systemTimeCoarse(SYSTEM_TIME_MONOTONIC);
+    gCachedCoarseTime.store(now, std::memory_order_relaxed);
+    return now;
+}
+
 int toMillisecondTimeoutDelay(nsecs_t referenceTime, nsecs_t timeoutTime)
 {
     nsecs_t timeoutDelayMillis;
@@ -27,3 +27,38 @@ TEST(Timers, systemTime_invalid) {
     systemTime(SYSTEM_TIME_BOOTTIME);
     EXPECT_EXIT(systemTime(SYSTEM_TIME_BOOTTIME + 1), testing::KilledBySignal(SIGABRT), "");
 }
+
+TEST(Timers, systemTimeCoarse) {
+    EXPECT_EXIT(systemTimeCoarse(-1), testing::KilledBySignal(SIGABRT), "");
+
+    // Coarse time is tick resolution; allow generous slack against the
+    // precise clock.
+    nsecs_t before = systemTime(SYSTEM_TIME_MONOTONIC);
+    nsecs_t coarse = systemTimeCoarse(SYSTEM_TIME_MONOTONIC);
+    nsecs_t after = systemTime(SYSTEM_TIME_MONOTONIC);
+    EXPECT_GE(coarse, before - ms2ns(100));
+    EXPECT_LE(coarse, after);
+
+    EXPECT_GE(systemTimeCoarse(SYSTEM_TIME_MONOTONIC), coarse);
+}
+
+TEST(Timers, systemTimeCached) {
+    nsecs_t refreshed = systemTimeCacheRefresh();
+    EXPECT_GT(refreshed, 0);
+    EXPECT_EQ(systemTimeCached(), refreshed);
+    // No clock access between refreshes: the cached value is stable.
+    EXPECT_EQ(systemTimeCached(), refreshed);
+}
+
+TEST(Timers, timestampBatch) {
+    android::TimestampBatch batch;
+    EXPECT_EQ(batch.clock(), SYSTEM_TIME_MONOTONIC);
+
+    nsecs_t first = batch.timestamp();
+    EXPECT_GT(first, 0);
+    EXPECT_EQ(batch.timestamp(), first);
+
+    nsecs_t second = batch.refresh();
+    EXPECT_GE(second, first);
+    EXPECT_EQ(batch.timestamp(), second);
+}
@@ -110,19 +110,25 @@ String8 Tokenizer::getLocation() const {
 }
 
 String8 Tokenizer::peekRemainderOfLine() const {
+    std::string_view remainder = peekRemainderOfLineView();
+    return String8(remainder.data(), remainder.size());
+}
+
+std::string_view Tokenizer::peekRemainderOfLineView() const {
     const char* end = getEnd();
-    const char* eol = mCurrent;
-    while (eol != end) {
-        char ch = *eol;
-        if (ch == '\n') {
-            break;
-        }
-        eol += 1;
+    const char* eol = static_cast<const char*>(memchr(mCurrent, '\n', end - mCurrent));
+    if (eol == nullptr) {
+        eol = end;
     }
-    return String8(mCurrent, eol - mCurrent);
+    return std::string_view(mCurrent, eol - mCurrent);
 }
 
 String8 Tokenizer::nextToken(const char* delimiters) {
+    std::string_view token = nextTokenView(delimiters);
+    return String8(token.data(), token.size());
+}
+
+std::string_view Tokenizer::nextTokenView(const char* delimiters) {
 #if DEBUG_TOKENIZER
     ALOGD("nextToken");
 #endif
@@ -135,7 +141,7 @@ String8 Tokenizer::nextToken(const char* delimiters) {
         }
         mCurrent += 1;
     }
-    return String8(tokenStart, mCurrent - tokenStart);
+    return std::string_view(tokenStart, mCurrent - tokenStart);
 }
 
 void Tokenizer::nextLine() {
@@ -143,15 +149,24 @@ void Tokenizer::nextLine() {
     ALOGD("nextLine");
 #endif
     const char* end = getEnd();
-    while (mCurrent != end) {
-        char ch = *(mCurrent++);
-        if (ch == '\n') {
-            mLineNumber += 1;
-            break;
-        }
+    const char* eol = static_cast<const char*>(memchr(mCurrent, '\n', end - mCurrent));
+    if (eol != nullptr) {
+        mCurrent = eol + 1;
+        mLineNumber += 1;
+    } else {
+        mCurrent = end;
     }
 }
 
+void Tokenizer::skipToEol() {
+#if DEBUG_TOKENIZER
+    ALOGD("skipToEol");
+#endif
+    const char* end = getEnd();
+    const char* eol = static_cast<const char*>(memchr(mCurrent, '\n', end - mCurrent));
+    mCurrent = (eol != nullptr) ? eol : end;
+}
+
 void Tokenizer::skipDelimiters(const char* delimiters) {
 #if DEBUG_TOKENIZER
     ALOGD("skipDelimiters");
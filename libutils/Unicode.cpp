@@ -18,10 +18,18 @@
 
 #include <android-base/macros.h>
 #include <limits.h>
+#include <stdint.h>
+#include <string.h>
 #include <utils/Unicode.h>
 
 #include <log/log.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 #if defined(_WIN32)
 # undef  nhtol
 # undef  htonl
@@ -66,6 +74,134 @@ static const char32_t kFirstByteMark[] = {
     0x00000000, 0x00000000, 0x000000C0, 0x000000E0, 0x000000F0
 };
 
+// --------------------------------------------------------------------------
+// ASCII fast paths
+// --------------------------------------------------------------------------
+//
+// Most strings passing through these conversions are pure ASCII, where
+// UTF-8 <-> UTF-16 degenerates to a widening or narrowing copy.  The helpers
+// below find the leading all-ASCII run with SIMD (SSE2 / NEON) or a
+// word-at-a-time probe and copy it in bulk, so the scalar decoders only run
+// for code points that actually need them.
+
+/**
+ * Return the number of leading bytes in [src, src+len) below 0x80.
+ */
+static inline size_t utf8_ascii_span(const uint8_t* src, size_t len)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= len; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(src + i));
+        int mask = _mm_movemask_epi8(chunk);
+        if (mask != 0) {
+            return i + __builtin_ctz((unsigned)mask);
+        }
+    }
+#elif defined(__aarch64__)
+    for (; i + 16 <= len; i += 16) {
+        if (vmaxvq_u8(vld1q_u8(src + i)) >= 0x80) {
+            break;
+        }
+    }
+#else
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, src + i, sizeof(word));
+        if (word & 0x8080808080808080ULL) {
+            break;
+        }
+    }
+#endif
+    while (i < len && src[i] < 0x80) {
+        i++;
+    }
+    return i;
+}
+
+/**
+ * Return the number of leading UTF-16 units in [src, src+len) below 0x80.
+ */
+static inline size_t utf16_ascii_span(const char16_t* src, size_t len)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i non_ascii = _mm_set1_epi16((short)0xFF80);
+    for (; i + 8 <= len; i += 8) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i hits = _mm_cmpeq_epi16(_mm_and_si128(chunk, non_ascii),
+                                       _mm_setzero_si128());
+        if (_mm_movemask_epi8(hits) != 0xFFFF) {
+            break;
+        }
+    }
+#elif defined(__aarch64__)
+    for (; i + 8 <= len; i += 8) {
+        if (vmaxvq_u16(vld1q_u16((const uint16_t*)(src + i))) >= 0x80) {
+            break;
+        }
+    }
+#else
+    for (; i + 4 <= len; i += 4) {
+        uint64_t word;
+        memcpy(&word, src + i, sizeof(word));
+        if (word & 0xFF80FF80FF80FF80ULL) {
+            break;
+        }
+    }
+#endif
+    while (i < len && src[i] < 0x80) {
+        i++;
+    }
+    return i;
+}
+
+/**
+ * Widen len ASCII bytes into UTF-16 units.
+ */
+static inline void utf8_ascii_to_utf16(const uint8_t* src, size_t len, char16_t* dst)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= len; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_unpacklo_epi8(chunk, zero));
+        _mm_storeu_si128((__m128i*)(dst + i + 8), _mm_unpackhi_epi8(chunk, zero));
+    }
+#elif defined(__aarch64__)
+    for (; i + 8 <= len; i += 8) {
+        vst1q_u16((uint16_t*)(dst + i), vmovl_u8(vld1_u8(src + i)));
+    }
+#endif
+    for (; i < len; i++) {
+        dst[i] = src[i];
+    }
+}
+
+/**
+ * Narrow len ASCII UTF-16 units into bytes.
+ */
+static inline void utf16_ascii_to_utf8(const char16_t* src, size_t len, char* dst)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= len; i += 16) {
+        __m128i lo = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i hi = _mm_loadu_si128((const __m128i*)(src + i + 8));
+        // All units are < 0x80, so saturation never alters a value.
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(lo, hi));
+    }
+#elif defined(__aarch64__)
+    for (; i + 8 <= len; i += 8) {
+        vst1_u8((uint8_t*)(dst + i), vmovn_u16(vld1q_u16((const uint16_t*)(src + i))));
+    }
+#endif
+    for (; i < len; i++) {
+        dst[i] = (char)src[i];
+    }
+}
+
 // --------------------------------------------------------------------------
 // UTF-32
 // --------------------------------------------------------------------------
@@ -335,6 +471,15 @@ void utf16_to_utf8(const char16_t* src, size_t src_len, char* dst, size_t dst_le
     const char16_t* const end_utf16 = src + src_len;
     char *cur = dst;
     while (cur_utf16 < end_utf16) {
+        const size_t run = utf16_ascii_span(cur_utf16, end_utf16 - cur_utf16);
+        if (run != 0) {
+            LOG_ALWAYS_FATAL_IF(dst_len < run, "%zu < %zu", dst_len, run);
+            utf16_ascii_to_utf8(cur_utf16, run, cur);
+            cur_utf16 += run;
+            cur += run;
+            dst_len -= run;
+            continue;
+        }
         char32_t utf32;
         // surrogate pairs
         if((*cur_utf16 & 0xFC00) == 0xD800 && (cur_utf16 + 1) < end_utf16
@@ -411,6 +556,16 @@ ssize_t utf16_to_utf8_length(const char16_t *src, size_t src_len)
     size_t ret = 0;
     const char16_t* const end = src + src_len;
     while (src < end) {
+        const size_t run = utf16_ascii_span(src, end - src);
+        if (run != 0) {
+            if (SSIZE_MAX - run < ret) {
+                android_errorWriteLog(0x534e4554, "37723026");
+                return -1;
+            }
+            ret += run;
+            src += run;
+            continue;
+        }
         size_t char_len;
         if ((*src & 0xFC00) == 0xD800 && (src + 1) < end
                 && (*(src + 1) & 0xFC00) == 0xDC00) {
@@ -490,6 +645,13 @@ ssize_t utf8_to_utf16_length(const uint8_t* u8str, size_t u8len, bool overreadIs
     /* Validate that the UTF-8 is the correct len */
     size_t u16measuredLen = 0;
     while (u8cur < u8end) {
+        // ASCII converts to UTF-16 one unit per byte and can't overread.
+        const size_t run = utf8_ascii_span(u8cur, u8end - u8cur);
+        u16measuredLen += run;
+        u8cur += run;
+        if (u8cur == u8end) {
+            break;
+        }
         u16measuredLen++;
         int u8charLen = utf8_codepoint_len(*u8cur);
         // Malformed utf8, some characters are beyond the end.
@@ -543,6 +705,16 @@ char16_t* utf8_to_utf16_no_null_terminator(
     char16_t* u16cur = dst;
 
     while (u8cur < u8end && u16cur < u16end) {
+        size_t run = utf8_ascii_span(u8cur, u8end - u8cur);
+        if (run != 0) {
+            if (run > (size_t)(u16end - u16cur)) {
+                run = u16end - u16cur;
+            }
+            utf8_ascii_to_utf16(u8cur, run, u16cur);
+            u8cur += run;
+            u16cur += run;
+            continue;
+        }
         size_t u8len = utf8_codepoint_len(*u8cur);
         uint32_t codepoint = utf8_to_utf32_codepoint(u8cur, u8len);
 
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <utils/Unicode.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+// A 4 KiB mostly-ASCII corpus: ASCII text with an occasional two-byte
+// code point, roughly what service transaction payloads look like.
+std::string makeUtf8(bool pureAscii) {
+    std::string s;
+    while (s.size() < 4096) {
+        s += "The quick brown fox jumps over the lazy dog. ";
+        if (!pureAscii) {
+            s += "\xC3\xA9";  // U+00E9
+        }
+    }
+    return s;
+}
+
+std::vector<char16_t> makeUtf16(bool pureAscii) {
+    std::string u8 = makeUtf8(pureAscii);
+    const uint8_t* str = reinterpret_cast<const uint8_t*>(u8.data());
+    ssize_t len = utf8_to_utf16_length(str, u8.size());
+    std::vector<char16_t> u16(len + 1);
+    utf8_to_utf16(str, u8.size(), u16.data(), u16.size());
+    u16.resize(len);
+    return u16;
+}
+
+}  // namespace
+
+static void BM_utf8_to_utf16(benchmark::State& state) {
+    std::string u8 = makeUtf8(state.range(0) != 0);
+    const uint8_t* str = reinterpret_cast<const uint8_t*>(u8.data());
+    ssize_t len = utf8_to_utf16_length(str, u8.size());
+    std::vector<char16_t> u16(len + 1);
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(utf8_to_utf16_length(str, u8.size()));
+        utf8_to_utf16(str, u8.size(), u16.data(), u16.size());
+        benchmark::DoNotOptimize(u16.data());
+    }
+    state.SetBytesProcessed(state.iterations() * u8.size());
+}
+BENCHMARK(BM_utf8_to_utf16)->Arg(0)->Arg(1);
+
+static void BM_utf16_to_utf8(benchmark::State& state) {
+    std::vector<char16_t> u16 = makeUtf16(state.range(0) != 0);
+    ssize_t len = utf16_to_utf8_length(u16.data(), u16.size());
+    std::vector<char> u8(len + 1);
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(utf16_to_utf8_length(u16.data(), u16.size()));
+        utf16_to_utf8(u16.data(), u16.size(), u8.data(), u8.size());
+        benchmark::DoNotOptimize(u8.data());
+    }
+    state.SetBytesProcessed(state.iterations() * u16.size() * sizeof(char16_t));
+}
+BENCHMARK(BM_utf16_to_utf8)->Arg(0)->Arg(1);
+
+BENCHMARK_MAIN();
@@ -22,6 +22,9 @@
 #include <log/log.h>
 #include <utils/Unicode.h>
 
+#include <string>
+#include <vector>
+
 #include <gtest/gtest.h>
 
 namespace android {
@@ -118,6 +121,37 @@ TEST_F(UnicodeTest, UTF8toUTF16Normal) {
             << "should be NULL terminated";
 }
 
+TEST_F(UnicodeTest, ASCIIFastPathRoundTrip) {
+    // Exercise the vectorized ASCII fast paths with non-ASCII characters at
+    // every offset within and just past a SIMD block, so run lengths of
+    // 0..40 bytes and the scalar tail are all covered.
+    for (size_t prefix = 0; prefix <= 40; prefix++) {
+        std::string utf8(prefix, 'a');
+        utf8 += "\xC4\x80";       // U+0100
+        utf8 += std::string(7, 'b');
+        utf8 += "\xF0\x90\x80\x80";  // U+10000, a surrogate pair in UTF-16
+        utf8 += std::string(17, 'c');
+
+        const uint8_t* u8str = reinterpret_cast<const uint8_t*>(utf8.data());
+        ssize_t u16len = utf8_to_utf16_length(u8str, utf8.size());
+        ASSERT_EQ(static_cast<ssize_t>(prefix + 1 + 7 + 2 + 17), u16len);
+
+        std::vector<char16_t> utf16(u16len + 1);
+        utf8_to_utf16(u8str, utf8.size(), utf16.data(), utf16.size());
+        EXPECT_EQ(0x0100, utf16[prefix]);
+        EXPECT_EQ(0xD800, utf16[prefix + 8]);
+        EXPECT_EQ(0xDC00, utf16[prefix + 9]);
+        EXPECT_EQ(0, utf16[u16len]);
+
+        ssize_t u8len = utf16_to_utf8_length(utf16.data(), u16len);
+        ASSERT_EQ(static_cast<ssize_t>(utf8.size()), u8len);
+
+        std::vector<char> back(u8len + 1);
+        utf16_to_utf8(utf16.data(), u16len, back.data(), back.size());
+        EXPECT_EQ(utf8, std::string(back.data(), u8len));
+    }
+}
+
 TEST_F(UnicodeTest, strstr16EmptyTarget) {
     EXPECT_EQ(strstr16(kSearchString, u""), kSearchString)
             << "should return the original pointer";
@@ -544,15 +544,32 @@ void VectorImpl::_do_copy(void* dest, const void* from, size_t num) const
 }
 
 void VectorImpl::_do_splat(void* dest, const void* item, size_t num) const {
-    do_splat(dest, item, num);
+    if (mFlags & HAS_TRIVIAL_COPY) {
+        char* d = static_cast<char*>(dest);
+        const size_t is = itemSize();
+        while (num--) {
+            memcpy(d, item, is);
+            d += is;
+        }
+    } else {
+        do_splat(dest, item, num);
+    }
 }
 
 void VectorImpl::_do_move_forward(void* dest, const void* from, size_t num) const {
-    do_move_forward(dest, from, num);
+    if (mFlags & HAS_TRIVIAL_MOVE) {
+        memmove(dest, from, num*itemSize());
+    } else {
+        do_move_forward(dest, from, num);
+    }
 }
 
 void VectorImpl::_do_move_backward(void* dest, const void* from, size_t num) const {
-    do_move_backward(dest, from, num);
+    if (mFlags & HAS_TRIVIAL_MOVE) {
+        memmove(dest, from, num*itemSize());
+    } else {
+        do_move_backward(dest, from, num);
+    }
 }
 
 /*****************************************************************************/
@@ -50,4 +50,50 @@ void BM_prepend_std_vector(benchmark::State& state) {
 }
 BENCHMARK(BM_prepend_std_vector);
 
+void BM_insert_erase_middle_android_vector(benchmark::State& state) {
+    android::Vector<uint64_t> v;
+    for (uint64_t i = 0; i < 1024; i++) {
+        v.push(i);
+    }
+    while (state.KeepRunning()) {
+        v.insertAt(uint64_t{42}, v.size() / 2);
+        v.removeAt(v.size() / 2);
+    }
+}
+BENCHMARK(BM_insert_erase_middle_android_vector);
+
+void BM_insert_erase_middle_std_vector(benchmark::State& state) {
+    std::vector<uint64_t> v;
+    for (uint64_t i = 0; i < 1024; i++) {
+        v.push_back(i);
+    }
+    while (state.KeepRunning()) {
+        v.insert(v.begin() + v.size() / 2, uint64_t{42});
+        v.erase(v.begin() + v.size() / 2);
+    }
+}
+BENCHMARK(BM_insert_erase_middle_std_vector);
+
+void BM_append_array_android_vector(benchmark::State& state) {
+    uint64_t chunk[64] = {};
+    while (state.KeepRunning()) {
+        android::Vector<uint64_t> v;
+        for (size_t i = 0; i < 16; i++) {
+            v.appendArray(chunk, 64);
+        }
+    }
+}
+BENCHMARK(BM_append_array_android_vector);
+
+void BM_append_array_std_vector(benchmark::State& state) {
+    uint64_t chunk[64] = {};
+    while (state.KeepRunning()) {
+        std::vector<uint64_t> v;
+        for (size_t i = 0; i < 16; i++) {
+            v.insert(v.end(), chunk, chunk + 64);
+        }
+    }
+}
+BENCHMARK(BM_append_array_std_vector);
+
 BENCHMARK_MAIN();
@@ -136,6 +136,21 @@ struct BitSet32 {
         return static_cast<uint32_t>(__builtin_popcountl(value & ~(0xffffffffUL >> n)));
     }
 
+    // Invokes f(n) for each marked bit, in increasing index order.  Iterates
+    // on a register copy with count-leading-zeros steps, so the cost is one
+    // clz per marked bit rather than one test per bit position.
+    template <typename F>
+    inline void forEachMarkedBit(F&& f) const { forEachMarkedBit(value, f); }
+
+    template <typename F>
+    static inline void forEachMarkedBit(uint32_t value, F&& f) {
+        while (value) {
+            uint32_t n = firstMarkedBit(value);
+            clearBit(value, n);
+            f(n);
+        }
+    }
+
     inline bool operator== (const BitSet32& other) const { return value == other.value; }
     inline bool operator!= (const BitSet32& other) const { return value != other.value; }
     inline BitSet32 operator& (const BitSet32& other) const {
@@ -284,6 +299,20 @@ struct BitSet64 {
         return static_cast<uint32_t>(__builtin_popcountll(value & ~(0xffffffffffffffffULL >> n)));
     }
 
+    // Invokes f(n) for each marked bit, in increasing index order.  See
+    // BitSet32::forEachMarkedBit.
+    template <typename F>
+    inline void forEachMarkedBit(F&& f) const { forEachMarkedBit(value, f); }
+
+    template <typename F>
+    static inline void forEachMarkedBit(uint64_t value, F&& f) {
+        while (value) {
+            uint32_t n = firstMarkedBit(value);
+            clearBit(value, n);
+            f(n);
+        }
+    }
+
     inline bool operator== (const BitSet64& other) const { return value == other.value; }
     inline bool operator!= (const BitSet64& other) const { return value != other.value; }
     inline BitSet64 operator& (const BitSet64& other) const {
@@ -304,6 +333,146 @@ struct BitSet64 {
 
 ANDROID_BASIC_TYPES_TRAITS(BitSet64)
 
+// A fixed-size set of N bits, N a multiple of 64, stored as an array of
+// 64-bit words.  Bit numbering and semantics follow BitSet32/BitSet64:
+// bit 0 is the most significant bit of the first word, and the first*/last*
+// queries are undefined on an empty (respectively full) set.
+template <uint32_t N>
+struct BitSetN {
+    static_assert(N > 0 && N % 64 == 0, "BitSetN size must be a positive multiple of 64");
+    static constexpr uint32_t kNumWords = N / 64;
+
+    uint64_t words[kNumWords];
+
+    inline BitSetN() { clear(); }
+
+    // Clears the bit set.
+    inline void clear() {
+        for (uint32_t i = 0; i < kNumWords; i++) {
+            words[i] = 0ULL;
+        }
+    }
+
+    // Returns the number of marked bits in the set.
+    inline uint32_t count() const {
+        uint32_t n = 0;
+        for (uint32_t i = 0; i < kNumWords; i++) {
+            n += static_cast<uint32_t>(__builtin_popcountll(words[i]));
+        }
+        return n;
+    }
+
+    // Returns true if the bit set does not contain any marked bits.
+    inline bool isEmpty() const {
+        uint64_t merged = 0ULL;
+        for (uint32_t i = 0; i < kNumWords; i++) {
+            merged |= words[i];
+        }
+        return !merged;
+    }
+
+    // Returns true if the bit set does not contain any unmarked bits.
+    inline bool isFull() const {
+        uint64_t merged = 0xffffffffffffffffULL;
+        for (uint32_t i = 0; i < kNumWords; i++) {
+            merged &= words[i];
+        }
+        return merged == 0xffffffffffffffffULL;
+    }
+
+    // Returns true if the specified bit is marked.
+    inline bool hasBit(uint32_t n) const {
+        return BitSet64::hasBit(words[n >> 6], n & 63);
+    }
+
+    // Marks the specified bit.
+    inline void markBit(uint32_t n) {
+        BitSet64::markBit(words[n >> 6], n & 63);
+    }
+
+    // Clears the specified bit.
+    inline void clearBit(uint32_t n) {
+        BitSet64::clearBit(words[n >> 6], n & 63);
+    }
+
+    // Finds the first marked bit in the set.
+    // Result is undefined if all bits are unmarked.
+    inline uint32_t firstMarkedBit() const {
+        for (uint32_t i = 0; i < kNumWords; i++) {
+            if (words[i]) {
+                return (i << 6) + BitSet64::firstMarkedBit(words[i]);
+            }
+        }
+        return N;
+    }
+
+    // Finds the last marked bit in the set.
+    // Result is undefined if all bits are unmarked.
+    inline uint32_t lastMarkedBit() const {
+        for (uint32_t i = kNumWords; i != 0; i--) {
+            if (words[i - 1]) {
+                return ((i - 1) << 6) + BitSet64::lastMarkedBit(words[i - 1]);
+            }
+        }
+        return N;
+    }
+
+    // Finds the first marked bit in the set and clears it.  Returns the bit index.
+    // Result is undefined if all bits are unmarked.
+    inline uint32_t clearFirstMarkedBit() {
+        uint32_t n = firstMarkedBit();
+        clearBit(n);
+        return n;
+    }
+
+    // Invokes f(n) for each marked bit, in increasing index order.  Words
+    // are iterated on register copies with count-leading-zeros steps, so
+    // the cost is one clz per marked bit plus one test per word.
+    template <typename F>
+    inline void forEachMarkedBit(F&& f) const {
+        for (uint32_t i = 0; i < kNumWords; i++) {
+            BitSet64::forEachMarkedBit(words[i],
+                                       [&](uint32_t n) { f((i << 6) + n); });
+        }
+    }
+
+    inline bool operator== (const BitSetN& other) const {
+        for (uint32_t i = 0; i < kNumWords; i++) {
+            if (words[i] != other.words[i]) return false;
+        }
+        return true;
+    }
+    inline bool operator!= (const BitSetN& other) const { return !(*this == other); }
+    inline BitSetN operator& (const BitSetN& other) const {
+        BitSetN result(*this);
+        result &= other;
+        return result;
+    }
+    inline BitSetN& operator&= (const BitSetN& other) {
+        for (uint32_t i = 0; i < kNumWords; i++) {
+            words[i] &= other.words[i];
+        }
+        return *this;
+    }
+    inline BitSetN operator| (const BitSetN& other) const {
+        BitSetN result(*this);
+        result |= other;
+        return result;
+    }
+    inline BitSetN& operator|= (const BitSetN& other) {
+        for (uint32_t i = 0; i < kNumWords; i++) {
+            words[i] |= other.words[i];
+        }
+        return *this;
+    }
+};
+
+typedef BitSetN<128> BitSet128;
+typedef BitSetN<256> BitSet256;
+
+ANDROID_BASIC_TYPES_TRAITS(BitSet128)
+ANDROID_BASIC_TYPES_TRAITS(BitSet256)
+
 } // namespace android
 
 #endif // UTILS_BITSET_H
@@ -40,6 +40,9 @@
 
 #define ALWAYS_INLINE __attribute__((always_inline))
 
+class Backtrace;
+class BacktraceMap;
+
 namespace android {
 
 class Printer;
@@ -54,13 +57,44 @@ public:
     CallStack(const char* logtag, int32_t ignoreDepth = 1);
     ~CallStack();
 
+    // Reusable state for code that captures stacks repeatedly (leak
+    // samplers, allocation trackers).  Keeps the parsed process map alive
+    // across captures instead of re-reading /proc/<pid>/maps every time.
+    // Not thread-safe; use one context per sampling thread.
+    class CaptureContext {
+    public:
+        CaptureContext();
+        ~CaptureContext();
+
+        // Drop this context's cached map; the next capture re-parses it.
+        void invalidate();
+
+        // Invalidate every live context by bumping the global map
+        // generation.  Call after anything that remaps the process
+        // (dlopen/dlclose) when individual contexts can't be reached.
+        static void invalidateAll();
+
+    private:
+        friend class CallStack;
+        BacktraceMap* getMap();
+
+        std::unique_ptr<BacktraceMap> mMap;
+        uint32_t mMapGeneration;
+    };
+
     // Reset the stack frames (same as creating an empty call stack).
-    void clear() { mFrameLines.clear(); }
+    void clear() { mFrameLines.clear(); mUnformatted.reset(); }
 
     // Immediately collect the stack traces for the specified thread.
     // The default is to dump the stack of the current call.
     void update(int32_t ignoreDepth = 1, pid_t tid = BACKTRACE_CURRENT_THREAD);
 
+    // Like update(), but reuses the context's cached process map, and
+    // defers frame formatting: lines are rendered on first use
+    // (log/dump/toString/print) instead of on the capture path.
+    void update(CaptureContext& context, int32_t ignoreDepth = 1,
+                pid_t tid = BACKTRACE_CURRENT_THREAD);
+
     // Dump a stack trace to the log using the supplied logtag.
     void log(const char* logtag,
              android_LogPriority priority = ANDROID_LOG_DEBUG,
@@ -75,8 +109,13 @@ public:
     // Dump a serialized representation of the stack trace to the specified printer.
     void print(Printer& printer) const;
 
+    // Render frame lines from a deferred capture now instead of at first
+    // print; a no-op otherwise.  Lets callers move formatting onto a worker
+    // thread ahead of a sequential dump.
+    void format() const { formatUnformatted(); }
+
     // Get the count of stack frames that are in this call stack.
-    size_t size() const { return mFrameLines.size(); }
+    size_t size() const;
 
     // DO NOT USE ANYTHING BELOW HERE. The following public members are expected
     // to disappear again shortly, once a better replacement facility exists.
@@ -161,7 +200,13 @@ public:
     static void CALLSTACK_WEAK deleteStack(CallStack* stack);
 #endif // WEAKS_AVAILABLE
 
-    Vector<String8> mFrameLines;
+    // Renders mFrameLines from a deferred capture, if one is pending.
+    void formatUnformatted() const;
+
+    // Shared (rather than unique) so CallStack objects stay copyable;
+    // the unwound frames are immutable once captured.
+    mutable std::shared_ptr<Backtrace> mUnformatted;
+    mutable Vector<String8> mFrameLines;
 };
 
 }  // namespace android
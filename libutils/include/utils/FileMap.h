@@ -20,6 +20,7 @@
 #ifndef __LIBS_FILE_MAP_H
 #define __LIBS_FILE_MAP_H
 
+#include <stdint.h>
 #include <sys/types.h>
 
 #include <utils/Compat.h>
@@ -55,16 +56,39 @@ public:
     FileMap(FileMap&& f) noexcept;
     FileMap& operator=(FileMap&& f) noexcept;
 
+    /*
+     * Optional flags for create(), applied when the mapping is established
+     * so readahead and fault behavior is right from the first access.
+     * These are hints: a kernel that doesn't support one is not an error.
+     */
+    enum CreateOptions {
+        /* madvise(MADV_SEQUENTIAL): aggressive readahead for linear scans. */
+        CREATE_ADVISE_SEQUENTIAL = 0x01,
+        /* madvise(MADV_WILLNEED): start asynchronous readahead of the whole
+         * mapping immediately. */
+        CREATE_ADVISE_WILLNEED   = 0x02,
+        /* madvise(MADV_HUGEPAGE): back large read-mostly mappings with
+         * transparent huge pages where available. */
+        CREATE_HUGEPAGE          = 0x04,
+        /* MAP_POPULATE: prefault the page tables before create() returns,
+         * trading mapping latency for fault-free access afterwards. */
+        CREATE_POPULATE          = 0x08,
+    };
+
     /*
      * Create a new mapping on an open file.
      *
      * Closing the file descriptor does not unmap the pages, so we don't
      * claim ownership of the fd.
      *
+     * "options" is a bitmask of CreateOptions; pass 0 for the historical
+     * behavior (no hints, pages faulted on demand).
+     *
      * Returns "false" on failure.
      */
     bool create(const char* origFileName, int fd,
-                off64_t offset, size_t length, bool readOnly);
+                off64_t offset, size_t length, bool readOnly,
+                uint32_t options = 0);
 
     ~FileMap(void);
 
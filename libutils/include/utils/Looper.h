@@ -26,6 +26,7 @@
 
 #include <android-base/unique_fd.h>
 
+#include <atomic>
 #include <utility>
 
 namespace android {
@@ -448,6 +449,18 @@ private:
         Message message;
     };
 
+    // A message posted by sendMessageAtTime(), staged on a lock-free MPSC
+    // stack until the looper thread merges it into mMessageEnvelopes.
+    struct StagedMessage {
+        StagedMessage(nsecs_t u, sp<MessageHandler> h, const Message& m)
+            : uptime(u), handler(std::move(h)), message(m) {}
+
+        StagedMessage* next = nullptr;
+        nsecs_t uptime;
+        sp<MessageHandler> handler;
+        Message message;
+    };
+
     const bool mAllowNonCallbacks; // immutable
 
     android::base::unique_fd mWakeEventFd;  // immutable
@@ -456,6 +469,16 @@ private:
     Vector<MessageEnvelope> mMessageEnvelopes; // guarded by mLock
     bool mSendingMessage; // guarded by mLock
 
+    // Incoming messages, pushed lock-free by any thread and drained under
+    // mLock by drainStagedMessagesLocked().  The newest message is at the
+    // head of the list.
+    std::atomic<StagedMessage*> mStagedMessages;
+
+    // Set when a staged message has already signalled the wake event fd, so
+    // a burst of posts coalesces into a single wakeup.  Cleared by the
+    // drain before it takes the staged list.
+    std::atomic<bool> mStagedWakePending;
+
     // Whether we are currently waiting for work.  Not protected by a lock,
     // any use of it is racy anyway.
     volatile bool mPolling;
@@ -476,6 +499,7 @@ private:
     int pollInner(int timeoutMillis);
     int removeFd(int fd, int seq);
     void awoken();
+    void drainStagedMessagesLocked();
     void pushResponse(int events, const Request& request);
     void rebuildEpollLocked();
     void scheduleEpollRebuildLocked();
@@ -45,8 +45,19 @@ public:
     };
 
     void setOnEntryRemovedListener(OnEntryRemoved<TKey, TValue>* listener);
+    // Reserves part of the cache as a protected segment.  New entries start in the
+    // probationary segment and are promoted on their first hit; eviction always takes
+    // probationary entries first, so a one-pass scan cannot flush the frequently-hit
+    // working set.  When the protected segment overflows, its LRU entry is demoted
+    // back to probationary.  0 (the default) keeps classic strict-LRU behavior.
+    void setProtectedCapacity(uint32_t protectedCapacity);
+    // Pinned entries are skipped by capacity eviction and removeOldest(); remove()
+    // and clear() still delete them.  Both return false if the key is not present.
+    bool pin(const TKey& key);
+    bool unpin(const TKey& key);
     size_t size() const;
     const TValue& get(const TKey& key);
+    bool get(const TKey& key, TValue* outValue);
     bool put(const TKey& key, const TValue& value);
     bool remove(const TKey& key);
     bool removeOldest();
@@ -64,14 +75,27 @@ private:
         virtual ~KeyedEntry() {}
     };
 
+    enum Segment : uint8_t {
+        kProbationary = 0,
+        kProtected = 1,
+    };
+
     class Entry final : public KeyedEntry {
     public:
         TKey key;
         TValue value;
         Entry* parent;
         Entry* child;
-
-        Entry(TKey _key, TValue _value) : key(_key), value(_value), parent(nullptr), child(nullptr) {
+        uint8_t segment;
+        bool pinned;
+
+        Entry(TKey _key, TValue _value)
+            : key(_key)
+            , value(_value)
+            , parent(nullptr)
+            , child(nullptr)
+            , segment(kProbationary)
+            , pinned(false) {
         }
         const TKey& getKey() const final { return key; }
     };
@@ -102,6 +126,8 @@ private:
 
     void attachToCache(Entry& entry);
     void detachFromCache(Entry& entry);
+    void demoteIfNeeded();
+    Entry* findEvictionCandidate();
 
     typename LruCacheSet::iterator findByKey(const TKey& key) {
         EntryForSearch entryForSearch(key);
@@ -111,9 +137,15 @@ private:
 
     std::unique_ptr<LruCacheSet> mSet;
     OnEntryRemoved<TKey, TValue>* mListener;
+    // mOldest/mYoungest hold the probationary segment; the protected segment has its own
+    // list and is only populated when setProtectedCapacity() has been called.
     Entry* mOldest;
     Entry* mYoungest;
+    Entry* mProtectedOldest;
+    Entry* mProtectedYoungest;
     uint32_t mMaxCapacity;
+    uint32_t mProtectedCapacity;
+    uint32_t mProtectedSize;
     TValue mNullValue;
 
 public:
@@ -165,7 +197,11 @@ LruCache<TKey, TValue>::LruCache(uint32_t maxCapacity)
     , mListener(nullptr)
     , mOldest(nullptr)
     , mYoungest(nullptr)
+    , mProtectedOldest(nullptr)
+    , mProtectedYoungest(nullptr)
     , mMaxCapacity(maxCapacity)
+    , mProtectedCapacity(0)
+    , mProtectedSize(0)
     , mNullValue(0) {
     mSet->max_load_factor(1.0);
 };
@@ -181,6 +217,33 @@ void LruCache<K, V>::setOnEntryRemovedListener(OnEntryRemoved<K, V>* listener) {
     mListener = listener;
 }
 
+template <typename TKey, typename TValue>
+void LruCache<TKey, TValue>::setProtectedCapacity(uint32_t protectedCapacity) {
+    mProtectedCapacity = protectedCapacity;
+    // Shrinking (or disabling) the protected segment demotes its overflow, oldest first.
+    demoteIfNeeded();
+}
+
+template <typename TKey, typename TValue>
+bool LruCache<TKey, TValue>::pin(const TKey& key) {
+    typename LruCacheSet::const_iterator find_result = findByKey(key);
+    if (find_result == mSet->end()) {
+        return false;
+    }
+    reinterpret_cast<Entry*>(*find_result)->pinned = true;
+    return true;
+}
+
+template <typename TKey, typename TValue>
+bool LruCache<TKey, TValue>::unpin(const TKey& key) {
+    typename LruCacheSet::const_iterator find_result = findByKey(key);
+    if (find_result == mSet->end()) {
+        return false;
+    }
+    reinterpret_cast<Entry*>(*find_result)->pinned = false;
+    return true;
+}
+
 template <typename TKey, typename TValue>
 size_t LruCache<TKey, TValue>::size() const {
     return mSet->size();
@@ -196,10 +259,39 @@ const TValue& LruCache<TKey, TValue>::get(const TKey& key) {
     // of LruCacheSet above.
     Entry *entry = reinterpret_cast<Entry*>(*find_result);
     detachFromCache(*entry);
+    if (mProtectedCapacity != 0 && entry->segment == kProbationary) {
+        entry->segment = kProtected;
+        mProtectedSize++;
+    }
     attachToCache(*entry);
+    demoteIfNeeded();
     return entry->value;
 }
 
+// Variant of get() that reports whether the key was present instead of
+// returning a reference to the null value on a miss.  Callers that copy the
+// value anyway (e.g. ShardedLruCache) use this to avoid conflating a miss
+// with a stored null value.
+template <typename TKey, typename TValue>
+bool LruCache<TKey, TValue>::get(const TKey& key, TValue* outValue) {
+    typename LruCacheSet::const_iterator find_result = findByKey(key);
+    if (find_result == mSet->end()) {
+        return false;
+    }
+    // All the elements in the set are of type Entry. See comment in the definition
+    // of LruCacheSet above.
+    Entry *entry = reinterpret_cast<Entry*>(*find_result);
+    detachFromCache(*entry);
+    if (mProtectedCapacity != 0 && entry->segment == kProbationary) {
+        entry->segment = kProtected;
+        mProtectedSize++;
+    }
+    attachToCache(*entry);
+    demoteIfNeeded();
+    *outValue = entry->value;
+    return true;
+}
+
 template <typename TKey, typename TValue>
 bool LruCache<TKey, TValue>::put(const TKey& key, const TValue& value) {
     if (mMaxCapacity != kUnlimitedCapacity && size() >= mMaxCapacity) {
@@ -230,14 +322,18 @@ bool LruCache<TKey, TValue>::remove(const TKey& key) {
         (*mListener)(entry->key, entry->value);
     }
     detachFromCache(*entry);
+    if (entry->segment == kProtected) {
+        mProtectedSize--;
+    }
     delete entry;
     return true;
 }
 
 template <typename TKey, typename TValue>
 bool LruCache<TKey, TValue>::removeOldest() {
-    if (mOldest != nullptr) {
-        return remove(mOldest->key);
+    Entry* victim = findEvictionCandidate();
+    if (victim != nullptr) {
+        return remove(victim->key);
         // TODO: should probably abort if false
     }
     return false;
@@ -245,8 +341,9 @@ bool LruCache<TKey, TValue>::removeOldest() {
 
 template <typename TKey, typename TValue>
 const TValue& LruCache<TKey, TValue>::peekOldestValue() {
-    if (mOldest) {
-        return mOldest->value;
+    Entry* victim = findEvictionCandidate();
+    if (victim) {
+        return victim->value;
     }
     return mNullValue;
 }
@@ -257,9 +354,15 @@ void LruCache<TKey, TValue>::clear() {
         for (Entry* p = mOldest; p != nullptr; p = p->child) {
             (*mListener)(p->key, p->value);
         }
+        for (Entry* p = mProtectedOldest; p != nullptr; p = p->child) {
+            (*mListener)(p->key, p->value);
+        }
     }
     mYoungest = nullptr;
     mOldest = nullptr;
+    mProtectedYoungest = nullptr;
+    mProtectedOldest = nullptr;
+    mProtectedSize = 0;
     for (auto entry : *mSet.get()) {
         delete entry;
     }
@@ -268,31 +371,61 @@ void LruCache<TKey, TValue>::clear() {
 
 template <typename TKey, typename TValue>
 void LruCache<TKey, TValue>::attachToCache(Entry& entry) {
-    if (mYoungest == nullptr) {
-        mYoungest = mOldest = &entry;
+    Entry*& oldest = entry.segment == kProtected ? mProtectedOldest : mOldest;
+    Entry*& youngest = entry.segment == kProtected ? mProtectedYoungest : mYoungest;
+    if (youngest == nullptr) {
+        youngest = oldest = &entry;
     } else {
-        entry.parent = mYoungest;
-        mYoungest->child = &entry;
-        mYoungest = &entry;
+        entry.parent = youngest;
+        youngest->child = &entry;
+        youngest = &entry;
     }
 }
 
 template <typename TKey, typename TValue>
 void LruCache<TKey, TValue>::detachFromCache(Entry& entry) {
+    Entry*& oldest = entry.segment == kProtected ? mProtectedOldest : mOldest;
+    Entry*& youngest = entry.segment == kProtected ? mProtectedYoungest : mYoungest;
     if (entry.parent != nullptr) {
         entry.parent->child = entry.child;
     } else {
-        mOldest = entry.child;
+        oldest = entry.child;
     }
     if (entry.child != nullptr) {
         entry.child->parent = entry.parent;
     } else {
-        mYoungest = entry.parent;
+        youngest = entry.parent;
     }
 
     entry.parent = nullptr;
     entry.child = nullptr;
 }
 
+// Moves the protected segment's overflow to the probationary MRU end, oldest first, so a
+// demoted entry still gets one more trip through the probationary queue before eviction.
+template <typename TKey, typename TValue>
+void LruCache<TKey, TValue>::demoteIfNeeded() {
+    while (mProtectedSize > mProtectedCapacity) {
+        Entry* demoted = mProtectedOldest;
+        detachFromCache(*demoted);
+        demoted->segment = kProbationary;
+        mProtectedSize--;
+        attachToCache(*demoted);
+    }
+}
+
+// The next entry capacity eviction would delete: the probationary LRU end first, then the
+// protected LRU end, skipping pinned entries.  Returns null if every entry is pinned.
+template <typename TKey, typename TValue>
+typename LruCache<TKey, TValue>::Entry* LruCache<TKey, TValue>::findEvictionCandidate() {
+    for (Entry* p = mOldest; p != nullptr; p = p->child) {
+        if (!p->pinned) return p;
+    }
+    for (Entry* p = mProtectedOldest; p != nullptr; p = p->child) {
+        if (!p->pinned) return p;
+    }
+    return nullptr;
+}
+
 }
 #endif // ANDROID_UTILS_LRU_CACHE_H
@@ -19,6 +19,9 @@
 
 #include <android/log.h>
 
+#include <string>
+#include <vector>
+
 namespace android {
 
 // Interface for printing to an arbitrary data stream
@@ -82,6 +85,39 @@ private:
     char mFormatString[MAX_FORMAT_STRING];
 }; // class FdPrinter
 
+// Print to a file descriptor, buffering lines and writing them out in
+// page-sized writev batches instead of one syscall per line.
+class BufferedFdPrinter : public Printer {
+public:
+    // Create a printer using the specified file descriptor.
+    // - Each line will be prefixed with 'indent' number of blank spaces.
+    // - In addition, each line will be prefixed with the 'prefix' string.
+    BufferedFdPrinter(int fd, unsigned int indent = 0, const char* prefix = nullptr);
+
+    // Flushes any buffered lines.
+    virtual ~BufferedFdPrinter();
+
+    // Buffer the specified line; \n is appended automatically.  Flushes
+    // automatically once a page worth of output has accumulated.
+    virtual void printLine(const char* string);
+
+    // Write all buffered lines to the file descriptor.
+    void flush();
+
+private:
+    enum {
+        // Flush once at least this many bytes are buffered.
+        FLUSH_THRESHOLD = 4096,
+        // Upper bound on iovecs passed to a single writev call.
+        MAX_IOVECS = 64,
+    };
+
+    int mFd;
+    std::string mLinePrefix;
+    std::vector<std::string> mLines;
+    size_t mBufferedBytes;
+}; // class BufferedFdPrinter
+
 class String8;
 
 // Print to a String8
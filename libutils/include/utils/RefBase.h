@@ -134,6 +134,13 @@
 // Explicitly deleting or otherwise destroying a RefBase object with outstanding
 // wp<> or sp<> pointers to it will result in an abort or heap corruption.
 
+// Classes that never hand out wp<> pointers do not need any of the machinery
+// above: deriving from LightRefBase<T> (see LightRefBase.h) instead of
+// RefBase gives sp<T> a compact layout with a single inline relaxed-ordering
+// count and no separately allocated weakref bookkeeping.  The choice of base
+// class is the trait; sp<> works identically with either.  See
+// RefBase_benchmark.cpp for the relative cost of the two layouts.
+
 // It is particularly important not to mix sp<> and direct storage management
 // since the sp from raw pointer constructor is implicit. Thus if a RefBase-
 // -derived object of type T is managed without ever incrementing its strong
@@ -182,6 +189,7 @@
 // LightRefBase used to be declared in this header, so we have to include it
 #include <utils/LightRefBase.h>
 
+#include <utils/BitSet.h>
 #include <utils/StrongPointer.h>
 #include <utils/TypeHelpers.h>
 
@@ -262,6 +270,18 @@ public:
         // acquires a strong reference if there is already one.
         bool                attemptIncStrong(const void* id);
 
+        // Batch variant of attemptIncStrong().  Attempts to acquire a strong
+        // reference on each non-null element of refs[0..n), recording ids[i]
+        // for element i, and marks bit i of the returned set iff refs[i] was
+        // promoted.  An entry with a normal lifetime that has already lost
+        // its last strong reference can never be revived, so it is rejected
+        // with a single relaxed load rather than the weak count round trip
+        // attemptIncStrong() pays; dead entries are the common case when
+        // fanning out over a long-lived observer list.  n must be at most 64
+        // (the capacity of the result); chunk larger arrays.
+        static BitSet64     attemptIncStrong(weakref_type* const* refs,
+                                             const void* const* ids, size_t n);
+
         // acquires a weak reference if there is already one.
         // This is not always safe. see ProcessState.cpp and BpBinder.cpp
         // for proper use.
@@ -390,6 +410,14 @@ public:
 
     sp<T> promote() const;
 
+    // Batch promotion: promotes src[0..n) in one call, overwriting dst[0..n).
+    // On return dst[i] holds a strong reference to src[i]'s object, or is null
+    // if src[i] was null or could not be promoted; bit i of the returned set
+    // is marked iff dst[i] is non-null.  Cheaper than promoting element-wise
+    // when many entries are dead, as in notification fan-out over an observer
+    // list that is swept lazily.  n must be at most 64; chunk larger arrays.
+    static BitSet64 promote(const wp<T>* src, sp<T>* dst, size_t n);
+
     // Reset
 
     void clear();
@@ -623,6 +651,27 @@ sp<T> wp<T>::promote() const
     return result;
 }
 
+template<typename T>
+BitSet64 wp<T>::promote(const wp<T>* src, sp<T>* dst, size_t n)
+{
+    constexpr size_t kMaxBatch = 64;  // Results must fit a BitSet64.
+    if (n > kMaxBatch) abort();
+    weakref_type* refs[kMaxBatch];
+    const void* ids[kMaxBatch];
+    for (size_t i = 0; i < n; i++) {
+        refs[i] = src[i].m_ptr != nullptr ? src[i].m_refs : nullptr;
+        ids[i] = &dst[i];
+    }
+    BitSet64 promoted = weakref_type::attemptIncStrong(refs, ids, n);
+    for (size_t i = 0; i < n; i++) {
+        dst[i].clear();
+        if (promoted.hasBit(i)) {
+            dst[i].set_pointer(src[i].m_ptr);
+        }
+    }
+    return promoted;
+}
+
 template<typename T>
 void wp<T>::clear()
 {
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2021 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_UTILS_SHARDED_LRU_CACHE_H
+#define ANDROID_UTILS_SHARDED_LRU_CACHE_H
+
+#include <memory>
+#include <vector>
+
+#include "utils/LruCache.h"
+#include "utils/Mutex.h"
+#include "utils/TypeHelpers.h"  // hash_t
+
+namespace android {
+
+/**
+ * A thread-safe wrapper around LruCache that spreads entries across several
+ * independently locked LruCache shards, so concurrent callers only contend
+ * when their keys hash to the same shard.
+ *
+ * Semantic differences from LruCache:
+ *  - Recency and eviction are tracked per shard, so eviction order is only
+ *    approximately LRU across the whole cache.
+ *  - The capacity is divided evenly among the shards; a shard that receives
+ *    a disproportionate share of the keys evicts before the cache as a whole
+ *    reaches maxCapacity.
+ *  - get() copies the value out instead of returning a reference, since a
+ *    reference into a shard could be invalidated by a concurrent eviction as
+ *    soon as the shard lock is dropped.
+ *
+ * OnEntryRemoved listeners are invoked with the owning shard's lock held;
+ * a listener must not call back into the cache.
+ */
+template <typename TKey, typename TValue>
+class ShardedLruCache {
+public:
+    explicit ShardedLruCache(uint32_t maxCapacity, uint32_t shardCount = kDefaultShardCount);
+
+    enum Capacity {
+        kUnlimitedCapacity,
+    };
+
+    static const uint32_t kDefaultShardCount = 16;
+
+    void setOnEntryRemovedListener(OnEntryRemoved<TKey, TValue>* listener);
+    size_t size() const;
+    bool get(const TKey& key, TValue* outValue);
+    bool put(const TKey& key, const TValue& value);
+    bool remove(const TKey& key);
+    void clear();
+    uint32_t shardCount() const { return static_cast<uint32_t>(mShards.size()); }
+
+private:
+    ShardedLruCache(const ShardedLruCache& that);  // disallow copy constructor
+
+    struct Shard {
+        explicit Shard(uint32_t maxCapacity) : cache(maxCapacity) {}
+
+        mutable Mutex lock;
+        LruCache<TKey, TValue> cache;
+    };
+
+    Shard& shardFor(const TKey& key) {
+        // Fold the upper bits in so the shard index isn't derived from the
+        // same low bits the shard's own hash table buckets use.
+        hash_t hash = hash_type(key);
+        return *mShards[(hash ^ (hash >> 16)) & (mShards.size() - 1)];
+    }
+
+    std::vector<std::unique_ptr<Shard>> mShards;
+};
+
+// Implementation is here, because it's fully templated
+template <typename TKey, typename TValue>
+ShardedLruCache<TKey, TValue>::ShardedLruCache(uint32_t maxCapacity, uint32_t shardCount) {
+    uint32_t count = 1;
+    while (count < shardCount) {
+        count <<= 1;
+    }
+    // Round the per-shard capacity up so a skewed key distribution doesn't
+    // shrink the cache below maxCapacity / shardCount entries per shard.
+    uint32_t shardCapacity = (maxCapacity == kUnlimitedCapacity)
+            ? static_cast<uint32_t>(LruCache<TKey, TValue>::kUnlimitedCapacity)
+            : (maxCapacity + count - 1) / count;
+    mShards.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        mShards.emplace_back(new Shard(shardCapacity));
+    }
+}
+
+template <typename TKey, typename TValue>
+void ShardedLruCache<TKey, TValue>::setOnEntryRemovedListener(
+        OnEntryRemoved<TKey, TValue>* listener) {
+    for (auto& shard : mShards) {
+        Mutex::Autolock _l(shard->lock);
+        shard->cache.setOnEntryRemovedListener(listener);
+    }
+}
+
+template <typename TKey, typename TValue>
+size_t ShardedLruCache<TKey, TValue>::size() const {
+    size_t total = 0;
+    for (auto& shard : mShards) {
+        Mutex::Autolock _l(shard->lock);
+        total += shard->cache.size();
+    }
+    return total;
+}
+
+template <typename TKey, typename TValue>
+bool ShardedLruCache<TKey, TValue>::get(const TKey& key, TValue* outValue) {
+    Shard& shard = shardFor(key);
+    Mutex::Autolock _l(shard.lock);
+    return shard.cache.get(key, outValue);
+}
+
+template <typename TKey, typename TValue>
+bool ShardedLruCache<TKey, TValue>::put(const TKey& key, const TValue& value) {
+    Shard& shard = shardFor(key);
+    Mutex::Autolock _l(shard.lock);
+    return shard.cache.put(key, value);
+}
+
+template <typename TKey, typename TValue>
+bool ShardedLruCache<TKey, TValue>::remove(const TKey& key) {
+    Shard& shard = shardFor(key);
+    Mutex::Autolock _l(shard.lock);
+    return shard.cache.remove(key);
+}
+
+template <typename TKey, typename TValue>
+void ShardedLruCache<TKey, TValue>::clear() {
+    for (auto& shard : mShards) {
+        Mutex::Autolock _l(shard->lock);
+        shard->cache.clear();
+    }
+}
+
+}  // namespace android
+
+#endif  // ANDROID_UTILS_SHARDED_LRU_CACHE_H
@@ -160,7 +160,12 @@ SortedVector<TYPE>::SortedVector()
     : SortedVectorImpl(sizeof(TYPE),
                 ((traits<TYPE>::has_trivial_ctor   ? HAS_TRIVIAL_CTOR   : 0)
                 |(traits<TYPE>::has_trivial_dtor   ? HAS_TRIVIAL_DTOR   : 0)
-                |(traits<TYPE>::has_trivial_copy   ? HAS_TRIVIAL_COPY   : 0))
+                |(traits<TYPE>::has_trivial_copy   ? HAS_TRIVIAL_COPY   : 0)
+                // same condition under which move_forward_type() in
+                // TypeHelpers.h degenerates to memmove()
+                |((traits<TYPE>::has_trivial_move
+                    || (traits<TYPE>::has_trivial_dtor && traits<TYPE>::has_trivial_copy))
+                                                   ? HAS_TRIVIAL_MOVE   : 0))
                 )
 {
 }
@@ -30,6 +30,11 @@ class StopWatch
 {
 public:
   StopWatch(const char* name, int clock = SYSTEM_TIME_MONOTONIC);
+
+  // Reads timestamps from the batch instead of the clock; the caller
+  // decides when the batch refreshes.  The batch must outlive the watch.
+  StopWatch(const char* name, TimestampBatch& batch);
+
   ~StopWatch();
 
   const char* name() const;
@@ -39,9 +44,12 @@ public:
   void reset();
 
 private:
+    nsecs_t now() const;
+
     const char*     mName;
     int             mClock;
-    
+    TimestampBatch* mBatch;
+
     struct lap_t {
         nsecs_t     soFar;
         nsecs_t     thisLap;
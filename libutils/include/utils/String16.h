@@ -134,12 +134,24 @@ public:
     void* edit();
     void* editResize(size_t new_size);
 
+    status_t setFromUTF8(const char* u8str, size_t u8len);
+
     void acquire();
     void release();
 
     size_t staticStringSize() const;
 
+    /*
+     * Strings short enough to fit in mData (including the terminator) are
+     * stored inline with mString null; longer strings keep the SharedBuffer
+     * or static storage behind mString.  mString being the discriminator
+     * keeps the object trivially movable (see ANDROID_TRIVIAL_MOVE_TRAIT
+     * below).
+     */
+    static constexpr size_t kSSOBufSize = 8;
+
     const char16_t* mString;
+    char16_t mData[kSSOBufSize];
 
 protected:
     /*
@@ -175,11 +187,11 @@ protected:
     }
 
     template <size_t N>
-    explicit constexpr String16(const StaticData<N>& s) : mString(s.data) {}
+    explicit constexpr String16(const StaticData<N>& s) : mString(s.data), mData{} {}
 
 public:
     template <size_t N>
-    explicit constexpr String16(const StaticString16<N>& s) : mString(s.mString) {}
+    explicit constexpr String16(const StaticString16<N>& s) : mString(s.mString), mData{} {}
 };
 
 // String16 can be trivially moved using memcpy() because moving does not
@@ -242,7 +254,7 @@ inline int strictly_order_type(const String16& lhs, const String16& rhs)
 
 inline const char16_t* String16::string() const
 {
-    return mString;
+    return mString ? mString : mData;
 }
 
 inline std::string String16::std_string(const String16& str)
@@ -271,72 +283,72 @@ inline String16 String16::operator+(const String16& other) const
 
 inline int String16::compare(const String16& other) const
 {
-    return strzcmp16(mString, size(), other.mString, other.size());
+    return strzcmp16(string(), size(), other.string(), other.size());
 }
 
 inline bool String16::operator<(const String16& other) const
 {
-    return strzcmp16(mString, size(), other.mString, other.size()) < 0;
+    return strzcmp16(string(), size(), other.string(), other.size()) < 0;
 }
 
 inline bool String16::operator<=(const String16& other) const
 {
-    return strzcmp16(mString, size(), other.mString, other.size()) <= 0;
+    return strzcmp16(string(), size(), other.string(), other.size()) <= 0;
 }
 
 inline bool String16::operator==(const String16& other) const
 {
-    return strzcmp16(mString, size(), other.mString, other.size()) == 0;
+    return strzcmp16(string(), size(), other.string(), other.size()) == 0;
 }
 
 inline bool String16::operator!=(const String16& other) const
 {
-    return strzcmp16(mString, size(), other.mString, other.size()) != 0;
+    return strzcmp16(string(), size(), other.string(), other.size()) != 0;
 }
 
 inline bool String16::operator>=(const String16& other) const
 {
-    return strzcmp16(mString, size(), other.mString, other.size()) >= 0;
+    return strzcmp16(string(), size(), other.string(), other.size()) >= 0;
 }
 
 inline bool String16::operator>(const String16& other) const
 {
-    return strzcmp16(mString, size(), other.mString, other.size()) > 0;
+    return strzcmp16(string(), size(), other.string(), other.size()) > 0;
 }
 
 inline bool String16::operator<(const char16_t* other) const
 {
-    return strcmp16(mString, other) < 0;
+    return strcmp16(string(), other) < 0;
 }
 
 inline bool String16::operator<=(const char16_t* other) const
 {
-    return strcmp16(mString, other) <= 0;
+    return strcmp16(string(), other) <= 0;
 }
 
 inline bool String16::operator==(const char16_t* other) const
 {
-    return strcmp16(mString, other) == 0;
+    return strcmp16(string(), other) == 0;
 }
 
 inline bool String16::operator!=(const char16_t* other) const
 {
-    return strcmp16(mString, other) != 0;
+    return strcmp16(string(), other) != 0;
 }
 
 inline bool String16::operator>=(const char16_t* other) const
 {
-    return strcmp16(mString, other) >= 0;
+    return strcmp16(string(), other) >= 0;
 }
 
 inline bool String16::operator>(const char16_t* other) const
 {
-    return strcmp16(mString, other) > 0;
+    return strcmp16(string(), other) > 0;
 }
 
 inline String16::operator const char16_t*() const
 {
-    return mString;
+    return string();
 }
 
 }  // namespace android
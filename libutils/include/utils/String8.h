@@ -226,7 +226,23 @@ private:
             status_t            real_append(const char* other, size_t numChars);
             char*               find_extension(void) const;
 
+            status_t            setInternal(const char* other, size_t numChars);
+            status_t            setFromUTF16(const char16_t* other, size_t numChars);
+            status_t            setFromUTF32(const char32_t* other, size_t numChars);
+            void                releaseStorage();
+
+    /*
+     * Strings short enough to fit in mData (including the terminator) are
+     * stored inline and mString is null; anything longer lives in a ref
+     * counted SharedBuffer that mString points into.  Short property and
+     * path strings dominate in practice, so this avoids an allocation for
+     * most instances.  mString being the discriminator keeps the object
+     * trivially movable (see ANDROID_TRIVIAL_MOVE_TRAIT below).
+     */
+    static constexpr size_t kSSOBufSize = 16;
+
             const char* mString;
+            char mData[kSSOBufSize];
 };
 
 // String8 can be trivially moved using memcpy() because moving does not
@@ -257,11 +273,11 @@ inline const String8 String8::empty() {
 
 inline const char* String8::c_str() const
 {
-    return mString;
+    return mString ? mString : mData;
 }
 inline const char* String8::string() const
 {
-    return mString;
+    return c_str();
 }
 
 inline std::string String8::std_string(const String8& str)
@@ -329,72 +345,72 @@ inline String8 String8::operator+(const char* other) const
 
 inline int String8::compare(const String8& other) const
 {
-    return strcmp(mString, other.mString);
+    return strcmp(c_str(), other.c_str());
 }
 
 inline bool String8::operator<(const String8& other) const
 {
-    return strcmp(mString, other.mString) < 0;
+    return strcmp(c_str(), other.c_str()) < 0;
 }
 
 inline bool String8::operator<=(const String8& other) const
 {
-    return strcmp(mString, other.mString) <= 0;
+    return strcmp(c_str(), other.c_str()) <= 0;
 }
 
 inline bool String8::operator==(const String8& other) const
 {
-    return strcmp(mString, other.mString) == 0;
+    return strcmp(c_str(), other.c_str()) == 0;
 }
 
 inline bool String8::operator!=(const String8& other) const
 {
-    return strcmp(mString, other.mString) != 0;
+    return strcmp(c_str(), other.c_str()) != 0;
 }
 
 inline bool String8::operator>=(const String8& other) const
 {
-    return strcmp(mString, other.mString) >= 0;
+    return strcmp(c_str(), other.c_str()) >= 0;
 }
 
 inline bool String8::operator>(const String8& other) const
 {
-    return strcmp(mString, other.mString) > 0;
+    return strcmp(c_str(), other.c_str()) > 0;
 }
 
 inline bool String8::operator<(const char* other) const
 {
-    return strcmp(mString, other) < 0;
+    return strcmp(c_str(), other) < 0;
 }
 
 inline bool String8::operator<=(const char* other) const
 {
-    return strcmp(mString, other) <= 0;
+    return strcmp(c_str(), other) <= 0;
 }
 
 inline bool String8::operator==(const char* other) const
 {
-    return strcmp(mString, other) == 0;
+    return strcmp(c_str(), other) == 0;
 }
 
 inline bool String8::operator!=(const char* other) const
 {
-    return strcmp(mString, other) != 0;
+    return strcmp(c_str(), other) != 0;
 }
 
 inline bool String8::operator>=(const char* other) const
 {
-    return strcmp(mString, other) >= 0;
+    return strcmp(c_str(), other) >= 0;
 }
 
 inline bool String8::operator>(const char* other) const
 {
-    return strcmp(mString, other) > 0;
+    return strcmp(c_str(), other) > 0;
 }
 
 inline String8::operator const char*() const
 {
-    return mString;
+    return c_str();
 }
 
 }  // namespace android
@@ -87,6 +87,26 @@ nsecs_t systemTime(int clock = SYSTEM_TIME_MONOTONIC);
 nsecs_t systemTime(int clock);
 #endif // def __cplusplus
 
+// Like systemTime(), but reads the coarse variant of the clock where one
+// exists (CLOCK_REALTIME_COARSE / CLOCK_MONOTONIC_COARSE on Linux): served
+// from the vDSO without a hardware clock read, at tick (~1-10ms) resolution.
+// Clocks without a coarse variant fall back to the precise read.
+#ifdef __cplusplus
+nsecs_t systemTimeCoarse(int clock = SYSTEM_TIME_MONOTONIC);
+#else
+nsecs_t systemTimeCoarse(int clock);
+#endif // def __cplusplus
+
+// Returns the coarse monotonic timestamp captured by the last
+// systemTimeCacheRefresh() without touching the clock at all.  Returns 0
+// before the first refresh.  Intended for hot paths that can tolerate a
+// timestamp as stale as the caller's refresh cadence.
+nsecs_t systemTimeCached(void);
+
+// Re-samples the coarse monotonic clock into the cache read by
+// systemTimeCached() and returns the fresh value.
+nsecs_t systemTimeCacheRefresh(void);
+
 /**
  * Returns the number of milliseconds to wait between the reference time and the timeout time.
  * If the timeout is in the past relative to the reference time, returns 0.
@@ -99,4 +119,37 @@ int toMillisecondTimeoutDelay(nsecs_t referenceTime, nsecs_t timeoutTime);
 
 #ifdef __cplusplus
 } // extern "C"
+
+// ------------------------------------------------------------------
+// C++ API
+
+namespace android {
+
+/**
+ * Amortizes one clock read across several nearby timestamps.
+ *
+ * refresh() samples the clock once; timestamp() then hands out that sample
+ * with no clock access until the next refresh().  Profiling layers that
+ * bracket every operation with timestamps can refresh once per event and
+ * share the sample between all interested observers (see StopWatch).
+ */
+class TimestampBatch {
+public:
+    explicit TimestampBatch(int clock = SYSTEM_TIME_MONOTONIC)
+        : mClock(clock), mSample(systemTime(clock)) {}
+
+    /** Samples the clock and makes the new value current. */
+    nsecs_t refresh() { return mSample = systemTime(mClock); }
+
+    /** Returns the current sample without touching the clock. */
+    nsecs_t timestamp() const { return mSample; }
+
+    int clock() const { return mClock; }
+
+private:
+    int     mClock;
+    nsecs_t mSample;
+};
+
+}  // namespace android
 #endif
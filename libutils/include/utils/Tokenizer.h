@@ -18,6 +18,7 @@
 #define _UTILS_TOKENIZER_H
 
 #include <assert.h>
+#include <string_view>
 #include <utils/Errors.h>
 #include <utils/FileMap.h>
 #include <utils/String8.h>
@@ -88,6 +89,13 @@ public:
      */
     String8 peekRemainderOfLine() const;
 
+    /**
+     * Like peekRemainderOfLine() but returns a view aliasing the underlying
+     * buffer instead of copying it.  The view is only valid for the lifetime
+     * of the tokenizer.
+     */
+    std::string_view peekRemainderOfLineView() const;
+
     /**
      * Gets the character at the current position and advances past it.
      * Returns null at end of file.
@@ -103,12 +111,25 @@ public:
      */
     String8 nextToken(const char* delimiters);
 
+    /**
+     * Like nextToken() but returns a view aliasing the underlying buffer
+     * instead of copying it.  The view is only valid for the lifetime of
+     * the tokenizer.
+     */
+    std::string_view nextTokenView(const char* delimiters);
+
     /**
      * Advances to the next line.
      * Does nothing if already at the end of the file.
      */
     void nextLine();
 
+    /**
+     * Advances to the end of the current line (the newline character, or the
+     * end of the file if there is none) without consuming it.
+     */
+    void skipToEol();
+
     /**
      * Skips over the specified delimiters in the line.
      * Also skips embedded nulls.
@@ -44,6 +44,9 @@ public:
         HAS_TRIVIAL_CTOR    = 0x00000001,
         HAS_TRIVIAL_DTOR    = 0x00000002,
         HAS_TRIVIAL_COPY    = 0x00000004,
+        // the item type can be relocated with memmove(), so moves skip the
+        // virtual do_move_forward()/do_move_backward() dispatch entirely
+        HAS_TRIVIAL_MOVE    = 0x00000008,
     };
 
                             VectorImpl(size_t itemSize, uint32_t flags);
@@ -68,7 +68,6 @@ constexpr pid_t kthreaddPid = 2;
 constexpr char procdir[] = "/proc/";
 
 // Configuration
-milliseconds llkUpdate;                              // last check ms signature
 milliseconds llkCycle;                               // ms to next thread check
 bool llkEnable = LLK_ENABLE_DEFAULT;                 // llk daemon enabled
 bool llkRunning = false;                             // thread is running
@@ -283,7 +282,9 @@ struct proc {
     uint64_t nrSwitches;           // /proc/<tid>/sched "nr_switches" for
                                    // refined ABA problem detection, determine
                                    // forward scheduling progress.
-    milliseconds update;           // llkUpdate millisecond signature of last.
+    uint64_t starttime;            // /proc/<tid>/stat field 22 start time,
+                                   // with tid forms the task's identity to
+                                   // detect tid number reuse.
     milliseconds count;            // duration in state.
 #ifdef __PTRACE_ENABLED__          // Privileged state checking
     milliseconds count_stack;      // duration where stack is stagnant.
@@ -301,6 +302,10 @@ struct proc {
     char stack;                    // index in llkCheckStackSymbols for matches
 #endif                             // and with maximum index PROP_VALUE_MAX/2.
     char comm[TASK_COMM_LEN + 3];  // space for adding '[' and ']'
+#ifdef __PTRACE_ENABLED__          // Privileged state checking
+    bool stackSkip;                // llkIgnorelistStack match, blocks ptrace
+    bool stackSkipValid;           // stackSkip has been cached
+#endif                             // End privilege
     bool exeMissingValid;          // exeMissing has been cached
     bool cmdlineValid;             // cmdline has been cached
     bool updated;                  // cleared before monitoring pass.
@@ -311,11 +316,12 @@ struct proc {
 
     void setFrozen(bool _frozen) { frozen = _frozen; }
 
-    proc(pid_t tid, pid_t pid, pid_t ppid, const char* _comm, int time, char state, bool frozen)
+    proc(pid_t tid, pid_t pid, pid_t ppid, const char* _comm, int time, uint64_t starttime,
+         char state, bool frozen)
         : tid(tid),
           schedUpdate(0),
           nrSwitches(0),
-          update(llkUpdate),
+          starttime(starttime),
           count(0ms),
 #ifdef __PTRACE_ENABLED__
           count_stack(0ms),
@@ -327,6 +333,8 @@ struct proc {
           state(state),
 #ifdef __PTRACE_ENABLED__
           stack(-1),
+          stackSkip(false),
+          stackSkipValid(false),
 #endif
           exeMissingValid(false),
           cmdlineValid(false),
@@ -386,6 +394,7 @@ struct proc {
 #ifdef __PTRACE_ENABLED__
         count_stack = 0ms;
         stack = -1;
+        stackSkipValid = false;
 #endif
         cmdline = "";
         comm[0] = '\0';
@@ -599,9 +608,10 @@ void llkTidRemove(pid_t tid) {
     tids.erase(tid);
 }
 
-proc* llkTidAlloc(pid_t tid, pid_t pid, pid_t ppid, const char* comm, int time, char state,
-                  bool frozen) {
-    auto it = tids.emplace(std::make_pair(tid, proc(tid, pid, ppid, comm, time, state, frozen)));
+proc* llkTidAlloc(pid_t tid, pid_t pid, pid_t ppid, const char* comm, int time,
+                  uint64_t starttime, char state, bool frozen) {
+    auto it = tids.emplace(
+            std::make_pair(tid, proc(tid, pid, ppid, comm, time, starttime, state, frozen)));
     return &it.first->second;
 }
 
@@ -802,7 +812,7 @@ long long getSchedValue(const std::string& schedString, const char* key) {
 }
 
 #ifdef __PTRACE_ENABLED__
-bool llkCheckStack(proc* procp, const std::string& piddir) {
+bool llkCheckStack(proc* procp, const std::string& piddir, timespec* cycleStart) {
     if (llkCheckStackSymbols.empty()) return false;
     if (procp->state == 'Z') {  // No brains for Zombies
         procp->stack = -1;
@@ -811,7 +821,21 @@ bool llkCheckStack(proc* procp, const std::string& piddir) {
     }
 
     // Don't check process that are known to block ptrace, save sepolicy noise.
-    if (llkSkipProc(procp, llkIgnorelistStack)) return false;
+    // The ignorelist match is stable for the life of the task, so pay for the
+    // name lookups once rather than on every cycle.
+    if (!procp->stackSkipValid) {
+        procp->stackSkip = llkSkipProc(procp, llkIgnorelistStack);
+        procp->stackSkipValid = true;
+    }
+    if (procp->stackSkip) return false;
+
+    // Bound total stack sampling per cycle so mitigation latency stays flat
+    // as the candidate count grows; candidates skipped here pick up again
+    // next cycle.
+    timespec now;
+    ::clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+    if (llkGetTimespecDiffMs(cycleStart, &now) > (llkCycle / 2)) return false;
+
     auto kernel_stack = ReadFile(piddir + "/stack");
     if (kernel_stack.empty()) {
         LOG(VERBOSE) << piddir << "/stack empty comm=" << procp->getComm()
@@ -845,6 +869,10 @@ bool llkCheckStack(proc* procp, const std::string& piddir) {
 }
 #endif
 
+// /proc/<tid>/sched is absent on kernels without CONFIG_SCHED_DEBUG.  Cache
+// the discovery so that candidates do not pay for a failed read every cycle.
+bool llkSchedExists = true;
+
 // Primary ABA mitigation watching last time schedule activity happened
 void llkCheckSchedUpdate(proc* procp, const std::string& piddir) {
     // Audit finds /proc/<tid>/sched is just over 1K, and
@@ -856,7 +884,10 @@ void llkCheckSchedUpdate(proc* procp, const std::string& piddir) {
     // Proc entries can not be read >1K atomically via libbase,
     // but if there are problems we assume at least a few
     // samples of reads occur before we take any real action.
-    std::string schedString = ReadFile(piddir + "/sched");
+    std::string schedString;
+    if (llkSchedExists) {
+        schedString = ReadFile(piddir + "/sched");
+    }
     if (schedString.empty()) {
         // /schedstat is not as standardized, but in 3.1+
         // Android devices, the third field is nr_switches
@@ -865,6 +896,8 @@ void llkCheckSchedUpdate(proc* procp, const std::string& piddir) {
         if (schedString.empty()) {
             return;
         }
+        // procfs is clearly readable here, so /sched is not configured.
+        llkSchedExists = false;
         auto val = static_cast<unsigned long long>(-1);
         if (((::sscanf(schedString.c_str(), "%*d %*d %llu", &val)) == 1) &&
             (val != static_cast<unsigned long long>(-1)) && (val != 0) &&
@@ -992,8 +1025,6 @@ milliseconds llkCheck(bool checkRunning) {
         it.second.updated = false;
     }
 
-    auto prevUpdate = llkUpdate;
-    llkUpdate += ms;
     ms -= llkCycle;
     auto myPid = ::getpid();
     auto myTid = ::gettid();
@@ -1031,44 +1062,59 @@ milliseconds llkCheck(bool checkRunning) {
             unsigned utime = -1;
             unsigned stime = -1;
             int dummy;
+            unsigned long long starttime = 0;
             pdir[0] = '\0';
             // tid should not change value
             auto match = ::sscanf(
                 stat.c_str(),
                 "%u (%" ___STRING(
-                    TASK_COMM_LEN) "[^)]) %c %u %*d %*d %*d %*d %*d %*d %*d %*d %*d %u %u %d",
-                &tid, pdir, &state, &ppid, &utime, &stime, &dummy);
+                    TASK_COMM_LEN) "[^)]) %c %u %*d %*d %*d %*d %*d %*d %*d %*d %*d %u %u %d"
+                                   " %*d %*d %*d %*d %*d %llu",
+                &tid, pdir, &state, &ppid, &utime, &stime, &dummy, &starttime);
             if (pid == -1) {
                 pid = tid;
             }
             LOG(VERBOSE) << "match " << match << ' ' << tid << " (" << pdir << ") " << state << ' '
-                         << ppid << " ... " << utime << ' ' << stime << ' ' << dummy;
-            if (match != 7) {
+                         << ppid << " ... " << utime << ' ' << stime << ' ' << starttime;
+            if (match != 8) {
                 continue;
             }
 
-            // Get the process cgroup
-            auto cgroup = ReadFile(piddir + "/cgroup");
-            auto frozen = cgroup.find(":freezer:/frozen") != std::string::npos;
+            // Get the process cgroup, but only for tasks the filters below
+            // will look at.  At steady state nearly every task is running or
+            // sleeping, and skipping the read here saves a file read per
+            // task per cycle.
+#ifdef __PTRACE_ENABLED__
+            auto needFrozen = llkIsMonitorState(state) || !llkCheckStackSymbols.empty();
+#else
+            auto needFrozen = llkIsMonitorState(state);
+#endif
+            auto frozen = false;
+            if (needFrozen) {
+                auto cgroup = ReadFile(piddir + "/cgroup");
+                frozen = cgroup.find(":freezer:/frozen") != std::string::npos;
+            }
 
             auto procp = llkTidLookup(tid);
             if (procp == nullptr) {
-                procp = llkTidAlloc(tid, pid, ppid, pdir, utime + stime, state, frozen);
+                procp = llkTidAlloc(tid, pid, ppid, pdir, utime + stime, starttime, state, frozen);
             } else {
                 // comm can change ...
                 procp->setComm(pdir);
                 // frozen can change, too...
-                procp->setFrozen(frozen);
+                if (needFrozen) {
+                    procp->setFrozen(frozen);
+                }
                 procp->updated = true;
-                // pid/ppid/tid wrap?
-                if (((procp->update != prevUpdate) && (procp->update != llkUpdate)) ||
-                    (procp->ppid != ppid) || (procp->pid != pid)) {
+                // tid number reuse?  start time is the authoritative check,
+                // everything cached belongs to the old task if it moved.
+                if ((procp->starttime != starttime) || (procp->pid != pid)) {
                     procp->reset();
                 } else if (procp->time != (utime + stime)) {  // secondary ABA.
                     // watching utime+stime granularity jiffy
                     procp->state = '?';
                 }
-                procp->update = llkUpdate;
+                procp->starttime = starttime;
                 procp->pid = pid;
                 procp->ppid = ppid;
                 procp->time = utime + stime;
@@ -1118,7 +1164,7 @@ milliseconds llkCheck(bool checkRunning) {
 
             auto pprocp = llkTidLookup(ppid);
             if (pprocp == nullptr) {
-                pprocp = llkTidAlloc(ppid, ppid, 0, "", 0, '?', false);
+                pprocp = llkTidAlloc(ppid, ppid, 0, "", 0, 0, '?', false);
             }
             if (pprocp) {
                 if (llkSkipPproc(pprocp, procp)) break;
@@ -1135,7 +1181,7 @@ milliseconds llkCheck(bool checkRunning) {
             llkCheckSchedUpdate(procp, piddir);
 
 #ifdef __PTRACE_ENABLED__
-            auto stuck = llkCheckStack(procp, piddir);
+            auto stuck = llkCheckStack(procp, piddir, &now);
             if (llkIsMonitorState(state)) {
                 if (procp->count >= llkStateTimeoutMs[(state == 'Z') ? llkStateZ : llkStateD]) {
                     stuck = true;
@@ -141,11 +141,28 @@ class TrieNode {
   const TrieNodeInternal* trie_node_base_;
 };
 
+// Caches the trie walk taken by the last lookup.  Property sets cluster under the same prefixes,
+// so the next lookup usually revisits the same nodes; verifying a cached child costs one strncmp
+// instead of a binary search of the child array.  The cache only holds pointers into the
+// serialized area, so it must be dropped if the area is unmapped, and callers are responsible
+// for not sharing it between threads.
+struct PropertyInfoLookupCache {
+  static constexpr uint32_t kMaxDepth = 16;
+  uint32_t depth = 0;
+  TrieNode nodes[kMaxDepth];
+};
+
 class PropertyInfoArea : private SerializedData {
  public:
   void GetPropertyInfoIndexes(const char* name, uint32_t* context_index, uint32_t* type_index) const;
   void GetPropertyInfo(const char* property, const char** context, const char** type) const;
 
+  // As above, but memoizing the trie walk in cache across calls.
+  void GetPropertyInfoIndexes(const char* name, uint32_t* context_index, uint32_t* type_index,
+                              PropertyInfoLookupCache* cache) const;
+  void GetPropertyInfo(const char* property, const char** context, const char** type,
+                       PropertyInfoLookupCache* cache) const;
+
   int FindContextIndex(const char* context) const;
   int FindTypeIndex(const char* type) const;
 
@@ -109,10 +109,17 @@ void PropertyInfoArea::CheckPrefixMatch(const char* remaining_name, const TrieNo
 
 void PropertyInfoArea::GetPropertyInfoIndexes(const char* name, uint32_t* context_index,
                                               uint32_t* type_index) const {
+  GetPropertyInfoIndexes(name, context_index, type_index, nullptr);
+}
+
+void PropertyInfoArea::GetPropertyInfoIndexes(const char* name, uint32_t* context_index,
+                                              uint32_t* type_index,
+                                              PropertyInfoLookupCache* cache) const {
   uint32_t return_context_index = ~0u;
   uint32_t return_type_index = ~0u;
   const char* remaining_name = name;
   auto trie_node = root_node();
+  uint32_t depth = 0;
   while (true) {
     const char* sep = strchr(remaining_name, '.');
 
@@ -134,12 +141,34 @@ void PropertyInfoArea::GetPropertyInfoIndexes(const char* name, uint32_t* contex
 
     const uint32_t substr_size = sep - remaining_name;
     TrieNode child_node;
-    if (!trie_node.FindChildForString(remaining_name, substr_size, &child_node)) {
-      break;
+    bool found_child = false;
+    // If the previous lookup descended into the same child at this depth, a single strncmp
+    // verifies the cached node and the binary search of the child array is skipped.  A cached
+    // node is only consulted while every shallower segment of this lookup has also hit the
+    // cache; any refresh below truncates the deeper entries.
+    if (cache != nullptr && depth < cache->depth) {
+      const char* child_name = cache->nodes[depth].name();
+      if (!strncmp(child_name, remaining_name, substr_size) && child_name[substr_size] == '\0') {
+        child_node = cache->nodes[depth];
+        found_child = true;
+      }
+    }
+    if (!found_child) {
+      if (!trie_node.FindChildForString(remaining_name, substr_size, &child_node)) {
+        if (cache != nullptr && depth < cache->depth) {
+          cache->depth = depth;
+        }
+        break;
+      }
+      if (cache != nullptr && depth < PropertyInfoLookupCache::kMaxDepth) {
+        cache->nodes[depth] = child_node;
+        cache->depth = depth + 1;
+      }
     }
 
     trie_node = child_node;
     remaining_name = sep + 1;
+    ++depth;
   }
 
   // We've made it to a leaf node, so check contents and return appropriately.
@@ -173,9 +202,14 @@ void PropertyInfoArea::GetPropertyInfoIndexes(const char* name, uint32_t* contex
 
 void PropertyInfoArea::GetPropertyInfo(const char* property, const char** context,
                                        const char** type) const {
+  GetPropertyInfo(property, context, type, nullptr);
+}
+
+void PropertyInfoArea::GetPropertyInfo(const char* property, const char** context,
+                                       const char** type, PropertyInfoLookupCache* cache) const {
   uint32_t context_index;
   uint32_t type_index;
-  GetPropertyInfoIndexes(property, &context_index, &type_index);
+  GetPropertyInfoIndexes(property, &context_index, &type_index, cache);
   if (context != nullptr) {
     if (context_index == ~0u) {
       *context = nullptr;
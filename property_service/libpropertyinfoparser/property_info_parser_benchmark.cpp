@@ -0,0 +1,111 @@
+//
+// Copyright (C) 2026 The Android Open Source Project
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <property_info_parser/property_info_parser.h>
+#include <property_info_serializer/property_info_serializer.h>
+
+namespace android {
+namespace properties {
+
+namespace {
+
+// A trie shaped like a device's property_contexts: a handful of contexts, most
+// properties resolved by prefix matches clustered under a few top level names.
+std::string BuildTestTrie() {
+  std::vector<PropertyInfoEntry> entries;
+  const char* prefixes[] = {
+      "ro.boot",    "ro.product",  "ro.vendor",  "ro.hardware", "init.svc",
+      "persist.sys", "persist.vendor", "sys.usb", "vendor.audio", "dev.mnt.blk",
+  };
+  for (const auto& prefix : prefixes) {
+    entries.emplace_back(prefix, std::string("u:object_r:") + prefix + ":s0", "string", false);
+    for (int i = 0; i < 20; ++i) {
+      auto name = std::string(prefix) + ".entry" + std::to_string(i);
+      entries.emplace_back(name, std::string("u:object_r:") + prefix + ":s0", "string", true);
+    }
+  }
+
+  std::string serialized_trie;
+  std::string error;
+  if (!BuildTrie(entries, "u:object_r:default_prop:s0", "string", &serialized_trie, &error)) {
+    return std::string();
+  }
+  return serialized_trie;
+}
+
+// The lookups a property set burst makes: long runs of names under the same
+// prefix, as seen when init replays a boot's worth of setprops.
+std::vector<std::string> BuildBootTrace() {
+  std::vector<std::string> trace;
+  const char* prefixes[] = {"ro.boot", "init.svc", "sys.usb", "persist.vendor", "vendor.audio"};
+  for (const auto& prefix : prefixes) {
+    for (int i = 0; i < 20; ++i) {
+      trace.emplace_back(std::string(prefix) + ".entry" + std::to_string(i % 5));
+    }
+  }
+  return trace;
+}
+
+}  // namespace
+
+static void BenchmarkGetPropertyInfo(benchmark::State& state) {
+  auto serialized_trie = BuildTestTrie();
+  auto trace = BuildBootTrace();
+  auto property_info_area = reinterpret_cast<const PropertyInfoArea*>(serialized_trie.data());
+
+  while (state.KeepRunning()) {
+    for (const auto& name : trace) {
+      const char* context;
+      const char* type;
+      property_info_area->GetPropertyInfo(name.c_str(), &context, &type);
+      benchmark::DoNotOptimize(context);
+      benchmark::DoNotOptimize(type);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * trace.size());
+}
+
+BENCHMARK(BenchmarkGetPropertyInfo);
+
+static void BenchmarkGetPropertyInfoCached(benchmark::State& state) {
+  auto serialized_trie = BuildTestTrie();
+  auto trace = BuildBootTrace();
+  auto property_info_area = reinterpret_cast<const PropertyInfoArea*>(serialized_trie.data());
+  PropertyInfoLookupCache cache;
+
+  while (state.KeepRunning()) {
+    for (const auto& name : trace) {
+      const char* context;
+      const char* type;
+      property_info_area->GetPropertyInfo(name.c_str(), &context, &type, &cache);
+      benchmark::DoNotOptimize(context);
+      benchmark::DoNotOptimize(type);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * trace.size());
+}
+
+BENCHMARK(BenchmarkGetPropertyInfoCached);
+
+}  // namespace properties
+}  // namespace android
+
+BENCHMARK_MAIN();
@@ -40,6 +40,16 @@ bool BuildTrie(const std::vector<PropertyInfoEntry>& property_info,
                const std::string& default_context, const std::string& default_type,
                std::string* serialized_trie, std::string* error);
 
+// As BuildTrie, but additionally takes the property names observed in a captured access
+// trace (one entry per lookup; repeat names to weight them).  Trie nodes are laid out in
+// order of observed access frequency, so lookups of hot prefixes touch the leading pages
+// of the serialized area rather than faulting in pages scattered across it.  The result
+// is read by the same parser as a trie built without hints.
+bool BuildTrieWithAccessHints(const std::vector<PropertyInfoEntry>& property_info,
+                              const std::string& default_context, const std::string& default_type,
+                              const std::vector<std::string>& accessed_properties,
+                              std::string* serialized_trie, std::string* error);
+
 void ParsePropertyInfoFile(const std::string& file_contents, bool require_prefix_or_exact,
                            std::vector<PropertyInfoEntry>* property_infos,
                            std::vector<std::string>* errors);
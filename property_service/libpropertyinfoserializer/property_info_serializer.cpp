@@ -43,5 +43,29 @@ bool BuildTrie(const std::vector<PropertyInfoEntry>& property_info,
   return true;
 }
 
+bool BuildTrieWithAccessHints(const std::vector<PropertyInfoEntry>& property_info,
+                              const std::string& default_context, const std::string& default_type,
+                              const std::vector<std::string>& accessed_properties,
+                              std::string* serialized_trie, std::string* error) {
+  // Check that names are legal first
+  auto trie_builder = TrieBuilder(default_context, default_type);
+
+  for (const auto& [name, context, type, is_exact] : property_info) {
+    if (!trie_builder.AddToTrie(name, context, type, is_exact, error)) {
+      return false;
+    }
+  }
+
+  // Hints only influence node layout, so names that don't resolve in the trie are ignored
+  // rather than errors; a trace naturally contains properties with no specific entry.
+  for (const auto& accessed_property : accessed_properties) {
+    trie_builder.AddAccessHint(accessed_property);
+  }
+
+  auto trie_serializer = TrieSerializer();
+  *serialized_trie = trie_serializer.SerializeTrie(trie_builder);
+  return true;
+}
+
 }  // namespace properties
 }  // namespace android
@@ -248,6 +248,95 @@ TEST(propertyinfoserializer, GetPropertyInfo) {
   EXPECT_STREQ("9th", type);
 }
 
+TEST(propertyinfoserializer, GetPropertyInfoCached) {
+  auto property_info = std::vector<PropertyInfoEntry>{
+      {"test.", "1st", "1st", false},       {"test.test", "2nd", "2nd", false},
+      {"test.test2.", "6th", "6th", false}, {"test.test", "5th", "5th", true},
+      {"test.test1", "3rd", "3rd", true},   {"test.test2", "7th", "7th", true},
+      {"test.test3", "3rd", "3rd", true},   {"this.is.a.long.string", "4th", "4th", true},
+      {"testoneword", "8th", "8th", true},  {"testwordprefix", "9th", "9th", false},
+  };
+
+  auto serialized_trie = std::string();
+  auto build_trie_error = std::string();
+  ASSERT_TRUE(BuildTrie(property_info, "default", "default", &serialized_trie, &build_trie_error))
+      << build_trie_error;
+
+  auto property_info_area = reinterpret_cast<const PropertyInfoArea*>(serialized_trie.data());
+
+  // The order forces cache hits, partial hits, full misses, and truncation after descending a
+  // deeper branch; cached lookups must match the uncached ones for every name regardless of
+  // what came before them.
+  const char* lookup_order[] = {
+      "test.test.a",  "test.test.b",          "test.test1", "test.a",
+      "abc.abc",      "this.is.a.long.string", "this.is.a",  "test.test2.a",
+      "test.test2.a", "testwordprefix.blah",  "abc",        "test.test.a",
+  };
+
+  PropertyInfoLookupCache cache;
+  for (const char* name : lookup_order) {
+    const char* context;
+    const char* type;
+    property_info_area->GetPropertyInfo(name, &context, &type);
+    const char* cached_context;
+    const char* cached_type;
+    property_info_area->GetPropertyInfo(name, &cached_context, &cached_type, &cache);
+    EXPECT_STREQ(context, cached_context) << name;
+    EXPECT_STREQ(type, cached_type) << name;
+  }
+}
+
+TEST(propertyinfoserializer, GetPropertyInfoWithAccessHints) {
+  auto property_info = std::vector<PropertyInfoEntry>{
+      {"test.", "1st", "1st", false},       {"test.test", "2nd", "2nd", false},
+      {"test.test2.", "6th", "6th", false}, {"test.test", "5th", "5th", true},
+      {"test.test1", "3rd", "3rd", true},   {"test.test2", "7th", "7th", true},
+      {"test.test3", "3rd", "3rd", true},   {"this.is.a.long.string", "4th", "4th", true},
+      {"testoneword", "8th", "8th", true},  {"testwordprefix", "9th", "9th", false},
+  };
+
+  // Hints reorder the serialized nodes, including repeats, names with no entry of their own, and
+  // names entirely absent from the trie; none of that may change what lookups return.
+  auto accessed_properties = std::vector<std::string>{
+      "test.test2.a", "test.test2.a", "test.test2.a", "this.is.a.long.string",
+      "test.unknown", "absent.name",  "test.test",
+  };
+
+  auto serialized_trie = std::string();
+  auto build_trie_error = std::string();
+  ASSERT_TRUE(BuildTrie(property_info, "default", "default", &serialized_trie, &build_trie_error))
+      << build_trie_error;
+
+  auto hinted_serialized_trie = std::string();
+  ASSERT_TRUE(BuildTrieWithAccessHints(property_info, "default", "default", accessed_properties,
+                                       &hinted_serialized_trie, &build_trie_error))
+      << build_trie_error;
+
+  // Layout changes must not change the size of the area, only the order of nodes within it.
+  EXPECT_EQ(serialized_trie.size(), hinted_serialized_trie.size());
+
+  auto property_info_area = reinterpret_cast<const PropertyInfoArea*>(serialized_trie.data());
+  auto hinted_property_info_area =
+      reinterpret_cast<const PropertyInfoArea*>(hinted_serialized_trie.data());
+
+  const char* lookup_names[] = {
+      "test.test",    "test.test1",    "test.test2",          "test.test2.a", "test.test3",
+      "test.a",       "test.test.a",   "this.is.a.long.string", "this.is.a",  "testoneword",
+      "testwordprefix.blah", "abc.abc", "absent.name",        "test.unknown",
+  };
+
+  for (const char* name : lookup_names) {
+    const char* context;
+    const char* type;
+    property_info_area->GetPropertyInfo(name, &context, &type);
+    const char* hinted_context;
+    const char* hinted_type;
+    hinted_property_info_area->GetPropertyInfo(name, &hinted_context, &hinted_type);
+    EXPECT_STREQ(context, hinted_context) << name;
+    EXPECT_STREQ(type, hinted_type) << name;
+  }
+}
+
 TEST(propertyinfoserializer, RealProperties) {
   auto property_info = std::vector<PropertyInfoEntry>{
       // Contexts from system/sepolicy/private/property_contexts
@@ -94,6 +94,28 @@ bool TrieBuilder::AddToTrie(const std::string& name, const std::string* context,
   return true;
 }
 
+void TrieBuilder::AddAccessHint(const std::string& name) {
+  TrieBuilderNode* current_node = &builder_root_;
+
+  auto name_pieces = Split(name, ".");
+  if (name_pieces.back().empty()) {
+    name_pieces.pop_back();
+  }
+
+  // A lookup descends one node per '.'-delimited piece before the last; the final piece is
+  // matched within that node.  Stop at the first piece the trie doesn't contain, as the
+  // lookup would.
+  while (name_pieces.size() > 1) {
+    auto child = current_node->FindChild(name_pieces.front());
+    if (child == nullptr) {
+      return;
+    }
+    child->AddHit();
+    current_node = child;
+    name_pieces.erase(name_pieces.begin());
+  }
+}
+
 const std::string* TrieBuilder::StringPointerFromContainer(const std::string& string,
                                                            std::set<std::string>* container) {
   // Get a pointer to the string in a given set, such that we only ever serialize each string once.
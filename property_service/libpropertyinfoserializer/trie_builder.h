@@ -17,6 +17,8 @@
 #ifndef PROPERTY_INFO_SERIALIZER_TRIE_BUILDER_H
 #define PROPERTY_INFO_SERIALIZER_TRIE_BUILDER_H
 
+#include <stdint.h>
+
 #include <memory>
 #include <set>
 #include <string>
@@ -77,6 +79,9 @@ class TrieBuilderNode {
     return true;
   }
 
+  uint64_t hits() const { return hits_; }
+  void AddHit() { ++hits_; }
+
   const std::string& name() const { return property_entry_.name; }
   const std::string* context() const { return property_entry_.context; }
   void set_context(const std::string* context) { property_entry_.context = context; }
@@ -91,6 +96,7 @@ class TrieBuilderNode {
 
  private:
   PropertyEntryBuilder property_entry_;
+  uint64_t hits_ = 0;
   std::vector<TrieBuilderNode> children_;
   std::vector<PropertyEntryBuilder> prefixes_;
   std::vector<PropertyEntryBuilder> exact_matches_;
@@ -102,6 +108,11 @@ class TrieBuilder {
   bool AddToTrie(const std::string& name, const std::string& context, const std::string& type,
                  bool exact, std::string* error);
 
+  // Records that a lookup of |name| was observed, bumping the hit count of every trie node
+  // the lookup would visit.  The serializer lays out frequently hit nodes first, so the
+  // pages a lookup of a hot prefix touches cluster at the front of the serialized area.
+  void AddAccessHint(const std::string& name);
+
   const TrieBuilderNode builder_root() const { return builder_root_; }
   const std::set<std::string>& contexts() const { return contexts_; }
   const std::set<std::string>& types() const { return types_; }
@@ -16,6 +16,8 @@
 
 #include "trie_serializer.h"
 
+#include <queue>
+
 namespace android {
 namespace properties {
 
@@ -39,6 +41,18 @@ void TrieSerializer::SerializeStrings(const std::set<std::string>& strings) {
   }
 }
 
+uint32_t TrieSerializer::WriteString(const std::string& string) {
+  // Identical strings, such as a trailing segment shared by many properties, resolve to a single
+  // copy in the arena; readers only ever reach strings through offsets.
+  auto it = string_offsets_.find(string);
+  if (it != string_offsets_.end()) {
+    return it->second;
+  }
+  uint32_t offset = arena_->AllocateAndWriteString(string);
+  string_offsets_.emplace(string, offset);
+  return offset;
+}
+
 uint32_t TrieSerializer::WritePropertyEntry(const PropertyEntryBuilder& property_entry) {
   uint32_t context_index = property_entry.context != nullptr && !property_entry.context->empty()
                                ? serialized_info()->FindContextIndex(property_entry.context->c_str())
@@ -48,7 +62,7 @@ uint32_t TrieSerializer::WritePropertyEntry(const PropertyEntryBuilder& property
                             : ~0u;
   uint32_t offset;
   auto serialized_property_entry = arena_->AllocateObject<PropertyEntry>(&offset);
-  serialized_property_entry->name_offset = arena_->AllocateAndWriteString(property_entry.name);
+  serialized_property_entry->name_offset = WriteString(property_entry.name);
   serialized_property_entry->namelen = property_entry.name.size();
   serialized_property_entry->context_index = context_index;
   serialized_property_entry->type_index = type_index;
@@ -56,63 +70,100 @@ uint32_t TrieSerializer::WritePropertyEntry(const PropertyEntryBuilder& property
 }
 
 uint32_t TrieSerializer::WriteTrieNode(const TrieBuilderNode& builder_node) {
-  uint32_t trie_offset;
-  auto trie = arena_->AllocateObject<TrieNodeInternal>(&trie_offset);
-
-  trie->property_entry = WritePropertyEntry(builder_node.property_entry());
-
-  // Write prefix matches
-  auto sorted_prefix_matches = builder_node.prefixes();
-  // Prefixes are sorted by descending length
-  std::sort(sorted_prefix_matches.begin(), sorted_prefix_matches.end(),
-            [](const auto& lhs, const auto& rhs) { return lhs.name.size() > rhs.name.size(); });
-
-  trie->num_prefixes = sorted_prefix_matches.size();
-
-  uint32_t prefix_entries_array_offset = arena_->AllocateUint32Array(sorted_prefix_matches.size());
-  trie->prefix_entries = prefix_entries_array_offset;
-
-  for (unsigned int i = 0; i < sorted_prefix_matches.size(); ++i) {
-    uint32_t property_entry_offset = WritePropertyEntry(sorted_prefix_matches[i]);
-    arena_->uint32_array(prefix_entries_array_offset)[i] = property_entry_offset;
-  }
-
-  // Write exact matches
-  auto sorted_exact_matches = builder_node.exact_matches();
-  // Exact matches are sorted alphabetically
-  std::sort(sorted_exact_matches.begin(), sorted_exact_matches.end(),
-            [](const auto& lhs, const auto& rhs) { return lhs.name < rhs.name; });
-
-  trie->num_exact_matches = sorted_exact_matches.size();
-
-  uint32_t exact_match_entries_array_offset =
-      arena_->AllocateUint32Array(sorted_exact_matches.size());
-  trie->exact_match_entries = exact_match_entries_array_offset;
-
-  for (unsigned int i = 0; i < sorted_exact_matches.size(); ++i) {
-    uint32_t property_entry_offset = WritePropertyEntry(sorted_exact_matches[i]);
-    arena_->uint32_array(exact_match_entries_array_offset)[i] = property_entry_offset;
-  }
-
-  // Write children
-  auto sorted_children = builder_node.children();
-  std::sort(sorted_children.begin(), sorted_children.end(),
-            [](const auto& lhs, const auto& rhs) { return lhs.name() < rhs.name(); });
-
-  trie->num_child_nodes = sorted_children.size();
-  uint32_t children_offset_array_offset = arena_->AllocateUint32Array(sorted_children.size());
-  trie->child_nodes = children_offset_array_offset;
-
-  for (unsigned int i = 0; i < sorted_children.size(); ++i) {
-    arena_->uint32_array(children_offset_array_offset)[i] = WriteTrieNode(sorted_children[i]);
+  // Nodes are laid out hottest first (see TrieBuilder::AddAccessHint), breadth first among
+  // equally hot nodes, so the top levels of the trie and the subtrees an access trace shows
+  // to be popular pack into the leading pages of the area instead of scattering between
+  // subtrees.  Each entry pairs a node to write with the offset of the uint32_t cell in its
+  // parent's child array that receives the node's location.
+  struct PendingNode {
+    const TrieBuilderNode* node;
+    uint32_t patch_offset;
+    uint64_t sequence;
+  };
+  auto cooler = [](const PendingNode& lhs, const PendingNode& rhs) {
+    if (lhs.node->hits() != rhs.node->hits()) return lhs.node->hits() < rhs.node->hits();
+    return lhs.sequence > rhs.sequence;
+  };
+  uint32_t root_offset = 0;
+  uint64_t sequence = 0;
+  std::priority_queue<PendingNode, std::vector<PendingNode>, decltype(cooler)> pending(cooler);
+  pending.push({&builder_node, ~0u, sequence++});
+
+  while (!pending.empty()) {
+    const TrieBuilderNode* node = pending.top().node;
+    uint32_t patch_offset = pending.top().patch_offset;
+    pending.pop();
+
+    uint32_t trie_offset;
+    auto trie = arena_->AllocateObject<TrieNodeInternal>(&trie_offset);
+    if (patch_offset != ~0u) {
+      arena_->uint32_array(patch_offset)[0] = trie_offset;
+    } else {
+      root_offset = trie_offset;
+    }
+
+    trie->property_entry = WritePropertyEntry(node->property_entry());
+
+    // Write prefix matches
+    auto sorted_prefix_matches = node->prefixes();
+    // Prefixes are sorted by descending length
+    std::sort(sorted_prefix_matches.begin(), sorted_prefix_matches.end(),
+              [](const auto& lhs, const auto& rhs) { return lhs.name.size() > rhs.name.size(); });
+
+    trie->num_prefixes = sorted_prefix_matches.size();
+
+    uint32_t prefix_entries_array_offset =
+        arena_->AllocateUint32Array(sorted_prefix_matches.size());
+    trie->prefix_entries = prefix_entries_array_offset;
+
+    for (unsigned int i = 0; i < sorted_prefix_matches.size(); ++i) {
+      uint32_t property_entry_offset = WritePropertyEntry(sorted_prefix_matches[i]);
+      arena_->uint32_array(prefix_entries_array_offset)[i] = property_entry_offset;
+    }
+
+    // Write exact matches
+    auto sorted_exact_matches = node->exact_matches();
+    // Exact matches are sorted alphabetically
+    std::sort(sorted_exact_matches.begin(), sorted_exact_matches.end(),
+              [](const auto& lhs, const auto& rhs) { return lhs.name < rhs.name; });
+
+    trie->num_exact_matches = sorted_exact_matches.size();
+
+    uint32_t exact_match_entries_array_offset =
+        arena_->AllocateUint32Array(sorted_exact_matches.size());
+    trie->exact_match_entries = exact_match_entries_array_offset;
+
+    for (unsigned int i = 0; i < sorted_exact_matches.size(); ++i) {
+      uint32_t property_entry_offset = WritePropertyEntry(sorted_exact_matches[i]);
+      arena_->uint32_array(exact_match_entries_array_offset)[i] = property_entry_offset;
+    }
+
+    // Queue children; their offsets are patched into the array as they are written.
+    auto sorted_children = std::vector<const TrieBuilderNode*>{};
+    for (const auto& child : node->children()) {
+      sorted_children.push_back(&child);
+    }
+    std::sort(sorted_children.begin(), sorted_children.end(),
+              [](const auto& lhs, const auto& rhs) { return lhs->name() < rhs->name(); });
+
+    trie->num_child_nodes = sorted_children.size();
+    uint32_t children_offset_array_offset = arena_->AllocateUint32Array(sorted_children.size());
+    trie->child_nodes = children_offset_array_offset;
+
+    for (unsigned int i = 0; i < sorted_children.size(); ++i) {
+      pending.push({sorted_children[i],
+                    static_cast<uint32_t>(children_offset_array_offset + i * sizeof(uint32_t)),
+                    sequence++});
+    }
   }
-  return trie_offset;
+  return root_offset;
 }
 
 TrieSerializer::TrieSerializer() {}
 
 std::string TrieSerializer::SerializeTrie(const TrieBuilder& trie_builder) {
   arena_.reset(new TrieNodeArena());
+  string_offsets_.clear();
 
   auto header = arena_->AllocateObject<PropertyInfoAreaHeader>(nullptr);
   header->current_version = 1;
@@ -18,6 +18,7 @@
 #define PROPERTY_INFO_SERIALIZER_TRIE_SERIALIZER_H
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "property_info_parser/property_info_parser.h"
@@ -36,10 +37,14 @@ class TrieSerializer {
 
  private:
   void SerializeStrings(const std::set<std::string>& strings);
+
+  // Writes the string to arena, reusing the offset of an identical string if
+  // one has already been written.
+  uint32_t WriteString(const std::string& string);
   uint32_t WritePropertyEntry(const PropertyEntryBuilder& property_entry);
 
-  // Writes a new TrieNode to arena, and recursively writes its children.
-  // Returns the offset within arena.
+  // Writes the trie rooted at builder_node to arena, laying the nodes out
+  // breadth first.  Returns the offset of the root node within arena.
   uint32_t WriteTrieNode(const TrieBuilderNode& builder_node);
 
   const PropertyInfoArea* serialized_info() const {
@@ -47,6 +52,7 @@ class TrieSerializer {
   }
 
   std::unique_ptr<TrieNodeArena> arena_;
+  std::unordered_map<std::string, uint32_t> string_offsets_;
 };
 
 }  // namespace properties
@@ -59,19 +59,25 @@ using namespace android;
 
 // Periodic chores intervals in seconds
 #define DEFAULT_PERIODIC_CHORES_INTERVAL_UNIT ( 60 )
+#define DEFAULT_PERIODIC_CHORES_INTERVAL_UNIT_MAX ( 240 )
 #define DEFAULT_PERIODIC_CHORES_INTERVAL_DISK_STATS_PUBLISH ( 3600 )
 #define DEFAULT_PERIODIC_CHORES_INTERVAL_UID_IO ( 3600 )
 #define DEFAULT_PERIODIC_CHORES_INTERVAL_UID_IO_LIMIT ( 300 )
 #define DEFAULT_PERIODIC_CHORES_INTERVAL_FLUSH_PROTO ( 3600 )
 
+// Disk I/Os per interval under which the disk is considered idle
+#define DEFAULT_PERIODIC_CHORES_IDLE_IO_COUNT ( 10 )
+
 // UID IO threshold in bytes
 #define DEFAULT_PERIODIC_CHORES_UID_IO_THRESHOLD ( 1024 * 1024 * 1024ULL )
 
 struct storaged_config {
     int periodic_chores_interval_unit;
+    int periodic_chores_interval_unit_max;  // stretched interval when disk is idle
     int periodic_chores_interval_disk_stats_publish;
     int periodic_chores_interval_uid_io;
     int periodic_chores_interval_flush_proto;
+    int periodic_chores_idle_io_count;  // I/Os per interval considered idle
     int event_time_check_usec;  // check how much cputime spent in event loop
 };
 
@@ -79,6 +85,7 @@ class storaged_t : public android::hardware::health::V2_0::IHealthInfoCallback,
                    public android::hardware::hidl_death_recipient {
   private:
     time_t mTimer;
+    int mPauseInterval;  // current adaptive polling interval in seconds
     storaged_config mConfig;
     unique_ptr<disk_stats_monitor> mDsm;
     uid_monitor mUidm;
@@ -87,14 +94,24 @@ class storaged_t : public android::hardware::health::V2_0::IHealthInfoCallback,
     unique_ptr<storage_info_t> storage_info;
     static const uint32_t current_version;
     unordered_map<userid_t, bool> proto_loaded;
+    // newest uid_io end timestamp persisted per user, snapshot or journal
+    unordered_map<userid_t, uint64_t> flushed_end_ts;
+    // journal records appended per user since the last snapshot
+    unordered_map<userid_t, int> journal_records;
     void load_proto(userid_t user_id);
+    void load_journal(userid_t user_id);
     char* prepare_proto(userid_t user_id, StoragedProto* proto);
     void flush_proto(userid_t user_id, StoragedProto* proto);
-    void flush_proto_data(userid_t user_id, const char* data, ssize_t size);
+    bool flush_proto_data(userid_t user_id, const char* data, ssize_t size);
+    bool append_journal_delta(userid_t user_id, StoragedProto* proto);
+    void update_event_interval(void);
     string proto_path(userid_t user_id) {
         return string("/data/misc_ce/") + to_string(user_id) +
                "/storaged/storaged.proto";
     }
+    string journal_path(userid_t user_id) {
+        return proto_path(user_id) + "_journal";
+    }
     void init_health_service();
 
   public:
@@ -103,7 +120,7 @@ class storaged_t : public android::hardware::health::V2_0::IHealthInfoCallback,
     void event(void);
     void event_checked(void);
     void pause(void) {
-        sleep(mConfig.periodic_chores_interval_unit);
+        sleep(mPauseInterval);
     }
 
     time_t get_starttime(void) {
@@ -120,6 +137,11 @@ class storaged_t : public android::hardware::health::V2_0::IHealthInfoCallback,
 
     uint32_t get_recent_perf(void) { return storage_info->get_recent_perf(); }
 
+    // called by dumpsys with --latency
+    void dump_latency(int fd) {
+        if (mDsm) mDsm->dump_latency(fd);
+    }
+
     map<uint64_t, struct uid_records> get_uid_records(
             double hours, uint64_t threshold, bool force_report) {
         return mUidm.dump(hours, threshold, force_report);
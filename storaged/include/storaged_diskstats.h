@@ -141,6 +141,30 @@ public:
     }
 };
 
+/*
+ * HDR-style histogram for I/O latencies: power-of-two major buckets
+ * subdivided linearly, so relative precision stays roughly constant across
+ * the range. Constant memory, one add() per diskstats polling interval.
+ */
+class latency_histogram {
+private:
+    static constexpr size_t SUB_BUCKET_BITS = 4;
+    // linear slots per power of two
+    static constexpr size_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    // covers [0, (2 * SUB_BUCKETS) << (MAJOR_BUCKETS - 2)) ms, ~524s
+    static constexpr size_t MAJOR_BUCKETS = 16;
+    uint64_t mCount;
+    uint64_t mMax;
+    uint64_t mBuckets[MAJOR_BUCKETS * SUB_BUCKETS];
+
+    static uint64_t bucket_floor(size_t slot);
+public:
+    latency_histogram() : mCount(0), mMax(0), mBuckets{} {}
+    void add(uint64_t value);
+    uint64_t percentile(double p) const;
+    void dump(int fd, const char* name) const;
+};
+
 class disk_stats_monitor {
 private:
     FRIEND_TEST(storaged_test, disk_stats_monitor);
@@ -148,6 +172,9 @@ private:
     struct disk_stats mPrevious;
     struct disk_stats mAccumulate;      /* reset after stall */
     struct disk_stats mAccumulate_pub;  /* reset after publish */
+    uint64_t mLastIoCount;              /* I/Os between the last two updates */
+    latency_histogram mReadLatency;     /* avg read latency per interval, ms */
+    latency_histogram mWriteLatency;    /* avg write latency per interval, ms */
     bool mStall;
     std::queue<struct disk_perf> mBuffer;
     struct {
@@ -184,6 +211,7 @@ public:
         mPrevious(),
         mAccumulate(),
         mAccumulate_pub(),
+        mLastIoCount(0),
         mStall(false),
         mValid(false),
         mWindow(window_size),
@@ -192,8 +220,11 @@ public:
         mStd(),
         mHealth(healthService) {}
   bool enabled() { return mHealth != nullptr || DISK_STATS_PATH != nullptr; }
+  uint64_t last_io_count() { return mLastIoCount; }
+  bool stalled() { return mStall; }
   void update(void);
   void publish(void);
+  void dump_latency(int fd);
 };
 
 #endif /* _STORAGED_DISKSTATS_H_ */
@@ -17,6 +17,8 @@
 #ifndef _STORAGED_SERVICE_H_
 #define _STORAGED_SERVICE_H_
 
+#include <stdint.h>
+
 #include <vector>
 
 #include <binder/BinderService.h>
@@ -24,14 +26,41 @@
 #include "android/os/BnStoraged.h"
 #include "android/os/storaged/BnStoragedPrivate.h"
 
+#include "uid_info.h"
+
 using namespace std;
 using namespace android::os;
 using namespace android::os::storaged;
 
+/*
+ * Binary uid I/O report emitted by dumpsys storaged --binary: one
+ * uid_io_dump_header followed by record_count fixed-size records, so an
+ * agent can save the stream to a file and mmap it.
+ */
+#define UID_IO_DUMP_MAGIC ( 0x444F4955 )  // "UIOD"
+#define UID_IO_DUMP_VERSION ( 1 )
+#define UID_IO_DUMP_NAME_LEN ( 64 )
+
+struct uid_io_dump_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t record_size;   // sizeof(struct uid_io_dump_record)
+    uint32_t record_count;
+};
+
+struct uid_io_dump_record {
+    uint64_t start_ts;
+    uint64_t end_ts;
+    uint64_t bytes[IO_TYPES][UID_STATS][CHARGER_STATS];
+    uint32_t user_id;
+    uint32_t pad;           // keep the record size 8-byte aligned
+    char name[UID_IO_DUMP_NAME_LEN];  // null-terminated, truncated
+};
+
 class StoragedService : public BinderService<StoragedService>, public BnStoraged {
 private:
-    void dumpUidRecordsDebug(int fd, const vector<struct uid_record>& entries);
-    void dumpUidRecords(int fd, const vector<struct uid_record>& entries);
+    void dumpUidRecordsDebug(string* out, const vector<struct uid_record>& entries);
+    void dumpUidRecords(string* out, const vector<struct uid_record>& entries);
 public:
     static status_t start();
     static char const* getServiceName() { return "storaged"; }
@@ -39,7 +39,8 @@ using namespace android::os::storaged;
 
 class uid_info : public UidInfo {
 public:
-    bool parse_uid_io_stats(string&& s);
+    // parses one null-terminated line of /proc/uid_io/stats in place
+    bool parse_uid_io_stats(char* line);
 };
 
 class io_usage {
@@ -95,6 +96,8 @@ private:
     uint64_t start_ts_;
     // true if UID_IO_STATS_PATH is accessible
     const bool enabled_;
+    // read buffer for UID_IO_STATS_PATH, reused across polling intervals
+    string io_stats_buffer_;
 
     // reads from /proc/uid_io/stats
     unordered_map<uint32_t, uid_info> get_uid_io_stats_locked();
@@ -56,7 +56,8 @@ public:
     std::string comm;
     pid_t pid;
     io_stats io[UID_STATS];
-    bool parse_task_io_stats(std::string&& s);
+    // parses one null-terminated "task,..." line of /proc/uid_io/stats in place
+    bool parse_task_io_stats(char* line);
 };
 
 class UidInfo : public Parcelable {
@@ -23,6 +23,7 @@
 #include <unistd.h>
 #include <zlib.h>
 
+#include <algorithm>
 #include <chrono>
 #include <fstream>
 #include <sstream>
@@ -60,6 +61,30 @@ constexpr ssize_t benchmark_unit_size = 16 * 1024;  // 16KB
 
 constexpr ssize_t min_benchmark_size = 128 * 1024;  // 128KB
 
+/*
+ * Changed uid_io records are appended to a per-user journal between full
+ * snapshot flushes; the journal is compacted into a snapshot after this many
+ * records (with hourly flushes, roughly once a day).
+ */
+constexpr int max_journal_records = 24;
+// journal records larger than this fall back to a snapshot flush
+constexpr uint32_t max_journal_record_size = 1024 * 1024;
+
+// framing for one journal record, followed by a serialized UidIOUsage
+struct journal_record_header {
+    uint32_t size;  // payload size in bytes
+    uint32_t crc;   // crc32 of the payload, seeded with current_version
+};
+
+uint64_t latest_end_ts(const UidIOUsage& usage)
+{
+    uint64_t ts = 0;
+    for (const auto& item : usage.uid_io_items()) {
+        ts = std::max(ts, item.end_ts());
+    }
+    return ts;
+}
+
 }  // namespace
 
 const uint32_t storaged_t::current_version = 4;
@@ -142,6 +167,15 @@ storaged_t::storaged_t(void) {
         property_get_int32("ro.storaged.event.interval",
                            DEFAULT_PERIODIC_CHORES_INTERVAL_UNIT);
 
+    mConfig.periodic_chores_interval_unit_max =
+        std::max(property_get_int32("ro.storaged.event.interval_max",
+                                    DEFAULT_PERIODIC_CHORES_INTERVAL_UNIT_MAX),
+                 mConfig.periodic_chores_interval_unit);
+
+    mConfig.periodic_chores_idle_io_count =
+        property_get_int32("ro.storaged.event.idle_io_count",
+                           DEFAULT_PERIODIC_CHORES_IDLE_IO_COUNT);
+
     mConfig.event_time_check_usec =
         property_get_int32("ro.storaged.event.perf_check", 0);
 
@@ -159,6 +193,7 @@ storaged_t::storaged_t(void) {
 
     mStarttime = time(NULL);
     mTimer = 0;
+    mPauseInterval = mConfig.periodic_chores_interval_unit;
 }
 
 void storaged_t::add_user_ce(userid_t user_id) {
@@ -171,34 +206,81 @@ void storaged_t::add_user_ce(userid_t user_id) {
 void storaged_t::remove_user_ce(userid_t user_id) {
     proto_loaded[user_id] = false;
     mUidm.clear_user_history(user_id);
+    flushed_end_ts[user_id] = 0;
+    journal_records[user_id] = 0;
     RemoveFileIfExists(proto_path(user_id), nullptr);
+    RemoveFileIfExists(journal_path(user_id), nullptr);
 }
 
 void storaged_t::load_proto(userid_t user_id) {
     string proto_file = proto_path(user_id);
     ifstream in(proto_file, ofstream::in | ofstream::binary);
 
-    if (!in.good()) return;
+    if (in.good()) {
+        stringstream ss;
+        ss << in.rdbuf();
+        StoragedProto proto;
+        proto.ParseFromString(ss.str());
+
+        const UidIOUsage& uid_io_usage = proto.uid_io_usage();
+        uint32_t computed_crc = crc32(current_version,
+            reinterpret_cast<const Bytef*>(uid_io_usage.SerializeAsString().c_str()),
+            uid_io_usage.ByteSize());
+        if (proto.crc() == computed_crc) {
+            mUidm.load_uid_io_proto(user_id, uid_io_usage);
+            flushed_end_ts[user_id] = latest_end_ts(uid_io_usage);
+
+            if (user_id == USER_SYSTEM) {
+                storage_info->load_perf_history_proto(proto.perf_history());
+            }
+        } else {
+            LOG(WARNING) << "CRC mismatch in " << proto_file;
+        }
+    }
+
+    // Records flushed after the last snapshot live in the journal.
+    load_journal(user_id);
+}
 
-    stringstream ss;
-    ss << in.rdbuf();
-    StoragedProto proto;
-    proto.ParseFromString(ss.str());
+void storaged_t::load_journal(userid_t user_id) {
+    string journal_file = journal_path(user_id);
+    ifstream in(journal_file, ifstream::in | ifstream::binary);
 
-    const UidIOUsage& uid_io_usage = proto.uid_io_usage();
-    uint32_t computed_crc = crc32(current_version,
-        reinterpret_cast<const Bytef*>(uid_io_usage.SerializeAsString().c_str()),
-        uid_io_usage.ByteSize());
-    if (proto.crc() != computed_crc) {
-        LOG(WARNING) << "CRC mismatch in " << proto_file;
-        return;
-    }
+    if (!in.good()) return;
 
-    mUidm.load_uid_io_proto(user_id, proto.uid_io_usage());
+    int records = 0;
+    uint64_t max_ts = flushed_end_ts[user_id];
+    for (;;) {
+        journal_record_header header;
+        in.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (in.gcount() == 0 && in.eof()) break;
+
+        string payload;
+        if (static_cast<size_t>(in.gcount()) == sizeof(header) &&
+            header.size <= max_journal_record_size) {
+            payload.resize(header.size);
+            in.read(&payload[0], payload.size());
+        }
 
-    if (user_id == USER_SYSTEM) {
-        storage_info->load_perf_history_proto(proto.perf_history());
+        UidIOUsage delta;
+        if (static_cast<size_t>(in.gcount()) != payload.size() || payload.empty() ||
+            crc32(current_version, reinterpret_cast<const Bytef*>(payload.data()),
+                  payload.size()) != header.crc ||
+            !delta.ParseFromString(payload)) {
+            // A torn or corrupt tail; drop it and force compaction on the
+            // next flush so nothing is appended after the bad record.
+            LOG(WARNING) << "Corrupt journal record in " << journal_file;
+            records = max_journal_records;
+            break;
+        }
+
+        mUidm.load_uid_io_proto(user_id, delta);
+        max_ts = std::max(max_ts, latest_end_ts(delta));
+        records++;
     }
+
+    journal_records[user_id] = records;
+    flushed_end_ts[user_id] = max_ts;
 }
 
 char* storaged_t:: prepare_proto(userid_t user_id, StoragedProto* proto) {
@@ -234,7 +316,7 @@ char* storaged_t:: prepare_proto(userid_t user_id, StoragedProto* proto) {
     return data;
 }
 
-void storaged_t::flush_proto_data(userid_t user_id,
+bool storaged_t::flush_proto_data(userid_t user_id,
                                   const char* data, ssize_t size) {
     string proto_file = proto_path(user_id);
     string tmp_file = proto_file + "_tmp";
@@ -244,7 +326,7 @@ void storaged_t::flush_proto_data(userid_t user_id,
                  S_IRUSR | S_IWUSR)));
     if (fd == -1) {
         PLOG(ERROR) << "Faied to open tmp file: " << tmp_file;
-        return;
+        return false;
     }
 
     if (user_id == USER_SYSTEM) {
@@ -259,7 +341,7 @@ void storaged_t::flush_proto_data(userid_t user_id,
             ret = write(fd, data, MIN(benchmark_unit_size, size));
             if (ret <= 0) {
                 PLOG(ERROR) << "Faied to write tmp file: " << tmp_file;
-                return;
+                return false;
             }
             end = steady_clock::now();
             /*
@@ -282,19 +364,89 @@ void storaged_t::flush_proto_data(userid_t user_id,
     } else {
         if (!WriteFully(fd, data, size)) {
             PLOG(ERROR) << "Faied to write tmp file: " << tmp_file;
-            return;
+            return false;
         }
     }
 
     fd.reset(-1);
-    rename(tmp_file.c_str(), proto_file.c_str());
+    return rename(tmp_file.c_str(), proto_file.c_str()) == 0;
+}
+
+/*
+ * Appends uid_io records newer than the last flush to the per-user journal,
+ * so steady-state flushes write a few hundred bytes instead of the full
+ * snapshot. Returns false when the caller must fall back to a snapshot flush
+ * (journal due for compaction, oversized delta or an append failure).
+ */
+bool storaged_t::append_journal_delta(userid_t user_id, StoragedProto* proto) {
+    if (journal_records[user_id] >= max_journal_records) {
+        return false;
+    }
+
+    UidIOUsage delta;
+    uint64_t last_ts = flushed_end_ts[user_id];
+    for (const auto& item : proto->uid_io_usage().uid_io_items()) {
+        if (item.end_ts() > last_ts) {
+            *delta.add_uid_io_items() = item;
+        }
+    }
+
+    // Nothing changed since the last flush; don't touch the disk at all.
+    if (delta.uid_io_items_size() == 0) {
+        return true;
+    }
+
+    string payload;
+    if (!delta.SerializeToString(&payload) ||
+        payload.size() > max_journal_record_size) {
+        return false;
+    }
+
+    journal_record_header header;
+    header.size = payload.size();
+    header.crc = crc32(current_version,
+        reinterpret_cast<const Bytef*>(payload.data()), payload.size());
+
+    string journal_file = journal_path(user_id);
+    unique_fd fd(TEMP_FAILURE_RETRY(open(journal_file.c_str(),
+                 O_SYNC | O_CREAT | O_APPEND | O_WRONLY | O_CLOEXEC,
+                 S_IRUSR | S_IWUSR)));
+    if (fd == -1) {
+        PLOG(ERROR) << "Failed to open journal file: " << journal_file;
+        return false;
+    }
+
+    if (!WriteFully(fd, &header, sizeof(header)) ||
+        !WriteFully(fd, payload.data(), payload.size())) {
+        PLOG(ERROR) << "Failed to append journal file: " << journal_file;
+        return false;
+    }
+
+    journal_records[user_id]++;
+    flushed_end_ts[user_id] = latest_end_ts(delta);
+    return true;
 }
 
 void storaged_t::flush_proto(userid_t user_id, StoragedProto* proto) {
+    /*
+     * USER_SYSTEM always flushes the full snapshot: that write doubles as
+     * the storage benchmark and carries perf_history.
+     */
+    if (user_id != USER_SYSTEM && append_journal_delta(user_id, proto)) {
+        return;
+    }
+
     unique_ptr<char> proto_data(prepare_proto(user_id, proto));
     if (proto_data == nullptr) return;
 
-    flush_proto_data(user_id, proto_data.get(), proto->ByteSize());
+    if (!flush_proto_data(user_id, proto_data.get(), proto->ByteSize())) {
+        return;
+    }
+
+    // The snapshot now covers everything; restart the journal.
+    RemoveFileIfExists(journal_path(user_id), nullptr);
+    journal_records[user_id] = 0;
+    flushed_end_ts[user_id] = latest_end_ts(proto->uid_io_usage());
 }
 
 void storaged_t::flush_protos(unordered_map<int, StoragedProto>* protos) {
@@ -330,7 +482,45 @@ void storaged_t::event(void) {
         flush_protos(&protos);
     }
 
-    mTimer += mConfig.periodic_chores_interval_unit;
+    update_event_interval();
+    mTimer += mPauseInterval;
+}
+
+namespace {
+
+// next time after |timer| at which a chore with period |interval| is due
+inline time_t next_chore_time(time_t timer, int interval)
+{
+    return timer - timer % interval + interval;
+}
+
+} // namespace
+
+void storaged_t::update_event_interval(void) {
+    // Stretch the polling interval while the disk stays (nearly) idle and
+    // snap back to the base interval on activity or a stall, so an idle
+    // device takes fewer wakeups without losing resolution during bursts.
+    if (mDsm->enabled() && !mDsm->stalled() &&
+        mDsm->last_io_count() <= (uint64_t)mConfig.periodic_chores_idle_io_count) {
+        mPauseInterval = std::min(mPauseInterval * 2,
+                                  mConfig.periodic_chores_interval_unit_max);
+    } else {
+        mPauseInterval = mConfig.periodic_chores_interval_unit;
+    }
+
+    // Never step over the next scheduled chore; the chores only fire when
+    // mTimer lands exactly on a multiple of their period.
+    time_t deadline =
+        next_chore_time(mTimer, mConfig.periodic_chores_interval_uid_io);
+    deadline = std::min(deadline,
+        next_chore_time(mTimer, mConfig.periodic_chores_interval_flush_proto));
+    if (mDsm->enabled()) {
+        deadline = std::min(deadline, next_chore_time(
+            mTimer, mConfig.periodic_chores_interval_disk_stats_publish));
+    }
+    if (mTimer + mPauseInterval > deadline) {
+        mPauseInterval = deadline - mTimer;
+    }
 }
 
 void storaged_t::event_checked(void) {
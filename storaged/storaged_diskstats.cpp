@@ -16,9 +16,12 @@
 
 #define LOG_TAG "storaged"
 
+#include <inttypes.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 
+#include <algorithm>
 #include <sstream>
 
 #include <android-base/file.h>
@@ -219,6 +222,62 @@ void add_disk_stats(struct disk_stats* src, struct disk_stats* dst)
     }
 }
 
+/* latency_histogram */
+void latency_histogram::add(uint64_t value)
+{
+    mCount++;
+    mMax = std::max(mMax, value);
+
+    size_t slot;
+    if (value < SUB_BUCKETS) {
+        slot = value;
+    } else {
+        size_t msb = 63 - __builtin_clzll(value);
+        size_t major = msb - SUB_BUCKET_BITS + 1;
+        if (major >= MAJOR_BUCKETS) {
+            slot = MAJOR_BUCKETS * SUB_BUCKETS - 1;
+        } else {
+            slot = major * SUB_BUCKETS +
+                   ((value >> (msb - SUB_BUCKET_BITS)) - SUB_BUCKETS);
+        }
+    }
+    mBuckets[slot]++;
+}
+
+// lowest value mapping to |slot|
+uint64_t latency_histogram::bucket_floor(size_t slot)
+{
+    size_t major = slot / SUB_BUCKETS;
+    size_t sub = slot % SUB_BUCKETS;
+    if (major == 0) return sub;
+    return (uint64_t)(SUB_BUCKETS + sub) << (major - 1);
+}
+
+uint64_t latency_histogram::percentile(double p) const
+{
+    if (mCount == 0) return 0;
+
+    uint64_t target = (uint64_t)(p / 100 * mCount + 0.5);
+    if (target == 0) target = 1;
+
+    uint64_t seen = 0;
+    for (size_t slot = 0; slot < MAJOR_BUCKETS * SUB_BUCKETS; slot++) {
+        seen += mBuckets[slot];
+        if (seen >= target) {
+            return std::min(bucket_floor(slot), mMax);
+        }
+    }
+    return mMax;
+}
+
+void latency_histogram::dump(int fd, const char* name) const
+{
+    dprintf(fd, "%s latency ms: n %" PRIu64 " p50 %" PRIu64 " p90 %" PRIu64
+            " p95 %" PRIu64 " p99 %" PRIu64 " max %" PRIu64 "\n",
+            name, mCount, percentile(50), percentile(90), percentile(95),
+            percentile(99), mMax);
+}
+
 /* disk_stats_monitor */
 void disk_stats_monitor::update_mean()
 {
@@ -269,6 +328,16 @@ void disk_stats_monitor::update(struct disk_stats* curr)
     disk_stats inc;
     get_inc_disk_stats(&mPrevious, curr, &inc);
     add_disk_stats(&inc, &mAccumulate_pub);
+    mLastIoCount = inc.read_ios + inc.write_ios;
+
+    // Per-request latency averaged over this polling interval; ticks are the
+    // total request wait times in milliseconds.
+    if (inc.read_ios) {
+        mReadLatency.add(inc.read_ticks / inc.read_ios);
+    }
+    if (inc.write_ios) {
+        mWriteLatency.add(inc.write_ticks / inc.write_ios);
+    }
 
     struct disk_perf perf = get_disk_perf(&inc);
     log_debug_disk_perf(&perf, "regular");
@@ -328,3 +397,9 @@ void disk_stats_monitor::publish(void)
     // Reset global structures
     memset(&mAccumulate_pub, 0, sizeof(struct disk_stats));
 }
+
+void disk_stats_monitor::dump_latency(int fd)
+{
+    mReadLatency.dump(fd, "read");
+    mWriteLatency.dump(fd, "write");
+}
@@ -16,11 +16,19 @@
 
 #include <inttypes.h>
 #include <stdint.h>
+#include <string.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <string>
+#include <thread>
 #include <vector>
 
+#include <android-base/file.h>
 #include <android-base/parseint.h>
 #include <android-base/parsedouble.h>
+#include <android-base/stringprintf.h>
+#include <android-base/unique_fd.h>
 #include <binder/IBinder.h>
 #include <binder/IInterface.h>
 
@@ -38,14 +46,48 @@ using namespace android::base;
 
 extern sp<storaged_t> storaged_sp;
 
+namespace {
+
+constexpr size_t dump_chunk_size = 64 * 1024;
+
+/*
+ * Streams |out| to |fd| in bounded chunks from a detached worker thread, so
+ * a slow dumpsys reader can't stall the binder thread that produced the
+ * report. The fd is dup'ed; the reader sees EOF once the worker finishes
+ * and drops its copy.
+ */
+void stream_dump_output(int fd, string&& out) {
+    unique_fd dup_fd(dup(fd));
+    if (dup_fd == -1) {
+        WriteStringToFd(out, fd);
+        return;
+    }
+
+    std::thread worker([fd = std::move(dup_fd), out = std::move(out)]() {
+        const char* data = out.data();
+        size_t left = out.size();
+        while (left > 0) {
+            size_t chunk = std::min(left, dump_chunk_size);
+            if (!WriteFully(fd, data, chunk)) {
+                break;
+            }
+            data += chunk;
+            left -= chunk;
+        }
+    });
+    worker.detach();
+}
+
+} // namespace
+
 status_t StoragedService::start() {
     return BinderService<StoragedService>::publish();
 }
 
-void StoragedService::dumpUidRecords(int fd, const vector<uid_record>& entries) {
+void StoragedService::dumpUidRecords(string* out, const vector<uid_record>& entries) {
     map<string, io_usage> merged_entries = merge_io_usage(entries);
     for (const auto& rec : merged_entries) {
-        dprintf(fd, "%s %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64
+        StringAppendF(out, "%s %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64
                 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 "\n",
                 rec.first.c_str(),
                 rec.second.bytes[READ][FOREGROUND][CHARGER_OFF],
@@ -59,10 +101,10 @@ void StoragedService::dumpUidRecords(int fd, const vector<uid_record>& entries)
     }
 }
 
-void StoragedService::dumpUidRecordsDebug(int fd, const vector<uid_record>& entries) {
+void StoragedService::dumpUidRecordsDebug(string* out, const vector<uid_record>& entries) {
     for (const auto& record : entries) {
         const io_usage& uid_usage = record.ios.uid_ios;
-        dprintf(fd, "%s_%d %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64
+        StringAppendF(out, "%s_%d %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64
                 " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 "\n",
                 record.name.c_str(), record.ios.user_id,
                 uid_usage.bytes[READ][FOREGROUND][CHARGER_OFF],
@@ -77,7 +119,7 @@ void StoragedService::dumpUidRecordsDebug(int fd, const vector<uid_record>& entr
         for (const auto& task_it : record.ios.task_ios) {
             const io_usage& task_usage = task_it.second;
             const string& comm = task_it.first;
-            dprintf(fd, "-> %s %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64
+            StringAppendF(out, "-> %s %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64
                     " %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 "\n",
                     comm.c_str(),
                     task_usage.bytes[READ][FOREGROUND][CHARGER_OFF],
@@ -107,6 +149,8 @@ status_t StoragedService::dump(int fd, const Vector<String16>& args) {
     uint64_t threshold = 0;
     bool force_report = false;
     bool debug = false;
+    bool latency = false;
+    bool binary = false;
     for (size_t i = 0; i < args.size(); i++) {
         const auto& arg = args[i];
         if (arg == String16("--hours")) {
@@ -138,25 +182,67 @@ status_t StoragedService::dump(int fd, const Vector<String16>& args) {
             debug = true;
             continue;
         }
+        if (arg == String16("--latency")) {
+            latency = true;
+            continue;
+        }
+        if (arg == String16("--binary")) {
+            binary = true;
+            continue;
+        }
+    }
+
+    if (latency) {
+        storaged_sp->dump_latency(fd);
     }
 
-    uint64_t last_ts = 0;
     map<uint64_t, struct uid_records> records =
                 storaged_sp->get_uid_records(hours, threshold, force_report);
-    for (const auto& it : records) {
-        if (last_ts != it.second.start_ts) {
-            dprintf(fd, "%" PRIu64, it.second.start_ts);
+
+    string out;
+    if (binary) {
+        uint32_t record_count = 0;
+        for (const auto& it : records) {
+            record_count += it.second.entries.size();
         }
-        dprintf(fd, ",%" PRIu64 "\n", it.first);
-        last_ts = it.first;
 
-        if (!debug) {
-            dumpUidRecords(fd, it.second.entries);
-        } else {
-            dumpUidRecordsDebug(fd, it.second.entries);
+        struct uid_io_dump_header header = {};
+        header.magic = UID_IO_DUMP_MAGIC;
+        header.version = UID_IO_DUMP_VERSION;
+        header.record_size = sizeof(struct uid_io_dump_record);
+        header.record_count = record_count;
+        out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        for (const auto& it : records) {
+            for (const auto& entry : it.second.entries) {
+                struct uid_io_dump_record rec = {};
+                rec.start_ts = it.second.start_ts;
+                rec.end_ts = it.first;
+                memcpy(rec.bytes, entry.ios.uid_ios.bytes, sizeof(rec.bytes));
+                rec.user_id = entry.ios.user_id;
+                snprintf(rec.name, sizeof(rec.name), "%s", entry.name.c_str());
+                out.append(reinterpret_cast<const char*>(&rec), sizeof(rec));
+            }
+        }
+    } else {
+        uint64_t last_ts = 0;
+        for (const auto& it : records) {
+            if (last_ts != it.second.start_ts) {
+                StringAppendF(&out, "%" PRIu64, it.second.start_ts);
+            }
+            StringAppendF(&out, ",%" PRIu64 "\n", it.first);
+            last_ts = it.first;
+
+            if (!debug) {
+                dumpUidRecords(&out, it.second.entries);
+            } else {
+                dumpUidRecordsDebug(&out, it.second.entries);
+            }
         }
     }
 
+    stream_dump_output(fd, std::move(out));
+
     if (time_window) {
         storaged_sp->update_uid_io_interval(time_window);
     }
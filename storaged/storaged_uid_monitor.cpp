@@ -16,9 +16,13 @@
 
 #define LOG_TAG "storaged"
 
+#include <errno.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
+#include <limits>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -27,8 +31,6 @@
 #include <android-base/file.h>
 #include <android-base/logging.h>
 #include <android-base/macros.h>
-#include <android-base/parseint.h>
-#include <android-base/strings.h>
 #include <android-base/stringprintf.h>
 #include <binder/IServiceManager.h>
 #include <log/log_event_list.h>
@@ -47,6 +49,33 @@ namespace {
 bool refresh_uid_names;
 const char* UID_IO_STATS_PATH = "/proc/uid_io/stats";
 
+/*
+ * Parses one unsigned base-10 field, skipping any leading separators and
+ * advancing *pos past the number. Fields in /proc/uid_io/stats are separated
+ * by a single space (uid lines) or comma (task lines).
+ */
+template <typename T>
+bool parse_io_field(char** pos, T* val)
+{
+    char* start = *pos;
+    while (*start == ' ' || *start == ',') {
+        start++;
+    }
+    if (*start == '-') {
+        return false;
+    }
+    errno = 0;
+    char* field_end;
+    unsigned long long v = strtoull(start, &field_end, 10);
+    if (field_end == start || errno == ERANGE ||
+        v > static_cast<unsigned long long>(std::numeric_limits<T>::max())) {
+        return false;
+    }
+    *val = static_cast<T>(v);
+    *pos = field_end;
+    return true;
+}
+
 } // namepsace
 
 std::unordered_map<uint32_t, uid_info> uid_monitor::get_uid_io_stats()
@@ -56,49 +85,59 @@ std::unordered_map<uint32_t, uid_info> uid_monitor::get_uid_io_stats()
 };
 
 /* return true on parse success and false on failure */
-bool uid_info::parse_uid_io_stats(std::string&& s)
+bool uid_info::parse_uid_io_stats(char* line)
 {
-    std::vector<std::string> fields = Split(s, " ");
-    if (fields.size() < 11 ||
-        !ParseUint(fields[0],  &uid) ||
-        !ParseUint(fields[1],  &io[FOREGROUND].rchar) ||
-        !ParseUint(fields[2],  &io[FOREGROUND].wchar) ||
-        !ParseUint(fields[3],  &io[FOREGROUND].read_bytes) ||
-        !ParseUint(fields[4],  &io[FOREGROUND].write_bytes) ||
-        !ParseUint(fields[5],  &io[BACKGROUND].rchar) ||
-        !ParseUint(fields[6],  &io[BACKGROUND].wchar) ||
-        !ParseUint(fields[7],  &io[BACKGROUND].read_bytes) ||
-        !ParseUint(fields[8],  &io[BACKGROUND].write_bytes) ||
-        !ParseUint(fields[9],  &io[FOREGROUND].fsync) ||
-        !ParseUint(fields[10], &io[BACKGROUND].fsync)) {
-        LOG(WARNING) << "Invalid uid I/O stats: \"" << s << "\"";
+    char* pos = line;
+    if (!parse_io_field(&pos, &uid) ||
+        !parse_io_field(&pos, &io[FOREGROUND].rchar) ||
+        !parse_io_field(&pos, &io[FOREGROUND].wchar) ||
+        !parse_io_field(&pos, &io[FOREGROUND].read_bytes) ||
+        !parse_io_field(&pos, &io[FOREGROUND].write_bytes) ||
+        !parse_io_field(&pos, &io[BACKGROUND].rchar) ||
+        !parse_io_field(&pos, &io[BACKGROUND].wchar) ||
+        !parse_io_field(&pos, &io[BACKGROUND].read_bytes) ||
+        !parse_io_field(&pos, &io[BACKGROUND].write_bytes) ||
+        !parse_io_field(&pos, &io[FOREGROUND].fsync) ||
+        !parse_io_field(&pos, &io[BACKGROUND].fsync)) {
+        LOG(WARNING) << "Invalid uid I/O stats: \"" << line << "\"";
         return false;
     }
     return true;
 }
 
 /* return true on parse success and false on failure */
-bool task_info::parse_task_io_stats(std::string&& s)
+bool task_info::parse_task_io_stats(char* line)
 {
-    std::vector<std::string> fields = Split(s, ",");
-    size_t size = fields.size();
-    if (size < 13 ||
-        !ParseInt(fields[size - 11],  &pid) ||
-        !ParseUint(fields[size - 10],  &io[FOREGROUND].rchar) ||
-        !ParseUint(fields[size - 9],  &io[FOREGROUND].wchar) ||
-        !ParseUint(fields[size - 8],  &io[FOREGROUND].read_bytes) ||
-        !ParseUint(fields[size - 7],  &io[FOREGROUND].write_bytes) ||
-        !ParseUint(fields[size - 6],  &io[BACKGROUND].rchar) ||
-        !ParseUint(fields[size - 5],  &io[BACKGROUND].wchar) ||
-        !ParseUint(fields[size - 4],  &io[BACKGROUND].read_bytes) ||
-        !ParseUint(fields[size - 3], &io[BACKGROUND].write_bytes) ||
-        !ParseUint(fields[size - 2], &io[FOREGROUND].fsync) ||
-        !ParseUint(fields[size - 1], &io[BACKGROUND].fsync)) {
-        LOG(WARNING) << "Invalid task I/O stats: \"" << s << "\"";
+    // Lines look like "task,<comm>,<pid>,<ten I/O fields>". The comm itself
+    // may contain commas, so locate the last eleven fields by scanning
+    // backwards from the end of the line.
+    char* line_end = line + strlen(line);
+    char* pos = line_end;
+    for (int i = 0; i < 11 && pos > line; i++) {
+        do {
+            pos--;
+        } while (pos > line && *pos != ',');
+    }
+
+    char* first_comma = strchr(line, ',');
+    char* field_pos = pos + 1;
+    if (first_comma == nullptr || pos <= first_comma || *pos != ',' ||
+        !parse_io_field(&field_pos, &pid) ||
+        !parse_io_field(&field_pos, &io[FOREGROUND].rchar) ||
+        !parse_io_field(&field_pos, &io[FOREGROUND].wchar) ||
+        !parse_io_field(&field_pos, &io[FOREGROUND].read_bytes) ||
+        !parse_io_field(&field_pos, &io[FOREGROUND].write_bytes) ||
+        !parse_io_field(&field_pos, &io[BACKGROUND].rchar) ||
+        !parse_io_field(&field_pos, &io[BACKGROUND].wchar) ||
+        !parse_io_field(&field_pos, &io[BACKGROUND].read_bytes) ||
+        !parse_io_field(&field_pos, &io[BACKGROUND].write_bytes) ||
+        !parse_io_field(&field_pos, &io[FOREGROUND].fsync) ||
+        !parse_io_field(&field_pos, &io[BACKGROUND].fsync) ||
+        field_pos != line_end) {
+        LOG(WARNING) << "Invalid task I/O stats: \"" << line << "\"";
         return false;
     }
-    comm = Join(std::vector<std::string>(
-                fields.begin() + 1, fields.end() - 11), ',');
+    comm.assign(first_comma + 1, pos - (first_comma + 1));
     return true;
 }
 
@@ -153,40 +192,58 @@ void get_uid_names(const vector<int>& uids, const vector<std::string*>& uid_name
 std::unordered_map<uint32_t, uid_info> uid_monitor::get_uid_io_stats_locked()
 {
     std::unordered_map<uint32_t, uid_info> uid_io_stats;
-    std::string buffer;
-    if (!ReadFileToString(UID_IO_STATS_PATH, &buffer)) {
+    // The read buffer is reused across polling intervals so that it does not
+    // get reallocated once it has grown to the size of /proc/uid_io/stats.
+    if (!ReadFileToString(UID_IO_STATS_PATH, &io_stats_buffer_)) {
         PLOG(ERROR) << UID_IO_STATS_PATH << ": ReadFileToString failed";
         return uid_io_stats;
     }
 
-    std::vector<std::string> io_stats = Split(std::move(buffer), "\n");
-    uid_info u;
     vector<int> uids;
     vector<std::string*> uid_names;
+    uid_info* cur_uid = nullptr;
+
+    // Walk the buffer in place instead of splitting it into per-line strings;
+    // with hundreds of apps this file is large and reparsed every interval.
+    char* buf = &io_stats_buffer_[0];
+    char* buf_end = buf + io_stats_buffer_.size();
+    for (char* line = buf; line < buf_end;) {
+        char* eol = static_cast<char*>(memchr(line, '\n', buf_end - line));
+        if (eol == nullptr) {
+            eol = buf_end;
+        }
+        *eol = '\0';
 
-    for (uint32_t i = 0; i < io_stats.size(); i++) {
-        if (io_stats[i].empty()) {
+        if (line == eol) {
+            line = eol + 1;
             continue;
         }
 
-        if (io_stats[i].compare(0, 4, "task")) {
-            if (!u.parse_uid_io_stats(std::move(io_stats[i])))
+        if (strncmp(line, "task", 4)) {
+            uid_info u;
+            if (!u.parse_uid_io_stats(line)) {
+                line = eol + 1;
                 continue;
-            uid_io_stats[u.uid] = u;
-            uid_io_stats[u.uid].name = std::to_string(u.uid);
-            uids.push_back(u.uid);
-            uid_names.push_back(&uid_io_stats[u.uid].name);
-            if (last_uid_io_stats_.find(u.uid) == last_uid_io_stats_.end()) {
+            }
+            uid_info& stats = uid_io_stats[u.uid];
+            stats = std::move(u);
+            stats.name = std::to_string(stats.uid);
+            uids.push_back(stats.uid);
+            uid_names.push_back(&stats.name);
+            auto last = last_uid_io_stats_.find(stats.uid);
+            if (last == last_uid_io_stats_.end()) {
                 refresh_uid_names = true;
             } else {
-                uid_io_stats[u.uid].name = last_uid_io_stats_[u.uid].name;
+                stats.name = last->second.name;
             }
-        } else {
+            cur_uid = &stats;
+        } else if (cur_uid != nullptr) {
             task_info t;
-            if (!t.parse_task_io_stats(std::move(io_stats[i])))
-                continue;
-            uid_io_stats[u.uid].tasks[t.pid] = t;
+            if (t.parse_task_io_stats(line)) {
+                cur_uid->tasks[t.pid] = std::move(t);
+            }
         }
+        line = eol + 1;
     }
 
     if (!uids.empty() && refresh_uid_names) {
@@ -317,14 +374,15 @@ void uid_monitor::update_curr_io_stats_locked()
         struct uid_io_usage& usage = curr_io_stats_[uid.name];
         usage.user_id = multiuser_get_user_id(uid.uid);
 
+        uid_info& last_uid = last_uid_io_stats_[uid.uid];
         int64_t fg_rd_delta = uid.io[FOREGROUND].read_bytes -
-            last_uid_io_stats_[uid.uid].io[FOREGROUND].read_bytes;
+            last_uid.io[FOREGROUND].read_bytes;
         int64_t bg_rd_delta = uid.io[BACKGROUND].read_bytes -
-            last_uid_io_stats_[uid.uid].io[BACKGROUND].read_bytes;
+            last_uid.io[BACKGROUND].read_bytes;
         int64_t fg_wr_delta = uid.io[FOREGROUND].write_bytes -
-            last_uid_io_stats_[uid.uid].io[FOREGROUND].write_bytes;
+            last_uid.io[FOREGROUND].write_bytes;
         int64_t bg_wr_delta = uid.io[BACKGROUND].write_bytes -
-            last_uid_io_stats_[uid.uid].io[BACKGROUND].write_bytes;
+            last_uid.io[BACKGROUND].write_bytes;
 
         usage.uid_ios.bytes[READ][FOREGROUND][charger_stat_] +=
             (fg_rd_delta < 0) ? 0 : fg_rd_delta;
@@ -339,14 +397,15 @@ void uid_monitor::update_curr_io_stats_locked()
             const task_info& task = task_it.second;
             const pid_t pid = task_it.first;
             const std::string& comm = task_it.second.comm;
+            task_info& last_task = last_uid.tasks[pid];
             int64_t task_fg_rd_delta = task.io[FOREGROUND].read_bytes -
-                last_uid_io_stats_[uid.uid].tasks[pid].io[FOREGROUND].read_bytes;
+                last_task.io[FOREGROUND].read_bytes;
             int64_t task_bg_rd_delta = task.io[BACKGROUND].read_bytes -
-                last_uid_io_stats_[uid.uid].tasks[pid].io[BACKGROUND].read_bytes;
+                last_task.io[BACKGROUND].read_bytes;
             int64_t task_fg_wr_delta = task.io[FOREGROUND].write_bytes -
-                last_uid_io_stats_[uid.uid].tasks[pid].io[FOREGROUND].write_bytes;
+                last_task.io[FOREGROUND].write_bytes;
             int64_t task_bg_wr_delta = task.io[BACKGROUND].write_bytes -
-                last_uid_io_stats_[uid.uid].tasks[pid].io[BACKGROUND].write_bytes;
+                last_task.io[BACKGROUND].write_bytes;
 
             io_usage& task_usage = usage.task_ios[comm];
             task_usage.bytes[READ][FOREGROUND][charger_stat_] +=
@@ -360,7 +419,7 @@ void uid_monitor::update_curr_io_stats_locked()
         }
     }
 
-    last_uid_io_stats_ = uid_io_stats;
+    last_uid_io_stats_ = std::move(uid_io_stats);
 }
 
 void uid_monitor::report(unordered_map<int, StoragedProto>* protos)
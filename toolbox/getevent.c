@@ -496,7 +496,7 @@ static int scan_dir(const char *dirname, int print_flags)
 
 static void usage(char *name)
 {
-    fprintf(stderr, "Usage: %s [-t] [-n] [-s switchmask] [-S] [-v [mask]] [-d] [-p] [-i] [-l] [-q] [-c count] [-r] [device]\n", name);
+    fprintf(stderr, "Usage: %s [-t] [-n] [-s switchmask] [-S] [-v [mask]] [-d] [-p] [-i] [-l] [-q] [-c count] [-r] [-b] [device]\n", name);
     fprintf(stderr, "    -t: show time stamps\n");
     fprintf(stderr, "    -n: don't print newlines\n");
     fprintf(stderr, "    -s: print switch states for given bits\n");
@@ -509,18 +509,21 @@ static void usage(char *name)
     fprintf(stderr, "    -q: quiet (clear verbosity mask)\n");
     fprintf(stderr, "    -c: print given number of events then exit\n");
     fprintf(stderr, "    -r: print rate events are received\n");
+    fprintf(stderr, "    -b: write raw binary events to stdout (ignores -t, -n and -l)\n");
 }
 
 int getevent_main(int argc, char *argv[])
 {
     int c;
     int i;
+    int j;
     int res;
     int get_time = 0;
     int print_device = 0;
+    int binary = 0;
     char *newline = "\n";
     uint16_t get_switch = 0;
-    struct input_event event;
+    struct input_event events[64];
     int print_flags = 0;
     int print_flags_set = 0;
     int dont_block = -1;
@@ -530,12 +533,12 @@ int getevent_main(int argc, char *argv[])
     const char *device = NULL;
     const char *device_path = "/dev/input";
 
-    /* disable buffering on stdout */
-    setbuf(stdout, NULL);
+    /* stdout stays buffered; the event loop flushes once per wakeup so a
+     * batch of events costs one write rather than several per event */
 
     opterr = 0;
     do {
-        c = getopt(argc, argv, "tns:Sv::dpilqc:rh");
+        c = getopt(argc, argv, "tns:Sv::dpilqc:rbh");
         if (c == EOF)
             break;
         switch (c) {
@@ -591,6 +594,9 @@ int getevent_main(int argc, char *argv[])
         case 'r':
             sync_rate = 1;
             break;
+        case 'b':
+            binary = 1;
+            break;
         case '?':
             fprintf(stderr, "%s: invalid option -%c\n",
                 argv[0], optopt);
@@ -663,29 +669,41 @@ int getevent_main(int argc, char *argv[])
         for(i = 1; i < nfds; i++) {
             if(ufds[i].revents) {
                 if(ufds[i].revents & POLLIN) {
-                    res = read(ufds[i].fd, &event, sizeof(event));
-                    if(res < (int)sizeof(event)) {
+                    /* drain every complete event the driver has queued in one
+                     * read; at high sample rates one wakeup covers many */
+                    res = read(ufds[i].fd, events, sizeof(events));
+                    if(res < (int)sizeof(events[0])) {
                         fprintf(stderr, "could not get event\n");
                         return 1;
                     }
-                    if(get_time) {
-                        printf("[%8ld.%06ld] ", event.time.tv_sec, event.time.tv_usec);
-                    }
-                    if(print_device)
-                        printf("%s: ", device_names[i]);
-                    print_event(event.type, event.code, event.value, print_flags);
-                    if(sync_rate && event.type == 0 && event.code == 0) {
-                        int64_t now = event.time.tv_sec * 1000000LL + event.time.tv_usec;
-                        if(last_sync_time)
-                            printf(" rate %lld", 1000000LL / (now - last_sync_time));
-                        last_sync_time = now;
+                    for(j = 0; j < res / (int)sizeof(events[0]); j++) {
+                        if(binary) {
+                            fwrite(&events[j], sizeof(events[0]), 1, stdout);
+                        } else {
+                            if(get_time) {
+                                printf("[%8ld.%06ld] ",
+                                       events[j].time.tv_sec, events[j].time.tv_usec);
+                            }
+                            if(print_device)
+                                printf("%s: ", device_names[i]);
+                            print_event(events[j].type, events[j].code, events[j].value,
+                                        print_flags);
+                            if(sync_rate && events[j].type == 0 && events[j].code == 0) {
+                                int64_t now = events[j].time.tv_sec * 1000000LL +
+                                              events[j].time.tv_usec;
+                                if(last_sync_time)
+                                    printf(" rate %lld", 1000000LL / (now - last_sync_time));
+                                last_sync_time = now;
+                            }
+                            printf("%s", newline);
+                        }
+                        if(event_count && --event_count == 0)
+                            return 0;
                     }
-                    printf("%s", newline);
-                    if(event_count && --event_count == 0)
-                        return 0;
                 }
             }
         }
+        fflush(stdout);
     }
 
     return 0;
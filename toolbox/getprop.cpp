@@ -15,6 +15,7 @@
  */
 
 #include <getopt.h>
+#include <string.h>
 #include <sys/system_properties.h>
 
 #include <iostream>
@@ -36,37 +37,49 @@ enum class ResultType {
 };
 
 void PrintAllProperties(ResultType result_type) {
-    std::vector<std::pair<std::string, std::string>> properties;
+    // Collect every name and value into one arena with an offset pair per
+    // property, rather than two heap strings each: getprop is run at high
+    // frequency by health scripts, and the thousands of small allocations
+    // dominated the cost of a full listing.
+    struct Snapshot {
+        std::string arena;  // NUL-terminated names and values, back to back
+        std::vector<std::pair<size_t, size_t>> offsets;
+    } snapshot;
     __system_property_foreach(
         [](const prop_info* pi, void* cookie) {
             __system_property_read_callback(
                 pi,
                 [](void* cookie, const char* name, const char* value, unsigned) {
-                    auto properties =
-                        reinterpret_cast<std::vector<std::pair<std::string, std::string>>*>(cookie);
-                    properties->emplace_back(name, value);
+                    auto snapshot = reinterpret_cast<Snapshot*>(cookie);
+                    auto name_offset = snapshot->arena.size();
+                    snapshot->arena += name;
+                    snapshot->arena += '\0';
+                    auto value_offset = snapshot->arena.size();
+                    snapshot->arena += value;
+                    snapshot->arena += '\0';
+                    snapshot->offsets.emplace_back(name_offset, value_offset);
                 },
                 cookie);
         },
-        &properties);
-
-    std::sort(properties.begin(), properties.end());
-
-    if (result_type != ResultType::Value) {
-        for (auto& [name, value] : properties) {
+        &snapshot);
+
+    // Property names are unique, so sorting by name alone is a total order.
+    const char* arena = snapshot.arena.c_str();
+    std::sort(snapshot.offsets.begin(), snapshot.offsets.end(),
+              [arena](const auto& lhs, const auto& rhs) {
+                  return strcmp(arena + lhs.first, arena + rhs.first) < 0;
+              });
+
+    for (const auto& [name_offset, value_offset] : snapshot.offsets) {
+        const char* name = arena + name_offset;
+        const char* value = arena + value_offset;
+        if (result_type != ResultType::Value) {
             const char* context = nullptr;
             const char* type = nullptr;
-            property_info_file->GetPropertyInfo(name.c_str(), &context, &type);
-            if (result_type == ResultType::Context) {
-                value = context;
-            } else {
-                value = type;
-            }
+            property_info_file->GetPropertyInfo(name, &context, &type);
+            value = (result_type == ResultType::Context) ? context : type;
         }
-    }
-
-    for (const auto& [name, value] : properties) {
-        std::cout << "[" << name << "]: [" << value << "]" << std::endl;
+        std::cout << "[" << name << "]: [" << value << "]\n";
     }
 }
 
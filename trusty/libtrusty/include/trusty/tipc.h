@@ -26,6 +26,7 @@ extern "C" {
 
 int tipc_connect(const char *dev_name, const char *srv_name);
 ssize_t tipc_send(int fd, const struct iovec* iov, int iovcnt, struct trusty_shm* shm, int shmcnt);
+ssize_t tipc_recv(int fd, const struct iovec* iov, int iovcnt);
 int tipc_close(int fd);
 
 #ifdef __cplusplus
@@ -23,6 +23,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include <log/log.h>
@@ -71,6 +72,16 @@ ssize_t tipc_send(int fd, const struct iovec* iov, int iovcnt, struct trusty_shm
     return rc;
 }
 
+ssize_t tipc_recv(int fd, const struct iovec* iov, int iovcnt) {
+    ssize_t rc = readv(fd, iov, iovcnt);
+    if (rc < 0) {
+        rc = -errno;
+        ALOGE("%s: failed to receive message (err=%d)\n", __func__, errno);
+    }
+
+    return rc;
+}
+
 void tipc_close(int fd)
 {
 	close(fd);
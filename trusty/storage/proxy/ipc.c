@@ -32,6 +32,9 @@
 
 static int tipc_fd = -1;
 
+/* first error seen among the batched commands of the current transaction */
+static uint32_t batch_result = STORAGE_NO_ERROR;
+
 int ipc_connect(const char *device, const char *port)
 {
     int rc;
@@ -100,6 +103,25 @@ int ipc_respond(struct storage_msg *msg, void *out, size_t out_size)
 
     assert(tipc_fd >=  0);
 
+    if (msg->flags & STORAGE_MSG_FLAG_BATCH) {
+        /*
+         * batched commands get no individual response; remember the first
+         * failure and send a cumulative result when the batch ends with a
+         * command that has the flag cleared.
+         */
+        if (batch_result == STORAGE_NO_ERROR)
+            batch_result = msg->result;
+        return 0;
+    }
+
+    if (batch_result != STORAGE_NO_ERROR) {
+        /* an earlier command of this batch failed */
+        msg->result = batch_result;
+        out = NULL;
+        out_size = 0;
+    }
+    batch_result = STORAGE_NO_ERROR;
+
     msg->cmd |= STORAGE_RESP_BIT;
 
     rc = writev(tipc_fd, iovs, out ? 2 : 1);